@@ -8,6 +8,40 @@
 #include "cgrad/error.h"
 #include <stdbool.h>
 
+/**
+ * @brief Backpropagates from t, accumulating the gradients of the leaves requiring one.
+ *
+ * The data and gradient of the tensors in the intermediates list of env are released, and set to NULL, as soon as
+ * the last operation reading them is backpropagated, instead of living until cgrad_env_free_intermediates.
+ * The tensors themselves are still freed by cgrad_env_free_intermediates.
+ *
+ * @param t The tensor to backpropagate from, usually the loss.
+ * @param env The environment.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
 cgrad_error backward(struct tensor* t, struct cgrad_env *env);
 
+/**
+ * @brief Backpropagates from t, using seed as the gradient of t with respect to itself instead of 1.
+ *
+ * All the gradients are scaled by seed, which is used for loss scaling in mixed precision training.
+ *
+ * @param t The tensor to backpropagate from, usually the loss.
+ * @param seed The gradient of t with respect to itself.
+ * @param env The environment.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error backward_with_seed(struct tensor* t, const double seed, struct cgrad_env *env);
+
+/**
+ * @brief Sets the function called by backward on each leaf as soon as its gradient is final, e.g. to update a
+ * parameter while the gradient is still in cache. function may be NULL to remove the hook.
+ *
+ * @param env The environment.
+ * @param function The hook, called with arg and the leaf tensor.
+ * @param arg The argument of the hook.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error backward_set_gradient_hook(struct cgrad_env *env, gradient_hook_function function, void *arg);
+
 #endif
\ No newline at end of file
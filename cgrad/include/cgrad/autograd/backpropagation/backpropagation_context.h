@@ -2,6 +2,7 @@
 #define BACKPROPAGATION_CONTEXT_H
 
 #include "cgrad/memory/tensor/tensor_allocator.h"
+#include "cgrad/parallel/thread_pool.h"
 #include "cgrad/error.h"
 #include "cgrad/config.h"
 #include <string.h>
@@ -30,6 +31,8 @@ typedef uint8_t context_id;
  *   contain the owned tensors; otherwise, behavior is undefined.
  *
  * - `n_owned`: The number of owned tensors currently stored in the context.
+ *
+ * - `pool`: Thread pool of the environment which recorded the operation, used by its forward and backward functions.
  */
 struct backpropagation_context
 {
@@ -38,6 +41,7 @@ struct backpropagation_context
     struct tensor *owned[AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE];
     size_t n_owned;
     struct tensor_allocator *owned_allocator;
+    struct thread_pool *pool;
 };
 
 // --- Function declarations ---
@@ -125,6 +129,7 @@ static inline cgrad_error context_init(struct backpropagation_context *const ctx
     memset(ctx->operands_size_t, 0, sizeof(ctx->operands_size_t));
     ctx->n_owned = 0;
     ctx->owned_allocator = autograd_tensor_allocator;
+    ctx->pool = NULL;
 
     return NO_ERROR;
 }
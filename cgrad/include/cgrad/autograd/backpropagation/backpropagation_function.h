@@ -24,10 +24,7 @@ static inline cgrad_error backpropagation_function_check_input(const struct tens
     {
         return AUTOGRAD_BACKPROPAGATION_TENSOR_NULL;
     }
-    if (grad_wrt_operand->dtype != grad_wrt_out->dtype)
-    {
-        return TENSOR_DTYPE_MISMATCH;
-    }
+    // Dtypes may differ, e.g. across tensor_cast or for the float32 loss of half precision logits
 
     return NO_ERROR;
 }
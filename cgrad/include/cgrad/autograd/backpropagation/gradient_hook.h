@@ -0,0 +1,26 @@
+#ifndef GRADIENT_HOOK_H
+#define GRADIENT_HOOK_H
+
+#include "cgrad/error.h"
+#include "cgrad/tensor/tensor.h"
+
+/**
+ * @typedef gradient_hook_function
+ * @brief Function called by backward on each leaf tensor once its gradient is final.
+ *
+ * @param arg The argument given when the hook was set.
+ * @param t The leaf tensor, whose gradient may be consumed and released.
+ */
+typedef cgrad_error (*gradient_hook_function)(void *arg, struct tensor *const t);
+
+/**
+ * @struct gradient_hook
+ * @brief Gradient hook of an environment, see backward_set_gradient_hook.
+ */
+struct gradient_hook
+{
+    gradient_hook_function function; /**< Function called on each leaf, NULL if none. */
+    void *arg;                       /**< Argument passed to function. */
+};
+
+#endif
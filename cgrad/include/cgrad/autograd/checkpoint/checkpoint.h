@@ -0,0 +1,117 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/error.h"
+#include "cgrad/config.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+struct cgrad_env;
+struct computational_graph_node;
+
+/**
+ * @enum checkpoint_policy
+ * @brief Selects how the segments marked with checkpoint_begin and checkpoint_end are handled.
+ */
+typedef enum checkpoint_policy
+{
+    CHECKPOINT_POLICY_STORE,     /**< Segments are ignored, every activation is kept until the end of the step. */
+    CHECKPOINT_POLICY_RECOMPUTE, /**< Only the segment input and output are kept, the rest is recomputed during backpropagation. */
+} checkpoint_policy;
+
+/**
+ * @struct checkpoint_segment
+ * @brief A sequence of operations whose intermediate tensors are released after the forward pass.
+ */
+struct checkpoint_segment
+{
+    struct computational_graph_node *output;                      /**< Node of the segment output, which is kept. */
+    struct computational_graph_node *nodes[AUTOGRAD_MAX_NODES];   /**< Released nodes, in forward order. */
+    size_t size;                                                  /**< Number of released nodes. */
+    size_t n_processed;                                           /**< Number of segment nodes already backpropagated. */
+};
+
+/**
+ * @struct checkpoint_stats
+ * @brief Measures of the memory/compute tradeoff, accumulated until checkpoint_reset_stats is called.
+ */
+struct checkpoint_stats
+{
+    size_t released_bytes;         /**< Bytes of activations released at the end of the segments. */
+    size_t recomputed_bytes;       /**< Bytes of activations recomputed during backpropagation. */
+    size_t n_recomputed_segments;  /**< Number of segments whose forward pass was recomputed. */
+    double recompute_seconds;      /**< Time spent in the recomputation of the segments. */
+};
+
+/**
+ * @struct checkpoint_state
+ * @brief Checkpointing state of an environment.
+ */
+struct checkpoint_state
+{
+    checkpoint_policy policy;
+    size_t active_segment;         /**< Id of the segment being recorded, 0 if none. */
+    bool is_active;
+    struct checkpoint_segment segments[AUTOGRAD_MAX_CHECKPOINT_SEGMENTS];
+    size_t n_segments;
+    struct checkpoint_stats stats;
+};
+
+void checkpoint_state_init(struct checkpoint_state *const state);
+
+/**
+ * @brief Selects whether checkpointed segments trade compute for memory.
+ *
+ * @param env The environment.
+ * @param policy The checkpointing policy, CHECKPOINT_POLICY_RECOMPUTE by default.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error checkpoint_set_policy(struct cgrad_env *const env, const checkpoint_policy policy);
+
+/**
+ * @brief Starts a checkpointed segment. The operations performed with gradient tracking until checkpoint_end
+ * belong to the segment.
+ *
+ * Intermediate tensors of the segment must not be used by operations outside of it, as their data is released
+ * (set to NULL) by checkpoint_end and only regenerated during backpropagation.
+ *
+ * @param env The environment.
+ * @param input The input of the segment, which is kept.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ *         - CHECKPOINT_SEGMENT_ALREADY_ACTIVE if a segment is being recorded.
+ */
+cgrad_error checkpoint_begin(struct cgrad_env *const env, const struct tensor *const input);
+
+/**
+ * @brief Ends the current checkpointed segment, releasing the data of its intermediate tensors.
+ *
+ * The forward pass of the segment is re-run from its input right before its output is backpropagated.
+ * Operations without a forward function are not released.
+ *
+ * @param env The environment.
+ * @param output The output of the segment, which is kept.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ *         - CHECKPOINT_SEGMENT_NOT_ACTIVE if checkpoint_begin was not called.
+ */
+cgrad_error checkpoint_end(struct cgrad_env *const env, struct tensor *const output);
+
+/**
+ * @brief Called by backpropagation when a node is dequeued, recomputes the segment it is the output of.
+ */
+cgrad_error checkpoint_on_node_popped(struct cgrad_env *const env, struct computational_graph_node *const node);
+
+/**
+ * @brief Called by backpropagation once a node has been backpropagated, releases a segment once it is complete.
+ */
+void checkpoint_on_node_processed(struct cgrad_env *const env, struct computational_graph_node *const node);
+
+/**
+ * @brief Forgets the recorded segments, called at the end of backpropagation.
+ */
+void checkpoint_clear_segments(struct cgrad_env *const env);
+
+const struct checkpoint_stats *checkpoint_get_stats(const struct cgrad_env *const env);
+void checkpoint_reset_stats(struct cgrad_env *const env);
+
+#endif
@@ -2,6 +2,7 @@
 #define COMPUTATIONAL_GRAPH_H
 
 #include "cgrad/autograd/backpropagation/backpropagation_function.h"
+#include "cgrad/autograd/computational_graph/forward_function.h"
 #include "cgrad/error.h"
 #include "cgrad/config.h"
 #include <stdbool.h>
@@ -26,6 +27,14 @@ struct computational_graph_node
     size_t children_operands[AUTOGRAD_MAX_CHILDREN];
     struct computational_graph_node *children[AUTOGRAD_MAX_CHILDREN];/**< Array of child nodes. */
     backpropagation_function function[AUTOGRAD_MAX_CHILDREN]; /**< Backpropagation functions for each child. */
+    bool function_accumulates[AUTOGRAD_MAX_CHILDREN]; /**< Whether the function of an operand accumulates into the operand gradient itself. */
+    forward_function forward;                    /**< Function recomputing the tensor from the context, used for replay. */
+    bool backward_reads_operands;                /**< Whether the backpropagation functions read the data of the operands. */
+    bool forward_inplace;                        /**< Whether the forward function may write the tensor over its first operand. */
+    size_t checkpoint_segment;                   /**< Id of the checkpointed segment the node was created in, 0 if none. */
+    bool is_recomputed;                          /**< Whether the tensor data is released after the forward pass and recomputed in backpropagation. */
+    bool is_leaf;                                /**< Whether the tensor is not the result of a tracked operation. */
+    bool is_intermediate;                        /**< Whether the tensor belongs to the intermediates of the environment, released during backpropagation. */
     struct backpropagation_context ctx;              /**< Context needed during backpropagation for computing gradients. */
     bool is_involved_in_backprop;                /**< Flag indicating if the node is involved in backpropagation. */
     bool is_grad_computed;                       /**< Flag indicating if the gradient has been computed. */
@@ -49,9 +58,82 @@ void print_computational_graph_node(const struct computational_graph_node *node)
  */
 static inline cgrad_error computational_graph_node_set_context_tensor(struct computational_graph_node *const node, struct tensor *t, const context_id ctx_id);
 
+/**
+ * @brief Sets the function recomputing the tensor of a computational graph node from its context.
+ *
+ * @param node Pointer to the computational graph node.
+ * @param forward The forward function of the operation which produced the node tensor.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+static inline cgrad_error computational_graph_node_set_forward_function(struct computational_graph_node *const node, forward_function forward);
+
+/**
+ * @brief Describes how the operation which produced a node accesses memory, used by the execution plan memory planner.
+ *
+ * By default the backpropagation functions are assumed to read the operands and the forward function to need
+ * a separate output buffer.
+ *
+ * @param node Pointer to the computational graph node.
+ * @param backward_reads_operands Whether the backpropagation functions read the data of the operands.
+ * @param forward_inplace Whether the forward function is correct when the tensor aliases its first operand.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+static inline cgrad_error computational_graph_node_set_memory_hints(struct computational_graph_node *const node, const bool backward_reads_operands, const bool forward_inplace);
+
+/**
+ * @brief Makes the backpropagation function of an operand accumulate into the gradient of the operand itself.
+ *
+ * The function then receives the operand as grad_wrt_operand instead of a dense gradient of its shape, and adds
+ * its contribution to operand->grad, e.g. as a row-sparse gradient (see tensor_sparse_grad.h). Such operations
+ * cannot be replayed by an execution plan.
+ *
+ * @param node Pointer to the computational graph node.
+ * @param operand_id The operand whose function accumulates.
+ * @return cgrad_error Error code indicating success or failure.
+ */
+static inline cgrad_error computational_graph_node_set_function_accumulates(struct computational_graph_node *const node, const size_t operand_id);
+
 static inline cgrad_error computational_graph_node_set_context_tensor(struct computational_graph_node *const node, struct tensor *t, const context_id ctx_id)
 {
     return context_set_operand(&node->ctx, t, ctx_id);
 }
 
+static inline cgrad_error computational_graph_node_set_forward_function(struct computational_graph_node *const node, forward_function forward)
+{
+    if (!node)
+    {
+        return AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_NULL;
+    }
+
+    node->forward = forward;
+    return NO_ERROR;
+}
+
+static inline cgrad_error computational_graph_node_set_memory_hints(struct computational_graph_node *const node, const bool backward_reads_operands, const bool forward_inplace)
+{
+    if (!node)
+    {
+        return AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_NULL;
+    }
+
+    node->backward_reads_operands = backward_reads_operands;
+    node->forward_inplace = forward_inplace;
+    return NO_ERROR;
+}
+
+static inline cgrad_error computational_graph_node_set_function_accumulates(struct computational_graph_node *const node, const size_t operand_id)
+{
+    if (!node)
+    {
+        return AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_NULL;
+    }
+    if (operand_id >= AUTOGRAD_MAX_CHILDREN)
+    {
+        return AUTOGRAD_INVALID_CONTEXT_ID;
+    }
+
+    node->function_accumulates[operand_id] = true;
+    return NO_ERROR;
+}
+
 #endif
@@ -0,0 +1,21 @@
+#ifndef FORWARD_FUNCTION_H
+#define FORWARD_FUNCTION_H
+
+#include "cgrad/error.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/autograd/backpropagation/backpropagation_context.h"
+
+/**
+ * @typedef forward_function
+ * @brief Function pointer type for recomputing the output of an operation.
+ *
+ * Recomputes the result of a recorded operation in place, reading its inputs from the context
+ * filled when the operation was linked in the computational graph. Used to replay a recorded
+ * graph without rebuilding it.
+ *
+ * @param ctx Pointer to the context containing the operation inputs.
+ * @param out Already allocated output tensor of the operation.
+ */
+typedef cgrad_error (*forward_function)(const struct backpropagation_context *const ctx, struct tensor *const out);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef EXECUTION_PLAN_H
+#define EXECUTION_PLAN_H
+
+#include "cgrad/autograd/computational_graph/computational_graph.h"
+#include "cgrad/datastructures/tensor_list.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/cgrad_env.h"
+#include "cgrad/error.h"
+#include "cgrad/config.h"
+#include <stdbool.h>
+
+// Each node contributes at most its tensor and its gradient, plus the temporary gradient buffers
+#define EXECUTION_PLAN_MAX_PLANNED_TENSORS (3 * AUTOGRAD_MAX_NODES)
+
+/**
+ * @struct execution_plan
+ * @brief A recorded training step which can be replayed without rebuilding the computational graph.
+ *
+ * The plan is captured from the graph built by a regular forward pass. It stores the graph nodes in
+ * topological order and a preassigned buffer for every gradient flowing along each edge, so that a
+ * replay performs no graph construction and no allocation: the forward pass is recomputed in place
+ * through the forward function of each node, followed by the backward pass.
+ *
+ * Shapes are fixed at capture time. New inputs are copied into the captured leaf tensors through
+ * execution_plan_feed, which fails with EXECUTION_PLAN_SHAPE_MISMATCH when the shapes differ (e.g. on
+ * the last partial batch), in which case the caller falls back to an eager step or captures a new plan.
+ */
+struct execution_plan
+{
+    struct computational_graph_node *nodes[AUTOGRAD_MAX_NODES];                         /**< Recorded nodes in topological order, loss first. */
+    size_t size;                                                                        /**< Number of recorded nodes. */
+    struct tensor *edge_gradients[AUTOGRAD_MAX_NODES][AUTOGRAD_MAX_CHILDREN];           /**< Buffer receiving the gradient of each edge, NULL towards tensors not requiring one. */
+    bool edge_accumulates[AUTOGRAD_MAX_NODES][AUTOGRAD_MAX_CHILDREN];                   /**< Whether the edge buffer is a temporary to accumulate into the child gradient. */
+    struct tensor *temporaries[AUTOGRAD_MAX_NODES];                                     /**< Temporary gradient buffers owned by the plan. */
+    size_t n_temporaries;                                                               /**< Number of temporary gradient buffers. */
+    struct tensor_list *intermediates;                                                  /**< Intermediates of the recorded step, owned by the plan. */
+    struct tensor *planned_tensors[EXECUTION_PLAN_MAX_PLANNED_TENSORS];                 /**< Tensors whose data lives in a shared buffer, see execution_plan_plan_memory. */
+    size_t n_planned_tensors;                                                           /**< Number of tensors in a shared buffer. */
+    void *buffers[EXECUTION_PLAN_MAX_PLANNED_TENSORS];                                  /**< Shared buffers owned by the plan. */
+    size_t n_buffers;                                                                   /**< Number of shared buffers. */
+    struct tensor *loss;                                                                /**< The recorded loss tensor. */
+    struct cgrad_env *env;                                                              /**< Environment the plan was captured in. */
+    bool is_captured;                                                                   /**< Whether the plan holds a recorded step. */
+};
+
+/**
+ * @brief Records the computational graph ending in loss into an execution plan and runs its backward pass.
+ *
+ * Must be called in place of backward() after a forward pass with gradient tracking. The recorded graph is
+ * detached from its tensors, so eager steps can still be performed on the same parameters while the plan is
+ * alive. The intermediates currently registered in the environment are moved into the plan.
+ *
+ * @param plan Pointer to the execution plan to capture.
+ * @param loss The loss tensor, root of the computational graph.
+ * @param env The environment used for the forward pass.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ *         - EXECUTION_PLAN_OPERATION_NOT_REPLAYABLE if an operation has no forward function.
+ *         - EXECUTION_PLAN_FUSED_BACKWARD if a gradient hook is set, e.g. by sgd_optimizer_fuse_backward.
+ */
+cgrad_error execution_plan_capture(struct execution_plan *const plan, struct tensor *const loss, struct cgrad_env *const env);
+
+/**
+ * @brief Copies new values into a leaf tensor of the recorded step, such as the input batch or the targets.
+ *
+ * @param plan Pointer to the captured execution plan.
+ * @param captured The tensor used as input when the plan was captured.
+ * @param value The new values.
+ * @return NO_ERROR if successful, EXECUTION_PLAN_SHAPE_MISMATCH if the plan cannot be replayed on value.
+ */
+cgrad_error execution_plan_feed(const struct execution_plan *const plan, struct tensor *const captured, const struct tensor *const value);
+
+/**
+ * @brief Replays the recorded forward and backward passes on the current content of the leaf tensors.
+ *
+ * Gradients of the leaf tensors (e.g. parameters) are accumulated as in backward(), while gradients of the
+ * intermediate tensors are overwritten.
+ *
+ * @param plan Pointer to the captured execution plan.
+ * @return NO_ERROR if successful, EXECUTION_PLAN_FUSED_BACKWARD if a gradient hook was set since the capture,
+ * otherwise an appropriate error code.
+ */
+cgrad_error execution_plan_replay(struct execution_plan *const plan);
+
+/**
+ * @brief Frees the recorded graph, the temporary gradient buffers and the intermediates owned by the plan.
+ *
+ * Tensors placed in shared buffers by execution_plan_plan_memory get back a buffer of their own.
+ *
+ * Tensors returned to the caller during the recorded forward pass (layer outputs, loss) must be freed by
+ * the caller after this call.
+ *
+ * @param plan Pointer to the execution plan.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ *         - TENSOR_ALLOCATION_FAILED if the planned tensors cannot get a buffer of their own, in which case nothing
+ *           is freed and the plan can still be replayed.
+ */
+cgrad_error execution_plan_cleanup(struct execution_plan *const plan);
+
+#endif
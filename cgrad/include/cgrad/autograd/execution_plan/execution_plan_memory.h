@@ -0,0 +1,53 @@
+#ifndef EXECUTION_PLAN_MEMORY_H
+#define EXECUTION_PLAN_MEMORY_H
+
+#include "cgrad/autograd/execution_plan/execution_plan.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+
+/**
+ * @struct execution_plan_memory_stats
+ * @brief Memory footprint of the tensors handled by the memory planner, in bytes.
+ */
+struct execution_plan_memory_stats
+{
+    size_t naive_bytes;     /**< Memory needed when every planned tensor has a buffer of its own. */
+    size_t planned_bytes;   /**< Memory of the shared buffers assigned by the planner. */
+    size_t peak_live_bytes; /**< Largest amount of memory alive at the same time, a lower bound for planned_bytes. */
+    size_t n_tensors;       /**< Number of planned tensors. */
+    size_t n_buffers;       /**< Number of shared buffers. */
+};
+
+/**
+ * @brief Places the intermediate tensors and gradients of a captured plan into a small set of shared buffers.
+ *
+ * The planner computes the lifetime of each intermediate tensor, gradient and temporary gradient buffer over
+ * a replay, that is from the forward step producing it to the last forward or backward step reading it.
+ * Tensors whose lifetimes do not overlap are assigned the same buffer by greedy interval colouring, and the
+ * output of an operation flagged as in-place may take over the buffer of its first operand when it is the
+ * last reader. The original buffers are released to the allocator.
+ *
+ * After planning, only the value of the loss and the gradients of the leaf tensors (e.g. parameters) are
+ * meaningful after a replay: the data of intermediate tensors and their gradients is overwritten by the
+ * tensors sharing their buffer.
+ *
+ * @param plan Pointer to the captured execution plan.
+ * @param stats Pointer to the statistics of the planning, may be NULL.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ *         - EXECUTION_PLAN_MEMORY_ALREADY_PLANNED if the plan memory has already been planned.
+ */
+cgrad_error execution_plan_plan_memory(struct execution_plan *const plan, struct execution_plan_memory_stats *const stats);
+
+/**
+ * @brief Releases the shared buffers of a plan, giving a buffer of its own back to each planned tensor.
+ *
+ * Called by execution_plan_cleanup, does nothing if the plan memory has not been planned. If a buffer cannot be
+ * allocated, the shared buffers are kept and the plan is left as it was.
+ *
+ * @param plan Pointer to the execution plan.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ *         - TENSOR_ALLOCATION_FAILED if a planned tensor cannot get a buffer of its own.
+ */
+cgrad_error execution_plan_release_memory(struct execution_plan *const plan);
+
+#endif
@@ -1,9 +1,13 @@
 #ifndef CGRAD_ENV_H 
 #define CGRAD_ENV_H 
 
+#include "cgrad/autograd/backpropagation/gradient_hook.h"
+#include "cgrad/autograd/checkpoint/checkpoint.h"
 #include "cgrad/datastructures/tensor_list.h"
 #include "cgrad/memory/tensor/tensor_allocator.h"
 #include "cgrad/memory/computational_graph/computational_graph_allocator.h"
+#include "cgrad/parallel/thread_pool.h"
+#include "cgrad/utils/philox.h"
 
 struct cgrad_env
 {
@@ -11,9 +15,37 @@ struct cgrad_env
     struct tensor_allocator tensor_alloc;
     struct tensor_list *tensor_alloc_intermediates;
     struct computational_graph_allocator graph_alloc;
+    struct checkpoint_state checkpoint;
+    struct gradient_hook grad_hook;          /**< Called by backward on each leaf once its gradient is final. */
+    struct philox_state rng;                 /**< Generator of the environment, used e.g. by parameter initializations. */
+    struct thread_pool *pool;                /**< Threads of the kernels, NULL to run them on the calling thread. */
 };
 
+/**
+ * @brief Initializes an environment, with a thread pool of thread_pool_default_size() threads.
+ */
 cgrad_error cgrad_env_init(struct cgrad_env *env, const unsigned int seed, const size_t intermediates_capacity);
+
+/**
+ * @brief Initializes an execution context for one thread, i.e. an environment with its own tensor and graph
+ * pools and intermediates list, which leaves the random generator untouched.
+ *
+ * An environment is never shared between threads: each thread running forward passes on a shared model
+ * uses its own context, so that allocations need no locking. The generator of the context is seeded with 0,
+ * threads needing random numbers are given their own stream, e.g. ctx.rng = philox_stream(&env.rng, thread_index).
+ * The context has no thread pool, since its thread already shares the cores with the others.
+ * Released with cgrad_env_cleanup.
+ */
+cgrad_error cgrad_env_context_init(struct cgrad_env *env, const size_t intermediates_capacity);
+
+/**
+ * @brief Replaces the thread pool of the environment with one of n_threads threads, or removes it if
+ * n_threads is 1.
+ *
+ * Must not be called while the environment is running a kernel, nor before the graphs recorded with the
+ * previous pool are released.
+ */
+cgrad_error cgrad_env_set_num_threads(struct cgrad_env *env, const size_t n_threads);
 void cgrad_env_cleanup(struct cgrad_env *env);
 cgrad_error cgrad_env_free_intermediates(struct cgrad_env *env);
 
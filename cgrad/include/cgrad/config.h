@@ -13,6 +13,7 @@
 #define AUTOGRAD_MAX_CHILDREN 8
 #define AUTOGRAD_MAX_TARGETS 128
 #define AUTOGRAD_MAX_BACKPROPAGATION_FUNCTION_CONTEXT_SIZE 8
+#define AUTOGRAD_MAX_CHECKPOINT_SEGMENTS 16
 
 // Dataset
 #define DATASET_CSV_MAX_LINE_CHAR_LENGTH 8192
@@ -3,6 +3,7 @@
 
 #include "cgrad/dataset/indexes_permutation.h"
 #include "cgrad/tensor/tensor.h"
+#include "cgrad/tensor/sparse_tensor.h"
 #include "cgrad/cgrad_env.h"
 #include "cgrad/error.h"
 #include <stddef.h>
@@ -31,10 +32,38 @@ struct csv_dataset *csv_dataset_alloc(const char *csv_path);
 /**
  * @brief Samples a batch of data from the dataset using the provided indexes.
  *
- * TODO
+ * The inputs and targets do not require a gradient, see tensor_set_requires_grad.
  */
 cgrad_error csv_dataset_sample_batch(const struct csv_dataset *const dataset, struct tensor **const inputs, struct tensor **const targets, const struct indexes_batch *const ixs_batch, const cgrad_dtype dtype, struct cgrad_env *const env);
 
+/**
+ * @brief Samples a batch of data from the dataset into already allocated tensors.
+ *
+ * @param dataset Pointer to the csv_dataset.
+ * @param inputs Tensor of shape [batch_size, cols - 1] receiving the features.
+ * @param targets Tensor of shape [batch_size, 1] receiving the labels.
+ * @param ixs_batch Indexes of the rows to sample.
+ * @return NO_ERROR on success, TENSOR_SHAPE_MISMATCH if the tensors do not match the batch size.
+ */
+cgrad_error csv_dataset_sample_batch_into(const struct csv_dataset *const dataset, struct tensor *const inputs, struct tensor *const targets, const struct indexes_batch *const ixs_batch);
+
+/**
+ * @brief Samples a batch of data from the dataset, storing only the nonzero features.
+ *
+ * The inputs are allocated in CSR format, see linear_forward_sparse, and freed with sparse_tensor_free. The
+ * targets are dense as in csv_dataset_sample_batch. Features must not be standard scaled, which would make them
+ * nonzero.
+ *
+ * @param dataset Pointer to the csv_dataset.
+ * @param inputs Sparse tensor of shape [batch_size, cols - 1] receiving the features.
+ * @param targets Set to the tensor of shape [batch_size, 1] holding the labels.
+ * @param ixs_batch Indexes of the rows to sample.
+ * @param dtype Dtype of the values and targets, DTYPE_FLOAT64 or DTYPE_FLOAT32.
+ * @param env The environment allocating the tensors.
+ * @return NO_ERROR on success, or an error code on failure.
+ */
+cgrad_error csv_dataset_sample_batch_sparse(const struct csv_dataset *const dataset, struct sparse_tensor *const inputs, struct tensor **const targets, const struct indexes_batch *const ixs_batch, const cgrad_dtype dtype, struct cgrad_env *const env);
+
 /**
  * @brief Applies standard scaling (zero mean, unit variance) to the dataset features.
  *
@@ -50,7 +50,15 @@ static inline cgrad_error tensor_list_add(struct tensor_list *const list, struct
     }
     if (list->size == list->capacity)
     {
-        return TENSOR_LIST_FULL;
+        // Grows as needed, the capacity given on allocation being a hint
+        const size_t capacity = list->capacity > 0 ? 2 * list->capacity : 1;
+        struct tensor **data = (struct tensor **)realloc(list->data, capacity * sizeof(struct tensor *));
+        if (!data)
+        {
+            return TENSOR_LIST_FULL;
+        }
+        list->data = data;
+        list->capacity = capacity;
     }
 
     list->data[list->size++] = t;
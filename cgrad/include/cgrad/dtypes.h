@@ -3,15 +3,21 @@
 
 #include <inttypes.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 typedef enum 
 {
     DTYPE_FLOAT64,
     DTYPE_FLOAT32,
     DTYPE_INT32,
+    DTYPE_BFLOAT16,  /**< Storage only, operations accumulate in float32. */
+    DTYPE_FLOAT16,   /**< Storage only, operations accumulate in float32. */
+    DTYPE_INT8,      /**< Quantized weights, see quantization/quantize.h. */
+    DTYPE_UINT8,     /**< Quantized activations, see quantization/quantize.h. */
 } cgrad_dtype;
 
 static inline size_t dtype_sizeof(cgrad_dtype dtype);
+static inline bool dtype_is_half(cgrad_dtype dtype);
 
 static inline size_t dtype_sizeof(cgrad_dtype dtype)
 {
@@ -23,9 +29,21 @@ static inline size_t dtype_sizeof(cgrad_dtype dtype)
             return sizeof(double);
         case DTYPE_INT32:
             return sizeof(int32_t);
+        case DTYPE_BFLOAT16:
+        case DTYPE_FLOAT16:
+            return sizeof(uint16_t);
+        case DTYPE_INT8:
+            return sizeof(int8_t);
+        case DTYPE_UINT8:
+            return sizeof(uint8_t);
         default:
             return 0;
     }
 }
 
+static inline bool dtype_is_half(cgrad_dtype dtype)
+{
+    return dtype == DTYPE_BFLOAT16 || dtype == DTYPE_FLOAT16;
+}
+
 #endif
\ No newline at end of file
@@ -23,15 +23,33 @@ typedef enum
     TENSOR_INVALID_DTYPE,
     TENSOR_DTYPE_MISMATCH,
     TENSOR_ALLOCATION_FAILED,
+    TENSOR_GRAD_SPARSE,          /**< The operation does not support row-sparse gradients. */
 
     OPERATION_INVALID_TENSOR_DTYPE,
 
+    // Sparse tensors
+    SPARSE_TENSOR_NULL,
+    SPARSE_TENSOR_INVALID_INDEXES,   /**< Row offsets decreasing or column indexes out of bounds. */
+
     // Model errors
     MODEL_MAX_PARAMS_EXCEEDED,
     MODEL_PARAMS_NULL,
+    MODEL_CHECKPOINT_FILE_ERROR,
+    MODEL_CHECKPOINT_INVALID_FORMAT,
+    MODEL_CHECKPOINT_VERSION_MISMATCH,
+    MODEL_CHECKPOINT_PARAMS_MISMATCH,
+    MODEL_CHECKPOINT_MAPPING_NULL,
+    MODEL_CHECKPOINT_WRITER_NULL,
+    MODEL_CHECKPOINT_WRITER_INIT_FAILED,
+    MODEL_CHECKPOINT_WRITER_ALLOCATION_FAILED,
 
     // Optimizers
     OPTIMIZER_NULL,
+    LOSS_SCALER_NULL,
+    LOSS_SCALER_FUSED_BACKWARD,          /**< The optimizer would update the parameters from the scaled gradients. */
+    GRAD_ACCUMULATOR_NULL,
+    GRAD_ACCUMULATOR_INVALID_MICRO_BATCHES,
+    GRAD_ACCUMULATOR_FUSED_BACKWARD,     /**< The optimizer updates the parameters from within backward. */
 
     // Allocator
     ALLOCATORS_NULL,
@@ -47,6 +65,7 @@ typedef enum
     AUTOGRAD_INVALID_CONTEXT_ID,
     AUTOGRAD_CONTEXT_ID_ALREADY_TAKEN,
     AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_ALLOCATION_ERROR,
+    AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_NULL,
     AUTOGRAD_BACKPROPAGATION_CONTEXT_NULL,
     AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL,
 
@@ -62,6 +81,51 @@ typedef enum
     AUTOGRAD_BACKPROPAGATION_INVALID_TENSOR_DTYPE,
     AUTOGRAD_BACKPROPAGATION_TENSOR_NULL,
 
+    // Execution plan
+    EXECUTION_PLAN_NULL,
+    EXECUTION_PLAN_NOT_CAPTURED,
+    EXECUTION_PLAN_OPERATION_NOT_REPLAYABLE,
+    EXECUTION_PLAN_SHAPE_MISMATCH,
+    EXECUTION_PLAN_MEMORY_ALREADY_PLANNED,
+    EXECUTION_PLAN_BUFFER_ALLOCATION_FAILED,
+    EXECUTION_PLAN_FUSED_BACKWARD,       /**< A gradient hook is set, which the replayed backward does not call. */
+
+    // Checkpoint
+    CHECKPOINT_SEGMENT_ALREADY_ACTIVE,
+    CHECKPOINT_SEGMENT_NOT_ACTIVE,
+    CHECKPOINT_MAX_SEGMENTS_EXCEEDED,
+
+    // Quantization
+    QUANT_PARAMS_NULL,
+    QUANT_INVALID_PARAMS,
+    QUANT_OBSERVER_NULL,
+    QUANT_OBSERVER_EMPTY,
+
+    // Inference batcher
+    INFERENCE_BATCHER_NULL,
+    INFERENCE_BATCHER_INVALID_CONFIG,
+    INFERENCE_BATCHER_INIT_FAILED,
+    INFERENCE_BATCHER_QUEUE_FULL,
+    INFERENCE_BATCHER_STOPPED,
+    INFERENCE_BATCHER_OUTPUT_MISMATCH,
+    INFERENCE_FUTURE_NULL,
+
+    // Data parallel
+    DATA_PARALLEL_TRAINER_NULL,
+    DATA_PARALLEL_INVALID_CONFIG,
+    DATA_PARALLEL_INIT_FAILED,
+    DATA_PARALLEL_PARAMS_MISMATCH,
+    ALLREDUCE_BACKEND_NULL,
+    ALLREDUCE_INIT_FAILED,
+    PROCESS_GROUP_LAUNCH_FAILED,
+    PROCESS_GROUP_WORKER_FAILED,
+    THREAD_POOL_NULL,
+    THREAD_POOL_INIT_FAILED,
+
+    // GEMM
+    GEMM_BACKEND_UNAVAILABLE,
+    PACKED_WEIGHT_INIT_FAILED,
+
     // Datastructures
     TENSOR_LIST_NULL,
     TENSOR_LIST_FULL,
@@ -78,6 +142,12 @@ typedef enum
     // Reshape
     TENSOR_RESHAPE_INVALID_SHAPE,
 
+    // Permute
+    TENSOR_PERMUTE_INVALID_AXES,
+
+    // Reduce
+    TENSOR_REDUCE_INVALID_AXES,
+
     // Index Batch
     INDEXES_BATCH_NULL,
 
@@ -98,7 +168,11 @@ typedef enum
 
     // Conv2d
     CONV2D_NULL,
-    CONV2D_CHANNELS_MISMATCH
+    CONV2D_CHANNELS_MISMATCH,
+
+    // Embedding
+    EMBEDDING_NULL,
+    EMBEDDING_INVALID_DTYPE
 
 } cgrad_error;
 
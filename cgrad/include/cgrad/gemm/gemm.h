@@ -0,0 +1,88 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "cgrad/parallel/thread_pool.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+
+// Environment variable selecting the backend at startup, either "native" or "blas"
+#define GEMM_BACKEND_ENV "CGRAD_GEMM_BACKEND"
+
+typedef enum gemm_transpose
+{
+    GEMM_NO_TRANS,
+    GEMM_TRANS,
+} gemm_transpose;
+
+/**
+ * @enum gemm_backend
+ * @brief Implementation of the matrix products.
+ *
+ * GEMM_BACKEND_BLAS is only available when the library is built with CGRAD_USE_BLAS, in which case it is the
+ * default. GEMM_BACKEND_NATIVE is the built-in implementation, packing panels of the operands into cache sized
+ * blocks consumed by a register tiled AVX2 or AVX-512 micro kernel, and splitting the columns of the output
+ * across the threads of a pool.
+ */
+typedef enum gemm_backend
+{
+    GEMM_BACKEND_NATIVE,
+    GEMM_BACKEND_BLAS,
+} gemm_backend;
+
+/**
+ * @struct gemm_packed_b
+ * @brief Right-hand side of a product packed ahead of time in the layout consumed by the native micro kernel.
+ *
+ * Lets operands multiplied repeatedly, such as the weights of a layer, be packed once instead of by every
+ * product. The buffer is reused by later packings of matrices of the same size or smaller.
+ */
+struct gemm_packed_b
+{
+    size_t k;
+    size_t n;
+    size_t capacity;                  /**< Size in bytes of data. */
+    void *data;
+};
+
+/**
+ * @brief Selects the backend of all the subsequent products.
+ *
+ * @return NO_ERROR if successful, GEMM_BACKEND_UNAVAILABLE if the library was built without BLAS.
+ */
+cgrad_error gemm_set_backend(const gemm_backend backend);
+
+/**
+ * @brief Backend in use, initially the one named by CGRAD_GEMM_BACKEND if set and available.
+ */
+gemm_backend gemm_get_backend(void);
+
+/**
+ * @brief Computes C = op(A) op(B) on row-major matrices, with op(A) of shape {m, k} and op(B) of shape {k, n}.
+ *
+ * The element (i, p) of op(A) is a[i * lda + p], or a[p * lda + i] if trans_a is GEMM_TRANS, and likewise for
+ * op(B). The pool is only used by the native backend, and may be NULL.
+ *
+ * @return NO_ERROR if successful, TENSOR_ALLOCATION_FAILED if the packing buffers could not be allocated.
+ */
+cgrad_error gemm_f32(const gemm_transpose trans_a, const gemm_transpose trans_b, const size_t m, const size_t n, const size_t k, const float *const a, const size_t lda, const float *const b, const size_t ldb, float *const c, const size_t ldc, struct thread_pool *const pool);
+cgrad_error gemm_f64(const gemm_transpose trans_a, const gemm_transpose trans_b, const size_t m, const size_t n, const size_t k, const double *const a, const size_t lda, const double *const b, const size_t ldb, double *const c, const size_t ldc, struct thread_pool *const pool);
+
+void gemm_packed_b_init(struct gemm_packed_b *const packed);
+
+/**
+ * @brief Packs op(B), of shape {k, n}, with the same conventions as gemm_f32.
+ *
+ * @return NO_ERROR if successful, TENSOR_ALLOCATION_FAILED if the buffer could not be allocated.
+ */
+cgrad_error gemm_pack_b_f32(const gemm_transpose trans_b, const size_t k, const size_t n, const float *const b, const size_t ldb, struct gemm_packed_b *const packed, struct thread_pool *const pool);
+cgrad_error gemm_pack_b_f64(const gemm_transpose trans_b, const size_t k, const size_t n, const double *const b, const size_t ldb, struct gemm_packed_b *const packed, struct thread_pool *const pool);
+
+/**
+ * @brief Computes C = op(A) B with B packed by gemm_pack_b_f32, always on the native backend.
+ */
+cgrad_error gemm_packed_f32(const gemm_transpose trans_a, const size_t m, const float *const a, const size_t lda, const struct gemm_packed_b *const b, float *const c, const size_t ldc, struct thread_pool *const pool);
+cgrad_error gemm_packed_f64(const gemm_transpose trans_a, const size_t m, const double *const a, const size_t lda, const struct gemm_packed_b *const b, double *const c, const size_t ldc, struct thread_pool *const pool);
+
+void gemm_packed_b_cleanup(struct gemm_packed_b *const packed);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef PACKED_WEIGHT_H
+#define PACKED_WEIGHT_H
+
+#include "cgrad/gemm/gemm.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/parallel/thread_pool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+/**
+ * @struct packed_weight
+ * @brief Weight of a layer packed for the native GEMM, so that the forward passes do not pack it again.
+ *
+ * The weight is viewed as a matrix of shape {shape[0], data_size / shape[0]}. The packing is redone when the
+ * weight is modified, which is detected through its version (see tensor_mark_modified) and its data pointer.
+ *
+ * The cache is shared by all the contexts running the layer. Checking that the packing is up to date is lock-free:
+ * source is stored with release semantics once the packing is complete, so that readers loading it with acquire
+ * semantics see the packed data. The mutex is only taken to repack.
+ */
+struct packed_weight
+{
+    pthread_mutex_t mutex;                      /**< Serializes the packings. */
+    _Atomic(const struct tensor *) source;      /**< Weight packed last, NULL if none or while packing. */
+    _Atomic(const void *) source_data;
+    atomic_size_t source_version;
+    atomic_int trans;
+    struct gemm_packed_b packed;
+};
+
+cgrad_error packed_weight_init(struct packed_weight *const cache);
+
+/**
+ * @brief Returns op(weight) packed, packing it first if it was modified since the last call.
+ *
+ * Sets *packed to NULL if cache is NULL, if the BLAS backend is selected, which packs its operands itself, or if
+ * the weight is neither float32 nor float64. Concurrent forward passes may share a cache as long as none of
+ * them modifies the weight, and only take its mutex when the weight was modified since the last packing.
+ *
+ * @return NO_ERROR if successful, TENSOR_ALLOCATION_FAILED if the packed buffer could not be allocated.
+ */
+cgrad_error packed_weight_get(struct packed_weight *const cache, const struct tensor *const weight, const gemm_transpose trans, const struct gemm_packed_b **const packed, struct thread_pool *const pool);
+void packed_weight_cleanup(struct packed_weight *const cache);
+
+#endif
@@ -6,6 +6,7 @@
 #include "cgrad/memory/tensor/tensor_allocator.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/gemm/packed_weight.h"
 #include "cgrad/cgrad_env.h"
 #include <stddef.h>
 
@@ -16,10 +17,18 @@ struct conv2d
     size_t out_channels;
     size_t kernel_size;
     struct cgrad_env *env;
+    struct packed_weight *packed_weight;  /**< Kernel packed for the forward passes, repacked when it is modified. */
 };
 
 cgrad_error conv2d_init(struct conv2d *const layer, const size_t in_channels, const size_t out_channels, const size_t kernel_size, const cgrad_dtype dtype, struct cgrad_env *const env);
 cgrad_error conv2d_forward(struct conv2d *const layer, struct tensor *const x, struct tensor **const out, const bool track_grad);
+
+/**
+ * @brief Computes the forward pass allocating from env instead of the environment of the layer.
+ *
+ * As with linear_forward_env, untracked forward passes may run concurrently on a shared layer.
+ */
+cgrad_error conv2d_forward_env(const struct conv2d *const layer, struct tensor *const x, struct tensor **const out, const bool track_grad, struct cgrad_env *const env);
 cgrad_error conv2d_xavier_init(struct conv2d *const layer);
 void conv2d_cleanup(struct conv2d *const layer);
 
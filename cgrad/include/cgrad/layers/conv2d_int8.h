@@ -0,0 +1,61 @@
+#ifndef CONV2D_INT8_H
+#define CONV2D_INT8_H
+
+#include "cgrad/layers/conv2d.h"
+#include "cgrad/quantization/quantize.h"
+#include "cgrad/quantization/qgemm.h"
+#include "cgrad/cgrad_env.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct conv2d_int8
+ * @brief Inference-only 2D convolution with DTYPE_INT8 weights, obtained by post-training quantization of a conv2d layer.
+ */
+struct conv2d_int8
+{
+    struct qgemm_weights weight;         /**< Kernel quantized with shape {out_channels, in_channels * kernel_size * kernel_size}. */
+    struct quant_params input_params;    /**< Quantization parameters of the input, from calibration. */
+    struct quant_params output_params;   /**< Quantization parameters of the output, if requantize_output is set. */
+    bool fuse_relu;
+    bool requantize_output;
+    size_t in_channels;
+    size_t out_channels;
+    size_t kernel_size;
+    struct cgrad_env *env;
+};
+
+/**
+ * @brief Quantizes a trained conv2d layer. The original layer is not modified and can be released.
+ *
+ * @param qlayer The quantized layer.
+ * @param layer The float layer.
+ * @param input_params Quantization parameters of the layer input, usually computed by a quant_observer.
+ * @param granularity Granularity of the kernel scales, QUANT_PER_CHANNEL has a scale for each output channel.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error conv2d_int8_init(struct conv2d_int8 *const qlayer, const struct conv2d *const layer, const struct quant_params *const input_params, const quant_granularity granularity);
+
+/**
+ * @brief Fuses a ReLU and, if output_params is not NULL, the requantization of the output into the layer.
+ *
+ * @param qlayer The quantized layer.
+ * @param relu Whether a ReLU is applied to the output.
+ * @param output_params Quantization parameters of the output, or NULL for a DTYPE_FLOAT32 output.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error conv2d_int8_set_output(struct conv2d_int8 *const qlayer, const bool relu, const struct quant_params *const output_params);
+
+/**
+ * @brief Computes the convolution, without gradient tracking.
+ *
+ * @param qlayer The quantized layer.
+ * @param x The input of shape {batch_size, in_channels, height, width}, either DTYPE_UINT8 already quantized with the
+ *          layer input parameters, or DTYPE_FLOAT32/DTYPE_FLOAT64, which is quantized first.
+ * @param out Pointer to the output tensor pointer, of shape {batch_size, out_channels, height_out, width_out}.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error conv2d_int8_forward(struct conv2d_int8 *const qlayer, const struct tensor *const x, struct tensor **const out);
+void conv2d_int8_cleanup(struct conv2d_int8 *const qlayer);
+
+#endif
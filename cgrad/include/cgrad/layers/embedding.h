@@ -0,0 +1,44 @@
+#ifndef EMBEDDING_H
+#define EMBEDDING_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/cgrad_env.h"
+#include <stddef.h>
+
+/**
+ * @struct embedding
+ * @brief Maps categorical indexes to rows of a weight of shape [n_embeddings, dim].
+ *
+ * The gradient of the weight is row-sparse, holding only the rows looked up since it was last cleared (see
+ * tensor_sparse_grad.h), and sgd_optimizer_step updates those rows only, so that the cost of a training step
+ * depends on the number of indexes and not on n_embeddings.
+ */
+struct embedding
+{
+    struct tensor *weight;
+    size_t n_embeddings;
+    size_t dim;
+    struct cgrad_env *env;
+};
+
+cgrad_error embedding_init(struct embedding *const layer, const size_t n_embeddings, const size_t dim, const cgrad_dtype dtype, struct cgrad_env *const env);
+
+/**
+ * @brief Gathers the rows of the weight selected by indexes.
+ *
+ * @param layer The embedding.
+ * @param indexes DTYPE_INT32 tensor of any shape, with values in [0, n_embeddings).
+ * @param out Set to the tensor of shape [indexes->data_size, dim], row i being the row indexes[i] of the weight.
+ * @param track_grad Whether the lookup is recorded for backpropagation.
+ * @return NO_ERROR if successful, TENSOR_INDEX_OUT_OF_BOUNDS if an index is out of range, otherwise an appropriate
+ * error code.
+ */
+cgrad_error embedding_forward(struct embedding *const layer, struct tensor *const indexes, struct tensor **const out, const bool track_grad);
+
+/**
+ * @brief Initializes the weight from a standard normal distribution.
+ */
+cgrad_error embedding_normal_init(struct embedding *const layer);
+void embedding_cleanup(struct embedding *const layer);
+
+#endif
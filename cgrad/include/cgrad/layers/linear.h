@@ -2,10 +2,12 @@
 #define LINEAR_H
 
 #include "cgrad/tensor/tensor.h"
+#include "cgrad/tensor/sparse_tensor.h"
 #include "cgrad/datastructures/tensor_list.h"
 #include "cgrad/memory/tensor/tensor_allocator.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/gemm/packed_weight.h"
 #include "cgrad/cgrad_env.h"
 #include <stddef.h>
 
@@ -16,10 +18,26 @@ struct linear
     size_t in_dim;
     size_t out_dim;
     struct cgrad_env *env;
+    struct packed_weight *packed_weight;  /**< Weight packed for the forward passes, repacked when it is modified. */
 };
 
 cgrad_error linear_init(struct linear *const layer, const size_t in_dim, const size_t out_dim, const cgrad_dtype dtype, struct cgrad_env *const env);
 cgrad_error linear_forward(struct linear *const layer, struct tensor *const x, struct tensor **const out, const bool track_grad);
+
+/**
+ * @brief Computes the forward pass allocating from env instead of the environment of the layer.
+ *
+ * Without gradient tracking the parameters are only read, so several threads may run forward passes on the
+ * same layer concurrently, each with its own environment (see cgrad_env_context_init).
+ */
+cgrad_error linear_forward_env(const struct linear *const layer, struct tensor *const x, struct tensor **const out, const bool track_grad, struct cgrad_env *const env);
+
+/**
+ * @brief Computes the forward pass on a sparse batch, at a cost proportional to its number of values.
+ *
+ * The gradient flows to the weight and bias only. x must outlive the backward pass.
+ */
+cgrad_error linear_forward_sparse(struct linear *const layer, const struct sparse_tensor *const x, struct tensor **const out, const bool track_grad);
 cgrad_error linear_xavier_init(struct linear *const layer);
 void linear_cleanup(struct linear *const layer);
 
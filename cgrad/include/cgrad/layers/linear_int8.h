@@ -0,0 +1,64 @@
+#ifndef LINEAR_INT8_H
+#define LINEAR_INT8_H
+
+#include "cgrad/layers/linear.h"
+#include "cgrad/quantization/quantize.h"
+#include "cgrad/quantization/qgemm.h"
+#include "cgrad/cgrad_env.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct linear_int8
+ * @brief Inference-only linear layer with DTYPE_INT8 weights, obtained by post-training quantization of a linear layer.
+ */
+struct linear_int8
+{
+    struct qgemm_weights weight;
+    float *bias;
+    struct quant_params input_params;    /**< Quantization parameters of the input, from calibration. */
+    struct quant_params output_params;   /**< Quantization parameters of the output, if requantize_output is set. */
+    bool fuse_relu;
+    bool requantize_output;
+    size_t in_dim;
+    size_t out_dim;
+    struct cgrad_env *env;
+};
+
+/**
+ * @brief Quantizes a trained linear layer. The original layer is not modified and can be released.
+ *
+ * @param qlayer The quantized layer.
+ * @param layer The float layer.
+ * @param input_params Quantization parameters of the layer input, usually computed by a quant_observer.
+ * @param granularity Granularity of the weight scales.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error linear_int8_init(struct linear_int8 *const qlayer, const struct linear *const layer, const struct quant_params *const input_params, const quant_granularity granularity);
+
+/**
+ * @brief Fuses a ReLU and, if output_params is not NULL, the requantization of the output into the layer.
+ *
+ * A requantized output is a DTYPE_UINT8 tensor which can be fed directly to the next quantized layer, provided
+ * that its input parameters are output_params.
+ *
+ * @param qlayer The quantized layer.
+ * @param relu Whether a ReLU is applied to the output.
+ * @param output_params Quantization parameters of the output, or NULL for a DTYPE_FLOAT32 output.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error linear_int8_set_output(struct linear_int8 *const qlayer, const bool relu, const struct quant_params *const output_params);
+
+/**
+ * @brief Computes the layer output, without gradient tracking.
+ *
+ * @param qlayer The quantized layer.
+ * @param x The input of shape {batch_size, in_dim}, either DTYPE_UINT8 already quantized with the layer input parameters,
+ *          or DTYPE_FLOAT32/DTYPE_FLOAT64, which is quantized first.
+ * @param out Pointer to the output tensor pointer, of shape {batch_size, out_dim}.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error linear_int8_forward(struct linear_int8 *const qlayer, const struct tensor *const x, struct tensor **const out);
+void linear_int8_cleanup(struct linear_int8 *const qlayer);
+
+#endif
@@ -10,6 +10,8 @@ typedef struct tensor *(*alloc_fn)(void*, const size_t *const, const size_t, con
 typedef struct tensor *(*from_array_alloc_fn)(void*, const void*, const size_t *const, const size_t, const cgrad_dtype);
 typedef void (*free_fn)(void*, struct tensor*);
 typedef struct tensor *(*clone_fn)(void*, const struct tensor *const);
+typedef void *(*data_alloc_fn)(void*, const size_t);
+typedef void (*data_free_fn)(void*, void*);
 
 struct tensor_allocator
 {
@@ -20,6 +22,8 @@ struct tensor_allocator
     free_fn free;
     free_fn no_grad_free;
     clone_fn clone;
+    data_alloc_fn data_alloc;
+    data_free_fn data_free;
     void *pool;
 };
 
@@ -30,6 +34,9 @@ static inline struct tensor *tensor_allocator_from_array_alloc(struct tensor_all
 static inline void tensor_allocator_free(struct tensor_allocator *allocator, struct tensor *ptr);
 static inline void tensor_allocator_no_grad_free(struct tensor_allocator *allocator, struct tensor *ptr);
 static inline struct tensor* tensor_allocator_clone(struct tensor_allocator *allocator, struct tensor *src);
+static inline void *tensor_allocator_data_alloc(struct tensor_allocator *allocator, const size_t size);
+static inline void tensor_allocator_data_free(struct tensor_allocator *allocator, void *data);
+static inline cgrad_error tensor_allocator_alloc_grad(struct tensor_allocator *allocator, struct tensor *const t);
 
 static inline struct tensor *tensor_allocator_alloc(struct tensor_allocator *allocator, const size_t *shape, const size_t shape_size, const cgrad_dtype dtype)
 {
@@ -66,4 +73,54 @@ static inline struct tensor* tensor_allocator_clone(struct tensor_allocator *all
     return allocator->clone(allocator->pool, src);
 }
 
+/**
+ * @brief Allocates a raw data buffer of the given size in bytes, not bound to any tensor.
+ *
+ * Used to provide storage shared by several tensors, whose data pointer is set to the buffer.
+ */
+static inline void *tensor_allocator_data_alloc(struct tensor_allocator *allocator, const size_t size)
+{
+    return allocator->data_alloc(allocator->pool, size);
+}
+
+static inline void tensor_allocator_data_free(struct tensor_allocator *allocator, void *data)
+{
+    allocator->data_free(allocator->pool, data);
+}
+
+/**
+ * @brief Lazily allocates a zeroed gradient buffer for a tensor.
+ *
+ * Gradients are not allocated together with the tensor: only tensors which actually
+ * receive a gradient (during backpropagation) own one. Does nothing if the tensor
+ * already has a gradient.
+ *
+ * @param allocator The allocator used for the gradient buffer.
+ * @param t The tensor which needs a gradient.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+static inline cgrad_error tensor_allocator_alloc_grad(struct tensor_allocator *allocator, struct tensor *const t)
+{
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (t->grad)
+    {
+        return NO_ERROR;
+    }
+    if (t->dtype != DTYPE_FLOAT32 && t->dtype != DTYPE_FLOAT64)
+    {
+        return TENSOR_INVALID_DTYPE;
+    }
+
+    t->grad = tensor_allocator_no_grad_zero_alloc(allocator, t->shape, t->shape_size, t->dtype);
+    if (!t->grad)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef MODEL_CHECKPOINT_H
+#define MODEL_CHECKPOINT_H
+
+#include "cgrad/model/model_params.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/config.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+
+#define MODEL_CHECKPOINT_VERSION 1
+
+// Tensor data offsets in the file are multiples of the alignment, so mapped tensors are aligned for SIMD loads
+#define MODEL_CHECKPOINT_ALIGNMENT 64
+
+/**
+ * @struct model_checkpoint_mapping
+ * @brief A checkpoint file mapped in memory, whose pages back the data of the model parameters.
+ */
+struct model_checkpoint_mapping
+{
+    void *addr;                               /**< Start of the mapped file. */
+    size_t size;                              /**< Size of the mapped file in bytes. */
+    struct model_params *params;              /**< Parameters pointing into the mapping. */
+    void *params_data[MODEL_MAX_PARAMS];      /**< Data of the parameters before mapping, restored by model_checkpoint_unmap. */
+};
+
+/**
+ * @brief Saves the parameters, and optionally the optimizer state, to a binary checkpoint.
+ *
+ * The file starts with a header and a table holding the kind, dtype, shape, offset and size of each tensor,
+ * followed by the raw tensor data at offsets aligned to MODEL_CHECKPOINT_ALIGNMENT. The file is written next
+ * to path and renamed once complete, so an interrupted save never leaves a truncated checkpoint behind.
+ *
+ * @param params The parameters to save.
+ * @param opt The optimizer whose momentum and master weights are saved, may be NULL.
+ * @param path Path of the checkpoint.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error model_checkpoint_save(const struct model_params *const params, const struct sgd_optimizer *const opt, const char *const path);
+
+/**
+ * @brief Size in bytes of the checkpoint of the parameters and optimizer state, see model_checkpoint_image.
+ */
+size_t model_checkpoint_image_size(const struct model_params *const params, const struct sgd_optimizer *const opt);
+
+/**
+ * @brief Writes in memory the exact content model_checkpoint_save would write to a file.
+ *
+ * @param params The parameters to save.
+ * @param opt The optimizer whose momentum and master weights are saved, may be NULL.
+ * @param image The destination, of at least model_checkpoint_image_size bytes.
+ * @param size The size of image in bytes.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error model_checkpoint_image(const struct model_params *const params, const struct sgd_optimizer *const opt, void *const image, const size_t size);
+
+/**
+ * @brief Copies the tensors of a checkpoint into the parameters, and optionally into the optimizer state.
+ *
+ * Parameters are matched by position and must have the dtype and shape they were saved with. The optimizer
+ * state is left untouched if the checkpoint does not contain it.
+ *
+ * @param params The parameters to fill.
+ * @param opt The optimizer to restore, may be NULL.
+ * @param path Path of the checkpoint.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error model_checkpoint_load(struct model_params *const params, struct sgd_optimizer *const opt, const char *const path);
+
+/**
+ * @brief Maps a checkpoint read-only and points the data of the parameters at the mapped pages, without copies.
+ *
+ * Intended for inference: the parameters must not be written, e.g. by an optimizer step, until
+ * model_checkpoint_unmap restores their own buffers. Pages are read from the file on first access.
+ *
+ * @param mapping The mapping, to be released with model_checkpoint_unmap.
+ * @param params The parameters to point at the checkpoint.
+ * @param path Path of the checkpoint.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error model_checkpoint_map(struct model_checkpoint_mapping *const mapping, struct model_params *const params, const char *const path);
+void model_checkpoint_unmap(struct model_checkpoint_mapping *const mapping);
+
+#endif
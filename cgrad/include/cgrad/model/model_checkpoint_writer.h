@@ -0,0 +1,94 @@
+#ifndef MODEL_CHECKPOINT_WRITER_H
+#define MODEL_CHECKPOINT_WRITER_H
+
+#include "cgrad/model/model_checkpoint.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+// Snapshots which can be held at once, one being written while the next is queued
+#define MODEL_CHECKPOINT_WRITER_N_SNAPSHOTS 2
+
+typedef enum
+{
+    MODEL_CHECKPOINT_SNAPSHOT_FREE,
+    MODEL_CHECKPOINT_SNAPSHOT_FILLING,
+    MODEL_CHECKPOINT_SNAPSHOT_PENDING,
+    MODEL_CHECKPOINT_SNAPSHOT_WRITING,
+} model_checkpoint_snapshot_state;
+
+/**
+ * @brief A checkpoint copied in memory, in the format of model_checkpoint_save, waiting to be written.
+ */
+struct model_checkpoint_snapshot
+{
+    void *image;
+    size_t size;
+    size_t capacity;                  /**< Allocated bytes of image, kept across snapshots. */
+    char *path;
+    size_t seq;                       /**< Snapshots are written in the order they were taken. */
+    model_checkpoint_snapshot_state state;
+};
+
+/**
+ * @struct model_checkpoint_writer
+ * @brief Saves checkpoints from a background thread, the training thread only copying the tensors.
+ *
+ * Each snapshot is written next to its path, flushed with fsync and renamed, as in model_checkpoint_save, then
+ * the directory is flushed too. Only the keep_last most recent paths are kept, older ones being removed once a
+ * newer checkpoint is complete. Files written by previous runs are left untouched.
+ */
+struct model_checkpoint_writer
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;              /**< Signals a snapshot queued, written, or the writer stopping. */
+    struct model_checkpoint_snapshot snapshots[MODEL_CHECKPOINT_WRITER_N_SNAPSHOTS];
+    size_t next_seq;
+    bool stopping;
+    char **kept;                      /**< Paths of the last written checkpoints, oldest first. */
+    size_t n_kept;
+    size_t keep_last;
+    size_t n_saved;                   /**< Checkpoints written successfully. */
+    cgrad_error error;                /**< First error of the background thread since the last wait, NO_ERROR otherwise. */
+    double blocked_seconds;           /**< Total time the callers of model_checkpoint_writer_save were blocked. */
+    double last_blocked_seconds;      /**< Time the last call to model_checkpoint_writer_save was blocked. */
+};
+
+/**
+ * @brief Initializes a writer and starts its thread.
+ *
+ * @param writer The writer, which must not be moved once initialized.
+ * @param keep_last Number of checkpoints kept on disk, 0 to keep all of them.
+ * @return NO_ERROR if successful, MODEL_CHECKPOINT_WRITER_INIT_FAILED if the thread cannot be started.
+ */
+cgrad_error model_checkpoint_writer_init(struct model_checkpoint_writer *const writer, const size_t keep_last);
+
+/**
+ * @brief Copies the parameters, and optionally the optimizer state, then returns while they are written to path.
+ *
+ * The parameters may be updated as soon as the call returns. The call only waits for the background thread if
+ * both snapshots are in use, i.e. if checkpoints are taken faster than they are written.
+ *
+ * @param writer The writer.
+ * @param params The parameters to save.
+ * @param opt The optimizer whose momentum and master weights are saved, may be NULL.
+ * @param path Path of the checkpoint.
+ * @return NO_ERROR if the snapshot was taken, otherwise an appropriate error code. Errors of the write itself are
+ * returned by model_checkpoint_writer_wait.
+ */
+cgrad_error model_checkpoint_writer_save(struct model_checkpoint_writer *const writer, const struct model_params *const params, const struct sgd_optimizer *const opt, const char *const path);
+
+/**
+ * @brief Waits until every snapshot taken has been written.
+ *
+ * @return The first error of the background thread since the previous wait, NO_ERROR if every checkpoint was
+ * written. The error is cleared once returned.
+ */
+cgrad_error model_checkpoint_writer_wait(struct model_checkpoint_writer *const writer);
+
+/**
+ * @brief Writes the pending snapshots, stops the thread and releases the writer.
+ */
+void model_checkpoint_writer_cleanup(struct model_checkpoint_writer *const writer);
+
+#endif
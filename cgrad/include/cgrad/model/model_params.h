@@ -3,6 +3,7 @@
 
 #include "cgrad/tensor/tensor.h"
 #include "cgrad/config.h"
+#include "cgrad/parallel/thread_pool.h"
 #include <string.h>
 
 struct model_params
@@ -13,15 +14,25 @@ struct model_params
 
 void model_params_init(struct model_params *const params);
 cgrad_error model_params_add(struct model_params *const params, struct tensor *const t);
-static inline void model_params_zero_grad(struct model_params *const params);
 
-static inline void model_params_zero_grad(struct model_params *const params)
-{
-    for (size_t i = 0; i < params->size; i++)
-    {
-        struct tensor *grad = params->params[i]->grad;
-        memset(grad->data, 0, grad->data_size * sizeof(double));
-    }
-}
+/**
+ * @brief Stores the gradient of each parameter in grads, NULL for parameters not reached by any backward pass yet.
+ */
+void model_params_grads(const struct model_params *const params, struct tensor **const grads);
+
+/**
+ * @brief Zeroes the gradients of the parameters with a single tensor_foreach_zero pass.
+ *
+ * Row-sparse gradients are zeroed on their rows, which they keep, see sgd_optimizer_zero_grad to release them.
+ */
+void model_params_zero_grad(struct model_params *const params);
+
+/**
+ * @brief Scales the gradients of the parameters so that their global L2 norm is at most max_norm.
+ *
+ * The norm before clipping is stored in total_norm, which may be NULL. Gradients scaled by a loss scaler must be
+ * clipped against max_norm times the scale.
+ */
+cgrad_error model_params_clip_grad_norm(struct model_params *const params, const double max_norm, double *const total_norm, struct thread_pool *const pool);
 
-#endif
\ No newline at end of file
+#endif
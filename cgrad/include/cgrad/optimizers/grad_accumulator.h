@@ -0,0 +1,60 @@
+#ifndef GRAD_ACCUMULATOR_H
+#define GRAD_ACCUMULATOR_H
+
+#include "cgrad/optimizers/loss_scaler.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/cgrad_env.h"
+#include <stdbool.h>
+
+/**
+ * @struct grad_accumulator
+ * @brief Accumulates the gradients of several micro-batches before each optimizer step.
+ *
+ * The loss of each micro-batch is backpropagated with seed 1 / n_micro_batches, times the loss scale if any, so
+ * the gradients are averaged as they are accumulated into the same buffers, with no pass of their own. The
+ * intermediates of the env are released after each backward, so memory scales with the micro-batch size.
+ */
+struct grad_accumulator
+{
+    struct sgd_optimizer *opt;
+    struct loss_scaler *scaler;       /**< Scales the loss of each micro-batch, NULL if not used. */
+    size_t n_micro_batches;           /**< Micro-batches accumulated per optimizer step. */
+    size_t n_accumulated;             /**< Micro-batches accumulated since the last step. */
+};
+
+/**
+ * @brief Initializes an accumulator stepping opt every n_micro_batches micro-batches.
+ *
+ * @param acc Pointer to the accumulator.
+ * @param opt The optimizer, which must not be fused into backward.
+ * @param scaler The loss scaler, or NULL.
+ * @param n_micro_batches Number of micro-batches per step, at least 1.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error grad_accumulator_init(struct grad_accumulator *const acc, struct sgd_optimizer *const opt, struct loss_scaler *const scaler, const size_t n_micro_batches);
+
+/**
+ * @brief Backpropagates the loss of a micro-batch, then frees the intermediates of env.
+ *
+ * The gradients are zeroed before the first micro-batch of each step, and the optimizer steps after the last one.
+ * Tensors computed by the forward pass must be in the intermediates list of env, or freed by the caller.
+ *
+ * @param acc Pointer to the accumulator.
+ * @param loss The loss of the micro-batch, averaged over its samples.
+ * @param env The environment.
+ * @param stepped Set to whether the parameters were updated, may be NULL.
+ * @return NO_ERROR if successful, GRAD_ACCUMULATOR_FUSED_BACKWARD if env has a gradient hook, otherwise an
+ * appropriate error code.
+ */
+cgrad_error grad_accumulator_backward(struct grad_accumulator *const acc, struct tensor *const loss, struct cgrad_env *const env, bool *const stepped);
+
+/**
+ * @brief Steps on the micro-batches accumulated so far, e.g. at the end of an epoch, averaging over them only.
+ *
+ * @param acc Pointer to the accumulator.
+ * @param stepped Set to whether the parameters were updated, may be NULL.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error grad_accumulator_flush(struct grad_accumulator *const acc, bool *const stepped);
+
+#endif
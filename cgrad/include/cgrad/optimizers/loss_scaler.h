@@ -0,0 +1,56 @@
+#ifndef LOSS_SCALER_H
+#define LOSS_SCALER_H
+
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/cgrad_env.h"
+#include <stdbool.h>
+
+/**
+ * @struct loss_scaler
+ * @brief Dynamic loss scaling for DTYPE_FLOAT16 training.
+ *
+ * The loss is scaled before backpropagation, so that small gradients do not underflow the float16 range,
+ * and gradients are unscaled by the optimizer. Steps whose gradients overflow are skipped and the scale is
+ * reduced, while the scale grows back after growth_interval consecutive good steps.
+ */
+struct loss_scaler
+{
+    double scale;            /**< Current loss scale. */
+    double growth_factor;    /**< Scale multiplier after growth_interval good steps. */
+    double backoff_factor;   /**< Scale multiplier after an overflow. */
+    size_t growth_interval;  /**< Number of consecutive good steps before growing the scale. */
+    size_t n_good_steps;     /**< Consecutive steps without overflow. */
+    size_t n_skipped_steps;  /**< Total number of steps skipped due to an overflow. */
+};
+
+/**
+ * @brief Initializes a loss scaler with growth factor 2, backoff factor 0.5 and growth interval 2000.
+ *
+ * @param scaler Pointer to the loss scaler.
+ * @param init_scale Initial loss scale, e.g. 65536.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error loss_scaler_init(struct loss_scaler *const scaler, const double init_scale);
+
+/**
+ * @brief Backpropagates the loss multiplied by the current scale.
+ *
+ * @param scaler Pointer to the loss scaler.
+ * @param loss The loss tensor.
+ * @param env The environment.
+ * @return NO_ERROR if successful, LOSS_SCALER_FUSED_BACKWARD if a fused optimizer would update the parameters
+ * before the overflow check and the unscaling of loss_scaler_step, otherwise an appropriate error code.
+ */
+cgrad_error loss_scaler_backward(const struct loss_scaler *const scaler, struct tensor *const loss, struct cgrad_env *const env);
+
+/**
+ * @brief Performs an optimizer step on the unscaled gradients, unless some of them are not finite.
+ *
+ * @param scaler Pointer to the loss scaler.
+ * @param opt The optimizer, whose parameters received the scaled gradients.
+ * @param stepped Set to whether the step was performed, may be NULL.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error loss_scaler_step(struct loss_scaler *const scaler, struct sgd_optimizer *const opt, bool *const stepped);
+
+#endif
@@ -4,21 +4,51 @@
 #include "cgrad/autograd/backpropagation/backpropagation.h"
 #include "cgrad/model/model_params.h"
 #include "cgrad/cgrad_env.h"
+#include "cgrad/tensor/tensor_foreach.h"
+#include "cgrad/tensor/tensor_sparse_grad.h"
 
+/**
+ * @struct sgd_optimizer
+ * @brief Stochastic gradient descent with momentum.
+ *
+ * Parameters with DTYPE_BFLOAT16 or DTYPE_FLOAT16 storage are updated through a float32 master copy, which
+ * is rounded into the parameter after each step, so that small updates are not lost to rounding.
+ *
+ * Parameters with a row-sparse gradient, e.g. embedding weights, are updated on the rows of their gradient only:
+ * the momentum of the other rows is left as is instead of decaying, as in lazy sparse updates.
+ */
 struct sgd_optimizer
 {
     size_t size;
     struct model_params *params;
     struct tensor *prev_b_t[MODEL_MAX_PARAMS];
+    struct tensor *master[MODEL_MAX_PARAMS];   /**< Float32 master weights of half precision parameters, NULL otherwise. */
     struct tensor_allocator *tensor_alloc;
+    struct cgrad_env *env;                     /**< Its thread pool runs the updates. */
     double lr;
     double momemtum;
     bool nesterov;
+    double grad_scale;                         /**< Gradients are multiplied by grad_scale before the update, 1 by default. */
 };
 
 cgrad_error sgd_optimizer_init(struct sgd_optimizer *opt, struct model_params *const params, const double lr, const double momentum, const bool nesterov, struct cgrad_env *env);
 void sgd_optimizer_cleanup(struct sgd_optimizer *opt);
+
+/**
+ * @brief Updates every parameter which received a gradient, in a single tensor_foreach_sgd pass.
+ */
 cgrad_error sgd_optimizer_step(struct sgd_optimizer *opt);
+
+/**
+ * @brief Updates each parameter during backward, as soon as its gradient is final, then releases the gradient.
+ *
+ * Parameters are updated while their gradient is still in cache and no gradient outlives its update, so
+ * sgd_optimizer_zero_grad and sgd_optimizer_step are not called. Gradients can therefore be neither accumulated
+ * over several backward calls nor inspected before the update, e.g. by a loss scaler, so loss_scaler_backward and
+ * execution_plan_capture reject an environment with a fused optimizer. Undone with
+ * backward_set_gradient_hook(env, NULL, NULL).
+ */
+cgrad_error sgd_optimizer_fuse_backward(struct sgd_optimizer *opt, struct cgrad_env *env);
 static inline void sgd_optimizer_zero_grad(struct sgd_optimizer *opt);
 
 static inline void sgd_optimizer_zero_grad(struct sgd_optimizer *opt)
@@ -28,7 +58,15 @@ static inline void sgd_optimizer_zero_grad(struct sgd_optimizer *opt)
         return;
     }
 
-    model_params_zero_grad(opt->params);
+    // Row-sparse gradients are released, so that the next ones hold the rows of the next batches only
+    for (size_t i = 0; i < opt->params->size; i++)
+    {
+        tensor_sparse_grad_clear(opt->params->params[i], opt->tensor_alloc);
+    }
+
+    struct tensor *grads[MODEL_MAX_PARAMS];
+    model_params_grads(opt->params, grads);
+    tensor_foreach_zero(grads, opt->params->size, opt->env->pool);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef ALLREDUCE_H
+#define ALLREDUCE_H
+
+#include "cgrad/model/model_params.h"
+#include "cgrad/dtypes.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+
+typedef cgrad_error (*allreduce_sum_fn)(void *, void *, const size_t, const cgrad_dtype);
+typedef cgrad_error (*allreduce_barrier_fn)(void *);
+typedef void (*allreduce_cleanup_fn)(void *);
+
+/**
+ * @struct allreduce_backend
+ * @brief Transport summing buffers across the processes of a group.
+ *
+ * Every process of the group calls the same collectives in the same order. Backends return bitwise identical
+ * results to all processes, so that replicas updated with them stay synchronized.
+ */
+struct allreduce_backend
+{
+    allreduce_sum_fn sum;             /**< Replaces a buffer of every process with the sum of the buffers. */
+    allreduce_barrier_fn barrier;
+    allreduce_cleanup_fn cleanup;
+    void *ctx;
+    size_t rank;
+    size_t world_size;
+    void *flat_grads;                 /**< Buffer of allreduce_grads, grown as needed. */
+    size_t flat_grads_capacity;       /**< Size in bytes of flat_grads. */
+};
+
+static inline cgrad_error allreduce_sum(struct allreduce_backend *const backend, void *const data, const size_t n, const cgrad_dtype dtype);
+static inline cgrad_error allreduce_barrier(struct allreduce_backend *const backend);
+
+/**
+ * @brief Releases the backend and its connection to the group.
+ */
+void allreduce_cleanup(struct allreduce_backend *const backend);
+
+/**
+ * @brief Replaces the gradients of params with their weighted sum across the group.
+ *
+ * The gradients are packed into one flat buffer, scaled by weight and summed in a single collective.
+ * With a weight equal to the share of the global batch processed by the process, e.g. 1 / world_size for
+ * equal shards, the result is the gradient of the mean loss of the global batch.
+ *
+ * @param backend The backend.
+ * @param params Parameters with gradients, of the same dtype, either DTYPE_FLOAT32 or DTYPE_FLOAT64.
+ * @param weight Factor applied to the local gradients.
+ * @return NO_ERROR if successful, TENSOR_GRAD_SPARSE if a gradient is row-sparse, as its rows differ across
+ * processes, otherwise an appropriate error code.
+ */
+cgrad_error allreduce_grads(struct allreduce_backend *const backend, struct model_params *const params, const double weight);
+
+static inline cgrad_error allreduce_sum(struct allreduce_backend *const backend, void *const data, const size_t n, const cgrad_dtype dtype)
+{
+    if (!backend)
+    {
+        return ALLREDUCE_BACKEND_NULL;
+    }
+
+    return backend->sum(backend->ctx, data, n, dtype);
+}
+
+static inline cgrad_error allreduce_barrier(struct allreduce_backend *const backend)
+{
+    if (!backend)
+    {
+        return ALLREDUCE_BACKEND_NULL;
+    }
+
+    return backend->barrier(backend->ctx);
+}
+
+#endif
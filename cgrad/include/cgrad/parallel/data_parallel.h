@@ -0,0 +1,128 @@
+#ifndef DATA_PARALLEL_H
+#define DATA_PARALLEL_H
+
+#include "cgrad/model/model_params.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/cgrad_env.h"
+#include "cgrad/error.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Number of gradient elements each worker reduces at a time, small enough to stay in L1 while summing the replicas
+#define DATA_PARALLEL_REDUCE_BLOCK_SIZE 1024
+
+// Alignment in elements of the boundaries between the gradient slices of the workers, to limit false sharing
+#define DATA_PARALLEL_REDUCE_ALIGNMENT 16
+
+/**
+ * @struct data_parallel_model
+ * @brief Describes how the trainer builds and runs the replicas of a model.
+ */
+struct data_parallel_model
+{
+    size_t replica_size;       /**< Size in bytes of a replica, e.g. sizeof(struct mlp). */
+
+    /**
+     * Builds a replica allocating from env and adds its parameters to params, in the same order, shape and dtype
+     * as the parameters of the trained model. Their values do not matter, they are copied before each step.
+     */
+    cgrad_error (*replica_init)(void *replica, struct model_params *const params, struct cgrad_env *const env);
+    void (*replica_cleanup)(void *replica);
+
+    /**
+     * Computes the mean loss of a shard, tracking gradients. Tensors allocated by the call other than the loss
+     * must be registered as intermediates of env, they are freed after the backward pass.
+     */
+    cgrad_error (*loss)(void *replica, struct tensor *const x, struct tensor *const y, struct tensor **const loss, struct cgrad_env *const env);
+};
+
+struct data_parallel_trainer;
+
+/**
+ * @struct data_parallel_worker
+ * @brief A thread owning a replica of the model and its execution context.
+ */
+struct data_parallel_worker
+{
+    struct data_parallel_trainer *trainer;
+    pthread_t thread;
+    struct cgrad_env env;
+    void *replica;
+    struct model_params params;
+    size_t shard_begin;        /**< First row of the batch processed by the worker. */
+    size_t shard_size;
+    size_t reduce_begin;       /**< Range of the flattened gradients reduced by the worker. */
+    size_t reduce_end;
+    double loss;
+    cgrad_error err;
+};
+
+/**
+ * @struct data_parallel_trainer
+ * @brief Synchronous data parallel training over worker threads.
+ *
+ * Each step shards the batch along its first dimension, every worker computes the gradients of its shard on
+ * its replica, then the gradients are summed into the gradients of the trained parameters, weighted by the
+ * shard sizes. The result is the gradient of the mean loss of the whole batch, up to rounding, so the
+ * optimizer of the trained parameters is stepped as in single threaded training.
+ *
+ * The reduction is a reduce-scatter over shared memory: the flattened gradients are split into one slice
+ * per worker, and each worker sums all the replicas over its slice, block by block.
+ */
+struct data_parallel_trainer
+{
+    struct data_parallel_model model;
+    struct model_params *params;
+    size_t n_workers;
+    struct data_parallel_worker *workers;
+    unsigned char *replicas;
+    size_t param_offsets[MODEL_MAX_PARAMS + 1]; /**< Offsets of the parameters in the flattened gradients. */
+
+    pthread_mutex_t start_mutex;
+    pthread_barrier_t step_start;
+    pthread_barrier_t backward_done;
+    pthread_barrier_t step_done;
+    bool running;
+
+    struct tensor *x;          /**< Batch of the running step. */
+    struct tensor *y;
+    size_t batch_size;
+};
+
+/**
+ * @brief Initializes a trainer and starts its worker threads.
+ *
+ * Each worker gets an execution context with its own random stream derived from env, in which its replica
+ * is built. The gradients of params are allocated if missing.
+ *
+ * @param trainer The trainer, to be stopped with data_parallel_cleanup.
+ * @param model The description of the model.
+ * @param params The trained parameters, with DTYPE_FLOAT32 or DTYPE_FLOAT64 dtype.
+ * @param n_workers Number of worker threads.
+ * @param intermediates_capacity Initial capacity of the intermediates list of each worker context.
+ * @param env Environment of the trained parameters.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error data_parallel_init(struct data_parallel_trainer *const trainer, const struct data_parallel_model *const model, struct model_params *const params, const size_t n_workers, const size_t intermediates_capacity, struct cgrad_env *const env);
+
+/**
+ * @brief Stops the workers and releases the replicas and their contexts.
+ */
+void data_parallel_cleanup(struct data_parallel_trainer *const trainer);
+
+/**
+ * @brief Runs forward and backward passes of a batch on the workers, and accumulates the gradients into params.
+ *
+ * Like backward, gradients are added to the current ones, which are zeroed by the caller. Row-sparse gradients of
+ * the replicas, e.g. of an embedding, are scattered to their rows of the dense gradients of params.
+ *
+ * @param trainer The trainer.
+ * @param x Inputs of the batch, sharded along the first dimension.
+ * @param y Targets of the batch, with the same first dimension as x.
+ * @param loss If not NULL, receives the mean loss of the batch.
+ * @return NO_ERROR if successful, otherwise the first error of the workers.
+ */
+cgrad_error data_parallel_step(struct data_parallel_trainer *const trainer, struct tensor *const x, struct tensor *const y, double *const loss);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef PROCESS_GROUP_H
+#define PROCESS_GROUP_H
+
+#include "cgrad/error.h"
+#include <stddef.h>
+
+/**
+ * @brief Function run by each process of a group.
+ *
+ * It runs in a forked copy of the caller, so it inherits e.g. a dataset loaded before the launch, but its
+ * allocations and environment are its own.
+ */
+typedef cgrad_error (*process_group_worker_fn)(const size_t rank, const size_t world_size, void *arg);
+
+/**
+ * @brief Forks world_size processes running worker with ranks 0 to world_size - 1, and waits for them.
+ *
+ * If a process fails, the others are killed, since they would wait forever for it in the next collective.
+ *
+ * @param world_size Number of processes.
+ * @param worker Function run by each process.
+ * @param arg Argument passed to worker.
+ * @return NO_ERROR if every process succeeded, PROCESS_GROUP_WORKER_FAILED if one failed or crashed,
+ * PROCESS_GROUP_LAUNCH_FAILED if the processes could not be started.
+ */
+cgrad_error process_group_launch(const size_t world_size, process_group_worker_fn worker, void *arg);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SHM_ALLREDUCE_H
+#define SHM_ALLREDUCE_H
+
+#include "cgrad/parallel/allreduce.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+
+// Alignment in bytes of the slots of the segment, and of the chunks reduced by each process
+#define SHM_ALLREDUCE_ALIGNMENT 64
+
+/**
+ * Allreduce over a POSIX shared memory segment, for the processes of a group running on one host.
+ *
+ * The segment holds one slot per process and a barrier built on a futex, so that waiting processes sleep
+ * in the kernel. A sum copies the buffer of each process into its slot, then each process reduces one chunk
+ * of all the slots into its own, and finally gathers the reduced chunks of the others. Buffers larger than a
+ * slot are summed in pieces.
+ */
+
+/**
+ * @brief Creates and initializes the segment of a group, before its processes are started.
+ *
+ * @param name Name of the segment, starting with a slash, e.g. "/cgrad_job".
+ * @param world_size Number of processes of the group.
+ * @param slot_size Size in bytes of the slot of each process.
+ * @return NO_ERROR if successful, ALLREDUCE_INIT_FAILED if the segment exists or cannot be created.
+ */
+cgrad_error shm_allreduce_create(const char *const name, const size_t world_size, const size_t slot_size);
+
+/**
+ * @brief Removes the name of the segment, which is released once every process has cleaned up its backend.
+ */
+cgrad_error shm_allreduce_unlink(const char *const name);
+
+/**
+ * @brief Connects a process to the segment of its group.
+ *
+ * @param backend The backend, released with allreduce_cleanup.
+ * @param name Name of the segment.
+ * @param rank Rank of the process in the group.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error shm_allreduce_init(struct allreduce_backend *const backend, const char *const name, const size_t rank);
+
+#endif
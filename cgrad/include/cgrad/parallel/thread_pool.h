@@ -0,0 +1,90 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "cgrad/error.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Minimum amount of work, in elementary operations, worth handing to another thread
+#define THREAD_POOL_MIN_TASK_WORK 32768
+
+// Environment variable overriding the default number of threads
+#define THREAD_POOL_NUM_THREADS_ENV "CGRAD_NUM_THREADS"
+
+/**
+ * @brief Body of a parallel loop, processing the items in [begin, end).
+ */
+typedef void (*thread_pool_fn)(void *arg, const size_t begin, const size_t end);
+
+struct thread_pool_worker
+{
+    pthread_t thread;
+    struct thread_pool *pool;
+    size_t index;                     /**< Index of the range run by the worker, the caller runs range 0. */
+};
+
+/**
+ * @struct thread_pool
+ * @brief Fork-join pool running the loops of the kernels over rows or batch elements.
+ *
+ * The calling thread takes part in every loop, so a pool of n threads starts n - 1 workers. Idle workers
+ * sleep on a condition variable, leaving the cores to e.g. the BLAS threads between loops. The pool must not
+ * be moved once initialized, since its workers point to it.
+ */
+struct thread_pool
+{
+    size_t n_threads;
+    struct thread_pool_worker *workers;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    size_t generation;                /**< Incremented for every loop, wakes the workers. */
+    size_t pending;                   /**< Workers still running the current loop. */
+    bool busy;
+    bool stopping;
+    thread_pool_fn fn;
+    void *arg;
+    size_t n;
+    size_t n_tasks;
+    size_t task_size;
+};
+
+/**
+ * @brief Initializes a pool of n_threads threads, the caller included.
+ *
+ * @return NO_ERROR if successful, THREAD_POOL_INIT_FAILED if the workers cannot be started.
+ */
+cgrad_error thread_pool_init(struct thread_pool *const pool, const size_t n_threads);
+
+/**
+ * @brief Stops the workers and releases the pool.
+ */
+void thread_pool_cleanup(struct thread_pool *const pool);
+
+/**
+ * @brief Calls fn over [0, n), split in at most one contiguous range per thread of at least grain items.
+ *
+ * Runs fn(arg, 0, n) on the caller if pool is NULL, if n is too small to split, or if the pool is already
+ * running a loop, e.g. when called from within fn. Returns once every range has been processed.
+ */
+void thread_pool_parallel_for(struct thread_pool *const pool, const size_t n, const size_t grain, thread_pool_fn fn, void *arg);
+
+/**
+ * @brief Number of threads used by default: the value of CGRAD_NUM_THREADS if set, otherwise the number
+ * of online processors.
+ *
+ * When BLAS is multi-threaded too, e.g. through OPENBLAS_NUM_THREADS, the two pools never run at the same
+ * time, since BLAS is only called between loops.
+ */
+size_t thread_pool_default_size(void);
+
+/**
+ * @brief Minimum number of items per range for items costing work_per_item operations each.
+ */
+static inline size_t thread_pool_grain(const size_t work_per_item)
+{
+    return work_per_item >= THREAD_POOL_MIN_TASK_WORK ? 1 : THREAD_POOL_MIN_TASK_WORK / (work_per_item ? work_per_item : 1);
+}
+
+#endif
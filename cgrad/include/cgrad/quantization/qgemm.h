@@ -0,0 +1,78 @@
+#ifndef QGEMM_H
+#define QGEMM_H
+
+#include "cgrad/quantization/quantize.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/cgrad_env.h"
+#include "cgrad/error.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// The reduction dimension is padded to whole 256 bit vectors
+#define QGEMM_K_ALIGNMENT 32
+
+/**
+ * @struct qgemm_weights
+ * @brief Weights quantized to DTYPE_INT8, stored with one row per output channel.
+ */
+struct qgemm_weights
+{
+    struct tensor *data;     /**< DTYPE_INT8 tensor of shape {n, k_padded}, rows are zero padded. */
+    float *scales;           /**< Scale of each output channel, all equal with QUANT_PER_TENSOR. */
+    int32_t *row_sums;       /**< Sum of the quantized weights of each output channel, removes the input zero point. */
+    size_t n;                /**< Number of output channels. */
+    size_t k;                /**< Reduction dimension. */
+    size_t k_padded;         /**< Reduction dimension rounded up to a multiple of QGEMM_K_ALIGNMENT. */
+};
+
+/**
+ * @struct qgemm_epilogue
+ * @brief Operations fused into the conversion of the int32 accumulators.
+ */
+struct qgemm_epilogue
+{
+    struct quant_params input_params;        /**< Quantization parameters of the uint8 input. */
+    const float *bias;                       /**< Bias of each output channel, may be NULL. */
+    bool relu;                               /**< Whether a ReLU is applied after the bias. */
+    bool requantize;                         /**< Whether the output is requantized to DTYPE_UINT8 instead of DTYPE_FLOAT32. */
+    struct quant_params output_params;       /**< Quantization parameters of the output, used if requantize is set. */
+};
+
+/**
+ * @brief Quantizes the weights of a layer with symmetric scales.
+ *
+ * The element (j, p), with j the output channel and p the reduction index, is read from
+ * weight->data[j * n_stride + p * k_stride], so that both {k, n} and {n, k} layouts can be packed.
+ *
+ * @param w The packed weights, to be released with qgemm_weights_cleanup.
+ * @param weight A DTYPE_FLOAT32, DTYPE_FLOAT64, DTYPE_BFLOAT16 or DTYPE_FLOAT16 weight tensor.
+ * @param n Number of output channels.
+ * @param k Reduction dimension.
+ * @param n_stride Stride between output channels in weight.
+ * @param k_stride Stride between reduction indexes in weight.
+ * @param granularity Whether a scale is computed for the whole tensor or for each output channel.
+ * @param env The environment.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error qgemm_weights_pack(struct qgemm_weights *const w, const struct tensor *const weight, const size_t n, const size_t k, const size_t n_stride, const size_t k_stride, const quant_granularity granularity, struct cgrad_env *const env);
+void qgemm_weights_cleanup(struct qgemm_weights *const w, struct cgrad_env *const env);
+
+/**
+ * @brief Computes C = epilogue(A W^T) with A of shape {m, k} in DTYPE_UINT8 and W the packed int8 weights.
+ *
+ * Products are accumulated exactly in int32 with AVX2 maddubs, or with VNNI dpbusd when compiled with AVX-VNNI
+ * or AVX512-VNNI support. The element (i, j) of the result is stored at c[i * c_row_stride + j * c_col_stride],
+ * as a float if epilogue->requantize is false and as a uint8 otherwise.
+ *
+ * @param a Row-major uint8 input with rows of length w->k.
+ * @param m Number of rows of the input.
+ * @param w The packed weights.
+ * @param epilogue Dequantization, bias, ReLU and requantization of the accumulators.
+ * @param c The output.
+ * @param c_row_stride Stride between output rows, in elements.
+ * @param c_col_stride Stride between output columns, in elements.
+ * @return NO_ERROR if successful, TENSOR_ALLOCATION_FAILED if the input could not be padded.
+ */
+cgrad_error qgemm_u8s8(const uint8_t *const a, const size_t m, const struct qgemm_weights *const w, const struct qgemm_epilogue *const epilogue, void *const c, const size_t c_row_stride, const size_t c_col_stride);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef QUANT_OBSERVER_H
+#define QUANT_OBSERVER_H
+
+#include "cgrad/quantization/quantize.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+
+/**
+ * @struct quant_observer
+ * @brief Records the range of an activation over a sample of calibration batches.
+ */
+struct quant_observer
+{
+    double min;            /**< Smallest observed value. */
+    double max;            /**< Largest observed value. */
+    size_t n_observed;     /**< Number of observed tensors. */
+};
+
+void quant_observer_init(struct quant_observer *const observer);
+
+/**
+ * @brief Extends the observed range with the values of a tensor.
+ *
+ * @param observer Pointer to the observer.
+ * @param t A DTYPE_FLOAT32 or DTYPE_FLOAT64 tensor, typically the input of a layer computed on a calibration batch.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error quant_observer_update(struct quant_observer *const observer, const struct tensor *const t);
+
+/**
+ * @brief Computes activation quantization parameters covering the observed range.
+ *
+ * The range is extended to include 0, so that zero is exactly representable. Non-negative activations,
+ * e.g. after a ReLU, get a zero point of 0.
+ *
+ * @param observer Pointer to the observer.
+ * @param params Receives the quantization parameters.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ *         - QUANT_OBSERVER_EMPTY if no tensor was observed.
+ */
+cgrad_error quant_observer_compute_params(const struct quant_observer *const observer, struct quant_params *const params);
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/cgrad_env.h"
+#include "cgrad/error.h"
+#include <stdint.h>
+
+/**
+ * Activations are quantized to DTYPE_UINT8 with an affine mapping restricted to 7 bits, weights to DTYPE_INT8
+ * with a symmetric mapping. With these ranges the sum of two u8 * s8 products always fits in 16 bits, so the
+ * AVX2 maddubs instruction used by qgemm never saturates.
+ */
+#define QUANT_ACTIVATION_QMIN 0
+#define QUANT_ACTIVATION_QMAX 127
+#define QUANT_WEIGHT_QMAX 127
+
+/**
+ * @struct quant_params
+ * @brief Affine quantization parameters, real = scale * (q - zero_point).
+ */
+struct quant_params
+{
+    float scale;
+    int32_t zero_point;
+};
+
+/**
+ * @enum quant_granularity
+ * @brief Granularity of the weight scales.
+ */
+typedef enum quant_granularity
+{
+    QUANT_PER_TENSOR,   /**< A single scale for the whole weight tensor. */
+    QUANT_PER_CHANNEL,  /**< A scale for each output channel. */
+} quant_granularity;
+
+/**
+ * @brief Quantizes a DTYPE_FLOAT32 or DTYPE_FLOAT64 tensor into a new DTYPE_UINT8 tensor.
+ *
+ * @param t The tensor to quantize.
+ * @param params Quantization parameters, usually computed by a quant_observer.
+ * @param out Pointer to the output tensor pointer, allocated without gradient.
+ * @param env The environment.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error tensor_quantize(const struct tensor *const t, const struct quant_params *const params, struct tensor **const out, struct cgrad_env *const env);
+cgrad_error tensor_quantize_into(const struct tensor *const t, const struct quant_params *const params, struct tensor *const out);
+
+/**
+ * @brief Dequantizes a DTYPE_UINT8 tensor into a new DTYPE_FLOAT32 tensor.
+ *
+ * @param t The quantized tensor.
+ * @param params Quantization parameters of t.
+ * @param out Pointer to the output tensor pointer, allocated without gradient.
+ * @param env The environment.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error tensor_dequantize(const struct tensor *const t, const struct quant_params *const params, struct tensor **const out, struct cgrad_env *const env);
+
+/**
+ * @brief Quantizes n float32 values into the activation range.
+ */
+void quantize_f32_array(const float *const src, uint8_t *const dst, const size_t n, const struct quant_params *const params);
+
+static inline cgrad_error quant_params_check(const struct quant_params *const params)
+{
+    if (!params)
+    {
+        return QUANT_PARAMS_NULL;
+    }
+    if (!(params->scale > 0) || params->zero_point < QUANT_ACTIVATION_QMIN || params->zero_point > QUANT_ACTIVATION_QMAX)
+    {
+        return QUANT_INVALID_PARAMS;
+    }
+
+    return NO_ERROR;
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef INFERENCE_BATCHER_H
+#define INFERENCE_BATCHER_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/cgrad_env.h"
+#include "cgrad/dtypes.h"
+#include "cgrad/error.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of most recent request latencies kept to compute percentiles
+#define INFERENCE_BATCHER_LATENCY_WINDOW 4096
+
+/**
+ * @brief Batched forward pass run by the batcher.
+ *
+ * Called only from the dispatcher thread with an input of shape {batch_size, in_dim}, it must store an output
+ * of shape {batch_size, out_dim} in out, without tracking gradients. Other tensors allocated by the call must
+ * be freed by it or registered as intermediates of env.
+ */
+typedef cgrad_error (*inference_batcher_forward_fn)(void *model, struct tensor *const x, struct tensor **const out, struct cgrad_env *const env);
+
+/**
+ * @struct inference_batcher_config
+ * @brief Parameters of an inference batcher.
+ */
+struct inference_batcher_config
+{
+    size_t in_dim;             /**< Number of elements of each input row. */
+    size_t out_dim;            /**< Number of elements of each output row. */
+    cgrad_dtype dtype;         /**< Dtype of the input and output rows. */
+    size_t max_batch_size;     /**< Maximum number of requests run in one forward pass. */
+    uint64_t max_delay_us;     /**< Maximum time the oldest queued request waits for the batch to fill. */
+    size_t queue_capacity;     /**< Maximum number of queued requests, further submissions are rejected. */
+};
+
+/**
+ * @struct inference_future
+ * @brief A submitted request, completed by the dispatcher once its batch has run.
+ *
+ * The future, its input and its output must stay valid until inference_future_wait returns.
+ */
+struct inference_future
+{
+    const void *input;         /**< Input row of in_dim elements. */
+    void *output;              /**< Output row of out_dim elements, written by the dispatcher. */
+    cgrad_error err;           /**< Result of the forward pass of the batch. */
+    bool done;
+    uint64_t submit_time_ns;
+};
+
+/**
+ * @struct inference_batcher_stats
+ * @brief Snapshot of the state of a batcher.
+ */
+struct inference_batcher_stats
+{
+    size_t queue_depth;        /**< Requests waiting to be batched. */
+    size_t completed_requests;
+    size_t completed_batches;
+    double mean_batch_size;
+    double latency_p50_us;     /**< Percentiles of the time from submission to completion of recent requests. */
+    double latency_p90_us;
+    double latency_p99_us;
+};
+
+/**
+ * @struct inference_batcher
+ * @brief Gathers single-row requests from any thread into batches run by one dispatcher thread.
+ *
+ * A batch is run as soon as max_batch_size requests are queued, or when the oldest queued request has waited
+ * max_delay_us. The environment is only used by the dispatcher thread.
+ */
+struct inference_batcher
+{
+    struct inference_batcher_config config;
+    inference_batcher_forward_fn forward;
+    void *model;
+    struct cgrad_env *env;
+
+    pthread_t dispatcher;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;                  /**< Signaled when a request is queued or the batcher stops. */
+    pthread_cond_t completed;                  /**< Broadcast when a batch has completed. */
+    bool running;
+
+    struct inference_future **queue;           /**< Ring buffer of queue_capacity pending requests. */
+    size_t queue_head;
+    size_t queue_size;
+    struct inference_future **batch;           /**< Requests of the batch being run by the dispatcher. */
+
+    size_t *batch_size_histogram;              /**< Number of batches of each size, max_batch_size + 1 entries. */
+    size_t completed_requests;
+    double latencies_us[INFERENCE_BATCHER_LATENCY_WINDOW];
+    size_t latencies_size;
+    size_t latencies_next;
+};
+
+/**
+ * @brief Initializes a batcher and starts its dispatcher thread.
+ *
+ * @param batcher The batcher, to be stopped with inference_batcher_cleanup.
+ * @param config The parameters of the batcher.
+ * @param forward The batched forward pass.
+ * @param model Model passed to forward.
+ * @param env Environment used by the forward pass, reserved to the dispatcher until cleanup.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error inference_batcher_init(struct inference_batcher *const batcher, const struct inference_batcher_config *const config, inference_batcher_forward_fn forward, void *model, struct cgrad_env *const env);
+
+/**
+ * @brief Runs the queued requests, then stops the dispatcher and releases the batcher.
+ */
+void inference_batcher_cleanup(struct inference_batcher *const batcher);
+
+/**
+ * @brief Queues a request, can be called from any thread.
+ *
+ * @param batcher The batcher.
+ * @param future The request, whose input and output must be set.
+ * @return NO_ERROR if queued, INFERENCE_BATCHER_QUEUE_FULL if queue_capacity requests are already pending.
+ */
+cgrad_error inference_batcher_submit(struct inference_batcher *const batcher, struct inference_future *const future);
+
+/**
+ * @brief Blocks until the request has completed.
+ *
+ * @return The result of the forward pass which computed the request.
+ */
+cgrad_error inference_future_wait(struct inference_batcher *const batcher, struct inference_future *const future);
+
+/**
+ * @brief Fills a snapshot of the state of the batcher.
+ *
+ * @param batcher The batcher.
+ * @param stats The snapshot.
+ * @param batch_size_histogram If not NULL, receives the number of batches of each size, max_batch_size + 1 entries.
+ */
+cgrad_error inference_batcher_get_stats(struct inference_batcher *const batcher, struct inference_batcher_stats *const stats, size_t *const batch_size_histogram);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SPARSE_TENSOR_H
+#define SPARSE_TENSOR_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/cgrad_env.h"
+#include "cgrad/error.h"
+#include <stddef.h>
+
+/**
+ * @struct sparse_tensor
+ * @brief A 2D tensor in compressed sparse row (CSR) format.
+ *
+ * The values of row i are values[row_ptrs[i]] to values[row_ptrs[i + 1] - 1], in the columns given by the same
+ * positions of col_indexes, sorted in increasing order. The three arrays are tensors of the environment, so that
+ * they can be recorded as context of the operations reading them. Sparse tensors are data, no gradient is
+ * computed for them.
+ */
+struct sparse_tensor
+{
+    struct tensor *values;          /**< Nonzero values, of shape [nnz]. */
+    struct tensor *col_indexes;     /**< Column of each value, DTYPE_INT32 of shape [nnz]. */
+    struct tensor *row_ptrs;        /**< Offset of the first value of each row, DTYPE_INT32 of shape [rows + 1]. */
+    size_t shape[2];                /**< Shape of the equivalent dense tensor. */
+    size_t nnz;                     /**< Number of stored values. */
+};
+
+/**
+ * @brief Allocates a sparse tensor of rows x cols with room for nnz values, all rows being empty.
+ *
+ * @param sparse The sparse tensor.
+ * @param rows Number of rows.
+ * @param cols Number of columns.
+ * @param nnz Number of values.
+ * @param dtype Dtype of the values, DTYPE_FLOAT64 or DTYPE_FLOAT32.
+ * @param env The environment allocating the tensors.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error sparse_tensor_alloc(struct sparse_tensor *const sparse, const size_t rows, const size_t cols, const size_t nnz, const cgrad_dtype dtype, struct cgrad_env *const env);
+
+/**
+ * @brief Allocates the sparse tensor holding the nonzero values of a 2D dense tensor.
+ */
+cgrad_error sparse_tensor_from_dense(const struct tensor *const dense, struct sparse_tensor *const sparse, struct cgrad_env *const env);
+
+/**
+ * @brief Checks that the row offsets are increasing and that the column indexes are in bounds.
+ *
+ * @return NO_ERROR if the sparse tensor is valid, SPARSE_TENSOR_INVALID_INDEXES otherwise.
+ */
+cgrad_error sparse_tensor_check(const struct sparse_tensor *const sparse);
+
+/**
+ * @brief Frees the tensors of a sparse tensor allocated from env.
+ */
+void sparse_tensor_free(struct sparse_tensor *const sparse, struct cgrad_env *const env);
+
+#endif
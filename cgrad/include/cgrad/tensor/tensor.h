@@ -27,6 +27,9 @@ struct tensor
     size_t shape_size;                     /**< Number of dimensions in the tensor. */
     struct computational_graph_node *node; /**< Pointer to the computational graph node for gradient tracking. */
     struct tensor *grad;                   /**< Pointer to the gradient tensor. */
+    struct tensor *grad_rows;              /**< Rows held by grad when it is row-sparse, NULL if it is dense, see tensor_sparse_grad.h. */
+    size_t version;                        /**< Incremented whenever the data is updated in place, see tensor_mark_modified. */
+    bool requires_grad;                    /**< Whether gradients are propagated to the tensor, see tensor_set_requires_grad. */
 };
 
 #endif
\ No newline at end of file
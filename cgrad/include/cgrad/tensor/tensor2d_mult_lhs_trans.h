@@ -3,7 +3,13 @@
 
 #include "cgrad/tensor/tensor.h"
 #include "cgrad/error.h"
+#include "cgrad/parallel/thread_pool.h"
 
 cgrad_error tensor2d_mult_lhs_trans_into(const struct tensor *const lhs_trans, const struct tensor *const rhs, struct tensor *const out);
 
+/**
+ * @brief Same as tensor2d_mult_lhs_trans_into, splitting the product across the threads of pool, which may be NULL.
+ */
+cgrad_error tensor2d_mult_lhs_trans_into_parallel(const struct tensor *const lhs_trans, const struct tensor *const rhs, struct tensor *const out, struct thread_pool *const pool);
+
 #endif
\ No newline at end of file
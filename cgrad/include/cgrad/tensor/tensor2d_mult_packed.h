@@ -0,0 +1,17 @@
+#ifndef TENSOR2D_MULT_PACKED_H
+#define TENSOR2D_MULT_PACKED_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/gemm/gemm.h"
+#include "cgrad/cgrad_env.h"
+
+/**
+ * @brief Computes x op(weight), with weight viewed as a matrix of shape {shape[0], data_size / shape[0]}.
+ *
+ * The reshape and transposition of the weight are folded into the product, and the gradient of the weight
+ * keeps its shape. If packed is not NULL, it must hold op(weight) packed by gemm_pack_b_f32 or gemm_pack_b_f64,
+ * and is multiplied instead of packing the weight again. Only float32 and float64 tensors are supported.
+ */
+cgrad_error tensor2d_mult_packed(struct tensor *const x, struct tensor *const weight, const gemm_transpose trans_weight, const struct gemm_packed_b *const packed, struct tensor **const out, const bool track_grad, struct cgrad_env *const env);
+
+#endif
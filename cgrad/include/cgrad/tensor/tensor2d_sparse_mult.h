@@ -0,0 +1,17 @@
+#ifndef TENSOR2D_SPARSE_MULT_H
+#define TENSOR2D_SPARSE_MULT_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/tensor/sparse_tensor.h"
+#include "cgrad/cgrad_env.h"
+
+/**
+ * @brief Computes the product of a sparse tensor x and a dense tensor y, of shape [x->shape[0], y->shape[1]].
+ *
+ * The cost is proportional to the number of values of x times the columns of y. The gradient flows to y only,
+ * computed as x^T times the gradient of the result with the same cost. x must outlive the backward pass, as
+ * the inputs of dense products do. Only float32 and float64 tensors are supported.
+ */
+cgrad_error tensor2d_sparse_mult(const struct sparse_tensor *const x, struct tensor *const y, struct tensor **const out, const bool track_grad, struct cgrad_env *const env);
+
+#endif
@@ -11,6 +11,7 @@ static inline struct tensor *tensor_from_array_alloc(struct cgrad_env *env, cons
 static inline void tensor_free(struct cgrad_env *env, struct tensor *ptr);
 static inline void tensor_no_grad_free(struct cgrad_env *env, struct tensor *ptr);
 static inline struct tensor *tensor_clone(struct cgrad_env *env, struct tensor *src);
+static inline cgrad_error tensor_alloc_grad(struct cgrad_env *env, struct tensor *const t);
 
 static inline struct tensor *tensor_alloc(struct cgrad_env *env, const size_t *shape, const size_t shape_size, const cgrad_dtype dtype)
 {
@@ -47,4 +48,9 @@ static inline struct tensor *tensor_clone(struct cgrad_env *env, struct tensor *
     return tensor_allocator_clone(&env->tensor_alloc, src);
 }
 
+static inline cgrad_error tensor_alloc_grad(struct cgrad_env *env, struct tensor *const t)
+{
+    return tensor_allocator_alloc_grad(&env->tensor_alloc, t);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef TENSOR_CAST_H
+#define TENSOR_CAST_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/autograd/backpropagation/backpropagation_function.h"
+#include "cgrad/cgrad_env.h"
+
+/**
+ * @brief Converts a tensor to another floating point dtype, rounding to nearest even when narrowing.
+ *
+ * The gradient is converted back to the dtype of the operand, so that e.g. a float32 input can be fed to
+ * layers with DTYPE_FLOAT16 or DTYPE_BFLOAT16 weights.
+ *
+ * @param t Pointer to the tensor to convert.
+ * @param dtype The dtype of the result, one of DTYPE_FLOAT64, DTYPE_FLOAT32, DTYPE_BFLOAT16, DTYPE_FLOAT16.
+ * @param out Pointer to the converted tensor, allocated by the function.
+ * @param track_grad Whether to track the operation in the computational graph.
+ * @param env The environment.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error tensor_cast(struct tensor *const t, const cgrad_dtype dtype, struct tensor **const out, const bool track_grad, struct cgrad_env *const env);
+
+/**
+ * @brief Converts a tensor into an existing tensor with the same shape and the target dtype.
+ */
+cgrad_error tensor_cast_into(const struct tensor *const t, struct tensor *const out);
+
+#endif
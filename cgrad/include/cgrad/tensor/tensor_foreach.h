@@ -0,0 +1,74 @@
+#ifndef TENSOR_FOREACH_H
+#define TENSOR_FOREACH_H
+
+#include "cgrad/error.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/parallel/thread_pool.h"
+
+// Number of elements of a work item, the tensors of a list being laid end to end and cut every TENSOR_FOREACH_CHUNK elements
+#define TENSOR_FOREACH_CHUNK 16384
+
+/**
+ * @brief Hyperparameters of tensor_foreach_sgd.
+ */
+struct tensor_foreach_sgd_args
+{
+    double lr;
+    double momentum;
+    bool nesterov;
+    double grad_scale;                /**< Gradients are multiplied by grad_scale before the update. */
+};
+
+/*
+ * The tensor_foreach functions apply one operation to a whole list of tensors with a single parallel loop. The
+ * tensors are laid end to end and cut into work items of TENSOR_FOREACH_CHUNK elements, so that hundreds of small
+ * tensors, e.g. biases, share work items instead of paying one dispatch each, and large ones are split over the
+ * threads of pool, which may be NULL. NULL entries of the lists are skipped.
+ */
+
+/**
+ * @brief Sets every element of ts[0], ..., ts[n - 1] to zero.
+ */
+cgrad_error tensor_foreach_zero(struct tensor *const *const ts, const size_t n, struct thread_pool *const pool);
+
+/**
+ * @brief Multiplies ts[0], ..., ts[n - 1] by alpha.
+ */
+cgrad_error tensor_foreach_scale(struct tensor *const *const ts, const size_t n, const double alpha, struct thread_pool *const pool);
+
+/**
+ * @brief Computes ys[i] <- alpha * xs[i] + ys[i] for every i < n, xs[i] and ys[i] having the same shape and dtype.
+ *
+ * @return NO_ERROR if successful, TENSOR_SHAPE_MISMATCH or TENSOR_DTYPE_MISMATCH if a pair differs.
+ */
+cgrad_error tensor_foreach_axpy(struct tensor *const *const xs, struct tensor *const *const ys, const size_t n, const double alpha, struct thread_pool *const pool);
+
+/**
+ * @brief Global L2 norm of ts[0], ..., ts[n - 1], i.e. the norm of their concatenation.
+ *
+ * Squares are accumulated in float64 per work item and the partial sums are added in order, so the result does
+ * not depend on the number of threads.
+ */
+cgrad_error tensor_foreach_norm(struct tensor *const *const ts, const size_t n, double *const out, struct thread_pool *const pool);
+
+/**
+ * @brief Scales ts[0], ..., ts[n - 1] so that their global L2 norm is at most max_norm.
+ *
+ * The norm before clipping is stored in total_norm, which may be NULL.
+ */
+cgrad_error tensor_foreach_clip_norm(struct tensor *const *const ts, const size_t n, const double max_norm, double *const total_norm, struct thread_pool *const pool);
+
+/**
+ * @brief SGD step with momentum over n parameters, reading and writing each element once.
+ *
+ * For every i < n, momentums[i] <- momentum * momentums[i] + g and weights[i] <- weights[i] - lr * d, where g is
+ * grad_scale * grads[i] and d is momentums[i], g + momentum * momentums[i] if nesterov, or g if momentum is zero.
+ * weights[i] and momentums[i] have dtype DTYPE_FLOAT64 or DTYPE_FLOAT32, and grads[i] the same dtype or, for float32
+ * weights, a half precision one. If rounded is not NULL, the updated float32 weights[i] are also rounded into the half
+ * precision rounded[i] when not NULL.
+ *
+ * @return NO_ERROR if successful, TENSOR_SHAPE_MISMATCH or TENSOR_DTYPE_MISMATCH if the tensors of a parameter differ.
+ */
+cgrad_error tensor_foreach_sgd(struct tensor *const *const weights, struct tensor *const *const grads, struct tensor *const *const momentums, struct tensor *const *const rounded, const size_t n, const struct tensor_foreach_sgd_args *const args, struct thread_pool *const pool);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef TENSOR_HALF_H
+#define TENSOR_HALF_H
+
+#include "cgrad/tensor/tensor.h"
+
+/**
+ * Number of elements converted at a time by the element wise kernels on half precision tensors.
+ */
+#define TENSOR_HALF_BLOCK_SIZE 256
+
+/**
+ * Helpers for operations on DTYPE_BFLOAT16 and DTYPE_FLOAT16 tensors, which are computed by their float32
+ * kernel on widened copies of the operands, so that accumulation happens in float32.
+ */
+
+/**
+ * @brief Initializes a float32 copy of a half precision tensor, with the same shape.
+ *
+ * @param t Pointer to the half precision tensor.
+ * @param t_f32 Pointer to the tensor to initialize, its data must be released with tensor_half_release_f32.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error tensor_half_widen(const struct tensor *const t, struct tensor *const t_f32);
+
+/**
+ * @brief Initializes a float32 tensor with the same shape of a half precision tensor, without copying its data.
+ *
+ * @param t Pointer to the half precision tensor.
+ * @param t_f32 Pointer to the tensor to initialize, its data must be released with tensor_half_release_f32.
+ * @return NO_ERROR if successful, otherwise an appropriate error code.
+ */
+cgrad_error tensor_half_alloc_f32(const struct tensor *const t, struct tensor *const t_f32);
+
+/**
+ * @brief Rounds the data of a float32 tensor into a half precision tensor with the same number of elements.
+ *
+ * @param t_f32 Pointer to the float32 tensor.
+ * @param t Pointer to the half precision tensor.
+ */
+void tensor_half_narrow(const struct tensor *const t_f32, struct tensor *const t);
+
+/**
+ * @brief Releases the data of a tensor initialized by tensor_half_widen or tensor_half_alloc_f32.
+ *
+ * @param t_f32 Pointer to the float32 tensor.
+ */
+void tensor_half_release_f32(struct tensor *const t_f32);
+
+#endif
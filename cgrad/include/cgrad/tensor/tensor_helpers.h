@@ -16,6 +16,22 @@ void print_tensor(const struct tensor *const t);
  */
 static inline cgrad_error tensor_check_null(const struct tensor *const t);
 
+/**
+ * @brief Records that the data of t was updated in place, invalidating what was derived from it, e.g. packed weights.
+ *
+ * Called by the optimizers and the checkpoint loaders on the parameters they update. Code writing into the
+ * parameters of a layer directly must call it too.
+ */
+static inline void tensor_mark_modified(struct tensor *const t);
+
+/**
+ * @brief Sets whether gradients are propagated to t, true for newly allocated tensors.
+ *
+ * Operations record no backpropagation edge towards tensors not requiring a gradient, such as the inputs and
+ * targets of a batch, and their results require a gradient only if one of their operands does.
+ */
+static inline void tensor_set_requires_grad(struct tensor *const t, const bool requires_grad);
+
 static inline cgrad_error tensor_check_null(const struct tensor *const t)
 {
     if (t == NULL)
@@ -29,4 +45,20 @@ static inline cgrad_error tensor_check_null(const struct tensor *const t)
     return NO_ERROR;
 }
 
+static inline void tensor_mark_modified(struct tensor *const t)
+{
+    if (t)
+    {
+        t->version++;
+    }
+}
+
+static inline void tensor_set_requires_grad(struct tensor *const t, const bool requires_grad)
+{
+    if (t)
+    {
+        t->requires_grad = requires_grad;
+    }
+}
+
 #endif
\ No newline at end of file
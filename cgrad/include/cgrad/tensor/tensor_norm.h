@@ -4,7 +4,9 @@
 #include "cgrad/error.h"
 #include "cgrad/tensor/tensor.h"
 
-static inline cgrad_error tensor_norm(const struct tensor *const t, double *const out);
+/**
+ * @brief L2 norm of the elements of t, accumulated in float64, see tensor_foreach_norm.
+ */
+cgrad_error tensor_norm(const struct tensor *const t, double *const out);
 
-
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,24 @@
+#ifndef TENSOR_PERMUTE_H
+#define TENSOR_PERMUTE_H
+
+#include "cgrad/cgrad_env.h"
+#include "cgrad/parallel/thread_pool.h"
+
+/**
+ * @brief Permutes the axes of t, axis i of out being axis perm[i] of t.
+ *
+ * Axes which stay adjacent are moved together, and the innermost pair is transposed in cache blocks.
+ * The gradient is permuted back by the inverse permutation.
+ *
+ * @return NO_ERROR if successful, TENSOR_PERMUTE_INVALID_AXES if perm is not a permutation of the axes of t.
+ */
+cgrad_error tensor_permute(struct tensor *const t, const size_t *const perm, struct tensor **const out, const bool track_grad, struct cgrad_env *const env);
+
+/**
+ * @brief Permutes the axes of t into out, which must already have the permuted shape.
+ *
+ * Used by the other transpositions. The outer loops are split over pool, which may be NULL.
+ */
+cgrad_error tensor_permute_into(const struct tensor *const t, const size_t *const perm, struct tensor *const out, struct thread_pool *const pool);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef TENSOR_REDUCE_H
+#define TENSOR_REDUCE_H
+
+#include "cgrad/cgrad_env.h"
+#include "cgrad/parallel/thread_pool.h"
+
+/**
+ * @brief Sums t over the given axes.
+ *
+ * If keepdim, the reduced axes are kept in out with size one, otherwise they are removed, a tensor reduced over
+ * every axis having shape {1}. float32 and half precision rows are accumulated with Kahan summation, and runs
+ * of contiguous values with Kahan summation over SIMD lanes or in float64.
+ *
+ * @return NO_ERROR if successful, TENSOR_REDUCE_INVALID_AXES if axes is empty, repeated or out of range.
+ */
+cgrad_error tensor_reduce_sum(struct tensor *const t, const size_t *const axes, const size_t n_axes, const bool keepdim, struct tensor **const out, const bool track_grad, struct cgrad_env *const env);
+
+/**
+ * @brief Averages t over the given axes, see tensor_reduce_sum.
+ */
+cgrad_error tensor_reduce_mean(struct tensor *const t, const size_t *const axes, const size_t n_axes, const bool keepdim, struct tensor **const out, const bool track_grad, struct cgrad_env *const env);
+
+/**
+ * @brief Maximum of t over the given axes, see tensor_reduce_sum. The gradient flows to the first maximum only.
+ */
+cgrad_error tensor_reduce_max(struct tensor *const t, const size_t *const axes, const size_t n_axes, const bool keepdim, struct tensor **const out, const bool track_grad, struct cgrad_env *const env);
+
+/**
+ * @brief Position of the first maximum of t over the given axes, see tensor_reduce_sum.
+ *
+ * Positions are flattened over the reduced axes in row-major order and stored in out as DTYPE_INT32, so that they
+ * are exact whatever the dtype of t. The result is not tracked.
+ */
+cgrad_error tensor_reduce_argmax(const struct tensor *const t, const size_t *const axes, const size_t n_axes, const bool keepdim, struct tensor **const out, struct cgrad_env *const env);
+
+/**
+ * @brief Sums t over the given axes into out, which must have the reduced shape, with or without the reduced axes.
+ *
+ * The outer loops are split over pool, which may be NULL. The result does not depend on the number of threads.
+ */
+cgrad_error tensor_reduce_sum_into(const struct tensor *const t, const size_t *const axes, const size_t n_axes, struct tensor *const out, struct thread_pool *const pool);
+
+/**
+ * @brief Averages t over the given axes into out, see tensor_reduce_sum_into.
+ */
+cgrad_error tensor_reduce_mean_into(const struct tensor *const t, const size_t *const axes, const size_t n_axes, struct tensor *const out, struct thread_pool *const pool);
+
+/**
+ * @brief Maximum of t over the given axes into out, see tensor_reduce_sum_into.
+ */
+cgrad_error tensor_reduce_max_into(const struct tensor *const t, const size_t *const axes, const size_t n_axes, struct tensor *const out, struct thread_pool *const pool);
+
+/**
+ * @brief Position of the first maximum of t over the given axes into out, see tensor_reduce_argmax. out must be
+ * DTYPE_INT32.
+ */
+cgrad_error tensor_reduce_argmax_into(const struct tensor *const t, const size_t *const axes, const size_t n_axes, struct tensor *const out, struct thread_pool *const pool);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef TENSOR_SPARSE_GRAD_H
+#define TENSOR_SPARSE_GRAD_H
+
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/memory/tensor/tensor_allocator.h"
+#include <stdbool.h>
+
+/*
+ * The gradient of t is row-sparse when t->grad_rows is not NULL. t->grad then holds, along its first axis, only
+ * the rows of the gradient listed in t->grad_rows, a DTYPE_INT32 tensor in increasing order without duplicates,
+ * the other rows being zero. Operations reading a few rows of a large tensor, e.g. embedding_forward, produce
+ * them, so that neither the gradient nor the optimizer step scale with the rows of the tensor.
+ */
+
+/**
+ * @brief Whether the gradient of t is row-sparse.
+ */
+static inline bool tensor_has_sparse_grad(const struct tensor *const t);
+
+/**
+ * @brief Adds row i of values into row rows[i] of the gradient of t, for each of the n elements of rows.
+ *
+ * Rows appearing several times are summed. If t has no gradient, it is allocated row-sparse, holding the rows
+ * touched only; a dense gradient is added into in place.
+ *
+ * @param t A DTYPE_FLOAT64 or DTYPE_FLOAT32 tensor.
+ * @param rows DTYPE_INT32 indexes along the first axis of t.
+ * @param values Tensor of the dtype of t, holding n rows of t->data_size / t->shape[0] elements.
+ * @param alloc Allocator of the gradient.
+ * @return NO_ERROR if successful, TENSOR_INDEX_OUT_OF_BOUNDS if a row is out of bounds, otherwise an appropriate
+ * error code.
+ */
+cgrad_error tensor_sparse_grad_accumulate(struct tensor *const t, const struct tensor *const rows, const struct tensor *const values, struct tensor_allocator *const alloc);
+
+/**
+ * @brief Replaces the row-sparse gradient of t, if any, with the equivalent dense gradient.
+ *
+ * Used when a dense gradient is added to the gradient of t, e.g. of an embedding weight also read by a product.
+ *
+ * @return NO_ERROR if successful, TENSOR_ALLOCATION_FAILED if the dense gradient could not be allocated.
+ */
+cgrad_error tensor_sparse_grad_densify(struct tensor *const t, struct tensor_allocator *const alloc);
+
+/**
+ * @brief Releases the row-sparse gradient of t, if any, so that the next accumulation starts with no row.
+ */
+void tensor_sparse_grad_clear(struct tensor *const t, struct tensor_allocator *const alloc);
+
+static inline bool tensor_has_sparse_grad(const struct tensor *const t)
+{
+    return t && t->grad_rows;
+}
+
+#endif
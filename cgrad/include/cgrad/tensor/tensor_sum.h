@@ -3,9 +3,19 @@
 
 #include "cgrad/tensor/tensor.h"
 #include "cgrad/error.h"
+#include "cgrad/parallel/thread_pool.h"
 
 #include <stddef.h>
 
+/**
+ * @brief Sums t over axis into out, which keeps the axis with size one. Shorthand for tensor_reduce_sum_into.
+ */
 cgrad_error tensor_sum(const struct tensor *const t, const size_t axis, struct tensor *const out);
 
+/**
+ * @brief Same as tensor_sum, with the elements of out computed by the threads of pool. The result does not
+ * depend on their number, see tensor_reduce_sum_into.
+ */
+cgrad_error tensor_sum_parallel(const struct tensor *const t, const size_t axis, struct tensor *const out, struct thread_pool *const pool);
+
 #endif
\ No newline at end of file
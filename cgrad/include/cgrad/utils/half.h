@@ -0,0 +1,156 @@
+#ifndef HALF_H
+#define HALF_H
+
+#include "cgrad/dtypes.h"
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Conversions between float32 and the 16 bit storage dtypes. Narrowing conversions round to nearest even.
+ */
+
+static inline float bf16_to_f32(const uint16_t h);
+static inline uint16_t f32_to_bf16(const float f);
+static inline float f16_to_f32(const uint16_t h);
+static inline uint16_t f32_to_f16(const float f);
+static inline float half_to_f32(const uint16_t h, const cgrad_dtype dtype);
+static inline uint16_t f32_to_half(const float f, const cgrad_dtype dtype);
+
+/**
+ * @brief Widens n elements of a DTYPE_BFLOAT16 or DTYPE_FLOAT16 array into float32.
+ *
+ * Vectorized with F16C for float16 and AVX2 for bfloat16 when available.
+ *
+ * @param src Source array of 16 bit values.
+ * @param dst Destination float32 array.
+ * @param n Number of elements.
+ * @param dtype Dtype of the source array.
+ */
+void half_to_f32_array(const uint16_t *const src, float *const dst, const size_t n, const cgrad_dtype dtype);
+
+/**
+ * @brief Narrows n float32 elements into a DTYPE_BFLOAT16 or DTYPE_FLOAT16 array, rounding to nearest even.
+ *
+ * Vectorized with F16C for float16 and AVX512-BF16 (or AVX2 otherwise) for bfloat16 when available.
+ *
+ * @param src Source float32 array.
+ * @param dst Destination array of 16 bit values.
+ * @param n Number of elements.
+ * @param dtype Dtype of the destination array.
+ */
+void f32_to_half_array(const float *const src, uint16_t *const dst, const size_t n, const cgrad_dtype dtype);
+
+static inline float bf16_to_f32(const uint16_t h)
+{
+    const uint32_t bits = (uint32_t)h << 16;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static inline uint16_t f32_to_bf16(const float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+
+    // Keep NaNs quiet, rounding could turn them into infinities
+    if ((bits & 0x7fffffff) > 0x7f800000)
+    {
+        return (uint16_t)((bits >> 16) | 0x40);
+    }
+
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return (uint16_t)(bits >> 16);
+}
+
+static inline float f16_to_f32(const uint16_t h)
+{
+    const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa == 0)
+    {
+        bits = sign;
+    }
+    else
+    {
+        // Subnormal, normalize the mantissa
+        exponent = 113;
+        while (!(mantissa & 0x400))
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static inline uint16_t f32_to_f16(const float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+
+    const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    const uint32_t abs = bits & 0x7fffffff;
+
+    if (abs >= 0x7f800000)
+    {
+        return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+    }
+    // At least 65520, which rounds to infinity
+    if (abs >= 0x477ff000)
+    {
+        return sign | 0x7c00;
+    }
+    // Below 2^-14, the result is subnormal
+    if (abs < 0x38800000)
+    {
+        // Up to 2^-25, which rounds to zero
+        if (abs <= 0x33000000)
+        {
+            return sign;
+        }
+
+        const uint32_t mantissa = (abs & 0x7fffff) | 0x800000;
+        const uint32_t shift = 126 - (abs >> 23);
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+
+        uint32_t result = mantissa >> shift;
+        if (remainder > halfway || (remainder == halfway && (result & 1)))
+        {
+            result++;
+        }
+        return sign | (uint16_t)result;
+    }
+
+    // Rebias the exponent from 127 to 15, then round the 13 dropped mantissa bits
+    const uint32_t rebiased = abs - 0x38000000;
+    return sign | (uint16_t)((rebiased + 0xfff + ((rebiased >> 13) & 1)) >> 13);
+}
+
+static inline float half_to_f32(const uint16_t h, const cgrad_dtype dtype)
+{
+    return dtype == DTYPE_BFLOAT16 ? bf16_to_f32(h) : f16_to_f32(h);
+}
+
+static inline uint16_t f32_to_half(const float f, const cgrad_dtype dtype)
+{
+    return dtype == DTYPE_BFLOAT16 ? f32_to_bf16(f) : f32_to_f16(f);
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include "cgrad/dtypes.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Counter-based Philox4x32-10 generator.
+ *
+ * A generator is a key and a position in an infinite sequence of 32 bit words, where each word is a pure
+ * function of the key and of its index. Fills never depend on how the sequence is split, so generated values
+ * are bit-reproducible whatever the number of threads producing them. Independent sequences for threads or
+ * devices are obtained with philox_stream.
+ */
+
+/**
+ * @struct philox_state
+ * @brief Key of a sequence and index of its next unused word.
+ */
+struct philox_state
+{
+    uint32_t key[2];
+    uint64_t offset;
+};
+
+void philox_init(struct philox_state *const state, const uint64_t seed);
+
+/**
+ * @brief Derives the independent sequence number stream of a generator, e.g. one per thread.
+ *
+ * The result depends only on the key of state and on stream, not on its offset.
+ */
+struct philox_state philox_stream(const struct philox_state *const state, const uint64_t stream);
+
+/**
+ * @brief Advances the generator by n words, as if they had been generated.
+ */
+void philox_skip(struct philox_state *const state, const uint64_t n);
+
+/**
+ * @brief Fills dst with n 32 bit words of the sequence and advances the generator. Vectorized with AVX2.
+ */
+void philox_fill_u32(struct philox_state *const state, uint32_t *const dst, const size_t n);
+
+/**
+ * @brief Fills dst with n values uniformly distributed in [low, high), one word each.
+ */
+void philox_uniform_f32(struct philox_state *const state, float *const dst, const size_t n, const float low, const float high);
+
+/**
+ * @brief Fills dst with n values uniformly distributed in [low, high), with 53 random bits from two words each.
+ */
+void philox_uniform_f64(struct philox_state *const state, double *const dst, const size_t n, const double low, const double high);
+
+/**
+ * @brief Fills a DTYPE_BFLOAT16 or DTYPE_FLOAT16 array with the values of philox_uniform_f32, rounded to nearest even.
+ */
+void philox_uniform_half(struct philox_state *const state, uint16_t *const dst, const size_t n, const float low, const float high, const cgrad_dtype dtype);
+
+/**
+ * @brief Fills dst with n normally distributed values using the Box-Muller transform, two words per pair of values.
+ */
+void philox_normal_f32(struct philox_state *const state, float *const dst, const size_t n, const float mean, const float std);
+void philox_normal_f64(struct philox_state *const state, double *const dst, const size_t n, const double mean, const double std);
+
+/**
+ * @brief Returns an integer uniformly distributed in [low, high], e.g. for shuffling.
+ */
+int64_t philox_uniform_int(struct philox_state *const state, const int64_t low, const int64_t high);
+
+#endif
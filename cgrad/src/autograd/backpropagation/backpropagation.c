@@ -1,8 +1,11 @@
 #include "cgrad/autograd/backpropagation/backpropagation.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/backpropagation/backpropagation_queue.h"
+#include "cgrad/autograd/checkpoint/checkpoint.h"
 #include "cgrad/tensor/tensor_add_inplace.h"
 #include "cgrad/tensor/tensor_set.h"
+#include "cgrad/tensor/tensor_sparse_grad.h"
+#include "cgrad/utils/half.h"
 #include "cgrad/config.h"
 #include <stdio.h>
 #include <string.h>
@@ -16,9 +19,15 @@ struct backpropagation_targets
 
 static cgrad_error build_gradients(struct computational_graph_node *loss_node, struct cgrad_env *env, struct backpropagation_targets *targets);
 static cgrad_error add_target(struct backpropagation_targets* const targets, struct computational_graph_node* const node);
-static inline cgrad_error set_gradient_wrt_itself(struct tensor* const t);
+static inline cgrad_error set_gradient_wrt_itself(struct tensor* const t, const double seed, struct cgrad_env *env);
+static inline void release_intermediate(struct tensor *const t, struct cgrad_env *env);
 
 cgrad_error backward(struct tensor* t, struct cgrad_env *env)
+{
+    return backward_with_seed(t, 1.0, env);
+}
+
+cgrad_error backward_with_seed(struct tensor* t, const double seed, struct cgrad_env *env)
 {
     if (!t)
     {
@@ -33,11 +42,21 @@ cgrad_error backward(struct tensor* t, struct cgrad_env *env)
     targets.size = 0;
 
     cgrad_error err = NO_ERROR;
-    if ((err = set_gradient_wrt_itself(t)) != NO_ERROR)
+    if ((err = set_gradient_wrt_itself(t, seed, env)) != NO_ERROR)
     {
         return err;
     }
 
+    // Only the intermediates of the environment are released, the other tensors may be read by their owner
+    const struct tensor_list *intermediates = env->tensor_alloc_intermediates;
+    for (size_t i = 0; i < intermediates->size; i++)
+    {
+        if (intermediates->data[i]->node)
+        {
+            intermediates->data[i]->node->is_intermediate = true;
+        }
+    }
+
     if ((err = build_gradients(t->node, env, &targets)) != NO_ERROR)
     {
         return err;
@@ -49,6 +68,20 @@ cgrad_error backward(struct tensor* t, struct cgrad_env *env)
         node->t->node = NULL;
         computational_graph_allocator_free(&env->graph_alloc, node);
     }
+    checkpoint_clear_segments(env);
+
+    return NO_ERROR;
+}
+
+cgrad_error backward_set_gradient_hook(struct cgrad_env *env, gradient_hook_function function, void *arg)
+{
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+
+    env->grad_hook.function = function;
+    env->grad_hook.arg = arg;
 
     return NO_ERROR;
 }
@@ -76,38 +109,82 @@ static cgrad_error build_gradients(struct computational_graph_node *loss_node, s
         {
             return err;
         }
+        if ((err = checkpoint_on_node_popped(env, node)) != NO_ERROR)
+        {
+            return err;
+        }
 
-        for (size_t i = 0; i < node->n_children; i++)
+        // A node is popped once all its parents pushed their gradient, which is therefore final
+        if (node->is_leaf && node->t->grad && env->grad_hook.function)
         {
-            struct computational_graph_node *child_node = node->children[i];
-            struct tensor *gradient = tensor_allocator_no_grad_alloc(&env->tensor_alloc, child_node->t->shape, child_node->t->shape_size, loss_node->t->dtype);
-            if (!gradient)
+            if ((err = env->grad_hook.function(env->grad_hook.arg, node->t)) != NO_ERROR)
             {
-                return TENSOR_ALLOCATION_FAILED;
+                return err;
             }
+        }
 
-            struct backpropagation_context *ctx = &node->ctx;
-            size_t operand = node->children_operands[i];
+        for (size_t i = 0; i < node->n_children; i++)
+        {
+            struct computational_graph_node *child_node = node->children[i];
 
-            if ((err = backpropagation_function_check_input(node->t->grad, gradient)) != NO_ERROR)
+            // Results not requiring a gradient are linked for the visit order only
+            if (child_node->t->requires_grad)
             {
-                return err;
-            }
+                struct backpropagation_context *ctx = &node->ctx;
+                size_t operand = node->children_operands[i];
 
-            if ((err = node->function[operand](ctx, node->t->grad, gradient)) != NO_ERROR)
-            {
-                return err;
-            }
+                // Functions accumulating into the gradient of the operand itself, e.g. a row-sparse one, need no dense gradient
+                if (node->function_accumulates[operand])
+                {
+                    if ((err = node->function[operand](ctx, node->t->grad, child_node->t)) != NO_ERROR)
+                    {
+                        return err;
+                    }
+                }
+                else
+                {
+                    // Gradients have the dtype of the tensor they refer to, which changes across tensor_cast
+                    struct tensor *gradient = tensor_allocator_no_grad_alloc(&env->tensor_alloc, child_node->t->shape, child_node->t->shape_size, child_node->t->dtype);
+                    if (!gradient)
+                    {
+                        return TENSOR_ALLOCATION_FAILED;
+                    }
 
-            if ((err = tensor_add_inplace(child_node->t->grad, gradient)) != NO_ERROR)
-            {
-                return err;
+                    if ((err = backpropagation_function_check_input(node->t->grad, gradient)) != NO_ERROR)
+                    {
+                        return err;
+                    }
+
+                    if ((err = node->function[operand](ctx, node->t->grad, gradient)) != NO_ERROR)
+                    {
+                        return err;
+                    }
+
+                    // The first gradient reaching a tensor without a gradient buffer becomes its gradient,
+                    // avoiding both the zeroed allocation and the accumulation.
+                    if (!child_node->t->grad)
+                    {
+                        child_node->t->grad = gradient;
+                    }
+                    else
+                    {
+                        // A row-sparse gradient, e.g. of an embedding weight also read by a product, becomes dense
+                        if ((err = tensor_sparse_grad_densify(child_node->t, &env->tensor_alloc)) != NO_ERROR)
+                        {
+                            tensor_allocator_free(&env->tensor_alloc, gradient);
+                            return err;
+                        }
+                        if ((err = tensor_add_inplace(child_node->t->grad, gradient)) != NO_ERROR)
+                        {
+                            return err;
+                        }
+                        tensor_allocator_free(&env->tensor_alloc, gradient);
+                    }
+                }
             }
 
             child_node->pushed_gradients_count++;
 
-            tensor_allocator_free(&env->tensor_alloc, gradient);
-
             if (child_node->pushed_gradients_count == child_node->n_parents)
             {
                 if ((err = backpropagation_queue_push(&queue, child_node)) != NO_ERROR)
@@ -116,6 +193,17 @@ static cgrad_error build_gradients(struct computational_graph_node *loss_node, s
                 }
             }
         }
+
+        checkpoint_on_node_processed(env, node);
+
+        /**
+         * Nodes are processed once all the operations using them are, and no later node reads the data or
+         * gradient of an intermediate tensor, which are therefore dead.
+         */
+        if (node->is_intermediate && node != loss_node)
+        {
+            release_intermediate(node->t, env);
+        }
     }
 
     return NO_ERROR;
@@ -144,15 +232,37 @@ static cgrad_error add_target(struct backpropagation_targets* const targets, str
     return NO_ERROR;
 }
 
-static inline cgrad_error set_gradient_wrt_itself(struct tensor* const t)
+static inline cgrad_error set_gradient_wrt_itself(struct tensor* const t, const double seed, struct cgrad_env *env)
 {
+    cgrad_error err = tensor_allocator_alloc_grad(&env->tensor_alloc, t);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
     switch (t->grad->dtype)
     {
         case DTYPE_FLOAT64:
-            return tensor2d_set(t->grad, 0, 0, (double)1.0);
+            return tensor2d_set(t->grad, 0, 0, (double)seed);
         case DTYPE_FLOAT32:
-            return tensor2d_set(t->grad, 0, 0, (float)1.0);
+            return tensor2d_set(t->grad, 0, 0, (float)seed);
+        case DTYPE_BFLOAT16:
+        case DTYPE_FLOAT16:
+            ((uint16_t *)t->grad->data)[0] = f32_to_half((float)seed, t->grad->dtype);
+            return NO_ERROR;
         default:
             return AUTOGRAD_BACKPROPAGATION_INVALID_TENSOR_DTYPE;
     }
-}
\ No newline at end of file
+}
+
+static inline void release_intermediate(struct tensor *const t, struct cgrad_env *env)
+{
+    tensor_allocator_data_free(&env->tensor_alloc, t->data);
+    t->data = NULL;
+
+    if (t->grad)
+    {
+        tensor_allocator_no_grad_free(&env->tensor_alloc, t->grad);
+        t->grad = NULL;
+    }
+}
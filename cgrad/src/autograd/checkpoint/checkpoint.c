@@ -0,0 +1,279 @@
+#include "cgrad/autograd/checkpoint/checkpoint.h"
+#include "cgrad/autograd/computational_graph/computational_graph.h"
+#include "cgrad/cgrad_env.h"
+#include <time.h>
+
+static void checkpoint_segment_collect(struct checkpoint_segment *const segment, struct computational_graph_node *const output, const size_t segment_id);
+static void checkpoint_segment_release(struct checkpoint_segment *const segment, struct cgrad_env *const env);
+static cgrad_error checkpoint_segment_recompute(struct checkpoint_segment *const segment, struct cgrad_env *const env);
+static inline size_t tensor_data_bytes(const struct tensor *const t);
+static inline double checkpoint_elapsed_seconds(const struct timespec *const start, const struct timespec *const end);
+
+void checkpoint_state_init(struct checkpoint_state *const state)
+{
+    state->policy = CHECKPOINT_POLICY_RECOMPUTE;
+    state->active_segment = 0;
+    state->is_active = false;
+    state->n_segments = 0;
+    state->stats = (struct checkpoint_stats){0};
+}
+
+cgrad_error checkpoint_set_policy(struct cgrad_env *const env, const checkpoint_policy policy)
+{
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (env->checkpoint.is_active)
+    {
+        return CHECKPOINT_SEGMENT_ALREADY_ACTIVE;
+    }
+
+    env->checkpoint.policy = policy;
+    return NO_ERROR;
+}
+
+cgrad_error checkpoint_begin(struct cgrad_env *const env, const struct tensor *const input)
+{
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (!input)
+    {
+        return TENSOR_NULL;
+    }
+
+    struct checkpoint_state *state = &env->checkpoint;
+    if (state->is_active)
+    {
+        return CHECKPOINT_SEGMENT_ALREADY_ACTIVE;
+    }
+
+    state->is_active = true;
+    if (state->policy == CHECKPOINT_POLICY_STORE)
+    {
+        return NO_ERROR;
+    }
+
+    if (state->n_segments >= AUTOGRAD_MAX_CHECKPOINT_SEGMENTS)
+    {
+        state->is_active = false;
+        return CHECKPOINT_MAX_SEGMENTS_EXCEEDED;
+    }
+
+    // Nodes created from now on are tagged with the segment id, see add_computational_graph_link
+    state->active_segment = ++state->n_segments;
+
+    return NO_ERROR;
+}
+
+cgrad_error checkpoint_end(struct cgrad_env *const env, struct tensor *const output)
+{
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (!output)
+    {
+        return TENSOR_NULL;
+    }
+
+    struct checkpoint_state *state = &env->checkpoint;
+    if (!state->is_active)
+    {
+        return CHECKPOINT_SEGMENT_NOT_ACTIVE;
+    }
+
+    const size_t segment_id = state->active_segment;
+    state->is_active = false;
+    state->active_segment = 0;
+
+    if (segment_id == 0)
+    {
+        return NO_ERROR;
+    }
+
+    struct checkpoint_segment *segment = &state->segments[segment_id - 1];
+    segment->output = output->node;
+    segment->size = 0;
+    segment->n_processed = 0;
+
+    // Without gradient tracking there is nothing to recompute
+    if (!output->node || output->node->checkpoint_segment != segment_id)
+    {
+        return NO_ERROR;
+    }
+
+    checkpoint_segment_collect(segment, output->node, segment_id);
+
+    for (size_t i = 0; i < segment->size; i++)
+    {
+        state->stats.released_bytes += tensor_data_bytes(segment->nodes[i]->t);
+    }
+    checkpoint_segment_release(segment, env);
+
+    return NO_ERROR;
+}
+
+cgrad_error checkpoint_on_node_popped(struct cgrad_env *const env, struct computational_graph_node *const node)
+{
+    if (node->checkpoint_segment == 0)
+    {
+        return NO_ERROR;
+    }
+
+    struct checkpoint_segment *segment = &env->checkpoint.segments[node->checkpoint_segment - 1];
+    if (node != segment->output || segment->size == 0)
+    {
+        return NO_ERROR;
+    }
+
+    // The output is backpropagated before any other node of the segment, regenerate them now
+    return checkpoint_segment_recompute(segment, env);
+}
+
+void checkpoint_on_node_processed(struct cgrad_env *const env, struct computational_graph_node *const node)
+{
+    if (node->checkpoint_segment == 0)
+    {
+        return;
+    }
+
+    struct checkpoint_segment *segment = &env->checkpoint.segments[node->checkpoint_segment - 1];
+    if (node != segment->output && !node->is_recomputed)
+    {
+        return;
+    }
+
+    segment->n_processed++;
+    if (segment->n_processed == segment->size + 1)
+    {
+        checkpoint_segment_release(segment, env);
+    }
+}
+
+void checkpoint_clear_segments(struct cgrad_env *const env)
+{
+    env->checkpoint.n_segments = 0;
+}
+
+const struct checkpoint_stats *checkpoint_get_stats(const struct cgrad_env *const env)
+{
+    if (!env)
+    {
+        return NULL;
+    }
+
+    return &env->checkpoint.stats;
+}
+
+void checkpoint_reset_stats(struct cgrad_env *const env)
+{
+    if (!env)
+    {
+        return;
+    }
+
+    env->checkpoint.stats = (struct checkpoint_stats){0};
+}
+
+static void checkpoint_segment_collect(struct checkpoint_segment *const segment, struct computational_graph_node *const output, const size_t segment_id)
+{
+    /**
+     * Depth-first visit from the output through the nodes of the segment. Nodes are appended in post-order,
+     * so operands precede the operations using them, which is the order of the forward pass.
+     */
+    struct computational_graph_node *stack[AUTOGRAD_MAX_NODES];
+    size_t next_child[AUTOGRAD_MAX_NODES];
+    size_t stack_size = 0;
+
+    stack[stack_size] = output;
+    next_child[stack_size++] = 0;
+
+    while (stack_size > 0)
+    {
+        struct computational_graph_node *node = stack[stack_size - 1];
+        if (next_child[stack_size - 1] < node->n_children)
+        {
+            struct computational_graph_node *child = node->children[next_child[stack_size - 1]++];
+            if (child->checkpoint_segment != segment_id || child->is_leaf || !child->forward || child->is_recomputed)
+            {
+                continue;
+            }
+            if (stack_size >= AUTOGRAD_MAX_NODES)
+            {
+                continue;
+            }
+
+            // Marked on entry, so that a node reachable through several paths is visited once
+            child->is_recomputed = true;
+            stack[stack_size] = child;
+            next_child[stack_size++] = 0;
+            continue;
+        }
+
+        stack_size--;
+        if (node != output)
+        {
+            segment->nodes[segment->size++] = node;
+        }
+    }
+}
+
+static void checkpoint_segment_release(struct checkpoint_segment *const segment, struct cgrad_env *const env)
+{
+    for (size_t i = 0; i < segment->size; i++)
+    {
+        struct tensor *t = segment->nodes[i]->t;
+        tensor_allocator_data_free(&env->tensor_alloc, t->data);
+        t->data = NULL;
+    }
+}
+
+static cgrad_error checkpoint_segment_recompute(struct checkpoint_segment *const segment, struct cgrad_env *const env)
+{
+    struct timespec start;
+    timespec_get(&start, TIME_UTC);
+
+    cgrad_error err = NO_ERROR;
+    for (size_t i = 0; i < segment->size; i++)
+    {
+        struct computational_graph_node *node = segment->nodes[i];
+        struct tensor *t = node->t;
+
+        const size_t bytes = tensor_data_bytes(t);
+        t->data = tensor_allocator_data_alloc(&env->tensor_alloc, bytes);
+        if (!t->data)
+        {
+            checkpoint_segment_release(segment, env);
+            return TENSOR_ALLOCATION_FAILED;
+        }
+
+        if ((err = node->forward(&node->ctx, t)) != NO_ERROR)
+        {
+            checkpoint_segment_release(segment, env);
+            return err;
+        }
+
+        env->checkpoint.stats.recomputed_bytes += bytes;
+    }
+
+    struct timespec end;
+    timespec_get(&end, TIME_UTC);
+
+    env->checkpoint.stats.n_recomputed_segments++;
+    env->checkpoint.stats.recompute_seconds += checkpoint_elapsed_seconds(&start, &end);
+
+    return NO_ERROR;
+}
+
+static inline size_t tensor_data_bytes(const struct tensor *const t)
+{
+    return t->data_size * dtype_sizeof(t->dtype);
+}
+
+static inline double checkpoint_elapsed_seconds(const struct timespec *const start, const struct timespec *const end)
+{
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) * 1e-9;
+}
@@ -25,10 +25,6 @@ cgrad_error add_computational_graph_link(struct tensor *operand, size_t operand_
     {
         return TENSOR_NULL;
     }
-    if (!operand->grad || !result->grad)
-    {
-        return TENSOR_GRAD_NULL;
-    }
     if (!env)
     {
         return ALLOCATORS_NULL;
@@ -40,35 +36,60 @@ cgrad_error add_computational_graph_link(struct tensor *operand, size_t operand_
 
     cgrad_error err = NO_ERROR;
 
-    if (!operand->node)
+    const bool is_new_result = !result->node;
+    if (is_new_result)
     {
-        operand->node = computational_graph_allocator_alloc(&env->graph_alloc, operand);
-        if (!operand->node)
+        result->node = computational_graph_allocator_alloc(&env->graph_alloc, result);
+        if (!result->node)
         {
             return AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_ALLOCATION_ERROR;
         }
-        if ((err = context_init(&operand->node->ctx, &env->tensor_alloc)) != NO_ERROR)
+        if ((err = context_init(&result->node->ctx, &env->tensor_alloc)) != NO_ERROR)
         {
             return err;
         }
+        result->node->checkpoint_segment = env->checkpoint.active_segment;
+        result->node->ctx.pool = env->pool;
     }
 
-    if (!result->node)
+    struct computational_graph_node *res_node = result->node;
+    res_node->is_leaf = false;
+
+    // The result requires a gradient if any of its operands does
+    result->requires_grad = is_new_result ? operand->requires_grad : (result->requires_grad || operand->requires_grad);
+
+    // Setup operand in the tensor operands pointer
+    context_set_operand(&res_node->ctx, operand, operand_id);
+
+    /**
+     * Leaves not requiring a gradient, e.g. inputs and targets, are not linked, so that no gradient is computed
+     * for them. Results not requiring a gradient keep their link, which orders their recomputation in replays
+     * and checkpointed segments, and backpropagation skips it.
+     */
+    if (!operand->requires_grad && !operand->node)
     {
-        result->node = computational_graph_allocator_alloc(&env->graph_alloc, result);
-        if (!result->node)
+        return NO_ERROR;
+    }
+
+    if (!operand->node)
+    {
+        operand->node = computational_graph_allocator_alloc(&env->graph_alloc, operand);
+        if (!operand->node)
         {
-            computational_graph_allocator_free(&env->graph_alloc, operand->node);
+            if (is_new_result)
+            {
+                computational_graph_allocator_free(&env->graph_alloc, res_node);
+                result->node = NULL;
+            }
             return AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_ALLOCATION_ERROR;
         }
-        if ((err = context_init(&result->node->ctx, &env->tensor_alloc)) != NO_ERROR)
+        if ((err = context_init(&operand->node->ctx, &env->tensor_alloc)) != NO_ERROR)
         {
             return err;
         }
     }
 
     struct computational_graph_node *op_node = operand->node;
-    struct computational_graph_node *res_node = result->node;
 
     // Setup connection
     if ((err = add_parent(op_node, res_node)) != NO_ERROR)
@@ -86,10 +107,7 @@ cgrad_error add_computational_graph_link(struct tensor *operand, size_t operand_
     }
 
     // Setup backpropagation function
-    result->node->function[operand_id] = backprop_function;
-
-    // Setup operand in the tensor operands pointer
-    context_set_operand(&res_node->ctx, operand, operand_id);
+    res_node->function[operand_id] = backprop_function;
 
     return NO_ERROR;
 }
@@ -0,0 +1,427 @@
+#include "cgrad/autograd/execution_plan/execution_plan.h"
+#include "cgrad/autograd/execution_plan/execution_plan_memory.h"
+#include "cgrad/autograd/backpropagation/backpropagation_queue.h"
+#include "cgrad/tensor/tensor_add_inplace.h"
+#include "cgrad/tensor/tensor_equality.h"
+#include "cgrad/tensor/tensor_set.h"
+#include <string.h>
+
+static cgrad_error execution_plan_sort_nodes(struct execution_plan *const plan, struct computational_graph_node *const loss_node);
+static cgrad_error execution_plan_check_replayable(const struct execution_plan *const plan);
+static cgrad_error execution_plan_assign_buffers(struct execution_plan *const plan);
+static cgrad_error execution_plan_take_intermediates(struct execution_plan *const plan);
+static struct tensor *execution_plan_get_temporary(struct execution_plan *const plan, const struct tensor *const t);
+static void execution_plan_capture_rollback(struct execution_plan *const plan);
+static cgrad_error execution_plan_backward(struct execution_plan *const plan);
+static inline cgrad_error execution_plan_seed_loss_gradient(struct execution_plan *const plan);
+
+cgrad_error execution_plan_capture(struct execution_plan *const plan, struct tensor *const loss, struct cgrad_env *const env)
+{
+    if (!plan)
+    {
+        return EXECUTION_PLAN_NULL;
+    }
+    if (!loss)
+    {
+        return TENSOR_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (!loss->node)
+    {
+        return AUTOGRAD_COMPUTATIONAL_GRAPH_NODE_NULL;
+    }
+    if (env->grad_hook.function)
+    {
+        return EXECUTION_PLAN_FUSED_BACKWARD;
+    }
+
+    plan->size = 0;
+    plan->n_temporaries = 0;
+    plan->n_planned_tensors = 0;
+    plan->n_buffers = 0;
+    plan->intermediates = NULL;
+    plan->loss = loss;
+    plan->env = env;
+    plan->is_captured = false;
+
+    cgrad_error err = NO_ERROR;
+    if ((err = execution_plan_sort_nodes(plan, loss->node)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = execution_plan_check_replayable(plan)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = execution_plan_assign_buffers(plan)) != NO_ERROR || (err = execution_plan_take_intermediates(plan)) != NO_ERROR)
+    {
+        execution_plan_capture_rollback(plan);
+        return err;
+    }
+
+    // Detach the recorded graph, the plan only refers to it through its nodes
+    for (size_t i = 0; i < plan->size; i++)
+    {
+        plan->nodes[i]->t->node = NULL;
+    }
+    plan->is_captured = true;
+
+    if ((err = execution_plan_seed_loss_gradient(plan)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    return execution_plan_backward(plan);
+}
+
+cgrad_error execution_plan_feed(const struct execution_plan *const plan, struct tensor *const captured, const struct tensor *const value)
+{
+    if (!plan)
+    {
+        return EXECUTION_PLAN_NULL;
+    }
+    if (!plan->is_captured)
+    {
+        return EXECUTION_PLAN_NOT_CAPTURED;
+    }
+    if (!captured || !value)
+    {
+        return TENSOR_NULL;
+    }
+    if (captured->dtype != value->dtype || !tensor_same_shape(captured, value))
+    {
+        return EXECUTION_PLAN_SHAPE_MISMATCH;
+    }
+
+    memcpy(captured->data, value->data, value->data_size * dtype_sizeof(value->dtype));
+
+    return NO_ERROR;
+}
+
+cgrad_error execution_plan_replay(struct execution_plan *const plan)
+{
+    if (!plan)
+    {
+        return EXECUTION_PLAN_NULL;
+    }
+    if (!plan->is_captured)
+    {
+        return EXECUTION_PLAN_NOT_CAPTURED;
+    }
+    if (plan->env->grad_hook.function)
+    {
+        return EXECUTION_PLAN_FUSED_BACKWARD;
+    }
+
+    cgrad_error err = NO_ERROR;
+
+    // Forward pass, in reverse topological order. Leaves are the inputs of the step.
+    for (size_t i = plan->size; i-- > 0;)
+    {
+        struct computational_graph_node *node = plan->nodes[i];
+        if (node->is_leaf)
+        {
+            continue;
+        }
+
+        if ((err = node->forward(&node->ctx, node->t)) != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    return execution_plan_backward(plan);
+}
+
+cgrad_error execution_plan_cleanup(struct execution_plan *const plan)
+{
+    if (!plan)
+    {
+        return EXECUTION_PLAN_NULL;
+    }
+    if (!plan->is_captured)
+    {
+        return NO_ERROR;
+    }
+
+    cgrad_error err = execution_plan_release_memory(plan);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct tensor_allocator *tensor_alloc = &plan->env->tensor_alloc;
+    for (size_t i = 0; i < plan->n_temporaries; i++)
+    {
+        tensor_allocator_free(tensor_alloc, plan->temporaries[i]);
+    }
+
+    for (size_t i = 0; i < plan->size; i++)
+    {
+        computational_graph_allocator_free(&plan->env->graph_alloc, plan->nodes[i]);
+    }
+
+    for (size_t i = 0; i < plan->intermediates->size; i++)
+    {
+        tensor_allocator_free(tensor_alloc, plan->intermediates->data[i]);
+    }
+    tensor_list_free(plan->intermediates);
+
+    plan->size = 0;
+    plan->n_temporaries = 0;
+    plan->intermediates = NULL;
+    plan->is_captured = false;
+
+    return NO_ERROR;
+}
+
+static cgrad_error execution_plan_sort_nodes(struct execution_plan *const plan, struct computational_graph_node *const loss_node)
+{
+    cgrad_error err = NO_ERROR;
+
+    struct backpropagation_queue queue;
+    if ((err = backpropagation_queue_init(&queue)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = backpropagation_queue_push(&queue, loss_node)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Same visit order as backward(): a node is visited once all its parents pushed their gradient
+    while (!backpropagation_queue_is_empty(&queue))
+    {
+        struct computational_graph_node *node = NULL;
+        backpropagation_queue_pop(&queue, &node);
+
+        if (plan->size >= AUTOGRAD_MAX_NODES)
+        {
+            return AUTOGRAD_MAX_TARGETS_EXCEEDED;
+        }
+        plan->nodes[plan->size++] = node;
+
+        for (size_t i = 0; i < node->n_children; i++)
+        {
+            struct computational_graph_node *child_node = node->children[i];
+            child_node->pushed_gradients_count++;
+            if (child_node->pushed_gradients_count == child_node->n_parents)
+            {
+                if ((err = backpropagation_queue_push(&queue, child_node)) != NO_ERROR)
+                {
+                    return err;
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < plan->size; i++)
+    {
+        plan->nodes[i]->pushed_gradients_count = 0;
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error execution_plan_check_replayable(const struct execution_plan *const plan)
+{
+    for (size_t i = 0; i < plan->size; i++)
+    {
+        const struct computational_graph_node *node = plan->nodes[i];
+        // Checkpointed tensors have no data outside of backward()
+        if (!node->is_leaf && (!node->forward || node->is_recomputed))
+        {
+            return EXECUTION_PLAN_OPERATION_NOT_REPLAYABLE;
+        }
+        for (size_t j = 0; j < AUTOGRAD_MAX_CHILDREN; j++)
+        {
+            if (node->function_accumulates[j])
+            {
+                return EXECUTION_PLAN_OPERATION_NOT_REPLAYABLE;
+            }
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error execution_plan_assign_buffers(struct execution_plan *const plan)
+{
+    struct tensor_allocator *tensor_alloc = &plan->env->tensor_alloc;
+    cgrad_error err = NO_ERROR;
+
+    for (size_t i = 0; i < plan->size; i++)
+    {
+        if (plan->nodes[i]->t->requires_grad && (err = tensor_allocator_alloc_grad(tensor_alloc, plan->nodes[i]->t)) != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    for (size_t i = 0; i < plan->size; i++)
+    {
+        struct computational_graph_node *node = plan->nodes[i];
+        for (size_t j = 0; j < node->n_children; j++)
+        {
+            struct computational_graph_node *child_node = node->children[j];
+            if (!child_node->t->requires_grad)
+            {
+                plan->edge_gradients[i][j] = NULL;
+                plan->edge_accumulates[i][j] = false;
+                continue;
+            }
+
+            /**
+             * The first gradient reaching an intermediate tensor is written directly into its gradient,
+             * which is overwritten at each replay. Leaf gradients accumulate across steps, as in backward(),
+             * so their contributions go through a temporary buffer.
+             */
+            if (!child_node->is_leaf && child_node->pushed_gradients_count == 0)
+            {
+                plan->edge_gradients[i][j] = child_node->t->grad;
+                plan->edge_accumulates[i][j] = false;
+            }
+            else
+            {
+                struct tensor *temporary = execution_plan_get_temporary(plan, child_node->t);
+                if (!temporary)
+                {
+                    return TENSOR_ALLOCATION_FAILED;
+                }
+                plan->edge_gradients[i][j] = temporary;
+                plan->edge_accumulates[i][j] = true;
+            }
+
+            child_node->pushed_gradients_count++;
+        }
+    }
+
+    for (size_t i = 0; i < plan->size; i++)
+    {
+        plan->nodes[i]->pushed_gradients_count = 0;
+    }
+
+    return NO_ERROR;
+}
+
+static struct tensor *execution_plan_get_temporary(struct execution_plan *const plan, const struct tensor *const t)
+{
+    // Temporaries only live within a single backpropagation function call, so they are shared by shape
+    for (size_t i = 0; i < plan->n_temporaries; i++)
+    {
+        struct tensor *temporary = plan->temporaries[i];
+        if (temporary->dtype == t->dtype && tensor_same_shape(temporary, t))
+        {
+            return temporary;
+        }
+    }
+
+    if (plan->n_temporaries >= AUTOGRAD_MAX_NODES)
+    {
+        return NULL;
+    }
+
+    struct tensor *temporary = tensor_allocator_no_grad_alloc(&plan->env->tensor_alloc, t->shape, t->shape_size, t->dtype);
+    if (!temporary)
+    {
+        return NULL;
+    }
+
+    plan->temporaries[plan->n_temporaries++] = temporary;
+    return temporary;
+}
+
+/**
+ * @brief Frees what a failed capture allocated, as execution_plan_cleanup only releases captured plans. The gradients
+ * of the tensors are kept, they are owned by the tensors.
+ */
+static void execution_plan_capture_rollback(struct execution_plan *const plan)
+{
+    for (size_t i = 0; i < plan->n_temporaries; i++)
+    {
+        tensor_allocator_free(&plan->env->tensor_alloc, plan->temporaries[i]);
+    }
+    plan->n_temporaries = 0;
+
+    // The graph is left as recorded, so that it can still be backpropagated eagerly
+    for (size_t i = 0; i < plan->size; i++)
+    {
+        plan->nodes[i]->pushed_gradients_count = 0;
+    }
+
+    if (plan->intermediates)
+    {
+        tensor_list_free(plan->intermediates);
+        plan->intermediates = NULL;
+    }
+}
+
+static cgrad_error execution_plan_take_intermediates(struct execution_plan *const plan)
+{
+    struct tensor_list *env_intermediates = plan->env->tensor_alloc_intermediates;
+
+    const size_t capacity = env_intermediates->size > 0 ? env_intermediates->size : 1;
+    plan->intermediates = tensor_list_alloc(capacity);
+    if (!plan->intermediates)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    memcpy(plan->intermediates->data, env_intermediates->data, env_intermediates->size * sizeof(struct tensor *));
+    plan->intermediates->size = env_intermediates->size;
+    env_intermediates->size = 0;
+
+    return NO_ERROR;
+}
+
+static cgrad_error execution_plan_backward(struct execution_plan *const plan)
+{
+    cgrad_error err = NO_ERROR;
+
+    for (size_t i = 0; i < plan->size; i++)
+    {
+        struct computational_graph_node *node = plan->nodes[i];
+        for (size_t j = 0; j < node->n_children; j++)
+        {
+            struct computational_graph_node *child_node = node->children[j];
+            struct tensor *gradient = plan->edge_gradients[i][j];
+            const size_t operand = node->children_operands[j];
+            if (!gradient)
+            {
+                continue;
+            }
+
+            if ((err = node->function[operand](&node->ctx, node->t->grad, gradient)) != NO_ERROR)
+            {
+                return err;
+            }
+
+            if (plan->edge_accumulates[i][j])
+            {
+                if ((err = tensor_add_inplace(child_node->t->grad, gradient)) != NO_ERROR)
+                {
+                    return err;
+                }
+            }
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static inline cgrad_error execution_plan_seed_loss_gradient(struct execution_plan *const plan)
+{
+    struct tensor *grad = plan->loss->grad;
+    switch (grad->dtype)
+    {
+        case DTYPE_FLOAT64:
+            return tensor2d_set(grad, 0, 0, (double)1.0);
+        case DTYPE_FLOAT32:
+            return tensor2d_set(grad, 0, 0, (float)1.0);
+        default:
+            return AUTOGRAD_BACKPROPAGATION_INVALID_TENSOR_DTYPE;
+    }
+}
@@ -0,0 +1,361 @@
+#include "cgrad/autograd/execution_plan/execution_plan_memory.h"
+#include <stdint.h>
+
+#define NO_INTERVAL SIZE_MAX
+
+struct planned_interval
+{
+    struct tensor *t;
+    size_t start;
+    size_t end;
+    size_t bytes;
+    size_t inplace_interval;
+    size_t buffer;
+};
+
+struct planned_buffer
+{
+    size_t bytes;
+    size_t end;
+};
+
+static size_t execution_plan_collect_intervals(const struct execution_plan *const plan, struct planned_interval *const intervals);
+static void execution_plan_node_uses(const struct execution_plan *const plan, const size_t k, size_t *const last_use, size_t *const first_gradient);
+static size_t execution_plan_color_intervals(struct planned_interval *const intervals, const size_t n_intervals, struct planned_buffer *const buffers);
+static size_t execution_plan_peak_live_bytes(const struct execution_plan *const plan, const struct planned_interval *const intervals, const size_t n_intervals);
+static inline void planned_interval_init(struct planned_interval *const interval, struct tensor *const t, const size_t start, const size_t end);
+static inline size_t execution_plan_forward_step(const struct execution_plan *const plan, const size_t i);
+static inline size_t execution_plan_backward_step(const struct execution_plan *const plan, const size_t i);
+
+cgrad_error execution_plan_plan_memory(struct execution_plan *const plan, struct execution_plan_memory_stats *const stats)
+{
+    if (!plan)
+    {
+        return EXECUTION_PLAN_NULL;
+    }
+    if (!plan->is_captured)
+    {
+        return EXECUTION_PLAN_NOT_CAPTURED;
+    }
+    if (plan->n_buffers > 0)
+    {
+        return EXECUTION_PLAN_MEMORY_ALREADY_PLANNED;
+    }
+
+    struct planned_interval intervals[EXECUTION_PLAN_MAX_PLANNED_TENSORS];
+    struct planned_buffer buffers[EXECUTION_PLAN_MAX_PLANNED_TENSORS];
+
+    const size_t n_intervals = execution_plan_collect_intervals(plan, intervals);
+    const size_t n_buffers = execution_plan_color_intervals(intervals, n_intervals, buffers);
+
+    struct tensor_allocator *tensor_alloc = &plan->env->tensor_alloc;
+    for (size_t i = 0; i < n_buffers; i++)
+    {
+        plan->buffers[i] = tensor_allocator_data_alloc(tensor_alloc, buffers[i].bytes);
+        if (!plan->buffers[i])
+        {
+            for (size_t j = 0; j < i; j++)
+            {
+                tensor_allocator_data_free(tensor_alloc, plan->buffers[j]);
+            }
+            return EXECUTION_PLAN_BUFFER_ALLOCATION_FAILED;
+        }
+    }
+    plan->n_buffers = n_buffers;
+
+    size_t naive_bytes = 0;
+    for (size_t i = 0; i < n_intervals; i++)
+    {
+        struct tensor *t = intervals[i].t;
+        tensor_allocator_data_free(tensor_alloc, t->data);
+        t->data = plan->buffers[intervals[i].buffer];
+
+        plan->planned_tensors[i] = t;
+        naive_bytes += intervals[i].bytes;
+    }
+    plan->n_planned_tensors = n_intervals;
+
+    if (stats)
+    {
+        stats->naive_bytes = naive_bytes;
+        stats->planned_bytes = 0;
+        for (size_t i = 0; i < n_buffers; i++)
+        {
+            stats->planned_bytes += buffers[i].bytes;
+        }
+        stats->peak_live_bytes = execution_plan_peak_live_bytes(plan, intervals, n_intervals);
+        stats->n_tensors = n_intervals;
+        stats->n_buffers = n_buffers;
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error execution_plan_release_memory(struct execution_plan *const plan)
+{
+    if (!plan)
+    {
+        return EXECUTION_PLAN_NULL;
+    }
+
+    /**
+     * Planned tensors are freed by their owner, which expects them to own their data. Their buffers are allocated
+     * before the shared ones are freed, so that a failure leaves the plan as it was.
+     */
+    struct tensor_allocator *tensor_alloc = &plan->env->tensor_alloc;
+    void *data[EXECUTION_PLAN_MAX_PLANNED_TENSORS];
+    for (size_t i = 0; i < plan->n_planned_tensors; i++)
+    {
+        const struct tensor *t = plan->planned_tensors[i];
+        data[i] = tensor_allocator_data_alloc(tensor_alloc, t->data_size * dtype_sizeof(t->dtype));
+        if (!data[i])
+        {
+            while (i-- > 0)
+            {
+                tensor_allocator_data_free(tensor_alloc, data[i]);
+            }
+            return TENSOR_ALLOCATION_FAILED;
+        }
+    }
+
+    for (size_t i = 0; i < plan->n_buffers; i++)
+    {
+        tensor_allocator_data_free(tensor_alloc, plan->buffers[i]);
+    }
+    for (size_t i = 0; i < plan->n_planned_tensors; i++)
+    {
+        plan->planned_tensors[i]->data = data[i];
+    }
+
+    plan->n_buffers = 0;
+    plan->n_planned_tensors = 0;
+
+    return NO_ERROR;
+}
+
+static size_t execution_plan_collect_intervals(const struct execution_plan *const plan, struct planned_interval *const intervals)
+{
+    size_t n_intervals = 0;
+
+    /**
+     * Interval of the tensor of each node, if planned. The loss (first node) is never planned, as its value
+     * is read by the caller after each replay and its gradient is the seed of the backward pass.
+     */
+    size_t output_intervals[AUTOGRAD_MAX_NODES];
+    for (size_t k = 0; k < plan->size; k++)
+    {
+        output_intervals[k] = NO_INTERVAL;
+    }
+
+    // Visit nodes in forward order, so that the operands of a node are planned before it
+    for (size_t k = plan->size; k-- > 1;)
+    {
+        struct computational_graph_node *node = plan->nodes[k];
+        if (node->is_leaf)
+        {
+            continue;
+        }
+
+        size_t last_use = execution_plan_forward_step(plan, k);
+        size_t first_gradient = execution_plan_backward_step(plan, k);
+        execution_plan_node_uses(plan, k, &last_use, &first_gradient);
+
+        struct planned_interval *output = &intervals[n_intervals];
+        planned_interval_init(output, node->t, execution_plan_forward_step(plan, k), last_use);
+        output_intervals[k] = n_intervals++;
+
+        if (node->forward_inplace)
+        {
+            for (size_t j = 0; j < node->n_children; j++)
+            {
+                if (node->children_operands[j] != 0)
+                {
+                    continue;
+                }
+                for (size_t c = k + 1; c < plan->size; c++)
+                {
+                    if (plan->nodes[c] == node->children[j])
+                    {
+                        output->inplace_interval = output_intervals[c];
+                        break;
+                    }
+                }
+            }
+        }
+
+        // The gradient is written by the first parent and read by the backward step of the node itself
+        if (node->t->requires_grad)
+        {
+            planned_interval_init(&intervals[n_intervals++], node->t->grad, first_gradient, execution_plan_backward_step(plan, k));
+        }
+    }
+
+    // Temporaries live across the backward steps of the edges using them
+    for (size_t t = 0; t < plan->n_temporaries; t++)
+    {
+        size_t start = NO_INTERVAL;
+        size_t end = 0;
+        for (size_t i = 0; i < plan->size; i++)
+        {
+            const struct computational_graph_node *node = plan->nodes[i];
+            for (size_t j = 0; j < node->n_children; j++)
+            {
+                if (plan->edge_accumulates[i][j] && plan->edge_gradients[i][j] == plan->temporaries[t])
+                {
+                    const size_t step = execution_plan_backward_step(plan, i);
+                    start = step < start ? step : start;
+                    end = step > end ? step : end;
+                }
+            }
+        }
+
+        if (start != NO_INTERVAL)
+        {
+            planned_interval_init(&intervals[n_intervals++], plan->temporaries[t], start, end);
+        }
+    }
+
+    return n_intervals;
+}
+
+static void execution_plan_node_uses(const struct execution_plan *const plan, const size_t k, size_t *const last_use, size_t *const first_gradient)
+{
+    // Parents precede their children in topological order
+    for (size_t i = 0; i < k; i++)
+    {
+        const struct computational_graph_node *parent = plan->nodes[i];
+        for (size_t j = 0; j < parent->n_children; j++)
+        {
+            if (parent->children[j] != plan->nodes[k])
+            {
+                continue;
+            }
+
+            const size_t forward_step = execution_plan_forward_step(plan, i);
+            const size_t backward_step = execution_plan_backward_step(plan, i);
+
+            *last_use = forward_step > *last_use ? forward_step : *last_use;
+            if (parent->backward_reads_operands)
+            {
+                *last_use = backward_step > *last_use ? backward_step : *last_use;
+            }
+            *first_gradient = backward_step < *first_gradient ? backward_step : *first_gradient;
+        }
+    }
+}
+
+static size_t execution_plan_color_intervals(struct planned_interval *const intervals, const size_t n_intervals, struct planned_buffer *const buffers)
+{
+    // Sort by start step, insertion sort is enough for the few hundred intervals of a plan
+    size_t order[EXECUTION_PLAN_MAX_PLANNED_TENSORS];
+    for (size_t i = 0; i < n_intervals; i++)
+    {
+        size_t j = i;
+        while (j > 0 && intervals[order[j - 1]].start > intervals[i].start)
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    size_t n_buffers = 0;
+    for (size_t o = 0; o < n_intervals; o++)
+    {
+        struct planned_interval *interval = &intervals[order[o]];
+
+        /**
+         * An in-place operation takes over the buffer of its operand when it is the last reader of it, that is
+         * when the operand lifetime ends exactly where the output lifetime starts.
+         */
+        if (interval->inplace_interval != NO_INTERVAL)
+        {
+            const struct planned_interval *operand = &intervals[interval->inplace_interval];
+            struct planned_buffer *buffer = &buffers[operand->buffer];
+            if (operand->end == interval->start && buffer->end == operand->end)
+            {
+                interval->buffer = operand->buffer;
+                buffer->end = interval->end;
+                buffer->bytes = interval->bytes > buffer->bytes ? interval->bytes : buffer->bytes;
+                continue;
+            }
+        }
+
+        // Best fit among the free buffers, otherwise grow the largest free buffer
+        size_t best_fit = NO_INTERVAL;
+        size_t largest = NO_INTERVAL;
+        for (size_t b = 0; b < n_buffers; b++)
+        {
+            if (buffers[b].end >= interval->start)
+            {
+                continue;
+            }
+            if (buffers[b].bytes >= interval->bytes && (best_fit == NO_INTERVAL || buffers[b].bytes < buffers[best_fit].bytes))
+            {
+                best_fit = b;
+            }
+            if (largest == NO_INTERVAL || buffers[b].bytes > buffers[largest].bytes)
+            {
+                largest = b;
+            }
+        }
+
+        size_t b = best_fit != NO_INTERVAL ? best_fit : largest;
+        if (b == NO_INTERVAL)
+        {
+            b = n_buffers++;
+            buffers[b].bytes = 0;
+        }
+
+        interval->buffer = b;
+        buffers[b].end = interval->end;
+        buffers[b].bytes = interval->bytes > buffers[b].bytes ? interval->bytes : buffers[b].bytes;
+    }
+
+    return n_buffers;
+}
+
+static size_t execution_plan_peak_live_bytes(const struct execution_plan *const plan, const struct planned_interval *const intervals, const size_t n_intervals)
+{
+    size_t peak = 0;
+    for (size_t step = 0; step < 2 * plan->size; step++)
+    {
+        size_t live = 0;
+        for (size_t i = 0; i < n_intervals; i++)
+        {
+            // An in-place output shares the step it is produced in with its operand
+            const bool is_inplace = intervals[i].inplace_interval != NO_INTERVAL && intervals[i].buffer == intervals[intervals[i].inplace_interval].buffer;
+            if (intervals[i].start <= step && step <= intervals[i].end && !(is_inplace && intervals[i].start == step))
+            {
+                live += intervals[i].bytes;
+            }
+        }
+        peak = live > peak ? live : peak;
+    }
+
+    return peak;
+}
+
+static inline void planned_interval_init(struct planned_interval *const interval, struct tensor *const t, const size_t start, const size_t end)
+{
+    interval->t = t;
+    interval->start = start;
+    interval->end = end;
+    interval->bytes = t->data_size * dtype_sizeof(t->dtype);
+    interval->inplace_interval = NO_INTERVAL;
+    interval->buffer = NO_INTERVAL;
+}
+
+/**
+ * A replay is a sequence of 2 * plan->size steps: the forward steps, in reverse topological order, followed
+ * by the backward steps, in topological order.
+ */
+static inline size_t execution_plan_forward_step(const struct execution_plan *const plan, const size_t i)
+{
+    return plan->size - 1 - i;
+}
+
+static inline size_t execution_plan_backward_step(const struct execution_plan *const plan, const size_t i)
+{
+    return plan->size + i;
+}
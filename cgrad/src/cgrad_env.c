@@ -3,10 +3,42 @@
 #include "cgrad/tensor/tensor_alloc.h"
 #include "cgrad/memory/tensor/cpu/tensor_cpu_allocator.h"
 #include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
+#include <stdlib.h>
 
 cgrad_error cgrad_env_init(struct cgrad_env *env, const unsigned int seed, const size_t intermediates_capacity)
 {
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+
     init_random_seed(seed);
+    env->seed = seed;
+
+    cgrad_error err = cgrad_env_context_init(env, intermediates_capacity);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    philox_init(&env->rng, seed);
+
+    err = cgrad_env_set_num_threads(env, thread_pool_default_size());
+    if (err != NO_ERROR)
+    {
+        cgrad_env_cleanup(env);
+        return err;
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error cgrad_env_context_init(struct cgrad_env *env, const size_t intermediates_capacity)
+{
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
 
     cgrad_error err = NO_ERROR;
     err = tensor_cpu_allocator_init(&env->tensor_alloc);
@@ -24,9 +56,15 @@ cgrad_error cgrad_env_init(struct cgrad_env *env, const unsigned int seed, const
     env->tensor_alloc_intermediates = tensor_list_alloc(intermediates_capacity);
     if (!env->tensor_alloc_intermediates)
     {
+        err = TENSOR_ALLOCATION_FAILED;
         goto tensor_intermediates_allocation_failed;
     }
 
+    checkpoint_state_init(&env->checkpoint);
+    env->grad_hook = (struct gradient_hook){NULL, NULL};
+    philox_init(&env->rng, 0);
+    env->pool = NULL;
+
     return NO_ERROR;
 
 tensor_intermediates_allocation_failed:
@@ -37,8 +75,52 @@ tensor_allocator_init_fail:
     return err;
 }
 
+cgrad_error cgrad_env_set_num_threads(struct cgrad_env *env, const size_t n_threads)
+{
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (n_threads == 0)
+    {
+        return THREAD_POOL_INIT_FAILED;
+    }
+
+    if (env->pool)
+    {
+        thread_pool_cleanup(env->pool);
+        free(env->pool);
+        env->pool = NULL;
+    }
+    if (n_threads == 1)
+    {
+        return NO_ERROR;
+    }
+
+    env->pool = malloc(sizeof(struct thread_pool));
+    if (!env->pool)
+    {
+        return THREAD_POOL_INIT_FAILED;
+    }
+
+    cgrad_error err = thread_pool_init(env->pool, n_threads);
+    if (err != NO_ERROR)
+    {
+        free(env->pool);
+        env->pool = NULL;
+    }
+
+    return err;
+}
+
 void cgrad_env_cleanup(struct cgrad_env *env)
 {
+    if (env->pool)
+    {
+        thread_pool_cleanup(env->pool);
+        free(env->pool);
+        env->pool = NULL;
+    }
     computational_graph_cpu_allocator_cleanup(&env->graph_alloc);
     tensor_cpu_allocator_cleanup(&env->tensor_alloc);
     tensor_list_free(env->tensor_alloc_intermediates);
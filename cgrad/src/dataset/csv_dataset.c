@@ -1,5 +1,8 @@
 #include "cgrad/dataset/csv_dataset.h"
 #include "cgrad/config.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -59,6 +62,27 @@ static size_t csv_dataset_count_cols(FILE *file);
  */
 static cgrad_error csv_dataset_fill_data(struct csv_dataset *dataset, FILE *file);
 
+struct csv_dataset_copy_args
+{
+    const struct csv_dataset *dataset;
+    struct tensor *inputs;
+    struct tensor *targets;
+    const struct indexes_batch *ixs_batch;
+};
+
+struct csv_dataset_sparse_copy_args
+{
+    const struct csv_dataset *dataset;
+    struct sparse_tensor *inputs;
+    struct tensor *targets;
+    const struct indexes_batch *ixs_batch;
+    int32_t *row_ptrs;
+};
+
+static cgrad_error csv_dataset_sample_batch_parallel(const struct csv_dataset *const dataset, struct tensor *const inputs, struct tensor *const targets, const struct indexes_batch *const ixs_batch, struct thread_pool *const pool);
+static void csv_dataset_copy_rows(void *arg, const size_t begin, const size_t end);
+static void csv_dataset_count_row_values(void *arg, const size_t begin, const size_t end);
+static void csv_dataset_copy_sparse_rows(void *arg, const size_t begin, const size_t end);
 static void copy_features_to_inputs(struct tensor *inputs, double *features, const size_t i, const size_t cols);
 static void copy_features_to_inputs_f64(struct tensor *inputs, double *features, const size_t i, const size_t cols);
 static void copy_features_to_inputs_f32(struct tensor *inputs, double *features, const size_t i, const size_t cols);
@@ -147,22 +171,183 @@ cgrad_error csv_dataset_sample_batch(const struct csv_dataset *const dataset, st
         return TENSOR_ALLOCATION_FAILED;
     }
 
-    for (size_t i = 0; i < ixs_batch->size; i++)
+    // Samples are data, no gradient is computed for them
+    tensor_set_requires_grad(*inputs, false);
+    tensor_set_requires_grad(*targets, false);
+
+    return csv_dataset_sample_batch_parallel(dataset, *inputs, *targets, ixs_batch, env->pool);
+}
+
+cgrad_error csv_dataset_sample_batch_into(const struct csv_dataset *const dataset, struct tensor *const inputs, struct tensor *const targets, const struct indexes_batch *const ixs_batch)
+{
+    return csv_dataset_sample_batch_parallel(dataset, inputs, targets, ixs_batch, NULL);
+}
+
+static cgrad_error csv_dataset_sample_batch_parallel(const struct csv_dataset *const dataset, struct tensor *const inputs, struct tensor *const targets, const struct indexes_batch *const ixs_batch, struct thread_pool *const pool)
+{
+    cgrad_error error;
+    if ((error = csv_dataset_check_null(dataset)) != NO_ERROR)
+    {
+        return error;
+    }
+    if (!ixs_batch)
+    {
+        return INDEXES_BATCH_NULL;
+    }
+    if (!inputs || !targets)
+    {
+        return TENSOR_NULL;
+    }
+
+    size_t cols = dataset->cols;
+    if (inputs->shape_size != 2 || inputs->shape[0] != ixs_batch->size || inputs->shape[1] != cols - 1)
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+    if (targets->shape_size != 2 || targets->shape[0] != ixs_batch->size || targets->shape[1] != 1)
     {
-        size_t row_idx = ixs_batch->indexes[i];
+        return TENSOR_SHAPE_MISMATCH;
+    }
+
+    struct csv_dataset_copy_args args = {.dataset = dataset, .inputs = inputs, .targets = targets, .ixs_batch = ixs_batch};
+    thread_pool_parallel_for(pool, ixs_batch->size, thread_pool_grain(cols), &csv_dataset_copy_rows, &args);
 
-        double *csv_row = dataset->data + row_idx * cols;
+    return NO_ERROR;
+}
+
+static void csv_dataset_copy_rows(void *arg, const size_t begin, const size_t end)
+{
+    const struct csv_dataset_copy_args *args = arg;
+    const size_t cols = args->dataset->cols;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        size_t row_idx = args->ixs_batch->indexes[i];
+
+        double *csv_row = args->dataset->data + row_idx * cols;
         double label = csv_row[0];
         double *features = csv_row + 1;
 
         // Copy features to inputs
-        copy_features_to_inputs(*inputs, features, i, cols);
-        copy_label_to_targets(*targets, label, i);
+        copy_features_to_inputs(args->inputs, features, i, cols);
+        copy_label_to_targets(args->targets, label, i);
     }
+}
+
+cgrad_error csv_dataset_sample_batch_sparse(const struct csv_dataset *const dataset, struct sparse_tensor *const inputs, struct tensor **const targets, const struct indexes_batch *const ixs_batch, const cgrad_dtype dtype, struct cgrad_env *const env)
+{
+    cgrad_error err = csv_dataset_check_null(dataset);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+    if (!ixs_batch)
+    {
+        return INDEXES_BATCH_NULL;
+    }
+    if (!inputs)
+    {
+        return SPARSE_TENSOR_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+
+    const size_t batch_size = ixs_batch->size;
+    const size_t cols = dataset->cols;
+
+    // The values of each row are counted first, their prefix sum giving the offsets of the rows
+    int32_t *row_ptrs = malloc((batch_size + 1) * sizeof(int32_t));
+    if (!row_ptrs)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+    struct csv_dataset_sparse_copy_args args = {.dataset = dataset, .inputs = inputs, .targets = NULL, .ixs_batch = ixs_batch, .row_ptrs = row_ptrs};
+    thread_pool_parallel_for(env->pool, batch_size, thread_pool_grain(cols), &csv_dataset_count_row_values, &args);
+
+    row_ptrs[0] = 0;
+    for (size_t i = 0; i < batch_size; i++)
+    {
+        row_ptrs[i + 1] += row_ptrs[i];
+    }
+
+    err = sparse_tensor_alloc(inputs, batch_size, cols - 1, (size_t)row_ptrs[batch_size], dtype, env);
+    if (err != NO_ERROR)
+    {
+        free(row_ptrs);
+        return err;
+    }
+    memcpy(inputs->row_ptrs->data, row_ptrs, (batch_size + 1) * sizeof(int32_t));
+    free(row_ptrs);
+
+    const size_t COLUMN_VECTOR_COLS = 1;
+    size_t targets_shape[] = {batch_size, COLUMN_VECTOR_COLS};
+    (*targets) = tensor_allocator_alloc(&env->tensor_alloc, targets_shape, sizeof(targets_shape) / sizeof(size_t), dtype);
+    if (!(*targets))
+    {
+        sparse_tensor_free(inputs, env);
+        return TENSOR_ALLOCATION_FAILED;
+    }
+    tensor_set_requires_grad(*targets, false);
+
+    args.targets = *targets;
+    args.row_ptrs = inputs->row_ptrs->data;
+    thread_pool_parallel_for(env->pool, batch_size, thread_pool_grain(cols), &csv_dataset_copy_sparse_rows, &args);
 
     return NO_ERROR;
 }
 
+static void csv_dataset_count_row_values(void *arg, const size_t begin, const size_t end)
+{
+    const struct csv_dataset_sparse_copy_args *args = arg;
+    const size_t cols = args->dataset->cols;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const double *features = args->dataset->data + args->ixs_batch->indexes[i] * cols + 1;
+        int32_t count = 0;
+        for (size_t j = 0; j < cols - 1; j++)
+        {
+            count += features[j] != 0.0;
+        }
+        args->row_ptrs[i + 1] = count;
+    }
+}
+
+static void csv_dataset_copy_sparse_rows(void *arg, const size_t begin, const size_t end)
+{
+    const struct csv_dataset_sparse_copy_args *args = arg;
+    const size_t cols = args->dataset->cols;
+    int32_t *col_indexes = args->inputs->col_indexes->data;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const double *csv_row = args->dataset->data + args->ixs_batch->indexes[i] * cols;
+        const double *features = csv_row + 1;
+
+        int32_t k = args->row_ptrs[i];
+        for (size_t j = 0; j < cols - 1; j++)
+        {
+            if (features[j] == 0.0)
+            {
+                continue;
+            }
+            if (args->inputs->values->dtype == DTYPE_FLOAT64)
+            {
+                ((double *)args->inputs->values->data)[k] = features[j];
+            }
+            else
+            {
+                ((float *)args->inputs->values->data)[k] = (float)features[j];
+            }
+            col_indexes[k++] = (int32_t)j;
+        }
+
+        copy_label_to_targets(args->targets, csv_row[0], i);
+    }
+}
+
 cgrad_error csv_dataset_standard_scale(struct csv_dataset *dataset)
 {
     cgrad_error error;
@@ -0,0 +1,854 @@
+#include "cgrad/gemm/gemm.h"
+#include "cgrad/utils/simd_support.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CGRAD_USE_BLAS
+#include <cblas.h>
+#endif
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+#include <immintrin.h>
+#endif
+
+/**
+ * The output is computed in tiles of GEMM_MR rows and NR columns, accumulated in registers by the micro kernel.
+ * Its operands are packed so that the kernel reads them sequentially: a block of GEMM_*_MC rows and GEMM_KC
+ * reduction indexes of A, sized for the L2 cache, in strips of GEMM_MR rows, and a panel of GEMM_KC reduction
+ * indexes and GEMM_*_NC columns of B in strips of NR columns, each of which fits the L1 cache.
+ */
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256 && defined(__AVX512F__)
+#define GEMM_VEC_F32 __m512
+#define GEMM_VEC_F64 __m512d
+#define GEMM_F32_LANES 16
+#define GEMM_F64_LANES 8
+#define GEMM_ZERO_PS() _mm512_setzero_ps()
+#define GEMM_ZERO_PD() _mm512_setzero_pd()
+#define GEMM_LOAD_PS(p) _mm512_load_ps(p)
+#define GEMM_LOAD_PD(p) _mm512_load_pd(p)
+#define GEMM_LOADU_PS(p) _mm512_loadu_ps(p)
+#define GEMM_LOADU_PD(p) _mm512_loadu_pd(p)
+#define GEMM_STOREU_PS(p, v) _mm512_storeu_ps(p, v)
+#define GEMM_STOREU_PD(p, v) _mm512_storeu_pd(p, v)
+#define GEMM_SET1_PS(x) _mm512_set1_ps(x)
+#define GEMM_SET1_PD(x) _mm512_set1_pd(x)
+#define GEMM_ADD_PS(a, b) _mm512_add_ps(a, b)
+#define GEMM_ADD_PD(a, b) _mm512_add_pd(a, b)
+#define GEMM_FMADD_PS(a, b, c) _mm512_fmadd_ps(a, b, c)
+#define GEMM_FMADD_PD(a, b, c) _mm512_fmadd_pd(a, b, c)
+#elif SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+#define GEMM_VEC_F32 __m256
+#define GEMM_VEC_F64 __m256d
+#define GEMM_F32_LANES 8
+#define GEMM_F64_LANES 4
+#define GEMM_ZERO_PS() _mm256_setzero_ps()
+#define GEMM_ZERO_PD() _mm256_setzero_pd()
+#define GEMM_LOAD_PS(p) _mm256_load_ps(p)
+#define GEMM_LOAD_PD(p) _mm256_load_pd(p)
+#define GEMM_LOADU_PS(p) _mm256_loadu_ps(p)
+#define GEMM_LOADU_PD(p) _mm256_loadu_pd(p)
+#define GEMM_STOREU_PS(p, v) _mm256_storeu_ps(p, v)
+#define GEMM_STOREU_PD(p, v) _mm256_storeu_pd(p, v)
+#define GEMM_SET1_PS(x) _mm256_set1_ps(x)
+#define GEMM_SET1_PD(x) _mm256_set1_pd(x)
+#define GEMM_ADD_PS(a, b) _mm256_add_ps(a, b)
+#define GEMM_ADD_PD(a, b) _mm256_add_pd(a, b)
+#ifdef __FMA__
+#define GEMM_FMADD_PS(a, b, c) _mm256_fmadd_ps(a, b, c)
+#define GEMM_FMADD_PD(a, b, c) _mm256_fmadd_pd(a, b, c)
+#else
+#define GEMM_FMADD_PS(a, b, c) _mm256_add_ps(_mm256_mul_ps(a, b), c)
+#define GEMM_FMADD_PD(a, b, c) _mm256_add_pd(_mm256_mul_pd(a, b), c)
+#endif
+#endif
+
+#ifdef GEMM_VEC_F32
+#define GEMM_MR 6
+#define GEMM_F32_NR (2 * GEMM_F32_LANES)
+#define GEMM_F64_NR (2 * GEMM_F64_LANES)
+#else
+#define GEMM_MR 4
+#define GEMM_F32_NR 8
+#define GEMM_F64_NR 4
+#endif
+
+#define GEMM_KC 256
+#define GEMM_F32_MC 96
+#define GEMM_F64_MC 48
+#define GEMM_F32_NC 4096
+#define GEMM_F64_NC 2048
+
+// Alignment in bytes of the packed operands, at least the size of a vector
+#define GEMM_BUFFER_ALIGNMENT 64
+
+struct gemm_pack_f32
+{
+    const float *src;
+    size_t ld;
+    bool along_k;             /**< Whether consecutive reduction indexes are contiguous in src. */
+    size_t offset;            /**< First row of A or column of B. */
+    size_t size;              /**< Number of rows of A or columns of B. */
+    size_t k_offset;
+    size_t kc;
+    size_t width;             /**< Rows or columns per strip. */
+    float *dst;
+};
+
+struct gemm_pack_f64
+{
+    const double *src;
+    size_t ld;
+    bool along_k;
+    size_t offset;
+    size_t size;
+    size_t k_offset;
+    size_t kc;
+    size_t width;
+    double *dst;
+};
+
+struct gemm_macro_f32
+{
+    const float *a_packed;
+    const float *b_packed;
+    size_t mc;
+    size_t nc;
+    size_t kc;
+    float *c;
+    size_t ldc;
+    bool accumulate;          /**< Whether the tiles are added to c, for all but the first block of reduction indexes. */
+};
+
+struct gemm_macro_f64
+{
+    const double *a_packed;
+    const double *b_packed;
+    size_t mc;
+    size_t nc;
+    size_t kc;
+    double *c;
+    size_t ldc;
+    bool accumulate;
+};
+
+static pthread_once_t gemm_backend_once = PTHREAD_ONCE_INIT;
+static atomic_int gemm_backend_current = GEMM_BACKEND_NATIVE;
+
+static void gemm_backend_init(void);
+static cgrad_error gemm_packed_b_reserve(struct gemm_packed_b *const packed, const size_t size);
+static void *gemm_buffer_alloc(const size_t size);
+static inline size_t gemm_round_up(const size_t x, const size_t multiple);
+static cgrad_error gemm_native_f32(const gemm_transpose trans_a, const gemm_transpose trans_b, const size_t m, const size_t n, const size_t k, const float *const a, const size_t lda, const float *const b, const size_t ldb, const float *const b_prepacked, float *const c, const size_t ldc, struct thread_pool *const pool);
+static cgrad_error gemm_native_f64(const gemm_transpose trans_a, const gemm_transpose trans_b, const size_t m, const size_t n, const size_t k, const double *const a, const size_t lda, const double *const b, const size_t ldb, const double *const b_prepacked, double *const c, const size_t ldc, struct thread_pool *const pool);
+static void gemm_pack_f32_strips(void *arg, const size_t begin, const size_t end);
+static void gemm_pack_f64_strips(void *arg, const size_t begin, const size_t end);
+static void gemm_macro_f32_strips(void *arg, const size_t begin, const size_t end);
+static void gemm_macro_f64_strips(void *arg, const size_t begin, const size_t end);
+static void gemm_kernel_f32(const size_t kc, const size_t rows, const float *restrict a, const float *restrict b, float *restrict c, const size_t ldc, const bool accumulate);
+static void gemm_kernel_f64(const size_t kc, const size_t rows, const double *restrict a, const double *restrict b, double *restrict c, const size_t ldc, const bool accumulate);
+
+cgrad_error gemm_set_backend(const gemm_backend backend)
+{
+    pthread_once(&gemm_backend_once, &gemm_backend_init);
+
+#ifndef CGRAD_USE_BLAS
+    if (backend == GEMM_BACKEND_BLAS)
+    {
+        return GEMM_BACKEND_UNAVAILABLE;
+    }
+#endif
+
+    atomic_store_explicit(&gemm_backend_current, backend, memory_order_relaxed);
+    return NO_ERROR;
+}
+
+gemm_backend gemm_get_backend(void)
+{
+    pthread_once(&gemm_backend_once, &gemm_backend_init);
+    return (gemm_backend)atomic_load_explicit(&gemm_backend_current, memory_order_relaxed);
+}
+
+cgrad_error gemm_f32(const gemm_transpose trans_a, const gemm_transpose trans_b, const size_t m, const size_t n, const size_t k, const float *const a, const size_t lda, const float *const b, const size_t ldb, float *const c, const size_t ldc, struct thread_pool *const pool)
+{
+#ifdef CGRAD_USE_BLAS
+    if (gemm_get_backend() == GEMM_BACKEND_BLAS)
+    {
+        cblas_sgemm(
+            CblasRowMajor,
+            trans_a == GEMM_TRANS ? CblasTrans : CblasNoTrans,
+            trans_b == GEMM_TRANS ? CblasTrans : CblasNoTrans,
+            m, n, k,
+            1.0f,
+            a, lda,
+            b, ldb,
+            0.0f,
+            c, ldc);
+
+        return NO_ERROR;
+    }
+#endif
+
+    return gemm_native_f32(trans_a, trans_b, m, n, k, a, lda, b, ldb, NULL, c, ldc, pool);
+}
+
+cgrad_error gemm_f64(const gemm_transpose trans_a, const gemm_transpose trans_b, const size_t m, const size_t n, const size_t k, const double *const a, const size_t lda, const double *const b, const size_t ldb, double *const c, const size_t ldc, struct thread_pool *const pool)
+{
+#ifdef CGRAD_USE_BLAS
+    if (gemm_get_backend() == GEMM_BACKEND_BLAS)
+    {
+        cblas_dgemm(
+            CblasRowMajor,
+            trans_a == GEMM_TRANS ? CblasTrans : CblasNoTrans,
+            trans_b == GEMM_TRANS ? CblasTrans : CblasNoTrans,
+            m, n, k,
+            1.0,
+            a, lda,
+            b, ldb,
+            0.0,
+            c, ldc);
+
+        return NO_ERROR;
+    }
+#endif
+
+    return gemm_native_f64(trans_a, trans_b, m, n, k, a, lda, b, ldb, NULL, c, ldc, pool);
+}
+
+void gemm_packed_b_init(struct gemm_packed_b *const packed)
+{
+    packed->k = 0;
+    packed->n = 0;
+    packed->capacity = 0;
+    packed->data = NULL;
+}
+
+cgrad_error gemm_pack_b_f32(const gemm_transpose trans_b, const size_t k, const size_t n, const float *const b, const size_t ldb, struct gemm_packed_b *const packed, struct thread_pool *const pool)
+{
+    cgrad_error err = gemm_packed_b_reserve(packed, k * gemm_round_up(n, GEMM_F32_NR) * sizeof(float));
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    packed->k = k;
+    packed->n = n;
+
+    // Same panels as packed by gemm_native_f32, stored one after the other
+    struct gemm_pack_f32 pack = {.src = b, .ld = ldb, .along_k = trans_b == GEMM_TRANS, .width = GEMM_F32_NR};
+    for (size_t jc = 0; jc < n; jc += GEMM_F32_NC)
+    {
+        const size_t nc = n - jc < GEMM_F32_NC ? n - jc : GEMM_F32_NC;
+        const size_t n_strips = (nc + GEMM_F32_NR - 1) / GEMM_F32_NR;
+
+        for (size_t pc = 0; pc < k; pc += GEMM_KC)
+        {
+            pack.offset = jc;
+            pack.size = nc;
+            pack.k_offset = pc;
+            pack.kc = k - pc < GEMM_KC ? k - pc : GEMM_KC;
+            pack.dst = (float *)packed->data + jc * k + pc * n_strips * GEMM_F32_NR;
+            thread_pool_parallel_for(pool, n_strips, thread_pool_grain(pack.kc * GEMM_F32_NR), &gemm_pack_f32_strips, &pack);
+        }
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error gemm_pack_b_f64(const gemm_transpose trans_b, const size_t k, const size_t n, const double *const b, const size_t ldb, struct gemm_packed_b *const packed, struct thread_pool *const pool)
+{
+    cgrad_error err = gemm_packed_b_reserve(packed, k * gemm_round_up(n, GEMM_F64_NR) * sizeof(double));
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    packed->k = k;
+    packed->n = n;
+
+    // Same panels as packed by gemm_native_f64, stored one after the other
+    struct gemm_pack_f64 pack = {.src = b, .ld = ldb, .along_k = trans_b == GEMM_TRANS, .width = GEMM_F64_NR};
+    for (size_t jc = 0; jc < n; jc += GEMM_F64_NC)
+    {
+        const size_t nc = n - jc < GEMM_F64_NC ? n - jc : GEMM_F64_NC;
+        const size_t n_strips = (nc + GEMM_F64_NR - 1) / GEMM_F64_NR;
+
+        for (size_t pc = 0; pc < k; pc += GEMM_KC)
+        {
+            pack.offset = jc;
+            pack.size = nc;
+            pack.k_offset = pc;
+            pack.kc = k - pc < GEMM_KC ? k - pc : GEMM_KC;
+            pack.dst = (double *)packed->data + jc * k + pc * n_strips * GEMM_F64_NR;
+            thread_pool_parallel_for(pool, n_strips, thread_pool_grain(pack.kc * GEMM_F64_NR), &gemm_pack_f64_strips, &pack);
+        }
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error gemm_packed_f32(const gemm_transpose trans_a, const size_t m, const float *const a, const size_t lda, const struct gemm_packed_b *const b, float *const c, const size_t ldc, struct thread_pool *const pool)
+{
+    return gemm_native_f32(trans_a, GEMM_NO_TRANS, m, b->n, b->k, a, lda, NULL, 0, (const float *)b->data, c, ldc, pool);
+}
+
+cgrad_error gemm_packed_f64(const gemm_transpose trans_a, const size_t m, const double *const a, const size_t lda, const struct gemm_packed_b *const b, double *const c, const size_t ldc, struct thread_pool *const pool)
+{
+    return gemm_native_f64(trans_a, GEMM_NO_TRANS, m, b->n, b->k, a, lda, NULL, 0, (const double *)b->data, c, ldc, pool);
+}
+
+void gemm_packed_b_cleanup(struct gemm_packed_b *const packed)
+{
+    if (!packed)
+    {
+        return;
+    }
+
+    free(packed->data);
+    gemm_packed_b_init(packed);
+}
+
+static void gemm_backend_init(void)
+{
+#ifdef CGRAD_USE_BLAS
+    gemm_backend backend = GEMM_BACKEND_BLAS;
+#else
+    gemm_backend backend = GEMM_BACKEND_NATIVE;
+#endif
+
+    const char *value = getenv(GEMM_BACKEND_ENV);
+    if (value && strcmp(value, "native") == 0)
+    {
+        backend = GEMM_BACKEND_NATIVE;
+    }
+
+    atomic_store_explicit(&gemm_backend_current, backend, memory_order_relaxed);
+}
+
+static cgrad_error gemm_packed_b_reserve(struct gemm_packed_b *const packed, const size_t size)
+{
+    if (size <= packed->capacity)
+    {
+        return NO_ERROR;
+    }
+
+    free(packed->data);
+    packed->data = gemm_buffer_alloc(size);
+    packed->capacity = packed->data ? size : 0;
+
+    return packed->data ? NO_ERROR : TENSOR_ALLOCATION_FAILED;
+}
+
+static void *gemm_buffer_alloc(const size_t size)
+{
+    return aligned_alloc(GEMM_BUFFER_ALIGNMENT, gemm_round_up(size, GEMM_BUFFER_ALIGNMENT));
+}
+
+static inline size_t gemm_round_up(const size_t x, const size_t multiple)
+{
+    return (x + multiple - 1) / multiple * multiple;
+}
+
+static cgrad_error gemm_native_f32(const gemm_transpose trans_a, const gemm_transpose trans_b, const size_t m, const size_t n, const size_t k, const float *const a, const size_t lda, const float *const b, const size_t ldb, const float *const b_prepacked, float *const c, const size_t ldc, struct thread_pool *const pool)
+{
+    if (m == 0 || n == 0)
+    {
+        return NO_ERROR;
+    }
+    if (k == 0)
+    {
+        for (size_t i = 0; i < m; i++)
+        {
+            memset(c + i * ldc, 0, n * sizeof(float));
+        }
+        return NO_ERROR;
+    }
+
+    const size_t kc_max = k < GEMM_KC ? k : GEMM_KC;
+    const size_t mc_max = m < GEMM_F32_MC ? gemm_round_up(m, GEMM_MR) : GEMM_F32_MC;
+    const size_t nc_max = n < GEMM_F32_NC ? gemm_round_up(n, GEMM_F32_NR) : GEMM_F32_NC;
+    float *a_packed = gemm_buffer_alloc(mc_max * kc_max * sizeof(float));
+    float *b_packed = b_prepacked ? NULL : gemm_buffer_alloc(kc_max * nc_max * sizeof(float));
+    if (!a_packed || (!b_prepacked && !b_packed))
+    {
+        free(a_packed);
+        free(b_packed);
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    struct gemm_pack_f32 pack_a = {.src = a, .ld = lda, .along_k = trans_a == GEMM_NO_TRANS, .width = GEMM_MR, .dst = a_packed};
+    struct gemm_pack_f32 pack_b = {.src = b, .ld = ldb, .along_k = trans_b == GEMM_TRANS, .width = GEMM_F32_NR, .dst = b_packed};
+
+    for (size_t jc = 0; jc < n; jc += GEMM_F32_NC)
+    {
+        const size_t nc = n - jc < GEMM_F32_NC ? n - jc : GEMM_F32_NC;
+        const size_t n_strips = (nc + GEMM_F32_NR - 1) / GEMM_F32_NR;
+
+        for (size_t pc = 0; pc < k; pc += GEMM_KC)
+        {
+            const size_t kc = k - pc < GEMM_KC ? k - pc : GEMM_KC;
+
+            // Prepacked panels are laid out one after the other, in the order they are consumed
+            const float *b_panel = b_prepacked ? b_prepacked + jc * k + pc * n_strips * GEMM_F32_NR : b_packed;
+            if (!b_prepacked)
+            {
+                pack_b.offset = jc;
+                pack_b.size = nc;
+                pack_b.k_offset = pc;
+                pack_b.kc = kc;
+                thread_pool_parallel_for(pool, n_strips, thread_pool_grain(kc * GEMM_F32_NR), &gemm_pack_f32_strips, &pack_b);
+            }
+
+            for (size_t ic = 0; ic < m; ic += GEMM_F32_MC)
+            {
+                const size_t mc = m - ic < GEMM_F32_MC ? m - ic : GEMM_F32_MC;
+
+                // The block of A is small next to the products using it, so it is packed by the caller
+                pack_a.offset = ic;
+                pack_a.size = mc;
+                pack_a.k_offset = pc;
+                pack_a.kc = kc;
+                gemm_pack_f32_strips(&pack_a, 0, (mc + GEMM_MR - 1) / GEMM_MR);
+
+                struct gemm_macro_f32 macro = {
+                    .a_packed = a_packed,
+                    .b_packed = b_panel,
+                    .mc = mc,
+                    .nc = nc,
+                    .kc = kc,
+                    .c = c + ic * ldc + jc,
+                    .ldc = ldc,
+                    .accumulate = pc > 0,
+                };
+                thread_pool_parallel_for(pool, n_strips, thread_pool_grain(2 * mc * kc * GEMM_F32_NR), &gemm_macro_f32_strips, &macro);
+            }
+        }
+    }
+
+    free(a_packed);
+    free(b_packed);
+    return NO_ERROR;
+}
+
+static cgrad_error gemm_native_f64(const gemm_transpose trans_a, const gemm_transpose trans_b, const size_t m, const size_t n, const size_t k, const double *const a, const size_t lda, const double *const b, const size_t ldb, const double *const b_prepacked, double *const c, const size_t ldc, struct thread_pool *const pool)
+{
+    if (m == 0 || n == 0)
+    {
+        return NO_ERROR;
+    }
+    if (k == 0)
+    {
+        for (size_t i = 0; i < m; i++)
+        {
+            memset(c + i * ldc, 0, n * sizeof(double));
+        }
+        return NO_ERROR;
+    }
+
+    const size_t kc_max = k < GEMM_KC ? k : GEMM_KC;
+    const size_t mc_max = m < GEMM_F64_MC ? gemm_round_up(m, GEMM_MR) : GEMM_F64_MC;
+    const size_t nc_max = n < GEMM_F64_NC ? gemm_round_up(n, GEMM_F64_NR) : GEMM_F64_NC;
+    double *a_packed = gemm_buffer_alloc(mc_max * kc_max * sizeof(double));
+    double *b_packed = b_prepacked ? NULL : gemm_buffer_alloc(kc_max * nc_max * sizeof(double));
+    if (!a_packed || (!b_prepacked && !b_packed))
+    {
+        free(a_packed);
+        free(b_packed);
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    struct gemm_pack_f64 pack_a = {.src = a, .ld = lda, .along_k = trans_a == GEMM_NO_TRANS, .width = GEMM_MR, .dst = a_packed};
+    struct gemm_pack_f64 pack_b = {.src = b, .ld = ldb, .along_k = trans_b == GEMM_TRANS, .width = GEMM_F64_NR, .dst = b_packed};
+
+    for (size_t jc = 0; jc < n; jc += GEMM_F64_NC)
+    {
+        const size_t nc = n - jc < GEMM_F64_NC ? n - jc : GEMM_F64_NC;
+        const size_t n_strips = (nc + GEMM_F64_NR - 1) / GEMM_F64_NR;
+
+        for (size_t pc = 0; pc < k; pc += GEMM_KC)
+        {
+            const size_t kc = k - pc < GEMM_KC ? k - pc : GEMM_KC;
+
+            // Prepacked panels are laid out one after the other, in the order they are consumed
+            const double *b_panel = b_prepacked ? b_prepacked + jc * k + pc * n_strips * GEMM_F64_NR : b_packed;
+            if (!b_prepacked)
+            {
+                pack_b.offset = jc;
+                pack_b.size = nc;
+                pack_b.k_offset = pc;
+                pack_b.kc = kc;
+                thread_pool_parallel_for(pool, n_strips, thread_pool_grain(kc * GEMM_F64_NR), &gemm_pack_f64_strips, &pack_b);
+            }
+
+            for (size_t ic = 0; ic < m; ic += GEMM_F64_MC)
+            {
+                const size_t mc = m - ic < GEMM_F64_MC ? m - ic : GEMM_F64_MC;
+
+                pack_a.offset = ic;
+                pack_a.size = mc;
+                pack_a.k_offset = pc;
+                pack_a.kc = kc;
+                gemm_pack_f64_strips(&pack_a, 0, (mc + GEMM_MR - 1) / GEMM_MR);
+
+                struct gemm_macro_f64 macro = {
+                    .a_packed = a_packed,
+                    .b_packed = b_panel,
+                    .mc = mc,
+                    .nc = nc,
+                    .kc = kc,
+                    .c = c + ic * ldc + jc,
+                    .ldc = ldc,
+                    .accumulate = pc > 0,
+                };
+                thread_pool_parallel_for(pool, n_strips, thread_pool_grain(2 * mc * kc * GEMM_F64_NR), &gemm_macro_f64_strips, &macro);
+            }
+        }
+    }
+
+    free(a_packed);
+    free(b_packed);
+    return NO_ERROR;
+}
+
+static void gemm_pack_f32_strips(void *arg, const size_t begin, const size_t end)
+{
+    const struct gemm_pack_f32 *pack = arg;
+    const size_t width = pack->width;
+
+    for (size_t s = begin; s < end; s++)
+    {
+        float *dst = pack->dst + s * width * pack->kc;
+        const size_t first = pack->offset + s * width;
+        const size_t valid = pack->size - s * width < width ? pack->size - s * width : width;
+
+        // Strips past the edge of the matrix are padded with zeros, so that the kernel always computes full tiles
+        if (pack->along_k)
+        {
+            for (size_t x = 0; x < width; x++)
+            {
+                if (x < valid)
+                {
+                    const float *src = pack->src + (first + x) * pack->ld + pack->k_offset;
+                    for (size_t p = 0; p < pack->kc; p++)
+                    {
+                        dst[p * width + x] = src[p];
+                    }
+                }
+                else
+                {
+                    for (size_t p = 0; p < pack->kc; p++)
+                    {
+                        dst[p * width + x] = 0.0f;
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (size_t p = 0; p < pack->kc; p++)
+            {
+                const float *src = pack->src + (pack->k_offset + p) * pack->ld + first;
+                memcpy(dst + p * width, src, valid * sizeof(float));
+                memset(dst + p * width + valid, 0, (width - valid) * sizeof(float));
+            }
+        }
+    }
+}
+
+static void gemm_pack_f64_strips(void *arg, const size_t begin, const size_t end)
+{
+    const struct gemm_pack_f64 *pack = arg;
+    const size_t width = pack->width;
+
+    for (size_t s = begin; s < end; s++)
+    {
+        double *dst = pack->dst + s * width * pack->kc;
+        const size_t first = pack->offset + s * width;
+        const size_t valid = pack->size - s * width < width ? pack->size - s * width : width;
+
+        if (pack->along_k)
+        {
+            for (size_t x = 0; x < width; x++)
+            {
+                if (x < valid)
+                {
+                    const double *src = pack->src + (first + x) * pack->ld + pack->k_offset;
+                    for (size_t p = 0; p < pack->kc; p++)
+                    {
+                        dst[p * width + x] = src[p];
+                    }
+                }
+                else
+                {
+                    for (size_t p = 0; p < pack->kc; p++)
+                    {
+                        dst[p * width + x] = 0.0;
+                    }
+                }
+            }
+        }
+        else
+        {
+            for (size_t p = 0; p < pack->kc; p++)
+            {
+                const double *src = pack->src + (pack->k_offset + p) * pack->ld + first;
+                memcpy(dst + p * width, src, valid * sizeof(double));
+                memset(dst + p * width + valid, 0, (width - valid) * sizeof(double));
+            }
+        }
+    }
+}
+
+static void gemm_macro_f32_strips(void *arg, const size_t begin, const size_t end)
+{
+    const struct gemm_macro_f32 *macro = arg;
+    float tile[GEMM_MR * GEMM_F32_NR];
+
+    for (size_t s = begin; s < end; s++)
+    {
+        const size_t j = s * GEMM_F32_NR;
+        const size_t cols = macro->nc - j < GEMM_F32_NR ? macro->nc - j : GEMM_F32_NR;
+        const float *b = macro->b_packed + s * GEMM_F32_NR * macro->kc;
+
+        for (size_t i = 0; i < macro->mc; i += GEMM_MR)
+        {
+            const size_t rows = macro->mc - i < GEMM_MR ? macro->mc - i : GEMM_MR;
+            const float *a = macro->a_packed + i * macro->kc;
+            float *c = macro->c + i * macro->ldc + j;
+
+            if (cols == GEMM_F32_NR)
+            {
+                gemm_kernel_f32(macro->kc, rows, a, b, c, macro->ldc, macro->accumulate);
+                continue;
+            }
+
+            // Tiles on the right edge are computed into a buffer, then only their valid columns are written
+            gemm_kernel_f32(macro->kc, rows, a, b, tile, GEMM_F32_NR, false);
+            for (size_t r = 0; r < rows; r++)
+            {
+                for (size_t x = 0; x < cols; x++)
+                {
+                    c[r * macro->ldc + x] = macro->accumulate ? c[r * macro->ldc + x] + tile[r * GEMM_F32_NR + x] : tile[r * GEMM_F32_NR + x];
+                }
+            }
+        }
+    }
+}
+
+static void gemm_macro_f64_strips(void *arg, const size_t begin, const size_t end)
+{
+    const struct gemm_macro_f64 *macro = arg;
+    double tile[GEMM_MR * GEMM_F64_NR];
+
+    for (size_t s = begin; s < end; s++)
+    {
+        const size_t j = s * GEMM_F64_NR;
+        const size_t cols = macro->nc - j < GEMM_F64_NR ? macro->nc - j : GEMM_F64_NR;
+        const double *b = macro->b_packed + s * GEMM_F64_NR * macro->kc;
+
+        for (size_t i = 0; i < macro->mc; i += GEMM_MR)
+        {
+            const size_t rows = macro->mc - i < GEMM_MR ? macro->mc - i : GEMM_MR;
+            const double *a = macro->a_packed + i * macro->kc;
+            double *c = macro->c + i * macro->ldc + j;
+
+            if (cols == GEMM_F64_NR)
+            {
+                gemm_kernel_f64(macro->kc, rows, a, b, c, macro->ldc, macro->accumulate);
+                continue;
+            }
+
+            gemm_kernel_f64(macro->kc, rows, a, b, tile, GEMM_F64_NR, false);
+            for (size_t r = 0; r < rows; r++)
+            {
+                for (size_t x = 0; x < cols; x++)
+                {
+                    c[r * macro->ldc + x] = macro->accumulate ? c[r * macro->ldc + x] + tile[r * GEMM_F64_NR + x] : tile[r * GEMM_F64_NR + x];
+                }
+            }
+        }
+    }
+}
+
+#ifdef GEMM_VEC_F32
+static inline void gemm_kernel_f32_rows(const size_t kc, const size_t rows, const float *restrict a, const float *restrict b, float *restrict c, const size_t ldc, const bool accumulate)
+{
+    // Two vectors per row of the tile, up to twelve accumulators in total
+    GEMM_VEC_F32 acc[GEMM_MR][2];
+    for (size_t r = 0; r < rows; r++)
+    {
+        acc[r][0] = GEMM_ZERO_PS();
+        acc[r][1] = GEMM_ZERO_PS();
+    }
+
+    for (size_t p = 0; p < kc; p++)
+    {
+        const GEMM_VEC_F32 b_0 = GEMM_LOAD_PS(b);
+        const GEMM_VEC_F32 b_1 = GEMM_LOAD_PS(b + GEMM_F32_LANES);
+        for (size_t r = 0; r < rows; r++)
+        {
+            const GEMM_VEC_F32 a_r = GEMM_SET1_PS(a[r]);
+            acc[r][0] = GEMM_FMADD_PS(a_r, b_0, acc[r][0]);
+            acc[r][1] = GEMM_FMADD_PS(a_r, b_1, acc[r][1]);
+        }
+        a += GEMM_MR;
+        b += GEMM_F32_NR;
+    }
+
+    for (size_t r = 0; r < rows; r++)
+    {
+        float *c_row = c + r * ldc;
+        if (accumulate)
+        {
+            acc[r][0] = GEMM_ADD_PS(acc[r][0], GEMM_LOADU_PS(c_row));
+            acc[r][1] = GEMM_ADD_PS(acc[r][1], GEMM_LOADU_PS(c_row + GEMM_F32_LANES));
+        }
+        GEMM_STOREU_PS(c_row, acc[r][0]);
+        GEMM_STOREU_PS(c_row + GEMM_F32_LANES, acc[r][1]);
+    }
+}
+
+static inline void gemm_kernel_f64_rows(const size_t kc, const size_t rows, const double *restrict a, const double *restrict b, double *restrict c, const size_t ldc, const bool accumulate)
+{
+    GEMM_VEC_F64 acc[GEMM_MR][2];
+    for (size_t r = 0; r < rows; r++)
+    {
+        acc[r][0] = GEMM_ZERO_PD();
+        acc[r][1] = GEMM_ZERO_PD();
+    }
+
+    for (size_t p = 0; p < kc; p++)
+    {
+        const GEMM_VEC_F64 b_0 = GEMM_LOAD_PD(b);
+        const GEMM_VEC_F64 b_1 = GEMM_LOAD_PD(b + GEMM_F64_LANES);
+        for (size_t r = 0; r < rows; r++)
+        {
+            const GEMM_VEC_F64 a_r = GEMM_SET1_PD(a[r]);
+            acc[r][0] = GEMM_FMADD_PD(a_r, b_0, acc[r][0]);
+            acc[r][1] = GEMM_FMADD_PD(a_r, b_1, acc[r][1]);
+        }
+        a += GEMM_MR;
+        b += GEMM_F64_NR;
+    }
+
+    for (size_t r = 0; r < rows; r++)
+    {
+        double *c_row = c + r * ldc;
+        if (accumulate)
+        {
+            acc[r][0] = GEMM_ADD_PD(acc[r][0], GEMM_LOADU_PD(c_row));
+            acc[r][1] = GEMM_ADD_PD(acc[r][1], GEMM_LOADU_PD(c_row + GEMM_F64_LANES));
+        }
+        GEMM_STOREU_PD(c_row, acc[r][0]);
+        GEMM_STOREU_PD(c_row + GEMM_F64_LANES, acc[r][1]);
+    }
+}
+#else
+static inline void gemm_kernel_f32_rows(const size_t kc, const size_t rows, const float *restrict a, const float *restrict b, float *restrict c, const size_t ldc, const bool accumulate)
+{
+    float acc[GEMM_MR][GEMM_F32_NR] = {{0}};
+    for (size_t p = 0; p < kc; p++)
+    {
+        for (size_t r = 0; r < rows; r++)
+        {
+            for (size_t x = 0; x < GEMM_F32_NR; x++)
+            {
+                acc[r][x] += a[r] * b[x];
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_F32_NR;
+    }
+
+    for (size_t r = 0; r < rows; r++)
+    {
+        for (size_t x = 0; x < GEMM_F32_NR; x++)
+        {
+            c[r * ldc + x] = accumulate ? c[r * ldc + x] + acc[r][x] : acc[r][x];
+        }
+    }
+}
+
+static inline void gemm_kernel_f64_rows(const size_t kc, const size_t rows, const double *restrict a, const double *restrict b, double *restrict c, const size_t ldc, const bool accumulate)
+{
+    double acc[GEMM_MR][GEMM_F64_NR] = {{0}};
+    for (size_t p = 0; p < kc; p++)
+    {
+        for (size_t r = 0; r < rows; r++)
+        {
+            for (size_t x = 0; x < GEMM_F64_NR; x++)
+            {
+                acc[r][x] += a[r] * b[x];
+            }
+        }
+        a += GEMM_MR;
+        b += GEMM_F64_NR;
+    }
+
+    for (size_t r = 0; r < rows; r++)
+    {
+        for (size_t x = 0; x < GEMM_F64_NR; x++)
+        {
+            c[r * ldc + x] = accumulate ? c[r * ldc + x] + acc[r][x] : acc[r][x];
+        }
+    }
+}
+#endif
+
+static void gemm_kernel_f32(const size_t kc, const size_t rows, const float *restrict a, const float *restrict b, float *restrict c, const size_t ldc, const bool accumulate)
+{
+    // Specialized on the number of rows, so that short tiles, e.g. of single row products, skip the padding rows
+    switch (rows)
+    {
+    case 1:
+        gemm_kernel_f32_rows(kc, 1, a, b, c, ldc, accumulate);
+        break;
+    case 2:
+        gemm_kernel_f32_rows(kc, 2, a, b, c, ldc, accumulate);
+        break;
+    case 3:
+        gemm_kernel_f32_rows(kc, 3, a, b, c, ldc, accumulate);
+        break;
+#if GEMM_MR > 4
+    case 4:
+        gemm_kernel_f32_rows(kc, 4, a, b, c, ldc, accumulate);
+        break;
+    case 5:
+        gemm_kernel_f32_rows(kc, 5, a, b, c, ldc, accumulate);
+        break;
+#endif
+    default:
+        gemm_kernel_f32_rows(kc, GEMM_MR, a, b, c, ldc, accumulate);
+        break;
+    }
+}
+
+static void gemm_kernel_f64(const size_t kc, const size_t rows, const double *restrict a, const double *restrict b, double *restrict c, const size_t ldc, const bool accumulate)
+{
+    // Specialized on the number of rows, so that short tiles, e.g. of single row products, skip the padding rows
+    switch (rows)
+    {
+    case 1:
+        gemm_kernel_f64_rows(kc, 1, a, b, c, ldc, accumulate);
+        break;
+    case 2:
+        gemm_kernel_f64_rows(kc, 2, a, b, c, ldc, accumulate);
+        break;
+    case 3:
+        gemm_kernel_f64_rows(kc, 3, a, b, c, ldc, accumulate);
+        break;
+#if GEMM_MR > 4
+    case 4:
+        gemm_kernel_f64_rows(kc, 4, a, b, c, ldc, accumulate);
+        break;
+    case 5:
+        gemm_kernel_f64_rows(kc, 5, a, b, c, ldc, accumulate);
+        break;
+#endif
+    default:
+        gemm_kernel_f64_rows(kc, GEMM_MR, a, b, c, ldc, accumulate);
+        break;
+    }
+}
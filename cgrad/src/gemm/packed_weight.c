@@ -0,0 +1,92 @@
+#include "cgrad/gemm/packed_weight.h"
+
+static inline bool packed_weight_is_current(struct packed_weight *const cache, const struct tensor *const weight, const gemm_transpose trans);
+
+cgrad_error packed_weight_init(struct packed_weight *const cache)
+{
+    if (pthread_mutex_init(&cache->mutex, NULL) != 0)
+    {
+        return PACKED_WEIGHT_INIT_FAILED;
+    }
+
+    atomic_init(&cache->source, NULL);
+    atomic_init(&cache->source_data, NULL);
+    atomic_init(&cache->source_version, 0);
+    atomic_init(&cache->trans, GEMM_NO_TRANS);
+    gemm_packed_b_init(&cache->packed);
+
+    return NO_ERROR;
+}
+
+cgrad_error packed_weight_get(struct packed_weight *const cache, const struct tensor *const weight, const gemm_transpose trans, const struct gemm_packed_b **const packed, struct thread_pool *const pool)
+{
+    *packed = NULL;
+    if (!cache || gemm_get_backend() != GEMM_BACKEND_NATIVE)
+    {
+        return NO_ERROR;
+    }
+    if (weight->dtype != DTYPE_FLOAT64 && weight->dtype != DTYPE_FLOAT32)
+    {
+        return NO_ERROR;
+    }
+
+    const size_t rows = weight->shape[0];
+    const size_t cols = weight->data_size / rows;
+
+    // Lock-free as long as the weight is not modified
+    if (packed_weight_is_current(cache, weight, trans))
+    {
+        *packed = &cache->packed;
+        return NO_ERROR;
+    }
+
+    cgrad_error err = NO_ERROR;
+    pthread_mutex_lock(&cache->mutex);
+
+    // Checked again, another forward pass may have packed the weight while this one waited for the mutex
+    if (!packed_weight_is_current(cache, weight, trans))
+    {
+        // Invalidated first, so that a failed packing is retried by the next call
+        atomic_store_explicit(&cache->source, NULL, memory_order_relaxed);
+
+        const size_t k = trans == GEMM_NO_TRANS ? rows : cols;
+        const size_t n = trans == GEMM_NO_TRANS ? cols : rows;
+        err = weight->dtype == DTYPE_FLOAT64 ? gemm_pack_b_f64(trans, k, n, weight->data, cols, &cache->packed, pool)
+                                             : gemm_pack_b_f32(trans, k, n, weight->data, cols, &cache->packed, pool);
+        if (err == NO_ERROR)
+        {
+            atomic_store_explicit(&cache->source_data, weight->data, memory_order_relaxed);
+            atomic_store_explicit(&cache->source_version, weight->version, memory_order_relaxed);
+            atomic_store_explicit(&cache->trans, trans, memory_order_relaxed);
+            atomic_store_explicit(&cache->source, weight, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (err == NO_ERROR)
+    {
+        *packed = &cache->packed;
+    }
+
+    return err;
+}
+
+void packed_weight_cleanup(struct packed_weight *const cache)
+{
+    if (!cache)
+    {
+        return;
+    }
+
+    gemm_packed_b_cleanup(&cache->packed);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+static inline bool packed_weight_is_current(struct packed_weight *const cache, const struct tensor *const weight, const gemm_transpose trans)
+{
+    // Acquiring source orders the loads of the other fields and of the packed data after the packing that stored it
+    return atomic_load_explicit(&cache->source, memory_order_acquire) == weight &&
+           atomic_load_explicit(&cache->source_data, memory_order_relaxed) == weight->data &&
+           atomic_load_explicit(&cache->source_version, memory_order_relaxed) == weight->version &&
+           atomic_load_explicit(&cache->trans, memory_order_relaxed) == (int)trans;
+}
@@ -1,19 +1,24 @@
 #include "cgrad/layers/conv2d.h"
 #include "cgrad/tensor/tensor.h"
 #include "cgrad/tensor/tensor2d_mult.h"
+#include "cgrad/tensor/tensor2d_mult_packed.h"
+#include "cgrad/tensor/tensor_helpers.h"
 #include "cgrad/tensor/tensor2d_trans.h"
 #include "cgrad/tensor/tensor_trans.h"
 #include "cgrad/tensor/tensor_reshape.h"
 #include "cgrad/tensor/tensor_im2row.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
-#include "cgrad/utils/random.h"
+#include "cgrad/utils/philox.h"
+#include "cgrad/utils/half.h"
 #include <math.h>
 #include <stdlib.h>
 #include <assert.h>
 
+static cgrad_error conv2d_mult_kernel(const struct conv2d *const layer, struct tensor *const x_patches, struct tensor **const out_patches, const bool track_grad, struct cgrad_env *const env);
 static cgrad_error conv2d_xavier_init_f64(struct conv2d *const layer);
 static cgrad_error conv2d_xavier_init_f32(struct conv2d *const layer);
+static cgrad_error conv2d_xavier_init_half(struct conv2d *const layer);
 
 cgrad_error conv2d_init(struct conv2d *const layer, const size_t in_channels, const size_t out_channels, const size_t kernel_size, const cgrad_dtype dtype, struct cgrad_env *const env)
 {
@@ -35,7 +40,17 @@ cgrad_error conv2d_init(struct conv2d *const layer, const size_t in_channels, co
         return TENSOR_ALLOCATION_FAILED;
     }
 
+    struct packed_weight *packed_weight = malloc(sizeof(struct packed_weight));
+    cgrad_error err = packed_weight ? packed_weight_init(packed_weight) : PACKED_WEIGHT_INIT_FAILED;
+    if (err != NO_ERROR)
+    {
+        free(packed_weight);
+        tensor_allocator_free(&env->tensor_alloc, weight);
+        return err;
+    }
+
     layer->weight = weight;
+    layer->packed_weight = packed_weight;
     layer->in_channels = in_channels;
     layer->out_channels = out_channels;
     layer->kernel_size = kernel_size;
@@ -50,6 +65,20 @@ cgrad_error conv2d_forward(struct conv2d *const layer, struct tensor *const x, s
     {
         return CONV2D_NULL;
     }
+
+    return conv2d_forward_env(layer, x, out, track_grad, layer->env);
+}
+
+cgrad_error conv2d_forward_env(const struct conv2d *const layer, struct tensor *const x, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
+{
+    if (!layer)
+    {
+        return CONV2D_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
     if (!x)
     {
         return TENSOR_NULL;
@@ -65,99 +94,116 @@ cgrad_error conv2d_forward(struct conv2d *const layer, struct tensor *const x, s
     const size_t W_out = x->shape[3] - kernel->shape[3] + 1;
 
     size_t K = kernel->shape[0];
-    size_t C = kernel->shape[1];
-    size_t R = kernel->shape[2];
-    size_t S = kernel->shape[3];
 
     cgrad_error err = NO_ERROR;
 
     struct tensor *x_patches = NULL;
-    err = tensor_im2row((struct tensor *)x, kernel, &x_patches, track_grad, layer->env);
+    err = tensor_im2row((struct tensor *)x, kernel, &x_patches, track_grad, env);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    const size_t KERNEL_NEW_SHAPE[] = {K, C * R * S};
-    struct tensor *reshaped_kernel = NULL;
-    err = tensor_reshape(kernel, KERNEL_NEW_SHAPE, 2, &reshaped_kernel, track_grad, layer->env);
+    struct tensor *out_patches = NULL;
+    err = conv2d_mult_kernel(layer, x_patches, &out_patches, track_grad, env);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    struct tensor *kernel_trans = NULL;
-    err = tensor2d_trans(reshaped_kernel, &kernel_trans, track_grad, layer->env);
+    struct tensor *out_patches_trans = NULL;
+    err = tensor2d_trans(out_patches, &out_patches_trans, track_grad, env);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    struct tensor *out_patches = NULL;
-    err = tensor2d_mult(x_patches, kernel_trans, &out_patches, track_grad, layer->env);
+    struct tensor *out_patches_trans_reshaped = NULL;
+    const size_t OUT_PATCHES_NEW_SHAPE[] = {K, x->shape[0], H_out, W_out};
+    err = tensor_reshape(out_patches_trans, OUT_PATCHES_NEW_SHAPE, 4, &out_patches_trans_reshaped, track_grad, env);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    struct tensor *out_patches_trans = NULL;
-    err = tensor2d_trans(out_patches, &out_patches_trans, track_grad, layer->env);
+    err = tensor_trans(out_patches_trans_reshaped, 0, 1, out, track_grad, env);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    struct tensor *out_patches_trans_reshaped = NULL;
-    const size_t OUT_PATCHES_NEW_SHAPE[] = {K, x->shape[0], H_out, W_out};
-    err = tensor_reshape(out_patches_trans, OUT_PATCHES_NEW_SHAPE, 4, &out_patches_trans_reshaped, track_grad, layer->env);
+    err = tensor_list_add(env->tensor_alloc_intermediates, x_patches);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_trans(out_patches_trans_reshaped, 0, 1, out, track_grad, layer->env);
+    err = tensor_list_add(env->tensor_alloc_intermediates, out_patches);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(layer->env->tensor_alloc_intermediates, x_patches);
+    err = tensor_list_add(env->tensor_alloc_intermediates, out_patches_trans);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(layer->env->tensor_alloc_intermediates, reshaped_kernel);
+    err = tensor_list_add(env->tensor_alloc_intermediates, out_patches_trans_reshaped);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(layer->env->tensor_alloc_intermediates, kernel_trans);
+    return NO_ERROR;
+}
+
+static cgrad_error conv2d_mult_kernel(const struct conv2d *const layer, struct tensor *const x_patches, struct tensor **const out_patches, const bool track_grad, struct cgrad_env *const env)
+{
+    struct tensor *kernel = layer->weight;
+
+    // The kernel, viewed as {K, C * R * S}, is multiplied transposed and packed once until it is modified
+    if (kernel->dtype == DTYPE_FLOAT64 || kernel->dtype == DTYPE_FLOAT32)
+    {
+        const struct gemm_packed_b *packed = NULL;
+        cgrad_error err = packed_weight_get(layer->packed_weight, kernel, GEMM_TRANS, &packed, env->pool);
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+
+        return tensor2d_mult_packed(x_patches, kernel, GEMM_TRANS, packed, out_patches, track_grad, env);
+    }
+
+    const size_t KERNEL_NEW_SHAPE[] = {kernel->shape[0], kernel->shape[1] * kernel->shape[2] * kernel->shape[3]};
+    struct tensor *reshaped_kernel = NULL;
+    cgrad_error err = tensor_reshape(kernel, KERNEL_NEW_SHAPE, 2, &reshaped_kernel, track_grad, env);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(layer->env->tensor_alloc_intermediates, out_patches);
+    struct tensor *kernel_trans = NULL;
+    err = tensor2d_trans(reshaped_kernel, &kernel_trans, track_grad, env);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(layer->env->tensor_alloc_intermediates, out_patches_trans);
+    err = tensor2d_mult(x_patches, kernel_trans, out_patches, track_grad, env);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    err = tensor_list_add(layer->env->tensor_alloc_intermediates, out_patches_trans_reshaped);
+    err = tensor_list_add(env->tensor_alloc_intermediates, reshaped_kernel);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    return NO_ERROR;
+    return tensor_list_add(env->tensor_alloc_intermediates, kernel_trans);
 }
 
 cgrad_error conv2d_xavier_init(struct conv2d *const layer)
@@ -173,6 +219,9 @@ cgrad_error conv2d_xavier_init(struct conv2d *const layer)
         return conv2d_xavier_init_f64(layer);
     case DTYPE_FLOAT32:
         return conv2d_xavier_init_f32(layer);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return conv2d_xavier_init_half(layer);
     default:
         return LINEAR_INVALID_DTYPE; 
     }
@@ -185,10 +234,8 @@ static cgrad_error conv2d_xavier_init_f64(struct conv2d *const layer)
 
     double xavier_init_bound = sqrt(1.0 / (layer->weight->shape[1] * layer->weight->shape[2] * layer->weight->shape[3]));
 
-    for (size_t i = 0; i < data_size; i++)
-    {
-        data[i] = sample_uniform(-xavier_init_bound, xavier_init_bound);
-    }
+    philox_uniform_f64(&layer->env->rng, data, data_size, -xavier_init_bound, xavier_init_bound);
+    tensor_mark_modified(layer->weight);
 
     return NO_ERROR;
 }
@@ -200,10 +247,21 @@ static cgrad_error conv2d_xavier_init_f32(struct conv2d *const layer)
 
     float xavier_init_bound = sqrt(1.0 / (layer->weight->shape[1] * layer->weight->shape[2] * layer->weight->shape[3]));
 
-    for (size_t i = 0; i < data_size; i++)
-    {
-        data[i] = sample_uniform(-xavier_init_bound, xavier_init_bound);
-    }
+    philox_uniform_f32(&layer->env->rng, data, data_size, -xavier_init_bound, xavier_init_bound);
+    tensor_mark_modified(layer->weight);
+
+    return NO_ERROR;
+}
+
+static cgrad_error conv2d_xavier_init_half(struct conv2d *const layer)
+{
+    uint16_t *restrict data = layer->weight->data;
+    size_t data_size = layer->weight->data_size;
+
+    float xavier_init_bound = sqrt(1.0 / (layer->weight->shape[1] * layer->weight->shape[2] * layer->weight->shape[3]));
+
+    philox_uniform_half(&layer->env->rng, data, data_size, -xavier_init_bound, xavier_init_bound, layer->weight->dtype);
+    tensor_mark_modified(layer->weight);
 
     return NO_ERROR;
 }
@@ -216,4 +274,7 @@ void conv2d_cleanup(struct conv2d *const layer)
     }
 
     tensor_allocator_free(&layer->env->tensor_alloc, layer->weight);
+    packed_weight_cleanup(layer->packed_weight);
+    free(layer->packed_weight);
+    layer->packed_weight = NULL;
 }
\ No newline at end of file
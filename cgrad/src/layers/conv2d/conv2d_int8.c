@@ -0,0 +1,185 @@
+#include "cgrad/layers/conv2d_int8.h"
+#include <stdlib.h>
+
+static void conv2d_int8_im2row(const uint8_t *const image, const size_t C, const size_t H, const size_t W, const size_t R, uint8_t *const patches);
+
+cgrad_error conv2d_int8_init(struct conv2d_int8 *const qlayer, const struct conv2d *const layer, const struct quant_params *const input_params, const quant_granularity granularity)
+{
+    if (!qlayer || !layer)
+    {
+        return CONV2D_NULL;
+    }
+
+    cgrad_error err = quant_params_check(input_params);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    qlayer->env = layer->env;
+    qlayer->in_channels = layer->in_channels;
+    qlayer->out_channels = layer->out_channels;
+    qlayer->kernel_size = layer->kernel_size;
+    qlayer->input_params = *input_params;
+    qlayer->output_params = (struct quant_params){.scale = 1.0f, .zero_point = 0};
+    qlayer->fuse_relu = false;
+    qlayer->requantize_output = false;
+
+    // The kernel {K, C, R, S} already stores each output channel contiguously
+    const size_t patch_size = layer->in_channels * layer->kernel_size * layer->kernel_size;
+    return qgemm_weights_pack(&qlayer->weight, layer->weight, layer->out_channels, patch_size, patch_size, 1, granularity, layer->env);
+}
+
+cgrad_error conv2d_int8_set_output(struct conv2d_int8 *const qlayer, const bool relu, const struct quant_params *const output_params)
+{
+    if (!qlayer)
+    {
+        return CONV2D_NULL;
+    }
+
+    if (output_params)
+    {
+        cgrad_error err = quant_params_check(output_params);
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+        qlayer->output_params = *output_params;
+    }
+
+    qlayer->fuse_relu = relu;
+    qlayer->requantize_output = output_params != NULL;
+
+    return NO_ERROR;
+}
+
+cgrad_error conv2d_int8_forward(struct conv2d_int8 *const qlayer, const struct tensor *const x, struct tensor **const out)
+{
+    if (!qlayer)
+    {
+        return CONV2D_NULL;
+    }
+    if (!x)
+    {
+        return TENSOR_NULL;
+    }
+    if (!out)
+    {
+        return OUTPUT_NULL;
+    }
+    if (x->shape_size != 4)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+    if (x->shape[1] != qlayer->in_channels)
+    {
+        return CONV2D_CHANNELS_MISMATCH;
+    }
+    if (x->shape[2] < qlayer->kernel_size || x->shape[3] < qlayer->kernel_size)
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+
+    const size_t B = x->shape[0];
+    const size_t C = x->shape[1];
+    const size_t H = x->shape[2];
+    const size_t W = x->shape[3];
+    const size_t K = qlayer->out_channels;
+    const size_t R = qlayer->kernel_size;
+    const size_t H_out = H - R + 1;
+    const size_t W_out = W - R + 1;
+
+    struct cgrad_env *env = qlayer->env;
+    cgrad_error err = NO_ERROR;
+
+    struct tensor *x_quantized = (struct tensor *)x;
+    if (x->dtype != DTYPE_UINT8)
+    {
+        if ((err = tensor_quantize(x, &qlayer->input_params, &x_quantized, env)) != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    const size_t out_shape[] = {B, K, H_out, W_out};
+    const cgrad_dtype out_dtype = qlayer->requantize_output ? DTYPE_UINT8 : DTYPE_FLOAT32;
+    *out = tensor_allocator_no_grad_alloc(&env->tensor_alloc, out_shape, 4, out_dtype);
+
+    // Patches of a single image, reused across the batch
+    uint8_t *patches = malloc(H_out * W_out * qlayer->weight.k);
+
+    if (!(*out) || !patches)
+    {
+        err = TENSOR_ALLOCATION_FAILED;
+    }
+    else
+    {
+        const struct qgemm_epilogue epilogue = {
+            .input_params = qlayer->input_params,
+            .bias = NULL,
+            .relu = qlayer->fuse_relu,
+            .requantize = qlayer->requantize_output,
+            .output_params = qlayer->output_params,
+        };
+
+        const uint8_t *x_data = x_quantized->data;
+        const size_t out_image_size = K * H_out * W_out;
+        for (size_t b = 0; b < B && err == NO_ERROR; b++)
+        {
+            conv2d_int8_im2row(x_data + b * C * H * W, C, H, W, R, patches);
+
+            // Output positions are the rows of the product, storing them with stride 1 yields the {K, H_out, W_out} layout
+            void *out_image = (char *)(*out)->data + b * out_image_size * dtype_sizeof(out_dtype);
+            err = qgemm_u8s8(patches, H_out * W_out, &qlayer->weight, &epilogue, out_image, 1, H_out * W_out);
+        }
+    }
+
+    free(patches);
+    if (x_quantized != x)
+    {
+        tensor_allocator_no_grad_free(&env->tensor_alloc, x_quantized);
+    }
+    if (err != NO_ERROR && *out)
+    {
+        tensor_allocator_no_grad_free(&env->tensor_alloc, *out);
+        *out = NULL;
+    }
+
+    return err;
+}
+
+void conv2d_int8_cleanup(struct conv2d_int8 *const qlayer)
+{
+    if (!qlayer)
+    {
+        return;
+    }
+
+    qgemm_weights_cleanup(&qlayer->weight, qlayer->env);
+}
+
+static void conv2d_int8_im2row(const uint8_t *const image, const size_t C, const size_t H, const size_t W, const size_t R, uint8_t *const patches)
+{
+    const size_t H_out = H - R + 1;
+    const size_t W_out = W - R + 1;
+
+    // Same patch layout as tensor_im2row, columns ordered by channel, then kernel row and column
+    uint8_t *dst = patches;
+    for (size_t h_out = 0; h_out < H_out; h_out++)
+    {
+        for (size_t w_out = 0; w_out < W_out; w_out++)
+        {
+            for (size_t c = 0; c < C; c++)
+            {
+                for (size_t r = 0; r < R; r++)
+                {
+                    const uint8_t *src = image + c * H * W + (h_out + r) * W + w_out;
+                    for (size_t s = 0; s < R; s++)
+                    {
+                        *dst++ = src[s];
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,203 @@
+#include "cgrad/layers/embedding.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include "cgrad/tensor/tensor_sparse_grad.h"
+#include "cgrad/autograd/computational_graph/computational_graph.h"
+#include "cgrad/autograd/computational_graph/computational_graph_link.h"
+#include "cgrad/utils/philox.h"
+#include <stdint.h>
+#include <string.h>
+
+typedef enum embedding_operand
+{
+    EMBEDDING_WEIGHT,
+    EMBEDDING_INDEXES,
+} embedding_operand;
+
+struct embedding_gather_args
+{
+    const struct tensor *weight;
+    const int32_t *indexes;
+    struct tensor *out;
+};
+
+static inline cgrad_error embedding_update_graph(struct tensor *const weight, struct tensor *const indexes, struct tensor **const out, struct cgrad_env *const env);
+static cgrad_error embedding_gather(const struct tensor *const weight, const struct tensor *const indexes, struct tensor *const out, struct thread_pool *const pool);
+static void embedding_gather_rows(void *arg, const size_t begin, const size_t end);
+static cgrad_error embedding_forward_function(const struct backpropagation_context *const ctx, struct tensor *const out);
+static cgrad_error embedding_backpropagate_weight(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *weight);
+
+cgrad_error embedding_init(struct embedding *const layer, const size_t n_embeddings, const size_t dim, const cgrad_dtype dtype, struct cgrad_env *const env)
+{
+    if (!layer)
+    {
+        return EMBEDDING_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (dtype != DTYPE_FLOAT64 && dtype != DTYPE_FLOAT32)
+    {
+        return EMBEDDING_INVALID_DTYPE;
+    }
+
+    const size_t weight_shape[] = {n_embeddings, dim};
+    struct tensor *weight = tensor_allocator_alloc(&env->tensor_alloc, weight_shape, 2, dtype);
+    if (!weight)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    layer->weight = weight;
+    layer->n_embeddings = n_embeddings;
+    layer->dim = dim;
+    layer->env = env;
+
+    return NO_ERROR;
+}
+
+cgrad_error embedding_forward(struct embedding *const layer, struct tensor *const indexes, struct tensor **const out, const bool track_grad)
+{
+    if (!layer)
+    {
+        return EMBEDDING_NULL;
+    }
+    cgrad_error err = tensor_check_null(indexes);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+    if (!out)
+    {
+        return OUTPUT_NULL;
+    }
+    if (indexes->dtype != DTYPE_INT32)
+    {
+        return TENSOR_INVALID_DTYPE;
+    }
+
+    const int32_t *indexes_data = indexes->data;
+    for (size_t i = 0; i < indexes->data_size; i++)
+    {
+        if (indexes_data[i] < 0 || (size_t)indexes_data[i] >= layer->n_embeddings)
+        {
+            return TENSOR_INDEX_OUT_OF_BOUNDS;
+        }
+    }
+
+    struct cgrad_env *env = layer->env;
+    const size_t shape[] = {indexes->data_size, layer->dim};
+    (*out) = tensor_allocator_alloc(&env->tensor_alloc, shape, 2, layer->weight->dtype);
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    if ((err = embedding_gather(layer->weight, indexes, *out, env->pool)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    if (track_grad)
+    {
+        return embedding_update_graph(layer->weight, indexes, out, env);
+    }
+
+    return NO_ERROR;
+}
+
+static inline cgrad_error embedding_update_graph(struct tensor *const weight, struct tensor *const indexes, struct tensor **const out, struct cgrad_env *const env)
+{
+    cgrad_error err = add_computational_graph_link(weight, EMBEDDING_WEIGHT, *out, &embedding_backpropagate_weight, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // The indexes are not differentiable, they are only set as operand for backward
+    if ((err = computational_graph_node_set_context_tensor((*out)->node, indexes, EMBEDDING_INDEXES)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    // The gradient of the weight is accumulated row by row, never allocated with the shape of the weight
+    if ((err = computational_graph_node_set_function_accumulates((*out)->node, EMBEDDING_WEIGHT)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_forward_function((*out)->node, &embedding_forward_function);
+}
+
+cgrad_error embedding_normal_init(struct embedding *const layer)
+{
+    if (!layer)
+    {
+        return EMBEDDING_NULL;
+    }
+
+    switch (layer->weight->dtype)
+    {
+    case DTYPE_FLOAT64:
+        philox_normal_f64(&layer->env->rng, layer->weight->data, layer->weight->data_size, 0.0, 1.0);
+        break;
+    case DTYPE_FLOAT32:
+        philox_normal_f32(&layer->env->rng, layer->weight->data, layer->weight->data_size, 0.0f, 1.0f);
+        break;
+    default:
+        return EMBEDDING_INVALID_DTYPE;
+    }
+    tensor_mark_modified(layer->weight);
+
+    return NO_ERROR;
+}
+
+void embedding_cleanup(struct embedding *const layer)
+{
+    if (!layer)
+    {
+        return;
+    }
+
+    tensor_allocator_free(&layer->env->tensor_alloc, layer->weight);
+    layer->weight = NULL;
+}
+
+static cgrad_error embedding_gather(const struct tensor *const weight, const struct tensor *const indexes, struct tensor *const out, struct thread_pool *const pool)
+{
+    struct embedding_gather_args args = {.weight = weight, .indexes = indexes->data, .out = out};
+    thread_pool_parallel_for(pool, indexes->data_size, thread_pool_grain(out->shape[1]), &embedding_gather_rows, &args);
+
+    return NO_ERROR;
+}
+
+static void embedding_gather_rows(void *arg, const size_t begin, const size_t end)
+{
+    const struct embedding_gather_args *args = arg;
+    const size_t row_bytes = args->out->shape[1] * dtype_sizeof(args->out->dtype);
+
+    for (size_t i = begin; i < end; i++)
+    {
+        memcpy((char *)args->out->data + i * row_bytes, (const char *)args->weight->data + (size_t)args->indexes[i] * row_bytes, row_bytes);
+    }
+}
+
+static cgrad_error embedding_forward_function(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return embedding_gather(ctx->operands[EMBEDDING_WEIGHT], ctx->operands[EMBEDDING_INDEXES], out, ctx->pool);
+}
+
+static cgrad_error embedding_backpropagate_weight(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *weight)
+{
+    const struct tensor *indexes = ctx->operands[EMBEDDING_INDEXES];
+    if (!indexes)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
+    }
+
+    /**
+     * If C = W[idx], then dz/dW[idx[i]] += dz/dC[i], the other rows of dz/dW being zero. The gradient is accumulated
+     * into the weight itself, see computational_graph_node_set_function_accumulates
+     */
+    return tensor_sparse_grad_accumulate(weight, indexes, grad_wrt_out, ctx->owned_allocator);
+}
@@ -1,19 +1,23 @@
 #include "cgrad/layers/linear.h"
 #include "cgrad/tensor/tensor2d_mult.h"
+#include "cgrad/tensor/tensor2d_mult_packed.h"
+#include "cgrad/tensor/tensor2d_sparse_mult.h"
+#include "cgrad/tensor/tensor_helpers.h"
 #include "cgrad/tensor/tensor2d_add_row_vector.h"
 #include "cgrad/tensor/tensor2d_trans.h"
 #include "cgrad/tensor/tensor_sum.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
-#include "cgrad/utils/random.h"
+#include "cgrad/utils/philox.h"
+#include "cgrad/utils/half.h"
 #include "cgrad/utils/simd_support.h"
 #include <math.h>
 #include <stdio.h>
-#include <cblas.h>
 #include <stdlib.h>
 #include <string.h>
 
 static cgrad_error linear_xavier_init_f64(struct linear *const layer);
 static cgrad_error linear_xavier_init_f32(struct linear *const layer);
+static cgrad_error linear_xavier_init_half(struct linear *const layer);
 
 cgrad_error linear_init(struct linear *const layer, const size_t in_dim, const size_t out_dim, const cgrad_dtype dtype, struct cgrad_env *const env)
 {
@@ -45,7 +49,18 @@ cgrad_error linear_init(struct linear *const layer, const size_t in_dim, const s
         return TENSOR_ALLOCATION_FAILED;
     }
 
+    struct packed_weight *packed_weight = malloc(sizeof(struct packed_weight));
+    cgrad_error err = packed_weight ? packed_weight_init(packed_weight) : PACKED_WEIGHT_INIT_FAILED;
+    if (err != NO_ERROR)
+    {
+        free(packed_weight);
+        tensor_allocator_free(&env->tensor_alloc, weight);
+        tensor_allocator_free(&env->tensor_alloc, bias);
+        return err;
+    }
+
     layer->env = env;
+    layer->packed_weight = packed_weight;
     layer->in_dim = in_dim;
     layer->out_dim = out_dim;
     layer->weight = weight;
@@ -55,6 +70,62 @@ cgrad_error linear_init(struct linear *const layer, const size_t in_dim, const s
 }
 
 cgrad_error linear_forward(struct linear *const layer, struct tensor *const x, struct tensor **const out, const bool track_grad)
+{
+    if (!layer)
+    {
+        return LINEAR_NULL;
+    }
+
+    return linear_forward_env(layer, x, out, track_grad, layer->env);
+}
+
+cgrad_error linear_forward_env(const struct linear *const layer, struct tensor *const x, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
+{
+    if (!layer)
+    {
+        return LINEAR_NULL;
+    }
+    if (!out)
+    {
+        return LINEAR_OUT_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+
+    // XW computation, multiplying the packed weight when the dtype allows it
+    struct tensor *mult = NULL;
+    cgrad_error err = NO_ERROR;
+    if (layer->weight->dtype == DTYPE_FLOAT64 || layer->weight->dtype == DTYPE_FLOAT32)
+    {
+        const struct gemm_packed_b *packed = NULL;
+        err = packed_weight_get(layer->packed_weight, layer->weight, GEMM_NO_TRANS, &packed, env->pool);
+        if (err == NO_ERROR)
+        {
+            err = tensor2d_mult_packed(x, layer->weight, GEMM_NO_TRANS, packed, &mult, track_grad, env);
+        }
+    }
+    else
+    {
+        err = tensor2d_mult(x, layer->weight, &mult, track_grad, env);
+    }
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // XW + b computation
+    err = tensor2d_add_row_vector(mult, layer->bias, out, track_grad, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return tensor_list_add(env->tensor_alloc_intermediates, mult);
+}
+
+cgrad_error linear_forward_sparse(struct linear *const layer, const struct sparse_tensor *const x, struct tensor **const out, const bool track_grad)
 {
     if (!layer)
     {
@@ -65,22 +136,24 @@ cgrad_error linear_forward(struct linear *const layer, struct tensor *const x, s
         return LINEAR_OUT_NULL;
     }
 
-    // XW computation 
+    struct cgrad_env *env = layer->env;
+
+    // XW computation, reading only the rows of W matching the columns of x holding values
     struct tensor *mult = NULL;
-    cgrad_error err = tensor2d_mult(x, layer->weight, &mult, track_grad, layer->env);
+    cgrad_error err = tensor2d_sparse_mult(x, layer->weight, &mult, track_grad, env);
     if (err != NO_ERROR)
     {
         return err;
     }
 
     // XW + b computation
-    err = tensor2d_add_row_vector(mult, layer->bias, out, track_grad, layer->env);
+    err = tensor2d_add_row_vector(mult, layer->bias, out, track_grad, env);
     if (err != NO_ERROR)
     {
         return err;
     }
 
-    return tensor_list_add(layer->env->tensor_alloc_intermediates, mult);
+    return tensor_list_add(env->tensor_alloc_intermediates, mult);
 }
 
 cgrad_error linear_xavier_init(struct linear *const layer)
@@ -96,6 +169,9 @@ cgrad_error linear_xavier_init(struct linear *const layer)
         return linear_xavier_init_f64(layer);
     case DTYPE_FLOAT32:
         return linear_xavier_init_f32(layer);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return linear_xavier_init_half(layer);
     default:
         return LINEAR_INVALID_DTYPE; 
     }
@@ -111,10 +187,8 @@ static cgrad_error linear_xavier_init_f64(struct linear *const layer)
     const double XAVIER_INIT_NUMERATOR = 6.0;
     double xavier_init_bound = sqrt(XAVIER_INIT_NUMERATOR / (in_dim + out_dim));
 
-    for (size_t i = 0; i < data_size; i++)
-    {
-        data[i] = sample_uniform(-xavier_init_bound, xavier_init_bound);
-    }
+    philox_uniform_f64(&layer->env->rng, data, data_size, -xavier_init_bound, xavier_init_bound);
+    tensor_mark_modified(layer->weight);
 
     return NO_ERROR;
 }
@@ -129,10 +203,22 @@ static cgrad_error linear_xavier_init_f32(struct linear *const layer)
     const float XAVIER_INIT_NUMERATOR = 6.0;
     float xavier_init_bound = sqrt(XAVIER_INIT_NUMERATOR / (in_dim + out_dim));
 
-    for (size_t i = 0; i < data_size; i++)
-    {
-        data[i] = sample_uniform(-xavier_init_bound, xavier_init_bound);
-    }
+    philox_uniform_f32(&layer->env->rng, data, data_size, -xavier_init_bound, xavier_init_bound);
+    tensor_mark_modified(layer->weight);
+
+    return NO_ERROR;
+}
+
+static cgrad_error linear_xavier_init_half(struct linear *const layer)
+{
+    uint16_t *restrict data = layer->weight->data;
+    size_t data_size = layer->weight->data_size;
+
+    const float XAVIER_INIT_NUMERATOR = 6.0;
+    float xavier_init_bound = sqrt(XAVIER_INIT_NUMERATOR / (layer->in_dim + layer->out_dim));
+
+    philox_uniform_half(&layer->env->rng, data, data_size, -xavier_init_bound, xavier_init_bound, layer->weight->dtype);
+    tensor_mark_modified(layer->weight);
 
     return NO_ERROR;
 }
@@ -146,4 +232,7 @@ void linear_cleanup(struct linear *const layer)
 
     tensor_allocator_free(&layer->env->tensor_alloc, layer->weight);
     tensor_allocator_free(&layer->env->tensor_alloc, layer->bias);
+    packed_weight_cleanup(layer->packed_weight);
+    free(layer->packed_weight);
+    layer->packed_weight = NULL;
 }
\ No newline at end of file
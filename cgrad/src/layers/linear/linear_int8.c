@@ -0,0 +1,168 @@
+#include "cgrad/layers/linear_int8.h"
+#include "cgrad/utils/half.h"
+#include <stdlib.h>
+
+static cgrad_error linear_int8_copy_bias(struct linear_int8 *const qlayer, const struct tensor *const bias);
+
+cgrad_error linear_int8_init(struct linear_int8 *const qlayer, const struct linear *const layer, const struct quant_params *const input_params, const quant_granularity granularity)
+{
+    if (!qlayer || !layer)
+    {
+        return LINEAR_NULL;
+    }
+
+    cgrad_error err = quant_params_check(input_params);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    qlayer->env = layer->env;
+    qlayer->in_dim = layer->in_dim;
+    qlayer->out_dim = layer->out_dim;
+    qlayer->input_params = *input_params;
+    qlayer->output_params = (struct quant_params){.scale = 1.0f, .zero_point = 0};
+    qlayer->fuse_relu = false;
+    qlayer->requantize_output = false;
+    qlayer->bias = NULL;
+
+    // The float weight has shape {in_dim, out_dim}, output channels are its columns
+    err = qgemm_weights_pack(&qlayer->weight, layer->weight, layer->out_dim, layer->in_dim, 1, layer->out_dim, granularity, layer->env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = linear_int8_copy_bias(qlayer, layer->bias);
+    if (err != NO_ERROR)
+    {
+        linear_int8_cleanup(qlayer);
+        return err;
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error linear_int8_set_output(struct linear_int8 *const qlayer, const bool relu, const struct quant_params *const output_params)
+{
+    if (!qlayer)
+    {
+        return LINEAR_NULL;
+    }
+
+    if (output_params)
+    {
+        cgrad_error err = quant_params_check(output_params);
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+        qlayer->output_params = *output_params;
+    }
+
+    qlayer->fuse_relu = relu;
+    qlayer->requantize_output = output_params != NULL;
+
+    return NO_ERROR;
+}
+
+cgrad_error linear_int8_forward(struct linear_int8 *const qlayer, const struct tensor *const x, struct tensor **const out)
+{
+    if (!qlayer)
+    {
+        return LINEAR_NULL;
+    }
+    if (!x)
+    {
+        return TENSOR_NULL;
+    }
+    if (!out)
+    {
+        return LINEAR_OUT_NULL;
+    }
+    if (x->shape_size != 2 || x->shape[1] != qlayer->in_dim)
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+
+    struct cgrad_env *env = qlayer->env;
+    cgrad_error err = NO_ERROR;
+
+    struct tensor *x_quantized = (struct tensor *)x;
+    if (x->dtype != DTYPE_UINT8)
+    {
+        if ((err = tensor_quantize(x, &qlayer->input_params, &x_quantized, env)) != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    const size_t batch_size = x->shape[0];
+    const size_t out_shape[] = {batch_size, qlayer->out_dim};
+    *out = tensor_allocator_no_grad_alloc(&env->tensor_alloc, out_shape, 2, qlayer->requantize_output ? DTYPE_UINT8 : DTYPE_FLOAT32);
+    if (!(*out))
+    {
+        err = TENSOR_ALLOCATION_FAILED;
+    }
+    else
+    {
+        const struct qgemm_epilogue epilogue = {
+            .input_params = qlayer->input_params,
+            .bias = qlayer->bias,
+            .relu = qlayer->fuse_relu,
+            .requantize = qlayer->requantize_output,
+            .output_params = qlayer->output_params,
+        };
+        err = qgemm_u8s8(x_quantized->data, batch_size, &qlayer->weight, &epilogue, (*out)->data, qlayer->out_dim, 1);
+    }
+
+    if (x_quantized != x)
+    {
+        tensor_allocator_no_grad_free(&env->tensor_alloc, x_quantized);
+    }
+
+    return err;
+}
+
+void linear_int8_cleanup(struct linear_int8 *const qlayer)
+{
+    if (!qlayer)
+    {
+        return;
+    }
+
+    qgemm_weights_cleanup(&qlayer->weight, qlayer->env);
+    free(qlayer->bias);
+    qlayer->bias = NULL;
+}
+
+static cgrad_error linear_int8_copy_bias(struct linear_int8 *const qlayer, const struct tensor *const bias)
+{
+    // The bias is added to the dequantized accumulators, so it is kept in float32
+    qlayer->bias = malloc(qlayer->out_dim * sizeof(float));
+    if (!qlayer->bias)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    for (size_t j = 0; j < qlayer->out_dim; j++)
+    {
+        switch (bias->dtype)
+        {
+        case DTYPE_FLOAT64:
+            qlayer->bias[j] = (float)((const double *)bias->data)[j];
+            break;
+        case DTYPE_FLOAT32:
+            qlayer->bias[j] = ((const float *)bias->data)[j];
+            break;
+        case DTYPE_BFLOAT16:
+        case DTYPE_FLOAT16:
+            qlayer->bias[j] = half_to_f32(((const uint16_t *)bias->data)[j], bias->dtype);
+            break;
+        default:
+            return LINEAR_INVALID_DTYPE;
+        }
+    }
+
+    return NO_ERROR;
+}
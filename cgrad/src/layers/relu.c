@@ -9,16 +9,29 @@
 #include <immintrin.h>
 #endif
 
+// Elements per range of the parallel loop, a multiple of the vector width keeping ranges aligned
+#define RELU_BLOCK_SIZE 1024
+
 typedef enum relu_layer_operand
 {
     RELU_ONLY_OPERAND,
 } relu_layer_operand;
 
+struct relu_forward_args
+{
+    const struct tensor *x;
+    struct tensor *out;
+};
+
 static inline cgrad_error relu_forward_update_graph(struct tensor *const x, struct tensor **const out, struct cgrad_env *const env);
+static cgrad_error relu_forward_function(const struct backpropagation_context *const ctx, struct tensor *const out);
 static cgrad_error relu_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error relu_backpropagate_f64(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error relu_backpropagate_f32(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
-static cgrad_error relu_forward_dispatch(const struct tensor *const x, struct tensor *const out);
+static cgrad_error relu_backpropagate_half(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error relu_forward_dispatch(const struct tensor *const x, struct tensor *const out, struct thread_pool *const pool);
+static void relu_forward_blocks(void *arg, const size_t begin, const size_t end);
+static cgrad_error relu_forward_half(const struct tensor *const x, struct tensor *const out);
 #if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
 static cgrad_error relu_forward_dispatch_avx_256(const struct tensor *const x, struct tensor *const out);
 static cgrad_error relu_forward_avx_256_f64(const struct tensor *const x, struct tensor *const out);
@@ -42,7 +55,7 @@ cgrad_error relu_forward(struct tensor *const x, struct tensor **const out, cons
 
     (*out) = tensor_allocator_alloc(&env->tensor_alloc, x->shape, x->shape_size, x->dtype);
 
-    cgrad_error err = relu_forward_dispatch(x, *out);
+    cgrad_error err = relu_forward_dispatch(x, *out, env->pool);
     if (err != NO_ERROR)
     {
         return err;
@@ -57,7 +70,18 @@ cgrad_error relu_forward(struct tensor *const x, struct tensor **const out, cons
 
 static inline cgrad_error relu_forward_update_graph(struct tensor *const x, struct tensor **const out, struct cgrad_env *const env)
 {
-    return add_computational_graph_link(x, RELU_ONLY_OPERAND, *out, &relu_backpropagate, env);
+    cgrad_error err = add_computational_graph_link(x, RELU_ONLY_OPERAND, *out, &relu_backpropagate, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_forward_function((*out)->node, &relu_forward_function);
+}
+
+static cgrad_error relu_forward_function(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return relu_forward_dispatch(ctx->operands[RELU_ONLY_OPERAND], out, ctx->pool);
 }
 
 static cgrad_error relu_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
@@ -74,6 +98,9 @@ static cgrad_error relu_backpropagate(const struct backpropagation_context *cons
         return relu_backpropagate_f64(ctx, grad_wrt_out, grad_wrt_operand);
     case DTYPE_FLOAT32:
         return relu_backpropagate_f32(ctx, grad_wrt_out, grad_wrt_operand);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return relu_backpropagate_half(ctx, grad_wrt_out, grad_wrt_operand);
     default:
         return AUTOGRAD_BACKPROPAGATION_INVALID_TENSOR_DTYPE;
     }
@@ -123,15 +150,83 @@ static cgrad_error relu_backpropagate_f32(const struct backpropagation_context *
     return NO_ERROR;
 }
 
-static cgrad_error relu_forward_dispatch(const struct tensor *const x, struct tensor *const out)
+static cgrad_error relu_backpropagate_half(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
 {
+    const struct tensor *const x = ctx->operands[RELU_ONLY_OPERAND];
+    if (!x)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
+    }
+
+    uint16_t *x_data = (uint16_t *)x->data;
+    uint16_t *grad_wrt_operand_data = (uint16_t *)grad_wrt_operand->data;
+    uint16_t *grad_wrt_out_data = (uint16_t *)grad_wrt_out->data;
+    size_t grad_wrt_operand_data_size = grad_wrt_operand->data_size;
+
+    for (size_t i = 0; i < grad_wrt_operand_data_size; i++)
+    {
+        // Positive values have the sign bit clear and are not zero, in both bfloat16 and float16
+        grad_wrt_operand_data[i] = (x_data[i] & 0x8000) || x_data[i] == 0 ? 0 : grad_wrt_out_data[i];
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error relu_forward_dispatch(const struct tensor *const x, struct tensor *const out, struct thread_pool *const pool)
+{
+    switch (x->dtype)
+    {
+    case DTYPE_FLOAT64:
+    case DTYPE_FLOAT32:
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        break;
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    struct relu_forward_args args = {.x = x, .out = out};
+    const size_t n_blocks = (x->data_size + RELU_BLOCK_SIZE - 1) / RELU_BLOCK_SIZE;
+    thread_pool_parallel_for(pool, n_blocks, thread_pool_grain(RELU_BLOCK_SIZE), &relu_forward_blocks, &args);
+
+    return NO_ERROR;
+}
+
+static void relu_forward_blocks(void *arg, const size_t begin, const size_t end)
+{
+    const struct relu_forward_args *args = arg;
+    const size_t first = begin * RELU_BLOCK_SIZE;
+    const size_t last = end * RELU_BLOCK_SIZE < args->x->data_size ? end * RELU_BLOCK_SIZE : args->x->data_size;
+    const size_t offset = first * dtype_sizeof(args->x->dtype);
+
+    // The kernels only read the data and its size, so each range is run as a tensor of its own
+    struct tensor x_block = *args->x;
+    struct tensor out_block = *args->out;
+    x_block.data = (char *)args->x->data + offset;
+    x_block.data_size = last - first;
+    out_block.data = (char *)args->out->data + offset;
+    out_block.data_size = last - first;
+
 #if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
-    return relu_forward_dispatch_avx_256(x, out);
+    relu_forward_dispatch_avx_256(&x_block, &out_block);
 #else
-    return relu_forward_scalar(x, out);
+    relu_forward_scalar(&x_block, &out_block);
 #endif
 }
 
+static cgrad_error relu_forward_half(const struct tensor *const x, struct tensor *const out)
+{
+    // No conversion needed, negative values are the ones with the sign bit set
+    uint16_t *x_data = (uint16_t *)x->data;
+    uint16_t *out_data = (uint16_t *)out->data;
+    for (size_t i = 0; i < out->data_size; i++)
+    {
+        out_data[i] = x_data[i] & 0x8000 ? 0 : x_data[i];
+    }
+
+    return NO_ERROR;
+}
+
 #if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
 static cgrad_error relu_forward_dispatch_avx_256(const struct tensor *const x, struct tensor *const out)
 {
@@ -141,6 +236,9 @@ static cgrad_error relu_forward_dispatch_avx_256(const struct tensor *const x, s
         return relu_forward_avx_256_f64(x, out);
     case DTYPE_FLOAT32:
         return relu_forward_avx_256_f32(x, out);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return relu_forward_half(x, out);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
@@ -212,6 +310,9 @@ static cgrad_error relu_forward_scalar(const struct tensor *const x, struct tens
         return relu_forward_scalar_f64(x, out);
     case DTYPE_FLOAT32:
         return relu_forward_scalar_f32(x, out);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return relu_forward_half(x, out);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
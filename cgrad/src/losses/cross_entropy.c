@@ -1,5 +1,6 @@
 #include "cgrad/losses/cross_entropy.h"
 #include "cgrad/tensor/tensor_get.h"
+#include "cgrad/tensor/tensor_half.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -11,15 +12,37 @@ typedef enum cross_entropy_loss_operand
     CROSS_ENTROPY_TARGET
 } cross_entropy_loss_operand;
 
+struct cross_entropy_loss_args
+{
+    const struct tensor *logits;
+    const struct tensor *targets;
+    void *row_losses;
+};
+
+struct cross_entropy_loss_backpropagate_args
+{
+    const struct tensor *logits;
+    const struct tensor *targets;
+    struct tensor *grad_wrt_operand;
+    double grad_wrt_loss;
+};
+
 static inline cgrad_error cross_entropy_loss_update_graph(struct tensor *const logits, struct tensor *const targets, struct tensor **const z, struct cgrad_env *const env);
-static cgrad_error cross_entropy_loss_dispatch(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z);
-static cgrad_error cross_entropy_loss_f64(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z);
-static cgrad_error cross_entropy_loss_f32(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z);
+static cgrad_error cross_entropy_loss_dispatch(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z, struct thread_pool *const pool);
+static cgrad_error cross_entropy_loss_f64(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z, struct thread_pool *const pool);
+static cgrad_error cross_entropy_loss_f32(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z, struct thread_pool *const pool);
+static cgrad_error cross_entropy_loss_half(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z, struct thread_pool *const pool);
+static void cross_entropy_loss_rows_f64(void *arg, const size_t begin, const size_t end);
+static void cross_entropy_loss_rows_f32(void *arg, const size_t begin, const size_t end);
 static double compute_softmax_normalization_f64(const struct tensor *const logits, const size_t row);
 static float compute_softmax_normalization_f32(const struct tensor *const logits, const size_t row);
+static cgrad_error cross_entropy_loss_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
 static cgrad_error cross_entropy_loss_backpropagate_predicted(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error cross_entropy_loss_backpropagate_predicted_f64(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error cross_entropy_loss_backpropagate_predicted_f32(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error cross_entropy_loss_backpropagate_predicted_half(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static void cross_entropy_loss_backpropagate_rows_f64(void *arg, const size_t begin, const size_t end);
+static void cross_entropy_loss_backpropagate_rows_f32(void *arg, const size_t begin, const size_t end);
 
 cgrad_error cross_entropy_loss(struct tensor *const logits, struct tensor *const targets, struct tensor **const z, const bool track_grad, struct cgrad_env *const env)
 {
@@ -42,16 +65,18 @@ cgrad_error cross_entropy_loss(struct tensor *const logits, struct tensor *const
         return TENSOR_WRONG_SHAPE;
     }
 
+    // The loss of half precision logits is float32, so that it can be scaled without overflowing
     const size_t shape[] = {1, 1};
     const size_t shape_size = 2;
-    (*z) = tensor_allocator_alloc(&env->tensor_alloc, shape, shape_size, logits->dtype);
+    const cgrad_dtype loss_dtype = dtype_is_half(logits->dtype) ? DTYPE_FLOAT32 : logits->dtype;
+    (*z) = tensor_allocator_alloc(&env->tensor_alloc, shape, shape_size, loss_dtype);
 
     if (!(*z))
     {
         return TENSOR_ALLOCATION_FAILED;
     }
 
-    cgrad_error err = cross_entropy_loss_dispatch(logits, targets, *z);
+    cgrad_error err = cross_entropy_loss_dispatch(logits, targets, *z, env->pool);
     if (err != NO_ERROR)
     {
         return err;
@@ -76,31 +101,69 @@ static inline cgrad_error cross_entropy_loss_update_graph(struct tensor *const l
     }
 
     // Setup operands manually, as the target was not added to the computational graph as node
-    return computational_graph_node_set_context_tensor((*z)->node, targets, CROSS_ENTROPY_TARGET);
+    err = computational_graph_node_set_context_tensor((*z)->node, targets, CROSS_ENTROPY_TARGET);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_forward_function((*z)->node, &cross_entropy_loss_forward);
 }
 
-static cgrad_error cross_entropy_loss_dispatch(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z)
+static cgrad_error cross_entropy_loss_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return cross_entropy_loss_dispatch(ctx->operands[CROSS_ENTROPY_PREDICTED], ctx->operands[CROSS_ENTROPY_TARGET], out, ctx->pool);
+}
+
+static cgrad_error cross_entropy_loss_dispatch(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z, struct thread_pool *const pool)
 {
     switch (logits->dtype)
     {
     case DTYPE_FLOAT64:
-        return cross_entropy_loss_f64(logits, targets, z);
+        return cross_entropy_loss_f64(logits, targets, z, pool);
     case DTYPE_FLOAT32:
-        return cross_entropy_loss_f32(logits, targets, z);
+        return cross_entropy_loss_f32(logits, targets, z, pool);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return cross_entropy_loss_half(logits, targets, z, pool);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
 }
 
-static cgrad_error cross_entropy_loss_f64(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z)
+static cgrad_error cross_entropy_loss_f64(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z, struct thread_pool *const pool)
 {
-    double batch_size = logits->shape[0];
+    size_t batch_size = logits->shape[0];
+    double *row_losses = malloc(batch_size * sizeof(double));
+    if (!row_losses)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    struct cross_entropy_loss_args args = {.logits = logits, .targets = targets, .row_losses = row_losses};
+    thread_pool_parallel_for(pool, batch_size, thread_pool_grain(2 * logits->shape[1]), &cross_entropy_loss_rows_f64, &args);
+
+    // Rows are summed in order, so that the loss does not depend on the number of threads
     double *z_data = (double *)z->data;
     z_data[0] = 0;
     for (size_t i = 0; i < batch_size; i++)
+    {
+        z_data[0] += row_losses[i];
+    }
+    z_data[0] /= (double)batch_size;
+
+    free(row_losses);
+    return NO_ERROR;
+}
+
+static void cross_entropy_loss_rows_f64(void *arg, const size_t begin, const size_t end)
+{
+    const struct cross_entropy_loss_args *args = arg;
+    double *row_losses = args->row_losses;
+    for (size_t i = begin; i < end; i++)
     {
         double target_label_double = 0;
-        tensor2d_get(targets, i, 0, &target_label_double);
+        tensor2d_get(args->targets, i, 0, &target_label_double);
         int target_label = (int)target_label_double;
 
         // Use relation:
@@ -108,27 +171,47 @@ static cgrad_error cross_entropy_loss_f64(const struct tensor *const logits, con
 
         // Compute -logit_c
         double logit_target_label = 0;
-        tensor2d_get(logits, i, target_label, &logit_target_label);
+        tensor2d_get(args->logits, i, target_label, &logit_target_label);
 
         // Compute \sum_k e^{logit_k}
-        double softmax_normalization = compute_softmax_normalization_f64(logits, i);
+        double softmax_normalization = compute_softmax_normalization_f64(args->logits, i);
 
-        z_data[0] += (-logit_target_label + log(softmax_normalization));
+        row_losses[i] = -logit_target_label + log(softmax_normalization);
     }
-    z_data[0] /= batch_size;
-
-    return NO_ERROR;
 }
 
-static cgrad_error cross_entropy_loss_f32(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const loss)
+static cgrad_error cross_entropy_loss_f32(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const loss, struct thread_pool *const pool)
 {
-    float batch_size = logits->shape[0];
+    size_t batch_size = logits->shape[0];
+    float *row_losses = malloc(batch_size * sizeof(float));
+    if (!row_losses)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    struct cross_entropy_loss_args args = {.logits = logits, .targets = targets, .row_losses = row_losses};
+    thread_pool_parallel_for(pool, batch_size, thread_pool_grain(2 * logits->shape[1]), &cross_entropy_loss_rows_f32, &args);
+
     float *z_data = (float *)loss->data;
     z_data[0] = 0;
     for (size_t i = 0; i < batch_size; i++)
+    {
+        z_data[0] += row_losses[i];
+    }
+    z_data[0] /= (float)batch_size;
+
+    free(row_losses);
+    return NO_ERROR;
+}
+
+static void cross_entropy_loss_rows_f32(void *arg, const size_t begin, const size_t end)
+{
+    const struct cross_entropy_loss_args *args = arg;
+    float *row_losses = args->row_losses;
+    for (size_t i = begin; i < end; i++)
     {
         float target_label_float = 0;
-        tensor2d_get(targets, i, 0, &target_label_float);
+        tensor2d_get(args->targets, i, 0, &target_label_float);
         int target_label = (int)target_label_float;
 
         // Use relation:
@@ -136,16 +219,28 @@ static cgrad_error cross_entropy_loss_f32(const struct tensor *const logits, con
 
         // Compute -logit_c
         float logit_target_label = 0;
-        tensor2d_get(logits, i, target_label, &logit_target_label);
+        tensor2d_get(args->logits, i, target_label, &logit_target_label);
 
         // Compute \sum_k e^{logit_k}
-        float softmax_normalization = compute_softmax_normalization_f32(logits, i);
+        float softmax_normalization = compute_softmax_normalization_f32(args->logits, i);
 
-        z_data[0] += (-logit_target_label + logf(softmax_normalization));
+        row_losses[i] = -logit_target_label + logf(softmax_normalization);
     }
-    z_data[0] /= batch_size;
+}
 
-    return NO_ERROR;
+static cgrad_error cross_entropy_loss_half(const struct tensor *const logits, const struct tensor *const targets, struct tensor *const z, struct thread_pool *const pool)
+{
+    struct tensor logits_f32 = {0};
+
+    cgrad_error err = tensor_half_widen(logits, &logits_f32);
+    if (err == NO_ERROR)
+    {
+        err = cross_entropy_loss_f32(&logits_f32, targets, z, pool);
+    }
+
+    tensor_half_release_f32(&logits_f32);
+
+    return err;
 }
 
 static cgrad_error cross_entropy_loss_backpropagate_predicted(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
@@ -156,6 +251,9 @@ static cgrad_error cross_entropy_loss_backpropagate_predicted(const struct backp
         return cross_entropy_loss_backpropagate_predicted_f64(ctx, grad_wrt_out, grad_wrt_operand);
     case DTYPE_FLOAT32:
         return cross_entropy_loss_backpropagate_predicted_f32(ctx, grad_wrt_out, grad_wrt_operand);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return cross_entropy_loss_backpropagate_predicted_half(ctx, grad_wrt_out, grad_wrt_operand);
     default:
         return AUTOGRAD_BACKPROPAGATION_INVALID_TENSOR_DTYPE;
     }
@@ -164,15 +262,30 @@ static cgrad_error cross_entropy_loss_backpropagate_predicted(const struct backp
 static cgrad_error cross_entropy_loss_backpropagate_predicted_f64(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
 {
     const struct tensor *logits = ctx->operands[CROSS_ENTROPY_PREDICTED];
-    const struct tensor *targets = ctx->operands[CROSS_ENTROPY_TARGET];
+    struct cross_entropy_loss_backpropagate_args args = {
+        .logits = logits,
+        .targets = ctx->operands[CROSS_ENTROPY_TARGET],
+        .grad_wrt_operand = grad_wrt_operand,
+        .grad_wrt_loss = ((double *)grad_wrt_out->data)[0],
+    };
+    thread_pool_parallel_for(ctx->pool, logits->shape[0], thread_pool_grain(3 * logits->shape[1]), &cross_entropy_loss_backpropagate_rows_f64, &args);
+
+    return NO_ERROR;
+}
+
+static void cross_entropy_loss_backpropagate_rows_f64(void *arg, const size_t begin, const size_t end)
+{
+    const struct cross_entropy_loss_backpropagate_args *args = arg;
+    const struct tensor *logits = args->logits;
     double batch_size = logits->shape[0];
     size_t num_classes = logits->shape[1];
-    double *grad_wrt_operand_data = (double *)grad_wrt_operand->data;
+    double *grad_wrt_operand_data = (double *)args->grad_wrt_operand->data;
+    double grad_wrt_loss = args->grad_wrt_loss;
 
-    for (size_t i = 0; i < batch_size; i++)
+    for (size_t i = begin; i < end; i++)
     {
         double target_label_double = 0;
-        tensor2d_get(targets, i, 0, &target_label_double);
+        tensor2d_get(args->targets, i, 0, &target_label_double);
         int target_label = (int)target_label_double;
 
         double softmax_normalization = compute_softmax_normalization_f64(logits, i);
@@ -185,26 +298,39 @@ static cgrad_error cross_entropy_loss_backpropagate_predicted_f64(const struct b
             double predicted = exp(logit) / softmax_normalization;
             double target = target_label == j ? 1 : 0;
 
-            // dL/dlogit_j = (predicted_j - target_j)
-            grad_wrt_operand_data[i * num_classes + j] = (predicted - target) / batch_size;
+            // dL/dlogit_j = (predicted_j - target_j), scaled by the gradient of the loss (e.g. loss scaling)
+            grad_wrt_operand_data[i * num_classes + j] = grad_wrt_loss * (predicted - target) / batch_size;
         }
     }
-
-    return NO_ERROR;
 }
 
 static cgrad_error cross_entropy_loss_backpropagate_predicted_f32(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
 {
     const struct tensor *logits = ctx->operands[CROSS_ENTROPY_PREDICTED];
-    const struct tensor *targets = ctx->operands[CROSS_ENTROPY_TARGET];
+    struct cross_entropy_loss_backpropagate_args args = {
+        .logits = logits,
+        .targets = ctx->operands[CROSS_ENTROPY_TARGET],
+        .grad_wrt_operand = grad_wrt_operand,
+        .grad_wrt_loss = ((float *)grad_wrt_out->data)[0],
+    };
+    thread_pool_parallel_for(ctx->pool, logits->shape[0], thread_pool_grain(3 * logits->shape[1]), &cross_entropy_loss_backpropagate_rows_f32, &args);
+
+    return NO_ERROR;
+}
+
+static void cross_entropy_loss_backpropagate_rows_f32(void *arg, const size_t begin, const size_t end)
+{
+    const struct cross_entropy_loss_backpropagate_args *args = arg;
+    const struct tensor *logits = args->logits;
     float batch_size = logits->shape[0];
     size_t num_classes = logits->shape[1];
-    float *grad_wrt_operand_data = (float *)grad_wrt_operand->data;
+    float *grad_wrt_operand_data = (float *)args->grad_wrt_operand->data;
+    float grad_wrt_loss = (float)args->grad_wrt_loss;
 
-    for (size_t i = 0; i < batch_size; i++)
+    for (size_t i = begin; i < end; i++)
     {
         float target_label_float = 0;
-        tensor2d_get(targets, i, 0, &target_label_float);
+        tensor2d_get(args->targets, i, 0, &target_label_float);
         int target_label = (int)target_label_float;
 
         float softmax_normalization = compute_softmax_normalization_f32(logits, i);
@@ -217,12 +343,35 @@ static cgrad_error cross_entropy_loss_backpropagate_predicted_f32(const struct b
             float predicted = expf(logit) / softmax_normalization;
             float target = target_label == j ? 1 : 0;
 
-            // dL/dlogit_j = (predicted_j - target_j)
-            grad_wrt_operand_data[i * num_classes + j] = (predicted - target) / batch_size;
+            // dL/dlogit_j = (predicted_j - target_j), scaled by the gradient of the loss (e.g. loss scaling)
+            grad_wrt_operand_data[i * num_classes + j] = grad_wrt_loss * (predicted - target) / batch_size;
         }
     }
+}
 
-    return NO_ERROR;
+static cgrad_error cross_entropy_loss_backpropagate_predicted_half(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    struct tensor logits_f32 = {0};
+    struct tensor grad_wrt_operand_f32 = {0};
+
+    // Same context, with the logits replaced by their float32 copy. The loss, hence grad_wrt_out, is float32.
+    struct backpropagation_context ctx_f32 = *ctx;
+
+    cgrad_error err = NO_ERROR;
+    if ((err = tensor_half_widen(ctx->operands[CROSS_ENTROPY_PREDICTED], &logits_f32)) == NO_ERROR &&
+        (err = tensor_half_alloc_f32(grad_wrt_operand, &grad_wrt_operand_f32)) == NO_ERROR)
+    {
+        ctx_f32.operands[CROSS_ENTROPY_PREDICTED] = &logits_f32;
+        if ((err = cross_entropy_loss_backpropagate_predicted_f32(&ctx_f32, grad_wrt_out, &grad_wrt_operand_f32)) == NO_ERROR)
+        {
+            tensor_half_narrow(&grad_wrt_operand_f32, grad_wrt_operand);
+        }
+    }
+
+    tensor_half_release_f32(&logits_f32);
+    tensor_half_release_f32(&grad_wrt_operand_f32);
+
+    return err;
 }
 
 static double compute_softmax_normalization_f64(const struct tensor *const logits, const size_t row)
@@ -15,6 +15,7 @@ static inline cgrad_error mse_loss_update_graph(struct tensor *const y_pred, str
 static cgrad_error mse_loss_dispatch(const struct tensor *const y_pred, const struct tensor *const y_target, struct tensor *const z);
 static cgrad_error mse_loss_f64(const struct tensor *const y_pred, const struct tensor *const y_target, struct tensor *const z);
 static cgrad_error mse_loss_f32(const struct tensor *const y_pred, const struct tensor *const y_target, struct tensor *const z);
+static cgrad_error mse_loss_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
 static cgrad_error mse_loss_backpropagate_predicted(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error mse_loss_backpropagate_predicted_f64(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error mse_loss_backpropagate_predicted_f32(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
@@ -72,7 +73,18 @@ static inline cgrad_error mse_loss_update_graph(struct tensor *const y_pred, str
         return err;
     }
 
-    return add_computational_graph_link(y_target, MSE_TARGET, *z, &mse_loss_backpropagate_target, env);
+    err = add_computational_graph_link(y_target, MSE_TARGET, *z, &mse_loss_backpropagate_target, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_forward_function((*z)->node, &mse_loss_forward);
+}
+
+static cgrad_error mse_loss_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return mse_loss_dispatch(ctx->operands[MSE_PREDICTED], ctx->operands[MSE_TARGET], out);
 }
 
 static cgrad_error mse_loss_dispatch(const struct tensor *const y_pred, const struct tensor *const y_target, struct tensor *const z)
@@ -149,11 +161,12 @@ static cgrad_error mse_loss_backpropagate_predicted_f64(const struct backpropaga
     double *grad_wrt_operand_data = (double *)grad_wrt_operand->data;
     double *predicted_data = (double *)predicted->data;
     double *target_data = (double *)target->data;
+    double grad_wrt_loss = ((double *)grad_wrt_out->data)[0];
 
     double batch_size = target->shape[0];
     for (size_t i = 0; i < batch_size; i++)
     {
-        grad_wrt_operand_data[i] = (predicted_data[i] - target_data[i]) / batch_size;
+        grad_wrt_operand_data[i] = grad_wrt_loss * (predicted_data[i] - target_data[i]) / batch_size;
     }
 
     return NO_ERROR;
@@ -167,11 +180,12 @@ static cgrad_error mse_loss_backpropagate_predicted_f32(const struct backpropaga
     float *grad_wrt_operand_data = (float *)grad_wrt_operand->data;
     float *predicted_data = (float *)predicted->data;
     float *target_data = (float *)target->data;
+    float grad_wrt_loss = ((float *)grad_wrt_out->data)[0];
 
     float batch_size = target->shape[0];
     for (size_t i = 0; i < batch_size; i++)
     {
-        grad_wrt_operand_data[i] = (predicted_data[i] - target_data[i]) / batch_size;
+        grad_wrt_operand_data[i] = grad_wrt_loss * (predicted_data[i] - target_data[i]) / batch_size;
     }
 
     return NO_ERROR;
@@ -59,6 +59,13 @@ static struct computational_graph_node *computational_graph_cpu_alloc(void *pool
     node->is_involved_in_backprop = false;
     node->is_grad_computed = false;
     node->pushed_gradients_count = 0;
+    node->forward = NULL;
+    node->backward_reads_operands = true;
+    node->forward_inplace = false;
+    node->checkpoint_segment = 0;
+    node->is_recomputed = false;
+    node->is_leaf = true;
+    node->is_intermediate = false;
 
     // Initialize arrays to prevent undefined behavior
     memset(node->parents, 0, sizeof(node->parents));
@@ -66,6 +73,7 @@ static struct computational_graph_node *computational_graph_cpu_alloc(void *pool
     // memset(node->parents_operands, 0, sizeof(node->parents_operands));
     memset(node->children_operands, 0, sizeof(node->children_operands));
     memset(node->function, 0, sizeof(node->function));
+    memset(node->function_accumulates, 0, sizeof(node->function_accumulates));
     // context_init(&node->ctx, tensor_alloc); // Pointer is not NULL at this point
 
     return node;
@@ -75,7 +83,8 @@ static void computational_graph_cpu_free(void *pool, struct computational_graph_
 {
     struct computational_graph_cpu_pool *cpu_pool = (struct computational_graph_cpu_pool *)pool;
 
-    if (node->t->node)
+    // The tensor may have been detached and linked to another node in the meantime
+    if (node->t->node == node)
     {
         node->t->node = NULL;
     }
@@ -15,6 +15,10 @@ static void tensor_cpu_no_grad_free(void *pool, struct tensor *t);
 
 static struct tensor *tensor_cpu_clone(void *pool, const struct tensor *const src);
 
+static void *tensor_cpu_data_alloc(void *pool, const size_t size);
+
+static void tensor_cpu_data_free(void *pool, void *data);
+
 static void compute_stride(size_t *const shape, size_t *const stride, size_t const shape_size);
 
 cgrad_error tensor_cpu_allocator_init(struct tensor_allocator *const tensor_alloc)
@@ -43,6 +47,8 @@ cgrad_error tensor_cpu_allocator_init(struct tensor_allocator *const tensor_allo
     tensor_alloc->free = tensor_cpu_free,
     tensor_alloc->no_grad_free = tensor_cpu_no_grad_free,
     tensor_alloc->clone = tensor_cpu_clone,
+    tensor_alloc->data_alloc = tensor_cpu_data_alloc,
+    tensor_alloc->data_free = tensor_cpu_data_free,
     tensor_alloc->pool = tensor_pool;
 
     return NO_ERROR;
@@ -61,28 +67,9 @@ void tensor_cpu_allocator_cleanup(struct tensor_allocator *const tensor_alloc)
 
 static struct tensor *tensor_cpu_alloc(void *pool, const size_t *const shape, const size_t shape_size, const cgrad_dtype dtype)
 {
-    struct tensor_cpu_pool *cpu_pool = (struct tensor_cpu_pool *)pool;
-    struct tensor *t = tensor_cpu_no_grad_alloc(cpu_pool, shape, shape_size, dtype);
-    if (!t)
-    {
-        return NULL;
-    }
-
-    // Allocate gradient only for real value tensors
-    if (dtype == DTYPE_FLOAT32 || dtype == DTYPE_FLOAT64)
-    {
-        t->grad = tensor_cpu_no_grad_zero_alloc(cpu_pool, shape, shape_size, dtype);
-        if (!t->grad)
-        {
-            tensor_cpu_free(cpu_pool, t);
-            return NULL;
-        }
-    }
-    else
-    {
-        t->grad = NULL;
-    }
-    return t;
+    // The gradient is allocated lazily, only for tensors which actually receive one
+    // during backpropagation (see tensor_allocator_alloc_grad).
+    return tensor_cpu_no_grad_alloc(pool, shape, shape_size, dtype);
 }
 
 static struct tensor *tensor_cpu_no_grad_alloc(void *pool, const size_t *const shape, const size_t shape_size, const cgrad_dtype dtype)
@@ -118,7 +105,10 @@ static struct tensor *tensor_cpu_no_grad_alloc(void *pool, const size_t *const s
     t->data_size = data_size;
     t->shape_size = shape_size;
     t->grad = NULL;
+    t->grad_rows = NULL;
     t->dtype = dtype;
+    t->version = 0;
+    t->requires_grad = true;
 
     return t;
 }
@@ -156,7 +146,10 @@ static struct tensor *tensor_cpu_no_grad_zero_alloc(void *pool, const size_t *co
     t->data_size = data_size;
     t->shape_size = shape_size;
     t->grad = NULL;
+    t->grad_rows = NULL;
     t->dtype = dtype;
+    t->version = 0;
+    t->requires_grad = true;
 
     return t;
 }
@@ -190,6 +183,11 @@ static void tensor_cpu_free(void *pool, struct tensor *t)
         tensor_cpu_no_grad_free(cpu_pool, t->grad);
         t->grad = NULL;
     }
+    if (t->grad_rows)
+    {
+        tensor_cpu_no_grad_free(cpu_pool, t->grad_rows);
+        t->grad_rows = NULL;
+    }
 
     if (t->node)
     {
@@ -230,6 +228,16 @@ static struct tensor *tensor_cpu_clone(void *pool, const struct tensor *const sr
     return new_tensor;
 }
 
+static void *tensor_cpu_data_alloc(void *pool, const size_t size)
+{
+    return tensor_cpu_pool_data_alloc((struct tensor_cpu_pool *)pool, size);
+}
+
+static void tensor_cpu_data_free(void *pool, void *data)
+{
+    tensor_cpu_pool_data_free((struct tensor_cpu_pool *)pool, data);
+}
+
 static void compute_stride(size_t *const shape, size_t *const stride, size_t const shape_size)
 {
     stride[shape_size - 1] = 1;
@@ -31,7 +31,8 @@ cgrad_error tensor_cpu_pool_init(struct tensor_cpu_pool *pool)
      */
     pool->data_memory = aligned_alloc(TENSOR_CPU_POOL_DATA_ALIGNMENT, MEMORY_TENSOR_POOL_N_CHUNKS * DATA_CHUNK_SIZE);
 
-    memset(pool->data_memory, 0, MEMORY_TENSOR_POOL_N_CHUNKS * DATA_CHUNK_SIZE);
+    // Not zeroed here, as data is zeroed on allocation: pages of unused chunks are never touched, so creating
+    // a pool, e.g. one per thread, costs no more than the chunk headers
     if (!pool->data_memory)
     {
         free(pool->tensor_memory);
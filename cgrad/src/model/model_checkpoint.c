@@ -0,0 +1,513 @@
+#include "cgrad/model/model_checkpoint.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MODEL_CHECKPOINT_MAGIC "CGRADCKP"
+#define MODEL_CHECKPOINT_BYTE_ORDER 0x01020304u
+#define MODEL_CHECKPOINT_MAX_SHAPE_SIZE 8
+
+_Static_assert(TENSOR_MAX_SHAPE_SIZE <= MODEL_CHECKPOINT_MAX_SHAPE_SIZE, "Tensor shapes do not fit checkpoint entries");
+
+typedef enum
+{
+    MODEL_CHECKPOINT_ENTRY_PARAM,
+    MODEL_CHECKPOINT_ENTRY_SGD_MOMENTUM,
+    MODEL_CHECKPOINT_ENTRY_SGD_MASTER,
+} model_checkpoint_entry_kind;
+
+// On-disk layout, fields are stored in the byte order of the writer, which is checked when reading
+struct model_checkpoint_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t n_entries;
+    uint32_t n_params;
+    uint64_t file_size;
+    uint8_t reserved[32];
+};
+
+struct model_checkpoint_entry
+{
+    uint32_t kind;
+    uint32_t index;
+    uint32_t dtype;       /**< cgrad_dtype value, new dtypes are only appended to the enum. */
+    uint32_t shape_size;
+    uint64_t shape[MODEL_CHECKPOINT_MAX_SHAPE_SIZE];
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct model_checkpoint_file
+{
+    void *addr;
+    size_t size;
+    const struct model_checkpoint_header *header;
+    const struct model_checkpoint_entry *entries;
+};
+
+static cgrad_error model_checkpoint_write(FILE *file, const struct model_params *const params, const struct sgd_optimizer *const opt);
+static size_t model_checkpoint_layout(const struct model_params *const params, const struct sgd_optimizer *const opt, const struct tensor **tensors, struct model_checkpoint_entry *entries, struct model_checkpoint_header *const header);
+static size_t model_checkpoint_collect(const struct model_params *const params, const struct sgd_optimizer *const opt, const struct tensor **tensors, struct model_checkpoint_entry *entries);
+static cgrad_error model_checkpoint_open(struct model_checkpoint_file *const file, const char *const path);
+static void model_checkpoint_close(struct model_checkpoint_file *const file);
+static const struct model_checkpoint_entry *model_checkpoint_find(const struct model_checkpoint_file *const file, const model_checkpoint_entry_kind kind, const size_t index);
+static bool model_checkpoint_entry_matches(const struct model_checkpoint_entry *const entry, const struct tensor *const t);
+static cgrad_error model_checkpoint_check_params(const struct model_checkpoint_file *const file, const struct model_params *const params);
+static cgrad_error model_checkpoint_load_entry(const struct model_checkpoint_file *const file, const model_checkpoint_entry_kind kind, const size_t index, struct tensor *const t);
+static size_t model_checkpoint_align(const size_t offset);
+
+cgrad_error model_checkpoint_save(const struct model_params *const params, const struct sgd_optimizer *const opt, const char *const path)
+{
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!path)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    char *tmp_path = malloc(strlen(path) + sizeof(".tmp"));
+    if (!tmp_path)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+    strcpy(tmp_path, path);
+    strcat(tmp_path, ".tmp");
+
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file)
+    {
+        free(tmp_path);
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    cgrad_error err = model_checkpoint_write(file, params, opt);
+    if (fclose(file) != 0 && err == NO_ERROR)
+    {
+        err = MODEL_CHECKPOINT_FILE_ERROR;
+    }
+    if (err == NO_ERROR && rename(tmp_path, path) != 0)
+    {
+        err = MODEL_CHECKPOINT_FILE_ERROR;
+    }
+    if (err != NO_ERROR)
+    {
+        remove(tmp_path);
+    }
+
+    free(tmp_path);
+    return err;
+}
+
+size_t model_checkpoint_image_size(const struct model_params *const params, const struct sgd_optimizer *const opt)
+{
+    if (!params)
+    {
+        return 0;
+    }
+
+    const struct tensor *tensors[3 * MODEL_MAX_PARAMS];
+    struct model_checkpoint_entry entries[3 * MODEL_MAX_PARAMS];
+    struct model_checkpoint_header header;
+    model_checkpoint_layout(params, opt, tensors, entries, &header);
+
+    return header.file_size;
+}
+
+cgrad_error model_checkpoint_image(const struct model_params *const params, const struct sgd_optimizer *const opt, void *const image, const size_t size)
+{
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+
+    const struct tensor *tensors[3 * MODEL_MAX_PARAMS];
+    struct model_checkpoint_entry entries[3 * MODEL_MAX_PARAMS];
+    struct model_checkpoint_header header;
+    const size_t n_entries = model_checkpoint_layout(params, opt, tensors, entries, &header);
+    if (!image || size < header.file_size)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    // Only the padding is zeroed, every other byte is copied once
+    uint8_t *dst = (uint8_t *)image;
+    memcpy(dst, &header, sizeof(header));
+    memcpy(dst + sizeof(header), entries, n_entries * sizeof(struct model_checkpoint_entry));
+    size_t written = sizeof(header) + n_entries * sizeof(struct model_checkpoint_entry);
+    for (size_t i = 0; i < n_entries; i++)
+    {
+        memset(dst + written, 0, entries[i].offset - written);
+        memcpy(dst + entries[i].offset, tensors[i]->data, entries[i].size);
+        written = entries[i].offset + entries[i].size;
+    }
+    memset(dst + written, 0, header.file_size - written);
+
+    return NO_ERROR;
+}
+
+cgrad_error model_checkpoint_load(struct model_params *const params, struct sgd_optimizer *const opt, const char *const path)
+{
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+
+    struct model_checkpoint_file file;
+    cgrad_error err = model_checkpoint_open(&file, path);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if ((err = model_checkpoint_check_params(&file, params)) != NO_ERROR)
+    {
+        model_checkpoint_close(&file);
+        return err;
+    }
+
+    for (size_t i = 0; i < params->size && err == NO_ERROR; i++)
+    {
+        err = model_checkpoint_load_entry(&file, MODEL_CHECKPOINT_ENTRY_PARAM, i, params->params[i]);
+    }
+
+    if (opt && err == NO_ERROR)
+    {
+        for (size_t i = 0; i < opt->size && err == NO_ERROR; i++)
+        {
+            if (model_checkpoint_find(&file, MODEL_CHECKPOINT_ENTRY_SGD_MOMENTUM, i))
+            {
+                err = model_checkpoint_load_entry(&file, MODEL_CHECKPOINT_ENTRY_SGD_MOMENTUM, i, opt->prev_b_t[i]);
+            }
+            if (opt->master[i] && err == NO_ERROR && model_checkpoint_find(&file, MODEL_CHECKPOINT_ENTRY_SGD_MASTER, i))
+            {
+                err = model_checkpoint_load_entry(&file, MODEL_CHECKPOINT_ENTRY_SGD_MASTER, i, opt->master[i]);
+            }
+        }
+    }
+
+    model_checkpoint_close(&file);
+    return err;
+}
+
+cgrad_error model_checkpoint_map(struct model_checkpoint_mapping *const mapping, struct model_params *const params, const char *const path)
+{
+    if (!mapping)
+    {
+        return MODEL_CHECKPOINT_MAPPING_NULL;
+    }
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+
+    struct model_checkpoint_file file;
+    cgrad_error err = model_checkpoint_open(&file, path);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if ((err = model_checkpoint_check_params(&file, params)) != NO_ERROR)
+    {
+        model_checkpoint_close(&file);
+        return err;
+    }
+
+    mapping->addr = file.addr;
+    mapping->size = file.size;
+    mapping->params = params;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct model_checkpoint_entry *entry = model_checkpoint_find(&file, MODEL_CHECKPOINT_ENTRY_PARAM, i);
+        mapping->params_data[i] = params->params[i]->data;
+        params->params[i]->data = (char *)file.addr + entry->offset;
+        tensor_mark_modified(params->params[i]);
+    }
+
+    return NO_ERROR;
+}
+
+void model_checkpoint_unmap(struct model_checkpoint_mapping *const mapping)
+{
+    if (!mapping || !mapping->addr)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < mapping->params->size; i++)
+    {
+        mapping->params->params[i]->data = mapping->params_data[i];
+        tensor_mark_modified(mapping->params->params[i]);
+    }
+
+    munmap(mapping->addr, mapping->size);
+    mapping->addr = NULL;
+}
+
+static cgrad_error model_checkpoint_write(FILE *file, const struct model_params *const params, const struct sgd_optimizer *const opt)
+{
+    const struct tensor *tensors[3 * MODEL_MAX_PARAMS];
+    struct model_checkpoint_entry entries[3 * MODEL_MAX_PARAMS];
+    struct model_checkpoint_header header;
+    const size_t n_entries = model_checkpoint_layout(params, opt, tensors, entries, &header);
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+    if (n_entries > 0 && fwrite(entries, sizeof(struct model_checkpoint_entry), n_entries, file) != n_entries)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    static const uint8_t padding[MODEL_CHECKPOINT_ALIGNMENT] = {0};
+    size_t written = sizeof(header) + n_entries * sizeof(struct model_checkpoint_entry);
+    for (size_t i = 0; i < n_entries; i++)
+    {
+        const size_t pad = entries[i].offset - written;
+        if (pad > 0 && fwrite(padding, 1, pad, file) != pad)
+        {
+            return MODEL_CHECKPOINT_FILE_ERROR;
+        }
+        if (entries[i].size > 0 && fwrite(tensors[i]->data, 1, entries[i].size, file) != entries[i].size)
+        {
+            return MODEL_CHECKPOINT_FILE_ERROR;
+        }
+        written = entries[i].offset + entries[i].size;
+    }
+
+    // Pad the last tensor as well, so that the size of the file matches the header
+    const size_t pad = header.file_size - written;
+    if (pad > 0 && fwrite(padding, 1, pad, file) != pad)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+static size_t model_checkpoint_layout(const struct model_params *const params, const struct sgd_optimizer *const opt, const struct tensor **tensors, struct model_checkpoint_entry *entries, struct model_checkpoint_header *const header)
+{
+    const size_t n_entries = model_checkpoint_collect(params, opt, tensors, entries);
+
+    // Data follows the header and the entries table, each tensor starting at an aligned offset
+    size_t offset = model_checkpoint_align(sizeof(struct model_checkpoint_header) + n_entries * sizeof(struct model_checkpoint_entry));
+    for (size_t i = 0; i < n_entries; i++)
+    {
+        entries[i].offset = offset;
+        offset = model_checkpoint_align(offset + entries[i].size);
+    }
+
+    memset(header, 0, sizeof(struct model_checkpoint_header));
+    memcpy(header->magic, MODEL_CHECKPOINT_MAGIC, sizeof(header->magic));
+    header->version = MODEL_CHECKPOINT_VERSION;
+    header->byte_order = MODEL_CHECKPOINT_BYTE_ORDER;
+    header->n_entries = n_entries;
+    header->n_params = params->size;
+    header->file_size = offset;
+
+    return n_entries;
+}
+
+static size_t model_checkpoint_collect(const struct model_params *const params, const struct sgd_optimizer *const opt, const struct tensor **tensors, struct model_checkpoint_entry *entries)
+{
+    size_t n_entries = 0;
+
+    for (size_t i = 0; i < 3 * params->size; i++)
+    {
+        const size_t index = i % params->size;
+        const model_checkpoint_entry_kind kind = i / params->size;
+
+        const struct tensor *t = NULL;
+        switch (kind)
+        {
+        case MODEL_CHECKPOINT_ENTRY_PARAM:
+            t = params->params[index];
+            break;
+        case MODEL_CHECKPOINT_ENTRY_SGD_MOMENTUM:
+            t = opt && index < opt->size ? opt->prev_b_t[index] : NULL;
+            break;
+        case MODEL_CHECKPOINT_ENTRY_SGD_MASTER:
+            t = opt && index < opt->size ? opt->master[index] : NULL;
+            break;
+        }
+        if (!t)
+        {
+            continue;
+        }
+
+        struct model_checkpoint_entry *entry = &entries[n_entries];
+        memset(entry, 0, sizeof(struct model_checkpoint_entry));
+        entry->kind = kind;
+        entry->index = index;
+        entry->dtype = t->dtype;
+        entry->shape_size = t->shape_size;
+        for (size_t d = 0; d < t->shape_size; d++)
+        {
+            entry->shape[d] = t->shape[d];
+        }
+        entry->size = t->data_size * dtype_sizeof(t->dtype);
+
+        tensors[n_entries] = t;
+        n_entries++;
+    }
+
+    return n_entries;
+}
+
+static cgrad_error model_checkpoint_open(struct model_checkpoint_file *const file, const char *const path)
+{
+    if (!path)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+    if ((size_t)st.st_size < sizeof(struct model_checkpoint_header))
+    {
+        close(fd);
+        return MODEL_CHECKPOINT_INVALID_FORMAT;
+    }
+
+    // The mapping stays valid after closing the descriptor
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    file->addr = addr;
+    file->size = st.st_size;
+    file->header = addr;
+    file->entries = (const struct model_checkpoint_entry *)(file->header + 1);
+
+    const struct model_checkpoint_header *header = file->header;
+    cgrad_error err = NO_ERROR;
+    if (memcmp(header->magic, MODEL_CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 || header->byte_order != MODEL_CHECKPOINT_BYTE_ORDER)
+    {
+        err = MODEL_CHECKPOINT_INVALID_FORMAT;
+    }
+    else if (header->version != MODEL_CHECKPOINT_VERSION)
+    {
+        err = MODEL_CHECKPOINT_VERSION_MISMATCH;
+    }
+    else if (header->file_size != file->size || header->n_entries > (file->size - sizeof(struct model_checkpoint_header)) / sizeof(struct model_checkpoint_entry))
+    {
+        err = MODEL_CHECKPOINT_INVALID_FORMAT;
+    }
+
+    // Every entry must describe aligned data inside the file
+    for (size_t i = 0; i < header->n_entries && err == NO_ERROR; i++)
+    {
+        const struct model_checkpoint_entry *entry = &file->entries[i];
+        if (entry->shape_size > TENSOR_MAX_SHAPE_SIZE || entry->offset % MODEL_CHECKPOINT_ALIGNMENT != 0 || entry->offset > file->size || entry->size > file->size - entry->offset)
+        {
+            err = MODEL_CHECKPOINT_INVALID_FORMAT;
+        }
+    }
+
+    if (err != NO_ERROR)
+    {
+        model_checkpoint_close(file);
+    }
+
+    return err;
+}
+
+static void model_checkpoint_close(struct model_checkpoint_file *const file)
+{
+    munmap(file->addr, file->size);
+    file->addr = NULL;
+}
+
+static const struct model_checkpoint_entry *model_checkpoint_find(const struct model_checkpoint_file *const file, const model_checkpoint_entry_kind kind, const size_t index)
+{
+    for (size_t i = 0; i < file->header->n_entries; i++)
+    {
+        const struct model_checkpoint_entry *entry = &file->entries[i];
+        if (entry->kind == kind && entry->index == index)
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static bool model_checkpoint_entry_matches(const struct model_checkpoint_entry *const entry, const struct tensor *const t)
+{
+    if (entry->dtype != (uint32_t)t->dtype || entry->shape_size != t->shape_size || entry->size != t->data_size * dtype_sizeof(t->dtype))
+    {
+        return false;
+    }
+
+    for (size_t d = 0; d < t->shape_size; d++)
+    {
+        if (entry->shape[d] != t->shape[d])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static cgrad_error model_checkpoint_check_params(const struct model_checkpoint_file *const file, const struct model_params *const params)
+{
+    if (file->header->n_params != params->size)
+    {
+        return MODEL_CHECKPOINT_PARAMS_MISMATCH;
+    }
+
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct model_checkpoint_entry *entry = model_checkpoint_find(file, MODEL_CHECKPOINT_ENTRY_PARAM, i);
+        if (!entry || !model_checkpoint_entry_matches(entry, params->params[i]))
+        {
+            return MODEL_CHECKPOINT_PARAMS_MISMATCH;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error model_checkpoint_load_entry(const struct model_checkpoint_file *const file, const model_checkpoint_entry_kind kind, const size_t index, struct tensor *const t)
+{
+    const struct model_checkpoint_entry *entry = model_checkpoint_find(file, kind, index);
+    if (!entry || !model_checkpoint_entry_matches(entry, t))
+    {
+        return MODEL_CHECKPOINT_PARAMS_MISMATCH;
+    }
+
+    memcpy(t->data, (const char *)file->addr + entry->offset, entry->size);
+    tensor_mark_modified(t);
+
+    return NO_ERROR;
+}
+
+static size_t model_checkpoint_align(const size_t offset)
+{
+    return (offset + MODEL_CHECKPOINT_ALIGNMENT - 1) / MODEL_CHECKPOINT_ALIGNMENT * MODEL_CHECKPOINT_ALIGNMENT;
+}
@@ -0,0 +1,409 @@
+#include "cgrad/model/model_checkpoint_writer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static void *model_checkpoint_writer_main(void *arg);
+static struct model_checkpoint_snapshot *model_checkpoint_writer_next(struct model_checkpoint_writer *const writer);
+static cgrad_error model_checkpoint_writer_write(const struct model_checkpoint_snapshot *const snapshot);
+static cgrad_error model_checkpoint_writer_write_all(const int fd, const void *const data, const size_t size);
+static void model_checkpoint_writer_sync_dir(const char *const path);
+static void model_checkpoint_writer_keep(struct model_checkpoint_writer *const writer, const char *const path);
+static char *model_checkpoint_writer_strdup(const char *const s, const char *const suffix);
+static double model_checkpoint_writer_elapsed(const struct timespec *const start, const struct timespec *const end);
+
+cgrad_error model_checkpoint_writer_init(struct model_checkpoint_writer *const writer, const size_t keep_last)
+{
+    if (!writer)
+    {
+        return MODEL_CHECKPOINT_WRITER_NULL;
+    }
+
+    memset(writer, 0, sizeof(struct model_checkpoint_writer));
+    writer->keep_last = keep_last;
+    writer->error = NO_ERROR;
+    if (keep_last > 0)
+    {
+        writer->kept = (char **)calloc(keep_last, sizeof(char *));
+        if (!writer->kept)
+        {
+            return MODEL_CHECKPOINT_WRITER_ALLOCATION_FAILED;
+        }
+    }
+
+    if (pthread_mutex_init(&writer->mutex, NULL) != 0)
+    {
+        free(writer->kept);
+        return MODEL_CHECKPOINT_WRITER_INIT_FAILED;
+    }
+    if (pthread_cond_init(&writer->cond, NULL) != 0)
+    {
+        pthread_mutex_destroy(&writer->mutex);
+        free(writer->kept);
+        return MODEL_CHECKPOINT_WRITER_INIT_FAILED;
+    }
+    if (pthread_create(&writer->thread, NULL, &model_checkpoint_writer_main, writer) != 0)
+    {
+        pthread_cond_destroy(&writer->cond);
+        pthread_mutex_destroy(&writer->mutex);
+        free(writer->kept);
+        return MODEL_CHECKPOINT_WRITER_INIT_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error model_checkpoint_writer_save(struct model_checkpoint_writer *const writer, const struct model_params *const params, const struct sgd_optimizer *const opt, const char *const path)
+{
+    if (!writer)
+    {
+        return MODEL_CHECKPOINT_WRITER_NULL;
+    }
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!path)
+    {
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Waits for a free snapshot only when both are queued or being written
+    pthread_mutex_lock(&writer->mutex);
+    struct model_checkpoint_snapshot *snapshot = NULL;
+    while (!snapshot)
+    {
+        for (size_t i = 0; i < MODEL_CHECKPOINT_WRITER_N_SNAPSHOTS && !snapshot; i++)
+        {
+            if (writer->snapshots[i].state == MODEL_CHECKPOINT_SNAPSHOT_FREE)
+            {
+                snapshot = &writer->snapshots[i];
+            }
+        }
+        if (!snapshot)
+        {
+            pthread_cond_wait(&writer->cond, &writer->mutex);
+        }
+    }
+    snapshot->state = MODEL_CHECKPOINT_SNAPSHOT_FILLING;
+    pthread_mutex_unlock(&writer->mutex);
+
+    // The staging buffer only grows, so that steady state saves allocate nothing but the path
+    cgrad_error err = NO_ERROR;
+    const size_t size = model_checkpoint_image_size(params, opt);
+    if (size > snapshot->capacity)
+    {
+        void *image = realloc(snapshot->image, size);
+        if (image)
+        {
+            snapshot->image = image;
+            snapshot->capacity = size;
+        }
+        else
+        {
+            err = MODEL_CHECKPOINT_WRITER_ALLOCATION_FAILED;
+        }
+    }
+
+    free(snapshot->path);
+    snapshot->path = model_checkpoint_writer_strdup(path, "");
+    if (err == NO_ERROR && !snapshot->path)
+    {
+        err = MODEL_CHECKPOINT_WRITER_ALLOCATION_FAILED;
+    }
+    if (err == NO_ERROR)
+    {
+        snapshot->size = size;
+        err = model_checkpoint_image(params, opt, snapshot->image, snapshot->capacity);
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    pthread_mutex_lock(&writer->mutex);
+    if (err == NO_ERROR)
+    {
+        snapshot->seq = writer->next_seq++;
+        snapshot->state = MODEL_CHECKPOINT_SNAPSHOT_PENDING;
+    }
+    else
+    {
+        snapshot->state = MODEL_CHECKPOINT_SNAPSHOT_FREE;
+    }
+    writer->last_blocked_seconds = model_checkpoint_writer_elapsed(&start, &end);
+    writer->blocked_seconds += writer->last_blocked_seconds;
+    pthread_cond_broadcast(&writer->cond);
+    pthread_mutex_unlock(&writer->mutex);
+
+    return err;
+}
+
+cgrad_error model_checkpoint_writer_wait(struct model_checkpoint_writer *const writer)
+{
+    if (!writer)
+    {
+        return MODEL_CHECKPOINT_WRITER_NULL;
+    }
+
+    pthread_mutex_lock(&writer->mutex);
+    bool busy = true;
+    while (busy)
+    {
+        busy = false;
+        for (size_t i = 0; i < MODEL_CHECKPOINT_WRITER_N_SNAPSHOTS; i++)
+        {
+            busy = busy || writer->snapshots[i].state != MODEL_CHECKPOINT_SNAPSHOT_FREE;
+        }
+        if (busy)
+        {
+            pthread_cond_wait(&writer->cond, &writer->mutex);
+        }
+    }
+    // Reported once, so that the next wait only covers the snapshots taken since
+    const cgrad_error err = writer->error;
+    writer->error = NO_ERROR;
+    pthread_mutex_unlock(&writer->mutex);
+
+    return err;
+}
+
+void model_checkpoint_writer_cleanup(struct model_checkpoint_writer *const writer)
+{
+    if (!writer)
+    {
+        return;
+    }
+
+    // The thread writes the pending snapshots before stopping
+    pthread_mutex_lock(&writer->mutex);
+    writer->stopping = true;
+    pthread_cond_broadcast(&writer->cond);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->thread, NULL);
+
+    for (size_t i = 0; i < MODEL_CHECKPOINT_WRITER_N_SNAPSHOTS; i++)
+    {
+        free(writer->snapshots[i].image);
+        free(writer->snapshots[i].path);
+        writer->snapshots[i].image = NULL;
+        writer->snapshots[i].path = NULL;
+    }
+    for (size_t i = 0; i < writer->n_kept; i++)
+    {
+        free(writer->kept[i]);
+    }
+    free(writer->kept);
+    writer->kept = NULL;
+    writer->n_kept = 0;
+
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->mutex);
+}
+
+static void *model_checkpoint_writer_main(void *arg)
+{
+    struct model_checkpoint_writer *writer = (struct model_checkpoint_writer *)arg;
+
+    pthread_mutex_lock(&writer->mutex);
+    while (true)
+    {
+        struct model_checkpoint_snapshot *snapshot = model_checkpoint_writer_next(writer);
+        if (!snapshot)
+        {
+            if (writer->stopping)
+            {
+                break;
+            }
+            pthread_cond_wait(&writer->cond, &writer->mutex);
+            continue;
+        }
+
+        // The file is written without the lock, the training thread only touching free snapshots
+        snapshot->state = MODEL_CHECKPOINT_SNAPSHOT_WRITING;
+        pthread_mutex_unlock(&writer->mutex);
+        const cgrad_error err = model_checkpoint_writer_write(snapshot);
+        if (err == NO_ERROR)
+        {
+            model_checkpoint_writer_keep(writer, snapshot->path);
+        }
+        pthread_mutex_lock(&writer->mutex);
+
+        if (err == NO_ERROR)
+        {
+            writer->n_saved++;
+        }
+        else if (writer->error == NO_ERROR)
+        {
+            writer->error = err;
+        }
+        snapshot->state = MODEL_CHECKPOINT_SNAPSHOT_FREE;
+        pthread_cond_broadcast(&writer->cond);
+    }
+    pthread_mutex_unlock(&writer->mutex);
+
+    return NULL;
+}
+
+static struct model_checkpoint_snapshot *model_checkpoint_writer_next(struct model_checkpoint_writer *const writer)
+{
+    struct model_checkpoint_snapshot *next = NULL;
+    for (size_t i = 0; i < MODEL_CHECKPOINT_WRITER_N_SNAPSHOTS; i++)
+    {
+        struct model_checkpoint_snapshot *snapshot = &writer->snapshots[i];
+        if (snapshot->state == MODEL_CHECKPOINT_SNAPSHOT_PENDING && (!next || snapshot->seq < next->seq))
+        {
+            next = snapshot;
+        }
+    }
+
+    return next;
+}
+
+static cgrad_error model_checkpoint_writer_write(const struct model_checkpoint_snapshot *const snapshot)
+{
+    char *tmp_path = model_checkpoint_writer_strdup(snapshot->path, ".tmp");
+    if (!tmp_path)
+    {
+        return MODEL_CHECKPOINT_WRITER_ALLOCATION_FAILED;
+    }
+
+    const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        free(tmp_path);
+        return MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    // The data reaches the disk before the rename makes it visible under path
+    cgrad_error err = model_checkpoint_writer_write_all(fd, snapshot->image, snapshot->size);
+    if (err == NO_ERROR && fsync(fd) != 0)
+    {
+        err = MODEL_CHECKPOINT_FILE_ERROR;
+    }
+    if (close(fd) != 0 && err == NO_ERROR)
+    {
+        err = MODEL_CHECKPOINT_FILE_ERROR;
+    }
+    if (err == NO_ERROR && rename(tmp_path, snapshot->path) != 0)
+    {
+        err = MODEL_CHECKPOINT_FILE_ERROR;
+    }
+
+    if (err == NO_ERROR)
+    {
+        model_checkpoint_writer_sync_dir(snapshot->path);
+    }
+    else
+    {
+        remove(tmp_path);
+    }
+
+    free(tmp_path);
+    return err;
+}
+
+static cgrad_error model_checkpoint_writer_write_all(const int fd, const void *const data, const size_t size)
+{
+    const char *src = (const char *)data;
+    size_t written = 0;
+    while (written < size)
+    {
+        const ssize_t n = write(fd, src + written, size - written);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            return MODEL_CHECKPOINT_FILE_ERROR;
+        }
+        written += (size_t)n;
+    }
+
+    return NO_ERROR;
+}
+
+static void model_checkpoint_writer_sync_dir(const char *const path)
+{
+    // Persists the rename, failures are ignored since some file systems cannot sync directories
+    const char *slash = strrchr(path, '/');
+    char *dir = NULL;
+    if (slash)
+    {
+        const size_t len = slash == path ? 1 : (size_t)(slash - path);
+        dir = (char *)malloc(len + 1);
+        if (!dir)
+        {
+            return;
+        }
+        memcpy(dir, path, len);
+        dir[len] = '\0';
+    }
+
+    const int fd = open(dir ? dir : ".", O_RDONLY | O_DIRECTORY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+static void model_checkpoint_writer_keep(struct model_checkpoint_writer *const writer, const char *const path)
+{
+    if (writer->keep_last == 0)
+    {
+        return;
+    }
+
+    // A path written again only moves to the end of the list
+    for (size_t i = 0; i < writer->n_kept; i++)
+    {
+        if (strcmp(writer->kept[i], path) == 0)
+        {
+            free(writer->kept[i]);
+            memmove(&writer->kept[i], &writer->kept[i + 1], (writer->n_kept - i - 1) * sizeof(char *));
+            writer->n_kept--;
+            break;
+        }
+    }
+
+    if (writer->n_kept == writer->keep_last)
+    {
+        remove(writer->kept[0]);
+        free(writer->kept[0]);
+        memmove(&writer->kept[0], &writer->kept[1], (writer->n_kept - 1) * sizeof(char *));
+        writer->n_kept--;
+    }
+
+    char *kept = model_checkpoint_writer_strdup(path, "");
+    if (kept)
+    {
+        writer->kept[writer->n_kept++] = kept;
+    }
+}
+
+static char *model_checkpoint_writer_strdup(const char *const s, const char *const suffix)
+{
+    char *copy = (char *)malloc(strlen(s) + strlen(suffix) + 1);
+    if (!copy)
+    {
+        return NULL;
+    }
+    strcpy(copy, s);
+    strcat(copy, suffix);
+
+    return copy;
+}
+
+static double model_checkpoint_writer_elapsed(const struct timespec *const start, const struct timespec *const end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
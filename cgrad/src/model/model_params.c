@@ -1,4 +1,5 @@
 #include "cgrad/model/model_params.h"
+#include "cgrad/tensor/tensor_foreach.h"
 
 void model_params_init(struct model_params *const params)
 {
@@ -18,4 +19,31 @@ cgrad_error model_params_add(struct model_params *const params, struct tensor *c
     params->size++;
 
     return NO_ERROR;
-}
\ No newline at end of file
+}
+
+void model_params_grads(const struct model_params *const params, struct tensor **const grads)
+{
+    for (size_t i = 0; i < params->size; i++)
+    {
+        grads[i] = params->params[i]->grad;
+    }
+}
+
+void model_params_zero_grad(struct model_params *const params)
+{
+    struct tensor *grads[MODEL_MAX_PARAMS];
+    model_params_grads(params, grads);
+    tensor_foreach_zero(grads, params->size, NULL);
+}
+
+cgrad_error model_params_clip_grad_norm(struct model_params *const params, const double max_norm, double *const total_norm, struct thread_pool *const pool)
+{
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+
+    struct tensor *grads[MODEL_MAX_PARAMS];
+    model_params_grads(params, grads);
+    return tensor_foreach_clip_norm(grads, params->size, max_norm, total_norm, pool);
+}
@@ -0,0 +1,111 @@
+#include "cgrad/optimizers/grad_accumulator.h"
+
+cgrad_error grad_accumulator_init(struct grad_accumulator *const acc, struct sgd_optimizer *const opt, struct loss_scaler *const scaler, const size_t n_micro_batches)
+{
+    if (!acc)
+    {
+        return GRAD_ACCUMULATOR_NULL;
+    }
+    if (!opt)
+    {
+        return OPTIMIZER_NULL;
+    }
+    if (n_micro_batches == 0)
+    {
+        return GRAD_ACCUMULATOR_INVALID_MICRO_BATCHES;
+    }
+
+    acc->opt = opt;
+    acc->scaler = scaler;
+    acc->n_micro_batches = n_micro_batches;
+    acc->n_accumulated = 0;
+
+    return NO_ERROR;
+}
+
+cgrad_error grad_accumulator_backward(struct grad_accumulator *const acc, struct tensor *const loss, struct cgrad_env *const env, bool *const stepped)
+{
+    if (!acc)
+    {
+        return GRAD_ACCUMULATOR_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (env->grad_hook.function)
+    {
+        return GRAD_ACCUMULATOR_FUSED_BACKWARD;
+    }
+    if (stepped)
+    {
+        *stepped = false;
+    }
+
+    // The buffers of the previous step are reused, backward accumulating into them
+    if (acc->n_accumulated == 0)
+    {
+        sgd_optimizer_zero_grad(acc->opt);
+    }
+
+    const double scale = acc->scaler ? acc->scaler->scale : 1.0;
+    cgrad_error err = backward_with_seed(loss, scale / (double)acc->n_micro_batches, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = cgrad_env_free_intermediates(env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if (++acc->n_accumulated < acc->n_micro_batches)
+    {
+        return NO_ERROR;
+    }
+
+    return grad_accumulator_flush(acc, stepped);
+}
+
+cgrad_error grad_accumulator_flush(struct grad_accumulator *const acc, bool *const stepped)
+{
+    if (!acc)
+    {
+        return GRAD_ACCUMULATOR_NULL;
+    }
+    if (stepped)
+    {
+        *stepped = false;
+    }
+    if (acc->n_accumulated == 0)
+    {
+        return NO_ERROR;
+    }
+
+    // Gradients were divided by n_micro_batches, of which only n_accumulated were run
+    struct sgd_optimizer *opt = acc->opt;
+    const double grad_scale = opt->grad_scale;
+    opt->grad_scale *= (double)acc->n_micro_batches / (double)acc->n_accumulated;
+
+    cgrad_error err = NO_ERROR;
+    bool updated = true;
+    if (acc->scaler)
+    {
+        err = loss_scaler_step(acc->scaler, opt, &updated);
+    }
+    else
+    {
+        err = sgd_optimizer_step(opt);
+    }
+    opt->grad_scale = grad_scale;
+    acc->n_accumulated = 0;
+
+    if (stepped)
+    {
+        *stepped = err == NO_ERROR && updated;
+    }
+
+    return err;
+}
@@ -0,0 +1,142 @@
+#include "cgrad/optimizers/loss_scaler.h"
+#include "cgrad/utils/half.h"
+#include <math.h>
+
+static bool loss_scaler_grads_finite(const struct model_params *const params);
+static bool tensor_all_finite(const struct tensor *const t);
+
+cgrad_error loss_scaler_init(struct loss_scaler *const scaler, const double init_scale)
+{
+    if (!scaler)
+    {
+        return LOSS_SCALER_NULL;
+    }
+
+    scaler->scale = init_scale;
+    scaler->growth_factor = 2.0;
+    scaler->backoff_factor = 0.5;
+    scaler->growth_interval = 2000;
+    scaler->n_good_steps = 0;
+    scaler->n_skipped_steps = 0;
+
+    return NO_ERROR;
+}
+
+cgrad_error loss_scaler_backward(const struct loss_scaler *const scaler, struct tensor *const loss, struct cgrad_env *const env)
+{
+    if (!scaler)
+    {
+        return LOSS_SCALER_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (env->grad_hook.function)
+    {
+        return LOSS_SCALER_FUSED_BACKWARD;
+    }
+
+    return backward_with_seed(loss, scaler->scale, env);
+}
+
+cgrad_error loss_scaler_step(struct loss_scaler *const scaler, struct sgd_optimizer *const opt, bool *const stepped)
+{
+    if (!scaler)
+    {
+        return LOSS_SCALER_NULL;
+    }
+    if (!opt)
+    {
+        return OPTIMIZER_NULL;
+    }
+
+    if (!loss_scaler_grads_finite(opt->params))
+    {
+        scaler->scale *= scaler->backoff_factor;
+        scaler->n_good_steps = 0;
+        scaler->n_skipped_steps++;
+        if (stepped)
+        {
+            *stepped = false;
+        }
+        return NO_ERROR;
+    }
+
+    // The unscaling composes with any factor already applied by the caller, e.g. a gradient accumulator
+    const double grad_scale = opt->grad_scale;
+    opt->grad_scale = grad_scale / scaler->scale;
+    cgrad_error err = sgd_optimizer_step(opt);
+    opt->grad_scale = grad_scale;
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if (++scaler->n_good_steps == scaler->growth_interval)
+    {
+        scaler->scale *= scaler->growth_factor;
+        scaler->n_good_steps = 0;
+    }
+    if (stepped)
+    {
+        *stepped = true;
+    }
+
+    return NO_ERROR;
+}
+
+static bool loss_scaler_grads_finite(const struct model_params *const params)
+{
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *grad = params->params[i]->grad;
+        if (grad && !tensor_all_finite(grad))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool tensor_all_finite(const struct tensor *const t)
+{
+    switch (t->dtype)
+    {
+    case DTYPE_FLOAT64:
+        for (size_t i = 0; i < t->data_size; i++)
+        {
+            if (!isfinite(((const double *)t->data)[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    case DTYPE_FLOAT32:
+        for (size_t i = 0; i < t->data_size; i++)
+        {
+            if (!isfinite(((const float *)t->data)[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+    {
+        // Infinities and NaNs have all exponent bits set
+        const uint16_t exponent_mask = t->dtype == DTYPE_BFLOAT16 ? 0x7f80 : 0x7c00;
+        for (size_t i = 0; i < t->data_size; i++)
+        {
+            if ((((const uint16_t *)t->data)[i] & exponent_mask) == exponent_mask)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    default:
+        return true;
+    }
+}
@@ -1,9 +1,16 @@
 #include "cgrad/optimizers/sgd.h"
-#include "cgrad/tensor/tensor_add_inplace.h"
-#include "cgrad/tensor/tensor_scalar_mult_tensor_add.h"
-#include "cgrad/tensor/tensor_axpy.h"
+#include "cgrad/tensor/tensor_foreach.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include "cgrad/tensor/tensor_sparse_grad.h"
+#include "cgrad/utils/half.h"
+#include <stdlib.h>
 
 static cgrad_error add_prev_b_t(struct sgd_optimizer *const opt, struct tensor *const prev_grad);
+static struct tensor *sgd_optimizer_alloc_master(struct sgd_optimizer *const opt, const struct tensor *const param);
+static cgrad_error sgd_optimizer_update(struct sgd_optimizer *const opt, const size_t first, const size_t last);
+static cgrad_error sgd_optimizer_update_rows(struct sgd_optimizer *const opt, const size_t i, const struct tensor_foreach_sgd_args *const args);
+static struct tensor sgd_optimizer_row_view(const struct tensor *const t, const size_t row, const size_t row_size);
+static cgrad_error sgd_optimizer_gradient_hook(void *arg, struct tensor *const t);
 
 cgrad_error sgd_optimizer_init(struct sgd_optimizer *opt, struct model_params *const params, const double lr, const double momentum, const bool nesterov, struct cgrad_env *env)
 {
@@ -24,12 +31,28 @@ cgrad_error sgd_optimizer_init(struct sgd_optimizer *opt, struct model_params *c
     opt->momemtum = momentum;
     opt->nesterov = nesterov;
     opt->params = params;
+    opt->grad_scale = 1.0;
     opt->tensor_alloc = &env->tensor_alloc;
+    opt->env = env;
     opt->size = 0;
     for (size_t i = 0; i < params->size; i++)
     {
         struct tensor* param = params->params[i];
-        struct tensor* param_prev_grad = tensor_allocator_no_grad_zero_alloc(opt->tensor_alloc, param->shape, param->shape_size, param->dtype);
+
+        // The state of half precision parameters is kept in float32
+        opt->master[i] = NULL;
+        cgrad_dtype state_dtype = param->dtype;
+        if (dtype_is_half(param->dtype))
+        {
+            opt->master[i] = sgd_optimizer_alloc_master(opt, param);
+            if (!opt->master[i])
+            {
+                return TENSOR_ALLOCATION_FAILED;
+            }
+            state_dtype = DTYPE_FLOAT32;
+        }
+
+        struct tensor* param_prev_grad = tensor_allocator_no_grad_zero_alloc(opt->tensor_alloc, param->shape, param->shape_size, state_dtype);
 
         cgrad_error err = add_prev_b_t(opt, param_prev_grad);
         if (err != NO_ERROR)
@@ -48,54 +71,17 @@ cgrad_error sgd_optimizer_step(struct sgd_optimizer *opt)
         return OPTIMIZER_NULL;
     }
 
-    double lr = opt->lr;
-    double momentum = opt->momemtum;
-    bool nesterov = opt->nesterov;
+    return sgd_optimizer_update(opt, 0, opt->params->size);
+}
 
-    for (size_t i = 0; i < opt->params->size; i++)
+cgrad_error sgd_optimizer_fuse_backward(struct sgd_optimizer *opt, struct cgrad_env *env)
+{
+    if (!opt)
     {
-        struct tensor* param = opt->params->params[i];
-        struct tensor_allocator *tensor_alloc = opt->tensor_alloc;
-        
-        struct tensor* prev_b_t = opt->prev_b_t[i];
-        struct tensor* b_t = tensor_allocator_no_grad_alloc(tensor_alloc, prev_b_t->shape, prev_b_t->shape_size, param->dtype);
-
-        if (momentum != 0)
-        {
-            if (nesterov)
-            {
-                // b_t <- momentum * b_t-1 + g_t
-                struct tensor* g_t = tensor_allocator_clone(tensor_alloc, param->grad);
-                tensor_scalar_mult_tensor_add(prev_b_t, g_t, momentum, b_t);
-
-                // g_t <- g_t + momentum * b_t
-                tensor_axpy(b_t, g_t, momentum);
-
-                // SGD update using g_t, i.e.:
-                // param <- param - lr * g_t
-                tensor_axpy(g_t, param, -lr);
-
-                tensor_allocator_free(tensor_alloc, g_t);
-            }
-            else
-            {
-                // No need to clone tensor as param->grad is not modified
-                // b_t <- momentum * b_t-1 + g_t
-                tensor_scalar_mult_tensor_add(prev_b_t, param->grad, momentum, b_t);
-
-                // SGD update using b_t, i.e.:
-                // g_t <- b_t
-                // param <- param - lr * g_t
-                tensor_axpy(b_t, param, -lr);
-            }
-        }
-
-        // Free and setup next iteration b_ts
-        tensor_allocator_free(tensor_alloc, opt->prev_b_t[i]);
-        opt->prev_b_t[i] = b_t;
+        return OPTIMIZER_NULL;
     }
 
-    return NO_ERROR;
+    return backward_set_gradient_hook(env, &sgd_optimizer_gradient_hook, opt);
 }
 
 void sgd_optimizer_cleanup(struct sgd_optimizer *opt)
@@ -108,6 +94,7 @@ void sgd_optimizer_cleanup(struct sgd_optimizer *opt)
     for (size_t i = 0; i < opt->size; i++)
     {
         tensor_allocator_free(opt->tensor_alloc, opt->prev_b_t[i]);
+        tensor_allocator_free(opt->tensor_alloc, opt->master[i]);
     }
 }
 
@@ -123,4 +110,156 @@ static cgrad_error add_prev_b_t(struct sgd_optimizer *const state, struct tensor
     state->size++;
 
     return NO_ERROR;
-}
\ No newline at end of file
+}
+
+static struct tensor *sgd_optimizer_alloc_master(struct sgd_optimizer *const opt, const struct tensor *const param)
+{
+    struct tensor *master = tensor_allocator_no_grad_alloc(opt->tensor_alloc, param->shape, param->shape_size, DTYPE_FLOAT32);
+    if (!master)
+    {
+        return NULL;
+    }
+
+    half_to_f32_array((const uint16_t *)param->data, (float *)master->data, param->data_size, param->dtype);
+
+    return master;
+}
+
+static cgrad_error sgd_optimizer_update(struct sgd_optimizer *const opt, const size_t first, const size_t last)
+{
+    struct tensor *weights[MODEL_MAX_PARAMS] = {NULL};
+    struct tensor *grads[MODEL_MAX_PARAMS] = {NULL};
+    struct tensor *momentums[MODEL_MAX_PARAMS] = {NULL};
+    struct tensor *rounded[MODEL_MAX_PARAMS] = {NULL};
+    size_t sparse[MODEL_MAX_PARAMS];
+    size_t n = 0;
+    size_t n_sparse = 0;
+
+    for (size_t i = first; i < last; i++)
+    {
+        struct tensor *param = opt->params->params[i];
+
+        // The gradient is allocated on first backpropagation, skip parameters which did not receive one
+        if (!param->grad)
+        {
+            continue;
+        }
+
+        // Row-sparse gradients update their rows only, see sgd_optimizer_update_rows
+        if (tensor_has_sparse_grad(param))
+        {
+            sparse[n_sparse++] = i;
+            continue;
+        }
+
+        // Half precision parameters are updated through their master weights, then rounded into the parameter
+        weights[n] = opt->master[i] ? opt->master[i] : param;
+        grads[n] = param->grad;
+        momentums[n] = opt->prev_b_t[i];
+        rounded[n] = opt->master[i] ? param : NULL;
+        n++;
+    }
+
+    // A single pass over every parameter, unscaling and widening gradients on the fly
+    const struct tensor_foreach_sgd_args args = {.lr = opt->lr, .momentum = opt->momemtum, .nesterov = opt->nesterov, .grad_scale = opt->grad_scale};
+    cgrad_error err = tensor_foreach_sgd(weights, grads, momentums, rounded, n, &args, opt->env->pool);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    for (size_t i = 0; i < n; i++)
+    {
+        tensor_mark_modified(rounded[i] ? rounded[i] : weights[i]);
+    }
+
+    for (size_t s = 0; s < n_sparse; s++)
+    {
+        if ((err = sgd_optimizer_update_rows(opt, sparse[s], &args)) != NO_ERROR)
+        {
+            return err;
+        }
+        tensor_mark_modified(opt->params->params[sparse[s]]);
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error sgd_optimizer_update_rows(struct sgd_optimizer *const opt, const size_t i, const struct tensor_foreach_sgd_args *const args)
+{
+    struct tensor *param = opt->params->params[i];
+    struct tensor *weight = opt->master[i] ? opt->master[i] : param;
+    const size_t n = param->grad_rows->data_size;
+    const size_t row_size = param->data_size / param->shape[0];
+    const int32_t *rows = param->grad_rows->data;
+
+    // The rows of the weight, gradient, momentum and rounded parameter are viewed as tensors, updated in a single pass
+    struct tensor *views = malloc(4 * n * sizeof(struct tensor));
+    struct tensor **lists = malloc(4 * n * sizeof(struct tensor *));
+    if (!views || !lists)
+    {
+        free(views);
+        free(lists);
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    for (size_t k = 0; k < n; k++)
+    {
+        views[k] = sgd_optimizer_row_view(weight, rows[k], row_size);
+        views[n + k] = sgd_optimizer_row_view(param->grad, k, row_size);
+        views[2 * n + k] = sgd_optimizer_row_view(opt->prev_b_t[i], rows[k], row_size);
+        views[3 * n + k] = sgd_optimizer_row_view(param, rows[k], row_size);
+    }
+    for (size_t k = 0; k < 4 * n; k++)
+    {
+        lists[k] = &views[k];
+    }
+
+    cgrad_error err = tensor_foreach_sgd(lists, lists + n, lists + 2 * n, opt->master[i] ? lists + 3 * n : NULL, n, args, opt->env->pool);
+
+    free(views);
+    free(lists);
+
+    return err;
+}
+
+static struct tensor sgd_optimizer_row_view(const struct tensor *const t, const size_t row, const size_t row_size)
+{
+    struct tensor view = {0};
+    view.data = (char *)t->data + row * row_size * dtype_sizeof(t->dtype);
+    view.dtype = t->dtype;
+    view.shape[0] = row_size;
+    view.shape_size = 1;
+    view.stride[0] = 1;
+    view.data_size = row_size;
+
+    return view;
+}
+
+static cgrad_error sgd_optimizer_gradient_hook(void *arg, struct tensor *const t)
+{
+    struct sgd_optimizer *opt = (struct sgd_optimizer *)arg;
+
+    for (size_t i = 0; i < opt->params->size; i++)
+    {
+        if (opt->params->params[i] != t)
+        {
+            continue;
+        }
+
+        cgrad_error err = sgd_optimizer_update(opt, i, i + 1);
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+
+        // The gradient is consumed, the next backward pass writes the first gradient it computes in its place
+        tensor_sparse_grad_clear(t, opt->tensor_alloc);
+        tensor_allocator_no_grad_free(opt->tensor_alloc, t->grad);
+        t->grad = NULL;
+        return NO_ERROR;
+    }
+
+    // Leaves which are not parameters of the optimizer keep their gradient
+    return NO_ERROR;
+}
@@ -0,0 +1,112 @@
+#include "cgrad/parallel/allreduce.h"
+#include <stdlib.h>
+#include <string.h>
+
+void allreduce_cleanup(struct allreduce_backend *const backend)
+{
+    if (!backend)
+    {
+        return;
+    }
+
+    backend->cleanup(backend->ctx);
+    free(backend->flat_grads);
+    backend->flat_grads = NULL;
+    backend->flat_grads_capacity = 0;
+}
+
+cgrad_error allreduce_grads(struct allreduce_backend *const backend, struct model_params *const params, const double weight)
+{
+    if (!backend)
+    {
+        return ALLREDUCE_BACKEND_NULL;
+    }
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (params->size == 0)
+    {
+        return NO_ERROR;
+    }
+
+    const cgrad_dtype dtype = params->params[0]->dtype;
+    if (dtype != DTYPE_FLOAT32 && dtype != DTYPE_FLOAT64)
+    {
+        return TENSOR_INVALID_DTYPE;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        if (!param->grad)
+        {
+            return TENSOR_GRAD_NULL;
+        }
+        if (param->grad_rows)
+        {
+            return TENSOR_GRAD_SPARSE;
+        }
+        if (param->dtype != dtype)
+        {
+            return TENSOR_DTYPE_MISMATCH;
+        }
+        n += param->data_size;
+    }
+
+    const size_t size = n * dtype_sizeof(dtype);
+    if (size > backend->flat_grads_capacity)
+    {
+        void *flat_grads = realloc(backend->flat_grads, size);
+        if (!flat_grads)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+        backend->flat_grads = flat_grads;
+        backend->flat_grads_capacity = size;
+    }
+
+    // Pack the weighted gradients, sum them across the group, then unpack the result
+    size_t offset = 0;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *grad = params->params[i]->grad;
+        if (dtype == DTYPE_FLOAT32)
+        {
+            float *restrict dst = (float *)backend->flat_grads + offset;
+            const float *restrict src = grad->data;
+            const float w = weight;
+            for (size_t j = 0; j < grad->data_size; j++)
+            {
+                dst[j] = w * src[j];
+            }
+        }
+        else
+        {
+            double *restrict dst = (double *)backend->flat_grads + offset;
+            const double *restrict src = grad->data;
+            for (size_t j = 0; j < grad->data_size; j++)
+            {
+                dst[j] = weight * src[j];
+            }
+        }
+        offset += grad->data_size;
+    }
+
+    cgrad_error err = allreduce_sum(backend, backend->flat_grads, n, dtype);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    offset = 0;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        struct tensor *grad = params->params[i]->grad;
+        memcpy(grad->data, (unsigned char *)backend->flat_grads + offset * dtype_sizeof(dtype), grad->data_size * dtype_sizeof(dtype));
+        offset += grad->data_size;
+    }
+
+    return NO_ERROR;
+}
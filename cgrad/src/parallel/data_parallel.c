@@ -0,0 +1,453 @@
+#include "cgrad/parallel/data_parallel.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include "cgrad/tensor/tensor_sparse_grad.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void *data_parallel_worker_run(void *arg);
+static cgrad_error data_parallel_worker_backward(struct data_parallel_worker *const worker);
+static cgrad_error data_parallel_worker_shard(struct data_parallel_worker *const worker, const struct tensor *const src, struct tensor **const shard);
+static void data_parallel_worker_reduce(struct data_parallel_worker *const worker);
+static void data_parallel_reduce_rows(struct tensor *const grad, const struct tensor *const replica_grad, const struct tensor *const rows, const size_t start, const size_t size, const double weight);
+static void data_parallel_axpy(void *const dst, const void *const src, const size_t size, const double weight, const cgrad_dtype dtype);
+static void data_parallel_destroy_sync(struct data_parallel_trainer *const trainer);
+static void data_parallel_release(struct data_parallel_trainer *const trainer, const size_t n_initialized);
+static cgrad_error data_parallel_check_replica(const struct model_params *const params, const struct model_params *const replica_params);
+
+cgrad_error data_parallel_init(struct data_parallel_trainer *const trainer, const struct data_parallel_model *const model, struct model_params *const params, const size_t n_workers, const size_t intermediates_capacity, struct cgrad_env *const env)
+{
+    if (!trainer)
+    {
+        return DATA_PARALLEL_TRAINER_NULL;
+    }
+    if (!params)
+    {
+        return MODEL_PARAMS_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (!model || !model->replica_init || !model->replica_cleanup || !model->loss || model->replica_size == 0 || n_workers == 0)
+    {
+        return DATA_PARALLEL_INVALID_CONFIG;
+    }
+
+    cgrad_error err = NO_ERROR;
+    trainer->param_offsets[0] = 0;
+    for (size_t i = 0; i < params->size; i++)
+    {
+        if ((err = tensor_alloc_grad(env, params->params[i])) != NO_ERROR)
+        {
+            return err;
+        }
+        trainer->param_offsets[i + 1] = trainer->param_offsets[i] + params->params[i]->data_size;
+    }
+
+    trainer->model = *model;
+    trainer->params = params;
+    trainer->n_workers = n_workers;
+    trainer->workers = calloc(n_workers, sizeof(struct data_parallel_worker));
+    trainer->replicas = calloc(n_workers, model->replica_size);
+    if (!trainer->workers || !trainer->replicas)
+    {
+        free(trainer->workers);
+        free(trainer->replicas);
+        return DATA_PARALLEL_INIT_FAILED;
+    }
+
+    // Split the flattened gradients into one aligned slice per worker
+    const size_t n_elements = trainer->param_offsets[params->size];
+    size_t slice = (n_elements + n_workers - 1) / n_workers;
+    slice = (slice + DATA_PARALLEL_REDUCE_ALIGNMENT - 1) / DATA_PARALLEL_REDUCE_ALIGNMENT * DATA_PARALLEL_REDUCE_ALIGNMENT;
+
+    for (size_t i = 0; i < n_workers; i++)
+    {
+        struct data_parallel_worker *worker = &trainer->workers[i];
+        worker->trainer = trainer;
+        worker->replica = trainer->replicas + i * model->replica_size;
+        worker->reduce_begin = i * slice < n_elements ? i * slice : n_elements;
+        worker->reduce_end = worker->reduce_begin + slice < n_elements ? worker->reduce_begin + slice : n_elements;
+        model_params_init(&worker->params);
+
+        if ((err = cgrad_env_context_init(&worker->env, intermediates_capacity)) != NO_ERROR)
+        {
+            data_parallel_release(trainer, i);
+            return err;
+        }
+        worker->env.rng = philox_stream(&env->rng, i);
+
+        if ((err = model->replica_init(worker->replica, &worker->params, &worker->env)) != NO_ERROR)
+        {
+            cgrad_env_cleanup(&worker->env);
+            data_parallel_release(trainer, i);
+            return err;
+        }
+        if ((err = data_parallel_check_replica(params, &worker->params)) != NO_ERROR)
+        {
+            data_parallel_release(trainer, i + 1);
+            return err;
+        }
+    }
+
+    // The caller takes part in the barriers delimiting a step, the workers alone in the one before the reduction
+    pthread_barrier_init(&trainer->step_start, NULL, n_workers + 1);
+    pthread_barrier_init(&trainer->backward_done, NULL, n_workers);
+    pthread_barrier_init(&trainer->step_done, NULL, n_workers + 1);
+
+    // Workers wait for all of them to be created before reaching the barriers, or exit if one could not be
+    pthread_mutex_init(&trainer->start_mutex, NULL);
+    pthread_mutex_lock(&trainer->start_mutex);
+    size_t n_created = 0;
+    while (n_created < n_workers && pthread_create(&trainer->workers[n_created].thread, NULL, &data_parallel_worker_run, &trainer->workers[n_created]) == 0)
+    {
+        n_created++;
+    }
+    trainer->running = n_created == n_workers;
+    pthread_mutex_unlock(&trainer->start_mutex);
+
+    if (!trainer->running)
+    {
+        for (size_t i = 0; i < n_created; i++)
+        {
+            pthread_join(trainer->workers[i].thread, NULL);
+        }
+        data_parallel_destroy_sync(trainer);
+        data_parallel_release(trainer, n_workers);
+        return DATA_PARALLEL_INIT_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
+void data_parallel_cleanup(struct data_parallel_trainer *const trainer)
+{
+    if (!trainer)
+    {
+        return;
+    }
+
+    trainer->running = false;
+    pthread_barrier_wait(&trainer->step_start);
+    for (size_t i = 0; i < trainer->n_workers; i++)
+    {
+        pthread_join(trainer->workers[i].thread, NULL);
+    }
+
+    data_parallel_destroy_sync(trainer);
+    data_parallel_release(trainer, trainer->n_workers);
+}
+
+cgrad_error data_parallel_step(struct data_parallel_trainer *const trainer, struct tensor *const x, struct tensor *const y, double *const loss)
+{
+    if (!trainer)
+    {
+        return DATA_PARALLEL_TRAINER_NULL;
+    }
+    if (!x || !y)
+    {
+        return TENSOR_NULL;
+    }
+    if (x->shape_size == 0 || y->shape_size == 0 || x->shape[0] == 0 || x->shape[0] != y->shape[0])
+    {
+        return INVALID_BATCH_SIZE;
+    }
+
+    trainer->x = x;
+    trainer->y = y;
+    trainer->batch_size = x->shape[0];
+
+    // Rows are spread evenly, the first workers taking one more row when the batch does not divide
+    const size_t base = trainer->batch_size / trainer->n_workers;
+    const size_t remainder = trainer->batch_size % trainer->n_workers;
+    for (size_t i = 0; i < trainer->n_workers; i++)
+    {
+        struct data_parallel_worker *worker = &trainer->workers[i];
+        worker->shard_begin = i * base + (i < remainder ? i : remainder);
+        worker->shard_size = base + (i < remainder ? 1 : 0);
+        worker->loss = 0.0;
+        worker->err = NO_ERROR;
+    }
+
+    pthread_barrier_wait(&trainer->step_start);
+    pthread_barrier_wait(&trainer->step_done);
+
+    double batch_loss = 0.0;
+    for (size_t i = 0; i < trainer->n_workers; i++)
+    {
+        const struct data_parallel_worker *worker = &trainer->workers[i];
+        if (worker->err != NO_ERROR)
+        {
+            return worker->err;
+        }
+        batch_loss += worker->loss * worker->shard_size / trainer->batch_size;
+    }
+
+    if (loss)
+    {
+        *loss = batch_loss;
+    }
+
+    return NO_ERROR;
+}
+
+static void *data_parallel_worker_run(void *arg)
+{
+    struct data_parallel_worker *worker = arg;
+    struct data_parallel_trainer *trainer = worker->trainer;
+
+    pthread_mutex_lock(&trainer->start_mutex);
+    const bool started = trainer->running;
+    pthread_mutex_unlock(&trainer->start_mutex);
+    if (!started)
+    {
+        return NULL;
+    }
+
+    while (true)
+    {
+        pthread_barrier_wait(&trainer->step_start);
+        if (!trainer->running)
+        {
+            break;
+        }
+
+        if (worker->shard_size > 0)
+        {
+            worker->err = data_parallel_worker_backward(worker);
+        }
+        pthread_barrier_wait(&trainer->backward_done);
+
+        // Every worker sees the same errors after the barrier, so they all skip the reduction together
+        bool failed = false;
+        for (size_t i = 0; i < trainer->n_workers; i++)
+        {
+            failed |= trainer->workers[i].err != NO_ERROR;
+        }
+        if (!failed)
+        {
+            data_parallel_worker_reduce(worker);
+        }
+
+        pthread_barrier_wait(&trainer->step_done);
+    }
+
+    return NULL;
+}
+
+static cgrad_error data_parallel_worker_backward(struct data_parallel_worker *const worker)
+{
+    struct data_parallel_trainer *trainer = worker->trainer;
+    struct cgrad_env *env = &worker->env;
+
+    // Synchronize the replica with the parameters updated by the last optimizer step
+    for (size_t i = 0; i < worker->params.size; i++)
+    {
+        const struct tensor *param = trainer->params->params[i];
+        memcpy(worker->params.params[i]->data, param->data, param->data_size * dtype_sizeof(param->dtype));
+        tensor_mark_modified(worker->params.params[i]);
+
+        // Row-sparse gradients restart from no row, instead of keeping the rows of the previous steps
+        tensor_sparse_grad_clear(worker->params.params[i], &env->tensor_alloc);
+    }
+    model_params_zero_grad(&worker->params);
+
+    cgrad_error err = NO_ERROR;
+    struct tensor *x = NULL;
+    struct tensor *y = NULL;
+    struct tensor *loss = NULL;
+    if ((err = data_parallel_worker_shard(worker, trainer->x, &x)) != NO_ERROR ||
+        (err = data_parallel_worker_shard(worker, trainer->y, &y)) != NO_ERROR)
+    {
+        goto cleanup;
+    }
+
+    if ((err = trainer->model.loss(worker->replica, x, y, &loss, env)) != NO_ERROR)
+    {
+        goto cleanup;
+    }
+    worker->loss = loss->dtype == DTYPE_FLOAT64 ? ((double *)loss->data)[0] : ((float *)loss->data)[0];
+
+    err = backward(loss, env);
+
+cleanup:
+    cgrad_env_free_intermediates(env);
+    if (x)
+    {
+        tensor_free(env, x);
+    }
+    if (y)
+    {
+        tensor_free(env, y);
+    }
+    if (loss)
+    {
+        tensor_free(env, loss);
+    }
+    return err;
+}
+
+static cgrad_error data_parallel_worker_shard(struct data_parallel_worker *const worker, const struct tensor *const src, struct tensor **const shard)
+{
+    size_t shape[TENSOR_MAX_SHAPE_SIZE];
+    memcpy(shape, src->shape, src->shape_size * sizeof(size_t));
+    shape[0] = worker->shard_size;
+
+    *shard = tensor_alloc(&worker->env, shape, src->shape_size, src->dtype);
+    if (!*shard)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+    tensor_set_requires_grad(*shard, src->requires_grad);
+
+    const size_t row_bytes = src->data_size / src->shape[0] * dtype_sizeof(src->dtype);
+    memcpy((*shard)->data, (const unsigned char *)src->data + worker->shard_begin * row_bytes, worker->shard_size * row_bytes);
+
+    return NO_ERROR;
+}
+
+static void data_parallel_worker_reduce(struct data_parallel_worker *const worker)
+{
+    struct data_parallel_trainer *trainer = worker->trainer;
+    const size_t *offsets = trainer->param_offsets;
+
+    for (size_t p = 0; p < trainer->params->size; p++)
+    {
+        const size_t begin = worker->reduce_begin > offsets[p] ? worker->reduce_begin : offsets[p];
+        const size_t end = worker->reduce_end < offsets[p + 1] ? worker->reduce_end : offsets[p + 1];
+        struct tensor *grad = trainer->params->params[p]->grad;
+
+        // The destination block is summed with every replica before moving on, so it is read and written once
+        for (size_t block = begin; block < end; block += DATA_PARALLEL_REDUCE_BLOCK_SIZE)
+        {
+            const size_t start = block - offsets[p];
+            const size_t size = end - block < DATA_PARALLEL_REDUCE_BLOCK_SIZE ? end - block : DATA_PARALLEL_REDUCE_BLOCK_SIZE;
+
+            for (size_t k = 0; k < trainer->n_workers; k++)
+            {
+                const struct data_parallel_worker *replica = &trainer->workers[k];
+                const struct tensor *replica_grad = replica->params.params[p]->grad;
+
+                // Parameters not reached by the backward pass of a replica have no gradient
+                if (replica->shard_size == 0 || !replica_grad)
+                {
+                    continue;
+                }
+
+                const double weight = (double)replica->shard_size / trainer->batch_size;
+                const struct tensor *replica_rows = replica->params.params[p]->grad_rows;
+                if (replica_rows)
+                {
+                    data_parallel_reduce_rows(grad, replica_grad, replica_rows, start, size, weight);
+                    continue;
+                }
+
+                const size_t offset = start * dtype_sizeof(grad->dtype);
+                data_parallel_axpy((unsigned char *)grad->data + offset, (const unsigned char *)replica_grad->data + offset, size, weight, grad->dtype);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Adds the elements [start, start + size) of a row-sparse replica gradient into the dense gradient, scattering
+ * the rows held by the replica to their indexes.
+ */
+static void data_parallel_reduce_rows(struct tensor *const grad, const struct tensor *const replica_grad, const struct tensor *const rows, const size_t start, const size_t size, const double weight)
+{
+    const size_t row_size = grad->data_size / grad->shape[0];
+    const size_t element_bytes = dtype_sizeof(grad->dtype);
+    const int32_t *rows_data = rows->data;
+    const size_t n_rows = rows->data_size;
+    const size_t end = start + size;
+
+    // The rows are sorted, so the first one overlapping the block is found by bisection
+    size_t lo = 0;
+    size_t hi = n_rows;
+    while (lo < hi)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (((size_t)rows_data[mid] + 1) * row_size <= start)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    for (size_t k = lo; k < n_rows && (size_t)rows_data[k] * row_size < end; k++)
+    {
+        const size_t row_begin = (size_t)rows_data[k] * row_size;
+        const size_t first = row_begin > start ? row_begin : start;
+        const size_t last = row_begin + row_size < end ? row_begin + row_size : end;
+        const size_t src = k * row_size + (first - row_begin);
+        data_parallel_axpy((unsigned char *)grad->data + first * element_bytes, (const unsigned char *)replica_grad->data + src * element_bytes, last - first, weight, grad->dtype);
+    }
+}
+
+static void data_parallel_axpy(void *const dst, const void *const src, const size_t size, const double weight, const cgrad_dtype dtype)
+{
+    if (dtype == DTYPE_FLOAT32)
+    {
+        float *restrict d = dst;
+        const float *restrict s = src;
+        const float w = weight;
+        for (size_t i = 0; i < size; i++)
+        {
+            d[i] += w * s[i];
+        }
+    }
+    else
+    {
+        double *restrict d = dst;
+        const double *restrict s = src;
+        for (size_t i = 0; i < size; i++)
+        {
+            d[i] += weight * s[i];
+        }
+    }
+}
+
+static void data_parallel_destroy_sync(struct data_parallel_trainer *const trainer)
+{
+    pthread_mutex_destroy(&trainer->start_mutex);
+    pthread_barrier_destroy(&trainer->step_start);
+    pthread_barrier_destroy(&trainer->backward_done);
+    pthread_barrier_destroy(&trainer->step_done);
+}
+
+static void data_parallel_release(struct data_parallel_trainer *const trainer, const size_t n_initialized)
+{
+    for (size_t i = 0; i < n_initialized; i++)
+    {
+        trainer->model.replica_cleanup(trainer->workers[i].replica);
+        cgrad_env_cleanup(&trainer->workers[i].env);
+    }
+    free(trainer->workers);
+    free(trainer->replicas);
+}
+
+static cgrad_error data_parallel_check_replica(const struct model_params *const params, const struct model_params *const replica_params)
+{
+    if (params->size != replica_params->size)
+    {
+        return DATA_PARALLEL_PARAMS_MISMATCH;
+    }
+
+    for (size_t i = 0; i < params->size; i++)
+    {
+        const struct tensor *param = params->params[i];
+        const struct tensor *replica_param = replica_params->params[i];
+        if (param->dtype != replica_param->dtype || param->data_size != replica_param->data_size)
+        {
+            return DATA_PARALLEL_PARAMS_MISMATCH;
+        }
+    }
+
+    return NO_ERROR;
+}
@@ -0,0 +1,96 @@
+#include "cgrad/parallel/process_group.h"
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void process_group_kill(const pid_t *const pids, const size_t world_size);
+
+cgrad_error process_group_launch(const size_t world_size, process_group_worker_fn worker, void *arg)
+{
+    if (!worker || world_size == 0)
+    {
+        return PROCESS_GROUP_LAUNCH_FAILED;
+    }
+
+    pid_t *pids = calloc(world_size, sizeof(pid_t));
+    if (!pids)
+    {
+        return PROCESS_GROUP_LAUNCH_FAILED;
+    }
+
+    // Buffered output would otherwise be written again by every child
+    fflush(NULL);
+
+    for (size_t rank = 0; rank < world_size; rank++)
+    {
+        pid_t pid = fork();
+        if (pid == -1)
+        {
+            process_group_kill(pids, world_size);
+            for (size_t started = 0; started < rank; started++)
+            {
+                waitpid(pids[started], NULL, 0);
+            }
+            free(pids);
+            return PROCESS_GROUP_LAUNCH_FAILED;
+        }
+        if (pid == 0)
+        {
+            const cgrad_error err = worker(rank, world_size, arg);
+            fflush(NULL);
+            _exit(err == NO_ERROR ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+        pids[rank] = pid;
+    }
+
+    cgrad_error err = NO_ERROR;
+    size_t n_running = world_size;
+    while (n_running > 0)
+    {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid == -1)
+        {
+            break;
+        }
+
+        // Other children of the caller are not part of the group
+        bool member = false;
+        for (size_t rank = 0; rank < world_size; rank++)
+        {
+            if (pids[rank] == pid)
+            {
+                pids[rank] = 0;
+                member = true;
+            }
+        }
+        if (!member)
+        {
+            continue;
+        }
+        n_running--;
+
+        if (err == NO_ERROR && (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS))
+        {
+            err = PROCESS_GROUP_WORKER_FAILED;
+            process_group_kill(pids, world_size);
+        }
+    }
+
+    free(pids);
+    return err;
+}
+
+static void process_group_kill(const pid_t *const pids, const size_t world_size)
+{
+    for (size_t rank = 0; rank < world_size; rank++)
+    {
+        if (pids[rank] > 0)
+        {
+            kill(pids[rank], SIGKILL);
+        }
+    }
+}
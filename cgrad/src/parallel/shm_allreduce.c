@@ -0,0 +1,270 @@
+#include "cgrad/parallel/shm_allreduce.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char SHM_ALLREDUCE_MAGIC[8] = {'C', 'G', 'R', 'A', 'D', 'S', 'H', 'M'};
+
+struct shm_allreduce_header
+{
+    char magic[8];
+    uint64_t world_size;
+    uint64_t slot_size;
+    _Atomic uint32_t arrived;         /**< Processes waiting at the barrier. */
+    _Atomic uint32_t generation;      /**< Incremented when the barrier opens, futex word of the waiters. */
+};
+
+struct shm_allreduce_ctx
+{
+    struct shm_allreduce_header *header;
+    unsigned char *slots;
+    size_t mapping_size;
+    size_t rank;
+};
+
+static size_t shm_allreduce_slots_offset();
+static cgrad_error shm_allreduce_sum(void *ctx, void *data, const size_t n, const cgrad_dtype dtype);
+static cgrad_error shm_allreduce_barrier(void *ctx);
+static void shm_allreduce_cleanup(void *ctx);
+static void shm_allreduce_reduce_chunk(struct shm_allreduce_ctx *const ctx, const size_t begin, const size_t end, const cgrad_dtype dtype);
+
+cgrad_error shm_allreduce_create(const char *const name, const size_t world_size, const size_t slot_size)
+{
+    if (!name || world_size == 0 || slot_size < SHM_ALLREDUCE_ALIGNMENT)
+    {
+        return ALLREDUCE_INIT_FAILED;
+    }
+
+    const size_t aligned_slot_size = slot_size / SHM_ALLREDUCE_ALIGNMENT * SHM_ALLREDUCE_ALIGNMENT;
+    const size_t size = shm_allreduce_slots_offset() + world_size * aligned_slot_size;
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1)
+    {
+        return ALLREDUCE_INIT_FAILED;
+    }
+    if (ftruncate(fd, size) == -1)
+    {
+        close(fd);
+        shm_unlink(name);
+        return ALLREDUCE_INIT_FAILED;
+    }
+
+    struct shm_allreduce_header *header = mmap(NULL, sizeof(struct shm_allreduce_header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (header == MAP_FAILED)
+    {
+        shm_unlink(name);
+        return ALLREDUCE_INIT_FAILED;
+    }
+
+    header->world_size = world_size;
+    header->slot_size = aligned_slot_size;
+    atomic_init(&header->arrived, 0);
+    atomic_init(&header->generation, 0);
+    memcpy(header->magic, SHM_ALLREDUCE_MAGIC, sizeof(SHM_ALLREDUCE_MAGIC));
+    munmap(header, sizeof(struct shm_allreduce_header));
+
+    return NO_ERROR;
+}
+
+cgrad_error shm_allreduce_unlink(const char *const name)
+{
+    if (!name || shm_unlink(name) == -1)
+    {
+        return ALLREDUCE_INIT_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error shm_allreduce_init(struct allreduce_backend *const backend, const char *const name, const size_t rank)
+{
+    if (!backend)
+    {
+        return ALLREDUCE_BACKEND_NULL;
+    }
+    if (!name)
+    {
+        return ALLREDUCE_INIT_FAILED;
+    }
+
+    int fd = shm_open(name, O_RDWR, 0600);
+    if (fd == -1)
+    {
+        return ALLREDUCE_INIT_FAILED;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t)shm_allreduce_slots_offset())
+    {
+        close(fd);
+        return ALLREDUCE_INIT_FAILED;
+    }
+
+    const size_t size = st.st_size;
+    void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        return ALLREDUCE_INIT_FAILED;
+    }
+
+    struct shm_allreduce_header *header = addr;
+    if (memcmp(header->magic, SHM_ALLREDUCE_MAGIC, sizeof(SHM_ALLREDUCE_MAGIC)) != 0 || rank >= header->world_size ||
+        shm_allreduce_slots_offset() + header->world_size * header->slot_size > size)
+    {
+        munmap(addr, size);
+        return ALLREDUCE_INIT_FAILED;
+    }
+
+    struct shm_allreduce_ctx *ctx = malloc(sizeof(struct shm_allreduce_ctx));
+    if (!ctx)
+    {
+        munmap(addr, size);
+        return ALLREDUCE_INIT_FAILED;
+    }
+    ctx->header = header;
+    ctx->slots = (unsigned char *)addr + shm_allreduce_slots_offset();
+    ctx->mapping_size = size;
+    ctx->rank = rank;
+
+    backend->sum = &shm_allreduce_sum;
+    backend->barrier = &shm_allreduce_barrier;
+    backend->cleanup = &shm_allreduce_cleanup;
+    backend->ctx = ctx;
+    backend->rank = rank;
+    backend->world_size = header->world_size;
+    backend->flat_grads = NULL;
+    backend->flat_grads_capacity = 0;
+
+    return NO_ERROR;
+}
+
+static size_t shm_allreduce_slots_offset()
+{
+    return (sizeof(struct shm_allreduce_header) + SHM_ALLREDUCE_ALIGNMENT - 1) / SHM_ALLREDUCE_ALIGNMENT * SHM_ALLREDUCE_ALIGNMENT;
+}
+
+static cgrad_error shm_allreduce_sum(void *ctx, void *data, const size_t n, const cgrad_dtype dtype)
+{
+    struct shm_allreduce_ctx *shm = ctx;
+    if (dtype != DTYPE_FLOAT32 && dtype != DTYPE_FLOAT64)
+    {
+        return TENSOR_INVALID_DTYPE;
+    }
+    if (!data)
+    {
+        return INPUT_NULL;
+    }
+
+    const size_t world_size = shm->header->world_size;
+    const size_t slot_size = shm->header->slot_size;
+    const size_t element_size = dtype_sizeof(dtype);
+    const size_t piece_capacity = slot_size / element_size;
+    const size_t chunk_alignment = SHM_ALLREDUCE_ALIGNMENT / element_size;
+
+    for (size_t piece = 0; piece < n; piece += piece_capacity)
+    {
+        const size_t piece_size = n - piece < piece_capacity ? n - piece : piece_capacity;
+        unsigned char *src = (unsigned char *)data + piece * element_size;
+
+        // Chunks are aligned to cache lines, so that no line is written by two processes
+        size_t chunk = (piece_size + world_size - 1) / world_size;
+        chunk = (chunk + chunk_alignment - 1) / chunk_alignment * chunk_alignment;
+
+        memcpy(shm->slots + shm->rank * slot_size, src, piece_size * element_size);
+        shm_allreduce_barrier(shm);
+
+        // Reduce-scatter: the sum of each chunk is stored in the slot of the process owning it
+        const size_t begin = shm->rank * chunk < piece_size ? shm->rank * chunk : piece_size;
+        const size_t end = begin + chunk < piece_size ? begin + chunk : piece_size;
+        shm_allreduce_reduce_chunk(shm, begin, end, dtype);
+        shm_allreduce_barrier(shm);
+
+        // Allgather: every process reads the chunk of each owner
+        for (size_t owner = 0; owner < world_size; owner++)
+        {
+            const size_t owner_begin = owner * chunk < piece_size ? owner * chunk : piece_size;
+            const size_t owner_end = owner_begin + chunk < piece_size ? owner_begin + chunk : piece_size;
+            memcpy(src + owner_begin * element_size, shm->slots + owner * slot_size + owner_begin * element_size, (owner_end - owner_begin) * element_size);
+        }
+
+        // Slots are overwritten by the next piece or sum only once everyone has gathered
+        shm_allreduce_barrier(shm);
+    }
+
+    return NO_ERROR;
+}
+
+static void shm_allreduce_reduce_chunk(struct shm_allreduce_ctx *const ctx, const size_t begin, const size_t end, const cgrad_dtype dtype)
+{
+    const size_t world_size = ctx->header->world_size;
+    const size_t slot_size = ctx->header->slot_size;
+
+    // Each chunk is reduced by one process only and copied by the others, so all results are bitwise identical
+    for (size_t r = 0; r < world_size; r++)
+    {
+        if (r == ctx->rank)
+        {
+            continue;
+        }
+
+        if (dtype == DTYPE_FLOAT32)
+        {
+            float *restrict dst = (float *)(ctx->slots + ctx->rank * slot_size);
+            const float *restrict src = (const float *)(ctx->slots + r * slot_size);
+            for (size_t i = begin; i < end; i++)
+            {
+                dst[i] += src[i];
+            }
+        }
+        else
+        {
+            double *restrict dst = (double *)(ctx->slots + ctx->rank * slot_size);
+            const double *restrict src = (const double *)(ctx->slots + r * slot_size);
+            for (size_t i = begin; i < end; i++)
+            {
+                dst[i] += src[i];
+            }
+        }
+    }
+}
+
+static cgrad_error shm_allreduce_barrier(void *ctx)
+{
+    struct shm_allreduce_header *header = ((struct shm_allreduce_ctx *)ctx)->header;
+
+    const uint32_t generation = atomic_load(&header->generation);
+    if (atomic_fetch_add(&header->arrived, 1) + 1 == header->world_size)
+    {
+        // The last process to arrive resets the count before opening the barrier
+        atomic_store(&header->arrived, 0);
+        atomic_fetch_add(&header->generation, 1);
+        syscall(SYS_futex, &header->generation, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+        return NO_ERROR;
+    }
+
+    // Spurious wakeups and signals only cause the generation to be checked again
+    while (atomic_load(&header->generation) == generation)
+    {
+        syscall(SYS_futex, &header->generation, FUTEX_WAIT, generation, NULL, NULL, 0);
+    }
+
+    return NO_ERROR;
+}
+
+static void shm_allreduce_cleanup(void *ctx)
+{
+    struct shm_allreduce_ctx *shm = ctx;
+    munmap(shm->header, shm->mapping_size);
+    free(shm);
+}
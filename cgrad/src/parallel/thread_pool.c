@@ -0,0 +1,213 @@
+#include "cgrad/parallel/thread_pool.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+static void *thread_pool_worker_loop(void *arg);
+static void thread_pool_stop(struct thread_pool *const pool, const size_t n_started);
+
+cgrad_error thread_pool_init(struct thread_pool *const pool, const size_t n_threads)
+{
+    if (!pool)
+    {
+        return THREAD_POOL_NULL;
+    }
+    if (n_threads == 0)
+    {
+        return THREAD_POOL_INIT_FAILED;
+    }
+
+    pool->n_threads = n_threads;
+    pool->generation = 0;
+    pool->pending = 0;
+    pool->busy = false;
+    pool->stopping = false;
+    pool->fn = NULL;
+    pool->arg = NULL;
+    pool->n = 0;
+    pool->n_tasks = 0;
+    pool->task_size = 0;
+
+    pool->workers = NULL;
+    if (n_threads > 1)
+    {
+        pool->workers = calloc(n_threads - 1, sizeof(struct thread_pool_worker));
+        if (!pool->workers)
+        {
+            return THREAD_POOL_INIT_FAILED;
+        }
+    }
+
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0)
+    {
+        free(pool->workers);
+        return THREAD_POOL_INIT_FAILED;
+    }
+    if (pthread_cond_init(&pool->work_ready, NULL) != 0)
+    {
+        pthread_mutex_destroy(&pool->mutex);
+        free(pool->workers);
+        return THREAD_POOL_INIT_FAILED;
+    }
+    if (pthread_cond_init(&pool->work_done, NULL) != 0)
+    {
+        pthread_cond_destroy(&pool->work_ready);
+        pthread_mutex_destroy(&pool->mutex);
+        free(pool->workers);
+        return THREAD_POOL_INIT_FAILED;
+    }
+
+    for (size_t i = 0; i < n_threads - 1; i++)
+    {
+        struct thread_pool_worker *worker = &pool->workers[i];
+        worker->pool = pool;
+        worker->index = i + 1;
+        if (pthread_create(&worker->thread, NULL, &thread_pool_worker_loop, worker) != 0)
+        {
+            thread_pool_stop(pool, i);
+            return THREAD_POOL_INIT_FAILED;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+void thread_pool_cleanup(struct thread_pool *const pool)
+{
+    if (!pool)
+    {
+        return;
+    }
+
+    thread_pool_stop(pool, pool->n_threads - 1);
+}
+
+void thread_pool_parallel_for(struct thread_pool *const pool, const size_t n, const size_t grain, thread_pool_fn fn, void *arg)
+{
+    if (n == 0)
+    {
+        return;
+    }
+
+    const size_t min_task_size = grain ? grain : 1;
+    size_t n_tasks = pool ? n / min_task_size : 1;
+    if (pool && n_tasks > pool->n_threads)
+    {
+        n_tasks = pool->n_threads;
+    }
+    if (n_tasks <= 1)
+    {
+        fn(arg, 0, n);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->busy)
+    {
+        // Nested loops run serially within the range of the outer one
+        pthread_mutex_unlock(&pool->mutex);
+        fn(arg, 0, n);
+        return;
+    }
+
+    const size_t task_size = (n + n_tasks - 1) / n_tasks;
+    pool->busy = true;
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->n = n;
+    pool->task_size = task_size;
+    pool->n_tasks = (n + task_size - 1) / task_size;
+    pool->pending = pool->n_tasks - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    fn(arg, 0, task_size);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->pending > 0)
+    {
+        pthread_cond_wait(&pool->work_done, &pool->mutex);
+    }
+    pool->busy = false;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+size_t thread_pool_default_size(void)
+{
+    const char *value = getenv(THREAD_POOL_NUM_THREADS_ENV);
+    if (value && *value)
+    {
+        char *end = NULL;
+        const unsigned long n_threads = strtoul(value, &end, 10);
+        if (*end == '\0' && n_threads > 0)
+        {
+            return n_threads;
+        }
+    }
+
+    const long n_processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return n_processors > 0 ? (size_t)n_processors : 1;
+}
+
+static void *thread_pool_worker_loop(void *arg)
+{
+    struct thread_pool_worker *worker = arg;
+    struct thread_pool *pool = worker->pool;
+    size_t seen_generation = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    while (true)
+    {
+        while (!pool->stopping && pool->generation == seen_generation)
+        {
+            pthread_cond_wait(&pool->work_ready, &pool->mutex);
+        }
+        if (pool->stopping)
+        {
+            break;
+        }
+        seen_generation = pool->generation;
+
+        // Workers beyond the number of ranges of a small loop sit it out
+        if (worker->index >= pool->n_tasks)
+        {
+            continue;
+        }
+
+        thread_pool_fn fn = pool->fn;
+        void *fn_arg = pool->arg;
+        const size_t begin = worker->index * pool->task_size;
+        const size_t end = begin + pool->task_size < pool->n ? begin + pool->task_size : pool->n;
+        pthread_mutex_unlock(&pool->mutex);
+
+        fn(fn_arg, begin, end);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->pending == 0)
+        {
+            pthread_cond_signal(&pool->work_done);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+static void thread_pool_stop(struct thread_pool *const pool, const size_t n_started)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (size_t i = 0; i < n_started; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&pool->work_done);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->workers);
+    pool->workers = NULL;
+}
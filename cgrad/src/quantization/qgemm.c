@@ -0,0 +1,384 @@
+#include "cgrad/quantization/qgemm.h"
+#include "cgrad/utils/half.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+#include <immintrin.h>
+#endif
+
+// Rows of the input and output channels computed by the micro kernel
+#define QGEMM_MR 2
+#define QGEMM_NR 4
+
+static inline double qgemm_weight_get(const struct tensor *const weight, const size_t idx);
+static void qgemm_tile(const uint8_t *const a, const size_t lda, const size_t m, const size_t i, const struct qgemm_weights *const w, const size_t j, int32_t acc[QGEMM_MR][QGEMM_NR]);
+static void qgemm_store_row(const int32_t acc[QGEMM_NR], const size_t i, const size_t j, const size_t n_cols, const struct qgemm_weights *const w, const struct qgemm_epilogue *const epilogue, void *const c, const size_t c_row_stride, const size_t c_col_stride);
+static inline void qgemm_store(const int32_t acc, const size_t i, const size_t j, const struct qgemm_weights *const w, const struct qgemm_epilogue *const epilogue, void *const c, const size_t c_row_stride, const size_t c_col_stride);
+
+cgrad_error qgemm_weights_pack(struct qgemm_weights *const w, const struct tensor *const weight, const size_t n, const size_t k, const size_t n_stride, const size_t k_stride, const quant_granularity granularity, struct cgrad_env *const env)
+{
+    if (!w || !weight)
+    {
+        return TENSOR_NULL;
+    }
+    if (!weight->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (n * k != weight->data_size)
+    {
+        return TENSOR_DATA_SIZE_MISMATCH;
+    }
+    if (weight->dtype != DTYPE_FLOAT64 && weight->dtype != DTYPE_FLOAT32 && !dtype_is_half(weight->dtype))
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    const size_t k_padded = (k + QGEMM_K_ALIGNMENT - 1) / QGEMM_K_ALIGNMENT * QGEMM_K_ALIGNMENT;
+    const size_t shape[] = {n, k_padded};
+    w->data = tensor_allocator_no_grad_zero_alloc(&env->tensor_alloc, shape, 2, DTYPE_INT8);
+    w->scales = malloc(n * sizeof(float));
+    w->row_sums = malloc(n * sizeof(int32_t));
+    w->n = n;
+    w->k = k;
+    w->k_padded = k_padded;
+
+    if (!w->data || !w->scales || !w->row_sums)
+    {
+        qgemm_weights_cleanup(w, env);
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    // Largest absolute value of each output channel
+    double tensor_abs_max = 0.0;
+    for (size_t j = 0; j < n; j++)
+    {
+        double abs_max = 0.0;
+        for (size_t p = 0; p < k; p++)
+        {
+            const double value = fabs(qgemm_weight_get(weight, j * n_stride + p * k_stride));
+            abs_max = value > abs_max ? value : abs_max;
+        }
+        w->scales[j] = (float)abs_max;
+        tensor_abs_max = abs_max > tensor_abs_max ? abs_max : tensor_abs_max;
+    }
+
+    int8_t *data = w->data->data;
+    for (size_t j = 0; j < n; j++)
+    {
+        const double abs_max = granularity == QUANT_PER_TENSOR ? tensor_abs_max : w->scales[j];
+        const float scale = abs_max > 0 ? (float)(abs_max / QUANT_WEIGHT_QMAX) : 1.0f;
+
+        int32_t row_sum = 0;
+        for (size_t p = 0; p < k; p++)
+        {
+            long q = lrint(qgemm_weight_get(weight, j * n_stride + p * k_stride) / scale);
+            q = q < -QUANT_WEIGHT_QMAX ? -QUANT_WEIGHT_QMAX : q;
+            q = q > QUANT_WEIGHT_QMAX ? QUANT_WEIGHT_QMAX : q;
+
+            data[j * k_padded + p] = (int8_t)q;
+            row_sum += (int32_t)q;
+        }
+
+        w->scales[j] = scale;
+        w->row_sums[j] = row_sum;
+    }
+
+    return NO_ERROR;
+}
+
+void qgemm_weights_cleanup(struct qgemm_weights *const w, struct cgrad_env *const env)
+{
+    if (!w)
+    {
+        return;
+    }
+
+    if (w->data)
+    {
+        tensor_allocator_no_grad_free(&env->tensor_alloc, w->data);
+    }
+    free(w->scales);
+    free(w->row_sums);
+
+    w->data = NULL;
+    w->scales = NULL;
+    w->row_sums = NULL;
+}
+
+cgrad_error qgemm_u8s8(const uint8_t *const a, const size_t m, const struct qgemm_weights *const w, const struct qgemm_epilogue *const epilogue, void *const c, const size_t c_row_stride, const size_t c_col_stride)
+{
+    const uint8_t *a_packed = a;
+    size_t lda = w->k;
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    // The vectorized kernel reads whole vectors, so the input rows are zero padded like the weights
+    uint8_t *a_padded = NULL;
+    if (w->k != w->k_padded)
+    {
+        a_padded = calloc(m * w->k_padded, sizeof(uint8_t));
+        if (!a_padded)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+        for (size_t i = 0; i < m; i++)
+        {
+            memcpy(a_padded + i * w->k_padded, a + i * w->k, w->k);
+        }
+        a_packed = a_padded;
+    }
+    lda = w->k_padded;
+#endif
+
+    int32_t acc[QGEMM_MR][QGEMM_NR];
+
+    // Output channels in the outer loop, so that the weights of a tile stay in cache while the input is streamed
+    for (size_t j = 0; j < w->n; j += QGEMM_NR)
+    {
+        for (size_t i = 0; i < m; i += QGEMM_MR)
+        {
+            qgemm_tile(a_packed, lda, m, i, w, j, acc);
+
+            const size_t n_cols = w->n - j < QGEMM_NR ? w->n - j : QGEMM_NR;
+            for (size_t ii = 0; ii < QGEMM_MR && i + ii < m; ii++)
+            {
+                qgemm_store_row(acc[ii], i + ii, j, n_cols, w, epilogue, c, c_row_stride, c_col_stride);
+            }
+        }
+    }
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    free(a_padded);
+#endif
+
+    return NO_ERROR;
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+
+static inline __m256i qgemm_dot_accumulate(const __m256i acc, const __m256i a, const __m256i b)
+{
+#if defined(__AVXVNNI__)
+    return _mm256_dpbusd_avx_epi32(acc, a, b);
+#elif defined(__AVX512VNNI__) && defined(__AVX512VL__)
+    return _mm256_dpbusd_epi32(acc, a, b);
+#else
+    // Pairs of u8 * s8 products summed in 16 bits, exact thanks to the 7 bit activations, then widened to 32 bits
+    const __m256i pairs = _mm256_maddubs_epi16(a, b);
+    return _mm256_add_epi32(acc, _mm256_madd_epi16(pairs, _mm256_set1_epi16(1)));
+#endif
+}
+
+static inline __m128i qgemm_hsum_4(const __m256i v0, const __m256i v1, const __m256i v2, const __m256i v3)
+{
+    // Pairwise sums within lanes, then across the two lanes, yield the four horizontal sums in order
+    const __m256i sum = _mm256_hadd_epi32(_mm256_hadd_epi32(v0, v1), _mm256_hadd_epi32(v2, v3));
+    return _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+}
+
+static void qgemm_tile(const uint8_t *const a, const size_t lda, const size_t m, const size_t i, const struct qgemm_weights *const w, const size_t j, int32_t acc[QGEMM_MR][QGEMM_NR])
+{
+    const int8_t *b = w->data->data;
+    const size_t ldb = w->k_padded;
+
+    // Rows and channels past the edges repeat the last one, their results are discarded
+    const uint8_t *a_rows[QGEMM_MR];
+    const int8_t *b_rows[QGEMM_NR];
+    for (size_t ii = 0; ii < QGEMM_MR; ii++)
+    {
+        a_rows[ii] = a + (i + ii < m ? i + ii : m - 1) * lda;
+    }
+    for (size_t jj = 0; jj < QGEMM_NR; jj++)
+    {
+        b_rows[jj] = b + (j + jj < w->n ? j + jj : w->n - 1) * ldb;
+    }
+
+    __m256i c[QGEMM_MR][QGEMM_NR];
+    for (size_t ii = 0; ii < QGEMM_MR; ii++)
+    {
+        for (size_t jj = 0; jj < QGEMM_NR; jj++)
+        {
+            c[ii][jj] = _mm256_setzero_si256();
+        }
+    }
+
+    for (size_t p = 0; p < ldb; p += QGEMM_K_ALIGNMENT)
+    {
+        __m256i a_vec[QGEMM_MR];
+        for (size_t ii = 0; ii < QGEMM_MR; ii++)
+        {
+            a_vec[ii] = _mm256_loadu_si256((const __m256i *)(a_rows[ii] + p));
+        }
+        for (size_t jj = 0; jj < QGEMM_NR; jj++)
+        {
+            const __m256i b_vec = _mm256_loadu_si256((const __m256i *)(b_rows[jj] + p));
+            for (size_t ii = 0; ii < QGEMM_MR; ii++)
+            {
+                c[ii][jj] = qgemm_dot_accumulate(c[ii][jj], a_vec[ii], b_vec);
+            }
+        }
+    }
+
+    for (size_t ii = 0; ii < QGEMM_MR; ii++)
+    {
+        _mm_storeu_si128((__m128i *)acc[ii], qgemm_hsum_4(c[ii][0], c[ii][1], c[ii][2], c[ii][3]));
+    }
+}
+
+static void qgemm_store_row(const int32_t acc[QGEMM_NR], const size_t i, const size_t j, const size_t n_cols, const struct qgemm_weights *const w, const struct qgemm_epilogue *const epilogue, void *const c, const size_t c_row_stride, const size_t c_col_stride)
+{
+    if (n_cols < QGEMM_NR)
+    {
+        for (size_t jj = 0; jj < n_cols; jj++)
+        {
+            qgemm_store(acc[jj], i, j + jj, w, epilogue, c, c_row_stride, c_col_stride);
+        }
+        return;
+    }
+
+    // Same operations as qgemm_store on the QGEMM_NR outputs of the row at once
+    const __m128i zero_point = _mm_set1_epi32(epilogue->input_params.zero_point);
+    const __m128i compensation = _mm_mullo_epi32(zero_point, _mm_loadu_si128((const __m128i *)(w->row_sums + j)));
+    const __m128i centered = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)acc), compensation);
+
+    const __m128 scales = _mm_mul_ps(_mm_set1_ps(epilogue->input_params.scale), _mm_loadu_ps(w->scales + j));
+    __m128 value = _mm_mul_ps(_mm_cvtepi32_ps(centered), scales);
+    if (epilogue->bias)
+    {
+        value = _mm_add_ps(value, _mm_loadu_ps(epilogue->bias + j));
+    }
+    if (epilogue->relu)
+    {
+        value = _mm_max_ps(value, _mm_setzero_ps());
+    }
+
+    const size_t idx = i * c_row_stride + j * c_col_stride;
+    if (!epilogue->requantize)
+    {
+        float *out = (float *)c + idx;
+        if (c_col_stride == 1)
+        {
+            _mm_storeu_ps(out, value);
+            return;
+        }
+
+        float values[QGEMM_NR];
+        _mm_storeu_ps(values, value);
+        for (size_t jj = 0; jj < QGEMM_NR; jj++)
+        {
+            out[jj * c_col_stride] = values[jj];
+        }
+        return;
+    }
+
+    __m128 scaled = _mm_mul_ps(value, _mm_set1_ps(1.0f / epilogue->output_params.scale));
+    scaled = _mm_min_ps(_mm_max_ps(scaled, _mm_set1_ps(-(float)QUANT_ACTIVATION_QMAX)), _mm_set1_ps((float)QUANT_ACTIVATION_QMAX));
+
+    __m128i q = _mm_add_epi32(_mm_cvtps_epi32(scaled), _mm_set1_epi32(epilogue->output_params.zero_point));
+    q = _mm_min_epi32(_mm_max_epi32(q, _mm_set1_epi32(QUANT_ACTIVATION_QMIN)), _mm_set1_epi32(QUANT_ACTIVATION_QMAX));
+
+    const __m128i q16 = _mm_packus_epi32(q, q);
+    const int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(q16, q16));
+
+    uint8_t *out = (uint8_t *)c + idx;
+    if (c_col_stride == 1)
+    {
+        memcpy(out, &packed, QGEMM_NR);
+        return;
+    }
+
+    uint8_t values[QGEMM_NR];
+    memcpy(values, &packed, QGEMM_NR);
+    for (size_t jj = 0; jj < QGEMM_NR; jj++)
+    {
+        out[jj * c_col_stride] = values[jj];
+    }
+}
+
+#else
+
+static void qgemm_tile(const uint8_t *const a, const size_t lda, const size_t m, const size_t i, const struct qgemm_weights *const w, const size_t j, int32_t acc[QGEMM_MR][QGEMM_NR])
+{
+    const size_t k = w->k;
+    const int8_t *b = w->data->data;
+
+    for (size_t ii = 0; ii < QGEMM_MR && i + ii < m; ii++)
+    {
+        for (size_t jj = 0; jj < QGEMM_NR && j + jj < w->n; jj++)
+        {
+            const uint8_t *a_row = a + (i + ii) * lda;
+            const int8_t *b_row = b + (j + jj) * w->k_padded;
+
+            int32_t sum = 0;
+            for (size_t p = 0; p < k; p++)
+            {
+                sum += (int32_t)a_row[p] * (int32_t)b_row[p];
+            }
+            acc[ii][jj] = sum;
+        }
+    }
+}
+
+static void qgemm_store_row(const int32_t acc[QGEMM_NR], const size_t i, const size_t j, const size_t n_cols, const struct qgemm_weights *const w, const struct qgemm_epilogue *const epilogue, void *const c, const size_t c_row_stride, const size_t c_col_stride)
+{
+    for (size_t jj = 0; jj < n_cols; jj++)
+    {
+        qgemm_store(acc[jj], i, j + jj, w, epilogue, c, c_row_stride, c_col_stride);
+    }
+}
+
+#endif
+
+static inline void qgemm_store(const int32_t acc, const size_t i, const size_t j, const struct qgemm_weights *const w, const struct qgemm_epilogue *const epilogue, void *const c, const size_t c_row_stride, const size_t c_col_stride)
+{
+    // sum_p (a_p - zero_point) * b_p = sum_p a_p * b_p - zero_point * sum_p b_p
+    const int32_t centered = acc - epilogue->input_params.zero_point * w->row_sums[j];
+
+    float value = (float)centered * (epilogue->input_params.scale * w->scales[j]);
+    if (epilogue->bias)
+    {
+        value += epilogue->bias[j];
+    }
+    if (epilogue->relu && value < 0)
+    {
+        value = 0;
+    }
+
+    const size_t idx = i * c_row_stride + j * c_col_stride;
+    if (!epilogue->requantize)
+    {
+        ((float *)c)[idx] = value;
+        return;
+    }
+
+    const float scaled = value * (1.0f / epilogue->output_params.scale);
+    long q = lrintf(scaled < -QUANT_ACTIVATION_QMAX ? -QUANT_ACTIVATION_QMAX : (scaled > QUANT_ACTIVATION_QMAX ? QUANT_ACTIVATION_QMAX : scaled));
+    q += epilogue->output_params.zero_point;
+    q = q < QUANT_ACTIVATION_QMIN ? QUANT_ACTIVATION_QMIN : q;
+    q = q > QUANT_ACTIVATION_QMAX ? QUANT_ACTIVATION_QMAX : q;
+
+    ((uint8_t *)c)[idx] = (uint8_t)q;
+}
+
+static inline double qgemm_weight_get(const struct tensor *const weight, const size_t idx)
+{
+    switch (weight->dtype)
+    {
+    case DTYPE_FLOAT64:
+        return ((const double *)weight->data)[idx];
+    case DTYPE_FLOAT32:
+        return ((const float *)weight->data)[idx];
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return half_to_f32(((const uint16_t *)weight->data)[idx], weight->dtype);
+    default:
+        return 0.0;
+    }
+}
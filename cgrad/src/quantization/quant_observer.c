@@ -0,0 +1,114 @@
+#include "cgrad/quantization/quant_observer.h"
+#include "cgrad/utils/half.h"
+#include <math.h>
+
+void quant_observer_init(struct quant_observer *const observer)
+{
+    observer->min = 0.0;
+    observer->max = 0.0;
+    observer->n_observed = 0;
+}
+
+cgrad_error quant_observer_update(struct quant_observer *const observer, const struct tensor *const t)
+{
+    if (!observer)
+    {
+        return QUANT_OBSERVER_NULL;
+    }
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+
+    double min = observer->min;
+    double max = observer->max;
+
+    switch (t->dtype)
+    {
+    case DTYPE_FLOAT32:
+    {
+        const float *data = t->data;
+        for (size_t i = 0; i < t->data_size; i++)
+        {
+            min = data[i] < min ? data[i] : min;
+            max = data[i] > max ? data[i] : max;
+        }
+        break;
+    }
+    case DTYPE_FLOAT64:
+    {
+        const double *data = t->data;
+        for (size_t i = 0; i < t->data_size; i++)
+        {
+            min = data[i] < min ? data[i] : min;
+            max = data[i] > max ? data[i] : max;
+        }
+        break;
+    }
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+    {
+        const uint16_t *data = t->data;
+        for (size_t i = 0; i < t->data_size; i++)
+        {
+            const float value = half_to_f32(data[i], t->dtype);
+            min = value < min ? value : min;
+            max = value > max ? value : max;
+        }
+        break;
+    }
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    observer->min = min;
+    observer->max = max;
+    observer->n_observed++;
+
+    return NO_ERROR;
+}
+
+cgrad_error quant_observer_compute_params(const struct quant_observer *const observer, struct quant_params *const params)
+{
+    if (!observer)
+    {
+        return QUANT_OBSERVER_NULL;
+    }
+    if (!params)
+    {
+        return QUANT_PARAMS_NULL;
+    }
+    if (observer->n_observed == 0)
+    {
+        return QUANT_OBSERVER_EMPTY;
+    }
+
+    // The observed range always contains 0, as min and max start from it
+    const double range = observer->max - observer->min;
+    const double levels = QUANT_ACTIVATION_QMAX - QUANT_ACTIVATION_QMIN;
+
+    if (!isfinite(range))
+    {
+        return QUANT_INVALID_PARAMS;
+    }
+    // Only zeros were observed, any scale represents them
+    if (range == 0)
+    {
+        params->scale = 1.0f;
+        params->zero_point = QUANT_ACTIVATION_QMIN;
+        return NO_ERROR;
+    }
+
+    params->scale = (float)(range / levels);
+
+    long zero_point = QUANT_ACTIVATION_QMIN + lround(-observer->min / params->scale);
+    zero_point = zero_point < QUANT_ACTIVATION_QMIN ? QUANT_ACTIVATION_QMIN : zero_point;
+    zero_point = zero_point > QUANT_ACTIVATION_QMAX ? QUANT_ACTIVATION_QMAX : zero_point;
+    params->zero_point = (int32_t)zero_point;
+
+    return NO_ERROR;
+}
@@ -0,0 +1,176 @@
+#include "cgrad/quantization/quantize.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+#include <immintrin.h>
+#endif
+
+static inline uint8_t quantize_value(const float x, const float inv_scale, const int32_t zero_point);
+static void quantize_f64_array(const double *const src, uint8_t *const dst, const size_t n, const struct quant_params *const params);
+
+cgrad_error tensor_quantize(const struct tensor *const t, const struct quant_params *const params, struct tensor **const out, struct cgrad_env *const env)
+{
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (!out)
+    {
+        return OUTPUT_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+
+    *out = tensor_allocator_no_grad_alloc(&env->tensor_alloc, t->shape, t->shape_size, DTYPE_UINT8);
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    cgrad_error err = tensor_quantize_into(t, params, *out);
+    if (err != NO_ERROR)
+    {
+        tensor_allocator_no_grad_free(&env->tensor_alloc, *out);
+        *out = NULL;
+    }
+
+    return err;
+}
+
+cgrad_error tensor_quantize_into(const struct tensor *const t, const struct quant_params *const params, struct tensor *const out)
+{
+    if (!t || !out)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->data || !out->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (out->dtype != DTYPE_UINT8)
+    {
+        return TENSOR_INVALID_DTYPE;
+    }
+    if (t->data_size != out->data_size)
+    {
+        return TENSOR_DATA_SIZE_MISMATCH;
+    }
+
+    cgrad_error err = quant_params_check(params);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    switch (t->dtype)
+    {
+    case DTYPE_FLOAT32:
+        quantize_f32_array(t->data, out->data, t->data_size, params);
+        return NO_ERROR;
+    case DTYPE_FLOAT64:
+        quantize_f64_array(t->data, out->data, t->data_size, params);
+        return NO_ERROR;
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+}
+
+cgrad_error tensor_dequantize(const struct tensor *const t, const struct quant_params *const params, struct tensor **const out, struct cgrad_env *const env)
+{
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (!out)
+    {
+        return OUTPUT_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (t->dtype != DTYPE_UINT8)
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    cgrad_error err = quant_params_check(params);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    *out = tensor_allocator_no_grad_alloc(&env->tensor_alloc, t->shape, t->shape_size, DTYPE_FLOAT32);
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    const uint8_t *t_data = t->data;
+    float *out_data = (*out)->data;
+    for (size_t i = 0; i < t->data_size; i++)
+    {
+        out_data[i] = params->scale * (float)((int32_t)t_data[i] - params->zero_point);
+    }
+
+    return NO_ERROR;
+}
+
+void quantize_f32_array(const float *const src, uint8_t *const dst, const size_t n, const struct quant_params *const params)
+{
+    const float inv_scale = 1.0f / params->scale;
+    size_t i = 0;
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    const __m256 inv_scale_vec = _mm256_set1_ps(inv_scale);
+    const __m256i zero_point_vec = _mm256_set1_epi32(params->zero_point);
+    const __m256i qmin = _mm256_set1_epi32(QUANT_ACTIVATION_QMIN);
+    const __m256i qmax = _mm256_set1_epi32(QUANT_ACTIVATION_QMAX);
+    const __m256 scaled_min = _mm256_set1_ps(-(float)QUANT_ACTIVATION_QMAX);
+    const __m256 scaled_max = _mm256_set1_ps((float)QUANT_ACTIVATION_QMAX);
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 scaled = _mm256_mul_ps(_mm256_loadu_ps(src + i), inv_scale_vec);
+        scaled = _mm256_min_ps(_mm256_max_ps(scaled, scaled_min), scaled_max);
+
+        // cvtps rounds to nearest even, as lrintf in quantize_value
+        __m256i q = _mm256_cvtps_epi32(scaled);
+        q = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(q, zero_point_vec), qmin), qmax);
+
+        const __m128i q16 = _mm_packus_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+        _mm_storel_epi64((__m128i *)(dst + i), _mm_packus_epi16(q16, q16));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        dst[i] = quantize_value(src[i], inv_scale, params->zero_point);
+    }
+}
+
+static void quantize_f64_array(const double *const src, uint8_t *const dst, const size_t n, const struct quant_params *const params)
+{
+    const float inv_scale = 1.0f / params->scale;
+    for (size_t i = 0; i < n; i++)
+    {
+        dst[i] = quantize_value((float)src[i], inv_scale, params->zero_point);
+    }
+}
+
+static inline uint8_t quantize_value(const float x, const float inv_scale, const int32_t zero_point)
+{
+    // Out of range values, including infinities, saturate
+    float q = x * inv_scale;
+    q = q < -(float)QUANT_ACTIVATION_QMAX ? -(float)QUANT_ACTIVATION_QMAX : q;
+    q = q > (float)QUANT_ACTIVATION_QMAX ? (float)QUANT_ACTIVATION_QMAX : q;
+
+    long value = lrintf(q) + zero_point;
+    value = value < QUANT_ACTIVATION_QMIN ? QUANT_ACTIVATION_QMIN : value;
+    value = value > QUANT_ACTIVATION_QMAX ? QUANT_ACTIVATION_QMAX : value;
+
+    return (uint8_t)value;
+}
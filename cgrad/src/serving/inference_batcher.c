@@ -0,0 +1,355 @@
+#include "cgrad/serving/inference_batcher.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void *inference_batcher_dispatch(void *arg);
+static cgrad_error inference_batcher_run(struct inference_batcher *const batcher, const size_t batch_size);
+static void inference_batcher_complete(struct inference_batcher *const batcher, const size_t batch_size, const cgrad_error err);
+static double inference_batcher_percentile(const double *const sorted, const size_t size, const double percentile);
+static int inference_batcher_compare_latencies(const void *a, const void *b);
+static uint64_t inference_batcher_now_ns();
+
+cgrad_error inference_batcher_init(struct inference_batcher *const batcher, const struct inference_batcher_config *const config, inference_batcher_forward_fn forward, void *model, struct cgrad_env *const env)
+{
+    if (!batcher)
+    {
+        return INFERENCE_BATCHER_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (!config || !forward || config->in_dim == 0 || config->out_dim == 0 || config->max_batch_size == 0 || config->queue_capacity == 0 || dtype_sizeof(config->dtype) == 0)
+    {
+        return INFERENCE_BATCHER_INVALID_CONFIG;
+    }
+
+    batcher->config = *config;
+    batcher->forward = forward;
+    batcher->model = model;
+    batcher->env = env;
+    batcher->running = true;
+    batcher->queue_head = 0;
+    batcher->queue_size = 0;
+    batcher->completed_requests = 0;
+    batcher->latencies_size = 0;
+    batcher->latencies_next = 0;
+
+    batcher->queue = malloc(config->queue_capacity * sizeof(struct inference_future *));
+    batcher->batch = malloc(config->max_batch_size * sizeof(struct inference_future *));
+    batcher->batch_size_histogram = calloc(config->max_batch_size + 1, sizeof(size_t));
+    if (!batcher->queue || !batcher->batch || !batcher->batch_size_histogram)
+    {
+        free(batcher->queue);
+        free(batcher->batch);
+        free(batcher->batch_size_histogram);
+        return INFERENCE_BATCHER_INIT_FAILED;
+    }
+
+    // Deadlines are computed on the monotonic clock, so the timed waits must use it too
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&batcher->mutex, NULL);
+    pthread_cond_init(&batcher->not_empty, &cond_attr);
+    pthread_cond_init(&batcher->completed, NULL);
+    pthread_condattr_destroy(&cond_attr);
+
+    if (pthread_create(&batcher->dispatcher, NULL, &inference_batcher_dispatch, batcher) != 0)
+    {
+        pthread_mutex_destroy(&batcher->mutex);
+        pthread_cond_destroy(&batcher->not_empty);
+        pthread_cond_destroy(&batcher->completed);
+        free(batcher->queue);
+        free(batcher->batch);
+        free(batcher->batch_size_histogram);
+        return INFERENCE_BATCHER_INIT_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
+void inference_batcher_cleanup(struct inference_batcher *const batcher)
+{
+    if (!batcher)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&batcher->mutex);
+    batcher->running = false;
+    pthread_cond_signal(&batcher->not_empty);
+    pthread_mutex_unlock(&batcher->mutex);
+
+    pthread_join(batcher->dispatcher, NULL);
+
+    pthread_mutex_destroy(&batcher->mutex);
+    pthread_cond_destroy(&batcher->not_empty);
+    pthread_cond_destroy(&batcher->completed);
+    free(batcher->queue);
+    free(batcher->batch);
+    free(batcher->batch_size_histogram);
+}
+
+cgrad_error inference_batcher_submit(struct inference_batcher *const batcher, struct inference_future *const future)
+{
+    if (!batcher)
+    {
+        return INFERENCE_BATCHER_NULL;
+    }
+    if (!future || !future->input || !future->output)
+    {
+        return INFERENCE_FUTURE_NULL;
+    }
+
+    future->done = false;
+    future->err = NO_ERROR;
+    future->submit_time_ns = inference_batcher_now_ns();
+
+    pthread_mutex_lock(&batcher->mutex);
+
+    if (!batcher->running)
+    {
+        pthread_mutex_unlock(&batcher->mutex);
+        return INFERENCE_BATCHER_STOPPED;
+    }
+    if (batcher->queue_size == batcher->config.queue_capacity)
+    {
+        pthread_mutex_unlock(&batcher->mutex);
+        return INFERENCE_BATCHER_QUEUE_FULL;
+    }
+
+    const size_t tail = (batcher->queue_head + batcher->queue_size) % batcher->config.queue_capacity;
+    batcher->queue[tail] = future;
+    batcher->queue_size++;
+
+    pthread_cond_signal(&batcher->not_empty);
+    pthread_mutex_unlock(&batcher->mutex);
+
+    return NO_ERROR;
+}
+
+cgrad_error inference_future_wait(struct inference_batcher *const batcher, struct inference_future *const future)
+{
+    if (!batcher)
+    {
+        return INFERENCE_BATCHER_NULL;
+    }
+    if (!future)
+    {
+        return INFERENCE_FUTURE_NULL;
+    }
+
+    pthread_mutex_lock(&batcher->mutex);
+    while (!future->done)
+    {
+        pthread_cond_wait(&batcher->completed, &batcher->mutex);
+    }
+    pthread_mutex_unlock(&batcher->mutex);
+
+    return future->err;
+}
+
+cgrad_error inference_batcher_get_stats(struct inference_batcher *const batcher, struct inference_batcher_stats *const stats, size_t *const batch_size_histogram)
+{
+    if (!batcher)
+    {
+        return INFERENCE_BATCHER_NULL;
+    }
+    if (!stats)
+    {
+        return OUTPUT_NULL;
+    }
+
+    double sorted[INFERENCE_BATCHER_LATENCY_WINDOW];
+
+    pthread_mutex_lock(&batcher->mutex);
+
+    const size_t max_batch_size = batcher->config.max_batch_size;
+    size_t completed_batches = 0;
+    for (size_t size = 1; size <= max_batch_size; size++)
+    {
+        completed_batches += batcher->batch_size_histogram[size];
+    }
+    if (batch_size_histogram)
+    {
+        memcpy(batch_size_histogram, batcher->batch_size_histogram, (max_batch_size + 1) * sizeof(size_t));
+    }
+
+    stats->queue_depth = batcher->queue_size;
+    stats->completed_requests = batcher->completed_requests;
+    stats->completed_batches = completed_batches;
+    stats->mean_batch_size = completed_batches > 0 ? (double)batcher->completed_requests / completed_batches : 0.0;
+
+    const size_t latencies_size = batcher->latencies_size;
+    memcpy(sorted, batcher->latencies_us, latencies_size * sizeof(double));
+
+    pthread_mutex_unlock(&batcher->mutex);
+
+    // Sorting is done outside the lock, not to stall the dispatcher
+    qsort(sorted, latencies_size, sizeof(double), &inference_batcher_compare_latencies);
+    stats->latency_p50_us = inference_batcher_percentile(sorted, latencies_size, 0.50);
+    stats->latency_p90_us = inference_batcher_percentile(sorted, latencies_size, 0.90);
+    stats->latency_p99_us = inference_batcher_percentile(sorted, latencies_size, 0.99);
+
+    return NO_ERROR;
+}
+
+static void *inference_batcher_dispatch(void *arg)
+{
+    struct inference_batcher *batcher = arg;
+    const size_t max_batch_size = batcher->config.max_batch_size;
+    const size_t capacity = batcher->config.queue_capacity;
+
+    pthread_mutex_lock(&batcher->mutex);
+    while (true)
+    {
+        while (batcher->queue_size == 0 && batcher->running)
+        {
+            pthread_cond_wait(&batcher->not_empty, &batcher->mutex);
+        }
+
+        // Once stopped, the queue is drained before exiting
+        if (batcher->queue_size == 0)
+        {
+            break;
+        }
+
+        // Wait for the batch to fill, at most until the deadline of the oldest request
+        const uint64_t deadline_ns = batcher->queue[batcher->queue_head]->submit_time_ns + batcher->config.max_delay_us * 1000;
+        const struct timespec deadline = {.tv_sec = deadline_ns / 1000000000, .tv_nsec = deadline_ns % 1000000000};
+        while (batcher->queue_size < max_batch_size && batcher->running)
+        {
+            if (pthread_cond_timedwait(&batcher->not_empty, &batcher->mutex, &deadline) == ETIMEDOUT)
+            {
+                break;
+            }
+        }
+
+        const size_t batch_size = batcher->queue_size < max_batch_size ? batcher->queue_size : max_batch_size;
+        for (size_t i = 0; i < batch_size; i++)
+        {
+            batcher->batch[i] = batcher->queue[batcher->queue_head];
+            batcher->queue_head = (batcher->queue_head + 1) % capacity;
+        }
+        batcher->queue_size -= batch_size;
+
+        // Submissions can proceed while the batch runs
+        pthread_mutex_unlock(&batcher->mutex);
+        const cgrad_error err = inference_batcher_run(batcher, batch_size);
+        pthread_mutex_lock(&batcher->mutex);
+
+        inference_batcher_complete(batcher, batch_size, err);
+        pthread_cond_broadcast(&batcher->completed);
+    }
+    pthread_mutex_unlock(&batcher->mutex);
+
+    return NULL;
+}
+
+static cgrad_error inference_batcher_run(struct inference_batcher *const batcher, const size_t batch_size)
+{
+    const struct inference_batcher_config *config = &batcher->config;
+    struct cgrad_env *env = batcher->env;
+    const size_t in_row_size = config->in_dim * dtype_sizeof(config->dtype);
+    const size_t out_row_size = config->out_dim * dtype_sizeof(config->dtype);
+
+    const size_t x_shape[] = {batch_size, config->in_dim};
+    struct tensor *x = tensor_no_grad_alloc(env, x_shape, 2, config->dtype);
+    if (!x)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    // Gather
+    for (size_t i = 0; i < batch_size; i++)
+    {
+        memcpy((char *)x->data + i * in_row_size, batcher->batch[i]->input, in_row_size);
+    }
+
+    struct tensor *out = NULL;
+    cgrad_error err = batcher->forward(batcher->model, x, &out, env);
+    if (err == NO_ERROR)
+    {
+        if (!out || out->dtype != config->dtype || out->shape_size != 2 || out->shape[0] != batch_size || out->shape[1] != config->out_dim)
+        {
+            err = INFERENCE_BATCHER_OUTPUT_MISMATCH;
+        }
+    }
+
+    // Scatter
+    if (err == NO_ERROR)
+    {
+        for (size_t i = 0; i < batch_size; i++)
+        {
+            memcpy(batcher->batch[i]->output, (const char *)out->data + i * out_row_size, out_row_size);
+        }
+    }
+
+    if (out)
+    {
+        tensor_free(env, out);
+    }
+    tensor_no_grad_free(env, x);
+    cgrad_env_free_intermediates(env);
+
+    return err;
+}
+
+static void inference_batcher_complete(struct inference_batcher *const batcher, const size_t batch_size, const cgrad_error err)
+{
+    const uint64_t now_ns = inference_batcher_now_ns();
+
+    for (size_t i = 0; i < batch_size; i++)
+    {
+        struct inference_future *future = batcher->batch[i];
+
+        batcher->latencies_us[batcher->latencies_next] = (now_ns - future->submit_time_ns) / 1000.0;
+        batcher->latencies_next = (batcher->latencies_next + 1) % INFERENCE_BATCHER_LATENCY_WINDOW;
+        if (batcher->latencies_size < INFERENCE_BATCHER_LATENCY_WINDOW)
+        {
+            batcher->latencies_size++;
+        }
+
+        future->err = err;
+        future->done = true;
+    }
+
+    batcher->batch_size_histogram[batch_size]++;
+    batcher->completed_requests += batch_size;
+}
+
+static double inference_batcher_percentile(const double *const sorted, const size_t size, const double percentile)
+{
+    if (size == 0)
+    {
+        return 0.0;
+    }
+
+    // Nearest rank
+    size_t rank = (size_t)ceil(percentile * size);
+    rank = rank == 0 ? 1 : rank;
+    rank = rank > size ? size : rank;
+
+    return sorted[rank - 1];
+}
+
+static int inference_batcher_compare_latencies(const void *a, const void *b)
+{
+    const double lhs = *(const double *)a;
+    const double rhs = *(const double *)b;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+static uint64_t inference_batcher_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,181 @@
+#include "cgrad/tensor/sparse_tensor.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include <stdint.h>
+
+static size_t sparse_tensor_count_nonzeros(const struct tensor *const dense);
+static void sparse_tensor_fill_from_dense(const struct tensor *const dense, struct sparse_tensor *const sparse);
+
+cgrad_error sparse_tensor_alloc(struct sparse_tensor *const sparse, const size_t rows, const size_t cols, const size_t nnz, const cgrad_dtype dtype, struct cgrad_env *const env)
+{
+    if (!sparse)
+    {
+        return SPARSE_TENSOR_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (dtype != DTYPE_FLOAT64 && dtype != DTYPE_FLOAT32)
+    {
+        return TENSOR_INVALID_DTYPE;
+    }
+    if (nnz > INT32_MAX || rows * cols < nnz)
+    {
+        return SPARSE_TENSOR_INVALID_INDEXES;
+    }
+
+    const size_t nnz_shape[] = {nnz};
+    const size_t row_ptrs_shape[] = {rows + 1};
+    sparse->values = tensor_no_grad_zero_alloc(env, nnz_shape, 1, dtype);
+    sparse->col_indexes = tensor_no_grad_zero_alloc(env, nnz_shape, 1, DTYPE_INT32);
+    sparse->row_ptrs = tensor_no_grad_zero_alloc(env, row_ptrs_shape, 1, DTYPE_INT32);
+    if (!sparse->values || !sparse->col_indexes || !sparse->row_ptrs)
+    {
+        sparse_tensor_free(sparse, env);
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    tensor_set_requires_grad(sparse->values, false);
+    tensor_set_requires_grad(sparse->col_indexes, false);
+    tensor_set_requires_grad(sparse->row_ptrs, false);
+    sparse->shape[0] = rows;
+    sparse->shape[1] = cols;
+    sparse->nnz = nnz;
+
+    return NO_ERROR;
+}
+
+cgrad_error sparse_tensor_from_dense(const struct tensor *const dense, struct sparse_tensor *const sparse, struct cgrad_env *const env)
+{
+    cgrad_error err = tensor_check_null(dense);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+    if (dense->shape_size != 2)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+
+    err = sparse_tensor_alloc(sparse, dense->shape[0], dense->shape[1], sparse_tensor_count_nonzeros(dense), dense->dtype, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    sparse_tensor_fill_from_dense(dense, sparse);
+
+    return NO_ERROR;
+}
+
+cgrad_error sparse_tensor_check(const struct sparse_tensor *const sparse)
+{
+    if (!sparse)
+    {
+        return SPARSE_TENSOR_NULL;
+    }
+    if (!sparse->values || !sparse->col_indexes || !sparse->row_ptrs)
+    {
+        return TENSOR_NULL;
+    }
+    if (sparse->values->data_size < sparse->nnz || sparse->col_indexes->data_size < sparse->nnz || sparse->row_ptrs->data_size != sparse->shape[0] + 1)
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+
+    const int32_t *row_ptrs = sparse->row_ptrs->data;
+    const int32_t *col_indexes = sparse->col_indexes->data;
+    if (row_ptrs[0] != 0 || (size_t)row_ptrs[sparse->shape[0]] != sparse->nnz)
+    {
+        return SPARSE_TENSOR_INVALID_INDEXES;
+    }
+    for (size_t i = 0; i < sparse->shape[0]; i++)
+    {
+        if (row_ptrs[i] > row_ptrs[i + 1])
+        {
+            return SPARSE_TENSOR_INVALID_INDEXES;
+        }
+    }
+    for (size_t k = 0; k < sparse->nnz; k++)
+    {
+        if (col_indexes[k] < 0 || (size_t)col_indexes[k] >= sparse->shape[1])
+        {
+            return SPARSE_TENSOR_INVALID_INDEXES;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+void sparse_tensor_free(struct sparse_tensor *const sparse, struct cgrad_env *const env)
+{
+    if (!sparse || !env)
+    {
+        return;
+    }
+
+    tensor_no_grad_free(env, sparse->values);
+    tensor_no_grad_free(env, sparse->col_indexes);
+    tensor_no_grad_free(env, sparse->row_ptrs);
+    sparse->values = NULL;
+    sparse->col_indexes = NULL;
+    sparse->row_ptrs = NULL;
+    sparse->nnz = 0;
+}
+
+static size_t sparse_tensor_count_nonzeros(const struct tensor *const dense)
+{
+    size_t nnz = 0;
+    for (size_t i = 0; i < dense->data_size; i++)
+    {
+        switch (dense->dtype)
+        {
+        case DTYPE_FLOAT64:
+            nnz += ((const double *)dense->data)[i] != 0.0;
+            break;
+        case DTYPE_FLOAT32:
+            nnz += ((const float *)dense->data)[i] != 0.0f;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return nnz;
+}
+
+static void sparse_tensor_fill_from_dense(const struct tensor *const dense, struct sparse_tensor *const sparse)
+{
+    int32_t *row_ptrs = sparse->row_ptrs->data;
+    int32_t *col_indexes = sparse->col_indexes->data;
+    const size_t cols = dense->shape[1];
+
+    size_t k = 0;
+    for (size_t i = 0; i < dense->shape[0]; i++)
+    {
+        row_ptrs[i] = (int32_t)k;
+        for (size_t j = 0; j < cols; j++)
+        {
+            if (dense->dtype == DTYPE_FLOAT64)
+            {
+                const double value = ((const double *)dense->data)[i * cols + j];
+                if (value != 0.0)
+                {
+                    ((double *)sparse->values->data)[k] = value;
+                    col_indexes[k++] = (int32_t)j;
+                }
+            }
+            else
+            {
+                const float value = ((const float *)dense->data)[i * cols + j];
+                if (value != 0.0f)
+                {
+                    ((float *)sparse->values->data)[k] = value;
+                    col_indexes[k++] = (int32_t)j;
+                }
+            }
+        }
+    }
+    row_ptrs[dense->shape[0]] = (int32_t)k;
+}
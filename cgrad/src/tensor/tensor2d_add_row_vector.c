@@ -5,6 +5,8 @@
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
 #include "cgrad/utils/simd_support.h"
+#include "cgrad/utils/half.h"
+#include <stdlib.h>
 
 #if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_0
 #include <immintrin.h>
@@ -18,8 +20,10 @@ typedef enum tensor2d_add_row_vector_operand
 
 static inline cgrad_error tensor2d_add_row_vector_update_graph(struct tensor *const t, struct tensor *const v, struct tensor **const out, struct cgrad_env *const env);
 static inline cgrad_error tensor2d_add_row_vector_dispatch(const struct tensor *const t, const struct tensor *const v, struct tensor *out);
+static cgrad_error tensor2d_add_row_vector_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
 static cgrad_error tensor2d_add_row_vector_backpropagate_tensor2d(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error tensor2d_add_row_vector_backpropagate_row_vector(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error tensor2d_add_row_vector_half(const struct tensor *const t, const struct tensor *const v, struct tensor *out);
 
 #if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
 static cgrad_error tensor2d_add_row_vector_dispatch_avx_256(const struct tensor *const t, const struct tensor *const v, struct tensor *out);
@@ -88,8 +92,18 @@ static inline cgrad_error tensor2d_add_row_vector_update_graph(struct tensor *co
     }
 
     err = add_computational_graph_link(v, ROW_VECTOR, *out, &tensor2d_add_row_vector_backpropagate_row_vector, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = computational_graph_node_set_forward_function((*out)->node, &tensor2d_add_row_vector_forward);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
 
-    return err;
+    return computational_graph_node_set_memory_hints((*out)->node, false, true);
 }
 
 cgrad_error tensor2d_add_row_vector_into(const struct tensor *const t, const struct tensor *const v, struct tensor *const out)
@@ -131,6 +145,11 @@ static inline cgrad_error tensor2d_add_row_vector_dispatch(const struct tensor *
 #endif
 }
 
+static cgrad_error tensor2d_add_row_vector_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return tensor2d_add_row_vector_dispatch(ctx->operands[TENSOR2D], ctx->operands[ROW_VECTOR], out);
+}
+
 static cgrad_error tensor2d_add_row_vector_backpropagate_tensor2d(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
 {
     cgrad_error err = tensor2d_copy(grad_wrt_out, grad_wrt_operand);
@@ -146,7 +165,7 @@ static cgrad_error tensor2d_add_row_vector_backpropagate_row_vector(const struct
 {
     // tensor_print_shape(grad_wrt_out);
     // tensor_print_shape(grad_wrt_operand);
-    cgrad_error err = tensor_sum(grad_wrt_out, 0, grad_wrt_operand);
+    cgrad_error err = tensor_sum_parallel(grad_wrt_out, 0, grad_wrt_operand, ctx->pool);
     if (err != NO_ERROR)
     {
         return err;
@@ -155,6 +174,43 @@ static cgrad_error tensor2d_add_row_vector_backpropagate_row_vector(const struct
     return NO_ERROR;
 }
 
+static cgrad_error tensor2d_add_row_vector_half(const struct tensor *const t, const struct tensor *const v, struct tensor *out)
+{
+    size_t rows = t->shape[0];
+    size_t cols = t->shape[1];
+
+    const uint16_t *t_data = (const uint16_t *)t->data;
+    const uint16_t *v_data = (const uint16_t *)v->data;
+    uint16_t *out_data = (uint16_t *)out->data;
+
+    float *v_f32 = malloc(2 * cols * sizeof(float));
+    if (!v_f32)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+    float *row_f32 = v_f32 + cols;
+
+    half_to_f32_array(v_data, v_f32, cols, v->dtype);
+
+    // Row by row, as out may be t itself
+    for (size_t i = 0; i < rows; i++)
+    {
+        size_t row_offset = i * cols;
+        half_to_f32_array(&t_data[row_offset], row_f32, cols, t->dtype);
+
+        for (size_t j = 0; j < cols; j++)
+        {
+            row_f32[j] += v_f32[j];
+        }
+
+        f32_to_half_array(row_f32, &out_data[row_offset], cols, out->dtype);
+    }
+
+    free(v_f32);
+
+    return NO_ERROR;
+}
+
 #if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
 static cgrad_error tensor2d_add_row_vector_dispatch_avx_256(const struct tensor *const t, const struct tensor *const v, struct tensor *out)
 {
@@ -164,6 +220,9 @@ static cgrad_error tensor2d_add_row_vector_dispatch_avx_256(const struct tensor
         return tensor2d_add_row_vector_avx_256_f64(t, v, out);
     case DTYPE_FLOAT32:
         return tensor2d_add_row_vector_avx_256_f32(t, v, out);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return tensor2d_add_row_vector_half(t, v, out);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
@@ -256,6 +315,9 @@ static cgrad_error tensor2d_add_row_vector_dispatch_scalar(const struct tensor *
         return tensor2d_add_row_vector_scalar_f64(t, v, out);
     case DTYPE_FLOAT32:
         return tensor2d_add_row_vector_scalar_f32(t, v, out);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return tensor2d_add_row_vector_half(t, v, out);
     default:
         return AUTOGRAD_BACKPROPAGATION_INVALID_TENSOR_DTYPE;
     }
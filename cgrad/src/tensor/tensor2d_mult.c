@@ -3,9 +3,10 @@
 #include "cgrad/tensor/tensor2d_mult_rhs_trans.h"
 #include "cgrad/tensor/tensor2d_mult_lhs_trans.h"
 #include "cgrad/tensor/tensor2d_trans.h"
+#include "cgrad/tensor/tensor_half.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
-#include <cblas.h>
+#include "cgrad/gemm/gemm.h"
 #include <stdlib.h>
 
 typedef enum tensor2d_mult_operand
@@ -15,9 +16,11 @@ typedef enum tensor2d_mult_operand
 } tensor2d_mult_operand;
 
 static inline cgrad_error tensor2d_mult_update_graph(struct tensor *const x, struct tensor *const y, struct tensor **const out, struct cgrad_env *const env);
-static inline cgrad_error tensor2d_mult_dispatch(const struct tensor *const x, const struct tensor *const y, struct tensor *const out);
-static cgrad_error tensor2d_mult_f64(const struct tensor *const x, const struct tensor *const y, struct tensor *const out);
-static cgrad_error tensor2d_mult_f32(const struct tensor *const x, const struct tensor *const y, struct tensor *const out);
+static inline cgrad_error tensor2d_mult_dispatch(const struct tensor *const x, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_f64(const struct tensor *const x, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_f32(const struct tensor *const x, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_half(const struct tensor *const x, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
 static cgrad_error tensor2d_mult_backpropagate_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error tensor2d_mult_backpropagate_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 
@@ -49,7 +52,7 @@ cgrad_error tensor2d_mult(struct tensor *const x, struct tensor *const y, struct
         return TENSOR_ALLOCATION_FAILED;
     }
 
-    cgrad_error err = tensor2d_mult_dispatch(x, y, *out);
+    cgrad_error err = tensor2d_mult_dispatch(x, y, *out, env->pool);
     if (err != NO_ERROR)
     {
         return err;
@@ -72,8 +75,12 @@ static inline cgrad_error tensor2d_mult_update_graph(struct tensor *const x, str
     }
 
     err = add_computational_graph_link(y, RHS_TENSOR, *out, &tensor2d_mult_backpropagate_rhs, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
 
-    return err;
+    return computational_graph_node_set_forward_function((*out)->node, &tensor2d_mult_forward);
 }
 
 cgrad_error tensor2d_mult_into(const struct tensor *const x, const struct tensor *const y, struct tensor *const out)
@@ -95,64 +102,85 @@ cgrad_error tensor2d_mult_into(const struct tensor *const x, const struct tensor
         return TENSOR_DTYPE_MISMATCH;
     }
 
-    return tensor2d_mult_dispatch(x, y, out);
+    return tensor2d_mult_dispatch(x, y, out, NULL);
 }
 
-static inline cgrad_error tensor2d_mult_dispatch(const struct tensor *const x, const struct tensor *const y, struct tensor *const out)
+static inline cgrad_error tensor2d_mult_dispatch(const struct tensor *const x, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool)
 {
     switch (x->dtype)
     {
     case DTYPE_FLOAT64:
-        return tensor2d_mult_f64(x, y, out);
+        return tensor2d_mult_f64(x, y, out, pool);
     case DTYPE_FLOAT32:
-        return tensor2d_mult_f32(x, y, out);
+        return tensor2d_mult_f32(x, y, out, pool);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return tensor2d_mult_half(x, y, out, pool);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
 }
 
-static cgrad_error tensor2d_mult_f64(const struct tensor *const x, const struct tensor *const y, struct tensor *const out)
+static cgrad_error tensor2d_mult_f64(const struct tensor *const x, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool)
 {
-    cblas_dgemm(
-        CblasRowMajor,
-        CblasNoTrans,
-        CblasNoTrans,
+    return gemm_f64(
+        GEMM_NO_TRANS,
+        GEMM_NO_TRANS,
         x->shape[0], // M
         y->shape[1], // N
         x->shape[1], // K (must match y->shape[0])
-        1.0,
         (double *)x->data,
         x->shape[1], // lda
-        y->data,
+        (double *)y->data,
         y->shape[1], // ldb
-        0.0,
         (double *)out->data,
-        out->shape[1] // ldc
-    );
-
-    return NO_ERROR;
+        out->shape[1], // ldc
+        pool);
 }
 
-static cgrad_error tensor2d_mult_f32(const struct tensor *const x, const struct tensor *const y, struct tensor *const out)
+static cgrad_error tensor2d_mult_f32(const struct tensor *const x, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool)
 {
-    cblas_sgemm(
-        CblasRowMajor,
-        CblasNoTrans,
-        CblasNoTrans,
+    return gemm_f32(
+        GEMM_NO_TRANS,
+        GEMM_NO_TRANS,
         x->shape[0], // M
         y->shape[1], // N
         x->shape[1], // K (must match y->shape[0])
-        1.0,
         (float *)x->data,
         x->shape[1], // lda
-        y->data,
+        (float *)y->data,
         y->shape[1], // ldb
-        0.0,
         (float *)out->data,
-        y->shape[1] // ldc
-    );
+        out->shape[1], // ldc
+        pool);
+}
 
-    return NO_ERROR;
+static cgrad_error tensor2d_mult_half(const struct tensor *const x, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool)
+{
+    // The product is computed by gemm_f32 on widened copies, so that accumulation happens in float32
+    struct tensor x_f32 = {0};
+    struct tensor y_f32 = {0};
+    struct tensor out_f32 = {0};
+
+    cgrad_error err = NO_ERROR;
+    if ((err = tensor_half_widen(x, &x_f32)) == NO_ERROR &&
+        (err = tensor_half_widen(y, &y_f32)) == NO_ERROR &&
+        (err = tensor_half_alloc_f32(out, &out_f32)) == NO_ERROR &&
+        (err = tensor2d_mult_f32(&x_f32, &y_f32, &out_f32, pool)) == NO_ERROR)
+    {
+        tensor_half_narrow(&out_f32, out);
+    }
+
+    tensor_half_release_f32(&x_f32);
+    tensor_half_release_f32(&y_f32);
+    tensor_half_release_f32(&out_f32);
+
+    return err;
+}
+
+static cgrad_error tensor2d_mult_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return tensor2d_mult_dispatch(ctx->operands[LHS_TENSOR], ctx->operands[RHS_TENSOR], out, ctx->pool);
 }
 
 static cgrad_error tensor2d_mult_backpropagate_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
@@ -167,7 +195,7 @@ static cgrad_error tensor2d_mult_backpropagate_lhs(const struct backpropagation_
      * If C = A*B, then
      * dz/dA = dz/dC * B^T, hence the trans
      */
-    return tensor2d_mult_rhs_trans_into(grad_wrt_out, rhs, grad_wrt_operand);
+    return tensor2d_mult_rhs_trans_into_parallel(grad_wrt_out, rhs, grad_wrt_operand, ctx->pool);
 }
 
 static cgrad_error tensor2d_mult_backpropagate_rhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
@@ -182,5 +210,5 @@ static cgrad_error tensor2d_mult_backpropagate_rhs(const struct backpropagation_
      * If C = A*B, then
      * dz/dB = A^T * dz/dC, hence the trans
      */
-    return tensor2d_mult_lhs_trans_into(lhs, grad_wrt_out, grad_wrt_operand);
+    return tensor2d_mult_lhs_trans_into_parallel(lhs, grad_wrt_out, grad_wrt_operand, ctx->pool);
 }
\ No newline at end of file
@@ -1,16 +1,24 @@
 #include "cgrad/tensor/tensor.h"
 #include "cgrad/tensor/tensor2d_mult.h"
 #include "cgrad/tensor/tensor2d_trans.h"
+#include "cgrad/tensor/tensor_half.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
-#include <cblas.h>
+#include "cgrad/tensor/tensor2d_mult_lhs_trans.h"
+#include "cgrad/gemm/gemm.h"
 #include <stdlib.h>
 
-static inline cgrad_error tensor2d_mult_lhs_trans_dispatch(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out);
-static cgrad_error tensor2d_mult_lhs_trans_f64(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out);
-static cgrad_error tensor2d_mult_lhs_trans_f32(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out);
+static inline cgrad_error tensor2d_mult_lhs_trans_dispatch(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_lhs_trans_f64(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_lhs_trans_f32(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_lhs_trans_half(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool);
 
 cgrad_error tensor2d_mult_lhs_trans_into(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out)
+{
+    return tensor2d_mult_lhs_trans_into_parallel(x_trans, y, out, NULL);
+}
+
+cgrad_error tensor2d_mult_lhs_trans_into_parallel(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool)
 {
     if (!x_trans || !y || !out)
     {
@@ -29,62 +37,77 @@ cgrad_error tensor2d_mult_lhs_trans_into(const struct tensor *const x_trans, con
         return TENSOR_DTYPE_MISMATCH;
     }
 
-    return tensor2d_mult_lhs_trans_dispatch(x_trans, y, out);
+    return tensor2d_mult_lhs_trans_dispatch(x_trans, y, out, pool);
 }
 
-static inline cgrad_error tensor2d_mult_lhs_trans_dispatch(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out)
+static inline cgrad_error tensor2d_mult_lhs_trans_dispatch(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool)
 {
     switch (x_trans->dtype)
     {
     case DTYPE_FLOAT64:
-        return tensor2d_mult_lhs_trans_f64(x_trans, y, out);
+        return tensor2d_mult_lhs_trans_f64(x_trans, y, out, pool);
     case DTYPE_FLOAT32:
-        return tensor2d_mult_lhs_trans_f32(x_trans, y, out);
+        return tensor2d_mult_lhs_trans_f32(x_trans, y, out, pool);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return tensor2d_mult_lhs_trans_half(x_trans, y, out, pool);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
 }
 
-static cgrad_error tensor2d_mult_lhs_trans_f64(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out)
+static cgrad_error tensor2d_mult_lhs_trans_f64(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool)
 {
-    cblas_dgemm(
-        CblasRowMajor,
-        CblasTrans,
-        CblasNoTrans,
-        x_trans->shape[1], 
+    return gemm_f64(
+        GEMM_TRANS,
+        GEMM_NO_TRANS,
+        x_trans->shape[1],
         y->shape[1],
-        x_trans->shape[0], 
-        1.0,
+        x_trans->shape[0],
         (double *)x_trans->data,
-        x_trans->shape[1], 
-        y->data,
-        y->shape[1], 
-        0.0,
+        x_trans->shape[1],
+        (double *)y->data,
+        y->shape[1],
         (double *)out->data,
-        out->shape[1]
-    );
-
-    return NO_ERROR;
+        out->shape[1],
+        pool);
 }
 
-static cgrad_error tensor2d_mult_lhs_trans_f32(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out)
+static cgrad_error tensor2d_mult_lhs_trans_f32(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool)
 {
-    cblas_sgemm(
-        CblasRowMajor,
-        CblasTrans,
-        CblasNoTrans,
-        x_trans->shape[1], 
+    return gemm_f32(
+        GEMM_TRANS,
+        GEMM_NO_TRANS,
+        x_trans->shape[1],
         y->shape[1],
-        x_trans->shape[0], 
-        1.0,
+        x_trans->shape[0],
         (float *)x_trans->data,
-        x_trans->shape[1], 
-        y->data,
-        y->shape[1], 
-        0.0,
+        x_trans->shape[1],
+        (float *)y->data,
+        y->shape[1],
         (float *)out->data,
-        out->shape[1]
-    );
+        out->shape[1],
+        pool);
+}
 
-    return NO_ERROR;
-}
\ No newline at end of file
+static cgrad_error tensor2d_mult_lhs_trans_half(const struct tensor *const x_trans, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool)
+{
+    struct tensor x_trans_f32 = {0};
+    struct tensor y_f32 = {0};
+    struct tensor out_f32 = {0};
+
+    cgrad_error err = NO_ERROR;
+    if ((err = tensor_half_widen(x_trans, &x_trans_f32)) == NO_ERROR &&
+        (err = tensor_half_widen(y, &y_f32)) == NO_ERROR &&
+        (err = tensor_half_alloc_f32(out, &out_f32)) == NO_ERROR &&
+        (err = tensor2d_mult_lhs_trans_f32(&x_trans_f32, &y_f32, &out_f32, pool)) == NO_ERROR)
+    {
+        tensor_half_narrow(&out_f32, out);
+    }
+
+    tensor_half_release_f32(&x_trans_f32);
+    tensor_half_release_f32(&y_f32);
+    tensor_half_release_f32(&out_f32);
+
+    return err;
+}
@@ -0,0 +1,191 @@
+#include "cgrad/tensor/tensor2d_mult_packed.h"
+#include "cgrad/autograd/backpropagation/backpropagation_context.h"
+#include "cgrad/autograd/computational_graph/computational_graph.h"
+#include "cgrad/autograd/computational_graph/computational_graph_link.h"
+
+typedef enum tensor2d_mult_packed_operand
+{
+    LHS_TENSOR,
+    WEIGHT_TENSOR,
+} tensor2d_mult_packed_operand;
+
+typedef enum tensor2d_mult_packed_operand_size_t
+{
+    TRANS_WEIGHT,
+} tensor2d_mult_packed_operand_size_t;
+
+static inline cgrad_error tensor2d_mult_packed_update_graph(struct tensor *const x, struct tensor *const weight, const gemm_transpose trans_weight, struct tensor **const out, struct cgrad_env *const env);
+static cgrad_error tensor2d_mult_packed_dispatch(const struct tensor *const x, const struct tensor *const weight, const gemm_transpose trans_weight, const struct gemm_packed_b *const packed, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_packed_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
+static cgrad_error tensor2d_mult_packed_backpropagate_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error tensor2d_mult_packed_backpropagate_weight(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+
+cgrad_error tensor2d_mult_packed(struct tensor *const x, struct tensor *const weight, const gemm_transpose trans_weight, const struct gemm_packed_b *const packed, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
+{
+    if (!x || !weight)
+    {
+        return TENSOR_NULL;
+    }
+    if (!x->data || !weight->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (x->dtype != weight->dtype)
+    {
+        return TENSOR_DTYPE_MISMATCH;
+    }
+    if (x->dtype != DTYPE_FLOAT64 && x->dtype != DTYPE_FLOAT32)
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    const size_t rows = weight->shape[0];
+    const size_t cols = weight->data_size / rows;
+    const size_t k = trans_weight == GEMM_NO_TRANS ? rows : cols;
+    const size_t n = trans_weight == GEMM_NO_TRANS ? cols : rows;
+    if (x->shape_size != 2 || x->shape[1] != k)
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+    if (packed && (packed->k != k || packed->n != n))
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+
+    const size_t shape[] = {x->shape[0], n};
+    const size_t shape_size = 2;
+    (*out) = tensor_allocator_alloc(&env->tensor_alloc, shape, shape_size, x->dtype);
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    cgrad_error err = tensor2d_mult_packed_dispatch(x, weight, trans_weight, packed, *out, env->pool);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if (track_grad)
+    {
+        return tensor2d_mult_packed_update_graph(x, weight, trans_weight, out, env);
+    }
+
+    return NO_ERROR;
+}
+
+static inline cgrad_error tensor2d_mult_packed_update_graph(struct tensor *const x, struct tensor *const weight, const gemm_transpose trans_weight, struct tensor **const out, struct cgrad_env *const env)
+{
+    cgrad_error err = add_computational_graph_link(x, LHS_TENSOR, *out, &tensor2d_mult_packed_backpropagate_lhs, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = add_computational_graph_link(weight, WEIGHT_TENSOR, *out, &tensor2d_mult_packed_backpropagate_weight, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = context_set_operand_size_t(&(*out)->node->ctx, trans_weight, TRANS_WEIGHT);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_forward_function((*out)->node, &tensor2d_mult_packed_forward);
+}
+
+static cgrad_error tensor2d_mult_packed_dispatch(const struct tensor *const x, const struct tensor *const weight, const gemm_transpose trans_weight, const struct gemm_packed_b *const packed, struct tensor *const out, struct thread_pool *const pool)
+{
+    const size_t m = x->shape[0];
+    const size_t k = x->shape[1];
+    const size_t n = out->shape[1];
+    const size_t ldw = weight->data_size / weight->shape[0];
+
+    switch (x->dtype)
+    {
+    case DTYPE_FLOAT64:
+        if (packed)
+        {
+            return gemm_packed_f64(GEMM_NO_TRANS, m, x->data, k, packed, out->data, n, pool);
+        }
+        return gemm_f64(GEMM_NO_TRANS, trans_weight, m, n, k, x->data, k, weight->data, ldw, out->data, n, pool);
+    case DTYPE_FLOAT32:
+        if (packed)
+        {
+            return gemm_packed_f32(GEMM_NO_TRANS, m, x->data, k, packed, out->data, n, pool);
+        }
+        return gemm_f32(GEMM_NO_TRANS, trans_weight, m, n, k, x->data, k, weight->data, ldw, out->data, n, pool);
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+}
+
+static cgrad_error tensor2d_mult_packed_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    // Replays run after the weight may have been updated, so it is packed again by the product
+    const gemm_transpose trans_weight = (gemm_transpose)ctx->operands_size_t[TRANS_WEIGHT];
+    return tensor2d_mult_packed_dispatch(ctx->operands[LHS_TENSOR], ctx->operands[WEIGHT_TENSOR], trans_weight, NULL, out, ctx->pool);
+}
+
+static cgrad_error tensor2d_mult_packed_backpropagate_lhs(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    const struct tensor *weight = ctx->operands[WEIGHT_TENSOR];
+    if (!weight)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
+    }
+
+    /**
+     * If C = A op(W), then
+     * dz/dA = dz/dC * op(W)^T, where op(W)^T is W itself when the weight is transposed
+     */
+    const gemm_transpose trans_weight = (gemm_transpose)ctx->operands_size_t[TRANS_WEIGHT];
+    const gemm_transpose trans_b = trans_weight == GEMM_NO_TRANS ? GEMM_TRANS : GEMM_NO_TRANS;
+    const size_t m = grad_wrt_operand->shape[0];
+    const size_t k = grad_wrt_operand->shape[1];
+    const size_t n = grad_wrt_out->shape[1];
+    const size_t ldw = weight->data_size / weight->shape[0];
+
+    switch (weight->dtype)
+    {
+    case DTYPE_FLOAT64:
+        return gemm_f64(GEMM_NO_TRANS, trans_b, m, k, n, grad_wrt_out->data, n, weight->data, ldw, grad_wrt_operand->data, k, ctx->pool);
+    case DTYPE_FLOAT32:
+        return gemm_f32(GEMM_NO_TRANS, trans_b, m, k, n, grad_wrt_out->data, n, weight->data, ldw, grad_wrt_operand->data, k, ctx->pool);
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+}
+
+static cgrad_error tensor2d_mult_packed_backpropagate_weight(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    const struct tensor *x = ctx->operands[LHS_TENSOR];
+    if (!x)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
+    }
+
+    /**
+     * If C = A W, then dz/dW = A^T * dz/dC.
+     * If C = A W^T, then dz/dW = (dz/dC)^T * A.
+     */
+    const gemm_transpose trans_weight = (gemm_transpose)ctx->operands_size_t[TRANS_WEIGHT];
+    const struct tensor *a = trans_weight == GEMM_NO_TRANS ? x : grad_wrt_out;
+    const struct tensor *b = trans_weight == GEMM_NO_TRANS ? grad_wrt_out : x;
+    const size_t rows = grad_wrt_operand->shape[0];
+    const size_t cols = grad_wrt_operand->data_size / rows;
+    const size_t batch_size = x->shape[0];
+
+    switch (x->dtype)
+    {
+    case DTYPE_FLOAT64:
+        return gemm_f64(GEMM_TRANS, GEMM_NO_TRANS, rows, cols, batch_size, a->data, a->shape[1], b->data, b->shape[1], grad_wrt_operand->data, cols, ctx->pool);
+    case DTYPE_FLOAT32:
+        return gemm_f32(GEMM_TRANS, GEMM_NO_TRANS, rows, cols, batch_size, a->data, a->shape[1], b->data, b->shape[1], grad_wrt_operand->data, cols, ctx->pool);
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+}
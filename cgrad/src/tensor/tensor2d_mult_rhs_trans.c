@@ -1,16 +1,24 @@
 #include "cgrad/tensor/tensor.h"
 #include "cgrad/tensor/tensor2d_mult.h"
 #include "cgrad/tensor/tensor2d_trans.h"
+#include "cgrad/tensor/tensor_half.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
-#include <cblas.h>
+#include "cgrad/tensor/tensor2d_mult_rhs_trans.h"
+#include "cgrad/gemm/gemm.h"
 #include <stdlib.h>
 
-static inline cgrad_error tensor2d_mult_rhs_trans_dispatch(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out);
-static cgrad_error tensor2d_mult_rhs_trans_f64(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out);
-static cgrad_error tensor2d_mult_rhs_trans_f32(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out);
+static inline cgrad_error tensor2d_mult_rhs_trans_dispatch(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_rhs_trans_f64(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_rhs_trans_f32(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_mult_rhs_trans_half(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, struct thread_pool *const pool);
 
 cgrad_error tensor2d_mult_rhs_trans_into(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out)
+{
+    return tensor2d_mult_rhs_trans_into_parallel(x, y_trans, out, NULL);
+}
+
+cgrad_error tensor2d_mult_rhs_trans_into_parallel(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, struct thread_pool *const pool)
 {
     if (!x || !y_trans || !out)
     {
@@ -29,62 +37,77 @@ cgrad_error tensor2d_mult_rhs_trans_into(const struct tensor *const x, const str
         return TENSOR_DTYPE_MISMATCH;
     }
 
-    return tensor2d_mult_rhs_trans_dispatch(x, y_trans, out);
+    return tensor2d_mult_rhs_trans_dispatch(x, y_trans, out, pool);
 }
 
-static inline cgrad_error tensor2d_mult_rhs_trans_dispatch(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out)
+static inline cgrad_error tensor2d_mult_rhs_trans_dispatch(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, struct thread_pool *const pool)
 {
     switch (x->dtype)
     {
     case DTYPE_FLOAT64:
-        return tensor2d_mult_rhs_trans_f64(x, y_trans, out);
+        return tensor2d_mult_rhs_trans_f64(x, y_trans, out, pool);
     case DTYPE_FLOAT32:
-        return tensor2d_mult_rhs_trans_f32(x, y_trans, out);
+        return tensor2d_mult_rhs_trans_f32(x, y_trans, out, pool);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return tensor2d_mult_rhs_trans_half(x, y_trans, out, pool);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
 }
 
-static cgrad_error tensor2d_mult_rhs_trans_f64(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out)
+static cgrad_error tensor2d_mult_rhs_trans_f64(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, struct thread_pool *const pool)
 {
-    cblas_dgemm(
-        CblasRowMajor,
-        CblasNoTrans,
-        CblasTrans,
-        x->shape[0], 
-        y_trans->shape[0], 
-        x->shape[1], 
-        1.0,
+    return gemm_f64(
+        GEMM_NO_TRANS,
+        GEMM_TRANS,
+        out->shape[0],
+        out->shape[1],
+        x->shape[1],
         (double *)x->data,
-        x->shape[1], 
-        y_trans->data,
-        y_trans->shape[0], 
-        0.0,
+        x->shape[1],
+        (double *)y_trans->data,
+        y_trans->shape[1],
         (double *)out->data,
-        out->shape[1]
-    );
-
-    return NO_ERROR;
+        out->shape[1],
+        pool);
 }
 
-static cgrad_error tensor2d_mult_rhs_trans_f32(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out)
+static cgrad_error tensor2d_mult_rhs_trans_f32(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, struct thread_pool *const pool)
 {
-    cblas_sgemm(
-        CblasRowMajor,
-        CblasNoTrans,
-        CblasTrans,
+    return gemm_f32(
+        GEMM_NO_TRANS,
+        GEMM_TRANS,
         out->shape[0],
         out->shape[1],
         x->shape[1],
-        1.0,
         (float *)x->data,
         x->shape[1],
-        y_trans->data,
+        (float *)y_trans->data,
         y_trans->shape[1],
-        0.0,
         (float *)out->data,
-        out->shape[1]
-    );
+        out->shape[1],
+        pool);
+}
 
-    return NO_ERROR;
-}
\ No newline at end of file
+static cgrad_error tensor2d_mult_rhs_trans_half(const struct tensor *const x, const struct tensor *const y_trans, struct tensor *const out, struct thread_pool *const pool)
+{
+    struct tensor x_f32 = {0};
+    struct tensor y_trans_f32 = {0};
+    struct tensor out_f32 = {0};
+
+    cgrad_error err = NO_ERROR;
+    if ((err = tensor_half_widen(x, &x_f32)) == NO_ERROR &&
+        (err = tensor_half_widen(y_trans, &y_trans_f32)) == NO_ERROR &&
+        (err = tensor_half_alloc_f32(out, &out_f32)) == NO_ERROR &&
+        (err = tensor2d_mult_rhs_trans_f32(&x_f32, &y_trans_f32, &out_f32, pool)) == NO_ERROR)
+    {
+        tensor_half_narrow(&out_f32, out);
+    }
+
+    tensor_half_release_f32(&x_f32);
+    tensor_half_release_f32(&y_trans_f32);
+    tensor_half_release_f32(&out_f32);
+
+    return err;
+}
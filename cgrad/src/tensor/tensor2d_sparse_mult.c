@@ -0,0 +1,276 @@
+#include "cgrad/tensor/tensor2d_sparse_mult.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include "cgrad/autograd/computational_graph/computational_graph.h"
+#include "cgrad/autograd/computational_graph/computational_graph_link.h"
+#include "cgrad/parallel/thread_pool.h"
+#include <stdint.h>
+#include <string.h>
+
+typedef enum tensor2d_sparse_mult_operand
+{
+    DENSE_TENSOR,
+    SPARSE_VALUES,
+    SPARSE_COL_INDEXES,
+    SPARSE_ROW_PTRS,
+} tensor2d_sparse_mult_operand;
+
+struct tensor2d_sparse_mult_args
+{
+    const struct tensor *values;
+    const int32_t *col_indexes;
+    const int32_t *row_ptrs;
+    size_t rows;
+    const struct tensor *dense;     /**< y in the forward pass, the gradient of the result in the backward pass. */
+    struct tensor *out;
+};
+
+static inline cgrad_error tensor2d_sparse_mult_update_graph(const struct sparse_tensor *const x, struct tensor *const y, struct tensor **const out, struct cgrad_env *const env);
+static cgrad_error tensor2d_sparse_mult_dispatch(const struct tensor *const values, const struct tensor *const col_indexes, const struct tensor *const row_ptrs, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool);
+static void tensor2d_sparse_mult_rows_f64(void *arg, const size_t begin, const size_t end);
+static void tensor2d_sparse_mult_rows_f32(void *arg, const size_t begin, const size_t end);
+static void tensor2d_sparse_mult_lhs_trans_cols_f64(void *arg, const size_t begin, const size_t end);
+static void tensor2d_sparse_mult_lhs_trans_cols_f32(void *arg, const size_t begin, const size_t end);
+static cgrad_error tensor2d_sparse_mult_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
+static cgrad_error tensor2d_sparse_mult_backpropagate_dense(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+
+cgrad_error tensor2d_sparse_mult(const struct sparse_tensor *const x, struct tensor *const y, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
+{
+    cgrad_error err = sparse_tensor_check(x);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = tensor_check_null(y)) != NO_ERROR)
+    {
+        return err;
+    }
+    if (!out)
+    {
+        return OUTPUT_NULL;
+    }
+    if (x->shape[1] != y->shape[0])
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+    if (x->values->dtype != y->dtype)
+    {
+        return TENSOR_DTYPE_MISMATCH;
+    }
+
+    const size_t shape[] = {x->shape[0], y->shape[1]};
+    const size_t shape_size = 2;
+    (*out) = tensor_allocator_alloc(&env->tensor_alloc, shape, shape_size, y->dtype);
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    err = tensor2d_sparse_mult_dispatch(x->values, x->col_indexes, x->row_ptrs, y, *out, env->pool);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if (track_grad)
+    {
+        return tensor2d_sparse_mult_update_graph(x, y, out, env);
+    }
+
+    return NO_ERROR;
+}
+
+static inline cgrad_error tensor2d_sparse_mult_update_graph(const struct sparse_tensor *const x, struct tensor *const y, struct tensor **const out, struct cgrad_env *const env)
+{
+    cgrad_error err = add_computational_graph_link(y, DENSE_TENSOR, *out, &tensor2d_sparse_mult_backpropagate_dense, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // The sparse tensor is not differentiable, so its arrays are only set as operands for backward
+    if ((err = computational_graph_node_set_context_tensor((*out)->node, x->values, SPARSE_VALUES)) != NO_ERROR ||
+        (err = computational_graph_node_set_context_tensor((*out)->node, x->col_indexes, SPARSE_COL_INDEXES)) != NO_ERROR ||
+        (err = computational_graph_node_set_context_tensor((*out)->node, x->row_ptrs, SPARSE_ROW_PTRS)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_forward_function((*out)->node, &tensor2d_sparse_mult_forward);
+}
+
+static cgrad_error tensor2d_sparse_mult_dispatch(const struct tensor *const values, const struct tensor *const col_indexes, const struct tensor *const row_ptrs, const struct tensor *const y, struct tensor *const out, struct thread_pool *const pool)
+{
+    const size_t rows = out->shape[0];
+    struct tensor2d_sparse_mult_args args = {
+        .values = values,
+        .col_indexes = col_indexes->data,
+        .row_ptrs = row_ptrs->data,
+        .rows = rows,
+        .dense = y,
+        .out = out,
+    };
+
+    // Each row costs its number of values times the columns of y
+    const size_t work_per_row = (values->data_size / (rows ? rows : 1) + 1) * y->shape[1];
+    switch (y->dtype)
+    {
+    case DTYPE_FLOAT64:
+        thread_pool_parallel_for(pool, rows, thread_pool_grain(work_per_row), &tensor2d_sparse_mult_rows_f64, &args);
+        return NO_ERROR;
+    case DTYPE_FLOAT32:
+        thread_pool_parallel_for(pool, rows, thread_pool_grain(work_per_row), &tensor2d_sparse_mult_rows_f32, &args);
+        return NO_ERROR;
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+}
+
+static void tensor2d_sparse_mult_rows_f64(void *arg, const size_t begin, const size_t end)
+{
+    const struct tensor2d_sparse_mult_args *args = arg;
+    const double *values = args->values->data;
+    const double *y = args->dense->data;
+    const size_t n = args->out->shape[1];
+
+    for (size_t i = begin; i < end; i++)
+    {
+        double *restrict out_row = (double *)args->out->data + i * n;
+        memset(out_row, 0, n * sizeof(double));
+        for (int32_t k = args->row_ptrs[i]; k < args->row_ptrs[i + 1]; k++)
+        {
+            const double value = values[k];
+            const double *restrict y_row = y + (size_t)args->col_indexes[k] * n;
+            for (size_t j = 0; j < n; j++)
+            {
+                out_row[j] += value * y_row[j];
+            }
+        }
+    }
+}
+
+static void tensor2d_sparse_mult_rows_f32(void *arg, const size_t begin, const size_t end)
+{
+    const struct tensor2d_sparse_mult_args *args = arg;
+    const float *values = args->values->data;
+    const float *y = args->dense->data;
+    const size_t n = args->out->shape[1];
+
+    for (size_t i = begin; i < end; i++)
+    {
+        float *restrict out_row = (float *)args->out->data + i * n;
+        memset(out_row, 0, n * sizeof(float));
+        for (int32_t k = args->row_ptrs[i]; k < args->row_ptrs[i + 1]; k++)
+        {
+            const float value = values[k];
+            const float *restrict y_row = y + (size_t)args->col_indexes[k] * n;
+            for (size_t j = 0; j < n; j++)
+            {
+                out_row[j] += value * y_row[j];
+            }
+        }
+    }
+}
+
+/**
+ * Rows of x^T * g are scattered into by several rows of x, so the work is split by columns instead, each task
+ * visiting all the values of x for its range of columns.
+ */
+static void tensor2d_sparse_mult_lhs_trans_cols_f64(void *arg, const size_t begin, const size_t end)
+{
+    const struct tensor2d_sparse_mult_args *args = arg;
+    const double *values = args->values->data;
+    const double *g = args->dense->data;
+    double *out = args->out->data;
+    const size_t n = args->out->shape[1];
+
+    for (size_t r = 0; r < args->out->shape[0]; r++)
+    {
+        memset(out + r * n + begin, 0, (end - begin) * sizeof(double));
+    }
+    for (size_t i = 0; i < args->rows; i++)
+    {
+        const double *restrict g_row = g + i * n;
+        for (int32_t k = args->row_ptrs[i]; k < args->row_ptrs[i + 1]; k++)
+        {
+            const double value = values[k];
+            double *restrict out_row = out + (size_t)args->col_indexes[k] * n;
+            for (size_t j = begin; j < end; j++)
+            {
+                out_row[j] += value * g_row[j];
+            }
+        }
+    }
+}
+
+static void tensor2d_sparse_mult_lhs_trans_cols_f32(void *arg, const size_t begin, const size_t end)
+{
+    const struct tensor2d_sparse_mult_args *args = arg;
+    const float *values = args->values->data;
+    const float *g = args->dense->data;
+    float *out = args->out->data;
+    const size_t n = args->out->shape[1];
+
+    for (size_t r = 0; r < args->out->shape[0]; r++)
+    {
+        memset(out + r * n + begin, 0, (end - begin) * sizeof(float));
+    }
+    for (size_t i = 0; i < args->rows; i++)
+    {
+        const float *restrict g_row = g + i * n;
+        for (int32_t k = args->row_ptrs[i]; k < args->row_ptrs[i + 1]; k++)
+        {
+            const float value = values[k];
+            float *restrict out_row = out + (size_t)args->col_indexes[k] * n;
+            for (size_t j = begin; j < end; j++)
+            {
+                out_row[j] += value * g_row[j];
+            }
+        }
+    }
+}
+
+static cgrad_error tensor2d_sparse_mult_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return tensor2d_sparse_mult_dispatch(ctx->operands[SPARSE_VALUES], ctx->operands[SPARSE_COL_INDEXES], ctx->operands[SPARSE_ROW_PTRS], ctx->operands[DENSE_TENSOR], out, ctx->pool);
+}
+
+static cgrad_error tensor2d_sparse_mult_backpropagate_dense(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    const struct tensor *values = ctx->operands[SPARSE_VALUES];
+    const struct tensor *col_indexes = ctx->operands[SPARSE_COL_INDEXES];
+    const struct tensor *row_ptrs = ctx->operands[SPARSE_ROW_PTRS];
+    if (!values || !col_indexes || !row_ptrs)
+    {
+        return AUTOGRAD_BACKPROPAGATION_CONTEXT_OPERAND_NULL;
+    }
+    if (grad_wrt_out->dtype != grad_wrt_operand->dtype)
+    {
+        return AUTOGRAD_BACKPROPAGATION_INVALID_TENSOR_DTYPE;
+    }
+
+    /**
+     * If C = A*B, then
+     * dz/dB = A^T * dz/dC, whose rows are nonzero only for the columns of A holding values
+     */
+    struct tensor2d_sparse_mult_args args = {
+        .values = values,
+        .col_indexes = col_indexes->data,
+        .row_ptrs = row_ptrs->data,
+        .rows = grad_wrt_out->shape[0],
+        .dense = grad_wrt_out,
+        .out = grad_wrt_operand,
+    };
+
+    const size_t work_per_col = values->data_size + grad_wrt_operand->shape[0];
+    switch (grad_wrt_operand->dtype)
+    {
+    case DTYPE_FLOAT64:
+        thread_pool_parallel_for(ctx->pool, grad_wrt_operand->shape[1], thread_pool_grain(work_per_col), &tensor2d_sparse_mult_lhs_trans_cols_f64, &args);
+        return NO_ERROR;
+    case DTYPE_FLOAT32:
+        thread_pool_parallel_for(ctx->pool, grad_wrt_operand->shape[1], thread_pool_grain(work_per_col), &tensor2d_sparse_mult_lhs_trans_cols_f32, &args);
+        return NO_ERROR;
+    default:
+        return AUTOGRAD_BACKPROPAGATION_INVALID_TENSOR_DTYPE;
+    }
+}
@@ -1,4 +1,5 @@
 #include "cgrad/tensor/tensor2d_trans.h"
+#include "cgrad/tensor/tensor_permute.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
 
@@ -8,9 +9,8 @@ typedef enum tensor2d_trans_operand
 } tensor2d_trans_operand;
 
 static inline cgrad_error tensor2d_trans_update_graph(struct tensor *const t, struct tensor **const out, struct cgrad_env *const env);
-static cgrad_error tensor2d_trans_dispatch(const struct tensor *const t, struct tensor *const out);
-static cgrad_error tensor2d_trans_f64(const struct tensor *const t, struct tensor *const out);
-static cgrad_error tensor2d_trans_f32(const struct tensor *const t, struct tensor *const out);
+static cgrad_error tensor2d_trans_dispatch(const struct tensor *const t, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor2d_trans_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
 static cgrad_error tensor2d_trans_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 
 cgrad_error tensor2d_trans(struct tensor *const t, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
@@ -36,7 +36,7 @@ cgrad_error tensor2d_trans(struct tensor *const t, struct tensor **const out, co
         return TENSOR_ALLOCATION_FAILED;
     }
 
-    cgrad_error err = tensor2d_trans_dispatch(t, *out);
+    cgrad_error err = tensor2d_trans_dispatch(t, *out, env->pool);
     if (err != NO_ERROR)
     {
         return err;
@@ -52,7 +52,19 @@ cgrad_error tensor2d_trans(struct tensor *const t, struct tensor **const out, co
 
 static inline cgrad_error tensor2d_trans_update_graph(struct tensor *const t, struct tensor **const out, struct cgrad_env *env)
 {
-    return add_computational_graph_link(t, TENSOR2D_TRANS_ONLY_OPERAND, *out, &tensor2d_trans_backpropagate, env);
+    cgrad_error err = add_computational_graph_link(t, TENSOR2D_TRANS_ONLY_OPERAND, *out, &tensor2d_trans_backpropagate, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = computational_graph_node_set_forward_function((*out)->node, &tensor2d_trans_forward);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_memory_hints((*out)->node, false, false);
 }
 
 cgrad_error tensor2d_trans_into(const struct tensor *const t, struct tensor *const out)
@@ -76,64 +88,22 @@ cgrad_error tensor2d_trans_into(const struct tensor *const t, struct tensor *con
         return TENSOR_SHAPE_MISMATCH;
     }
 
-    return tensor2d_trans_dispatch(t, out);
+    return tensor2d_trans_dispatch(t, out, NULL);
 }
 
-static cgrad_error tensor2d_trans_dispatch(const struct tensor *const t, struct tensor *const out)
+static cgrad_error tensor2d_trans_dispatch(const struct tensor *const t, struct tensor *const out, struct thread_pool *const pool)
 {
-    switch (t->dtype)
-    {
-    case DTYPE_FLOAT64:
-        return tensor2d_trans_f64(t, out);
-    case DTYPE_FLOAT32:
-        return tensor2d_trans_f32(t, out);
-    default:
-        return OPERATION_INVALID_TENSOR_DTYPE;
-    }
+    const size_t perm[] = {1, 0};
+    return tensor_permute_into(t, perm, out, pool);
 }
 
-static cgrad_error tensor2d_trans_f64(const struct tensor *const t, struct tensor *const out)
+static cgrad_error tensor2d_trans_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
 {
-    size_t rows = t->shape[0];
-    size_t cols = t->shape[1];
-
-    double *restrict out_data = (double *)out->data;
-    double *restrict t_data = (double *)t->data;
-
-    // Transpose
-    for (size_t i = 0; i < rows; i++)
-    {
-        for (size_t j = 0; j < cols; j++)
-        {
-            out_data[j * rows + i] = t_data[i * cols + j];
-        }
-    }
-
-    return NO_ERROR;
-}
-
-static cgrad_error tensor2d_trans_f32(const struct tensor *const t, struct tensor *const out)
-{
-    size_t rows = t->shape[0];
-    size_t cols = t->shape[1];
-
-    float *restrict out_data = (float *)out->data;
-    float *restrict t_data = (float *)t->data;
-
-    // Transpose
-    for (size_t i = 0; i < rows; i++)
-    {
-        size_t offset = i * cols;
-        for (size_t j = 0; j < cols; j++)
-        {
-            out_data[j * rows + i] = t_data[offset + j];
-        }
-    }
-
-    return NO_ERROR;
+    return tensor2d_trans_dispatch(ctx->operands[TENSOR2D_TRANS_ONLY_OPERAND], out, ctx->pool);
 }
 
 static cgrad_error tensor2d_trans_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
 {
-    return tensor2d_trans_into(grad_wrt_out, grad_wrt_operand);
+    // Shapes were checked by the forward pass
+    return tensor2d_trans_dispatch(grad_wrt_out, grad_wrt_operand, ctx->pool);
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "cgrad/tensor/tensor_copy.h"
 #include "cgrad/tensor/tensor_helpers.h"
 #include "cgrad/tensor/tensor_equality.h"
+#include "cgrad/tensor/tensor_half.h"
+#include "cgrad/utils/half.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 
 typedef enum tensor_add_operand
@@ -14,6 +16,8 @@ static inline cgrad_error tensor_add_update_graph(struct tensor *const x, struct
 static inline cgrad_error tensor_add_dispatch(const struct tensor *const x, const struct tensor *const y, struct tensor *const out);
 static cgrad_error tensor_add_f64(const struct tensor *const x, const struct tensor *const y, struct tensor *const out);
 static cgrad_error tensor_add_f32(const struct tensor *const x, const struct tensor *const y, struct tensor *const out);
+static cgrad_error tensor_add_half(const struct tensor *const x, const struct tensor *const y, struct tensor *const out);
+static cgrad_error tensor_add_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
 static cgrad_error tensor_add_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 
 cgrad_error tensor_add(struct tensor *const x, struct tensor *const y, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
@@ -68,8 +72,23 @@ static inline cgrad_error tensor_add_update_graph(struct tensor *const x, struct
     }
 
     err = add_computational_graph_link(y, RHS_TENSOR, *out, &tensor_add_backpropagate, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
 
-    return err;
+    err = computational_graph_node_set_forward_function((*out)->node, &tensor_add_forward);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_memory_hints((*out)->node, false, false);
+}
+
+static cgrad_error tensor_add_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return tensor_add_dispatch(ctx->operands[LHS_TENSOR], ctx->operands[RHS_TENSOR], out);
 }
 
 static cgrad_error tensor_add_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
@@ -90,6 +109,9 @@ static inline cgrad_error tensor_add_dispatch(const struct tensor *const x, cons
         return tensor_add_f64(x, y, out);
     case DTYPE_FLOAT32:
         return tensor_add_f32(x, y, out);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return tensor_add_half(x, y, out);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
@@ -122,3 +144,28 @@ static cgrad_error tensor_add_f32(const struct tensor *const x, const struct ten
 
     return NO_ERROR;
 }
+
+static cgrad_error tensor_add_half(const struct tensor *const x, const struct tensor *const y, struct tensor *const out)
+{
+    uint16_t *restrict out_data = (uint16_t *)out->data;
+    uint16_t *restrict A_data = (uint16_t *)x->data;
+    uint16_t *restrict B_data = (uint16_t *)y->data;
+
+    float A_block[TENSOR_HALF_BLOCK_SIZE];
+    float B_block[TENSOR_HALF_BLOCK_SIZE];
+
+    for (size_t start = 0; start < x->data_size; start += TENSOR_HALF_BLOCK_SIZE)
+    {
+        const size_t n = x->data_size - start < TENSOR_HALF_BLOCK_SIZE ? x->data_size - start : TENSOR_HALF_BLOCK_SIZE;
+
+        half_to_f32_array(&A_data[start], A_block, n, x->dtype);
+        half_to_f32_array(&B_data[start], B_block, n, y->dtype);
+        for (size_t i = 0; i < n; i++)
+        {
+            A_block[i] += B_block[i];
+        }
+        f32_to_half_array(A_block, &out_data[start], n, out->dtype);
+    }
+
+    return NO_ERROR;
+}
@@ -1,11 +1,17 @@
 #include "cgrad/tensor/tensor_axpy.h"
 #include "cgrad/tensor/tensor_helpers.h"
 #include "cgrad/tensor/tensor_equality.h"
+#include "cgrad/tensor/tensor_half.h"
+#include "cgrad/utils/half.h"
+
+#ifdef CGRAD_USE_BLAS
 #include <cblas.h>
+#endif
 
 static inline cgrad_error tensor_axpy_dispatch(const struct tensor *const x, struct tensor *const y, const double alpha);
 static cgrad_error tensor_axpy_f64(const struct tensor *const x, struct tensor *const y, const double alpha);
 static cgrad_error tensor_axpy_f32(const struct tensor *const x, struct tensor *const y, const double alpha);
+static cgrad_error tensor_axpy_half(const struct tensor *const x, struct tensor *const y, const double alpha);
 
 cgrad_error tensor_axpy(const struct tensor *const x, struct tensor *const y, const double alpha)
 {
@@ -31,6 +37,10 @@ static inline cgrad_error tensor_axpy_dispatch(const struct tensor *const x, str
     case DTYPE_FLOAT32:
         tensor_axpy_f32(x, y, alpha);
         break;
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        tensor_axpy_half(x, y, alpha);
+        break;
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
@@ -40,6 +50,7 @@ static inline cgrad_error tensor_axpy_dispatch(const struct tensor *const x, str
 
 static cgrad_error tensor_axpy_f64(const struct tensor *const x, struct tensor *const y, const double alpha)
 {
+#ifdef CGRAD_USE_BLAS
     const blasint TENSOR_STRIDES = 1;
     cblas_daxpy(
         x->data_size,
@@ -48,12 +59,21 @@ static cgrad_error tensor_axpy_f64(const struct tensor *const x, struct tensor *
         TENSOR_STRIDES,
         y->data,
         TENSOR_STRIDES);
+#else
+    const double *x_data = (const double *)x->data;
+    double *y_data = (double *)y->data;
+    for (size_t i = 0; i < x->data_size; i++)
+    {
+        y_data[i] += alpha * x_data[i];
+    }
+#endif
 
     return NO_ERROR;
 }
 
 static cgrad_error tensor_axpy_f32(const struct tensor *const x, struct tensor *const y, const double alpha)
 {
+#ifdef CGRAD_USE_BLAS
     const blasint TENSOR_STRIDES = 1;
     cblas_saxpy(
         x->data_size,
@@ -62,6 +82,38 @@ static cgrad_error tensor_axpy_f32(const struct tensor *const x, struct tensor *
         TENSOR_STRIDES,
         y->data,
         TENSOR_STRIDES);
+#else
+    const float *x_data = (const float *)x->data;
+    float *y_data = (float *)y->data;
+    for (size_t i = 0; i < x->data_size; i++)
+    {
+        y_data[i] += (float)alpha * x_data[i];
+    }
+#endif
 
     return NO_ERROR;
-}
\ No newline at end of file
+}
+
+static cgrad_error tensor_axpy_half(const struct tensor *const x, struct tensor *const y, const double alpha)
+{
+    const uint16_t *x_data = (const uint16_t *)x->data;
+    uint16_t *y_data = (uint16_t *)y->data;
+
+    float x_block[TENSOR_HALF_BLOCK_SIZE];
+    float y_block[TENSOR_HALF_BLOCK_SIZE];
+
+    for (size_t start = 0; start < x->data_size; start += TENSOR_HALF_BLOCK_SIZE)
+    {
+        const size_t n = x->data_size - start < TENSOR_HALF_BLOCK_SIZE ? x->data_size - start : TENSOR_HALF_BLOCK_SIZE;
+
+        half_to_f32_array(&x_data[start], x_block, n, x->dtype);
+        half_to_f32_array(&y_data[start], y_block, n, y->dtype);
+        for (size_t i = 0; i < n; i++)
+        {
+            y_block[i] += (float)alpha * x_block[i];
+        }
+        f32_to_half_array(y_block, &y_data[start], n, y->dtype);
+    }
+
+    return NO_ERROR;
+}
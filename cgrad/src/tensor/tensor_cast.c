@@ -0,0 +1,173 @@
+#include "cgrad/tensor/tensor_cast.h"
+#include "cgrad/tensor/tensor_equality.h"
+#include "cgrad/utils/half.h"
+#include "cgrad/autograd/computational_graph/computational_graph.h"
+#include "cgrad/autograd/computational_graph/computational_graph_link.h"
+#include <string.h>
+
+typedef enum tensor_cast_operand
+{
+    TENSOR_CAST_ONLY_OPERAND,
+} tensor_cast_operand;
+
+static inline cgrad_error tensor_cast_update_graph(struct tensor *const t, struct tensor **const out, struct cgrad_env *const env);
+static cgrad_error tensor_cast_dispatch(const struct tensor *const t, struct tensor *const out);
+static void tensor_cast_generic(const struct tensor *const t, struct tensor *const out);
+static inline bool tensor_cast_supported(const cgrad_dtype dtype);
+static inline double tensor_cast_load(const void *const data, const size_t i, const cgrad_dtype dtype);
+static inline void tensor_cast_store(void *const data, const size_t i, const cgrad_dtype dtype, const double value);
+static cgrad_error tensor_cast_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
+static cgrad_error tensor_cast_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+
+cgrad_error tensor_cast(struct tensor *const t, const cgrad_dtype dtype, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
+{
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (!tensor_cast_supported(t->dtype) || !tensor_cast_supported(dtype))
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    (*out) = tensor_allocator_alloc(&env->tensor_alloc, t->shape, t->shape_size, dtype);
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    cgrad_error err = tensor_cast_dispatch(t, *out);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if (track_grad)
+    {
+        return tensor_cast_update_graph(t, out, env);
+    }
+
+    return NO_ERROR;
+}
+
+cgrad_error tensor_cast_into(const struct tensor *const t, struct tensor *const out)
+{
+    if (!t || !out)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->data || !out->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (!tensor_same_shape(t, out))
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+    if (!tensor_cast_supported(t->dtype) || !tensor_cast_supported(out->dtype))
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    return tensor_cast_dispatch(t, out);
+}
+
+static inline cgrad_error tensor_cast_update_graph(struct tensor *const t, struct tensor **const out, struct cgrad_env *const env)
+{
+    cgrad_error err = add_computational_graph_link(t, TENSOR_CAST_ONLY_OPERAND, *out, &tensor_cast_backpropagate, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = computational_graph_node_set_forward_function((*out)->node, &tensor_cast_forward);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_memory_hints((*out)->node, false, false);
+}
+
+static cgrad_error tensor_cast_dispatch(const struct tensor *const t, struct tensor *const out)
+{
+    if (t->dtype == out->dtype)
+    {
+        memcpy(out->data, t->data, t->data_size * dtype_sizeof(t->dtype));
+    }
+    else if (dtype_is_half(t->dtype) && out->dtype == DTYPE_FLOAT32)
+    {
+        half_to_f32_array((const uint16_t *)t->data, (float *)out->data, t->data_size, t->dtype);
+    }
+    else if (t->dtype == DTYPE_FLOAT32 && dtype_is_half(out->dtype))
+    {
+        f32_to_half_array((const float *)t->data, (uint16_t *)out->data, t->data_size, out->dtype);
+    }
+    else
+    {
+        tensor_cast_generic(t, out);
+    }
+
+    return NO_ERROR;
+}
+
+static void tensor_cast_generic(const struct tensor *const t, struct tensor *const out)
+{
+    for (size_t i = 0; i < t->data_size; i++)
+    {
+        tensor_cast_store(out->data, i, out->dtype, tensor_cast_load(t->data, i, t->dtype));
+    }
+}
+
+static inline bool tensor_cast_supported(const cgrad_dtype dtype)
+{
+    return dtype == DTYPE_FLOAT64 || dtype == DTYPE_FLOAT32 || dtype_is_half(dtype);
+}
+
+static inline double tensor_cast_load(const void *const data, const size_t i, const cgrad_dtype dtype)
+{
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+        return ((const double *)data)[i];
+    case DTYPE_FLOAT32:
+        return ((const float *)data)[i];
+    default:
+        return half_to_f32(((const uint16_t *)data)[i], dtype);
+    }
+}
+
+static inline void tensor_cast_store(void *const data, const size_t i, const cgrad_dtype dtype, const double value)
+{
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+        ((double *)data)[i] = value;
+        break;
+    case DTYPE_FLOAT32:
+        ((float *)data)[i] = (float)value;
+        break;
+    default:
+        ((uint16_t *)data)[i] = f32_to_half((float)value, dtype);
+        break;
+    }
+}
+
+static cgrad_error tensor_cast_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return tensor_cast_dispatch(ctx->operands[TENSOR_CAST_ONLY_OPERAND], out);
+}
+
+static cgrad_error tensor_cast_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    // The gradient wrt the operand has the dtype of the operand
+    return tensor_cast_dispatch(grad_wrt_out, grad_wrt_operand);
+}
@@ -1,5 +1,6 @@
 #include "cgrad/tensor/tensor_equality.h"
 #include <math.h>
+#include <string.h>
 
 static bool tensor_no_grad_same_data_f32(const struct tensor *const t1, const struct tensor *const t2);
 static bool tensor_no_grad_same_data_f64(const struct tensor *const t1, const struct tensor *const t2);
@@ -79,6 +80,10 @@ inline bool tensor_no_grad_same_data(const struct tensor *const t1, const struct
         return tensor_no_grad_same_data_f32(t1, t2);
     case DTYPE_FLOAT64:
         return tensor_no_grad_same_data_f64(t1, t2);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        // Rounding is deterministic, so half precision results are compared exactly
+        return memcmp(t1->data, t2->data, t1->data_size * dtype_sizeof(t1->dtype)) == 0;
     default:
         return false;
     }
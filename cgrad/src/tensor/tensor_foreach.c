@@ -0,0 +1,619 @@
+#include "cgrad/tensor/tensor_foreach.h"
+#include "cgrad/utils/half.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+#include <immintrin.h>
+#endif
+
+// Number of half precision elements widened to float32 at once on the stack
+#define FOREACH_BLOCK 256
+
+struct foreach_args;
+
+/**
+ * @brief Applies the operation to the elements [begin, end) of the i-th tensors, returning their contribution
+ * to the sum of the work item.
+ */
+typedef double (*foreach_kernel)(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end);
+
+struct foreach_args
+{
+    struct tensor *const *lists[3];   /**< Lists the operation is applied to, lists[0] giving the layout. */
+    size_t n_lists;
+    size_t n;
+    size_t *offsets;                  /**< Position of each tensor in the concatenation, offsets[n] being its size. */
+    foreach_kernel kernel;
+    double alpha;
+    const struct tensor_foreach_sgd_args *sgd;
+    struct tensor *const *rounded;
+    double *partials;                 /**< Sum of each work item, NULL if the operation has none. */
+};
+
+static cgrad_error foreach_run(struct foreach_args *const args, const size_t work_per_element, double *const sum, struct thread_pool *const pool);
+static void foreach_range(void *arg, const size_t begin, const size_t end);
+static cgrad_error foreach_check_float(struct tensor *const *const ts, const size_t n);
+static double foreach_zero_kernel(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end);
+static double foreach_scale_kernel(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end);
+static double foreach_axpy_kernel(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end);
+static double foreach_norm_kernel(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end);
+static double foreach_sgd_kernel(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end);
+static double foreach_sum_squares_f64(const double *const src, const size_t n);
+static double foreach_sum_squares_f32(const float *const src, const size_t n);
+static void foreach_sgd_f64(const struct tensor_foreach_sgd_args *const sgd, double *const w, const double *const g, double *const b, const size_t n);
+static void foreach_sgd_f32(const struct tensor_foreach_sgd_args *const sgd, float *const w, const float *const g, float *const b, const size_t n);
+
+cgrad_error tensor_foreach_zero(struct tensor *const *const ts, const size_t n, struct thread_pool *const pool)
+{
+    if (!ts)
+    {
+        return TENSOR_NULL;
+    }
+
+    struct foreach_args args = {.lists = {ts}, .n_lists = 1, .n = n, .kernel = &foreach_zero_kernel};
+    return foreach_run(&args, 1, NULL, pool);
+}
+
+cgrad_error tensor_foreach_scale(struct tensor *const *const ts, const size_t n, const double alpha, struct thread_pool *const pool)
+{
+    if (!ts)
+    {
+        return TENSOR_NULL;
+    }
+    cgrad_error err = foreach_check_float(ts, n);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct foreach_args args = {.lists = {ts}, .n_lists = 1, .n = n, .kernel = &foreach_scale_kernel, .alpha = alpha};
+    return foreach_run(&args, 1, NULL, pool);
+}
+
+cgrad_error tensor_foreach_axpy(struct tensor *const *const xs, struct tensor *const *const ys, const size_t n, const double alpha, struct thread_pool *const pool)
+{
+    if (!xs || !ys)
+    {
+        return TENSOR_NULL;
+    }
+    cgrad_error err = foreach_check_float(ys, n);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!xs[i] || !ys[i])
+        {
+            continue;
+        }
+        if (xs[i]->data_size != ys[i]->data_size)
+        {
+            return TENSOR_SHAPE_MISMATCH;
+        }
+        if (xs[i]->dtype != ys[i]->dtype)
+        {
+            return TENSOR_DTYPE_MISMATCH;
+        }
+    }
+
+    struct foreach_args args = {.lists = {ys, xs}, .n_lists = 2, .n = n, .kernel = &foreach_axpy_kernel, .alpha = alpha};
+    return foreach_run(&args, 2, NULL, pool);
+}
+
+cgrad_error tensor_foreach_norm(struct tensor *const *const ts, const size_t n, double *const out, struct thread_pool *const pool)
+{
+    if (!ts)
+    {
+        return TENSOR_NULL;
+    }
+    if (!out)
+    {
+        return TENSOR_NULL;
+    }
+    cgrad_error err = foreach_check_float(ts, n);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    double sum = 0.0;
+    struct foreach_args args = {.lists = {ts}, .n_lists = 1, .n = n, .kernel = &foreach_norm_kernel};
+    err = foreach_run(&args, 1, &sum, pool);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    *out = sqrt(sum);
+    return NO_ERROR;
+}
+
+cgrad_error tensor_foreach_clip_norm(struct tensor *const *const ts, const size_t n, const double max_norm, double *const total_norm, struct thread_pool *const pool)
+{
+    double norm = 0.0;
+    cgrad_error err = tensor_foreach_norm(ts, n, &norm, pool);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+    if (total_norm)
+    {
+        *total_norm = norm;
+    }
+
+    if (norm <= max_norm)
+    {
+        return NO_ERROR;
+    }
+
+    return tensor_foreach_scale(ts, n, max_norm / norm, pool);
+}
+
+cgrad_error tensor_foreach_sgd(struct tensor *const *const weights, struct tensor *const *const grads, struct tensor *const *const momentums, struct tensor *const *const rounded, const size_t n, const struct tensor_foreach_sgd_args *const args, struct thread_pool *const pool)
+{
+    if (!weights || !grads || !momentums || !args)
+    {
+        return TENSOR_NULL;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        const struct tensor *const w = weights[i];
+        const struct tensor *const g = grads[i];
+        const struct tensor *const b = momentums[i];
+        const struct tensor *const r = rounded ? rounded[i] : NULL;
+        if (!w || !g || !b)
+        {
+            continue;
+        }
+        if (w->data_size != g->data_size || w->data_size != b->data_size || (r && w->data_size != r->data_size))
+        {
+            return TENSOR_SHAPE_MISMATCH;
+        }
+        if (w->dtype != DTYPE_FLOAT64 && w->dtype != DTYPE_FLOAT32)
+        {
+            return OPERATION_INVALID_TENSOR_DTYPE;
+        }
+        const bool grad_valid = g->dtype == w->dtype || (w->dtype == DTYPE_FLOAT32 && dtype_is_half(g->dtype));
+        const bool rounded_valid = !r || (w->dtype == DTYPE_FLOAT32 && dtype_is_half(r->dtype));
+        if (!grad_valid || b->dtype != w->dtype || !rounded_valid)
+        {
+            return TENSOR_DTYPE_MISMATCH;
+        }
+    }
+
+    struct foreach_args foreach = {.lists = {weights, grads, momentums}, .n_lists = 3, .n = n, .kernel = &foreach_sgd_kernel, .sgd = args, .rounded = rounded};
+    return foreach_run(&foreach, 4, NULL, pool);
+}
+
+static cgrad_error foreach_run(struct foreach_args *const args, const size_t work_per_element, double *const sum, struct thread_pool *const pool)
+{
+    args->offsets = (size_t *)malloc((args->n + 1) * sizeof(size_t));
+    if (!args->offsets)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    // Tensors missing from any list take no room in the concatenation
+    args->offsets[0] = 0;
+    for (size_t i = 0; i < args->n; i++)
+    {
+        bool present = true;
+        for (size_t l = 0; l < args->n_lists; l++)
+        {
+            present = present && args->lists[l][i];
+        }
+        args->offsets[i + 1] = args->offsets[i] + (present ? args->lists[0][i]->data_size : 0);
+    }
+
+    const size_t n_items = (args->offsets[args->n] + TENSOR_FOREACH_CHUNK - 1) / TENSOR_FOREACH_CHUNK;
+    args->partials = NULL;
+    if (sum)
+    {
+        args->partials = (double *)malloc((n_items > 0 ? n_items : 1) * sizeof(double));
+        if (!args->partials)
+        {
+            free(args->offsets);
+            return TENSOR_ALLOCATION_FAILED;
+        }
+    }
+
+    thread_pool_parallel_for(pool, n_items, thread_pool_grain(TENSOR_FOREACH_CHUNK * work_per_element), &foreach_range, args);
+
+    // Partial sums are added in the order of the work items, whichever thread computed them
+    if (sum)
+    {
+        *sum = 0.0;
+        for (size_t item = 0; item < n_items; item++)
+        {
+            *sum += args->partials[item];
+        }
+        free(args->partials);
+    }
+    free(args->offsets);
+
+    return NO_ERROR;
+}
+
+static void foreach_range(void *arg, const size_t begin, const size_t end)
+{
+    const struct foreach_args *const args = (const struct foreach_args *)arg;
+    const size_t *const offsets = args->offsets;
+    const size_t total = offsets[args->n];
+
+    for (size_t item = begin; item < end; item++)
+    {
+        size_t pos = item * TENSOR_FOREACH_CHUNK;
+        const size_t item_end = pos + TENSOR_FOREACH_CHUNK < total ? pos + TENSOR_FOREACH_CHUNK : total;
+
+        // First tensor i with offsets[i] <= pos < offsets[i + 1]
+        size_t lo = 0;
+        size_t hi = args->n;
+        while (lo + 1 < hi)
+        {
+            const size_t mid = (lo + hi) / 2;
+            if (offsets[mid] <= pos)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+
+        double partial = 0.0;
+        for (size_t i = lo; pos < item_end; i++)
+        {
+            const size_t stop = offsets[i + 1] < item_end ? offsets[i + 1] : item_end;
+            if (stop > pos)
+            {
+                partial += args->kernel(args, i, pos - offsets[i], stop - offsets[i]);
+                pos = stop;
+            }
+        }
+
+        if (args->partials)
+        {
+            args->partials[item] = partial;
+        }
+    }
+}
+
+static cgrad_error foreach_check_float(struct tensor *const *const ts, const size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!ts[i])
+        {
+            continue;
+        }
+        const cgrad_dtype dtype = ts[i]->dtype;
+        if (dtype != DTYPE_FLOAT64 && dtype != DTYPE_FLOAT32 && !dtype_is_half(dtype))
+        {
+            return OPERATION_INVALID_TENSOR_DTYPE;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static double foreach_zero_kernel(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end)
+{
+    struct tensor *const t = args->lists[0][i];
+    const size_t size = dtype_sizeof(t->dtype);
+    memset((char *)t->data + begin * size, 0, (end - begin) * size);
+
+    return 0.0;
+}
+
+static double foreach_scale_kernel(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end)
+{
+    struct tensor *const t = args->lists[0][i];
+    const size_t n = end - begin;
+
+    switch (t->dtype)
+    {
+    case DTYPE_FLOAT64:
+    {
+        double *const data = (double *)t->data + begin;
+        for (size_t j = 0; j < n; j++)
+        {
+            data[j] *= args->alpha;
+        }
+        break;
+    }
+    case DTYPE_FLOAT32:
+    {
+        float *const data = (float *)t->data + begin;
+        const float alpha = (float)args->alpha;
+        for (size_t j = 0; j < n; j++)
+        {
+            data[j] *= alpha;
+        }
+        break;
+    }
+    default:
+    {
+        uint16_t *const data = (uint16_t *)t->data + begin;
+        const float alpha = (float)args->alpha;
+        float block[FOREACH_BLOCK];
+        for (size_t start = 0; start < n; start += FOREACH_BLOCK)
+        {
+            const size_t len = n - start < FOREACH_BLOCK ? n - start : FOREACH_BLOCK;
+            half_to_f32_array(data + start, block, len, t->dtype);
+            for (size_t j = 0; j < len; j++)
+            {
+                block[j] *= alpha;
+            }
+            f32_to_half_array(block, data + start, len, t->dtype);
+        }
+        break;
+    }
+    }
+
+    return 0.0;
+}
+
+static double foreach_axpy_kernel(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end)
+{
+    struct tensor *const y = args->lists[0][i];
+    const struct tensor *const x = args->lists[1][i];
+    const size_t n = end - begin;
+
+    switch (y->dtype)
+    {
+    case DTYPE_FLOAT64:
+    {
+        double *const y_data = (double *)y->data + begin;
+        const double *const x_data = (const double *)x->data + begin;
+        for (size_t j = 0; j < n; j++)
+        {
+            y_data[j] += args->alpha * x_data[j];
+        }
+        break;
+    }
+    case DTYPE_FLOAT32:
+    {
+        float *const y_data = (float *)y->data + begin;
+        const float *const x_data = (const float *)x->data + begin;
+        const float alpha = (float)args->alpha;
+        for (size_t j = 0; j < n; j++)
+        {
+            y_data[j] += alpha * x_data[j];
+        }
+        break;
+    }
+    default:
+    {
+        uint16_t *const y_data = (uint16_t *)y->data + begin;
+        const uint16_t *const x_data = (const uint16_t *)x->data + begin;
+        const float alpha = (float)args->alpha;
+        float y_block[FOREACH_BLOCK];
+        float x_block[FOREACH_BLOCK];
+        for (size_t start = 0; start < n; start += FOREACH_BLOCK)
+        {
+            const size_t len = n - start < FOREACH_BLOCK ? n - start : FOREACH_BLOCK;
+            half_to_f32_array(y_data + start, y_block, len, y->dtype);
+            half_to_f32_array(x_data + start, x_block, len, x->dtype);
+            for (size_t j = 0; j < len; j++)
+            {
+                y_block[j] += alpha * x_block[j];
+            }
+            f32_to_half_array(y_block, y_data + start, len, y->dtype);
+        }
+        break;
+    }
+    }
+
+    return 0.0;
+}
+
+static double foreach_norm_kernel(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end)
+{
+    const struct tensor *const t = args->lists[0][i];
+    const size_t n = end - begin;
+
+    switch (t->dtype)
+    {
+    case DTYPE_FLOAT64:
+        return foreach_sum_squares_f64((const double *)t->data + begin, n);
+    case DTYPE_FLOAT32:
+        return foreach_sum_squares_f32((const float *)t->data + begin, n);
+    default:
+    {
+        const uint16_t *const data = (const uint16_t *)t->data + begin;
+        float block[FOREACH_BLOCK];
+        double sum = 0.0;
+        for (size_t start = 0; start < n; start += FOREACH_BLOCK)
+        {
+            const size_t len = n - start < FOREACH_BLOCK ? n - start : FOREACH_BLOCK;
+            half_to_f32_array(data + start, block, len, t->dtype);
+            sum += foreach_sum_squares_f32(block, len);
+        }
+        return sum;
+    }
+    }
+}
+
+static double foreach_sgd_kernel(const struct foreach_args *const args, const size_t i, const size_t begin, const size_t end)
+{
+    struct tensor *const w = args->lists[0][i];
+    const struct tensor *const g = args->lists[1][i];
+    struct tensor *const b = args->lists[2][i];
+    struct tensor *const r = args->rounded ? args->rounded[i] : NULL;
+    const size_t n = end - begin;
+
+    if (w->dtype == DTYPE_FLOAT64)
+    {
+        foreach_sgd_f64(args->sgd, (double *)w->data + begin, (const double *)g->data + begin, (double *)b->data + begin, n);
+        return 0.0;
+    }
+
+    float *const w_data = (float *)w->data + begin;
+    float *const b_data = (float *)b->data + begin;
+    if (!dtype_is_half(g->dtype) && !r)
+    {
+        foreach_sgd_f32(args->sgd, w_data, (const float *)g->data + begin, b_data, n);
+        return 0.0;
+    }
+
+    // Half precision gradients are widened, and updated weights rounded, one block at a time
+    float block[FOREACH_BLOCK];
+    for (size_t start = 0; start < n; start += FOREACH_BLOCK)
+    {
+        const size_t len = n - start < FOREACH_BLOCK ? n - start : FOREACH_BLOCK;
+        const float *g_data = (const float *)g->data + begin + start;
+        if (dtype_is_half(g->dtype))
+        {
+            half_to_f32_array((const uint16_t *)g->data + begin + start, block, len, g->dtype);
+            g_data = block;
+        }
+        foreach_sgd_f32(args->sgd, w_data + start, g_data, b_data + start, len);
+        if (r)
+        {
+            f32_to_half_array(w_data + start, (uint16_t *)r->data + begin + start, len, r->dtype);
+        }
+    }
+
+    return 0.0;
+}
+
+static double foreach_sum_squares_f64(const double *const src, const size_t n)
+{
+    size_t i = 0;
+    double sum = 0.0;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m256d v0 = _mm256_loadu_pd(src + i);
+        const __m256d v1 = _mm256_loadu_pd(src + i + 4);
+        const __m256d v2 = _mm256_loadu_pd(src + i + 8);
+        const __m256d v3 = _mm256_loadu_pd(src + i + 12);
+        acc0 = _mm256_fmadd_pd(v0, v0, acc0);
+        acc1 = _mm256_fmadd_pd(v1, v1, acc1);
+        acc2 = _mm256_fmadd_pd(v2, v2, acc2);
+        acc3 = _mm256_fmadd_pd(v3, v3, acc3);
+    }
+    const __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+    const __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+#endif
+    for (; i < n; i++)
+    {
+        sum += src[i] * src[i];
+    }
+
+    return sum;
+}
+
+static double foreach_sum_squares_f32(const float *const src, const size_t n)
+{
+    size_t i = 0;
+    double sum = 0.0;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    // Squares are accumulated in float64 lanes, so that large tensors lose no precision
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    for (; i + 16 <= n; i += 16)
+    {
+        const __m256 v0 = _mm256_loadu_ps(src + i);
+        const __m256 v1 = _mm256_loadu_ps(src + i + 8);
+        const __m256d d0 = _mm256_cvtps_pd(_mm256_castps256_ps128(v0));
+        const __m256d d1 = _mm256_cvtps_pd(_mm256_extractf128_ps(v0, 1));
+        const __m256d d2 = _mm256_cvtps_pd(_mm256_castps256_ps128(v1));
+        const __m256d d3 = _mm256_cvtps_pd(_mm256_extractf128_ps(v1, 1));
+        acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+        acc2 = _mm256_fmadd_pd(d2, d2, acc2);
+        acc3 = _mm256_fmadd_pd(d3, d3, acc3);
+    }
+    const __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+    const __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+#endif
+    for (; i < n; i++)
+    {
+        sum += (double)src[i] * src[i];
+    }
+
+    return sum;
+}
+
+static void foreach_sgd_f64(const struct tensor_foreach_sgd_args *const sgd, double *const w, const double *const g, double *const b, const size_t n)
+{
+    const double lr = sgd->lr;
+    const double momentum = sgd->momentum;
+    const double scale = sgd->grad_scale;
+
+    if (momentum == 0.0)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            w[j] -= lr * (scale * g[j]);
+        }
+    }
+    else if (sgd->nesterov)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            const double g_j = scale * g[j];
+            const double b_j = momentum * b[j] + g_j;
+            b[j] = b_j;
+            w[j] -= lr * (g_j + momentum * b_j);
+        }
+    }
+    else
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            const double b_j = momentum * b[j] + scale * g[j];
+            b[j] = b_j;
+            w[j] -= lr * b_j;
+        }
+    }
+}
+
+static void foreach_sgd_f32(const struct tensor_foreach_sgd_args *const sgd, float *const w, const float *const g, float *const b, const size_t n)
+{
+    const float lr = (float)sgd->lr;
+    const float momentum = (float)sgd->momentum;
+    const float scale = (float)sgd->grad_scale;
+
+    if (momentum == 0.0f)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            w[j] -= lr * (scale * g[j]);
+        }
+    }
+    else if (sgd->nesterov)
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            const float g_j = scale * g[j];
+            const float b_j = momentum * b[j] + g_j;
+            b[j] = b_j;
+            w[j] -= lr * (g_j + momentum * b_j);
+        }
+    }
+    else
+    {
+        for (size_t j = 0; j < n; j++)
+        {
+            const float b_j = momentum * b[j] + scale * g[j];
+            b[j] = b_j;
+            w[j] -= lr * b_j;
+        }
+    }
+}
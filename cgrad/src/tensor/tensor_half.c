@@ -0,0 +1,52 @@
+#include "cgrad/tensor/tensor_half.h"
+#include "cgrad/utils/half.h"
+#include <stdlib.h>
+
+cgrad_error tensor_half_widen(const struct tensor *const t, struct tensor *const t_f32)
+{
+    cgrad_error err = tensor_half_alloc_f32(t, t_f32);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    half_to_f32_array((const uint16_t *)t->data, (float *)t_f32->data, t->data_size, t->dtype);
+
+    return NO_ERROR;
+}
+
+cgrad_error tensor_half_alloc_f32(const struct tensor *const t, struct tensor *const t_f32)
+{
+    if (!t || !t_f32)
+    {
+        return TENSOR_NULL;
+    }
+    if (!dtype_is_half(t->dtype))
+    {
+        return TENSOR_INVALID_DTYPE;
+    }
+
+    *t_f32 = *t;
+    t_f32->dtype = DTYPE_FLOAT32;
+    t_f32->node = NULL;
+    t_f32->grad = NULL;
+    t_f32->grad_rows = NULL;
+    t_f32->data = malloc(t->data_size * sizeof(float));
+    if (!t_f32->data)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    return NO_ERROR;
+}
+
+void tensor_half_narrow(const struct tensor *const t_f32, struct tensor *const t)
+{
+    f32_to_half_array((const float *)t_f32->data, (uint16_t *)t->data, t->data_size, t->dtype);
+}
+
+void tensor_half_release_f32(struct tensor *const t_f32)
+{
+    free(t_f32->data);
+    t_f32->data = NULL;
+}
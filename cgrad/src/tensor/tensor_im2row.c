@@ -1,4 +1,5 @@
 #include "cgrad/tensor/tensor_im2row.h"
+#include "cgrad/tensor/tensor_half.h"
 #include "cgrad/autograd/backpropagation/backpropagation_context.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
 #include "cgrad/autograd/computational_graph/computational_graph_link.h"
@@ -13,28 +14,100 @@ typedef enum tensor_im2row_owned
     ORIGIN_IDXS,
 } tensor_im2row_owned;
 
-static inline cgrad_error tensor_im2row_update_graph(struct tensor *const t, struct tensor *const out, struct tensor *const origin_idxs, struct cgrad_env *env);
-static inline cgrad_error tensor_im2row_dispatch(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, struct cgrad_env *const env);
-static cgrad_error tensor_im2row_f32(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, struct cgrad_env *const env);
+typedef enum tensor_im2row_operand_size_t
+{
+    KERNEL_CHANNELS,
+    KERNEL_HEIGHT,
+    KERNEL_WIDTH,
+} tensor_im2row_operand_size_t;
+
+struct tensor_im2row_args
+{
+    const struct tensor *t;
+    size_t C;
+    size_t R;
+    size_t S;
+    struct tensor *out;
+    struct tensor *origin_idxs;
+};
+
+struct tensor_im2row_scatter_args
+{
+    const struct tensor *origin_idxs;
+    const struct tensor *grad_wrt_out;
+    struct tensor *grad_wrt_operand;
+};
+
+static inline cgrad_error tensor_im2row_update_graph(struct tensor *const t, const struct tensor *const kernel, struct tensor *const out, struct tensor *const origin_idxs, struct cgrad_env *env);
+static inline cgrad_error tensor_im2row_dispatch(const struct tensor *const t, const size_t C, const size_t R, const size_t S, struct tensor *const out, struct tensor *const origin_idxs, struct thread_pool *const pool);
+static cgrad_error tensor_im2row_f32(const struct tensor *const t, const size_t C, const size_t R, const size_t S, struct tensor *const out, struct tensor *const origin_idxs, struct thread_pool *const pool);
+static void tensor_im2row_f32_rows(void *arg, const size_t begin, const size_t end);
+static cgrad_error tensor_im2row_half(const struct tensor *const t, const size_t C, const size_t R, const size_t S, struct tensor *const out, struct tensor *const origin_idxs, struct thread_pool *const pool);
+static cgrad_error tensor_im2row_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
 static cgrad_error tensor_im2row_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 static cgrad_error tensor_im2row_backpropagate_f32(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static void tensor_im2row_scatter_f32_batches(void *arg, const size_t begin, const size_t end);
+static cgrad_error tensor_im2row_backpropagate_half(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 
 cgrad_error tensor_im2row(struct tensor *t, const struct tensor *kernel, struct tensor **out, const bool track_grad, struct cgrad_env *const env)
 {
-    // checks
+    if (!t || !kernel)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (t->shape_size != 4 || kernel->shape_size != 4)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+    if (t->shape[1] != kernel->shape[1])
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+
+    const size_t H_out = t->shape[2] - kernel->shape[2] + 1;
+    const size_t W_out = t->shape[3] - kernel->shape[3] + 1;
+    const size_t C = kernel->shape[1];
+    const size_t R = kernel->shape[2];
+    const size_t S = kernel->shape[3];
+
+    const size_t out_shape[] = {H_out * W_out * t->shape[0], C * R * S};
+    (*out) = tensor_allocator_alloc(&env->tensor_alloc, out_shape, 2, t->dtype);
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
 
+    // Source indexes are only needed for backpropagation, half precision cannot represent them exactly
     struct tensor *origin_idxs = NULL;
-    tensor_im2row_dispatch(t, kernel, out, &origin_idxs, env);
+    if (track_grad)
+    {
+        origin_idxs = tensor_allocator_no_grad_alloc(&env->tensor_alloc, out_shape, 2, DTYPE_FLOAT32);
+        if (!origin_idxs)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+    }
+
+    cgrad_error err = tensor_im2row_dispatch(t, C, R, S, *out, origin_idxs, env->pool);
+    if (err != NO_ERROR)
+    {
+        tensor_allocator_no_grad_free(&env->tensor_alloc, origin_idxs);
+        return err;
+    }
 
     if (track_grad)
     {
-        return tensor_im2row_update_graph(t, *out, origin_idxs, env);
+        return tensor_im2row_update_graph(t, kernel, *out, origin_idxs, env);
     }
 
     return NO_ERROR;
 }
 
-static inline cgrad_error tensor_im2row_update_graph(struct tensor *const t, struct tensor *const out, struct tensor *const origin_idxs, struct cgrad_env *env)
+static inline cgrad_error tensor_im2row_update_graph(struct tensor *const t, const struct tensor *const kernel, struct tensor *const out, struct tensor *const origin_idxs, struct cgrad_env *env)
 {
     cgrad_error err = add_computational_graph_link(t, TENSOR, out, &tensor_im2row_backpropagate, env);
     if (err != NO_ERROR)
@@ -42,70 +115,136 @@ static inline cgrad_error tensor_im2row_update_graph(struct tensor *const t, str
         return err;
     }
 
-    return context_set_owned(&out->node->ctx, origin_idxs, ORIGIN_IDXS);
+    err = context_set_owned(&out->node->ctx, origin_idxs, ORIGIN_IDXS);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Save kernel dimensions, needed to recompute the patches
+    struct backpropagation_context *ctx = &out->node->ctx;
+    if ((err = context_set_operand_size_t(ctx, kernel->shape[1], KERNEL_CHANNELS)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = context_set_operand_size_t(ctx, kernel->shape[2], KERNEL_HEIGHT)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = context_set_operand_size_t(ctx, kernel->shape[3], KERNEL_WIDTH)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = computational_graph_node_set_forward_function(out->node, &tensor_im2row_forward);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_memory_hints(out->node, false, false);
 }
 
-static inline cgrad_error tensor_im2row_dispatch(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, struct cgrad_env *const env)
+static inline cgrad_error tensor_im2row_dispatch(const struct tensor *const t, const size_t C, const size_t R, const size_t S, struct tensor *const out, struct tensor *const origin_idxs, struct thread_pool *const pool)
 {
     switch (t->dtype)
     {
     case DTYPE_FLOAT32:
-        return tensor_im2row_f32(t, kernel, out, origin_idxs, env);
+        return tensor_im2row_f32(t, C, R, S, out, origin_idxs, pool);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return tensor_im2row_half(t, C, R, S, out, origin_idxs, pool);
     default:
         return OPERATION_INVALID_TENSOR_DTYPE;
     }
 }
 
-static cgrad_error tensor_im2row_f32(struct tensor *t, const struct tensor *kernel, struct tensor **const out, struct tensor **const origin_idxs, struct cgrad_env *const env)
+static cgrad_error tensor_im2row_f32(const struct tensor *const t, const size_t C, const size_t R, const size_t S, struct tensor *const out, struct tensor *const origin_idxs, struct thread_pool *const pool)
 {
-    float *t_data = (float *)t->data;
+    struct tensor_im2row_args args = {.t = t, .C = C, .R = R, .S = S, .out = out, .origin_idxs = origin_idxs};
 
-    const size_t H_out = t->shape[2] - kernel->shape[2] + 1;
-    const size_t W_out = t->shape[3] - kernel->shape[3] + 1;
+    // Each row of the output is one patch, copied independently of the others
+    const size_t H_out = t->shape[2] - R + 1;
+    const size_t W_out = t->shape[3] - S + 1;
+    thread_pool_parallel_for(pool, t->shape[0] * H_out * W_out, thread_pool_grain(C * R * S), &tensor_im2row_f32_rows, &args);
 
-    // size_t K = kernel->shape[0];
-    size_t C = kernel->shape[1];
-    size_t R = kernel->shape[2];
-    size_t S = kernel->shape[3];
+    return NO_ERROR;
+}
 
-    const size_t out_shape[] = {H_out * W_out * t->shape[0], C * R * S};
-    (*out) = tensor_allocator_alloc(&env->tensor_alloc, out_shape, 2, t->dtype);
-    (*origin_idxs) = tensor_allocator_alloc(&env->tensor_alloc, out_shape, 2, t->dtype);
-    float *out_data = (float *)(*out)->data;
-    float *origin_idxs_data = (float *)(*origin_idxs)->data;
+static void tensor_im2row_f32_rows(void *arg, const size_t begin, const size_t end)
+{
+    const struct tensor_im2row_args *args = arg;
+    const struct tensor *const t = args->t;
+    const size_t C = args->C;
+    const size_t R = args->R;
+    const size_t S = args->S;
+    float *t_data = (float *)t->data;
+
+    const size_t H_out = t->shape[2] - R + 1;
+    const size_t W_out = t->shape[3] - S + 1;
 
-    const size_t BATCH_OFFSET = C * R * S * H_out * W_out;
+    const size_t out_cols = args->out->shape[1];
+    float *out_data = (float *)args->out->data;
+    float *origin_idxs_data = args->origin_idxs ? (float *)args->origin_idxs->data : NULL;
 
-    for (size_t batch = 0; batch < t->shape[0]; batch++)
+    // Rows of all the batch elements follow each other, patch (batch, h_out, w_out) is row (batch * H_out + h_out) * W_out + w_out
+    for (size_t row = begin; row < end; row++)
     {
-        size_t row = 0;
-        for (size_t h_out = 0; h_out < H_out; h_out++)
+        const size_t batch = row / (H_out * W_out);
+        const size_t h_out = (row / W_out) % H_out;
+        const size_t w_out = row % W_out;
+
+        size_t col = 0;
+        for (size_t c = 0; c < C; c++)
         {
-            for (size_t w_out = 0; w_out < W_out; w_out++)
+            for (size_t r = 0; r < R; r++)
             {
-                size_t col = 0;
-                for (size_t c = 0; c < C; c++)
+                for (size_t s = 0; s < S; s++)
                 {
-                    for (size_t r = 0; r < R; r++)
-                    {
-                        for (size_t s = 0; s < S; s++)
-                        {
-                            size_t h_in = h_out + r;
-                            size_t w_in = w_out + s;
-
-                            out_data[col + row * out_shape[1] + batch * BATCH_OFFSET] = t_data[batch * t->stride[0] + c * t->stride[1] + h_in * t->stride[2] + w_in];
-                            origin_idxs_data[col + row * out_shape[1] + batch * BATCH_OFFSET] = batch * t->stride[0] + c * t->stride[1] + h_in * t->stride[2] + w_in;
+                    size_t h_in = h_out + r;
+                    size_t w_in = w_out + s;
+                    size_t origin_idx = batch * t->stride[0] + c * t->stride[1] + h_in * t->stride[2] + w_in;
 
-                            col++;
-                        }
+                    out_data[col + row * out_cols] = t_data[origin_idx];
+                    if (origin_idxs_data)
+                    {
+                        origin_idxs_data[col + row * out_cols] = origin_idx;
                     }
+
+                    col++;
                 }
-                row++;
             }
         }
     }
+}
 
-    return NO_ERROR;
+static cgrad_error tensor_im2row_half(const struct tensor *const t, const size_t C, const size_t R, const size_t S, struct tensor *const out, struct tensor *const origin_idxs, struct thread_pool *const pool)
+{
+    struct tensor t_f32 = {0};
+    struct tensor out_f32 = {0};
+
+    cgrad_error err = NO_ERROR;
+    if ((err = tensor_half_widen(t, &t_f32)) == NO_ERROR &&
+        (err = tensor_half_alloc_f32(out, &out_f32)) == NO_ERROR &&
+        (err = tensor_im2row_f32(&t_f32, C, R, S, &out_f32, origin_idxs, pool)) == NO_ERROR)
+    {
+        tensor_half_narrow(&out_f32, out);
+    }
+
+    tensor_half_release_f32(&t_f32);
+    tensor_half_release_f32(&out_f32);
+
+    return err;
+}
+
+static cgrad_error tensor_im2row_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    const size_t C = ctx->operands_size_t[KERNEL_CHANNELS];
+    const size_t R = ctx->operands_size_t[KERNEL_HEIGHT];
+    const size_t S = ctx->operands_size_t[KERNEL_WIDTH];
+
+    // Source indexes only depend on shapes, which do not change on replay
+    return tensor_im2row_dispatch(ctx->operands[TENSOR], C, R, S, out, NULL, ctx->pool);
 }
 
 static cgrad_error tensor_im2row_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
@@ -114,6 +253,9 @@ static cgrad_error tensor_im2row_backpropagate(const struct backpropagation_cont
     {
     case DTYPE_FLOAT32:
         return tensor_im2row_backpropagate_f32(ctx, grad_wrt_out, grad_wrt_operand);
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return tensor_im2row_backpropagate_half(ctx, grad_wrt_out, grad_wrt_operand);
     default:
         return AUTOGRAD_BACKPROPAGATION_INVALID_TENSOR_DTYPE;
     }
@@ -121,16 +263,51 @@ static cgrad_error tensor_im2row_backpropagate(const struct backpropagation_cont
 
 static cgrad_error tensor_im2row_backpropagate_f32(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
 {
-    struct tensor *origin_idxs = ctx->owned[ORIGIN_IDXS];
+    struct tensor_im2row_scatter_args args = {.origin_idxs = ctx->owned[ORIGIN_IDXS], .grad_wrt_out = grad_wrt_out, .grad_wrt_operand = grad_wrt_operand};
+
+    // Patches only overlap within a batch element, so batch elements are scattered independently
+    const size_t batch_size = grad_wrt_operand->shape[0];
+    thread_pool_parallel_for(ctx->pool, batch_size, thread_pool_grain(args.origin_idxs->data_size / batch_size), &tensor_im2row_scatter_f32_batches, &args);
+
+    return NO_ERROR;
+}
 
-    float *grad_wrt_out_data = (float *)grad_wrt_out->data;
+static void tensor_im2row_scatter_f32_batches(void *arg, const size_t begin, const size_t end)
+{
+    const struct tensor_im2row_scatter_args *args = arg;
+    struct tensor *grad_wrt_operand = args->grad_wrt_operand;
+
+    float *grad_wrt_out_data = (float *)args->grad_wrt_out->data;
     float *grad_wrt_operand_data = (float *)grad_wrt_operand->data;
-    float *origin_idxs_data = (float *)origin_idxs->data;
+    float *origin_idxs_data = (float *)args->origin_idxs->data;
+
+    const size_t batch_offset = args->origin_idxs->data_size / grad_wrt_operand->shape[0];
+    const size_t operand_batch_offset = grad_wrt_operand->stride[0];
 
-    for (size_t i = 0; i < origin_idxs->data_size; i++)
+    // Patches overlap, so the gradient is scattered with accumulation
+    memset(grad_wrt_operand_data + begin * operand_batch_offset, 0, (end - begin) * operand_batch_offset * sizeof(float));
+    for (size_t i = begin * batch_offset; i < end * batch_offset; i++)
     {
         grad_wrt_operand_data[(size_t)origin_idxs_data[i]] += grad_wrt_out_data[i];
     }
+}
 
-    return NO_ERROR;
-}
\ No newline at end of file
+static cgrad_error tensor_im2row_backpropagate_half(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    // Overlapping patches are accumulated in float32 before rounding
+    struct tensor grad_wrt_out_f32 = {0};
+    struct tensor grad_wrt_operand_f32 = {0};
+
+    cgrad_error err = NO_ERROR;
+    if ((err = tensor_half_widen(grad_wrt_out, &grad_wrt_out_f32)) == NO_ERROR &&
+        (err = tensor_half_alloc_f32(grad_wrt_operand, &grad_wrt_operand_f32)) == NO_ERROR &&
+        (err = tensor_im2row_backpropagate_f32(ctx, &grad_wrt_out_f32, &grad_wrt_operand_f32)) == NO_ERROR)
+    {
+        tensor_half_narrow(&grad_wrt_operand_f32, grad_wrt_operand);
+    }
+
+    tensor_half_release_f32(&grad_wrt_out_f32);
+    tensor_half_release_f32(&grad_wrt_operand_f32);
+
+    return err;
+}
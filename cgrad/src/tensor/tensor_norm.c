@@ -1,37 +1,13 @@
 #include "cgrad/tensor/tensor_norm.h"
+#include "cgrad/tensor/tensor_foreach.h"
 
-static inline cgrad_error tensor_norm_dispatch(const struct tensor *const t, double *const out);
-static inline cgrad_error tensor_norm_f32(const struct tensor *const t, double *const out);
-
-static inline cgrad_error tensor_norm(const struct tensor *const t, double *const out)
+cgrad_error tensor_norm(const struct tensor *const t, double *const out)
 {
     if (!t)
     {
         return TENSOR_NULL;
     }
 
-    return tensor_norm_dispatch(t, out);
-}
-
-static inline cgrad_error tensor_norm_dispatch(const struct tensor *const t, double *const out)
-{
-    switch (t->dtype)
-    {
-        case DTYPE_FLOAT32:
-            return tensor_norm_f32(t, out);
-        default:
-            return OPERATION_INVALID_TENSOR_DTYPE;
-    }
+    struct tensor *const ts[] = {(struct tensor *)t};
+    return tensor_foreach_norm(ts, 1, out, NULL);
 }
-
-static inline cgrad_error tensor_norm_f32(const struct tensor *const t, double *const out)
-{
-    *out = 0.0f;
-    float* t_data = (float*)t->data;
-    for (size_t i = 0;  i < t->data_size; i++)
-    {
-        *out += (t_data[i] * t_data[i]);
-    }
-
-    return NO_ERROR;
-}
\ No newline at end of file
@@ -0,0 +1,506 @@
+#include "cgrad/tensor/tensor_permute.h"
+#include "cgrad/autograd/backpropagation/backpropagation_context.h"
+#include "cgrad/autograd/computational_graph/computational_graph.h"
+#include "cgrad/autograd/computational_graph/computational_graph_link.h"
+#include "cgrad/utils/simd_support.h"
+#include <stdint.h>
+#include <string.h>
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+#include <immintrin.h>
+#endif
+// Source rows transposed per band, the output lines they write staying in L1 while the band is walked
+// Side of the blocks transposed at once, so that the rows read and the rows written both stay in L1
+#define PERMUTE_BLOCK 32
+
+// Length of the runs copied at once when the innermost axis is not moved
+#define PERMUTE_COPY_BLOCK 4096
+
+typedef enum tensor_permute_operand
+{
+    TENSOR,
+} tensor_permute_operand;
+
+/**
+ * Permutation reduced to the fewest axes: axes of size one are dropped and axes which stay adjacent are merged.
+ * Axes are in the order of the output, which is contiguous.
+ */
+struct permute_plan
+{
+    size_t n_axes;
+    size_t shape[TENSOR_MAX_SHAPE_SIZE];
+    size_t src_stride[TENSOR_MAX_SHAPE_SIZE];
+    size_t dst_stride[TENSOR_MAX_SHAPE_SIZE];
+    size_t row_axis;                     /**< Axis contiguous in the source, the last one if it is not moved. */
+    size_t outer[TENSOR_MAX_SHAPE_SIZE]; /**< Axes iterated around the innermost pair, outermost first. */
+    size_t n_outer;
+    size_t block;    /**< Length of the blocks the last axis is split in. */
+    size_t n_blocks; /**< Blocks per outer index. */
+    size_t elem_size;
+};
+
+struct permute_args
+{
+    const struct permute_plan *plan;
+    const unsigned char *src;
+    unsigned char *dst;
+};
+
+static inline cgrad_error tensor_permute_update_graph(struct tensor *const t, const size_t *const perm, struct tensor **const out, struct cgrad_env *const env);
+static bool tensor_permute_is_valid(const size_t *const perm, const size_t shape_size);
+static void permute_plan_init(struct permute_plan *const plan, const struct tensor *const t, const size_t *const perm, const size_t elem_size);
+static void permute_range(void *arg, const size_t begin, const size_t end);
+static void permute_transpose(const unsigned char *const src, const size_t ld_src, unsigned char *const dst, const size_t ld_dst, const size_t n_x, const size_t n_y, const size_t elem_size);
+static void permute_block_u16(const uint16_t *restrict src, const size_t ld_src, uint16_t *restrict dst, const size_t ld_dst, const size_t n_x, const size_t n_y);
+static void permute_block_f32(const float *restrict src, const size_t ld_src, float *restrict dst, const size_t ld_dst, const size_t n_x, const size_t n_y);
+static void permute_block_f64(const double *restrict src, const size_t ld_src, double *restrict dst, const size_t ld_dst, const size_t n_x, const size_t n_y);
+static cgrad_error tensor_permute_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
+static cgrad_error tensor_permute_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static inline void permute_tile_8x8_f32(const float *restrict src, const size_t ld_src, float *restrict dst, const size_t ld_dst);
+static inline void permute_tile_4x4_f64(const double *restrict src, const size_t ld_src, double *restrict dst, const size_t ld_dst);
+#endif
+
+cgrad_error tensor_permute(struct tensor *const t, const size_t *const perm, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
+{
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (!perm || !tensor_permute_is_valid(perm, t->shape_size))
+    {
+        return TENSOR_PERMUTE_INVALID_AXES;
+    }
+
+    size_t shape[TENSOR_MAX_SHAPE_SIZE];
+    for (size_t i = 0; i < t->shape_size; i++)
+    {
+        shape[i] = t->shape[perm[i]];
+    }
+
+    (*out) = tensor_allocator_alloc(&env->tensor_alloc, shape, t->shape_size, t->dtype);
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    cgrad_error err = tensor_permute_into(t, perm, *out, env->pool);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if (track_grad)
+    {
+        return tensor_permute_update_graph(t, perm, out, env);
+    }
+
+    return NO_ERROR;
+}
+
+static inline cgrad_error tensor_permute_update_graph(struct tensor *const t, const size_t *const perm, struct tensor **const out, struct cgrad_env *const env)
+{
+    cgrad_error err = add_computational_graph_link(t, TENSOR, *out, &tensor_permute_backpropagate, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // One axis per slot, TENSOR_MAX_SHAPE_SIZE does not exceed the size of the context
+    for (size_t i = 0; i < t->shape_size; i++)
+    {
+        err = context_set_operand_size_t(&(*out)->node->ctx, perm[i], i);
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    err = computational_graph_node_set_forward_function((*out)->node, &tensor_permute_forward);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_memory_hints((*out)->node, false, false);
+}
+
+cgrad_error tensor_permute_into(const struct tensor *const t, const size_t *const perm, struct tensor *const out, struct thread_pool *const pool)
+{
+    if (!t || !out)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->data || !out->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (t->dtype != out->dtype)
+    {
+        return TENSOR_DTYPE_MISMATCH;
+    }
+    if (t->shape_size != out->shape_size)
+    {
+        return TENSOR_WRONG_SHAPE;
+    }
+    if (!perm || !tensor_permute_is_valid(perm, t->shape_size))
+    {
+        return TENSOR_PERMUTE_INVALID_AXES;
+    }
+    for (size_t i = 0; i < t->shape_size; i++)
+    {
+        if (out->shape[i] != t->shape[perm[i]])
+        {
+            return TENSOR_SHAPE_MISMATCH;
+        }
+    }
+
+    // Values are only moved, so every dtype of the same size shares a kernel
+    size_t elem_size = 0;
+    switch (t->dtype)
+    {
+    case DTYPE_FLOAT64:
+    case DTYPE_FLOAT32:
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        elem_size = dtype_sizeof(t->dtype);
+        break;
+    default:
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    if (t->data_size == 0)
+    {
+        return NO_ERROR;
+    }
+
+    struct permute_plan plan;
+    permute_plan_init(&plan, t, perm, elem_size);
+
+    const size_t last = plan.n_axes - 1;
+    const size_t block_rows = plan.row_axis == last ? 1 : plan.shape[plan.row_axis];
+    const size_t n_items = t->data_size / (plan.shape[last] * block_rows) * plan.n_blocks;
+
+    struct permute_args args = {.plan = &plan, .src = t->data, .dst = out->data};
+    thread_pool_parallel_for(pool, n_items, thread_pool_grain(plan.block * block_rows), &permute_range, &args);
+
+    return NO_ERROR;
+}
+
+static bool tensor_permute_is_valid(const size_t *const perm, const size_t shape_size)
+{
+    bool seen[TENSOR_MAX_SHAPE_SIZE] = {false};
+    for (size_t i = 0; i < shape_size; i++)
+    {
+        if (perm[i] >= shape_size || seen[perm[i]])
+        {
+            return false;
+        }
+        seen[perm[i]] = true;
+    }
+
+    return true;
+}
+
+static void permute_plan_init(struct permute_plan *const plan, const struct tensor *const t, const size_t *const perm, const size_t elem_size)
+{
+    size_t stride[TENSOR_MAX_SHAPE_SIZE];
+    size_t size = 1;
+    for (size_t i = t->shape_size; i-- > 0;)
+    {
+        stride[i] = size;
+        size *= t->shape[i];
+    }
+
+    plan->n_axes = 0;
+    for (size_t i = 0; i < t->shape_size; i++)
+    {
+        const size_t axis_size = t->shape[perm[i]];
+        const size_t axis_stride = stride[perm[i]];
+        if (axis_size == 1)
+        {
+            continue;
+        }
+
+        // Merged into the previous axis when that one directly encloses it in the source too
+        const size_t prev = plan->n_axes - 1;
+        if (plan->n_axes > 0 && plan->src_stride[prev] == axis_size * axis_stride)
+        {
+            plan->shape[prev] *= axis_size;
+            plan->src_stride[prev] = axis_stride;
+            continue;
+        }
+
+        plan->shape[plan->n_axes] = axis_size;
+        plan->src_stride[plan->n_axes] = axis_stride;
+        plan->n_axes++;
+    }
+
+    if (plan->n_axes == 0)
+    {
+        plan->shape[0] = 1;
+        plan->src_stride[0] = 1;
+        plan->n_axes = 1;
+    }
+
+    size = 1;
+    for (size_t i = plan->n_axes; i-- > 0;)
+    {
+        plan->dst_stride[i] = size;
+        size *= plan->shape[i];
+    }
+
+    const size_t last = plan->n_axes - 1;
+    plan->row_axis = last;
+    for (size_t i = 0; i < plan->n_axes; i++)
+    {
+        if (plan->src_stride[i] == 1)
+        {
+            plan->row_axis = i;
+        }
+    }
+
+    plan->n_outer = 0;
+    for (size_t i = 0; i < last; i++)
+    {
+        if (i != plan->row_axis)
+        {
+            plan->outer[plan->n_outer++] = i;
+        }
+    }
+
+    plan->block = plan->row_axis == last ? PERMUTE_COPY_BLOCK : PERMUTE_BLOCK;
+    plan->n_blocks = (plan->shape[last] + plan->block - 1) / plan->block;
+    plan->elem_size = elem_size;
+}
+
+static void permute_range(void *arg, const size_t begin, const size_t end)
+{
+    const struct permute_args *args = arg;
+    const struct permute_plan *plan = args->plan;
+    const size_t last = plan->n_axes - 1;
+    const size_t elem_size = plan->elem_size;
+
+    // Unravel the outer index of the first item, the following ones are reached incrementally
+    size_t idx[TENSOR_MAX_SHAPE_SIZE];
+    size_t src_offset = 0;
+    size_t dst_offset = 0;
+    size_t remainder = begin / plan->n_blocks;
+    for (size_t i = plan->n_outer; i-- > 0;)
+    {
+        const size_t axis = plan->outer[i];
+        idx[i] = remainder % plan->shape[axis];
+        remainder /= plan->shape[axis];
+        src_offset += idx[i] * plan->src_stride[axis];
+        dst_offset += idx[i] * plan->dst_stride[axis];
+    }
+
+    size_t block = begin % plan->n_blocks;
+    for (size_t item = begin; item < end; item++)
+    {
+        const size_t x_begin = block * plan->block;
+        const size_t n_x = plan->shape[last] - x_begin < plan->block ? plan->shape[last] - x_begin : plan->block;
+        const unsigned char *src = args->src + (src_offset + x_begin * plan->src_stride[last]) * elem_size;
+        unsigned char *dst = args->dst + (dst_offset + x_begin) * elem_size;
+
+        if (plan->row_axis == last)
+        {
+            memcpy(dst, src, n_x * elem_size);
+        }
+        else
+        {
+            permute_transpose(src, plan->src_stride[last], dst, plan->dst_stride[plan->row_axis], n_x, plan->shape[plan->row_axis], elem_size);
+        }
+
+        if (++block < plan->n_blocks)
+        {
+            continue;
+        }
+
+        block = 0;
+        for (size_t i = plan->n_outer; i-- > 0;)
+        {
+            const size_t axis = plan->outer[i];
+            src_offset += plan->src_stride[axis];
+            dst_offset += plan->dst_stride[axis];
+            if (++idx[i] < plan->shape[axis])
+            {
+                break;
+            }
+            src_offset -= plan->shape[axis] * plan->src_stride[axis];
+            dst_offset -= plan->shape[axis] * plan->dst_stride[axis];
+            idx[i] = 0;
+        }
+    }
+}
+
+/**
+ * Computes dst[y * ld_dst + x] = src[x * ld_src + y] for x < n_x and y < n_y, n_x being at most PERMUTE_BLOCK.
+ * The band of source rows is walked whole in tiles, the PERMUTE_BLOCK lines of dst it writes staying in cache.
+ */
+static void permute_transpose(const unsigned char *const src, const size_t ld_src, unsigned char *const dst, const size_t ld_dst, const size_t n_x, const size_t n_y, const size_t elem_size)
+{
+    switch (elem_size)
+    {
+    case sizeof(double):
+        permute_block_f64((const double *)src, ld_src, (double *)dst, ld_dst, n_x, n_y);
+        break;
+    case sizeof(float):
+        permute_block_f32((const float *)src, ld_src, (float *)dst, ld_dst, n_x, n_y);
+        break;
+    default:
+        permute_block_u16((const uint16_t *)src, ld_src, (uint16_t *)dst, ld_dst, n_x, n_y);
+        break;
+    }
+}
+
+static void permute_block_u16(const uint16_t *restrict src, const size_t ld_src, uint16_t *restrict dst, const size_t ld_dst, const size_t n_x, const size_t n_y)
+{
+    for (size_t x = 0; x < n_x; x++)
+    {
+        for (size_t y = 0; y < n_y; y++)
+        {
+            dst[y * ld_dst + x] = src[x * ld_src + y];
+        }
+    }
+}
+
+static void permute_block_f32(const float *restrict src, const size_t ld_src, float *restrict dst, const size_t ld_dst, const size_t n_x, const size_t n_y)
+{
+    size_t x = 0;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    for (; x + 8 <= n_x; x += 8)
+    {
+        size_t y = 0;
+        for (; y + 8 <= n_y; y += 8)
+        {
+            permute_tile_8x8_f32(src + x * ld_src + y, ld_src, dst + y * ld_dst + x, ld_dst);
+        }
+        for (; y < n_y; y++)
+        {
+            for (size_t tile_x = x; tile_x < x + 8; tile_x++)
+            {
+                dst[y * ld_dst + tile_x] = src[tile_x * ld_src + y];
+            }
+        }
+    }
+#endif
+    for (; x < n_x; x++)
+    {
+        for (size_t y = 0; y < n_y; y++)
+        {
+            dst[y * ld_dst + x] = src[x * ld_src + y];
+        }
+    }
+}
+
+static void permute_block_f64(const double *restrict src, const size_t ld_src, double *restrict dst, const size_t ld_dst, const size_t n_x, const size_t n_y)
+{
+    size_t x = 0;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    for (; x + 4 <= n_x; x += 4)
+    {
+        size_t y = 0;
+        for (; y + 4 <= n_y; y += 4)
+        {
+            permute_tile_4x4_f64(src + x * ld_src + y, ld_src, dst + y * ld_dst + x, ld_dst);
+        }
+        for (; y < n_y; y++)
+        {
+            for (size_t tile_x = x; tile_x < x + 4; tile_x++)
+            {
+                dst[y * ld_dst + tile_x] = src[tile_x * ld_src + y];
+            }
+        }
+    }
+#endif
+    for (; x < n_x; x++)
+    {
+        for (size_t y = 0; y < n_y; y++)
+        {
+            dst[y * ld_dst + x] = src[x * ld_src + y];
+        }
+    }
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+static inline void permute_tile_8x8_f32(const float *restrict src, const size_t ld_src, float *restrict dst, const size_t ld_dst)
+{
+    const __m256 r0 = _mm256_loadu_ps(src + 0 * ld_src);
+    const __m256 r1 = _mm256_loadu_ps(src + 1 * ld_src);
+    const __m256 r2 = _mm256_loadu_ps(src + 2 * ld_src);
+    const __m256 r3 = _mm256_loadu_ps(src + 3 * ld_src);
+    const __m256 r4 = _mm256_loadu_ps(src + 4 * ld_src);
+    const __m256 r5 = _mm256_loadu_ps(src + 5 * ld_src);
+    const __m256 r6 = _mm256_loadu_ps(src + 6 * ld_src);
+    const __m256 r7 = _mm256_loadu_ps(src + 7 * ld_src);
+
+    // Interleave pairs of rows, then pairs of pairs, each 128 bit lane holding columns j and j + 4
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    const __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+    const __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+    const __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+    const __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+    const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    _mm256_storeu_ps(dst + 0 * ld_dst, _mm256_permute2f128_ps(s0, s4, 0x20));
+    _mm256_storeu_ps(dst + 1 * ld_dst, _mm256_permute2f128_ps(s1, s5, 0x20));
+    _mm256_storeu_ps(dst + 2 * ld_dst, _mm256_permute2f128_ps(s2, s6, 0x20));
+    _mm256_storeu_ps(dst + 3 * ld_dst, _mm256_permute2f128_ps(s3, s7, 0x20));
+    _mm256_storeu_ps(dst + 4 * ld_dst, _mm256_permute2f128_ps(s0, s4, 0x31));
+    _mm256_storeu_ps(dst + 5 * ld_dst, _mm256_permute2f128_ps(s1, s5, 0x31));
+    _mm256_storeu_ps(dst + 6 * ld_dst, _mm256_permute2f128_ps(s2, s6, 0x31));
+    _mm256_storeu_ps(dst + 7 * ld_dst, _mm256_permute2f128_ps(s3, s7, 0x31));
+}
+
+static inline void permute_tile_4x4_f64(const double *restrict src, const size_t ld_src, double *restrict dst, const size_t ld_dst)
+{
+    const __m256d r0 = _mm256_loadu_pd(src + 0 * ld_src);
+    const __m256d r1 = _mm256_loadu_pd(src + 1 * ld_src);
+    const __m256d r2 = _mm256_loadu_pd(src + 2 * ld_src);
+    const __m256d r3 = _mm256_loadu_pd(src + 3 * ld_src);
+
+    const __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    const __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    const __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    const __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+    _mm256_storeu_pd(dst + 0 * ld_dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(dst + 1 * ld_dst, _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(dst + 2 * ld_dst, _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(dst + 3 * ld_dst, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+#endif
+
+static cgrad_error tensor_permute_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return tensor_permute_into(ctx->operands[TENSOR], ctx->operands_size_t, out, ctx->pool);
+}
+
+static cgrad_error tensor_permute_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    // The gradient is moved back by the inverse permutation
+    size_t inverse[TENSOR_MAX_SHAPE_SIZE];
+    for (size_t i = 0; i < grad_wrt_out->shape_size; i++)
+    {
+        inverse[ctx->operands_size_t[i]] = i;
+    }
+
+    return tensor_permute_into(grad_wrt_out, inverse, grad_wrt_operand, ctx->pool);
+}
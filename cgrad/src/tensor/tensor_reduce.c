@@ -0,0 +1,1197 @@
+#include "cgrad/tensor/tensor_reduce.h"
+#include "cgrad/autograd/backpropagation/backpropagation_context.h"
+#include "cgrad/autograd/computational_graph/computational_graph.h"
+#include "cgrad/autograd/computational_graph/computational_graph_link.h"
+#include "cgrad/utils/half.h"
+#include "cgrad/utils/simd_support.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+#include <immintrin.h>
+#endif
+
+// Elements of the kept innermost axis reduced at once, so that their accumulators stay in L1
+#define REDUCE_COLS 256
+
+// Below this many blocks of outputs the reduced axes are split too, each part reducing about REDUCE_SPLIT_WORK elements
+#define REDUCE_MIN_BLOCKS 16
+#define REDUCE_SPLIT_WORK 65536
+
+typedef enum tensor_reduce_operand
+{
+    TENSOR,
+} tensor_reduce_operand;
+
+typedef enum tensor_reduce_op
+{
+    REDUCE_SUM,
+    REDUCE_MEAN,
+    REDUCE_MAX,
+    REDUCE_ARGMAX,
+} tensor_reduce_op;
+
+/**
+ * Reduction over the fewest axes: axes of size one are dropped and adjacent axes which are both reduced or both
+ * kept are merged. Each block of outputs is a run of at most REDUCE_COLS elements of the innermost kept axis,
+ * computed by accumulating the matching rows of t, or by reducing runs of t if the innermost axis is reduced.
+ */
+struct reduce_plan
+{
+    size_t n_axes;
+    size_t shape[TENSOR_MAX_SHAPE_SIZE];
+    size_t stride[TENSOR_MAX_SHAPE_SIZE];
+    size_t outer[TENSOR_MAX_SHAPE_SIZE];  /**< Kept axes around the innermost one, outermost first. */
+    size_t n_outer_axes;
+    size_t across[TENSOR_MAX_SHAPE_SIZE]; /**< Reduced axes around the innermost one, outermost first. */
+    size_t n_across_axes;
+    size_t inner;        /**< Kept elements contiguous in both t and out, one if the last axis is reduced. */
+    size_t run;          /**< Reduced elements contiguous in t, one if the last axis is kept. */
+    size_t n_outer;      /**< Runs of inner elements of out. */
+    size_t n_reduced;    /**< Elements reduced into each element of out. */
+    size_t cols;         /**< Elements per block of outputs. */
+    size_t n_col_blocks; /**< Blocks per run of inner elements. */
+    size_t split;        /**< Reduced elements per part. */
+    size_t n_splits;     /**< Parts per block, each reduced by a separate item. */
+};
+
+struct reduce_args
+{
+    const struct reduce_plan *plan;
+    tensor_reduce_op op;
+    cgrad_dtype dtype;
+    const void *src;
+    struct tensor *out;
+    size_t *indices;       /**< Written instead of out by REDUCE_ARGMAX if not NULL. */
+    double *partial_values; /**< Results of each item when the reduced axes are split. */
+    size_t *partial_indices;
+};
+
+struct reduce_acc
+{
+    double value[REDUCE_COLS];   /**< Sums of float64 rows, maxima of every dtype. */
+    float sum[REDUCE_COLS];      /**< Kahan sums of float32 and half rows. */
+    float comp[REDUCE_COLS];     /**< Compensations of the Kahan sums. */
+    size_t index[REDUCE_COLS];   /**< Reduced position of the maxima. */
+    float buffer[REDUCE_COLS];   /**< Half values widened to float32. */
+};
+
+struct broadcast_args
+{
+    const struct reduce_plan *plan;
+    cgrad_dtype dtype;
+    const unsigned char *src;
+    unsigned char *dst;
+    double scale;
+};
+
+static cgrad_error tensor_reduce(struct tensor *const t, const size_t *const axes, const size_t n_axes, const bool keepdim, const tensor_reduce_op op, struct tensor **const out, const bool track_grad, struct cgrad_env *const env);
+static inline cgrad_error tensor_reduce_update_graph(struct tensor *const t, const size_t mask, const tensor_reduce_op op, struct tensor **const out, struct cgrad_env *const env);
+static cgrad_error tensor_reduce_into(const struct tensor *const t, const size_t *const axes, const size_t n_axes, const tensor_reduce_op op, struct tensor *const out, struct thread_pool *const pool);
+static bool tensor_reduce_axes_mask(const size_t *const axes, const size_t n_axes, const size_t shape_size, size_t *const mask);
+static bool tensor_reduce_dtype_is_valid(const cgrad_dtype dtype);
+static cgrad_error tensor_reduce_check_shape(const struct tensor *const t, const size_t mask, const struct tensor *const out);
+static cgrad_error tensor_reduce_compute(const struct tensor *const t, const size_t mask, const tensor_reduce_op op, struct tensor *const out, size_t *const indices, struct thread_pool *const pool);
+static void reduce_plan_init(struct reduce_plan *const plan, const size_t *const shape, const size_t shape_size, const size_t mask);
+static void reduce_range(void *arg, const size_t begin, const size_t end);
+static void reduce_combine_range(void *arg, const size_t begin, const size_t end);
+static void reduce_block(const struct reduce_args *const args, const size_t offset, const size_t n_cols, const size_t split, double *const values, size_t *const indices);
+static void reduce_block_runs(const struct reduce_args *const args, const size_t offset, const size_t split, double *const value, size_t *const index);
+static size_t reduce_unravel_reduced(const struct reduce_plan *const plan, const size_t r, size_t *const idx, size_t *const run_pos);
+static void reduce_next_run(const struct reduce_plan *const plan, size_t *const idx, size_t *const offset);
+static void reduce_accumulate_f64(const tensor_reduce_op op, struct reduce_acc *const acc, const double *const src, const size_t n, const size_t r);
+static void reduce_accumulate_f32(const tensor_reduce_op op, struct reduce_acc *const acc, const float *const src, const size_t n, const size_t r);
+static double reduce_run_sum_f64(const double *const src, const size_t n);
+static double reduce_run_sum_f32(const float *const src, const size_t n);
+static void reduce_run_max_f64(const double *const src, const size_t n, const size_t r, double *const max, size_t *const index);
+static void reduce_run_max_f32(const float *const src, const size_t n, const size_t r, double *const max, size_t *const index);
+static void reduce_store(const struct reduce_args *const args, const size_t pos, double *const values, const size_t *const indices, const size_t n);
+static void reduce_store_values(struct tensor *const out, const size_t pos, const double *const values, const size_t n);
+static void reduce_broadcast_range(void *arg, const size_t begin, const size_t end);
+static void reduce_scale_row(const cgrad_dtype dtype, const void *const src, void *const dst, const size_t n, const double scale);
+static size_t reduce_outer_offset(const struct reduce_plan *const plan, size_t o);
+static size_t reduce_reduced_offset(const struct reduce_plan *const plan, size_t r);
+static cgrad_error tensor_reduce_sum_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
+static cgrad_error tensor_reduce_mean_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
+static cgrad_error tensor_reduce_max_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
+static cgrad_error tensor_reduce_sum_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error tensor_reduce_mean_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error tensor_reduce_max_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
+static cgrad_error tensor_reduce_broadcast(const struct tensor *const grad_wrt_out, const size_t mask, const double scale, struct tensor *const grad_wrt_operand, struct thread_pool *const pool);
+
+cgrad_error tensor_reduce_sum(struct tensor *const t, const size_t *const axes, const size_t n_axes, const bool keepdim, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
+{
+    return tensor_reduce(t, axes, n_axes, keepdim, REDUCE_SUM, out, track_grad, env);
+}
+
+cgrad_error tensor_reduce_mean(struct tensor *const t, const size_t *const axes, const size_t n_axes, const bool keepdim, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
+{
+    return tensor_reduce(t, axes, n_axes, keepdim, REDUCE_MEAN, out, track_grad, env);
+}
+
+cgrad_error tensor_reduce_max(struct tensor *const t, const size_t *const axes, const size_t n_axes, const bool keepdim, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
+{
+    return tensor_reduce(t, axes, n_axes, keepdim, REDUCE_MAX, out, track_grad, env);
+}
+
+cgrad_error tensor_reduce_argmax(const struct tensor *const t, const size_t *const axes, const size_t n_axes, const bool keepdim, struct tensor **const out, struct cgrad_env *const env)
+{
+    return tensor_reduce((struct tensor *)t, axes, n_axes, keepdim, REDUCE_ARGMAX, out, false, env);
+}
+
+cgrad_error tensor_reduce_sum_into(const struct tensor *const t, const size_t *const axes, const size_t n_axes, struct tensor *const out, struct thread_pool *const pool)
+{
+    return tensor_reduce_into(t, axes, n_axes, REDUCE_SUM, out, pool);
+}
+
+cgrad_error tensor_reduce_mean_into(const struct tensor *const t, const size_t *const axes, const size_t n_axes, struct tensor *const out, struct thread_pool *const pool)
+{
+    return tensor_reduce_into(t, axes, n_axes, REDUCE_MEAN, out, pool);
+}
+
+cgrad_error tensor_reduce_max_into(const struct tensor *const t, const size_t *const axes, const size_t n_axes, struct tensor *const out, struct thread_pool *const pool)
+{
+    return tensor_reduce_into(t, axes, n_axes, REDUCE_MAX, out, pool);
+}
+
+cgrad_error tensor_reduce_argmax_into(const struct tensor *const t, const size_t *const axes, const size_t n_axes, struct tensor *const out, struct thread_pool *const pool)
+{
+    return tensor_reduce_into(t, axes, n_axes, REDUCE_ARGMAX, out, pool);
+}
+
+static cgrad_error tensor_reduce(struct tensor *const t, const size_t *const axes, const size_t n_axes, const bool keepdim, const tensor_reduce_op op, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
+{
+    if (!t)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (!out)
+    {
+        return OUTPUT_NULL;
+    }
+    if (!env)
+    {
+        return CGRAD_ENV_NULL;
+    }
+    if (!tensor_reduce_dtype_is_valid(t->dtype))
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    size_t mask = 0;
+    if (!tensor_reduce_axes_mask(axes, n_axes, t->shape_size, &mask))
+    {
+        return TENSOR_REDUCE_INVALID_AXES;
+    }
+
+    size_t shape[TENSOR_MAX_SHAPE_SIZE];
+    size_t shape_size = 0;
+    for (size_t i = 0; i < t->shape_size; i++)
+    {
+        if (!(mask & ((size_t)1 << i)))
+        {
+            shape[shape_size++] = t->shape[i];
+        }
+        else if (keepdim)
+        {
+            shape[shape_size++] = 1;
+        }
+    }
+    if (shape_size == 0)
+    {
+        shape[shape_size++] = 1;
+    }
+
+    const cgrad_dtype out_dtype = op == REDUCE_ARGMAX ? DTYPE_INT32 : t->dtype;
+    (*out) = tensor_allocator_alloc(&env->tensor_alloc, shape, shape_size, out_dtype);
+    if (!(*out))
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    cgrad_error err = tensor_reduce_compute(t, mask, op, *out, NULL, env->pool);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    if (track_grad && op != REDUCE_ARGMAX)
+    {
+        return tensor_reduce_update_graph(t, mask, op, out, env);
+    }
+
+    return NO_ERROR;
+}
+
+static inline cgrad_error tensor_reduce_update_graph(struct tensor *const t, const size_t mask, const tensor_reduce_op op, struct tensor **const out, struct cgrad_env *const env)
+{
+    backpropagation_function backpropagate = &tensor_reduce_sum_backpropagate;
+    forward_function forward = &tensor_reduce_sum_forward;
+    if (op == REDUCE_MEAN)
+    {
+        backpropagate = &tensor_reduce_mean_backpropagate;
+        forward = &tensor_reduce_mean_forward;
+    }
+    else if (op == REDUCE_MAX)
+    {
+        backpropagate = &tensor_reduce_max_backpropagate;
+        forward = &tensor_reduce_max_forward;
+    }
+
+    cgrad_error err = add_computational_graph_link(t, TENSOR, *out, backpropagate, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // The reduced axes as a bit mask, TENSOR_MAX_SHAPE_SIZE bits fitting in a size_t
+    err = context_set_operand_size_t(&(*out)->node->ctx, mask, 0);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = computational_graph_node_set_forward_function((*out)->node, forward);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Only the maximum looks back at the operand to route the gradient
+    return computational_graph_node_set_memory_hints((*out)->node, op == REDUCE_MAX, false);
+}
+
+static cgrad_error tensor_reduce_into(const struct tensor *const t, const size_t *const axes, const size_t n_axes, const tensor_reduce_op op, struct tensor *const out, struct thread_pool *const pool)
+{
+    if (!t || !out)
+    {
+        return TENSOR_NULL;
+    }
+    if (!t->data || !out->data)
+    {
+        return TENSOR_DATA_NULL;
+    }
+    if (!tensor_reduce_dtype_is_valid(t->dtype))
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+    if (out->dtype != (op == REDUCE_ARGMAX ? DTYPE_INT32 : t->dtype))
+    {
+        return TENSOR_DTYPE_MISMATCH;
+    }
+
+    size_t mask = 0;
+    if (!tensor_reduce_axes_mask(axes, n_axes, t->shape_size, &mask))
+    {
+        return TENSOR_REDUCE_INVALID_AXES;
+    }
+
+    cgrad_error err = tensor_reduce_check_shape(t, mask, out);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return tensor_reduce_compute(t, mask, op, out, NULL, pool);
+}
+
+static bool tensor_reduce_axes_mask(const size_t *const axes, const size_t n_axes, const size_t shape_size, size_t *const mask)
+{
+    if (!axes || n_axes == 0)
+    {
+        return false;
+    }
+
+    *mask = 0;
+    for (size_t i = 0; i < n_axes; i++)
+    {
+        if (axes[i] >= shape_size || (*mask & ((size_t)1 << axes[i])))
+        {
+            return false;
+        }
+        *mask |= (size_t)1 << axes[i];
+    }
+
+    return true;
+}
+
+static bool tensor_reduce_dtype_is_valid(const cgrad_dtype dtype)
+{
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+    case DTYPE_FLOAT32:
+    case DTYPE_BFLOAT16:
+    case DTYPE_FLOAT16:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static cgrad_error tensor_reduce_check_shape(const struct tensor *const t, const size_t mask, const struct tensor *const out)
+{
+    // The reduced axes either stay with size one, or are removed
+    if (out->shape_size == t->shape_size)
+    {
+        for (size_t i = 0; i < t->shape_size; i++)
+        {
+            const size_t expected = mask & ((size_t)1 << i) ? 1 : t->shape[i];
+            if (out->shape[i] != expected)
+            {
+                return TENSOR_SHAPE_MISMATCH;
+            }
+        }
+
+        return NO_ERROR;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < t->shape_size; i++)
+    {
+        if (mask & ((size_t)1 << i))
+        {
+            continue;
+        }
+        if (kept >= out->shape_size || out->shape[kept] != t->shape[i])
+        {
+            return TENSOR_SHAPE_MISMATCH;
+        }
+        kept++;
+    }
+
+    if (kept == 0)
+    {
+        return out->shape_size == 1 && out->shape[0] == 1 ? NO_ERROR : TENSOR_SHAPE_MISMATCH;
+    }
+
+    return kept == out->shape_size ? NO_ERROR : TENSOR_SHAPE_MISMATCH;
+}
+
+static cgrad_error tensor_reduce_compute(const struct tensor *const t, const size_t mask, const tensor_reduce_op op, struct tensor *const out, size_t *const indices, struct thread_pool *const pool)
+{
+    struct reduce_plan plan;
+    reduce_plan_init(&plan, t->shape, t->shape_size, mask);
+
+    const size_t n_blocks = plan.n_outer * plan.n_col_blocks;
+    if (n_blocks == 0)
+    {
+        return NO_ERROR;
+    }
+
+    struct reduce_args args = {.plan = &plan, .op = op, .dtype = t->dtype, .src = t->data, .out = out, .indices = indices, .partial_values = NULL, .partial_indices = NULL};
+    if (plan.n_splits > 1)
+    {
+        args.partial_values = malloc(n_blocks * plan.n_splits * plan.cols * sizeof(double));
+        args.partial_indices = malloc(n_blocks * plan.n_splits * plan.cols * sizeof(size_t));
+        if (!args.partial_values || !args.partial_indices)
+        {
+            free(args.partial_values);
+            free(args.partial_indices);
+            return TENSOR_ALLOCATION_FAILED;
+        }
+    }
+
+    thread_pool_parallel_for(pool, n_blocks * plan.n_splits, thread_pool_grain(plan.cols * plan.split), &reduce_range, &args);
+
+    // The parts are combined in order, so that the result does not depend on the number of threads
+    if (plan.n_splits > 1)
+    {
+        thread_pool_parallel_for(pool, n_blocks, thread_pool_grain(plan.cols * plan.n_splits), &reduce_combine_range, &args);
+        free(args.partial_values);
+        free(args.partial_indices);
+    }
+
+    return NO_ERROR;
+}
+
+static void reduce_plan_init(struct reduce_plan *const plan, const size_t *const shape, const size_t shape_size, const size_t mask)
+{
+    bool reduced[TENSOR_MAX_SHAPE_SIZE];
+    plan->n_axes = 0;
+    for (size_t i = 0; i < shape_size; i++)
+    {
+        if (shape[i] == 1)
+        {
+            continue;
+        }
+
+        const bool is_reduced = mask & ((size_t)1 << i);
+        if (plan->n_axes > 0 && reduced[plan->n_axes - 1] == is_reduced)
+        {
+            plan->shape[plan->n_axes - 1] *= shape[i];
+            continue;
+        }
+
+        plan->shape[plan->n_axes] = shape[i];
+        reduced[plan->n_axes] = is_reduced;
+        plan->n_axes++;
+    }
+    if (plan->n_axes == 0)
+    {
+        plan->shape[0] = 1;
+        reduced[0] = false;
+        plan->n_axes = 1;
+    }
+
+    size_t stride = 1;
+    for (size_t i = plan->n_axes; i-- > 0;)
+    {
+        plan->stride[i] = stride;
+        stride *= plan->shape[i];
+    }
+
+    const size_t last = plan->n_axes - 1;
+    plan->inner = reduced[last] ? 1 : plan->shape[last];
+    plan->run = reduced[last] ? plan->shape[last] : 1;
+    plan->n_outer_axes = 0;
+    plan->n_across_axes = 0;
+    plan->n_outer = 1;
+    plan->n_reduced = plan->run;
+    for (size_t i = 0; i < last; i++)
+    {
+        if (reduced[i])
+        {
+            plan->across[plan->n_across_axes++] = i;
+            plan->n_reduced *= plan->shape[i];
+        }
+        else
+        {
+            plan->outer[plan->n_outer_axes++] = i;
+            plan->n_outer *= plan->shape[i];
+        }
+    }
+
+    plan->cols = plan->inner < REDUCE_COLS ? plan->inner : REDUCE_COLS;
+    plan->n_col_blocks = (plan->inner + REDUCE_COLS - 1) / REDUCE_COLS;
+
+    plan->split = plan->n_reduced;
+    plan->n_splits = 1;
+    if (plan->n_outer * plan->n_col_blocks < REDUCE_MIN_BLOCKS && plan->n_reduced * plan->cols > 2 * REDUCE_SPLIT_WORK)
+    {
+        plan->split = REDUCE_SPLIT_WORK / plan->cols;
+        plan->n_splits = (plan->n_reduced + plan->split - 1) / plan->split;
+    }
+}
+
+static void reduce_range(void *arg, const size_t begin, const size_t end)
+{
+    const struct reduce_args *args = arg;
+    const struct reduce_plan *plan = args->plan;
+
+    // Unravel the first run of outputs once, the next ones are reached incrementally
+    size_t split = begin % plan->n_splits;
+    size_t col_block = begin / plan->n_splits % plan->n_col_blocks;
+    size_t o = begin / (plan->n_splits * plan->n_col_blocks);
+    size_t idx[TENSOR_MAX_SHAPE_SIZE];
+    size_t offset = 0;
+    size_t remainder = o;
+    for (size_t i = plan->n_outer_axes; i-- > 0;)
+    {
+        const size_t axis = plan->outer[i];
+        idx[i] = remainder % plan->shape[axis];
+        remainder /= plan->shape[axis];
+        offset += idx[i] * plan->stride[axis];
+    }
+
+    // Outputs reduced from runs are single elements, stored together
+    const bool gather = plan->inner == 1 && plan->n_splits == 1;
+    size_t pending = 0;
+    double values[REDUCE_COLS];
+    size_t indices[REDUCE_COLS];
+    for (size_t item = begin; item < end; item++)
+    {
+        const size_t col_begin = col_block * REDUCE_COLS;
+        const size_t n_cols = plan->inner - col_begin < REDUCE_COLS ? plan->inner - col_begin : REDUCE_COLS;
+        reduce_block(args, offset + col_begin, n_cols, split, values + pending, indices + pending);
+
+        if (gather)
+        {
+            if (++pending == REDUCE_COLS)
+            {
+                reduce_store(args, o + 1 - pending, values, indices, pending);
+                pending = 0;
+            }
+        }
+        else if (plan->n_splits == 1)
+        {
+            reduce_store(args, o * plan->inner + col_begin, values, indices, n_cols);
+        }
+        else
+        {
+            memcpy(args->partial_values + item * plan->cols, values, n_cols * sizeof(double));
+            memcpy(args->partial_indices + item * plan->cols, indices, n_cols * sizeof(size_t));
+        }
+
+        if (++split < plan->n_splits)
+        {
+            continue;
+        }
+        split = 0;
+        if (++col_block < plan->n_col_blocks)
+        {
+            continue;
+        }
+        col_block = 0;
+        o++;
+
+        for (size_t i = plan->n_outer_axes; i-- > 0;)
+        {
+            const size_t axis = plan->outer[i];
+            offset += plan->stride[axis];
+            if (++idx[i] < plan->shape[axis])
+            {
+                break;
+            }
+            offset -= plan->shape[axis] * plan->stride[axis];
+            idx[i] = 0;
+        }
+    }
+
+    if (pending > 0)
+    {
+        reduce_store(args, o - pending, values, indices, pending);
+    }
+}
+
+static void reduce_combine_range(void *arg, const size_t begin, const size_t end)
+{
+    const struct reduce_args *args = arg;
+    const struct reduce_plan *plan = args->plan;
+    const bool is_max = args->op == REDUCE_MAX || args->op == REDUCE_ARGMAX;
+
+    double values[REDUCE_COLS];
+    size_t indices[REDUCE_COLS];
+    for (size_t block = begin; block < end; block++)
+    {
+        const size_t col_begin = block % plan->n_col_blocks * REDUCE_COLS;
+        const size_t n_cols = plan->inner - col_begin < REDUCE_COLS ? plan->inner - col_begin : REDUCE_COLS;
+        const double *partial_values = args->partial_values + block * plan->n_splits * plan->cols;
+        const size_t *partial_indices = args->partial_indices + block * plan->n_splits * plan->cols;
+
+        memcpy(values, partial_values, n_cols * sizeof(double));
+        memcpy(indices, partial_indices, n_cols * sizeof(size_t));
+        for (size_t s = 1; s < plan->n_splits; s++)
+        {
+            const double *part = partial_values + s * plan->cols;
+            for (size_t i = 0; i < n_cols; i++)
+            {
+                if (!is_max)
+                {
+                    values[i] += part[i];
+                }
+                else if (part[i] > values[i])
+                {
+                    // Later parts only win on a strictly greater value, keeping the first maximum
+                    values[i] = part[i];
+                    indices[i] = partial_indices[s * plan->cols + i];
+                }
+            }
+        }
+
+        reduce_store(args, block / plan->n_col_blocks * plan->inner + col_begin, values, indices, n_cols);
+    }
+}
+
+static void reduce_block(const struct reduce_args *const args, const size_t offset, const size_t n_cols, const size_t split, double *const values, size_t *const indices)
+{
+    const struct reduce_plan *plan = args->plan;
+    if (plan->inner == 1)
+    {
+        reduce_block_runs(args, offset, split, values, indices);
+        return;
+    }
+
+    const bool is_max = args->op == REDUCE_MAX || args->op == REDUCE_ARGMAX;
+    struct reduce_acc acc;
+    for (size_t i = 0; i < n_cols; i++)
+    {
+        acc.value[i] = is_max ? -INFINITY : 0.0;
+        acc.sum[i] = 0.0f;
+        acc.comp[i] = 0.0f;
+        acc.index[i] = 0;
+    }
+
+    const size_t r_begin = split * plan->split;
+    const size_t r_end = plan->n_reduced - r_begin < plan->split ? plan->n_reduced : r_begin + plan->split;
+
+    // Unravel the first reduced position once, then walk the rows in order
+    size_t idx[TENSOR_MAX_SHAPE_SIZE];
+    size_t run_pos = 0;
+    size_t row_offset = offset + reduce_unravel_reduced(plan, r_begin, idx, &run_pos);
+    for (size_t r = r_begin; r < r_end; r++)
+    {
+        switch (args->dtype)
+        {
+        case DTYPE_FLOAT64:
+            reduce_accumulate_f64(args->op, &acc, (const double *)args->src + row_offset, n_cols, r);
+            break;
+        case DTYPE_FLOAT32:
+            reduce_accumulate_f32(args->op, &acc, (const float *)args->src + row_offset, n_cols, r);
+            break;
+        default:
+            // Widened to float32, then reduced as such
+            half_to_f32_array((const uint16_t *)args->src + row_offset, acc.buffer, n_cols, args->dtype);
+            reduce_accumulate_f32(args->op, &acc, acc.buffer, n_cols, r);
+            break;
+        }
+
+        reduce_next_run(plan, idx, &row_offset);
+    }
+
+    for (size_t i = 0; i < n_cols; i++)
+    {
+        values[i] = is_max ? acc.value[i] : acc.value[i] + ((double)acc.sum[i] - (double)acc.comp[i]);
+        indices[i] = acc.index[i];
+    }
+}
+
+static void reduce_block_runs(const struct reduce_args *const args, const size_t offset, const size_t split, double *const value, size_t *const index)
+{
+    const struct reduce_plan *plan = args->plan;
+    const bool is_max = args->op == REDUCE_MAX || args->op == REDUCE_ARGMAX;
+    *value = is_max ? -INFINITY : 0.0;
+    *index = 0;
+
+    const size_t r_begin = split * plan->split;
+    const size_t r_end = plan->n_reduced - r_begin < plan->split ? plan->n_reduced : r_begin + plan->split;
+
+    size_t idx[TENSOR_MAX_SHAPE_SIZE];
+    size_t run_pos = 0;
+    size_t run_offset = offset + reduce_unravel_reduced(plan, r_begin, idx, &run_pos);
+    for (size_t r = r_begin; r < r_end;)
+    {
+        // The part of the run left, or of the split
+        const size_t n = plan->run - run_pos < r_end - r ? plan->run - run_pos : r_end - r;
+        const size_t src_offset = run_offset + run_pos;
+
+        switch (args->dtype)
+        {
+        case DTYPE_FLOAT64:
+            if (is_max)
+            {
+                reduce_run_max_f64((const double *)args->src + src_offset, n, r, value, index);
+            }
+            else
+            {
+                *value += reduce_run_sum_f64((const double *)args->src + src_offset, n);
+            }
+            break;
+        case DTYPE_FLOAT32:
+            if (is_max)
+            {
+                reduce_run_max_f32((const float *)args->src + src_offset, n, r, value, index);
+            }
+            else
+            {
+                *value += reduce_run_sum_f32((const float *)args->src + src_offset, n);
+            }
+            break;
+        default:
+        {
+            // Widened to float32 in pieces, then reduced as such
+            float buffer[REDUCE_COLS];
+            for (size_t done = 0; done < n; done += REDUCE_COLS)
+            {
+                const size_t len = n - done < REDUCE_COLS ? n - done : REDUCE_COLS;
+                half_to_f32_array((const uint16_t *)args->src + src_offset + done, buffer, len, args->dtype);
+                if (is_max)
+                {
+                    reduce_run_max_f32(buffer, len, r + done, value, index);
+                }
+                else
+                {
+                    *value += reduce_run_sum_f32(buffer, len);
+                }
+            }
+            break;
+        }
+        }
+
+        r += n;
+        run_pos += n;
+        if (run_pos == plan->run)
+        {
+            run_pos = 0;
+            reduce_next_run(plan, idx, &run_offset);
+        }
+    }
+}
+
+static size_t reduce_unravel_reduced(const struct reduce_plan *const plan, const size_t r, size_t *const idx, size_t *const run_pos)
+{
+    // Most blocks start from the first position, without dividing
+    if (r == 0 || plan->run == 0)
+    {
+        for (size_t i = 0; i < plan->n_across_axes; i++)
+        {
+            idx[i] = 0;
+        }
+        *run_pos = 0;
+        return 0;
+    }
+
+    size_t offset = 0;
+    size_t remainder = r / plan->run;
+    *run_pos = r % plan->run;
+    for (size_t i = plan->n_across_axes; i-- > 0;)
+    {
+        const size_t axis = plan->across[i];
+        idx[i] = remainder % plan->shape[axis];
+        remainder /= plan->shape[axis];
+        offset += idx[i] * plan->stride[axis];
+    }
+
+    return offset;
+}
+
+static void reduce_next_run(const struct reduce_plan *const plan, size_t *const idx, size_t *const offset)
+{
+    for (size_t i = plan->n_across_axes; i-- > 0;)
+    {
+        const size_t axis = plan->across[i];
+        *offset += plan->stride[axis];
+        if (++idx[i] < plan->shape[axis])
+        {
+            return;
+        }
+        *offset -= plan->shape[axis] * plan->stride[axis];
+        idx[i] = 0;
+    }
+}
+
+static void reduce_accumulate_f64(const tensor_reduce_op op, struct reduce_acc *const acc, const double *const src, const size_t n, const size_t r)
+{
+    if (op == REDUCE_MAX || op == REDUCE_ARGMAX)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            if (src[i] > acc->value[i])
+            {
+                acc->value[i] = src[i];
+                acc->index[i] = r;
+            }
+        }
+        return;
+    }
+
+    double *restrict value = acc->value;
+    for (size_t i = 0; i < n; i++)
+    {
+        value[i] += src[i];
+    }
+}
+
+static void reduce_accumulate_f32(const tensor_reduce_op op, struct reduce_acc *const acc, const float *const src, const size_t n, const size_t r)
+{
+    if (op == REDUCE_MAX || op == REDUCE_ARGMAX)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            if (src[i] > acc->value[i])
+            {
+                acc->value[i] = src[i];
+                acc->index[i] = r;
+            }
+        }
+        return;
+    }
+
+    // Kahan summation, one compensation per column
+    float *restrict sum = acc->sum;
+    float *restrict comp = acc->comp;
+    for (size_t i = 0; i < n; i++)
+    {
+        const float y = src[i] - comp[i];
+        const float t = sum[i] + y;
+        comp[i] = (t - sum[i]) - y;
+        sum[i] = t;
+    }
+}
+
+static double reduce_run_sum_f64(const double *const src, const size_t n)
+{
+    size_t i = 0;
+    double sum = 0.0;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    for (; i + 16 <= n; i += 16)
+    {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(src + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(src + i + 4));
+        acc2 = _mm256_add_pd(acc2, _mm256_loadu_pd(src + i + 8));
+        acc3 = _mm256_add_pd(acc3, _mm256_loadu_pd(src + i + 12));
+    }
+    const __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+    const __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+#endif
+    double sum_odd = 0.0;
+    for (; i + 2 <= n; i += 2)
+    {
+        sum += src[i];
+        sum_odd += src[i + 1];
+    }
+    if (i < n)
+    {
+        sum += src[i];
+    }
+
+    return sum + sum_odd;
+}
+
+static double reduce_run_sum_f32(const float *const src, const size_t n)
+{
+    size_t i = 0;
+    double sum = 0.0;
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    // Two independent Kahan sums of 8 lanes, hiding the latency of the compensation
+    if (n >= 16)
+    {
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        __m256 comp0 = _mm256_setzero_ps();
+        __m256 comp1 = _mm256_setzero_ps();
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m256 y0 = _mm256_sub_ps(_mm256_loadu_ps(src + i), comp0);
+            const __m256 y1 = _mm256_sub_ps(_mm256_loadu_ps(src + i + 8), comp1);
+            const __m256 t0 = _mm256_add_ps(sum0, y0);
+            const __m256 t1 = _mm256_add_ps(sum1, y1);
+            comp0 = _mm256_sub_ps(_mm256_sub_ps(t0, sum0), y0);
+            comp1 = _mm256_sub_ps(_mm256_sub_ps(t1, sum1), y1);
+            sum0 = t0;
+            sum1 = t1;
+        }
+
+        // The lanes are added in float64
+        const __m256 lanes0 = _mm256_sub_ps(sum0, comp0);
+        const __m256 lanes1 = _mm256_sub_ps(sum1, comp1);
+        const __m256d acc = _mm256_add_pd(_mm256_add_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(lanes0)), _mm256_cvtps_pd(_mm256_extractf128_ps(lanes0, 1))),
+                                          _mm256_add_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(lanes1)), _mm256_cvtps_pd(_mm256_extractf128_ps(lanes1, 1))));
+        const __m128d half = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+        sum = _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    }
+#endif
+    // The few values left are added in float64, exact enough without the latency of the compensation
+    double sum_odd = 0.0;
+    for (; i + 2 <= n; i += 2)
+    {
+        sum += src[i];
+        sum_odd += src[i + 1];
+    }
+    if (i < n)
+    {
+        sum += src[i];
+    }
+
+    return sum + sum_odd;
+}
+
+static void reduce_run_max_f64(const double *const src, const size_t n, const size_t r, double *const max, size_t *const index)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (src[i] > *max)
+        {
+            *max = src[i];
+            *index = r + i;
+        }
+    }
+}
+
+static void reduce_run_max_f32(const float *const src, const size_t n, const size_t r, double *const max, size_t *const index)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (src[i] > *max)
+        {
+            *max = src[i];
+            *index = r + i;
+        }
+    }
+}
+
+static void reduce_store(const struct reduce_args *const args, const size_t pos, double *const values, const size_t *const indices, const size_t n)
+{
+    switch (args->op)
+    {
+    case REDUCE_ARGMAX:
+        if (args->indices)
+        {
+            memcpy(args->indices + pos, indices, n * sizeof(size_t));
+            return;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            ((int32_t *)args->out->data)[pos + i] = (int32_t)indices[i];
+        }
+        return;
+    case REDUCE_MEAN:
+        for (size_t i = 0; i < n; i++)
+        {
+            values[i] /= (double)args->plan->n_reduced;
+        }
+        break;
+    default:
+        break;
+    }
+
+    reduce_store_values(args->out, pos, values, n);
+}
+
+static void reduce_store_values(struct tensor *const out, const size_t pos, const double *const values, const size_t n)
+{
+    switch (out->dtype)
+    {
+    case DTYPE_FLOAT64:
+        memcpy((double *)out->data + pos, values, n * sizeof(double));
+        break;
+    case DTYPE_FLOAT32:
+        for (size_t i = 0; i < n; i++)
+        {
+            ((float *)out->data)[pos + i] = (float)values[i];
+        }
+        break;
+    case DTYPE_BFLOAT16:
+        for (size_t i = 0; i < n; i++)
+        {
+            ((uint16_t *)out->data)[pos + i] = f32_to_bf16((float)values[i]);
+        }
+        break;
+    case DTYPE_FLOAT16:
+        for (size_t i = 0; i < n; i++)
+        {
+            ((uint16_t *)out->data)[pos + i] = f32_to_f16((float)values[i]);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static cgrad_error tensor_reduce_sum_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return tensor_reduce_compute(ctx->operands[TENSOR], ctx->operands_size_t[0], REDUCE_SUM, out, NULL, ctx->pool);
+}
+
+static cgrad_error tensor_reduce_mean_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return tensor_reduce_compute(ctx->operands[TENSOR], ctx->operands_size_t[0], REDUCE_MEAN, out, NULL, ctx->pool);
+}
+
+static cgrad_error tensor_reduce_max_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return tensor_reduce_compute(ctx->operands[TENSOR], ctx->operands_size_t[0], REDUCE_MAX, out, NULL, ctx->pool);
+}
+
+static cgrad_error tensor_reduce_sum_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    return tensor_reduce_broadcast(grad_wrt_out, ctx->operands_size_t[0], 1.0, grad_wrt_operand, ctx->pool);
+}
+
+static cgrad_error tensor_reduce_mean_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    size_t n_reduced = 1;
+    for (size_t i = 0; i < grad_wrt_operand->shape_size; i++)
+    {
+        if (ctx->operands_size_t[0] & ((size_t)1 << i))
+        {
+            n_reduced *= grad_wrt_operand->shape[i];
+        }
+    }
+
+    return tensor_reduce_broadcast(grad_wrt_out, ctx->operands_size_t[0], 1.0 / n_reduced, grad_wrt_operand, ctx->pool);
+}
+
+static cgrad_error tensor_reduce_max_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
+{
+    const struct tensor *t = ctx->operands[TENSOR];
+    const size_t mask = ctx->operands_size_t[0];
+
+    // The gradient flows to the first maximum, found again rather than kept since the forward pass
+    size_t *indices = malloc(grad_wrt_out->data_size * sizeof(size_t));
+    if (!indices)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    cgrad_error err = tensor_reduce_compute(t, mask, REDUCE_ARGMAX, NULL, indices, ctx->pool);
+    if (err != NO_ERROR)
+    {
+        free(indices);
+        return err;
+    }
+
+    struct reduce_plan plan;
+    reduce_plan_init(&plan, t->shape, t->shape_size, mask);
+
+    const size_t elem_size = dtype_sizeof(grad_wrt_operand->dtype);
+    const unsigned char *src = grad_wrt_out->data;
+    unsigned char *dst = grad_wrt_operand->data;
+    memset(dst, 0, grad_wrt_operand->data_size * elem_size);
+    for (size_t o = 0; o < plan.n_outer; o++)
+    {
+        const size_t offset = reduce_outer_offset(&plan, o);
+        for (size_t col = 0; col < plan.inner; col++)
+        {
+            const size_t pos = o * plan.inner + col;
+            const size_t t_offset = offset + col + reduce_reduced_offset(&plan, indices[pos]);
+            memcpy(dst + t_offset * elem_size, src + pos * elem_size, elem_size);
+        }
+    }
+
+    free(indices);
+    return NO_ERROR;
+}
+
+static cgrad_error tensor_reduce_broadcast(const struct tensor *const grad_wrt_out, const size_t mask, const double scale, struct tensor *const grad_wrt_operand, struct thread_pool *const pool)
+{
+    struct reduce_plan plan;
+    reduce_plan_init(&plan, grad_wrt_operand->shape, grad_wrt_operand->shape_size, mask);
+
+    // Every output is copied back over its reduced elements, without splitting them
+    plan.split = plan.n_reduced;
+    plan.n_splits = 1;
+
+    struct broadcast_args args = {.plan = &plan, .dtype = grad_wrt_operand->dtype, .src = grad_wrt_out->data, .dst = grad_wrt_operand->data, .scale = scale};
+    thread_pool_parallel_for(pool, plan.n_outer * plan.n_col_blocks, thread_pool_grain(plan.cols * plan.n_reduced), &reduce_broadcast_range, &args);
+
+    return NO_ERROR;
+}
+
+static void reduce_broadcast_range(void *arg, const size_t begin, const size_t end)
+{
+    const struct broadcast_args *args = arg;
+    const struct reduce_plan *plan = args->plan;
+    const size_t elem_size = dtype_sizeof(args->dtype);
+
+    // Scaled values, converted once and copied over each row or run
+    double row[REDUCE_COLS];
+    for (size_t block = begin; block < end; block++)
+    {
+        const size_t o = block / plan->n_col_blocks;
+        const size_t col_begin = block % plan->n_col_blocks * REDUCE_COLS;
+        const size_t n_cols = plan->inner - col_begin < REDUCE_COLS ? plan->inner - col_begin : REDUCE_COLS;
+        const unsigned char *src = args->src + (o * plan->inner + col_begin) * elem_size;
+
+        if (plan->inner > 1)
+        {
+            reduce_scale_row(args->dtype, src, row, n_cols, args->scale);
+        }
+        else
+        {
+            unsigned char value[sizeof(double)];
+            reduce_scale_row(args->dtype, src, value, 1, args->scale);
+            for (size_t i = 0; i < REDUCE_COLS; i++)
+            {
+                memcpy((unsigned char *)row + i * elem_size, value, elem_size);
+            }
+        }
+
+        size_t offset = reduce_outer_offset(plan, o) + col_begin;
+        size_t idx[TENSOR_MAX_SHAPE_SIZE] = {0};
+        for (size_t r = 0; r < plan->n_reduced; r += plan->run)
+        {
+            if (plan->inner > 1)
+            {
+                memcpy(args->dst + offset * elem_size, row, n_cols * elem_size);
+            }
+            else
+            {
+                for (size_t done = 0; done < plan->run; done += REDUCE_COLS)
+                {
+                    const size_t len = plan->run - done < REDUCE_COLS ? plan->run - done : REDUCE_COLS;
+                    memcpy(args->dst + (offset + done) * elem_size, row, len * elem_size);
+                }
+            }
+
+            for (size_t i = plan->n_across_axes; i-- > 0;)
+            {
+                const size_t axis = plan->across[i];
+                offset += plan->stride[axis];
+                if (++idx[i] < plan->shape[axis])
+                {
+                    break;
+                }
+                offset -= plan->shape[axis] * plan->stride[axis];
+                idx[i] = 0;
+            }
+        }
+    }
+}
+
+static void reduce_scale_row(const cgrad_dtype dtype, const void *const src, void *const dst, const size_t n, const double scale)
+{
+    if (scale == 1.0)
+    {
+        memcpy(dst, src, n * dtype_sizeof(dtype));
+        return;
+    }
+
+    switch (dtype)
+    {
+    case DTYPE_FLOAT64:
+        for (size_t i = 0; i < n; i++)
+        {
+            ((double *)dst)[i] = ((const double *)src)[i] * scale;
+        }
+        break;
+    case DTYPE_FLOAT32:
+        for (size_t i = 0; i < n; i++)
+        {
+            ((float *)dst)[i] = (float)(((const float *)src)[i] * scale);
+        }
+        break;
+    case DTYPE_BFLOAT16:
+        for (size_t i = 0; i < n; i++)
+        {
+            ((uint16_t *)dst)[i] = f32_to_bf16((float)(bf16_to_f32(((const uint16_t *)src)[i]) * scale));
+        }
+        break;
+    case DTYPE_FLOAT16:
+        for (size_t i = 0; i < n; i++)
+        {
+            ((uint16_t *)dst)[i] = f32_to_f16((float)(f16_to_f32(((const uint16_t *)src)[i]) * scale));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static size_t reduce_outer_offset(const struct reduce_plan *const plan, size_t o)
+{
+    size_t offset = 0;
+    for (size_t i = plan->n_outer_axes; i-- > 0;)
+    {
+        const size_t axis = plan->outer[i];
+        offset += o % plan->shape[axis] * plan->stride[axis];
+        o /= plan->shape[axis];
+    }
+
+    return offset;
+}
+
+static size_t reduce_reduced_offset(const struct reduce_plan *const plan, size_t r)
+{
+    size_t offset = r % plan->run;
+    r /= plan->run;
+    for (size_t i = plan->n_across_axes; i-- > 0;)
+    {
+        const size_t axis = plan->across[i];
+        offset += r % plan->shape[axis] * plan->stride[axis];
+        r /= plan->shape[axis];
+    }
+
+    return offset;
+}
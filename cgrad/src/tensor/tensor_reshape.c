@@ -16,6 +16,7 @@ typedef enum tensor_reshape_operand_size_t
     
 static inline cgrad_error tensor_reshape_update_graph(struct tensor *const t, const size_t *shape, const size_t shape_size, struct tensor *const out, struct cgrad_env *const env);
 static inline cgrad_error tensor_reshape_dispatch(const struct tensor *const t, const size_t *shape, const size_t shape_size, struct tensor *const out);
+static cgrad_error tensor_reshape_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
 static cgrad_error tensor_reshape_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 
 cgrad_error tensor_reshape(struct tensor *const t, const size_t *shape, const size_t shape_size, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
@@ -62,7 +63,11 @@ cgrad_error tensor_reshape(struct tensor *const t, const size_t *shape, const si
 
 static inline cgrad_error tensor_reshape_dispatch(const struct tensor *const t, const size_t *shape, const size_t shape_size, struct tensor *const out)
 {
-    memcpy(out->data, t->data, t->data_size * dtype_sizeof(t->dtype));
+    // The memory planner may assign the same buffer to the input and the output
+    if (out->data != t->data)
+    {
+        memcpy(out->data, t->data, t->data_size * dtype_sizeof(t->dtype));
+    }
     return NO_ERROR;
 }
 
@@ -95,7 +100,13 @@ static inline cgrad_error tensor_reshape_update_graph(struct tensor *const t, co
         }
     }
 
-    return NO_ERROR;
+    err = computational_graph_node_set_forward_function(out->node, &tensor_reshape_forward);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_memory_hints(out->node, false, true);
 }
 
 cgrad_error tensor_reshape_into(const struct tensor *const t, const size_t *shape, const size_t shape_size, struct tensor *const out)
@@ -112,6 +123,11 @@ cgrad_error tensor_reshape_into(const struct tensor *const t, const size_t *shap
     return tensor_reshape_dispatch(t, shape, shape_size, out);
 }
 
+static cgrad_error tensor_reshape_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
+{
+    return tensor_reshape_dispatch(ctx->operands[TENSOR], out->shape, out->shape_size, out);
+}
+
 static cgrad_error tensor_reshape_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
 {
     const size_t shape_size = ctx->operands_size_t[OLD_SHAPE_SIZE];
@@ -0,0 +1,200 @@
+#include "cgrad/tensor/tensor_sparse_grad.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief A row to accumulate, from the current gradient if src < the number of its rows, from values otherwise.
+ */
+struct sparse_grad_entry
+{
+    int32_t row;
+    size_t src;
+};
+
+static int sparse_grad_entry_compare(const void *a, const void *b);
+static void sparse_grad_row_add(void *const dst, const void *const src, const size_t row_size, const cgrad_dtype dtype);
+
+cgrad_error tensor_sparse_grad_accumulate(struct tensor *const t, const struct tensor *const rows, const struct tensor *const values, struct tensor_allocator *const alloc)
+{
+    if (!t || !rows || !values)
+    {
+        return TENSOR_NULL;
+    }
+    if (!alloc)
+    {
+        return TENSOR_ALLOCATOR_NULL;
+    }
+    if (rows->dtype != DTYPE_INT32 || values->dtype != t->dtype)
+    {
+        return TENSOR_DTYPE_MISMATCH;
+    }
+    if (t->dtype != DTYPE_FLOAT64 && t->dtype != DTYPE_FLOAT32)
+    {
+        return OPERATION_INVALID_TENSOR_DTYPE;
+    }
+
+    const size_t n_rows = t->shape[0];
+    const size_t row_size = t->data_size / n_rows;
+    const size_t row_bytes = row_size * dtype_sizeof(t->dtype);
+    const size_t n = rows->data_size;
+    const int32_t *rows_data = rows->data;
+    if (values->data_size != n * row_size)
+    {
+        return TENSOR_SHAPE_MISMATCH;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        if (rows_data[i] < 0 || (size_t)rows_data[i] >= n_rows)
+        {
+            return TENSOR_INDEX_OUT_OF_BOUNDS;
+        }
+    }
+
+    // Dense gradients, e.g. of a weight also read by a dense operation, are added into directly
+    if (t->grad && !t->grad_rows)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            sparse_grad_row_add((char *)t->grad->data + rows_data[i] * row_bytes, (const char *)values->data + i * row_bytes, row_size, t->dtype);
+        }
+        return NO_ERROR;
+    }
+
+    // The rows held so far and the new ones are sorted together, the position breaking ties so that sums are deterministic
+    const size_t n_held = t->grad_rows ? t->grad_rows->data_size : 0;
+    const size_t n_entries = n_held + n;
+    struct sparse_grad_entry *entries = malloc(n_entries * sizeof(struct sparse_grad_entry));
+    if (!entries)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+    for (size_t i = 0; i < n_held; i++)
+    {
+        entries[i] = (struct sparse_grad_entry){.row = ((const int32_t *)t->grad_rows->data)[i], .src = i};
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        entries[n_held + i] = (struct sparse_grad_entry){.row = rows_data[i], .src = n_held + i};
+    }
+    qsort(entries, n_entries, sizeof(struct sparse_grad_entry), &sparse_grad_entry_compare);
+
+    size_t n_unique = 0;
+    for (size_t i = 0; i < n_entries; i++)
+    {
+        n_unique += i == 0 || entries[i].row != entries[i - 1].row;
+    }
+
+    size_t grad_shape[TENSOR_MAX_SHAPE_SIZE];
+    memcpy(grad_shape, t->shape, t->shape_size * sizeof(size_t));
+    grad_shape[0] = n_unique;
+    const size_t rows_shape[] = {n_unique};
+    struct tensor *grad = tensor_allocator_no_grad_alloc(alloc, grad_shape, t->shape_size, t->dtype);
+    struct tensor *grad_rows = tensor_allocator_no_grad_alloc(alloc, rows_shape, 1, DTYPE_INT32);
+    if (!grad || !grad_rows)
+    {
+        tensor_allocator_no_grad_free(alloc, grad);
+        tensor_allocator_no_grad_free(alloc, grad_rows);
+        free(entries);
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    int32_t *grad_rows_data = grad_rows->data;
+    size_t k = 0;
+    for (size_t i = 0; i < n_entries; i++)
+    {
+        const size_t src = entries[i].src;
+        const void *src_row = src < n_held ? (const char *)t->grad->data + src * row_bytes : (const char *)values->data + (src - n_held) * row_bytes;
+        if (i == 0 || entries[i].row != entries[i - 1].row)
+        {
+            grad_rows_data[k] = entries[i].row;
+            memcpy((char *)grad->data + k * row_bytes, src_row, row_bytes);
+            k++;
+        }
+        else
+        {
+            sparse_grad_row_add((char *)grad->data + (k - 1) * row_bytes, src_row, row_size, t->dtype);
+        }
+    }
+    free(entries);
+
+    tensor_sparse_grad_clear(t, alloc);
+    t->grad = grad;
+    t->grad_rows = grad_rows;
+
+    return NO_ERROR;
+}
+
+cgrad_error tensor_sparse_grad_densify(struct tensor *const t, struct tensor_allocator *const alloc)
+{
+    if (!tensor_has_sparse_grad(t))
+    {
+        return NO_ERROR;
+    }
+
+    struct tensor *grad = tensor_allocator_no_grad_alloc(alloc, t->shape, t->shape_size, t->dtype);
+    if (!grad)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    // The dense gradient is zeroed on allocation, only the rows held are copied
+    const size_t row_bytes = t->data_size / t->shape[0] * dtype_sizeof(t->dtype);
+    const int32_t *rows = t->grad_rows->data;
+    for (size_t k = 0; k < t->grad_rows->data_size; k++)
+    {
+        memcpy((char *)grad->data + rows[k] * row_bytes, (const char *)t->grad->data + k * row_bytes, row_bytes);
+    }
+
+    tensor_sparse_grad_clear(t, alloc);
+    t->grad = grad;
+
+    return NO_ERROR;
+}
+
+void tensor_sparse_grad_clear(struct tensor *const t, struct tensor_allocator *const alloc)
+{
+    if (!t || !t->grad_rows)
+    {
+        return;
+    }
+
+    tensor_allocator_no_grad_free(alloc, t->grad);
+    tensor_allocator_no_grad_free(alloc, t->grad_rows);
+    t->grad = NULL;
+    t->grad_rows = NULL;
+}
+
+static int sparse_grad_entry_compare(const void *a, const void *b)
+{
+    const struct sparse_grad_entry *x = a;
+    const struct sparse_grad_entry *y = b;
+    if (x->row != y->row)
+    {
+        return x->row < y->row ? -1 : 1;
+    }
+
+    return x->src < y->src ? -1 : (x->src > y->src);
+}
+
+static void sparse_grad_row_add(void *const dst, const void *const src, const size_t row_size, const cgrad_dtype dtype)
+{
+    if (dtype == DTYPE_FLOAT64)
+    {
+        double *restrict d = dst;
+        const double *restrict s = src;
+        for (size_t j = 0; j < row_size; j++)
+        {
+            d[j] += s[j];
+        }
+    }
+    else
+    {
+        float *restrict d = dst;
+        const float *restrict s = src;
+        for (size_t j = 0; j < row_size; j++)
+        {
+            d[j] += s[j];
+        }
+    }
+}
@@ -1,4 +1,5 @@
 #include "cgrad/tensor/tensor_trans.h"
+#include "cgrad/tensor/tensor_permute.h"
 
 #include "cgrad/autograd/backpropagation/backpropagation_context.h"
 #include "cgrad/autograd/computational_graph/computational_graph.h"
@@ -14,11 +15,10 @@ typedef enum tensor_trans_operand_size_t
     AXIS_1,
     AXIS_2
 } tensor_trans_operand_size_t;
-    
+
 static inline cgrad_error tensor_trans_update_graph(struct tensor *const t, const size_t axis_1, const size_t axis_2, struct tensor **const out, struct cgrad_env *env);
-static cgrad_error tensor_trans_dispatch(const struct tensor *const t, const size_t axis_1, const size_t axis_2, struct tensor *const out);
-// static cgrad_error tensor_trans_f64(const struct tensor *const t, struct tensor *const out);
-static cgrad_error tensor_trans_f32(const struct tensor *const t, const size_t axis_1, const size_t axis_2, struct tensor *const out);
+static cgrad_error tensor_trans_dispatch(const struct tensor *const t, const size_t axis_1, const size_t axis_2, struct tensor *const out, struct thread_pool *const pool);
+static cgrad_error tensor_trans_forward(const struct backpropagation_context *const ctx, struct tensor *const out);
 static cgrad_error tensor_trans_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand);
 
 cgrad_error tensor_trans(struct tensor *const t, const size_t axis_1, const size_t axis_2, struct tensor **const out, const bool track_grad, struct cgrad_env *const env)
@@ -31,7 +31,11 @@ cgrad_error tensor_trans(struct tensor *const t, const size_t axis_1, const size
     {
         return TENSOR_DATA_NULL;
     }
-    
+    if (axis_1 >= t->shape_size || axis_2 >= t->shape_size)
+    {
+        return TENSOR_PERMUTE_INVALID_AXES;
+    }
+
     size_t trans_shape[TENSOR_MAX_SHAPE_SIZE];
     memcpy(trans_shape, t->shape, sizeof(size_t) * t->shape_size);
     size_t temp = trans_shape[axis_1];
@@ -44,7 +48,7 @@ cgrad_error tensor_trans(struct tensor *const t, const size_t axis_1, const size
         return TENSOR_ALLOCATION_FAILED;
     }
 
-    cgrad_error err = tensor_trans_dispatch(t, axis_1, axis_2, *out);
+    cgrad_error err = tensor_trans_dispatch(t, axis_1, axis_2, *out, env->pool);
     if (err != NO_ERROR)
     {
         return err;
@@ -77,7 +81,19 @@ static inline cgrad_error tensor_trans_update_graph(struct tensor *const t, cons
         return err;
     }
 
-    return context_set_operand_size_t(&(*out)->node->ctx, axis_2, AXIS_2);
+    err = context_set_operand_size_t(&(*out)->node->ctx, axis_2, AXIS_2);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    err = computational_graph_node_set_forward_function((*out)->node, &tensor_trans_forward);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return computational_graph_node_set_memory_hints((*out)->node, false, false);
 }
 
 cgrad_error tensor_trans_into(const struct tensor *const t, const size_t axis_1, const size_t axis_2, struct tensor *const out)
@@ -94,76 +110,44 @@ cgrad_error tensor_trans_into(const struct tensor *const t, const size_t axis_1,
     {
         return TENSOR_WRONG_SHAPE;
     }
+    if (axis_1 >= t->shape_size || axis_2 >= t->shape_size)
+    {
+        return TENSOR_PERMUTE_INVALID_AXES;
+    }
     if (t->shape[axis_1] != out->shape[axis_2] || t->shape[axis_2] != out->shape[axis_1])
     {
         return TENSOR_SHAPE_MISMATCH;
     }
 
-    return tensor_trans_dispatch(t, axis_1, axis_2, out);
+    return tensor_trans_dispatch(t, axis_1, axis_2, out, NULL);
 }
 
-static cgrad_error tensor_trans_dispatch(const struct tensor *const t, const size_t axis_1, const size_t axis_2, struct tensor *const out)
+static cgrad_error tensor_trans_dispatch(const struct tensor *const t, const size_t axis_1, const size_t axis_2, struct tensor *const out, struct thread_pool *const pool)
 {
-    switch (t->dtype)
+    // Swapping two axes is the permutation exchanging them
+    size_t perm[TENSOR_MAX_SHAPE_SIZE];
+    for (size_t i = 0; i < t->shape_size; i++)
     {
-    // case DTYPE_FLOAT64:
-    //     return tensor_trans_f64(t, out);
-    case DTYPE_FLOAT32:
-        return tensor_trans_f32(t, axis_1, axis_2, out);
-    default:
-        return OPERATION_INVALID_TENSOR_DTYPE;
+        perm[i] = i;
     }
+    perm[axis_1] = axis_2;
+    perm[axis_2] = axis_1;
+
+    return tensor_permute_into(t, perm, out, pool);
 }
 
-static cgrad_error tensor_trans_f32(const struct tensor *const t, const size_t axis_1, const size_t axis_2, struct tensor *const out)
+static cgrad_error tensor_trans_forward(const struct backpropagation_context *const ctx, struct tensor *const out)
 {
-    float *restrict out_data = (float *)out->data;
-    float *restrict t_data = (float *)t->data;
-
-    size_t idx[TENSOR_MAX_SHAPE_SIZE];
-    memset(idx, 0, sizeof(idx));
-
-    for (size_t d = 0; d < t->data_size; d++)
-    {
-        size_t t_offset = 0;
-        size_t out_offset = 0;
-
-        for (size_t i = 0; i < t->shape_size; i++)
-        {
-            t_offset += idx[i] * t->stride[i];
-
-            size_t out_idx_i = idx[i];
-            if (i == axis_1)
-            {
-                out_idx_i = idx[axis_2];
-            }
-            else if (i == axis_2)
-            {
-                out_idx_i = idx[axis_1];
-            }
-
-            out_offset += out_idx_i * out->stride[i];
-        }
-
-        out_data[out_offset] = t_data[t_offset];
-
-        // Increment idx
-        for (size_t i = t->shape_size; i-- > 0; )
-        {
-            if (++idx[i] < t->shape[i])
-            {
-                break;
-            }
-            idx[i] = 0;
-        }
-    }
-
-    return NO_ERROR;
+    const size_t axis_1 = ctx->operands_size_t[AXIS_1];
+    const size_t axis_2 = ctx->operands_size_t[AXIS_2];
+    return tensor_trans_dispatch(ctx->operands[TENSOR], axis_1, axis_2, out, ctx->pool);
 }
 
 static cgrad_error tensor_trans_backpropagate(const struct backpropagation_context *const ctx, const struct tensor *const grad_wrt_out, struct tensor *grad_wrt_operand)
 {
     const size_t axis_1 = ctx->operands_size_t[AXIS_1];
     const size_t axis_2 = ctx->operands_size_t[AXIS_2];
-    return tensor_trans_into(grad_wrt_out, axis_1, axis_2, grad_wrt_operand);
+
+    // Shapes were checked by the forward pass
+    return tensor_trans_dispatch(grad_wrt_out, axis_1, axis_2, grad_wrt_operand, ctx->pool);
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "cgrad/utils/half.h"
+#include "cgrad/utils/simd_support.h"
+
+#if SIMD_AVX_LEVEL > SIMD_AVX_LEVEL_0 || defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+static void bf16_to_f32_array(const uint16_t *const src, float *const dst, const size_t n);
+static void f32_to_bf16_array(const float *const src, uint16_t *const dst, const size_t n);
+static void f16_to_f32_array(const uint16_t *const src, float *const dst, const size_t n);
+static void f32_to_f16_array(const float *const src, uint16_t *const dst, const size_t n);
+
+void half_to_f32_array(const uint16_t *const src, float *const dst, const size_t n, const cgrad_dtype dtype)
+{
+    if (dtype == DTYPE_BFLOAT16)
+    {
+        bf16_to_f32_array(src, dst, n);
+    }
+    else
+    {
+        f16_to_f32_array(src, dst, n);
+    }
+}
+
+void f32_to_half_array(const float *const src, uint16_t *const dst, const size_t n, const cgrad_dtype dtype)
+{
+    if (dtype == DTYPE_BFLOAT16)
+    {
+        f32_to_bf16_array(src, dst, n);
+    }
+    else
+    {
+        f32_to_f16_array(src, dst, n);
+    }
+}
+
+static void bf16_to_f32_array(const uint16_t *const src, float *const dst, const size_t n)
+{
+    size_t i = 0;
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m128i h = _mm_loadu_si128((const __m128i *)(src + i));
+        const __m256i bits = _mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16);
+        _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(bits));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        dst[i] = bf16_to_f32(src[i]);
+    }
+}
+
+static void f32_to_bf16_array(const float *const src, uint16_t *const dst, const size_t n)
+{
+    size_t i = 0;
+
+#if defined(__AVX512BF16__) && defined(__AVX512VL__)
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m128bh h = _mm256_cvtneps_pbh(_mm256_loadu_ps(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), (__m128i)h);
+    }
+#elif SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+    const __m256i rounding_bias = _mm256_set1_epi32(0x7fff);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i abs_mask = _mm256_set1_epi32(0x7fffffff);
+    const __m256i infinity = _mm256_set1_epi32(0x7f800000);
+    const __m256i quiet_bit = _mm256_set1_epi32(0x00400000);
+
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m256i bits = _mm256_castps_si256(_mm256_loadu_ps(src + i));
+
+        // Same rounding as f32_to_bf16, NaNs are only made quiet
+        const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), one);
+        const __m256i rounded = _mm256_add_epi32(bits, _mm256_add_epi32(rounding_bias, lsb));
+        const __m256i is_nan = _mm256_cmpgt_epi32(_mm256_and_si256(bits, abs_mask), infinity);
+        const __m256i result = _mm256_blendv_epi8(rounded, _mm256_or_si256(bits, quiet_bit), is_nan);
+
+        // Pack the upper halves, packus works within 128 bit lanes so the qwords are reordered afterwards
+        const __m256i packed = _mm256_packus_epi32(_mm256_srli_epi32(result, 16), _mm256_setzero_si256());
+        const __m256i ordered = _mm256_permute4x64_epi64(packed, 0x08);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm256_castsi256_si128(ordered));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        dst[i] = f32_to_bf16(src[i]);
+    }
+}
+
+static void f16_to_f32_array(const uint16_t *const src, float *const dst, const size_t n)
+{
+    size_t i = 0;
+
+#if defined(__F16C__)
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m128i h = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        dst[i] = f16_to_f32(src[i]);
+    }
+}
+
+static void f32_to_f16_array(const float *const src, uint16_t *const dst, const size_t n)
+{
+    size_t i = 0;
+
+#if defined(__F16C__)
+    for (; i + 8 <= n; i += 8)
+    {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        _mm_storeu_si128((__m128i *)(dst + i), h);
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        dst[i] = f32_to_f16(src[i]);
+    }
+}
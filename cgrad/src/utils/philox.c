@@ -0,0 +1,315 @@
+#include "cgrad/utils/philox.h"
+#include "cgrad/utils/simd_support.h"
+#include "cgrad/utils/half.h"
+#include <math.h>
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+#include <immintrin.h>
+#endif
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+// Words are produced in chunks of this size before being converted
+#define PHILOX_CHUNK_SIZE 256
+
+static inline void philox_block(const uint64_t block, const uint32_t key[2], uint32_t out[4]);
+static void philox_fill_blocks(const uint64_t first_block, const uint32_t key[2], uint32_t *const dst, const size_t n_blocks);
+static uint64_t philox_splitmix64(uint64_t x);
+
+void philox_init(struct philox_state *const state, const uint64_t seed)
+{
+    state->key[0] = (uint32_t)seed;
+    state->key[1] = (uint32_t)(seed >> 32);
+    state->offset = 0;
+}
+
+struct philox_state philox_stream(const struct philox_state *const state, const uint64_t stream)
+{
+    const uint64_t key = ((uint64_t)state->key[1] << 32) | state->key[0];
+
+    struct philox_state child;
+    philox_init(&child, philox_splitmix64(key ^ philox_splitmix64(stream + 1)));
+
+    return child;
+}
+
+void philox_skip(struct philox_state *const state, const uint64_t n)
+{
+    state->offset += n;
+}
+
+void philox_fill_u32(struct philox_state *const state, uint32_t *const dst, const size_t n)
+{
+    uint64_t offset = state->offset;
+    size_t i = 0;
+
+    // Words of a block partially consumed by a previous fill
+    if (offset % 4 != 0 && n > 0)
+    {
+        uint32_t words[4];
+        philox_block(offset / 4, state->key, words);
+        for (size_t w = offset % 4; w < 4 && i < n; w++)
+        {
+            dst[i++] = words[w];
+        }
+    }
+
+    const size_t n_blocks = (n - i) / 4;
+    philox_fill_blocks((offset + i) / 4, state->key, dst + i, n_blocks);
+    i += 4 * n_blocks;
+
+    if (i < n)
+    {
+        uint32_t words[4];
+        philox_block((offset + i) / 4, state->key, words);
+        for (size_t w = 0; i < n; w++)
+        {
+            dst[i++] = words[w];
+        }
+    }
+
+    state->offset = offset + n;
+}
+
+void philox_uniform_f32(struct philox_state *const state, float *const dst, const size_t n, const float low, const float high)
+{
+    uint32_t words[PHILOX_CHUNK_SIZE];
+    const float range = high - low;
+
+    for (size_t start = 0; start < n; start += PHILOX_CHUNK_SIZE)
+    {
+        const size_t size = n - start < PHILOX_CHUNK_SIZE ? n - start : PHILOX_CHUNK_SIZE;
+        philox_fill_u32(state, words, size);
+
+        // The 24 high bits fill the mantissa exactly
+        for (size_t i = 0; i < size; i++)
+        {
+            dst[start + i] = low + (float)(words[i] >> 8) * 0x1p-24f * range;
+        }
+    }
+}
+
+void philox_uniform_f64(struct philox_state *const state, double *const dst, const size_t n, const double low, const double high)
+{
+    uint32_t words[PHILOX_CHUNK_SIZE];
+    const double range = high - low;
+
+    for (size_t start = 0; start < n; start += PHILOX_CHUNK_SIZE / 2)
+    {
+        const size_t size = n - start < PHILOX_CHUNK_SIZE / 2 ? n - start : PHILOX_CHUNK_SIZE / 2;
+        philox_fill_u32(state, words, 2 * size);
+
+        for (size_t i = 0; i < size; i++)
+        {
+            const uint64_t bits = ((uint64_t)(words[2 * i] >> 5) << 26) | (words[2 * i + 1] >> 6);
+            dst[start + i] = low + (double)bits * 0x1p-53 * range;
+        }
+    }
+}
+
+void philox_uniform_half(struct philox_state *const state, uint16_t *const dst, const size_t n, const float low, const float high, const cgrad_dtype dtype)
+{
+    float values[PHILOX_CHUNK_SIZE];
+
+    for (size_t start = 0; start < n; start += PHILOX_CHUNK_SIZE)
+    {
+        const size_t size = n - start < PHILOX_CHUNK_SIZE ? n - start : PHILOX_CHUNK_SIZE;
+        philox_uniform_f32(state, values, size, low, high);
+        f32_to_half_array(values, dst + start, size, dtype);
+    }
+}
+
+void philox_normal_f32(struct philox_state *const state, float *const dst, const size_t n, const float mean, const float std)
+{
+    uint32_t words[PHILOX_CHUNK_SIZE];
+    const float two_pi = 6.28318530717958647692f;
+
+    for (size_t start = 0; start < n; start += PHILOX_CHUNK_SIZE)
+    {
+        const size_t size = n - start < PHILOX_CHUNK_SIZE ? n - start : PHILOX_CHUNK_SIZE;
+        const size_t n_words = (size + 1) & ~(size_t)1;
+        philox_fill_u32(state, words, n_words);
+
+        for (size_t i = 0; i < size; i += 2)
+        {
+            // u1 in (0, 1] keeps the logarithm finite
+            const float u1 = (float)((words[i] >> 8) + 1) * 0x1p-24f;
+            const float u2 = (float)(words[i + 1] >> 8) * 0x1p-24f;
+            const float radius = std * sqrtf(-2.0f * logf(u1));
+
+            dst[start + i] = mean + radius * cosf(two_pi * u2);
+            if (i + 1 < size)
+            {
+                dst[start + i + 1] = mean + radius * sinf(two_pi * u2);
+            }
+        }
+    }
+}
+
+void philox_normal_f64(struct philox_state *const state, double *const dst, const size_t n, const double mean, const double std)
+{
+    uint32_t words[PHILOX_CHUNK_SIZE];
+    const double two_pi = 6.28318530717958647692;
+
+    for (size_t start = 0; start < n; start += PHILOX_CHUNK_SIZE)
+    {
+        const size_t size = n - start < PHILOX_CHUNK_SIZE ? n - start : PHILOX_CHUNK_SIZE;
+        const size_t n_words = (size + 1) & ~(size_t)1;
+        philox_fill_u32(state, words, n_words);
+
+        for (size_t i = 0; i < size; i += 2)
+        {
+            const double u1 = ((double)words[i] + 1.0) * 0x1p-32;
+            const double u2 = (double)words[i + 1] * 0x1p-32;
+            const double radius = std * sqrt(-2.0 * log(u1));
+
+            dst[start + i] = mean + radius * cos(two_pi * u2);
+            if (i + 1 < size)
+            {
+                dst[start + i + 1] = mean + radius * sin(two_pi * u2);
+            }
+        }
+    }
+}
+
+int64_t philox_uniform_int(struct philox_state *const state, const int64_t low, const int64_t high)
+{
+    uint32_t words[2];
+    philox_fill_u32(state, words, 2);
+
+    // Multiply-shift maps 64 random bits to the range, with a bias below range / 2^64
+    const uint64_t range = (uint64_t)(high - low) + 1;
+    const uint64_t bits = ((uint64_t)words[0] << 32) | words[1];
+    if (range == 0)
+    {
+        return (int64_t)bits;
+    }
+
+    return low + (int64_t)(((unsigned __int128)bits * range) >> 64);
+}
+
+static inline void philox_block(const uint64_t block, const uint32_t key[2], uint32_t out[4])
+{
+    uint32_t c0 = (uint32_t)block;
+    uint32_t c1 = (uint32_t)(block >> 32);
+    uint32_t c2 = 0;
+    uint32_t c3 = 0;
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+
+    for (int r = 0; r < PHILOX_ROUNDS; r++)
+    {
+        const uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        const uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t)p1;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t)p0;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+#if SIMD_AVX_LEVEL >= SIMD_AVX_LEVEL_256
+
+// Low and high halves of the 64 bit products of each 32 bit lane of x with m
+static inline void philox_mulhilo_avx(const __m256i x, const __m256i m, __m256i *const lo, __m256i *const hi)
+{
+    const __m256i even = _mm256_mul_epu32(x, m);
+    const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), m);
+
+    *lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    *hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+static void philox_fill_blocks(const uint64_t first_block, const uint32_t key[2], uint32_t *const dst, const size_t n_blocks)
+{
+    const __m256i m0 = _mm256_set1_epi32(PHILOX_M0);
+    const __m256i m1 = _mm256_set1_epi32(PHILOX_M1);
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    size_t b = 0;
+
+    // Eight blocks per iteration, one in each lane
+    for (; b + 8 <= n_blocks; b += 8)
+    {
+        const uint64_t block = first_block + b;
+
+        // The carry into the high word only happens when the low word wraps within the eight blocks
+        __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32((uint32_t)block), lane);
+        const __m256i carry = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_set1_epi32((uint32_t)block), _mm256_set1_epi32(0x80000000)),
+                                                 _mm256_xor_si256(c0, _mm256_set1_epi32(0x80000000)));
+        __m256i c1 = _mm256_sub_epi32(_mm256_set1_epi32((uint32_t)(block >> 32)), carry);
+        __m256i c2 = _mm256_setzero_si256();
+        __m256i c3 = _mm256_setzero_si256();
+        uint32_t k0 = key[0];
+        uint32_t k1 = key[1];
+
+        for (int r = 0; r < PHILOX_ROUNDS; r++)
+        {
+            __m256i lo0, hi0, lo1, hi1;
+            philox_mulhilo_avx(c0, m0, &lo0, &hi0);
+            philox_mulhilo_avx(c2, m1, &lo1, &hi1);
+
+            c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(k0));
+            c1 = lo1;
+            c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(k1));
+            c3 = lo0;
+
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+
+        // Transpose the words of each lane back into consecutive blocks
+        const __m256i t0 = _mm256_unpacklo_epi32(c0, c1);
+        const __m256i t1 = _mm256_unpackhi_epi32(c0, c1);
+        const __m256i t2 = _mm256_unpacklo_epi32(c2, c3);
+        const __m256i t3 = _mm256_unpackhi_epi32(c2, c3);
+        const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+        const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+        const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+        const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+
+        __m256i *out = (__m256i *)(dst + 4 * b);
+        _mm256_storeu_si256(out, _mm256_permute2x128_si256(u0, u1, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(u2, u3, 0x20));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(u0, u1, 0x31));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(u2, u3, 0x31));
+    }
+
+    for (; b < n_blocks; b++)
+    {
+        philox_block(first_block + b, key, dst + 4 * b);
+    }
+}
+
+#else
+
+static void philox_fill_blocks(const uint64_t first_block, const uint32_t key[2], uint32_t *const dst, const size_t n_blocks)
+{
+    for (size_t b = 0; b < n_blocks; b++)
+    {
+        philox_block(first_block + b, key, dst + 4 * b);
+    }
+}
+
+#endif
+
+static uint64_t philox_splitmix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
@@ -3,6 +3,7 @@
 #include "cgrad/layers/relu.h"
 #include "cgrad/losses/cross_entropy.h"
 #include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/autograd/checkpoint/checkpoint.h"
 #include "cgrad/cgrad_env.h"
 #include "cgrad/model/model_params.h"
 #include "cgrad/tensor/tensor.h"
@@ -20,14 +21,16 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
+#include <string.h>
+#include <time.h>
 
 #define OUTPUT_ITERATION_FREQ 25
 
 int main(int argc, char **argv)
 {
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
-        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path>\n", argv[0]);
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> [store|recompute]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
@@ -41,6 +44,17 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    /**
+     * Each convolutional block is a checkpointed segment. With the recompute policy, only the block inputs
+     * and outputs are kept after the forward pass, while the patches and the other intermediates of the
+     * convolutions are recomputed during backpropagation.
+     */
+    const checkpoint_policy policy = (argc == 3 && strcmp(argv[2], "recompute") == 0) ? CHECKPOINT_POLICY_RECOMPUTE : CHECKPOINT_POLICY_STORE;
+    if (checkpoint_set_policy(&env, policy) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
     const size_t BATCH_SIZE = 64;
     const size_t NUM_CLASSES = 10;
 
@@ -118,6 +132,9 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    struct timespec train_start;
+    timespec_get(&train_start, TIME_UTC);
+
     size_t epochs = 2;
     for (size_t epoch = 0; epoch < epochs; epoch++)
     {
@@ -161,6 +178,11 @@ int main(int argc, char **argv)
                 return EXIT_FAILURE;
             }
 
+            if (checkpoint_begin(&env, x_reshaped) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
             struct tensor *h1 = NULL;
             if (conv2d_forward(&conv1, x_reshaped, &h1, true) != NO_ERROR)
             {
@@ -173,12 +195,27 @@ int main(int argc, char **argv)
                 return EXIT_FAILURE;
             }
 
+            if (checkpoint_end(&env, h2) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
+            if (checkpoint_begin(&env, h2) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
             struct tensor *h3 = NULL;
             if (conv2d_forward(&conv2, h2, &h3, true) != NO_ERROR)
             {
                 return EXIT_FAILURE;
             }
 
+            if (checkpoint_end(&env, h3) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
             struct tensor *h3_flattened = NULL;
             size_t h3_flattened_shape[] = {iter_batch_size, 2304};
             if (tensor_reshape(h3, h3_flattened_shape, 2, &h3_flattened, true, &env) != NO_ERROR)
@@ -198,6 +235,16 @@ int main(int argc, char **argv)
                 return EXIT_FAILURE;
             }
 
+            // Activations are owned by the environment, so that backward releases each one once it is no longer read
+            struct tensor *activations[] = {x_reshaped, h1, h2, h3, h3_flattened, h4};
+            for (size_t i = 0; i < sizeof(activations) / sizeof(activations[0]); i++)
+            {
+                if (tensor_list_add(env.tensor_alloc_intermediates, activations[i]) != NO_ERROR)
+                {
+                    return EXIT_FAILURE;
+                }
+            }
+
             if (iteration % OUTPUT_ITERATION_FREQ == 0)
             {
                 float loss;
@@ -214,13 +261,7 @@ int main(int argc, char **argv)
             // Clear iteration allocations
             cgrad_env_free_intermediates(&env);
             tensor_free(&env, x);
-            tensor_free(&env, x_reshaped);
             tensor_free(&env, y);
-            tensor_free(&env, h1);
-            tensor_free(&env, h2);
-            tensor_free(&env, h3);
-            tensor_free(&env, h3_flattened);
-            tensor_free(&env, h4);
             tensor_free(&env, z);
 
             index_permutation_update(permutation, iter_batch_size);
@@ -228,6 +269,15 @@ int main(int argc, char **argv)
         }
     }
 
+    struct timespec train_end;
+    timespec_get(&train_end, TIME_UTC);
+    const double train_seconds = (double)(train_end.tv_sec - train_start.tv_sec) + (double)(train_end.tv_nsec - train_start.tv_nsec) * 1e-9;
+
+    const struct checkpoint_stats *stats = checkpoint_get_stats(&env);
+    printf("Checkpoint policy: %s\n", policy == CHECKPOINT_POLICY_RECOMPUTE ? "recompute" : "store");
+    printf("Released activations: %ld bytes, recomputed: %ld bytes in %ld segments\n", stats->released_bytes, stats->recomputed_bytes, stats->n_recomputed_segments);
+    printf("Training time: %.3f s, of which recomputation: %.3f s\n", train_seconds, stats->recompute_seconds);
+
     // Cleanup
     sgd_optimizer_cleanup(&opt);
     conv2d_cleanup(&conv1);
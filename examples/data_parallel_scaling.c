@@ -0,0 +1,265 @@
+#include "cgrad/cgrad_env.h"
+#include "cgrad/parallel/data_parallel.h"
+#include "cgrad/layers/conv2d.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_reshape.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define INPUT_DIM 784
+#define HIDDEN_DIM 512
+#define NUM_CLASSES 10
+#define CONV_CHANNELS 4
+#define CONV_KERNEL_SIZE 3
+#define CONV_FLATTENED_DIM 2304
+
+struct mlp
+{
+    struct linear linear1;
+    struct linear linear2;
+};
+
+struct cnn
+{
+    struct conv2d conv1;
+    struct conv2d conv2;
+    struct linear linear1;
+};
+
+static cgrad_error mlp_init(void *model, struct model_params *const params, struct cgrad_env *const env);
+static void mlp_cleanup(void *model);
+static cgrad_error mlp_loss(void *model, struct tensor *const x, struct tensor *const y, struct tensor **const loss, struct cgrad_env *const env);
+static cgrad_error cnn_init(void *model, struct model_params *const params, struct cgrad_env *const env);
+static void cnn_cleanup(void *model);
+static cgrad_error cnn_loss(void *model, struct tensor *const x, struct tensor *const y, struct tensor **const loss, struct cgrad_env *const env);
+static cgrad_error run_scaling(const char *const name, const struct data_parallel_model *const model, const size_t max_workers, struct tensor *const x, struct tensor *const y, struct cgrad_env *const env);
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end);
+
+int main(int argc, char **argv)
+{
+    if (argc > 3)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s [max_workers] [batch_size]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const size_t max_workers = argc > 1 ? strtoul(argv[1], NULL, 10) : 8;
+    // Patches of larger convolution batches exceed the chunks of the tensor pool
+    const size_t batch_size = argc > 2 ? strtoul(argv[2], NULL, 10) : 64;
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    if (cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Synthetic MNIST shaped batch, only the throughput is measured
+    const size_t x_shape[] = {batch_size, INPUT_DIM};
+    const size_t y_shape[] = {batch_size, 1};
+    struct tensor *x = tensor_alloc(&env, x_shape, 2, DTYPE_FLOAT32);
+    struct tensor *y = tensor_alloc(&env, y_shape, 2, DTYPE_FLOAT32);
+    if (!x || !y)
+    {
+        return EXIT_FAILURE;
+    }
+    philox_normal_f32(&env.rng, x->data, x->data_size, 0.0f, 1.0f);
+    for (size_t i = 0; i < batch_size; i++)
+    {
+        ((float *)y->data)[i] = philox_uniform_int(&env.rng, 0, NUM_CLASSES - 1);
+    }
+
+    // BLAS threads would compete with the workers, run with e.g. OPENBLAS_NUM_THREADS=1
+    const struct data_parallel_model mlp = {.replica_size = sizeof(struct mlp), .replica_init = &mlp_init, .replica_cleanup = &mlp_cleanup, .loss = &mlp_loss};
+    const struct data_parallel_model cnn = {.replica_size = sizeof(struct cnn), .replica_init = &cnn_init, .replica_cleanup = &cnn_cleanup, .loss = &cnn_loss};
+    printf("batch size %ld\n", batch_size);
+    if (run_scaling("mlp", &mlp, max_workers, x, y, &env) != NO_ERROR || run_scaling("conv", &cnn, max_workers, x, y, &env) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    tensor_free(&env, x);
+    tensor_free(&env, y);
+    cgrad_env_cleanup(&env);
+    return EXIT_SUCCESS;
+}
+
+static cgrad_error run_scaling(const char *const name, const struct data_parallel_model *const model, const size_t max_workers, struct tensor *const x, struct tensor *const y, struct cgrad_env *const env)
+{
+    const size_t WARMUP_STEPS = 2;
+    const size_t STEPS = 10;
+
+    // The trained model is built like any replica
+    void *trained = malloc(model->replica_size);
+    struct model_params params;
+    cgrad_error err;
+    if (!trained || (err = model->replica_init(trained, &params, env)) != NO_ERROR)
+    {
+        free(trained);
+        return DATA_PARALLEL_INIT_FAILED;
+    }
+
+    struct sgd_optimizer opt;
+    if ((err = sgd_optimizer_init(&opt, &params, 1e-3, 0.9, false, env)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    printf("\n%s\n%8s %16s %12s %10s\n", name, "workers", "samples/s", "speedup", "efficiency");
+    double single_throughput = 0.0;
+    for (size_t n_workers = 1; n_workers <= max_workers; n_workers *= 2)
+    {
+        struct data_parallel_trainer trainer;
+        if ((err = data_parallel_init(&trainer, model, &params, n_workers, 64, env)) != NO_ERROR)
+        {
+            return err;
+        }
+
+        struct timespec start, end;
+        double loss = 0.0;
+        for (size_t step = 0; step < WARMUP_STEPS + STEPS; step++)
+        {
+            if (step == WARMUP_STEPS)
+            {
+                clock_gettime(CLOCK_MONOTONIC, &start);
+            }
+
+            sgd_optimizer_zero_grad(&opt);
+            if ((err = data_parallel_step(&trainer, x, y, &loss)) != NO_ERROR || (err = sgd_optimizer_step(&opt)) != NO_ERROR)
+            {
+                data_parallel_cleanup(&trainer);
+                return err;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        data_parallel_cleanup(&trainer);
+
+        const double throughput = STEPS * x->shape[0] / elapsed_seconds(&start, &end);
+        if (n_workers == 1)
+        {
+            single_throughput = throughput;
+        }
+        const double speedup = throughput / single_throughput;
+        printf("%8ld %16.0f %11.2fx %9.0f%%   (loss %.4f)\n", n_workers, throughput, speedup, 100.0 * speedup / n_workers, loss);
+    }
+
+    sgd_optimizer_cleanup(&opt);
+    model->replica_cleanup(trained);
+    free(trained);
+    return NO_ERROR;
+}
+
+static cgrad_error mlp_init(void *model, struct model_params *const params, struct cgrad_env *const env)
+{
+    struct mlp *mlp = model;
+    cgrad_error err;
+    if ((err = linear_init(&mlp->linear1, INPUT_DIM, HIDDEN_DIM, DTYPE_FLOAT32, env)) != NO_ERROR ||
+        (err = linear_xavier_init(&mlp->linear1)) != NO_ERROR ||
+        (err = linear_init(&mlp->linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE_FLOAT32, env)) != NO_ERROR ||
+        (err = linear_xavier_init(&mlp->linear2)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    model_params_init(params);
+    model_params_add(params, mlp->linear1.weight);
+    model_params_add(params, mlp->linear1.bias);
+    model_params_add(params, mlp->linear2.weight);
+    model_params_add(params, mlp->linear2.bias);
+    return NO_ERROR;
+}
+
+static void mlp_cleanup(void *model)
+{
+    struct mlp *mlp = model;
+    linear_cleanup(&mlp->linear1);
+    linear_cleanup(&mlp->linear2);
+}
+
+static cgrad_error mlp_loss(void *model, struct tensor *const x, struct tensor *const y, struct tensor **const loss, struct cgrad_env *const env)
+{
+    struct mlp *mlp = model;
+    cgrad_error err;
+
+    struct tensor *h1 = NULL, *h2 = NULL, *h3 = NULL;
+    if ((err = linear_forward(&mlp->linear1, x, &h1, true)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h1)) != NO_ERROR ||
+        (err = relu_forward(h1, &h2, true, env)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h2)) != NO_ERROR ||
+        (err = linear_forward(&mlp->linear2, h2, &h3, true)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h3)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    return cross_entropy_loss(h3, y, loss, true, env);
+}
+
+static cgrad_error cnn_init(void *model, struct model_params *const params, struct cgrad_env *const env)
+{
+    struct cnn *cnn = model;
+    cgrad_error err;
+    if ((err = conv2d_init(&cnn->conv1, 1, CONV_CHANNELS, CONV_KERNEL_SIZE, DTYPE_FLOAT32, env)) != NO_ERROR ||
+        (err = conv2d_xavier_init(&cnn->conv1)) != NO_ERROR ||
+        (err = conv2d_init(&cnn->conv2, CONV_CHANNELS, CONV_CHANNELS, CONV_KERNEL_SIZE, DTYPE_FLOAT32, env)) != NO_ERROR ||
+        (err = conv2d_xavier_init(&cnn->conv2)) != NO_ERROR ||
+        (err = linear_init(&cnn->linear1, CONV_FLATTENED_DIM, NUM_CLASSES, DTYPE_FLOAT32, env)) != NO_ERROR ||
+        (err = linear_xavier_init(&cnn->linear1)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    model_params_init(params);
+    model_params_add(params, cnn->conv1.weight);
+    model_params_add(params, cnn->conv2.weight);
+    model_params_add(params, cnn->linear1.weight);
+    return NO_ERROR;
+}
+
+static void cnn_cleanup(void *model)
+{
+    struct cnn *cnn = model;
+    conv2d_cleanup(&cnn->conv1);
+    conv2d_cleanup(&cnn->conv2);
+    linear_cleanup(&cnn->linear1);
+}
+
+static cgrad_error cnn_loss(void *model, struct tensor *const x, struct tensor *const y, struct tensor **const loss, struct cgrad_env *const env)
+{
+    struct cnn *cnn = model;
+    cgrad_error err;
+
+    const size_t batch_size = x->shape[0];
+    const size_t img_shape[] = {batch_size, 1, 28, 28};
+    const size_t flattened_shape[] = {batch_size, CONV_FLATTENED_DIM};
+
+    struct tensor *img = NULL, *h1 = NULL, *h2 = NULL, *h3 = NULL, *h3_flattened = NULL, *h4 = NULL;
+    if ((err = tensor_reshape(x, img_shape, 4, &img, true, env)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, img)) != NO_ERROR ||
+        (err = conv2d_forward(&cnn->conv1, img, &h1, true)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h1)) != NO_ERROR ||
+        (err = relu_forward(h1, &h2, true, env)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h2)) != NO_ERROR ||
+        (err = conv2d_forward(&cnn->conv2, h2, &h3, true)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h3)) != NO_ERROR ||
+        (err = tensor_reshape(h3, flattened_shape, 2, &h3_flattened, true, env)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h3_flattened)) != NO_ERROR ||
+        (err = linear_forward(&cnn->linear1, h3_flattened, &h4, true)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h4)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    return cross_entropy_loss(h4, y, loss, true, env);
+}
+
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,161 @@
+#include "cgrad/cgrad_env.h"
+#include "cgrad/layers/embedding.h"
+#include "cgrad/losses/mse.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/tensor/tensor2d_mult.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static cgrad_error run_training(const size_t n_embeddings, const bool sparse, const size_t iterations, double *const seconds, struct cgrad_env *const env);
+static cgrad_error run_iteration(struct embedding *const layer, struct tensor *const projection, struct sgd_optimizer *const opt, struct tensor *const indexes, struct tensor *const target, struct cgrad_env *const env);
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end);
+
+static const size_t BATCH_SIZE = 256;
+static const size_t DIM = 16;
+static const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+int main(int argc, char **argv)
+{
+    if (argc > 3)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s [n_threads] [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const size_t n_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+    const size_t iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : 50;
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    if (cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) != NO_ERROR || cgrad_env_set_num_threads(&env, n_threads) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Training steps of an embedding with a dense gradient, then with the row-sparse one, as the vocabulary grows
+    const size_t N_EMBEDDINGS[] = {1024, 8192, 65536};
+    printf("%ld threads, batch of %ld indexes, embeddings of %ld float32\n", n_threads, BATCH_SIZE, DIM);
+    for (size_t v = 0; v < sizeof(N_EMBEDDINGS) / sizeof(N_EMBEDDINGS[0]); v++)
+    {
+        double seconds[2];
+        for (size_t sparse = 0; sparse < 2; sparse++)
+        {
+            if (run_training(N_EMBEDDINGS[v], sparse, iterations, &seconds[sparse], &env) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+        }
+
+        printf("%6ld embeddings | dense: %8.3f ms | sparse: %8.3f ms | speedup %6.1fx\n", N_EMBEDDINGS[v], seconds[0] * 1e3,
+               seconds[1] * 1e3, seconds[0] / seconds[1]);
+    }
+
+    cgrad_env_cleanup(&env);
+    return EXIT_SUCCESS;
+}
+
+static cgrad_error run_training(const size_t n_embeddings, const bool sparse, const size_t iterations, double *const seconds, struct cgrad_env *const env)
+{
+    struct embedding layer;
+    struct model_params params;
+    struct sgd_optimizer opt;
+    cgrad_error err = NO_ERROR;
+    if ((err = embedding_init(&layer, n_embeddings, DIM, DTYPE, env)) != NO_ERROR || (err = embedding_normal_init(&layer)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    const size_t projection_shape[] = {DIM, 1};
+    const size_t indexes_shape[] = {BATCH_SIZE};
+    const size_t target_shape[] = {BATCH_SIZE, 1};
+    struct tensor *projection = tensor_alloc(env, projection_shape, 2, DTYPE);
+    struct tensor *indexes = tensor_alloc(env, indexes_shape, 1, DTYPE_INT32);
+    struct tensor *target = tensor_alloc(env, target_shape, 2, DTYPE);
+    if (!projection || !indexes || !target)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+    tensor_set_requires_grad(indexes, false);
+    tensor_set_requires_grad(target, false);
+
+    srand(0);
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+    {
+        ((int32_t *)indexes->data)[i] = rand() % n_embeddings;
+        ((float *)target->data)[i] = (float)rand() / RAND_MAX;
+    }
+    for (size_t i = 0; i < DIM; i++)
+    {
+        ((float *)projection->data)[i] = 0.1f;
+    }
+
+    // A dense gradient is added into in place by the lookups, so that every step updates the whole weight
+    if (!sparse)
+    {
+        layer.weight->grad = tensor_allocator_no_grad_alloc(&env->tensor_alloc, layer.weight->shape, layer.weight->shape_size, DTYPE);
+        if (!layer.weight->grad)
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+    }
+
+    model_params_init(&params);
+    if ((err = model_params_add(&params, layer.weight)) != NO_ERROR || (err = model_params_add(&params, projection)) != NO_ERROR ||
+        (err = sgd_optimizer_init(&opt, &params, 0.01, 0.9, false, env)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t it = 0; it < iterations && err == NO_ERROR; it++)
+    {
+        err = run_iteration(&layer, projection, &opt, indexes, target, env);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *seconds = elapsed_seconds(&start, &end) / iterations;
+
+    sgd_optimizer_cleanup(&opt);
+    tensor_free(env, projection);
+    tensor_free(env, indexes);
+    tensor_free(env, target);
+    embedding_cleanup(&layer);
+
+    return err;
+}
+
+static cgrad_error run_iteration(struct embedding *const layer, struct tensor *const projection, struct sgd_optimizer *const opt, struct tensor *const indexes, struct tensor *const target, struct cgrad_env *const env)
+{
+    struct tensor *h1 = NULL;
+    struct tensor *h2 = NULL;
+    struct tensor *z = NULL;
+
+    cgrad_error err = NO_ERROR;
+    if ((err = embedding_forward(layer, indexes, &h1, true)) == NO_ERROR && (err = tensor2d_mult(h1, projection, &h2, true, env)) == NO_ERROR &&
+        (err = mse_loss(h2, target, &z, true, env)) == NO_ERROR)
+    {
+        sgd_optimizer_zero_grad(opt);
+        if ((err = backward(z, env)) == NO_ERROR)
+        {
+            err = sgd_optimizer_step(opt);
+        }
+    }
+
+    cgrad_env_free_intermediates(env);
+    tensor_free(env, h1);
+    tensor_free(env, h2);
+    tensor_free(env, z);
+
+    return err;
+}
+
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,203 @@
+#include "cgrad/cgrad_env.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/serving/inference_batcher.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define INPUT_DIM 784
+#define HIDDEN_DIM 512
+#define NUM_CLASSES 10
+
+struct mlp
+{
+    struct linear linear1;
+    struct linear linear2;
+};
+
+struct client
+{
+    struct inference_batcher *batcher;
+    size_t n_requests;
+    unsigned int seed;
+    size_t failed;
+};
+
+static cgrad_error mlp_forward(void *model, struct tensor *const x, struct tensor **const out, struct cgrad_env *const env);
+static void *client_run(void *arg);
+static cgrad_error run_benchmark(struct mlp *const model, struct cgrad_env *const env, const size_t n_clients, const size_t n_requests, const size_t max_batch_size, const uint64_t max_delay_us);
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end);
+
+int main(int argc, char **argv)
+{
+    if (argc > 4)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s [n_clients] [max_batch_size] [max_delay_us]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const size_t n_clients = argc > 1 ? strtoul(argv[1], NULL, 10) : 32;
+    const size_t max_batch_size = argc > 2 ? strtoul(argv[2], NULL, 10) : 32;
+    const uint64_t max_delay_us = argc > 3 ? strtoull(argv[3], NULL, 10) : 1000;
+    const size_t REQUESTS_PER_CLIENT = 200;
+
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    if (cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Allocate model, the weights are random as only the serving path is measured
+    struct mlp model;
+    if (linear_init(&model.linear1, INPUT_DIM, HIDDEN_DIM, DTYPE, &env) != NO_ERROR ||
+        linear_xavier_init(&model.linear1) != NO_ERROR ||
+        linear_init(&model.linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE, &env) != NO_ERROR ||
+        linear_xavier_init(&model.linear2) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Each request run alone, then gathered in batches
+    printf("%ld clients, %ld requests each\n", n_clients, REQUESTS_PER_CLIENT);
+    if (run_benchmark(&model, &env, n_clients, REQUESTS_PER_CLIENT, 1, 0) != NO_ERROR ||
+        run_benchmark(&model, &env, n_clients, REQUESTS_PER_CLIENT, max_batch_size, max_delay_us) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Cleanup
+    linear_cleanup(&model.linear1);
+    linear_cleanup(&model.linear2);
+    cgrad_env_cleanup(&env);
+    return EXIT_SUCCESS;
+}
+
+static cgrad_error mlp_forward(void *model, struct tensor *const x, struct tensor **const out, struct cgrad_env *const env)
+{
+    struct mlp *mlp = model;
+    cgrad_error err;
+
+    struct tensor *h1 = NULL;
+    if ((err = linear_forward(&mlp->linear1, x, &h1, false)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct tensor *h2 = NULL;
+    if ((err = relu_forward(h1, &h2, false, env)) != NO_ERROR)
+    {
+        tensor_free(env, h1);
+        return err;
+    }
+
+    err = linear_forward(&mlp->linear2, h2, out, false);
+
+    tensor_free(env, h1);
+    tensor_free(env, h2);
+    return err;
+}
+
+static void *client_run(void *arg)
+{
+    struct client *client = arg;
+    float input[INPUT_DIM];
+    float output[NUM_CLASSES];
+
+    for (size_t r = 0; r < client->n_requests; r++)
+    {
+        for (size_t i = 0; i < INPUT_DIM; i++)
+        {
+            input[i] = (float)rand_r(&client->seed) / RAND_MAX;
+        }
+
+        // Closed loop, each client waits for its answer before sending the next request
+        struct inference_future future = {.input = input, .output = output};
+        if (inference_batcher_submit(client->batcher, &future) != NO_ERROR || inference_future_wait(client->batcher, &future) != NO_ERROR)
+        {
+            client->failed++;
+        }
+    }
+
+    return NULL;
+}
+
+static cgrad_error run_benchmark(struct mlp *const model, struct cgrad_env *const env, const size_t n_clients, const size_t n_requests, const size_t max_batch_size, const uint64_t max_delay_us)
+{
+    const struct inference_batcher_config config = {
+        .in_dim = INPUT_DIM,
+        .out_dim = NUM_CLASSES,
+        .dtype = DTYPE_FLOAT32,
+        .max_batch_size = max_batch_size,
+        .max_delay_us = max_delay_us,
+        .queue_capacity = n_clients,
+    };
+
+    struct inference_batcher batcher;
+    cgrad_error err = inference_batcher_init(&batcher, &config, &mlp_forward, model, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct client *clients = calloc(n_clients, sizeof(struct client));
+    pthread_t *threads = calloc(n_clients, sizeof(pthread_t));
+    size_t *histogram = calloc(max_batch_size + 1, sizeof(size_t));
+    if (!clients || !threads || !histogram)
+    {
+        inference_batcher_cleanup(&batcher);
+        return INFERENCE_BATCHER_INIT_FAILED;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t c = 0; c < n_clients; c++)
+    {
+        clients[c] = (struct client){.batcher = &batcher, .n_requests = n_requests, .seed = c + 1, .failed = 0};
+        pthread_create(&threads[c], NULL, &client_run, &clients[c]);
+    }
+
+    size_t failed = 0;
+    for (size_t c = 0; c < n_clients; c++)
+    {
+        pthread_join(threads[c], NULL);
+        failed += clients[c].failed;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    struct inference_batcher_stats stats;
+    inference_batcher_get_stats(&batcher, &stats, histogram);
+    inference_batcher_cleanup(&batcher);
+
+    const double seconds = elapsed_seconds(&start, &end);
+    printf("\nmax batch size %ld, max delay %ld us\n", max_batch_size, max_delay_us);
+    printf("throughput: %.0f requests/s, failed requests: %ld\n", stats.completed_requests / seconds, failed);
+    printf("latency p50: %.0f us, p90: %.0f us, p99: %.0f us\n", stats.latency_p50_us, stats.latency_p90_us, stats.latency_p99_us);
+    printf("batches: %ld, mean batch size: %.2f\n", stats.completed_batches, stats.mean_batch_size);
+    printf("batch size histogram:");
+    for (size_t size = 1; size <= max_batch_size; size++)
+    {
+        if (histogram[size] > 0)
+        {
+            printf(" %ld:%ld", size, histogram[size]);
+        }
+    }
+    printf("\n");
+
+    free(clients);
+    free(threads);
+    free(histogram);
+    return NO_ERROR;
+}
+
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
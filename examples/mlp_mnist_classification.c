@@ -4,6 +4,7 @@
 #include "cgrad/losses/cross_entropy.h"
 #include "cgrad/autograd/backpropagation/backpropagation.h"
 #include "cgrad/model/model_params.h"
+#include "cgrad/model/model_checkpoint_writer.h"
 #include "cgrad/tensor/tensor_alloc.h"
 #include "cgrad/tensor/tensor.h"
 #include "cgrad/tensor/tensor_get.h"
@@ -20,9 +21,9 @@
 
 int main(int argc, char **argv)
 {
-    if (argc != 2)
+    if (argc != 2 && argc != 3)
     {
-        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path>\n", argv[0]);
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> [checkpoint_path]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
@@ -93,6 +94,13 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
+    // Keeps the checkpoint of the last epoch only
+    struct model_checkpoint_writer writer;
+    if (model_checkpoint_writer_init(&writer, 1) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
     // Setup indexes batch container. In this case, the container's capacity is the batch size.
     struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
     if (!ixs_batch)
@@ -189,7 +197,27 @@ int main(int argc, char **argv)
             index_permutation_update(permutation, iter_batch_size);
             iteration++;
         }
+
+        // Save the model together with the optimizer state, to resume training or serve it. Training is only
+        // blocked while the tensors are copied, the file being written by the thread of the writer
+        if (argc == 3 && model_checkpoint_writer_save(&writer, &params, &opt, argv[2]) != NO_ERROR)
+        {
+            fprintf(stderr, "Error while trying to save %s.\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Wait for the checkpoint of the last epoch to be on disk
+    if (argc == 3)
+    {
+        if (model_checkpoint_writer_wait(&writer) != NO_ERROR)
+        {
+            fprintf(stderr, "Error while trying to save %s.\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        printf("Checkpoint saved to %s, training blocked for %.3f ms\n", argv[2], writer.blocked_seconds * 1e3);
     }
+    model_checkpoint_writer_cleanup(&writer);
 
     // Cleanup
     sgd_optimizer_cleanup(&opt);
@@ -0,0 +1,335 @@
+#include "cgrad/cgrad_env.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/linear_int8.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/quantization/quant_observer.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/tensor/tensor_get.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_permutation.h"
+#include "cgrad/utils/random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define OUTPUT_ITERATION_FREQ 25
+
+struct mlp
+{
+    struct linear linear1;
+    struct linear linear2;
+};
+
+struct mlp_int8
+{
+    struct linear_int8 linear1;
+    struct linear_int8 linear2;
+};
+
+static cgrad_error mlp_forward(struct mlp *const model, struct tensor *const x, struct tensor **const hidden, struct tensor **const logits, const bool track_grad, struct cgrad_env *const env);
+static cgrad_error mlp_int8_forward(struct mlp_int8 *const model, struct tensor *const x, struct tensor **const hidden, struct tensor **const logits);
+static size_t count_correct(const struct tensor *const logits, const struct tensor *const y);
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end);
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    if (cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    const size_t BATCH_SIZE = 64;
+    const size_t INPUT_DIM = 784;
+    const size_t HIDDEN_DIM = 512;
+    const size_t NUM_CLASSES = 10;
+    const size_t CALIBRATION_BATCHES = 16;
+
+    // Can be downloaded from https://www.kaggle.com/datasets/oddrationale/mnist-in-csv
+    struct csv_dataset *train_set = csv_dataset_alloc(argv[1]);
+    if (!train_set)
+    {
+        fprintf(stderr, "Error while trying to open %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (csv_dataset_standard_scale(train_set) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Allocate model
+    struct mlp model;
+    if (linear_init(&model.linear1, INPUT_DIM, HIDDEN_DIM, DTYPE, &env) != NO_ERROR ||
+        linear_xavier_init(&model.linear1) != NO_ERROR ||
+        linear_init(&model.linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE, &env) != NO_ERROR ||
+        linear_xavier_init(&model.linear2) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup model params
+    struct model_params params;
+    model_params_init(&params);
+    model_params_add(&params, model.linear1.weight);
+    model_params_add(&params, model.linear1.bias);
+    model_params_add(&params, model.linear2.weight);
+    model_params_add(&params, model.linear2.bias);
+
+    // Setup optimizer
+    double lr = 3e-4;
+    double momentum = 0.9;
+    struct sgd_optimizer opt;
+
+    if (sgd_optimizer_init(&opt, &params, lr, momentum, false, &env) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
+    if (!ixs_batch)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // ------------- Float training -------------
+    struct indexes_permutation *permutation = indexes_permutation_alloc(train_set->rows);
+    if (!permutation || indexes_permutation_init(permutation) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    size_t iteration = 0;
+    while (!index_permutation_is_terminated(permutation))
+    {
+        size_t remaining = index_permutation_get_remaining(permutation);
+        size_t iter_batch_size = remaining < BATCH_SIZE ? remaining : BATCH_SIZE;
+
+        struct tensor *x = NULL;
+        struct tensor *y = NULL;
+        if (indexes_permutation_sample_index_batch(permutation, ixs_batch, iter_batch_size) != NO_ERROR ||
+            csv_dataset_sample_batch(train_set, &x, &y, ixs_batch, DTYPE, &env) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        struct tensor *hidden = NULL;
+        struct tensor *logits = NULL;
+        struct tensor *z = NULL;
+        if (mlp_forward(&model, x, &hidden, &logits, true, &env) != NO_ERROR ||
+            cross_entropy_loss(logits, y, &z, true, &env) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (iteration % OUTPUT_ITERATION_FREQ == 0)
+        {
+            float loss;
+            tensor2d_get(z, 0, 0, &loss);
+            printf("iteration %04ld - loss: %f\n", iteration, loss);
+        }
+
+        sgd_optimizer_zero_grad(&opt);
+        backward(z, &env);
+        sgd_optimizer_step(&opt);
+
+        cgrad_env_free_intermediates(&env);
+        tensor_free(&env, x);
+        tensor_free(&env, y);
+        tensor_free(&env, hidden);
+        tensor_free(&env, logits);
+        tensor_free(&env, z);
+
+        index_permutation_update(permutation, iter_batch_size);
+        iteration++;
+    }
+
+    // ------------- Calibration -------------
+    // Ranges of the inputs of both layers, observed on a few batches of the float model
+    struct quant_observer input_observer;
+    struct quant_observer hidden_observer;
+    quant_observer_init(&input_observer);
+    quant_observer_init(&hidden_observer);
+
+    for (size_t batch = 0; batch < CALIBRATION_BATCHES && batch * BATCH_SIZE < train_set->rows; batch++)
+    {
+        ixs_batch->size = 0;
+        for (size_t i = batch * BATCH_SIZE; i < train_set->rows && ixs_batch->size < BATCH_SIZE; i++)
+        {
+            ixs_batch->indexes[ixs_batch->size++] = i;
+        }
+
+        struct tensor *x = NULL;
+        struct tensor *y = NULL;
+        struct tensor *hidden = NULL;
+        struct tensor *logits = NULL;
+        if (csv_dataset_sample_batch(train_set, &x, &y, ixs_batch, DTYPE, &env) != NO_ERROR ||
+            mlp_forward(&model, x, &hidden, &logits, false, &env) != NO_ERROR ||
+            quant_observer_update(&input_observer, x) != NO_ERROR ||
+            quant_observer_update(&hidden_observer, hidden) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        cgrad_env_free_intermediates(&env);
+        tensor_free(&env, x);
+        tensor_free(&env, y);
+        tensor_free(&env, hidden);
+        tensor_free(&env, logits);
+    }
+
+    struct quant_params input_params;
+    struct quant_params hidden_params;
+    if (quant_observer_compute_params(&input_observer, &input_params) != NO_ERROR ||
+        quant_observer_compute_params(&hidden_observer, &hidden_params) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // The first layer computes the ReLU and hands uint8 activations to the second one
+    struct mlp_int8 model_int8;
+    if (linear_int8_init(&model_int8.linear1, &model.linear1, &input_params, QUANT_PER_CHANNEL) != NO_ERROR ||
+        linear_int8_set_output(&model_int8.linear1, true, &hidden_params) != NO_ERROR ||
+        linear_int8_init(&model_int8.linear2, &model.linear2, &hidden_params, QUANT_PER_CHANNEL) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // ------------- Evaluation -------------
+    size_t correct_f32 = 0;
+    size_t correct_int8 = 0;
+    double seconds_f32 = 0;
+    double seconds_int8 = 0;
+
+    for (size_t start = 0; start < train_set->rows; start += BATCH_SIZE)
+    {
+        ixs_batch->size = 0;
+        for (size_t i = start; i < train_set->rows && ixs_batch->size < BATCH_SIZE; i++)
+        {
+            ixs_batch->indexes[ixs_batch->size++] = i;
+        }
+
+        struct tensor *x = NULL;
+        struct tensor *y = NULL;
+        if (csv_dataset_sample_batch(train_set, &x, &y, ixs_batch, DTYPE, &env) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        struct timespec t0, t1, t2;
+        struct tensor *hidden_f32 = NULL;
+        struct tensor *logits_f32 = NULL;
+        struct tensor *hidden_int8 = NULL;
+        struct tensor *logits_int8 = NULL;
+
+        timespec_get(&t0, TIME_UTC);
+        if (mlp_forward(&model, x, &hidden_f32, &logits_f32, false, &env) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+        timespec_get(&t1, TIME_UTC);
+        if (mlp_int8_forward(&model_int8, x, &hidden_int8, &logits_int8) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+        timespec_get(&t2, TIME_UTC);
+
+        seconds_f32 += elapsed_seconds(&t0, &t1);
+        seconds_int8 += elapsed_seconds(&t1, &t2);
+        correct_f32 += count_correct(logits_f32, y);
+        correct_int8 += count_correct(logits_int8, y);
+
+        cgrad_env_free_intermediates(&env);
+        tensor_free(&env, x);
+        tensor_free(&env, y);
+        tensor_free(&env, hidden_f32);
+        tensor_free(&env, logits_f32);
+        tensor_free(&env, hidden_int8);
+        tensor_free(&env, logits_int8);
+    }
+
+    const double rows = (double)train_set->rows;
+    printf("float32 - accuracy: %.4f, throughput: %.0f samples/s\n", correct_f32 / rows, rows / seconds_f32);
+    printf("int8    - accuracy: %.4f, throughput: %.0f samples/s\n", correct_int8 / rows, rows / seconds_int8);
+
+    // Cleanup
+    linear_int8_cleanup(&model_int8.linear1);
+    linear_int8_cleanup(&model_int8.linear2);
+    sgd_optimizer_cleanup(&opt);
+    linear_cleanup(&model.linear1);
+    linear_cleanup(&model.linear2);
+    indexes_batch_free(ixs_batch);
+    cgrad_env_cleanup(&env);
+    return EXIT_SUCCESS;
+}
+
+static cgrad_error mlp_forward(struct mlp *const model, struct tensor *const x, struct tensor **const hidden, struct tensor **const logits, const bool track_grad, struct cgrad_env *const env)
+{
+    struct tensor *h1 = NULL;
+    cgrad_error err = linear_forward(&model->linear1, x, &h1, track_grad);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = tensor_list_add(env->tensor_alloc_intermediates, h1)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = relu_forward(h1, hidden, track_grad, env)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    return linear_forward(&model->linear2, *hidden, logits, track_grad);
+}
+
+static cgrad_error mlp_int8_forward(struct mlp_int8 *const model, struct tensor *const x, struct tensor **const hidden, struct tensor **const logits)
+{
+    cgrad_error err = linear_int8_forward(&model->linear1, x, hidden);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    return linear_int8_forward(&model->linear2, *hidden, logits);
+}
+
+static size_t count_correct(const struct tensor *const logits, const struct tensor *const y)
+{
+    const float *logits_data = logits->data;
+    const float *y_data = y->data;
+    const size_t num_classes = logits->shape[1];
+
+    size_t correct = 0;
+    for (size_t i = 0; i < logits->shape[0]; i++)
+    {
+        size_t predicted = 0;
+        for (size_t j = 1; j < num_classes; j++)
+        {
+            predicted = logits_data[i * num_classes + j] > logits_data[i * num_classes + predicted] ? j : predicted;
+        }
+        correct += predicted == (size_t)y_data[i];
+    }
+
+    return correct;
+}
+
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end)
+{
+    return (double)(end->tv_sec - start->tv_sec) + (double)(end->tv_nsec - start->tv_nsec) * 1e-9;
+}
@@ -0,0 +1,232 @@
+#include "cgrad/cgrad_env.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/parallel/allreduce.h"
+#include "cgrad/parallel/process_group.h"
+#include "cgrad/parallel/shm_allreduce.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_get.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_permutation.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define OUTPUT_ITERATION_FREQ 25
+
+#define GLOBAL_BATCH_SIZE 64
+#define INPUT_DIM 784
+#define HIDDEN_DIM 512
+#define NUM_CLASSES 10
+
+// Gradients larger than a slot are summed in several pieces
+#define SLOT_SIZE (4 * 1024 * 1024)
+
+struct training_job
+{
+    const struct csv_dataset *train_set;
+    const char *segment_name;
+};
+
+static cgrad_error train_worker(const size_t rank, const size_t world_size, void *arg);
+
+int main(int argc, char **argv)
+{
+    if (argc != 2 && argc != 3)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path> [n_processes]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const size_t n_processes = argc == 3 ? strtoul(argv[2], NULL, 10) : 2;
+    if (n_processes == 0 || GLOBAL_BATCH_SIZE % n_processes != 0)
+    {
+        fprintf(stderr, "The number of processes must divide the batch size %d.\n", GLOBAL_BATCH_SIZE);
+        return EXIT_FAILURE;
+    }
+
+    // Loaded once, the processes share its pages after the fork
+    struct csv_dataset *train_set = csv_dataset_alloc(argv[1]);
+    if (!train_set)
+    {
+        fprintf(stderr, "Error while trying to open %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    if (csv_dataset_standard_scale(train_set) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    char segment_name[64];
+    snprintf(segment_name, sizeof(segment_name), "/cgrad_mnist_%d", getpid());
+    if (shm_allreduce_create(segment_name, n_processes, SLOT_SIZE) != NO_ERROR)
+    {
+        fprintf(stderr, "Error while trying to create the shared memory segment.\n");
+        return EXIT_FAILURE;
+    }
+
+    struct training_job job = {.train_set = train_set, .segment_name = segment_name};
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    cgrad_error err = process_group_launch(n_processes, &train_worker, &job);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    shm_allreduce_unlink(segment_name);
+
+    if (err != NO_ERROR)
+    {
+        fprintf(stderr, "Training failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("Trained with %ld processes in %.2f s\n", n_processes, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+    return EXIT_SUCCESS;
+}
+
+static cgrad_error train_worker(const size_t rank, const size_t world_size, void *arg)
+{
+    const struct training_job *job = arg;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const size_t BATCH_SIZE = GLOBAL_BATCH_SIZE / world_size;
+
+    // Every process starts from the same weights, the identical summed gradients keep them equal
+    struct cgrad_env env;
+    if (cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) != NO_ERROR)
+    {
+        return CGRAD_ENV_NULL;
+    }
+
+    struct allreduce_backend backend;
+    cgrad_error err;
+    if ((err = shm_allreduce_init(&backend, job->segment_name, rank)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Allocate model
+    struct linear linear1;
+    struct linear linear2;
+    if ((err = linear_init(&linear1, INPUT_DIM, HIDDEN_DIM, DTYPE, &env)) != NO_ERROR ||
+        (err = linear_xavier_init(&linear1)) != NO_ERROR ||
+        (err = linear_init(&linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE, &env)) != NO_ERROR ||
+        (err = linear_xavier_init(&linear2)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct model_params params;
+    model_params_init(&params);
+    model_params_add(&params, linear1.weight);
+    model_params_add(&params, linear1.bias);
+    model_params_add(&params, linear2.weight);
+    model_params_add(&params, linear2.bias);
+
+    struct sgd_optimizer opt;
+    if ((err = sgd_optimizer_init(&opt, &params, 3e-4, 0.9, false, &env)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    // Equal contiguous shards, so that all the processes run the same number of iterations
+    const size_t shard_size = job->train_set->rows / world_size;
+    const size_t shard_begin = rank * shard_size;
+
+    struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
+    struct indexes_permutation *permutation = indexes_permutation_alloc(shard_size);
+    if (!ixs_batch || !permutation || (err = indexes_permutation_init(permutation)) != NO_ERROR)
+    {
+        return INDEXES_PERMUTATION_NULL;
+    }
+
+    size_t iteration = 0;
+    while (!index_permutation_is_terminated(permutation))
+    {
+        size_t remaining = index_permutation_get_remaining(permutation);
+        size_t iter_batch_size = remaining < BATCH_SIZE ? remaining : BATCH_SIZE;
+
+        if ((err = indexes_permutation_sample_index_batch(permutation, ixs_batch, iter_batch_size)) != NO_ERROR)
+        {
+            return err;
+        }
+        for (size_t i = 0; i < ixs_batch->size; i++)
+        {
+            ixs_batch->indexes[i] += shard_begin;
+        }
+
+        struct tensor *x = NULL;
+        struct tensor *y = NULL;
+        if ((err = csv_dataset_sample_batch(job->train_set, &x, &y, ixs_batch, DTYPE, &env)) != NO_ERROR)
+        {
+            return err;
+        }
+
+        // ------------- Forward -------------
+        struct tensor *h1 = NULL;
+        struct tensor *h2 = NULL;
+        struct tensor *h3 = NULL;
+        struct tensor *z = NULL;
+        if ((err = linear_forward(&linear1, x, &h1, true)) != NO_ERROR ||
+            (err = relu_forward(h1, &h2, true, &env)) != NO_ERROR ||
+            (err = linear_forward(&linear2, h2, &h3, true)) != NO_ERROR ||
+            (err = cross_entropy_loss(h3, y, &z, true, &env)) != NO_ERROR)
+        {
+            return err;
+        }
+
+        // ------------- Backward -------------
+        sgd_optimizer_zero_grad(&opt);
+        if ((err = backward(z, &env)) != NO_ERROR)
+        {
+            return err;
+        }
+
+        // Every process holds an equal share of the global batch
+        if ((err = allreduce_grads(&backend, &params, 1.0 / world_size)) != NO_ERROR)
+        {
+            return err;
+        }
+        sgd_optimizer_step(&opt);
+
+        if (iteration % OUTPUT_ITERATION_FREQ == 0)
+        {
+            float local_loss;
+            tensor2d_get(z, 0, 0, &local_loss);
+            double loss = local_loss / world_size;
+            if ((err = allreduce_sum(&backend, &loss, 1, DTYPE_FLOAT64)) != NO_ERROR)
+            {
+                return err;
+            }
+            if (rank == 0)
+            {
+                printf("iteration %04ld - loss: %f\n", iteration, loss);
+            }
+        }
+
+        // Clear iteration allocations
+        cgrad_env_free_intermediates(&env);
+        tensor_free(&env, x);
+        tensor_free(&env, y);
+        tensor_free(&env, h1);
+        tensor_free(&env, h2);
+        tensor_free(&env, h3);
+        tensor_free(&env, z);
+
+        index_permutation_update(permutation, iter_batch_size);
+        iteration++;
+    }
+
+    // Cleanup
+    sgd_optimizer_cleanup(&opt);
+    linear_cleanup(&linear1);
+    linear_cleanup(&linear2);
+    indexes_batch_free(ixs_batch);
+    allreduce_cleanup(&backend);
+    cgrad_env_cleanup(&env);
+    return NO_ERROR;
+}
@@ -0,0 +1,277 @@
+#include "cgrad/cgrad_env.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/autograd/execution_plan/execution_plan.h"
+#include "cgrad/autograd/execution_plan/execution_plan_memory.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor.h"
+#include "cgrad/tensor/tensor_get.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_permutation.h"
+#include "cgrad/utils/random.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+
+#define OUTPUT_ITERATION_FREQ 25
+
+struct mlp_step
+{
+    struct tensor *x;
+    struct tensor *y;
+    struct tensor *h1;
+    struct tensor *h2;
+    struct tensor *h3;
+    struct tensor *z;
+};
+
+static cgrad_error mlp_step_forward(struct linear *const linear1, struct linear *const linear2, struct mlp_step *const step, struct cgrad_env *const env);
+static void mlp_step_free(struct mlp_step *const step, struct cgrad_env *const env);
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s <mnist_train_dataset_path>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    if (cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    const size_t BATCH_SIZE = 64;
+    const size_t INPUT_DIM = 784;
+    const size_t HIDDEN_DIM = 512;
+    const size_t NUM_CLASSES = 10;
+
+    // Can be downloaded from https://www.kaggle.com/datasets/oddrationale/mnist-in-csv
+    struct csv_dataset *train_set = csv_dataset_alloc(argv[1]);
+    if (!train_set)
+    {
+        fprintf(stderr, "Error while trying to open %s.\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (csv_dataset_standard_scale(train_set) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Allocate model
+    struct linear linear1;
+    if (linear_init(&linear1, INPUT_DIM, HIDDEN_DIM, DTYPE, &env) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear1) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct linear linear2;
+    if (linear_init(&linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE, &env) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (linear_xavier_init(&linear2) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup model params
+    struct model_params params;
+    model_params_init(&params);
+    model_params_add(&params, linear1.weight);
+    model_params_add(&params, linear1.bias);
+    model_params_add(&params, linear2.weight);
+    model_params_add(&params, linear2.bias);
+
+    // Setup optimizer
+    double lr = 3e-4;
+    double momentum = 0.9;
+    struct sgd_optimizer opt;
+
+    if (sgd_optimizer_init(&opt, &params, lr, momentum, false, &env) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Setup indexes batch container. In this case, the container's capacity is the batch size.
+    struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
+    if (!ixs_batch)
+    {
+        return EXIT_FAILURE;
+    }
+
+    /**
+     * The training step is recorded on the first full batch and replayed on the following ones,
+     * sampling each batch directly into the captured input tensors. The last partial batch has a
+     * different shape, hence it falls back to a regular eager step.
+     */
+    struct execution_plan plan;
+    struct mlp_step captured = {0};
+    bool is_captured = false;
+    size_t replayed_steps = 0;
+    size_t eager_steps = 0;
+
+    size_t epochs = 1;
+    for (size_t epoch = 0; epoch < epochs; epoch++)
+    {
+        struct indexes_permutation *permutation = indexes_permutation_alloc(train_set->rows);
+        if (!permutation)
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (indexes_permutation_init(permutation) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+
+        size_t iteration = 0;
+        while (!index_permutation_is_terminated(permutation))
+        {
+            size_t remaining = index_permutation_get_remaining(permutation);
+            size_t iter_batch_size = remaining < BATCH_SIZE ? remaining : BATCH_SIZE;
+
+            // Sample batch indeces
+            if (indexes_permutation_sample_index_batch(permutation, ixs_batch, iter_batch_size) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+
+            struct tensor *z = NULL;
+            sgd_optimizer_zero_grad(&opt);
+
+            if (is_captured && iter_batch_size == BATCH_SIZE)
+            {
+                // ------------- Replay -------------
+                if (csv_dataset_sample_batch_into(train_set, captured.x, captured.y, ixs_batch) != NO_ERROR)
+                {
+                    return EXIT_FAILURE;
+                }
+                if (execution_plan_replay(&plan) != NO_ERROR)
+                {
+                    return EXIT_FAILURE;
+                }
+                z = captured.z;
+                replayed_steps++;
+            }
+            else
+            {
+                // ------------- Eager step, captured on the first full batch -------------
+                struct mlp_step step = {0};
+                if (csv_dataset_sample_batch(train_set, &step.x, &step.y, ixs_batch, DTYPE, &env) != NO_ERROR)
+                {
+                    return EXIT_FAILURE;
+                }
+                if (mlp_step_forward(&linear1, &linear2, &step, &env) != NO_ERROR)
+                {
+                    return EXIT_FAILURE;
+                }
+
+                if (!is_captured && iter_batch_size == BATCH_SIZE)
+                {
+                    if (execution_plan_capture(&plan, step.z, &env) != NO_ERROR)
+                    {
+                        return EXIT_FAILURE;
+                    }
+                    captured = step;
+                    is_captured = true;
+                    z = captured.z;
+
+                    // Intermediates and gradients of the captured step share buffers from now on
+                    struct execution_plan_memory_stats stats;
+                    if (execution_plan_plan_memory(&plan, &stats) != NO_ERROR)
+                    {
+                        return EXIT_FAILURE;
+                    }
+                    printf("Planned %ld tensors into %ld buffers: %ld bytes instead of %ld (peak live %ld bytes)\n",
+                           stats.n_tensors, stats.n_buffers, stats.planned_bytes, stats.naive_bytes, stats.peak_live_bytes);
+                }
+                else
+                {
+                    backward(step.z, &env);
+                    float loss;
+                    tensor2d_get(step.z, 0, 0, &loss);
+                    printf("epoch %02ld, iteration %04ld - eager step loss: %f\n", epoch, iteration, loss);
+
+                    cgrad_env_free_intermediates(&env);
+                    mlp_step_free(&step, &env);
+                }
+                eager_steps++;
+            }
+
+            if (z && iteration % OUTPUT_ITERATION_FREQ == 0)
+            {
+                float loss;
+                tensor2d_get(z, 0, 0, &loss);
+                printf("epoch %02ld, iteration %04ld - loss: %f\n", epoch, iteration, loss);
+            }
+
+            sgd_optimizer_step(&opt);
+
+            index_permutation_update(permutation, iter_batch_size);
+            iteration++;
+        }
+    }
+
+    printf("Replayed steps: %ld, eager steps: %ld\n", replayed_steps, eager_steps);
+
+    // Cleanup
+    if (is_captured)
+    {
+        // The captured tensors still live in the shared buffers if the plan could not give them their own
+        if (execution_plan_cleanup(&plan) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+        mlp_step_free(&captured, &env);
+    }
+    sgd_optimizer_cleanup(&opt);
+    linear_cleanup(&linear1);
+    linear_cleanup(&linear2);
+    indexes_batch_free(ixs_batch);
+    cgrad_env_cleanup(&env);
+    return EXIT_SUCCESS;
+}
+
+static cgrad_error mlp_step_forward(struct linear *const linear1, struct linear *const linear2, struct mlp_step *const step, struct cgrad_env *const env)
+{
+    cgrad_error err = NO_ERROR;
+    if ((err = linear_forward(linear1, step->x, &step->h1, true)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = relu_forward(step->h1, &step->h2, true, env)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = linear_forward(linear2, step->h2, &step->h3, true)) != NO_ERROR)
+    {
+        return err;
+    }
+    return cross_entropy_loss(step->h3, step->y, &step->z, true, env);
+}
+
+static void mlp_step_free(struct mlp_step *const step, struct cgrad_env *const env)
+{
+    tensor_free(env, step->x);
+    tensor_free(env, step->y);
+    tensor_free(env, step->h1);
+    tensor_free(env, step->h2);
+    tensor_free(env, step->h3);
+    tensor_free(env, step->z);
+}
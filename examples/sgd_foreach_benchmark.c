@@ -0,0 +1,223 @@
+#include "cgrad/cgrad_env.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_axpy.h"
+#include "cgrad/tensor/tensor_scalar_mult_tensor_add.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct sgd_case
+{
+    const char *name;
+    size_t n_layers;
+    size_t width;
+};
+
+static cgrad_error run_case(const struct sgd_case *const c, const size_t iterations, struct cgrad_env *const env);
+static cgrad_error build_model(struct model_params *const params, const struct sgd_case *const c, struct cgrad_env *const env);
+static cgrad_error add_param(struct model_params *const params, const size_t *const shape, const size_t shape_size, const size_t seed, struct cgrad_env *const env);
+static void legacy_step(struct model_params *const params, struct tensor **const prev_b_t, const double lr, const double momentum, struct cgrad_env *const env);
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end);
+
+int main(int argc, char **argv)
+{
+    if (argc > 3)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s [n_threads] [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const size_t n_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+    const size_t iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : 200;
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    if (cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) != NO_ERROR || cgrad_env_set_num_threads(&env, n_threads) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Linear layers of width x width weights and width biases, from many small layers to a few large ones
+    const struct sgd_case CASES[] = {
+        {"32 layers of width 16", 32, 16},
+        {"32 layers of width 64", 32, 64},
+        {"16 layers of width 256", 16, 256},
+        {"4 layers of width 1024", 4, 1024},
+    };
+
+    printf("%ld threads, %ld iterations, float32\n", n_threads, iterations);
+    for (size_t c = 0; c < sizeof(CASES) / sizeof(CASES[0]); c++)
+    {
+        if (run_case(&CASES[c], iterations, &env) != NO_ERROR)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    cgrad_env_cleanup(&env);
+    return EXIT_SUCCESS;
+}
+
+static cgrad_error run_case(const struct sgd_case *const c, const size_t iterations, struct cgrad_env *const env)
+{
+    const double LR = 0.01;
+    const double MOMENTUM = 0.9;
+
+    // The same model is updated per tensor as before, then rebuilt and updated with a single foreach pass, since
+    // the tensor pool cannot hold both at once
+    struct model_params params;
+    cgrad_error err = build_model(&params, c, env);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    struct tensor *prev_b_t[MODEL_MAX_PARAMS];
+    for (size_t i = 0; i < params.size; i++)
+    {
+        const struct tensor *const param = params.params[i];
+        prev_b_t[i] = tensor_no_grad_zero_alloc(env, param->shape, param->shape_size, param->dtype);
+        if (!prev_b_t[i])
+        {
+            return TENSOR_ALLOCATION_FAILED;
+        }
+    }
+
+    // The gradients are kept across steps, so that the momentum does not decay into denormals
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t it = 0; it < iterations; it++)
+    {
+        legacy_step(&params, prev_b_t, LR, MOMENTUM, env);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double legacy_seconds = elapsed_seconds(&start, &end) / iterations;
+
+    size_t n_elements = 0;
+    for (size_t i = 0; i < params.size; i++)
+    {
+        n_elements += params.params[i]->data_size;
+    }
+    float *expected = (float *)malloc(n_elements * sizeof(float));
+    if (!expected)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+    for (size_t i = 0, offset = 0; i < params.size; offset += params.params[i]->data_size, i++)
+    {
+        memcpy(expected + offset, params.params[i]->data, params.params[i]->data_size * sizeof(float));
+        tensor_no_grad_free(env, prev_b_t[i]);
+        tensor_free(env, params.params[i]);
+    }
+
+    struct sgd_optimizer opt;
+    if ((err = build_model(&params, c, env)) != NO_ERROR || (err = sgd_optimizer_init(&opt, &params, LR, MOMENTUM, false, env)) != NO_ERROR)
+    {
+        free(expected);
+        return err;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t it = 0; it < iterations && err == NO_ERROR; it++)
+    {
+        err = sgd_optimizer_step(&opt);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double seconds = elapsed_seconds(&start, &end) / iterations;
+
+    double max_diff = 0.0;
+    for (size_t i = 0, offset = 0; i < params.size; offset += params.params[i]->data_size, i++)
+    {
+        const float *const actual = (const float *)params.params[i]->data;
+        for (size_t j = 0; j < params.params[i]->data_size; j++)
+        {
+            max_diff = fmax(max_diff, fabs((double)expected[offset + j] - actual[j]));
+        }
+    }
+
+    if (err == NO_ERROR)
+    {
+        printf("%-24s %3ld tensors, %8ld elements | per tensor: %8.1f us | foreach: %8.1f us | speedup %5.1fx | max diff %.1e\n", c->name,
+               params.size, n_elements, legacy_seconds * 1e6, seconds * 1e6, legacy_seconds / seconds, max_diff);
+    }
+
+    free(expected);
+    sgd_optimizer_cleanup(&opt);
+    for (size_t i = 0; i < params.size; i++)
+    {
+        tensor_free(env, params.params[i]);
+    }
+
+    return err;
+}
+
+static cgrad_error build_model(struct model_params *const params, const struct sgd_case *const c, struct cgrad_env *const env)
+{
+    model_params_init(params);
+    for (size_t l = 0; l < c->n_layers; l++)
+    {
+        const size_t weight_shape[] = {c->width, c->width};
+        const size_t bias_shape[] = {1, c->width};
+        cgrad_error err = add_param(params, weight_shape, 2, 2 * l, env);
+        if (err == NO_ERROR)
+        {
+            err = add_param(params, bias_shape, 2, 2 * l + 1, env);
+        }
+        if (err != NO_ERROR)
+        {
+            return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+static cgrad_error add_param(struct model_params *const params, const size_t *const shape, const size_t shape_size, const size_t seed, struct cgrad_env *const env)
+{
+    struct tensor *param = tensor_alloc(env, shape, shape_size, DTYPE_FLOAT32);
+    if (!param)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+    cgrad_error err = tensor_alloc_grad(env, param);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    for (size_t i = 0; i < param->data_size; i++)
+    {
+        ((float *)param->data)[i] = (float)((seed * 31 + i * 7) % 17) / 17.0f - 0.5f;
+        ((float *)param->grad->data)[i] = (float)((seed + i) % 5) / 5.0f - 0.4f;
+    }
+
+    return model_params_add(params, param);
+}
+
+/**
+ * The former sgd_optimizer_step: one momentum tensor allocated and two kernels dispatched per parameter.
+ */
+static void legacy_step(struct model_params *const params, struct tensor **const prev_b_t, const double lr, const double momentum, struct cgrad_env *const env)
+{
+    for (size_t i = 0; i < params->size; i++)
+    {
+        struct tensor *param = params->params[i];
+        struct tensor *b_t = tensor_no_grad_alloc(env, prev_b_t[i]->shape, prev_b_t[i]->shape_size, prev_b_t[i]->dtype);
+
+        // b_t <- momentum * b_t-1 + g_t, param <- param - lr * b_t
+        tensor_scalar_mult_tensor_add(prev_b_t[i], param->grad, momentum, b_t);
+        tensor_axpy(b_t, param, -lr);
+
+        tensor_no_grad_free(env, prev_b_t[i]);
+        prev_b_t[i] = b_t;
+    }
+}
+
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
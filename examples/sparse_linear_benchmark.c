@@ -0,0 +1,156 @@
+#include "cgrad/cgrad_env.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_batch.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/model/model_params.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static cgrad_error run_iteration(struct linear *const layer, struct model_params *const params, const struct csv_dataset *const dataset, const struct indexes_batch *const ixs_batch, const bool sparse, double *const loss, struct cgrad_env *const env);
+static void fill_dataset(struct csv_dataset *const dataset, const double density, const size_t n_classes);
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end);
+
+int main(int argc, char **argv)
+{
+    if (argc > 3)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s [n_threads] [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const size_t n_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+    const size_t iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : 20;
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const size_t BATCH_SIZE = 128;
+    const size_t N_FEATURES = 8192;
+    const size_t N_CLASSES = 64;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    if (cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) != NO_ERROR || cgrad_env_set_num_threads(&env, n_threads) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    struct linear layer;
+    struct model_params params;
+    model_params_init(&params);
+    if (linear_init(&layer, N_FEATURES, N_CLASSES, DTYPE, &env) != NO_ERROR || linear_xavier_init(&layer) != NO_ERROR ||
+        model_params_add(&params, layer.weight) != NO_ERROR || model_params_add(&params, layer.bias) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // A single batch of a synthetic dataset, with label first as in the CSV files
+    struct csv_dataset dataset = {.rows = BATCH_SIZE, .cols = N_FEATURES + 1};
+    dataset.data = malloc(dataset.rows * dataset.cols * sizeof(double));
+    struct indexes_batch *ixs_batch = indexes_batch_alloc(BATCH_SIZE);
+    if (!dataset.data || !ixs_batch)
+    {
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+    {
+        ixs_batch->indexes[i] = i;
+    }
+    ixs_batch->size = BATCH_SIZE;
+
+    // Sampling, forward and backward of a linear input layer, on the densified and on the sparse batch
+    const double DENSITIES[] = {0.001, 0.01, 0.1, 0.5};
+    printf("%ld threads, batch of %ld x %ld features, %ld outputs, float32\n", n_threads, BATCH_SIZE, N_FEATURES, N_CLASSES);
+    for (size_t d = 0; d < sizeof(DENSITIES) / sizeof(DENSITIES[0]); d++)
+    {
+        fill_dataset(&dataset, DENSITIES[d], N_CLASSES);
+
+        double seconds[2];
+        double losses[2];
+        for (size_t sparse = 0; sparse < 2; sparse++)
+        {
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (size_t it = 0; it < iterations; it++)
+            {
+                if (run_iteration(&layer, &params, &dataset, ixs_batch, sparse, &losses[sparse], &env) != NO_ERROR)
+                {
+                    return EXIT_FAILURE;
+                }
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            seconds[sparse] = elapsed_seconds(&start, &end) / iterations;
+        }
+
+        printf("density %5.1f%% | dense: %8.3f ms | sparse: %8.3f ms | speedup %6.1fx | loss diff %.1e\n", DENSITIES[d] * 100.0,
+               seconds[0] * 1e3, seconds[1] * 1e3, seconds[0] / seconds[1], fabs(losses[0] - losses[1]));
+    }
+
+    free(dataset.data);
+    indexes_batch_free(ixs_batch);
+    linear_cleanup(&layer);
+    cgrad_env_cleanup(&env);
+    return EXIT_SUCCESS;
+}
+
+static cgrad_error run_iteration(struct linear *const layer, struct model_params *const params, const struct csv_dataset *const dataset, const struct indexes_batch *const ixs_batch, const bool sparse, double *const loss, struct cgrad_env *const env)
+{
+    struct tensor *x = NULL;
+    struct sparse_tensor sparse_x = {0};
+    struct tensor *y = NULL;
+    struct tensor *logits = NULL;
+    struct tensor *z = NULL;
+
+    cgrad_error err = NO_ERROR;
+    if (sparse)
+    {
+        if ((err = csv_dataset_sample_batch_sparse(dataset, &sparse_x, &y, ixs_batch, DTYPE_FLOAT32, env)) == NO_ERROR)
+        {
+            err = linear_forward_sparse(layer, &sparse_x, &logits, true);
+        }
+    }
+    else
+    {
+        if ((err = csv_dataset_sample_batch(dataset, &x, &y, ixs_batch, DTYPE_FLOAT32, env)) == NO_ERROR)
+        {
+            err = linear_forward(layer, x, &logits, true);
+        }
+    }
+
+    if (err == NO_ERROR && (err = cross_entropy_loss(logits, y, &z, true, env)) == NO_ERROR)
+    {
+        model_params_zero_grad(params);
+        err = backward(z, env);
+        *loss = ((float *)z->data)[0];
+    }
+
+    cgrad_env_free_intermediates(env);
+    sparse_tensor_free(&sparse_x, env);
+    tensor_free(env, x);
+    tensor_free(env, y);
+    tensor_free(env, logits);
+    tensor_free(env, z);
+
+    return err;
+}
+
+static void fill_dataset(struct csv_dataset *const dataset, const double density, const size_t n_classes)
+{
+    srand(0);
+    for (size_t i = 0; i < dataset->rows; i++)
+    {
+        double *row = dataset->data + i * dataset->cols;
+        row[0] = (double)(i % n_classes);
+        for (size_t j = 1; j < dataset->cols; j++)
+        {
+            row[j] = (double)rand() / RAND_MAX < density ? (double)rand() / RAND_MAX : 0.0;
+        }
+    }
+}
+
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
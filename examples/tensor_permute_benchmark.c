@@ -0,0 +1,168 @@
+#include "cgrad/cgrad_env.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_permute.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct permute_case
+{
+    const char *name;
+    size_t shape[4];
+    size_t shape_size;
+    size_t perm[4];
+};
+
+static cgrad_error run_case(const struct permute_case *const c, const cgrad_dtype dtype, const size_t iterations, struct cgrad_env *const env);
+static void legacy_permute(const struct tensor *const t, const size_t *const perm, struct tensor *const out);
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end);
+
+int main(int argc, char **argv)
+{
+    if (argc > 3)
+    {
+        fprintf(stderr, "Wrong number of parameters. Usage:\n %s [n_threads] [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const size_t n_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+    const size_t iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : 20;
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    if (cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) != NO_ERROR || cgrad_env_set_num_threads(&env, n_threads) != NO_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // The transpositions of the conv2d forward pass, for a batch of 16 images of 28x28 and 32 kernels of 3x3
+    const struct permute_case CASES[] = {
+        {"kernel {32, 9} -> {9, 32}", {32, 9}, 2, {1, 0}},
+        {"patches {10816, 32} -> {32, 10816}", {10816, 32}, 2, {1, 0}},
+        {"output {32, 16, 26, 26} -> {16, 32, 26, 26}", {32, 16, 26, 26}, 4, {1, 0, 2, 3}},
+        {"NCHW {16, 32, 26, 26} -> NHWC", {16, 32, 26, 26}, 4, {0, 2, 3, 1}},
+        {"square {1000, 1000} -> {1000, 1000}", {1000, 1000}, 2, {1, 0}},
+    };
+    const cgrad_dtype DTYPES[] = {DTYPE_FLOAT32, DTYPE_FLOAT64};
+
+    printf("%ld threads, %ld iterations\n", n_threads, iterations);
+    for (size_t d = 0; d < sizeof(DTYPES) / sizeof(DTYPES[0]); d++)
+    {
+        printf("\n%s\n", DTYPES[d] == DTYPE_FLOAT32 ? "float32" : "float64");
+        for (size_t c = 0; c < sizeof(CASES) / sizeof(CASES[0]); c++)
+        {
+            if (run_case(&CASES[c], DTYPES[d], iterations, &env) != NO_ERROR)
+            {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    cgrad_env_cleanup(&env);
+    return EXIT_SUCCESS;
+}
+
+static cgrad_error run_case(const struct permute_case *const c, const cgrad_dtype dtype, const size_t iterations, struct cgrad_env *const env)
+{
+    size_t out_shape[4];
+    for (size_t i = 0; i < c->shape_size; i++)
+    {
+        out_shape[i] = c->shape[c->perm[i]];
+    }
+
+    struct tensor *t = tensor_alloc(env, c->shape, c->shape_size, dtype);
+    struct tensor *out = tensor_alloc(env, out_shape, c->shape_size, dtype);
+    struct tensor *expected = tensor_alloc(env, out_shape, c->shape_size, dtype);
+    if (!t || !out || !expected)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+
+    for (size_t i = 0; i < t->data_size; i++)
+    {
+        if (dtype == DTYPE_FLOAT32)
+        {
+            ((float *)t->data)[i] = (float)i;
+        }
+        else
+        {
+            ((double *)t->data)[i] = (double)i;
+        }
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t it = 0; it < iterations; it++)
+    {
+        legacy_permute(t, c->perm, expected);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double legacy_seconds = elapsed_seconds(&start, &end) / iterations;
+
+    cgrad_error err = NO_ERROR;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t it = 0; it < iterations && err == NO_ERROR; it++)
+    {
+        err = tensor_permute_into(t, c->perm, out, env->pool);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double seconds = elapsed_seconds(&start, &end) / iterations;
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    const size_t bytes = t->data_size * dtype_sizeof(dtype);
+    const bool matches = memcmp(out->data, expected->data, bytes) == 0;
+    printf("%-46s per element: %8.1f us | blocked: %8.1f us, %5.1f GB/s | speedup %5.1fx%s\n", c->name,
+           legacy_seconds * 1e6, seconds * 1e6, 2.0 * bytes / seconds / 1e9, legacy_seconds / seconds, matches ? "" : " MISMATCH");
+
+    tensor_free(env, t);
+    tensor_free(env, out);
+    tensor_free(env, expected);
+    return matches ? NO_ERROR : TENSOR_DATA_SIZE_MISMATCH;
+}
+
+/**
+ * The former tensor_trans kernel, generalized to any permutation: the offsets of both tensors are recomputed
+ * over every axis for each element.
+ */
+static void legacy_permute(const struct tensor *const t, const size_t *const perm, struct tensor *const out)
+{
+    size_t idx[TENSOR_MAX_SHAPE_SIZE] = {0};
+    for (size_t d = 0; d < t->data_size; d++)
+    {
+        size_t t_offset = 0;
+        size_t out_offset = 0;
+        for (size_t i = 0; i < t->shape_size; i++)
+        {
+            t_offset += idx[i] * t->stride[i];
+            out_offset += idx[perm[i]] * out->stride[i];
+        }
+
+        if (t->dtype == DTYPE_FLOAT32)
+        {
+            ((float *)out->data)[out_offset] = ((const float *)t->data)[t_offset];
+        }
+        else
+        {
+            ((double *)out->data)[out_offset] = ((const double *)t->data)[t_offset];
+        }
+
+        for (size_t i = t->shape_size; i-- > 0;)
+        {
+            if (++idx[i] < t->shape[i])
+            {
+                break;
+            }
+            idx[i] = 0;
+        }
+    }
+}
+
+static double elapsed_seconds(const struct timespec *const start, const struct timespec *const end)
+{
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
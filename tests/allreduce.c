@@ -0,0 +1,202 @@
+#include "cgrad_test/assert.h"
+#include "cgrad_test/config.h"
+#include "cgrad_test/test_result.h"
+#include "cgrad_test/test_case.h"
+#include "cgrad_test/datastructures/test_list/test_list.h"
+#include "cgrad_test/datastructures/test_list/test_list_callbacks.h"
+#include "cgrad_test/run_tests.h"
+#include "cgrad/parallel/allreduce.h"
+#include "cgrad/parallel/process_group.h"
+#include "cgrad/parallel/shm_allreduce.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/cgrad_env.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+#define WORLD_SIZE 3
+
+// Small slots, so that buffers are summed in several pieces
+#define SLOT_SIZE 256
+
+void shm_allreduce_test_sum(struct test_result *);
+void shm_allreduce_test_grads(struct test_result *);
+void process_group_test_worker_failure(struct test_result *);
+
+static cgrad_error sum_worker(const size_t rank, const size_t world_size, void *arg);
+static cgrad_error grads_worker(const size_t rank, const size_t world_size, void *arg);
+static cgrad_error failing_worker(const size_t rank, const size_t world_size, void *arg);
+
+int main(int argc, char **argv)
+{
+    struct test_list *tests = tests_list_alloc();
+    test_list_append(tests, &shm_allreduce_test_sum, "shm_allreduce_test_sum");
+    test_list_append(tests, &shm_allreduce_test_grads, "shm_allreduce_test_grads");
+    test_list_append(tests, &process_group_test_worker_failure, "process_group_test_worker_failure");
+
+    run_tests(tests);
+
+    size_t num_failed_tests = 0;
+    test_list_foreach(tests, &report_failures, &num_failed_tests);
+
+    size_t num_passed_tests = tests->size - num_failed_tests;
+    float percentage_passed_tests = ((float)num_passed_tests / (float)tests->size) * 100.0;
+    float percentage_failed_tests = ((float)num_failed_tests / (float)tests->size) * 100.0;
+
+    printf("Number of tests: %ld\n", tests->size);
+    printf("Number of passed tests: %ld (%.2f \%)\n", num_passed_tests, percentage_passed_tests);
+    printf("Number of failed tests: %ld (%.2f \%)\n", num_failed_tests, percentage_failed_tests);
+
+    return EXIT_SUCCESS;
+}
+
+void shm_allreduce_test_sum(struct test_result *result)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/cgrad_test_sum_%d", getpid());
+
+    ASSERT_TRUE(shm_allreduce_create(name, WORLD_SIZE, SLOT_SIZE) == NO_ERROR, "Segment creation failed.");
+    const cgrad_error err = process_group_launch(WORLD_SIZE, &sum_worker, name);
+    shm_allreduce_unlink(name);
+    ASSERT_TRUE(err == NO_ERROR, "Every process should receive the sum of the buffers.");
+
+test_cleanup:
+}
+
+void shm_allreduce_test_grads(struct test_result *result)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/cgrad_test_grads_%d", getpid());
+
+    ASSERT_TRUE(shm_allreduce_create(name, WORLD_SIZE, SLOT_SIZE) == NO_ERROR, "Segment creation failed.");
+    const cgrad_error err = process_group_launch(WORLD_SIZE, &grads_worker, name);
+    shm_allreduce_unlink(name);
+    ASSERT_TRUE(err == NO_ERROR, "Every process should receive the mean of the gradients.");
+
+test_cleanup:
+}
+
+void process_group_test_worker_failure(struct test_result *result)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/cgrad_test_failure_%d", getpid());
+
+    // The other processes wait for the failed one in their first sum, they must be killed
+    ASSERT_TRUE(shm_allreduce_create(name, WORLD_SIZE, SLOT_SIZE) == NO_ERROR, "Segment creation failed.");
+    const cgrad_error err = process_group_launch(WORLD_SIZE, &failing_worker, name);
+    shm_allreduce_unlink(name);
+    ASSERT_TRUE(err == PROCESS_GROUP_WORKER_FAILED, "The failure of a process should be reported.");
+
+test_cleanup:
+}
+
+static cgrad_error sum_worker(const size_t rank, const size_t world_size, void *arg)
+{
+    struct allreduce_backend backend;
+    cgrad_error err = shm_allreduce_init(&backend, arg, rank);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    const size_t N = 1000;
+    float data_f32[1000];
+    double data_f64[1000];
+    for (size_t i = 0; i < N; i++)
+    {
+        data_f32[i] = rank + 0.5f * i;
+        data_f64[i] = rank * 0.25 - (double)i;
+    }
+
+    if ((err = allreduce_sum(&backend, data_f32, N, DTYPE_FLOAT32)) != NO_ERROR ||
+        (err = allreduce_sum(&backend, data_f64, N, DTYPE_FLOAT64)) != NO_ERROR)
+    {
+        allreduce_cleanup(&backend);
+        return err;
+    }
+
+    // Sums of ranks 0, 1 and 2, exact in floating point
+    for (size_t i = 0; i < N; i++)
+    {
+        if (data_f32[i] != 3.0f + 1.5f * i || data_f64[i] != 0.75 - 3.0 * i)
+        {
+            err = TENSOR_DATA_SIZE_MISMATCH;
+        }
+    }
+
+    allreduce_cleanup(&backend);
+    return err;
+}
+
+static cgrad_error grads_worker(const size_t rank, const size_t world_size, void *arg)
+{
+    struct cgrad_env env;
+    struct allreduce_backend backend;
+    cgrad_error err;
+    if ((err = cgrad_env_init(&env, 42, 20)) != NO_ERROR)
+    {
+        return err;
+    }
+    if ((err = shm_allreduce_init(&backend, arg, rank)) != NO_ERROR)
+    {
+        cgrad_env_cleanup(&env);
+        return err;
+    }
+
+    const size_t weight_shape[] = {7, 9};
+    const size_t bias_shape[] = {1, 9};
+    struct tensor *weight = tensor_alloc(&env, weight_shape, 2, DTYPE_FLOAT32);
+    struct tensor *bias = tensor_alloc(&env, bias_shape, 2, DTYPE_FLOAT32);
+    struct model_params params;
+    model_params_init(&params);
+    model_params_add(&params, weight);
+    model_params_add(&params, bias);
+    tensor_alloc_grad(&env, weight);
+    tensor_alloc_grad(&env, bias);
+
+    for (size_t i = 0; i < weight->data_size; i++)
+    {
+        ((float *)weight->grad->data)[i] = (rank + 1) * 3.0f;
+    }
+    for (size_t i = 0; i < bias->data_size; i++)
+    {
+        ((float *)bias->grad->data)[i] = -(float)rank * 3.0f;
+    }
+
+    if ((err = allreduce_grads(&backend, &params, 1.0 / world_size)) == NO_ERROR)
+    {
+        for (size_t i = 0; i < weight->data_size; i++)
+        {
+            err = fabsf(((float *)weight->grad->data)[i] - 6.0f) > 1e-5f ? TENSOR_DATA_SIZE_MISMATCH : err;
+        }
+        for (size_t i = 0; i < bias->data_size; i++)
+        {
+            err = fabsf(((float *)bias->grad->data)[i] + 3.0f) > 1e-5f ? TENSOR_DATA_SIZE_MISMATCH : err;
+        }
+    }
+
+    allreduce_cleanup(&backend);
+    cgrad_env_cleanup(&env);
+    return err;
+}
+
+static cgrad_error failing_worker(const size_t rank, const size_t world_size, void *arg)
+{
+    if (rank == 1)
+    {
+        return ALLREDUCE_INIT_FAILED;
+    }
+
+    struct allreduce_backend backend;
+    cgrad_error err = shm_allreduce_init(&backend, arg, rank);
+    if (err != NO_ERROR)
+    {
+        return err;
+    }
+
+    double value = 1.0;
+    err = allreduce_sum(&backend, &value, 1, DTYPE_FLOAT64);
+    allreduce_cleanup(&backend);
+    return err;
+}
@@ -0,0 +1,1091 @@
+#include "cgrad_test/assert.h"
+#include "cgrad_test/config.h"
+#include "cgrad_test/test_result.h"
+#include "cgrad_test/test_case.h"
+#include "cgrad_test/datastructures/test_list/test_list.h"
+#include "cgrad_test/datastructures/test_list/test_list_callbacks.h"
+#include "cgrad_test/run_tests.h"
+#include "cgrad/config.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/autograd/checkpoint/checkpoint.h"
+#include "cgrad/autograd/execution_plan/execution_plan.h"
+#include "cgrad/autograd/execution_plan/execution_plan_memory.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/layers/embedding.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/mse.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/optimizers/grad_accumulator.h"
+#include "cgrad/optimizers/loss_scaler.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/tensor/tensor_add.h"
+#include "cgrad/tensor/tensor2d_add_row_vector.h"
+#include "cgrad/tensor/tensor2d_mult.h"
+#include "cgrad/tensor/tensor_cast.h"
+#include "cgrad/tensor/tensor_reshape.h"
+#include "cgrad/tensor/tensor_equality.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+void lazy_grad_test_alloc_without_grad(struct test_result *);
+void lazy_grad_test_alloc_grad_zeroed(struct test_result *);
+void lazy_grad_test_backward_instance_1(struct test_result *);
+void execution_plan_test_replay_instance_1(struct test_result *);
+void execution_plan_test_capture_rollback(struct test_result *);
+void execution_plan_test_plan_memory_instance_1(struct test_result *);
+void checkpoint_test_recompute_instance_1(struct test_result *);
+void checkpoint_test_recompute_failure(struct test_result *);
+void mixed_precision_test_backward_instance_1(struct test_result *);
+void requires_grad_test_backward_instance_1(struct test_result *);
+void backward_test_release_intermediates(struct test_result *);
+void backward_test_fused_optimizer_step(struct test_result *);
+void grad_accumulator_test_micro_batches(struct test_result *);
+void embedding_test_sparse_sgd_step(struct test_result *);
+void embedding_test_tied_weight(struct test_result *);
+static void *failing_data_alloc(void *pool, const size_t size);
+
+// Data allocations succeeding before failing_data_alloc fails, through real_data_alloc
+static data_alloc_fn real_data_alloc;
+static size_t n_data_allocs_left;
+
+int main(int argc, char **argv)
+{
+    struct test_list *tests = tests_list_alloc();
+    test_list_append(tests, &lazy_grad_test_alloc_without_grad, "lazy_grad_test_alloc_without_grad");
+    test_list_append(tests, &lazy_grad_test_alloc_grad_zeroed, "lazy_grad_test_alloc_grad_zeroed");
+    test_list_append(tests, &lazy_grad_test_backward_instance_1, "lazy_grad_test_backward_instance_1");
+    test_list_append(tests, &execution_plan_test_replay_instance_1, "execution_plan_test_replay_instance_1");
+    test_list_append(tests, &execution_plan_test_capture_rollback, "execution_plan_test_capture_rollback");
+    test_list_append(tests, &execution_plan_test_plan_memory_instance_1, "execution_plan_test_plan_memory_instance_1");
+    test_list_append(tests, &checkpoint_test_recompute_instance_1, "checkpoint_test_recompute_instance_1");
+    test_list_append(tests, &checkpoint_test_recompute_failure, "checkpoint_test_recompute_failure");
+    test_list_append(tests, &mixed_precision_test_backward_instance_1, "mixed_precision_test_backward_instance_1");
+    test_list_append(tests, &requires_grad_test_backward_instance_1, "requires_grad_test_backward_instance_1");
+    test_list_append(tests, &backward_test_release_intermediates, "backward_test_release_intermediates");
+    test_list_append(tests, &backward_test_fused_optimizer_step, "backward_test_fused_optimizer_step");
+    test_list_append(tests, &grad_accumulator_test_micro_batches, "grad_accumulator_test_micro_batches");
+    test_list_append(tests, &embedding_test_sparse_sgd_step, "embedding_test_sparse_sgd_step");
+    test_list_append(tests, &embedding_test_tied_weight, "embedding_test_tied_weight");
+
+    run_tests(tests);
+
+    size_t num_failed_tests = 0;
+    test_list_foreach(tests, &report_failures, &num_failed_tests);
+
+    size_t num_passed_tests = tests->size - num_failed_tests;
+    float percentage_passed_tests = ((float)num_passed_tests / (float)tests->size) * 100.0;
+    float percentage_failed_tests = ((float)num_failed_tests / (float)tests->size) * 100.0;
+
+    printf("Number of tests: %ld\n", tests->size);
+    printf("Number of passed tests: %ld (%.2f \%)\n", num_passed_tests, percentage_passed_tests);
+    printf("Number of failed tests: %ld (%.2f \%)\n", num_failed_tests, percentage_failed_tests);
+
+    return EXIT_SUCCESS;
+}
+
+void lazy_grad_test_alloc_without_grad(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t shape[] = {2, 2};
+    struct tensor *t = tensor_alloc(&env, shape, 2, DTYPE);
+    ASSERT_TRUE(t, "Allocation failed.");
+    ASSERT_TRUE(!t->grad, "Grad should not be allocated eagerly.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void lazy_grad_test_alloc_grad_zeroed(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t shape[] = {3, 2};
+    const double zeros[] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    struct tensor *t = tensor_alloc(&env, shape, 2, DTYPE);
+    struct tensor *expected_grad = tensor_from_array_alloc(&env, zeros, shape, 2, DTYPE);
+
+    ASSERT_TRUE(tensor_alloc_grad(&env, t) == NO_ERROR, "Grad allocation failed.");
+    ASSERT_TRUE(tensor_no_grad_equal(t->grad, expected_grad), "Grad should be zeroed.");
+
+    struct tensor *grad = t->grad;
+    ASSERT_TRUE(tensor_alloc_grad(&env, t) == NO_ERROR && t->grad == grad, "Grad should not be reallocated.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void lazy_grad_test_backward_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t shape[] = {2, 1};
+    const float t1_data[] = {1.0, 2.0};
+    struct tensor *t1 = tensor_from_array_alloc(&env, t1_data, shape, 2, DTYPE);
+
+    const float t2_data[] = {0.0, 1.0};
+    struct tensor *t2 = tensor_from_array_alloc(&env, t2_data, shape, 2, DTYPE);
+
+    const float target_data[] = {0.0, 1.0};
+    struct tensor *target = tensor_from_array_alloc(&env, target_data, shape, 2, DTYPE);
+
+    struct tensor *unused = tensor_from_array_alloc(&env, t1_data, shape, 2, DTYPE);
+
+    const float expected_grad_data[] = {0.5, 1.0};
+    struct tensor *expected_grad = tensor_from_array_alloc(&env, expected_grad_data, shape, 2, DTYPE);
+
+    struct tensor *out = NULL;
+    ASSERT_TRUE(tensor_add(t1, t2, &out, true, &env) == NO_ERROR, "Add failed.");
+
+    struct tensor *z = NULL;
+    ASSERT_TRUE(mse_loss(out, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+    ASSERT_TRUE(!t1->grad && !out->grad && !z->grad, "Grad allocated before backward.");
+
+    ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward failed.");
+    ASSERT_TRUE(tensor_no_grad_equal(t1->grad, expected_grad), "Wrong gradient.");
+    ASSERT_TRUE(!unused->grad, "Grad allocated for unused tensor.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void execution_plan_test_replay_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct execution_plan plan;
+    plan.is_captured = false;
+
+    const size_t shape[] = {2, 1};
+    const float t1_data[] = {1.0, 2.0};
+    struct tensor *t1 = tensor_from_array_alloc(&env, t1_data, shape, 2, DTYPE);
+
+    const float t2_data[] = {0.0, 1.0};
+    struct tensor *t2 = tensor_from_array_alloc(&env, t2_data, shape, 2, DTYPE);
+
+    const float target_data[] = {0.0, 1.0};
+    struct tensor *target = tensor_from_array_alloc(&env, target_data, shape, 2, DTYPE);
+
+    const float new_t1_data[] = {2.0, 3.0};
+    struct tensor *new_t1 = tensor_from_array_alloc(&env, new_t1_data, shape, 2, DTYPE);
+
+    const float expected_captured_grad_data[] = {0.5, 1.0};
+    struct tensor *expected_captured_grad = tensor_from_array_alloc(&env, expected_captured_grad_data, shape, 2, DTYPE);
+
+    const float expected_replayed_grad_data[] = {1.0, 1.5};
+    struct tensor *expected_replayed_grad = tensor_from_array_alloc(&env, expected_replayed_grad_data, shape, 2, DTYPE);
+
+    const size_t other_shape[] = {1, 2};
+    struct tensor *other = tensor_from_array_alloc(&env, new_t1_data, other_shape, 2, DTYPE);
+
+    struct tensor *out = NULL;
+    ASSERT_TRUE(tensor_add(t1, t2, &out, true, &env) == NO_ERROR, "Add failed.");
+
+    struct tensor *z = NULL;
+    ASSERT_TRUE(mse_loss(out, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+
+    ASSERT_TRUE(execution_plan_capture(&plan, z, &env) == NO_ERROR, "Capture failed.");
+    ASSERT_TRUE(tensor_no_grad_equal(t1->grad, expected_captured_grad), "Wrong gradient after capture.");
+
+    ASSERT_TRUE(execution_plan_feed(&plan, t1, other) == EXECUTION_PLAN_SHAPE_MISMATCH, "Feed should reject a different shape.");
+    ASSERT_TRUE(csv_dataset_sample_batch_into(NULL, t1, target, NULL) == DATASET_NULL, "Sampling into a plan from a NULL dataset should fail.");
+    ASSERT_TRUE(execution_plan_feed(&plan, t1, new_t1) == NO_ERROR, "Feed failed.");
+
+    memset(t1->grad->data, 0, t1->grad->data_size * dtype_sizeof(t1->grad->dtype));
+    ASSERT_TRUE(execution_plan_replay(&plan) == NO_ERROR, "Replay failed.");
+    ASSERT_TRUE(tensor_no_grad_equal(t1->grad, expected_replayed_grad), "Wrong gradient after replay.");
+
+test_cleanup:
+    execution_plan_cleanup(&plan);
+    cgrad_env_cleanup(&env);
+}
+
+void execution_plan_test_capture_rollback(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct execution_plan plan;
+    plan.is_captured = false;
+    struct tensor *fillers[MEMORY_TENSOR_POOL_N_CHUNKS];
+    size_t n_fillers = 0;
+
+    const double values[] = {0.5, -1.0, 2.0, 1.5, 0.0, -0.5};
+    const size_t x_shape[] = {2, 3};
+    const size_t w_shape[] = {3, 1};
+    const size_t b_shape[] = {2, 1};
+    struct tensor *x = tensor_from_array_alloc(&env, values, x_shape, 2, DTYPE);
+    struct tensor *w = tensor_from_array_alloc(&env, values + 1, w_shape, 2, DTYPE);
+    struct tensor *b = tensor_from_array_alloc(&env, values + 2, b_shape, 2, DTYPE);
+    struct tensor *target = tensor_from_array_alloc(&env, values + 3, b_shape, 2, DTYPE);
+    ASSERT_TRUE(x && w && b && target, "Tensor allocation failed.");
+
+    struct tensor *h = NULL, *out = NULL, *z = NULL;
+    ASSERT_TRUE(tensor2d_mult(x, w, &h, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(tensor_add(h, b, &out, true, &env) == NO_ERROR, "Add failed.");
+    ASSERT_TRUE(mse_loss(out, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+
+    // The gradients are allocated upfront, so that the capture only allocates the temporaries of the leaves
+    struct tensor *const graph[] = {x, w, b, target, h, out, z};
+    for (size_t i = 0; i < 7; i++)
+    {
+        ASSERT_TRUE(tensor_alloc_grad(&env, graph[i]) == NO_ERROR, "Gradient allocation failed.");
+    }
+
+    // The pool is left with a single chunk, taken by the first temporary
+    const size_t filler_shape[] = {1};
+    while (n_fillers < MEMORY_TENSOR_POOL_N_CHUNKS && (fillers[n_fillers] = tensor_no_grad_alloc(&env, filler_shape, 1, DTYPE)))
+    {
+        n_fillers++;
+    }
+    tensor_no_grad_free(&env, fillers[--n_fillers]);
+
+    ASSERT_TRUE(execution_plan_capture(&plan, z, &env) == TENSOR_ALLOCATION_FAILED, "Capture should fail when the pool is exhausted.");
+    ASSERT_TRUE(!plan.is_captured, "A failed capture should not hold a plan.");
+    fillers[n_fillers] = tensor_no_grad_alloc(&env, filler_shape, 1, DTYPE);
+    ASSERT_TRUE(fillers[n_fillers++], "A failed capture should release its temporaries.");
+
+    // The graph is left as recorded
+    while (n_fillers > 0)
+    {
+        tensor_no_grad_free(&env, fillers[--n_fillers]);
+    }
+    ASSERT_TRUE(backward(z, &env) == NO_ERROR, "The graph of a failed capture should still be backpropagated.");
+    ASSERT_TRUE(fabs(((double *)b->grad->data)[0] - 0.5) < 1e-12, "Wrong gradient after a failed capture.");
+
+test_cleanup:
+    execution_plan_cleanup(&plan);
+    cgrad_env_cleanup(&env);
+}
+
+void execution_plan_test_plan_memory_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct execution_plan plan;
+    plan.is_captured = false;
+
+    double values[32];
+    for (size_t i = 0; i < 32; i++)
+    {
+        values[i] = (double)((i * 7) % 11) / 11.0 - 0.5;
+    }
+
+    const size_t x_shape[] = {4, 3};
+    const size_t w1_shape[] = {3, 5};
+    const size_t b1_shape[] = {1, 5};
+    const size_t w2_shape[] = {5, 2};
+    const size_t target_shape[] = {8, 1};
+    struct tensor *x = tensor_from_array_alloc(&env, values, x_shape, 2, DTYPE);
+    struct tensor *w1 = tensor_from_array_alloc(&env, values + 1, w1_shape, 2, DTYPE);
+    struct tensor *b1 = tensor_from_array_alloc(&env, values + 2, b1_shape, 2, DTYPE);
+    struct tensor *w2 = tensor_from_array_alloc(&env, values + 3, w2_shape, 2, DTYPE);
+    struct tensor *target = tensor_from_array_alloc(&env, values + 4, target_shape, 2, DTYPE);
+
+    // Linear, ReLU, linear, then reshape to a column for the MSE loss
+    struct tensor *h1 = NULL, *h2 = NULL, *h3 = NULL, *h4 = NULL, *h5 = NULL, *z = NULL;
+    ASSERT_TRUE(tensor2d_mult(x, w1, &h1, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(tensor2d_add_row_vector(h1, b1, &h2, true, &env) == NO_ERROR, "Add row vector failed.");
+    ASSERT_TRUE(relu_forward(h2, &h3, true, &env) == NO_ERROR, "ReLU failed.");
+    ASSERT_TRUE(tensor2d_mult(h3, w2, &h4, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(tensor_reshape(h4, target_shape, 2, &h5, true, &env) == NO_ERROR, "Reshape failed.");
+    ASSERT_TRUE(mse_loss(h5, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+
+    ASSERT_TRUE(execution_plan_capture(&plan, z, &env) == NO_ERROR, "Capture failed.");
+
+    double expected_loss = ((double *)z->data)[0];
+    struct tensor *expected_w1_grad = tensor_from_array_alloc(&env, w1->grad->data, w1_shape, 2, DTYPE);
+    struct tensor *expected_b1_grad = tensor_from_array_alloc(&env, b1->grad->data, b1_shape, 2, DTYPE);
+    struct tensor *expected_w2_grad = tensor_from_array_alloc(&env, w2->grad->data, w2_shape, 2, DTYPE);
+
+    struct execution_plan_memory_stats stats;
+    ASSERT_TRUE(execution_plan_plan_memory(&plan, &stats) == NO_ERROR, "Memory planning failed.");
+    ASSERT_TRUE(execution_plan_plan_memory(&plan, NULL) == EXECUTION_PLAN_MEMORY_ALREADY_PLANNED, "Memory should not be planned twice.");
+    ASSERT_TRUE(stats.n_buffers < stats.n_tensors, "Planned tensors should share buffers.");
+    ASSERT_TRUE(stats.peak_live_bytes <= stats.planned_bytes && stats.planned_bytes < stats.naive_bytes, "Wrong memory statistics.");
+    ASSERT_TRUE(h5->data == h4->data, "Reshape should reuse the buffer of its operand.");
+
+    memset(w1->grad->data, 0, w1->grad->data_size * sizeof(double));
+    memset(b1->grad->data, 0, b1->grad->data_size * sizeof(double));
+    memset(w2->grad->data, 0, w2->grad->data_size * sizeof(double));
+
+    ASSERT_TRUE(execution_plan_replay(&plan) == NO_ERROR, "Replay failed.");
+    ASSERT_TRUE(((double *)z->data)[0] == expected_loss, "Wrong loss after replay.");
+    ASSERT_TRUE(tensor_no_grad_equal(w1->grad, expected_w1_grad), "Wrong gradient after replay.");
+    ASSERT_TRUE(tensor_no_grad_equal(b1->grad, expected_b1_grad), "Wrong gradient after replay.");
+    ASSERT_TRUE(tensor_no_grad_equal(w2->grad, expected_w2_grad), "Wrong gradient after replay.");
+
+    // A cleanup which cannot give the planned tensors their own buffers keeps the shared ones
+    real_data_alloc = env.tensor_alloc.data_alloc;
+    n_data_allocs_left = 0;
+    env.tensor_alloc.data_alloc = &failing_data_alloc;
+    cgrad_error err = execution_plan_cleanup(&plan);
+    env.tensor_alloc.data_alloc = real_data_alloc;
+    ASSERT_TRUE(err == TENSOR_ALLOCATION_FAILED, "Cleanup should report the failed allocation.");
+    ASSERT_TRUE(plan.is_captured && h5->data == h4->data, "A failed cleanup should leave the plan as it was.");
+    ASSERT_TRUE(execution_plan_replay(&plan) == NO_ERROR, "Replay failed.");
+    ASSERT_TRUE(((double *)z->data)[0] == expected_loss, "Wrong loss after replay.");
+    ASSERT_TRUE(execution_plan_cleanup(&plan) == NO_ERROR, "Cleanup failed.");
+    ASSERT_TRUE(h5->data != h4->data, "Planned tensors should own their data after the cleanup.");
+
+test_cleanup:
+    execution_plan_cleanup(&plan);
+    cgrad_env_cleanup(&env);
+}
+
+static void *failing_data_alloc(void *pool, const size_t size)
+{
+    if (n_data_allocs_left == 0)
+    {
+        return NULL;
+    }
+
+    n_data_allocs_left--;
+    return real_data_alloc(pool, size);
+}
+
+void checkpoint_test_recompute_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    double values[32];
+    for (size_t i = 0; i < 32; i++)
+    {
+        values[i] = (double)((i * 5) % 13) / 13.0 - 0.5;
+    }
+
+    const size_t x_shape[] = {4, 3};
+    const size_t w1_shape[] = {3, 5};
+    const size_t b1_shape[] = {1, 5};
+    const size_t w2_shape[] = {5, 1};
+    const size_t target_shape[] = {4, 1};
+    struct tensor *x = tensor_from_array_alloc(&env, values, x_shape, 2, DTYPE);
+    struct tensor *w1 = tensor_from_array_alloc(&env, values + 1, w1_shape, 2, DTYPE);
+    struct tensor *b1 = tensor_from_array_alloc(&env, values + 2, b1_shape, 2, DTYPE);
+    struct tensor *w2 = tensor_from_array_alloc(&env, values + 3, w2_shape, 2, DTYPE);
+    struct tensor *target = tensor_from_array_alloc(&env, values + 4, target_shape, 2, DTYPE);
+
+    struct tensor *expected_w1_grad = NULL;
+    struct tensor *expected_b1_grad = NULL;
+
+    // The first pass stores every activation, the second one recomputes the hidden layer
+    const checkpoint_policy policies[] = {CHECKPOINT_POLICY_STORE, CHECKPOINT_POLICY_RECOMPUTE};
+    for (size_t p = 0; p < 2; p++)
+    {
+        ASSERT_TRUE(checkpoint_set_policy(&env, policies[p]) == NO_ERROR, "Setting the policy failed.");
+
+        struct tensor *h1 = NULL, *h2 = NULL, *h3 = NULL, *h4 = NULL, *z = NULL;
+        ASSERT_TRUE(checkpoint_begin(&env, x) == NO_ERROR, "Checkpoint begin failed.");
+        ASSERT_TRUE(tensor2d_mult(x, w1, &h1, true, &env) == NO_ERROR, "Mult failed.");
+        ASSERT_TRUE(tensor2d_add_row_vector(h1, b1, &h2, true, &env) == NO_ERROR, "Add row vector failed.");
+        ASSERT_TRUE(relu_forward(h2, &h3, true, &env) == NO_ERROR, "ReLU failed.");
+        ASSERT_TRUE(checkpoint_begin(&env, h3) == CHECKPOINT_SEGMENT_ALREADY_ACTIVE, "Segments should not nest.");
+        ASSERT_TRUE(checkpoint_end(&env, h3) == NO_ERROR, "Checkpoint end failed.");
+        ASSERT_TRUE(tensor2d_mult(h3, w2, &h4, true, &env) == NO_ERROR, "Mult failed.");
+        ASSERT_TRUE(mse_loss(h4, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+
+        if (policies[p] == CHECKPOINT_POLICY_RECOMPUTE)
+        {
+            ASSERT_TRUE(!h1->data && !h2->data && h3->data, "Only the segment output should be kept.");
+        }
+
+        ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward failed.");
+
+        if (policies[p] == CHECKPOINT_POLICY_STORE)
+        {
+            expected_w1_grad = tensor_from_array_alloc(&env, w1->grad->data, w1_shape, 2, DTYPE);
+            expected_b1_grad = tensor_from_array_alloc(&env, b1->grad->data, b1_shape, 2, DTYPE);
+            ASSERT_TRUE(checkpoint_get_stats(&env)->released_bytes == 0, "Nothing should be released.");
+        }
+        else
+        {
+            ASSERT_TRUE(tensor_no_grad_equal(w1->grad, expected_w1_grad), "Wrong gradient after recomputation.");
+            ASSERT_TRUE(tensor_no_grad_equal(b1->grad, expected_b1_grad), "Wrong gradient after recomputation.");
+
+            const struct checkpoint_stats *stats = checkpoint_get_stats(&env);
+            ASSERT_TRUE(stats->n_recomputed_segments == 1, "The segment should be recomputed once.");
+            ASSERT_TRUE(stats->released_bytes == 2 * 4 * 5 * sizeof(double) && stats->recomputed_bytes == stats->released_bytes, "Wrong checkpoint statistics.");
+        }
+
+        memset(w1->grad->data, 0, w1->grad->data_size * sizeof(double));
+        memset(b1->grad->data, 0, b1->grad->data_size * sizeof(double));
+        tensor_free(&env, h1);
+        tensor_free(&env, h2);
+        tensor_free(&env, h3);
+        tensor_free(&env, h4);
+        tensor_free(&env, z);
+    }
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void checkpoint_test_recompute_failure(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const double values[] = {0.5, -1.0, 2.0, 1.5, 0.25, -0.75, 0.1, -0.2, 0.3};
+    const size_t x_shape[] = {3, 3};
+    const size_t w_shape[] = {3, 1};
+    struct tensor *x = tensor_from_array_alloc(&env, values, x_shape, 2, DTYPE);
+    struct tensor *w = tensor_from_array_alloc(&env, values + 3, w_shape, 2, DTYPE);
+    struct tensor *target = tensor_from_array_alloc(&env, values + 6, w_shape, 2, DTYPE);
+
+    struct tensor *h1 = NULL, *h2 = NULL, *h3 = NULL, *z = NULL;
+    ASSERT_TRUE(checkpoint_begin(&env, x) == NO_ERROR, "Checkpoint begin failed.");
+    ASSERT_TRUE(tensor2d_mult(x, x, &h1, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(relu_forward(h1, &h2, true, &env) == NO_ERROR, "ReLU failed.");
+    ASSERT_TRUE(tensor2d_mult(h2, w, &h3, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(checkpoint_end(&env, h3) == NO_ERROR, "Checkpoint end failed.");
+    ASSERT_TRUE(mse_loss(h3, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+    ASSERT_TRUE(!h1->data && !h2->data, "The segment should be released.");
+
+    // The first node of the segment is recomputed, then the buffer of the second one cannot be allocated
+    real_data_alloc = env.tensor_alloc.data_alloc;
+    n_data_allocs_left = 1;
+    env.tensor_alloc.data_alloc = &failing_data_alloc;
+    cgrad_error err = backward(z, &env);
+    env.tensor_alloc.data_alloc = real_data_alloc;
+    ASSERT_TRUE(err == TENSOR_ALLOCATION_FAILED, "Backward should report the failed allocation.");
+    ASSERT_TRUE(n_data_allocs_left == 0 && !h1->data && !h2->data, "A failed recomputation should release the segment.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void mixed_precision_test_backward_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const double LOSS_SCALE = 1024.0;
+    const float TOLERANCE = 1e-2;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t x_shape[] = {2, 3};
+    const size_t w_shape[] = {3, 2};
+    const size_t target_shape[] = {2, 1};
+    const float x_data[] = {0.5, -1.0, 2.0, 1.5, 0.25, -0.75};
+    const float w_data[] = {0.1, -0.2, 0.3, 0.4, -0.5, 0.6};
+    const float target_data[] = {0.0, 1.0};
+    struct tensor *x = tensor_from_array_alloc(&env, x_data, x_shape, 2, DTYPE_FLOAT32);
+    struct tensor *x_half_input = tensor_from_array_alloc(&env, x_data, x_shape, 2, DTYPE_FLOAT32);
+    struct tensor *w = tensor_from_array_alloc(&env, w_data, w_shape, 2, DTYPE_FLOAT32);
+    struct tensor *target = tensor_from_array_alloc(&env, target_data, target_shape, 2, DTYPE_FLOAT32);
+
+    // Reference float32 gradient
+    struct tensor *logits = NULL, *z = NULL;
+    ASSERT_TRUE(tensor2d_mult(x, w, &logits, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(cross_entropy_loss(logits, target, &z, true, &env) == NO_ERROR, "Cross entropy failed.");
+    ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward failed.");
+
+    // Same step with float16 weights, a float32 input and a scaled loss
+    struct tensor *w_half = NULL, *x_half = NULL, *logits_half = NULL, *z_half = NULL, *w_half_grad = NULL;
+    ASSERT_TRUE(tensor_cast(w, DTYPE_FLOAT16, &w_half, false, &env) == NO_ERROR, "Cast failed.");
+    ASSERT_TRUE(tensor_cast(x_half_input, DTYPE_FLOAT16, &x_half, true, &env) == NO_ERROR, "Cast failed.");
+    ASSERT_TRUE(tensor2d_mult(x_half, w_half, &logits_half, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(cross_entropy_loss(logits_half, target, &z_half, true, &env) == NO_ERROR, "Cross entropy failed.");
+    ASSERT_TRUE(z_half->dtype == DTYPE_FLOAT32, "The loss of half precision logits should be float32.");
+    ASSERT_TRUE(backward_with_seed(z_half, LOSS_SCALE, &env) == NO_ERROR, "Backward failed.");
+
+    ASSERT_TRUE(w_half->grad->dtype == DTYPE_FLOAT16, "The gradient should have the dtype of its tensor.");
+    ASSERT_TRUE(x_half_input->grad->dtype == DTYPE_FLOAT32, "The gradient should be cast back to the input dtype.");
+    ASSERT_TRUE(tensor_cast(w_half->grad, DTYPE_FLOAT32, &w_half_grad, false, &env) == NO_ERROR, "Cast failed.");
+
+    for (size_t i = 0; i < w->grad->data_size; i++)
+    {
+        const float expected = ((float *)w->grad->data)[i] * LOSS_SCALE;
+        const float actual = ((float *)w_half_grad->data)[i];
+        ASSERT_TRUE(fabsf(actual - expected) <= TOLERANCE * fabsf(expected), "Half precision gradient too far from the float32 one.");
+    }
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void requires_grad_test_backward_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct execution_plan plan;
+    plan.is_captured = false;
+
+    double values[16];
+    for (size_t i = 0; i < 16; i++)
+    {
+        values[i] = (double)((i * 5) % 7) / 7.0 - 0.5;
+    }
+
+    const size_t x_shape[] = {2, 6};
+    const size_t x_view_shape[] = {4, 3};
+    const size_t w_shape[] = {3, 1};
+    const size_t target_shape[] = {4, 1};
+    struct tensor *x = tensor_from_array_alloc(&env, values, x_shape, 2, DTYPE);
+    struct tensor *x_grad = tensor_from_array_alloc(&env, values, x_shape, 2, DTYPE);
+    struct tensor *new_x = tensor_from_array_alloc(&env, values + 2, x_shape, 2, DTYPE);
+    struct tensor *w = tensor_from_array_alloc(&env, values + 1, w_shape, 2, DTYPE);
+    struct tensor *target = tensor_from_array_alloc(&env, values + 3, target_shape, 2, DTYPE);
+    tensor_set_requires_grad(x, false);
+    tensor_set_requires_grad(target, false);
+
+    // Reference gradients, computed with an input requiring a gradient
+    struct tensor *h1 = NULL, *h2 = NULL, *z = NULL;
+    ASSERT_TRUE(tensor_reshape(x_grad, x_view_shape, 2, &h1, true, &env) == NO_ERROR, "Reshape failed.");
+    ASSERT_TRUE(tensor2d_mult(h1, w, &h2, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(mse_loss(h2, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+    ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward failed.");
+    ASSERT_TRUE(x_grad->grad, "Input requiring a gradient should receive one.");
+    struct tensor *expected_w_grad = tensor_from_array_alloc(&env, w->grad->data, w_shape, 2, DTYPE);
+    memset(w->grad->data, 0, w->grad->data_size * sizeof(double));
+
+    // The reshape result does not require a gradient, so neither the input nor the target receive one
+    ASSERT_TRUE(tensor_reshape(x, x_view_shape, 2, &h1, true, &env) == NO_ERROR, "Reshape failed.");
+    ASSERT_TRUE(tensor2d_mult(h1, w, &h2, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(mse_loss(h2, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+    ASSERT_TRUE(!x->node && !h1->requires_grad && h2->requires_grad, "Wrong requires_grad propagation.");
+
+    ASSERT_TRUE(execution_plan_capture(&plan, z, &env) == NO_ERROR, "Capture failed.");
+    ASSERT_TRUE(!x->grad && !h1->grad && !target->grad, "Gradient computed for a tensor not requiring it.");
+    ASSERT_TRUE(tensor_no_grad_equal(w->grad, expected_w_grad), "Wrong gradient after capture.");
+
+    // The reshape result is recomputed from the fed input during replays
+    ASSERT_TRUE(execution_plan_feed(&plan, x, new_x) == NO_ERROR, "Feed failed.");
+    memset(w->grad->data, 0, w->grad->data_size * sizeof(double));
+    ASSERT_TRUE(execution_plan_replay(&plan) == NO_ERROR, "Replay failed.");
+    struct tensor *replayed_w_grad = tensor_from_array_alloc(&env, w->grad->data, w_shape, 2, DTYPE);
+
+    memset(w->grad->data, 0, w->grad->data_size * sizeof(double));
+    struct tensor *h3 = NULL, *h4 = NULL, *z2 = NULL;
+    ASSERT_TRUE(tensor_reshape(new_x, x_view_shape, 2, &h3, true, &env) == NO_ERROR, "Reshape failed.");
+    ASSERT_TRUE(tensor2d_mult(h3, w, &h4, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(mse_loss(h4, target, &z2, true, &env) == NO_ERROR, "MSE failed.");
+    ASSERT_TRUE(backward(z2, &env) == NO_ERROR, "Backward failed.");
+    ASSERT_TRUE(tensor_no_grad_equal(w->grad, replayed_w_grad), "Wrong gradient after replay.");
+    ASSERT_TRUE(((double *)z->data)[0] == ((double *)z2->data)[0], "Wrong loss after replay.");
+
+test_cleanup:
+    execution_plan_cleanup(&plan);
+    cgrad_env_cleanup(&env);
+}
+
+void backward_test_release_intermediates(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 1;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    double values[16];
+    for (size_t i = 0; i < 16; i++)
+    {
+        values[i] = (double)((i * 3) % 7) / 7.0 - 0.5;
+    }
+
+    const size_t x_shape[] = {4, 3};
+    const size_t w_shape[] = {3, 1};
+    const size_t target_shape[] = {4, 1};
+    struct tensor *x = tensor_from_array_alloc(&env, values, x_shape, 2, DTYPE);
+    struct tensor *w = tensor_from_array_alloc(&env, values + 1, w_shape, 2, DTYPE);
+    struct tensor *target = tensor_from_array_alloc(&env, values + 2, target_shape, 2, DTYPE);
+
+    struct tensor *expected_w_grad = NULL;
+    for (size_t run = 0; run < 2; run++)
+    {
+        struct tensor *h1 = NULL, *h2 = NULL, *h3 = NULL, *z = NULL;
+        ASSERT_TRUE(tensor2d_mult(x, w, &h1, true, &env) == NO_ERROR, "Mult failed.");
+        ASSERT_TRUE(relu_forward(h1, &h2, true, &env) == NO_ERROR, "ReLU failed.");
+        ASSERT_TRUE(tensor_add(h2, h1, &h3, true, &env) == NO_ERROR, "Add failed.");
+        ASSERT_TRUE(mse_loss(h3, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+
+        // The second run hands the activations to the environment, beyond the capacity of its list
+        if (run == 1)
+        {
+            ASSERT_TRUE(tensor_list_add(env.tensor_alloc_intermediates, h1) == NO_ERROR, "Add to intermediates failed.");
+            ASSERT_TRUE(tensor_list_add(env.tensor_alloc_intermediates, h3) == NO_ERROR, "Add to intermediates failed.");
+        }
+
+        w->grad = NULL;
+        ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward failed.");
+        ASSERT_TRUE(z->data && h2->data && h2->grad, "Tensors not in the intermediates should be kept.");
+        if (run == 0)
+        {
+            expected_w_grad = w->grad;
+            ASSERT_TRUE(h1->data && h1->grad && h3->data, "Tensors not in the intermediates should be kept.");
+        }
+        else
+        {
+            ASSERT_TRUE(!h1->data && !h1->grad && !h3->data && !h3->grad, "Intermediates should be released by backward.");
+            ASSERT_TRUE(tensor_no_grad_equal(w->grad, expected_w_grad), "Releasing intermediates should not change the gradients.");
+        }
+    }
+    ASSERT_TRUE(cgrad_env_free_intermediates(&env) == NO_ERROR, "Freeing intermediates failed.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void backward_test_fused_optimizer_step(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+    const size_t STEPS = 3;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    double values[32];
+    for (size_t i = 0; i < 32; i++)
+    {
+        values[i] = (double)((i * 5) % 11) / 11.0 - 0.5;
+    }
+
+    const size_t x_shape[] = {4, 3};
+    const size_t w1_shape[] = {3, 5};
+    const size_t b1_shape[] = {1, 5};
+    const size_t w2_shape[] = {5, 1};
+    const size_t target_shape[] = {4, 1};
+    struct tensor *x = tensor_from_array_alloc(&env, values, x_shape, 2, DTYPE);
+    struct tensor *target = tensor_from_array_alloc(&env, values + 4, target_shape, 2, DTYPE);
+    tensor_set_requires_grad(x, false);
+    tensor_set_requires_grad(target, false);
+
+    // The same model trained with separate steps, then with the update fused into backward
+    struct tensor *weights[2][3];
+    struct model_params params[2];
+    struct sgd_optimizer opt[2];
+    for (size_t run = 0; run < 2; run++)
+    {
+        weights[run][0] = tensor_from_array_alloc(&env, values + 1, w1_shape, 2, DTYPE);
+        weights[run][1] = tensor_from_array_alloc(&env, values + 2, b1_shape, 2, DTYPE);
+        weights[run][2] = tensor_from_array_alloc(&env, values + 3, w2_shape, 2, DTYPE);
+        model_params_init(&params[run]);
+        for (size_t p = 0; p < 3; p++)
+        {
+            ASSERT_TRUE(model_params_add(&params[run], weights[run][p]) == NO_ERROR, "Adding parameter failed.");
+        }
+        ASSERT_TRUE(sgd_optimizer_init(&opt[run], &params[run], 0.1, 0.9, false, &env) == NO_ERROR, "SGD initialization failed.");
+
+        if (run == 1)
+        {
+            ASSERT_TRUE(sgd_optimizer_fuse_backward(&opt[run], &env) == NO_ERROR, "Fusing the optimizer failed.");
+        }
+
+        for (size_t step = 0; step < STEPS; step++)
+        {
+            struct tensor *h1 = NULL, *h2 = NULL, *h3 = NULL, *h4 = NULL, *z = NULL;
+            ASSERT_TRUE(tensor2d_mult(x, weights[run][0], &h1, true, &env) == NO_ERROR, "Mult failed.");
+            ASSERT_TRUE(tensor2d_add_row_vector(h1, weights[run][1], &h2, true, &env) == NO_ERROR, "Add row vector failed.");
+            ASSERT_TRUE(relu_forward(h2, &h3, true, &env) == NO_ERROR, "ReLU failed.");
+            ASSERT_TRUE(tensor2d_mult(h3, weights[run][2], &h4, true, &env) == NO_ERROR, "Mult failed.");
+            ASSERT_TRUE(mse_loss(h4, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+
+            if (run == 0)
+            {
+                sgd_optimizer_zero_grad(&opt[run]);
+                ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward failed.");
+                ASSERT_TRUE(sgd_optimizer_step(&opt[run]) == NO_ERROR, "SGD step failed.");
+            }
+            else
+            {
+                ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward failed.");
+                ASSERT_TRUE(!weights[run][0]->grad && !weights[run][1]->grad && !weights[run][2]->grad, "Fused updates should release the gradients.");
+            }
+        }
+    }
+
+    // Neither a replayed backward nor a scaled one runs the fused updates, so both are rejected
+    struct tensor *h1 = NULL, *h2 = NULL, *z = NULL;
+    struct execution_plan plan;
+    struct loss_scaler scaler;
+    ASSERT_TRUE(tensor2d_mult(x, weights[1][0], &h1, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(tensor2d_mult(h1, weights[1][2], &h2, true, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(mse_loss(h2, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+    ASSERT_TRUE(execution_plan_capture(&plan, z, &env) == EXECUTION_PLAN_FUSED_BACKWARD, "Capturing a fused step should fail.");
+    ASSERT_TRUE(loss_scaler_init(&scaler, 1024.0) == NO_ERROR, "Loss scaler initialization failed.");
+    ASSERT_TRUE(loss_scaler_backward(&scaler, z, &env) == LOSS_SCALER_FUSED_BACKWARD, "Scaling a fused backward should fail.");
+    ASSERT_TRUE(backward_set_gradient_hook(&env, NULL, NULL) == NO_ERROR, "Removing the hook failed.");
+
+    for (size_t p = 0; p < 3; p++)
+    {
+        ASSERT_TRUE(tensor_no_grad_equal(weights[0][p], weights[1][p]), "Fused updates should match separate steps.");
+    }
+
+    sgd_optimizer_cleanup(&opt[0]);
+    sgd_optimizer_cleanup(&opt[1]);
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void grad_accumulator_test_micro_batches(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+    const size_t MICRO_BATCHES = 4;
+    const size_t MICRO_BATCH_SIZE = 2;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    double values[48];
+    for (size_t i = 0; i < 48; i++)
+    {
+        values[i] = (double)((i * 5) % 11) / 11.0 - 0.5;
+    }
+
+    const size_t w1_shape[] = {3, 5};
+    const size_t b1_shape[] = {1, 5};
+    const size_t w2_shape[] = {5, 1};
+
+    // The same model trained on a batch of 8 then a batch of 4 rows, then on micro-batches of 2 rows, the second
+    // step being flushed after 2 of the 4 micro-batches
+    struct tensor *weights[2][3];
+    struct model_params params[2];
+    struct sgd_optimizer opt[2];
+    struct grad_accumulator acc;
+    for (size_t run = 0; run < 2; run++)
+    {
+        weights[run][0] = tensor_from_array_alloc(&env, values + 1, w1_shape, 2, DTYPE);
+        weights[run][1] = tensor_from_array_alloc(&env, values + 2, b1_shape, 2, DTYPE);
+        weights[run][2] = tensor_from_array_alloc(&env, values + 3, w2_shape, 2, DTYPE);
+        model_params_init(&params[run]);
+        for (size_t p = 0; p < 3; p++)
+        {
+            ASSERT_TRUE(model_params_add(&params[run], weights[run][p]) == NO_ERROR, "Adding parameter failed.");
+        }
+        ASSERT_TRUE(sgd_optimizer_init(&opt[run], &params[run], 0.1, 0.9, false, &env) == NO_ERROR, "SGD initialization failed.");
+    }
+    ASSERT_TRUE(grad_accumulator_init(&acc, &opt[1], NULL, MICRO_BATCHES) == NO_ERROR, "Accumulator initialization failed.");
+
+    const size_t batch_sizes[] = {MICRO_BATCHES * MICRO_BATCH_SIZE, MICRO_BATCHES * MICRO_BATCH_SIZE / 2};
+    for (size_t run = 0; run < 2; run++)
+    {
+        for (size_t step = 0; step < 2; step++)
+        {
+            const size_t batch_size = run == 0 ? batch_sizes[step] : MICRO_BATCH_SIZE;
+            const size_t n_passes = run == 0 ? 1 : batch_sizes[step] / MICRO_BATCH_SIZE;
+            for (size_t pass = 0; pass < n_passes; pass++)
+            {
+                const size_t x_shape[] = {batch_size, 3};
+                const size_t target_shape[] = {batch_size, 1};
+                struct tensor *x = tensor_from_array_alloc(&env, values + 3 * pass * MICRO_BATCH_SIZE, x_shape, 2, DTYPE);
+                struct tensor *target = tensor_from_array_alloc(&env, values + 24 + pass * MICRO_BATCH_SIZE, target_shape, 2, DTYPE);
+                ASSERT_TRUE(x && target, "Tensor allocation failed.");
+                tensor_set_requires_grad(x, false);
+                tensor_set_requires_grad(target, false);
+
+                struct tensor *h1 = NULL, *h2 = NULL, *h3 = NULL, *h4 = NULL, *z = NULL;
+                ASSERT_TRUE(tensor2d_mult(x, weights[run][0], &h1, true, &env) == NO_ERROR, "Mult failed.");
+                ASSERT_TRUE(tensor2d_add_row_vector(h1, weights[run][1], &h2, true, &env) == NO_ERROR, "Add row vector failed.");
+                ASSERT_TRUE(relu_forward(h2, &h3, true, &env) == NO_ERROR, "ReLU failed.");
+                ASSERT_TRUE(tensor2d_mult(h3, weights[run][2], &h4, true, &env) == NO_ERROR, "Mult failed.");
+                ASSERT_TRUE(mse_loss(h4, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+                struct tensor *const forward[] = {x, target, h1, h2, h3, h4, z};
+                for (size_t i = 0; i < 7; i++)
+                {
+                    ASSERT_TRUE(tensor_list_add(env.tensor_alloc_intermediates, forward[i]) == NO_ERROR, "Adding intermediate failed.");
+                }
+
+                if (run == 0)
+                {
+                    sgd_optimizer_zero_grad(&opt[run]);
+                    ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward failed.");
+                    ASSERT_TRUE(sgd_optimizer_step(&opt[run]) == NO_ERROR, "SGD step failed.");
+                    ASSERT_TRUE(cgrad_env_free_intermediates(&env) == NO_ERROR, "Freeing intermediates failed.");
+                    continue;
+                }
+
+                bool stepped = true;
+                ASSERT_TRUE(grad_accumulator_backward(&acc, z, &env, &stepped) == NO_ERROR, "Accumulated backward failed.");
+                ASSERT_TRUE(stepped == (step == 0 && pass == MICRO_BATCHES - 1), "The optimizer should step after the last micro-batch only.");
+                ASSERT_TRUE(env.tensor_alloc_intermediates->size == 0, "Intermediates should be freed after each micro-batch.");
+            }
+        }
+    }
+
+    bool stepped = false;
+    ASSERT_TRUE(grad_accumulator_flush(&acc, &stepped) == NO_ERROR && stepped, "Flushing the accumulator failed.");
+    ASSERT_TRUE(grad_accumulator_flush(&acc, &stepped) == NO_ERROR && !stepped, "Flushing an empty accumulator should not step.");
+
+    for (size_t p = 0; p < 3; p++)
+    {
+        for (size_t i = 0; i < weights[0][p]->data_size; i++)
+        {
+            const double expected = ((double *)weights[0][p]->data)[i];
+            ASSERT_TRUE(fabs(((double *)weights[1][p]->data)[i] - expected) < 1e-12, "Accumulated steps should match full batch steps.");
+        }
+    }
+
+    sgd_optimizer_cleanup(&opt[0]);
+    sgd_optimizer_cleanup(&opt[1]);
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void embedding_test_sparse_sgd_step(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+    const size_t N_EMBEDDINGS = 6;
+    const size_t DIM = 3;
+    const size_t BATCH_SIZE = 5;
+    const size_t STEPS = 2;
+    const int32_t indexes_data[] = {4, 1, 4, 0, 1};
+    const int32_t expected_rows[] = {0, 1, 4};
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct embedding layer = {0};
+    struct sgd_optimizer opt[2] = {0};
+
+    double values[32];
+    for (size_t i = 0; i < 32; i++)
+    {
+        values[i] = (double)((i * 5) % 11) / 11.0 - 0.5;
+    }
+
+    // The lookup of the embedding is the product of the one-hot encoded indexes with a dense weight
+    double one_hot[5 * 6] = {0};
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+    {
+        one_hot[i * N_EMBEDDINGS + indexes_data[i]] = 1.0;
+    }
+
+    const size_t x_shape[] = {BATCH_SIZE, N_EMBEDDINGS};
+    const size_t indexes_shape[] = {BATCH_SIZE};
+    const size_t w1_shape[] = {N_EMBEDDINGS, DIM};
+    const size_t w2_shape[] = {DIM, 1};
+    const size_t target_shape[] = {BATCH_SIZE, 1};
+    struct tensor *x = tensor_from_array_alloc(&env, one_hot, x_shape, 2, DTYPE);
+    struct tensor *indexes = tensor_from_array_alloc(&env, indexes_data, indexes_shape, 1, DTYPE_INT32);
+    struct tensor *target = tensor_from_array_alloc(&env, values + 7, target_shape, 2, DTYPE);
+    struct tensor *dense_weight = tensor_from_array_alloc(&env, values, w1_shape, 2, DTYPE);
+    ASSERT_TRUE(x && indexes && target && dense_weight, "Tensor allocation failed.");
+    tensor_set_requires_grad(x, false);
+    tensor_set_requires_grad(indexes, false);
+    tensor_set_requires_grad(target, false);
+
+    ASSERT_TRUE(embedding_init(&layer, N_EMBEDDINGS, DIM, DTYPE, &env) == NO_ERROR, "Embedding initialization failed.");
+    memcpy(layer.weight->data, values, N_EMBEDDINGS * DIM * sizeof(double));
+
+    struct tensor *weights[2][2] = {{dense_weight, tensor_from_array_alloc(&env, values + 1, w2_shape, 2, DTYPE)},
+                                    {layer.weight, tensor_from_array_alloc(&env, values + 1, w2_shape, 2, DTYPE)}};
+    struct model_params params[2];
+    for (size_t run = 0; run < 2; run++)
+    {
+        model_params_init(&params[run]);
+        ASSERT_TRUE(model_params_add(&params[run], weights[run][0]) == NO_ERROR, "Adding parameter failed.");
+        ASSERT_TRUE(model_params_add(&params[run], weights[run][1]) == NO_ERROR, "Adding parameter failed.");
+        ASSERT_TRUE(sgd_optimizer_init(&opt[run], &params[run], 0.1, 0.9, false, &env) == NO_ERROR, "SGD initialization failed.");
+    }
+
+    for (size_t step = 0; step < STEPS; step++)
+    {
+        for (size_t run = 0; run < 2; run++)
+        {
+            struct tensor *h1 = NULL, *h2 = NULL, *z = NULL;
+            if (run == 0)
+            {
+                ASSERT_TRUE(tensor2d_mult(x, weights[run][0], &h1, true, &env) == NO_ERROR, "Mult failed.");
+            }
+            else
+            {
+                ASSERT_TRUE(embedding_forward(&layer, indexes, &h1, true) == NO_ERROR, "Embedding lookup failed.");
+            }
+            ASSERT_TRUE(tensor2d_mult(h1, weights[run][1], &h2, true, &env) == NO_ERROR, "Mult failed.");
+            ASSERT_TRUE(mse_loss(h2, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+
+            sgd_optimizer_zero_grad(&opt[run]);
+            ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward failed.");
+            struct tensor *const forward[] = {h1, h2, z};
+            for (size_t i = 0; i < 3; i++)
+            {
+                ASSERT_TRUE(tensor_list_add(env.tensor_alloc_intermediates, forward[i]) == NO_ERROR, "Adding intermediate failed.");
+            }
+        }
+
+        // The gradient of the embedding holds the rows looked up, each once, summing the duplicated lookups
+        const struct tensor *grad = layer.weight->grad;
+        ASSERT_TRUE(tensor_has_sparse_grad(layer.weight) && layer.weight->grad_rows->data_size == 3, "The gradient of the embedding should hold 3 rows.");
+        ASSERT_TRUE(grad->shape[0] == 3 && grad->shape[1] == DIM, "The gradient of the embedding should be compact.");
+        for (size_t k = 0; k < 3; k++)
+        {
+            ASSERT_TRUE(((int32_t *)layer.weight->grad_rows->data)[k] == expected_rows[k], "The rows of the gradient should be sorted.");
+            for (size_t j = 0; j < DIM; j++)
+            {
+                const double expected = ((double *)dense_weight->grad->data)[expected_rows[k] * DIM + j];
+                ASSERT_TRUE(fabs(((double *)grad->data)[k * DIM + j] - expected) < 1e-12, "Sparse gradient should match the dense gradient.");
+            }
+        }
+
+        ASSERT_TRUE(sgd_optimizer_step(&opt[0]) == NO_ERROR, "SGD step failed.");
+        ASSERT_TRUE(sgd_optimizer_step(&opt[1]) == NO_ERROR, "SGD step failed.");
+        ASSERT_TRUE(cgrad_env_free_intermediates(&env) == NO_ERROR, "Freeing intermediates failed.");
+    }
+
+    // Rows never looked up keep their initial values
+    for (size_t p = 0; p < 2; p++)
+    {
+        for (size_t i = 0; i < weights[0][p]->data_size; i++)
+        {
+            const double expected = ((double *)weights[0][p]->data)[i];
+            ASSERT_TRUE(fabs(((double *)weights[1][p]->data)[i] - expected) < 1e-12, "Sparse updates should match dense updates.");
+        }
+    }
+    ASSERT_TRUE(((double *)layer.weight->data)[2 * DIM] == values[2 * DIM], "Rows not looked up should not be updated.");
+
+    sgd_optimizer_zero_grad(&opt[1]);
+    ASSERT_TRUE(!layer.weight->grad && !layer.weight->grad_rows, "Zeroing the gradients should release the sparse gradient.");
+
+test_cleanup:
+    sgd_optimizer_cleanup(&opt[0]);
+    sgd_optimizer_cleanup(&opt[1]);
+    cgrad_env_cleanup(&env);
+}
+
+void embedding_test_tied_weight(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+    const size_t N_EMBEDDINGS = 6;
+    const size_t DIM = 3;
+    const size_t BATCH_SIZE = 4;
+    const int32_t indexes_data[] = {4, 1, 4, 0};
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct embedding layers[2] = {0};
+
+    double values[32];
+    for (size_t i = 0; i < 32; i++)
+    {
+        values[i] = (double)((i * 5) % 11) / 11.0 - 0.5;
+    }
+    double one_hot[4 * 6] = {0};
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+    {
+        one_hot[i * N_EMBEDDINGS + indexes_data[i]] = 1.0;
+    }
+
+    const size_t x_shape[] = {BATCH_SIZE, N_EMBEDDINGS};
+    const size_t indexes_shape[] = {BATCH_SIZE};
+    const size_t w_shape[] = {N_EMBEDDINGS, DIM};
+    const size_t projection_shape[] = {DIM, 1};
+    const size_t target_shape[] = {BATCH_SIZE, 1};
+    struct tensor *x = tensor_from_array_alloc(&env, values + 3, x_shape, 2, DTYPE);
+    struct tensor *lookup = tensor_from_array_alloc(&env, one_hot, x_shape, 2, DTYPE);
+    struct tensor *indexes = tensor_from_array_alloc(&env, indexes_data, indexes_shape, 1, DTYPE_INT32);
+    struct tensor *projection = tensor_from_array_alloc(&env, values + 1, projection_shape, 2, DTYPE);
+    struct tensor *target = tensor_from_array_alloc(&env, values + 5, target_shape, 2, DTYPE);
+    struct tensor *reference = tensor_from_array_alloc(&env, values, w_shape, 2, DTYPE);
+    ASSERT_TRUE(x && lookup && indexes && projection && target && reference, "Tensor allocation failed.");
+    tensor_set_requires_grad(x, false);
+    tensor_set_requires_grad(lookup, false);
+    tensor_set_requires_grad(indexes, false);
+    tensor_set_requires_grad(projection, false);
+    tensor_set_requires_grad(target, false);
+
+    // The weight is both looked up and multiplied, the reference looking it up as a product with one-hot rows.
+    // With the lookup as first operand of the sum, its row-sparse gradient reaches the weight first.
+    for (size_t run = 0; run < 3; run++)
+    {
+        struct tensor *weight = reference;
+        if (run > 0)
+        {
+            ASSERT_TRUE(embedding_init(&layers[run - 1], N_EMBEDDINGS, DIM, DTYPE, &env) == NO_ERROR, "Embedding initialization failed.");
+            weight = layers[run - 1].weight;
+            memcpy(weight->data, values, N_EMBEDDINGS * DIM * sizeof(double));
+        }
+
+        struct tensor *h1 = NULL, *h2 = NULL, *h3 = NULL, *h4 = NULL, *z = NULL;
+        if (run == 0)
+        {
+            ASSERT_TRUE(tensor2d_mult(lookup, weight, &h1, true, &env) == NO_ERROR, "Mult failed.");
+        }
+        else
+        {
+            ASSERT_TRUE(embedding_forward(&layers[run - 1], indexes, &h1, true) == NO_ERROR, "Embedding lookup failed.");
+        }
+        ASSERT_TRUE(tensor2d_mult(x, weight, &h2, true, &env) == NO_ERROR, "Mult failed.");
+        ASSERT_TRUE((run == 2 ? tensor_add(h2, h1, &h3, true, &env) : tensor_add(h1, h2, &h3, true, &env)) == NO_ERROR, "Add failed.");
+        ASSERT_TRUE(tensor2d_mult(h3, projection, &h4, true, &env) == NO_ERROR, "Mult failed.");
+        ASSERT_TRUE(mse_loss(h4, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+        ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward through a tied weight should not fail.");
+        struct tensor *const forward[] = {h1, h2, h3, h4, z};
+        for (size_t i = 0; i < 5; i++)
+        {
+            ASSERT_TRUE(tensor_list_add(env.tensor_alloc_intermediates, forward[i]) == NO_ERROR, "Adding intermediate failed.");
+        }
+
+        if (run > 0)
+        {
+            ASSERT_TRUE(!weight->grad_rows && weight->grad->data_size == weight->data_size, "The gradient of a tied weight should be dense.");
+            for (size_t i = 0; i < weight->data_size; i++)
+            {
+                const double expected = ((double *)reference->grad->data)[i];
+                ASSERT_TRUE(fabs(((double *)weight->grad->data)[i] - expected) < 1e-12, "The gradient of a tied weight should sum both uses.");
+            }
+        }
+        ASSERT_TRUE(cgrad_env_free_intermediates(&env) == NO_ERROR, "Freeing intermediates failed.");
+    }
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
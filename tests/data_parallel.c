@@ -0,0 +1,361 @@
+#include "cgrad_test/assert.h"
+#include "cgrad_test/config.h"
+#include "cgrad_test/test_result.h"
+#include "cgrad_test/test_case.h"
+#include "cgrad_test/datastructures/test_list/test_list.h"
+#include "cgrad_test/datastructures/test_list/test_list_callbacks.h"
+#include "cgrad_test/run_tests.h"
+#include "cgrad/parallel/data_parallel.h"
+#include "cgrad/layers/embedding.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/losses/mse.h"
+#include "cgrad/optimizers/sgd.h"
+#include "cgrad/tensor/tensor2d_mult.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#define IN_DIM 6
+#define HIDDEN_DIM 5
+#define NUM_CLASSES 3
+#define BATCH_SIZE 10
+#define N_EMBEDDINGS 4096
+#define EMBEDDING_DIM 3
+
+struct mlp
+{
+    struct linear linear1;
+    struct linear linear2;
+};
+
+struct embedding_model
+{
+    struct embedding embedding;
+    struct tensor *projection;
+    struct cgrad_env *env;
+};
+
+void data_parallel_test_matches_single_thread(struct test_result *);
+void data_parallel_test_invalid_config(struct test_result *);
+void data_parallel_test_sparse_grads(struct test_result *);
+
+static cgrad_error mlp_init(void *model, struct model_params *const params, struct cgrad_env *const env);
+static void mlp_cleanup(void *model);
+static cgrad_error mlp_loss(void *model, struct tensor *const x, struct tensor *const y, struct tensor **const loss, struct cgrad_env *const env);
+static cgrad_error embedding_model_init(void *model, struct model_params *const params, struct cgrad_env *const env);
+static void embedding_model_cleanup(void *model);
+static cgrad_error embedding_model_loss(void *model, struct tensor *const x, struct tensor *const y, struct tensor **const loss, struct cgrad_env *const env);
+static bool grads_close(const struct model_params *const a, const struct model_params *const b);
+
+int main(int argc, char **argv)
+{
+    struct test_list *tests = tests_list_alloc();
+    test_list_append(tests, &data_parallel_test_matches_single_thread, "data_parallel_test_matches_single_thread");
+    test_list_append(tests, &data_parallel_test_invalid_config, "data_parallel_test_invalid_config");
+    test_list_append(tests, &data_parallel_test_sparse_grads, "data_parallel_test_sparse_grads");
+
+    run_tests(tests);
+
+    size_t num_failed_tests = 0;
+    test_list_foreach(tests, &report_failures, &num_failed_tests);
+
+    size_t num_passed_tests = tests->size - num_failed_tests;
+    float percentage_passed_tests = ((float)num_passed_tests / (float)tests->size) * 100.0;
+    float percentage_failed_tests = ((float)num_failed_tests / (float)tests->size) * 100.0;
+
+    printf("Number of tests: %ld\n", tests->size);
+    printf("Number of passed tests: %ld (%.2f \%)\n", num_passed_tests, percentage_passed_tests);
+    printf("Number of failed tests: %ld (%.2f \%)\n", num_failed_tests, percentage_failed_tests);
+
+    return EXIT_SUCCESS;
+}
+
+void data_parallel_test_matches_single_thread(struct test_result *result)
+{
+    const size_t N_WORKERS = 3;
+    const size_t N_STEPS = 3;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, 42, 20) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    // Two identical models, one trained on a single thread as reference
+    struct mlp model, reference;
+    struct model_params params, reference_params;
+    ASSERT_TRUE(mlp_init(&model, &params, &env) == NO_ERROR && mlp_init(&reference, &reference_params, &env) == NO_ERROR, "Model initialization failed.");
+    for (size_t i = 0; i < params.size; i++)
+    {
+        memcpy(reference_params.params[i]->data, params.params[i]->data, params.params[i]->data_size * sizeof(double));
+    }
+
+    struct sgd_optimizer opt, reference_opt;
+    ASSERT_TRUE(sgd_optimizer_init(&opt, &params, 0.1, 0.9, false, &env) == NO_ERROR, "Optimizer initialization failed.");
+    ASSERT_TRUE(sgd_optimizer_init(&reference_opt, &reference_params, 0.1, 0.9, false, &env) == NO_ERROR, "Optimizer initialization failed.");
+
+    const struct data_parallel_model description = {
+        .replica_size = sizeof(struct mlp),
+        .replica_init = &mlp_init,
+        .replica_cleanup = &mlp_cleanup,
+        .loss = &mlp_loss,
+    };
+    struct data_parallel_trainer trainer;
+    ASSERT_TRUE(data_parallel_init(&trainer, &description, &params, N_WORKERS, 20, &env) == NO_ERROR, "Trainer initialization failed.");
+
+    // The batch does not divide among the workers
+    const size_t x_shape[] = {BATCH_SIZE, IN_DIM};
+    const size_t y_shape[] = {BATCH_SIZE, 1};
+    struct tensor *x = tensor_alloc(&env, x_shape, 2, DTYPE_FLOAT64);
+    struct tensor *y = tensor_alloc(&env, y_shape, 2, DTYPE_FLOAT64);
+    for (size_t i = 0; i < x->data_size; i++)
+    {
+        ((double *)x->data)[i] = sin(0.7 * i);
+    }
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+    {
+        ((double *)y->data)[i] = i % NUM_CLASSES;
+    }
+
+    for (size_t step = 0; step < N_STEPS; step++)
+    {
+        sgd_optimizer_zero_grad(&opt);
+        double loss;
+        ASSERT_TRUE(data_parallel_step(&trainer, x, y, &loss) == NO_ERROR, "Data parallel step failed.");
+
+        sgd_optimizer_zero_grad(&reference_opt);
+        struct tensor *reference_loss = NULL;
+        ASSERT_TRUE(mlp_loss(&reference, x, y, &reference_loss, &env) == NO_ERROR, "Reference forward failed.");
+        ASSERT_TRUE(backward(reference_loss, &env) == NO_ERROR, "Reference backward failed.");
+        const double expected_loss = ((double *)reference_loss->data)[0];
+        tensor_free(&env, reference_loss);
+        cgrad_env_free_intermediates(&env);
+
+        ASSERT_TRUE(fabs(loss - expected_loss) < 1e-12, "Loss differs from the single threaded loss.");
+        ASSERT_TRUE(grads_close(&params, &reference_params), "Gradients differ from the single threaded gradients.");
+
+        ASSERT_TRUE(sgd_optimizer_step(&opt) == NO_ERROR && sgd_optimizer_step(&reference_opt) == NO_ERROR, "Optimizer step failed.");
+    }
+
+    const size_t mismatched_shape[] = {BATCH_SIZE - 1, 1};
+    struct tensor *mismatched_y = tensor_alloc(&env, mismatched_shape, 2, DTYPE_FLOAT64);
+    ASSERT_TRUE(data_parallel_step(&trainer, x, mismatched_y, NULL) == INVALID_BATCH_SIZE, "Batches of different sizes should be rejected.");
+
+    data_parallel_cleanup(&trainer);
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void data_parallel_test_invalid_config(struct test_result *result)
+{
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, 42, 20) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct mlp model;
+    struct model_params params;
+    ASSERT_TRUE(mlp_init(&model, &params, &env) == NO_ERROR, "Model initialization failed.");
+
+    struct data_parallel_model description = {
+        .replica_size = sizeof(struct mlp),
+        .replica_init = &mlp_init,
+        .replica_cleanup = &mlp_cleanup,
+        .loss = &mlp_loss,
+    };
+    struct data_parallel_trainer trainer;
+    ASSERT_TRUE(data_parallel_init(&trainer, &description, &params, 0, 20, &env) == DATA_PARALLEL_INVALID_CONFIG, "Zero workers should be rejected.");
+
+    // Replicas must have the parameters of the trained model
+    params.size--;
+    ASSERT_TRUE(data_parallel_init(&trainer, &description, &params, 2, 20, &env) == DATA_PARALLEL_PARAMS_MISMATCH, "Replicas with other parameters should be rejected.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void data_parallel_test_sparse_grads(struct test_result *result)
+{
+    const size_t N_WORKERS = 2;
+    const size_t N_STEPS = 3;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, 42, 20) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    // The replicas hold row-sparse gradients, the trained model and the reference dense ones
+    struct embedding_model model, reference;
+    struct model_params params, reference_params;
+    ASSERT_TRUE(embedding_model_init(&model, &params, &env) == NO_ERROR && embedding_model_init(&reference, &reference_params, &env) == NO_ERROR, "Model initialization failed.");
+    for (size_t i = 0; i < params.size; i++)
+    {
+        memcpy(reference_params.params[i]->data, params.params[i]->data, params.params[i]->data_size * sizeof(double));
+        ASSERT_TRUE(tensor_alloc_grad(&env, reference_params.params[i]) == NO_ERROR, "Gradient allocation failed.");
+    }
+
+    struct sgd_optimizer opt, reference_opt;
+    ASSERT_TRUE(sgd_optimizer_init(&opt, &params, 0.1, 0.9, false, &env) == NO_ERROR, "Optimizer initialization failed.");
+    ASSERT_TRUE(sgd_optimizer_init(&reference_opt, &reference_params, 0.1, 0.9, false, &env) == NO_ERROR, "Optimizer initialization failed.");
+
+    const struct data_parallel_model description = {
+        .replica_size = sizeof(struct embedding_model),
+        .replica_init = &embedding_model_init,
+        .replica_cleanup = &embedding_model_cleanup,
+        .loss = &embedding_model_loss,
+    };
+    struct data_parallel_trainer trainer;
+    ASSERT_TRUE(data_parallel_init(&trainer, &description, &params, N_WORKERS, 20, &env) == NO_ERROR, "Trainer initialization failed.");
+
+    // Rows repeated within and across shards, far from the first rows, and straddling the slices and blocks reduced
+    const int32_t indexes[BATCH_SIZE] = {4000, 2053, 341, 4000, 7, 2053, 4095, 341, 4001, 12};
+    const size_t x_shape[] = {BATCH_SIZE};
+    const size_t y_shape[] = {BATCH_SIZE, 1};
+    struct tensor *x = tensor_from_array_alloc(&env, indexes, x_shape, 1, DTYPE_INT32);
+    struct tensor *y = tensor_alloc(&env, y_shape, 2, DTYPE_FLOAT64);
+    ASSERT_TRUE(x && y, "Tensor allocation failed.");
+    tensor_set_requires_grad(x, false);
+    tensor_set_requires_grad(y, false);
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+    {
+        ((double *)y->data)[i] = cos(0.3 * i);
+    }
+
+    for (size_t step = 0; step < N_STEPS; step++)
+    {
+        sgd_optimizer_zero_grad(&opt);
+        double loss;
+        ASSERT_TRUE(data_parallel_step(&trainer, x, y, &loss) == NO_ERROR, "Data parallel step failed.");
+
+        sgd_optimizer_zero_grad(&reference_opt);
+        struct tensor *reference_loss = NULL;
+        ASSERT_TRUE(embedding_model_loss(&reference, x, y, &reference_loss, &env) == NO_ERROR, "Reference forward failed.");
+        ASSERT_TRUE(backward(reference_loss, &env) == NO_ERROR, "Reference backward failed.");
+        const double expected_loss = ((double *)reference_loss->data)[0];
+        tensor_free(&env, reference_loss);
+        cgrad_env_free_intermediates(&env);
+
+        ASSERT_TRUE(fabs(loss - expected_loss) < 1e-12, "Loss differs from the single threaded loss.");
+        ASSERT_TRUE(grads_close(&params, &reference_params), "Gradients differ from the single threaded gradients.");
+
+        ASSERT_TRUE(sgd_optimizer_step(&opt) == NO_ERROR && sgd_optimizer_step(&reference_opt) == NO_ERROR, "Optimizer step failed.");
+    }
+
+    data_parallel_cleanup(&trainer);
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+static cgrad_error mlp_init(void *model, struct model_params *const params, struct cgrad_env *const env)
+{
+    struct mlp *mlp = model;
+    cgrad_error err;
+    if ((err = linear_init(&mlp->linear1, IN_DIM, HIDDEN_DIM, DTYPE_FLOAT64, env)) != NO_ERROR ||
+        (err = linear_xavier_init(&mlp->linear1)) != NO_ERROR ||
+        (err = linear_init(&mlp->linear2, HIDDEN_DIM, NUM_CLASSES, DTYPE_FLOAT64, env)) != NO_ERROR ||
+        (err = linear_xavier_init(&mlp->linear2)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    model_params_init(params);
+    model_params_add(params, mlp->linear1.weight);
+    model_params_add(params, mlp->linear1.bias);
+    model_params_add(params, mlp->linear2.weight);
+    model_params_add(params, mlp->linear2.bias);
+    return NO_ERROR;
+}
+
+static void mlp_cleanup(void *model)
+{
+    struct mlp *mlp = model;
+    linear_cleanup(&mlp->linear1);
+    linear_cleanup(&mlp->linear2);
+}
+
+static cgrad_error mlp_loss(void *model, struct tensor *const x, struct tensor *const y, struct tensor **const loss, struct cgrad_env *const env)
+{
+    struct mlp *mlp = model;
+    cgrad_error err;
+
+    struct tensor *h1 = NULL, *h2 = NULL, *h3 = NULL;
+    if ((err = linear_forward(&mlp->linear1, x, &h1, true)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h1)) != NO_ERROR ||
+        (err = relu_forward(h1, &h2, true, env)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h2)) != NO_ERROR ||
+        (err = linear_forward(&mlp->linear2, h2, &h3, true)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h3)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    return cross_entropy_loss(h3, y, loss, true, env);
+}
+
+static cgrad_error embedding_model_init(void *model, struct model_params *const params, struct cgrad_env *const env)
+{
+    struct embedding_model *m = model;
+    cgrad_error err;
+    if ((err = embedding_init(&m->embedding, N_EMBEDDINGS, EMBEDDING_DIM, DTYPE_FLOAT64, env)) != NO_ERROR ||
+        (err = embedding_normal_init(&m->embedding)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    const size_t projection_shape[] = {EMBEDDING_DIM, 1};
+    m->projection = tensor_alloc(env, projection_shape, 2, DTYPE_FLOAT64);
+    if (!m->projection)
+    {
+        return TENSOR_ALLOCATION_FAILED;
+    }
+    for (size_t i = 0; i < EMBEDDING_DIM; i++)
+    {
+        ((double *)m->projection->data)[i] = 0.5 - 0.25 * i;
+    }
+    m->env = env;
+
+    model_params_init(params);
+    model_params_add(params, m->embedding.weight);
+    model_params_add(params, m->projection);
+    return NO_ERROR;
+}
+
+static void embedding_model_cleanup(void *model)
+{
+    struct embedding_model *m = model;
+    embedding_cleanup(&m->embedding);
+    tensor_free(m->env, m->projection);
+}
+
+static cgrad_error embedding_model_loss(void *model, struct tensor *const x, struct tensor *const y, struct tensor **const loss, struct cgrad_env *const env)
+{
+    struct embedding_model *m = model;
+    cgrad_error err;
+
+    struct tensor *h1 = NULL, *h2 = NULL;
+    if ((err = embedding_forward(&m->embedding, x, &h1, true)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h1)) != NO_ERROR ||
+        (err = tensor2d_mult(h1, m->projection, &h2, true, env)) != NO_ERROR ||
+        (err = tensor_list_add(env->tensor_alloc_intermediates, h2)) != NO_ERROR)
+    {
+        return err;
+    }
+
+    return mse_loss(h2, y, loss, true, env);
+}
+
+static bool grads_close(const struct model_params *const a, const struct model_params *const b)
+{
+    for (size_t i = 0; i < a->size; i++)
+    {
+        const double *ga = a->params[i]->grad->data;
+        const double *gb = b->params[i]->grad->data;
+        for (size_t j = 0; j < a->params[i]->data_size; j++)
+        {
+            if (fabs(ga[j] - gb[j]) > 1e-12)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,163 @@
+#include "cgrad_test/assert.h"
+#include "cgrad_test/config.h"
+#include "cgrad_test/test_result.h"
+#include "cgrad_test/test_case.h"
+#include "cgrad_test/datastructures/test_list/test_list.h"
+#include "cgrad_test/datastructures/test_list/test_list_callbacks.h"
+#include "cgrad_test/run_tests.h"
+#include "cgrad/cgrad_env.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/conv2d.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define N_THREADS 4
+#define N_ITERATIONS 50
+
+struct forward_worker
+{
+    const struct linear *linear;
+    const struct conv2d *conv;
+    const struct tensor *linear_x;
+    const struct tensor *conv_x;
+    const struct tensor *linear_expected;
+    const struct tensor *conv_expected;
+    size_t mismatches;
+    cgrad_error err;
+};
+
+void cgrad_env_context_test_concurrent_forward(struct test_result *);
+
+static void *forward_worker_run(void *arg);
+static bool tensor_data_equal(const struct tensor *const a, const struct tensor *const b);
+
+int main(int argc, char **argv)
+{
+    struct test_list *tests = tests_list_alloc();
+    test_list_append(tests, &cgrad_env_context_test_concurrent_forward, "cgrad_env_context_test_concurrent_forward");
+
+    run_tests(tests);
+
+    size_t num_failed_tests = 0;
+    test_list_foreach(tests, &report_failures, &num_failed_tests);
+
+    size_t num_passed_tests = tests->size - num_failed_tests;
+    float percentage_passed_tests = ((float)num_passed_tests / (float)tests->size) * 100.0;
+    float percentage_failed_tests = ((float)num_failed_tests / (float)tests->size) * 100.0;
+
+    printf("Number of tests: %ld\n", tests->size);
+    printf("Number of passed tests: %ld (%.2f \%)\n", num_passed_tests, percentage_passed_tests);
+    printf("Number of failed tests: %ld (%.2f \%)\n", num_failed_tests, percentage_failed_tests);
+
+    return EXIT_SUCCESS;
+}
+
+void cgrad_env_context_test_concurrent_forward(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct linear linear;
+    struct conv2d conv;
+    ASSERT_TRUE(linear_init(&linear, 64, 32, DTYPE, &env) == NO_ERROR && linear_xavier_init(&linear) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(conv2d_init(&conv, 2, 3, 3, DTYPE, &env) == NO_ERROR && conv2d_xavier_init(&conv) == NO_ERROR, "Conv2d initialization failed.");
+
+    const size_t linear_x_shape[] = {8, 64};
+    const size_t conv_x_shape[] = {2, 2, 7, 6};
+    struct tensor *linear_x = tensor_alloc(&env, linear_x_shape, 2, DTYPE);
+    struct tensor *conv_x = tensor_alloc(&env, conv_x_shape, 4, DTYPE);
+    for (size_t i = 0; i < linear_x->data_size; i++)
+    {
+        ((float *)linear_x->data)[i] = 0.01f * i - 0.3f;
+    }
+    for (size_t i = 0; i < conv_x->data_size; i++)
+    {
+        ((float *)conv_x->data)[i] = 0.02f * (i % 17) - 0.1f;
+    }
+
+    struct tensor *linear_expected = NULL;
+    struct tensor *conv_expected = NULL;
+    ASSERT_TRUE(linear_forward(&linear, linear_x, &linear_expected, false) == NO_ERROR, "Linear forward failed.");
+    ASSERT_TRUE(conv2d_forward(&conv, conv_x, &conv_expected, false) == NO_ERROR, "Conv2d forward failed.");
+
+    float weight_before[64 * 32];
+    memcpy(weight_before, linear.weight->data, sizeof(weight_before));
+
+    // Every thread runs forward passes on the shared layers with its own context
+    pthread_t threads[N_THREADS];
+    struct forward_worker workers[N_THREADS];
+    for (size_t t = 0; t < N_THREADS; t++)
+    {
+        workers[t] = (struct forward_worker){
+            .linear = &linear,
+            .conv = &conv,
+            .linear_x = linear_x,
+            .conv_x = conv_x,
+            .linear_expected = linear_expected,
+            .conv_expected = conv_expected,
+            .mismatches = 0,
+            .err = NO_ERROR,
+        };
+        ASSERT_TRUE(pthread_create(&threads[t], NULL, &forward_worker_run, &workers[t]) == 0, "Thread creation failed.");
+    }
+    for (size_t t = 0; t < N_THREADS; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+
+    for (size_t t = 0; t < N_THREADS; t++)
+    {
+        ASSERT_TRUE(workers[t].err == NO_ERROR, "Concurrent forward failed.");
+        ASSERT_TRUE(workers[t].mismatches == 0, "Concurrent forward differs from the reference.");
+    }
+    ASSERT_TRUE(memcmp(weight_before, linear.weight->data, sizeof(weight_before)) == 0, "Shared parameters should not be written.");
+    ASSERT_TRUE(linear.weight->node == NULL && conv.weight->node == NULL, "Untracked forward should not link the parameters to a graph.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+static void *forward_worker_run(void *arg)
+{
+    struct forward_worker *worker = arg;
+
+    struct cgrad_env ctx;
+    if ((worker->err = cgrad_env_context_init(&ctx, 20)) != NO_ERROR)
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < N_ITERATIONS && worker->err == NO_ERROR; i++)
+    {
+        struct tensor *linear_out = NULL;
+        struct tensor *conv_out = NULL;
+        if ((worker->err = linear_forward_env(worker->linear, (struct tensor *)worker->linear_x, &linear_out, false, &ctx)) != NO_ERROR ||
+            (worker->err = conv2d_forward_env(worker->conv, (struct tensor *)worker->conv_x, &conv_out, false, &ctx)) != NO_ERROR)
+        {
+            break;
+        }
+
+        if (!tensor_data_equal(linear_out, worker->linear_expected) || !tensor_data_equal(conv_out, worker->conv_expected))
+        {
+            worker->mismatches++;
+        }
+
+        tensor_free(&ctx, linear_out);
+        tensor_free(&ctx, conv_out);
+        cgrad_env_free_intermediates(&ctx);
+    }
+
+    cgrad_env_cleanup(&ctx);
+    return NULL;
+}
+
+static bool tensor_data_equal(const struct tensor *const a, const struct tensor *const b)
+{
+    return a->data_size == b->data_size && memcmp(a->data, b->data, a->data_size * dtype_sizeof(a->dtype)) == 0;
+}
@@ -0,0 +1,347 @@
+#include "cgrad_test/assert.h"
+#include "cgrad_test/config.h"
+#include "cgrad_test/test_result.h"
+#include "cgrad_test/test_case.h"
+#include "cgrad_test/datastructures/test_list/test_list.h"
+#include "cgrad_test/datastructures/test_list/test_list_callbacks.h"
+#include "cgrad_test/run_tests.h"
+#include "cgrad/gemm/gemm.h"
+#include "cgrad/gemm/packed_weight.h"
+#include "cgrad/parallel/thread_pool.h"
+#include "cgrad/tensor/tensor2d_mult_packed.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define N_THREADS 4
+
+// Padding added to every leading dimension, so that strided operands are covered too
+#define LD_PADDING 3
+
+struct gemm_case
+{
+    size_t m;
+    size_t n;
+    size_t k;
+};
+
+void gemm_test_matches_reference(struct test_result *);
+void gemm_test_zero_k_clears_output(struct test_result *);
+void gemm_test_backends(struct test_result *);
+void gemm_test_packed_matches_reference(struct test_result *);
+void gemm_test_packed_weight_invalidation(struct test_result *);
+
+static bool gemm_case_check(const struct gemm_case *const shape, const gemm_transpose trans_a, const gemm_transpose trans_b, const bool f32, const bool prepacked, struct thread_pool *const pool);
+static void gemm_reference(const gemm_transpose trans_a, const gemm_transpose trans_b, const struct gemm_case *const shape, const double *const a, const size_t lda, const double *const b, const size_t ldb, double *const c);
+
+int main(int argc, char **argv)
+{
+    struct test_list *tests = tests_list_alloc();
+    test_list_append(tests, &gemm_test_matches_reference, "gemm_test_matches_reference");
+    test_list_append(tests, &gemm_test_zero_k_clears_output, "gemm_test_zero_k_clears_output");
+    test_list_append(tests, &gemm_test_backends, "gemm_test_backends");
+    test_list_append(tests, &gemm_test_packed_matches_reference, "gemm_test_packed_matches_reference");
+    test_list_append(tests, &gemm_test_packed_weight_invalidation, "gemm_test_packed_weight_invalidation");
+
+    run_tests(tests);
+
+    size_t num_failed_tests = 0;
+    test_list_foreach(tests, &report_failures, &num_failed_tests);
+
+    size_t num_passed_tests = tests->size - num_failed_tests;
+    float percentage_passed_tests = ((float)num_passed_tests / (float)tests->size) * 100.0;
+    float percentage_failed_tests = ((float)num_failed_tests / (float)tests->size) * 100.0;
+
+    printf("Number of tests: %ld\n", tests->size);
+    printf("Number of passed tests: %ld (%.2f \%)\n", num_passed_tests, percentage_passed_tests);
+    printf("Number of failed tests: %ld (%.2f \%)\n", num_failed_tests, percentage_failed_tests);
+
+    return EXIT_SUCCESS;
+}
+
+void gemm_test_matches_reference(struct test_result *result)
+{
+    // Edge tiles, several blocks along every dimension and reductions longer than a packed panel
+    const struct gemm_case CASES[] = {
+        {1, 1, 1},
+        {7, 13, 5},
+        {6, 32, 64},
+        {100, 35, 17},
+        {130, 70, 300},
+        {3, 4100, 2},
+    };
+    const gemm_transpose TRANS[] = {GEMM_NO_TRANS, GEMM_TRANS};
+
+    struct thread_pool pool;
+    bool initialized = false;
+    ASSERT_TRUE(gemm_set_backend(GEMM_BACKEND_NATIVE) == NO_ERROR, "The native backend should always be available.");
+    ASSERT_TRUE(thread_pool_init(&pool, N_THREADS) == NO_ERROR, "Thread pool initialization should not fail.");
+    initialized = true;
+
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++)
+    {
+        for (size_t ta = 0; ta < 2; ta++)
+        {
+            for (size_t tb = 0; tb < 2; tb++)
+            {
+                ASSERT_TRUE(gemm_case_check(&CASES[i], TRANS[ta], TRANS[tb], false, false, NULL), "f64 product should match the reference.");
+                ASSERT_TRUE(gemm_case_check(&CASES[i], TRANS[ta], TRANS[tb], true, false, NULL), "f32 product should match the reference.");
+                ASSERT_TRUE(gemm_case_check(&CASES[i], TRANS[ta], TRANS[tb], false, false, &pool), "Parallel f64 product should match the reference.");
+                ASSERT_TRUE(gemm_case_check(&CASES[i], TRANS[ta], TRANS[tb], true, false, &pool), "Parallel f32 product should match the reference.");
+            }
+        }
+    }
+
+test_cleanup:
+    if (initialized)
+    {
+        thread_pool_cleanup(&pool);
+    }
+}
+
+void gemm_test_zero_k_clears_output(struct test_result *result)
+{
+    float c_f32[6] = {1, 2, 3, 4, 5, 6};
+    double c_f64[6] = {1, 2, 3, 4, 5, 6};
+
+    ASSERT_TRUE(gemm_set_backend(GEMM_BACKEND_NATIVE) == NO_ERROR, "The native backend should always be available.");
+    ASSERT_TRUE(gemm_f32(GEMM_NO_TRANS, GEMM_NO_TRANS, 2, 3, 0, NULL, 1, NULL, 3, c_f32, 3, NULL) == NO_ERROR, "Empty product should not fail.");
+    ASSERT_TRUE(gemm_f64(GEMM_NO_TRANS, GEMM_NO_TRANS, 2, 3, 0, NULL, 1, NULL, 3, c_f64, 3, NULL) == NO_ERROR, "Empty product should not fail.");
+    for (size_t i = 0; i < 6; i++)
+    {
+        ASSERT_TRUE(c_f32[i] == 0.0f && c_f64[i] == 0.0, "An empty reduction should produce zeros.");
+    }
+
+test_cleanup:
+    return;
+}
+
+void gemm_test_backends(struct test_result *result)
+{
+    const struct gemm_case SHAPE = {33, 17, 40};
+    const gemm_backend initial = gemm_get_backend();
+
+    ASSERT_TRUE(gemm_set_backend(GEMM_BACKEND_NATIVE) == NO_ERROR && gemm_get_backend() == GEMM_BACKEND_NATIVE, "The native backend should always be available.");
+
+#ifdef CGRAD_USE_BLAS
+    ASSERT_TRUE(gemm_set_backend(GEMM_BACKEND_BLAS) == NO_ERROR && gemm_get_backend() == GEMM_BACKEND_BLAS, "BLAS should be selectable when linked.");
+    ASSERT_TRUE(gemm_case_check(&SHAPE, GEMM_TRANS, GEMM_NO_TRANS, true, false, NULL), "BLAS f32 product should match the reference.");
+    ASSERT_TRUE(gemm_case_check(&SHAPE, GEMM_NO_TRANS, GEMM_TRANS, false, false, NULL), "BLAS f64 product should match the reference.");
+#else
+    ASSERT_TRUE(gemm_set_backend(GEMM_BACKEND_BLAS) == GEMM_BACKEND_UNAVAILABLE, "BLAS should not be selectable when not linked.");
+    ASSERT_TRUE(gemm_get_backend() == GEMM_BACKEND_NATIVE, "A failed selection should keep the current backend.");
+    ASSERT_TRUE(gemm_case_check(&SHAPE, GEMM_TRANS, GEMM_NO_TRANS, true, false, NULL), "Native f32 product should match the reference.");
+#endif
+
+test_cleanup:
+    gemm_set_backend(initial);
+}
+
+void gemm_test_packed_matches_reference(struct test_result *result)
+{
+    // A single row, a single strip and several packed panels along both k and n
+    const struct gemm_case CASES[] = {
+        {1, 10, 784},
+        {5, 1, 3},
+        {17, 4100, 300},
+    };
+    const gemm_transpose TRANS[] = {GEMM_NO_TRANS, GEMM_TRANS};
+
+    struct thread_pool pool;
+    bool initialized = false;
+    ASSERT_TRUE(gemm_set_backend(GEMM_BACKEND_NATIVE) == NO_ERROR, "The native backend should always be available.");
+    ASSERT_TRUE(thread_pool_init(&pool, N_THREADS) == NO_ERROR, "Thread pool initialization should not fail.");
+    initialized = true;
+
+    for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); i++)
+    {
+        for (size_t ta = 0; ta < 2; ta++)
+        {
+            for (size_t tb = 0; tb < 2; tb++)
+            {
+                ASSERT_TRUE(gemm_case_check(&CASES[i], TRANS[ta], TRANS[tb], false, true, NULL), "Prepacked f64 product should match the reference.");
+                ASSERT_TRUE(gemm_case_check(&CASES[i], TRANS[ta], TRANS[tb], true, true, &pool), "Prepacked f32 product should match the reference.");
+            }
+        }
+    }
+
+test_cleanup:
+    if (initialized)
+    {
+        thread_pool_cleanup(&pool);
+    }
+}
+
+void gemm_test_packed_weight_invalidation(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    struct packed_weight cache;
+    bool env_initialized = false;
+    bool cache_initialized = false;
+    ASSERT_TRUE(gemm_set_backend(GEMM_BACKEND_NATIVE) == NO_ERROR, "The native backend should always be available.");
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+    env_initialized = true;
+    ASSERT_TRUE(packed_weight_init(&cache) == NO_ERROR, "Packed weight initialization should not fail.");
+    cache_initialized = true;
+
+    // The weight is used as a {3, 4} matrix, transposed like a convolution kernel
+    const size_t weight_shape[] = {3, 2, 2};
+    const size_t x_shape[] = {5, 4};
+    struct tensor *weight = tensor_alloc(&env, weight_shape, 3, DTYPE_FLOAT64);
+    struct tensor *x = tensor_alloc(&env, x_shape, 2, DTYPE_FLOAT64);
+    ASSERT_TRUE(weight && x, "Tensor allocation should not fail.");
+    for (size_t i = 0; i < weight->data_size; i++)
+    {
+        ((double *)weight->data)[i] = (double)i - 4.0;
+    }
+    for (size_t i = 0; i < x->data_size; i++)
+    {
+        ((double *)x->data)[i] = (double)(i % 7);
+    }
+
+    for (size_t update = 0; update < 2; update++)
+    {
+        const struct gemm_packed_b *packed = NULL;
+        struct tensor *out = NULL;
+        ASSERT_TRUE(packed_weight_get(&cache, weight, GEMM_TRANS, &packed, NULL) == NO_ERROR && packed, "Packing the weight should not fail.");
+        ASSERT_TRUE(tensor2d_mult_packed(x, weight, GEMM_TRANS, packed, &out, false, &env) == NO_ERROR, "Prepacked product should not fail.");
+
+        double expected[5 * 3];
+        ASSERT_TRUE(gemm_f64(GEMM_NO_TRANS, GEMM_TRANS, 5, 3, 4, x->data, 4, weight->data, 4, expected, 3, NULL) == NO_ERROR, "Reference product should not fail.");
+        ASSERT_TRUE(memcmp(expected, out->data, sizeof(expected)) == 0, "Prepacked product should use the current weight.");
+        tensor_free(&env, out);
+
+        // A current packing is returned without taking the mutex, which would otherwise deadlock here
+        const struct gemm_packed_b *current = NULL;
+        pthread_mutex_lock(&cache.mutex);
+        const cgrad_error err = packed_weight_get(&cache, weight, GEMM_TRANS, &current, NULL);
+        pthread_mutex_unlock(&cache.mutex);
+        ASSERT_TRUE(err == NO_ERROR && current == packed, "A current packing should be returned without locking.");
+
+        // Updated in place, as an optimizer step does
+        for (size_t i = 0; i < weight->data_size; i++)
+        {
+            ((double *)weight->data)[i] *= -0.5;
+        }
+        tensor_mark_modified(weight);
+    }
+
+test_cleanup:
+    if (cache_initialized)
+    {
+        packed_weight_cleanup(&cache);
+    }
+    if (env_initialized)
+    {
+        cgrad_env_cleanup(&env);
+    }
+}
+
+static bool gemm_case_check(const struct gemm_case *const shape, const gemm_transpose trans_a, const gemm_transpose trans_b, const bool f32, const bool prepacked, struct thread_pool *const pool)
+{
+    const size_t a_rows = trans_a == GEMM_NO_TRANS ? shape->m : shape->k;
+    const size_t a_cols = trans_a == GEMM_NO_TRANS ? shape->k : shape->m;
+    const size_t b_rows = trans_b == GEMM_NO_TRANS ? shape->k : shape->n;
+    const size_t b_cols = trans_b == GEMM_NO_TRANS ? shape->n : shape->k;
+    const size_t lda = a_cols + LD_PADDING;
+    const size_t ldb = b_cols + LD_PADDING;
+    const size_t ldc = shape->n + LD_PADDING;
+
+    double *a = malloc(a_rows * lda * sizeof(double));
+    double *b = malloc(b_rows * ldb * sizeof(double));
+    double *expected = malloc(shape->m * shape->n * sizeof(double));
+    double *c_f64 = malloc(shape->m * ldc * sizeof(double));
+    float *a_f32 = malloc(a_rows * lda * sizeof(float));
+    float *b_f32 = malloc(b_rows * ldb * sizeof(float));
+    float *c_f32 = malloc(shape->m * ldc * sizeof(float));
+    bool matches = a && b && expected && c_f64 && a_f32 && b_f32 && c_f32;
+
+    if (matches)
+    {
+        // Small integers keep the products exact in float32 for reductions of a few hundred terms
+        for (size_t i = 0; i < a_rows * lda; i++)
+        {
+            a[i] = (double)((int)(i * 7 % 11) - 5);
+            a_f32[i] = (float)a[i];
+        }
+        for (size_t i = 0; i < b_rows * ldb; i++)
+        {
+            b[i] = (double)((int)(i * 5 % 13) - 6);
+            b_f32[i] = (float)b[i];
+        }
+        for (size_t i = 0; i < shape->m * ldc; i++)
+        {
+            c_f64[i] = NAN;
+            c_f32[i] = NAN;
+        }
+        gemm_reference(trans_a, trans_b, shape, a, lda, b, ldb, expected);
+
+        cgrad_error err = NO_ERROR;
+        if (prepacked)
+        {
+            struct gemm_packed_b packed;
+            gemm_packed_b_init(&packed);
+            err = f32 ? gemm_pack_b_f32(trans_b, shape->k, shape->n, b_f32, ldb, &packed, pool)
+                      : gemm_pack_b_f64(trans_b, shape->k, shape->n, b, ldb, &packed, pool);
+            if (err == NO_ERROR)
+            {
+                err = f32 ? gemm_packed_f32(trans_a, shape->m, a_f32, lda, &packed, c_f32, ldc, pool)
+                          : gemm_packed_f64(trans_a, shape->m, a, lda, &packed, c_f64, ldc, pool);
+            }
+            gemm_packed_b_cleanup(&packed);
+        }
+        else
+        {
+            err = f32 ? gemm_f32(trans_a, trans_b, shape->m, shape->n, shape->k, a_f32, lda, b_f32, ldb, c_f32, ldc, pool)
+                      : gemm_f64(trans_a, trans_b, shape->m, shape->n, shape->k, a, lda, b, ldb, c_f64, ldc, pool);
+        }
+        matches = err == NO_ERROR;
+
+        for (size_t i = 0; matches && i < shape->m; i++)
+        {
+            for (size_t j = 0; matches && j < shape->n; j++)
+            {
+                const double value = f32 ? (double)c_f32[i * ldc + j] : c_f64[i * ldc + j];
+                matches = value == expected[i * shape->n + j];
+            }
+            for (size_t j = shape->n; matches && j < ldc; j++)
+            {
+                // The padding of the output is left untouched
+                matches = f32 ? isnan(c_f32[i * ldc + j]) : isnan(c_f64[i * ldc + j]);
+            }
+        }
+    }
+
+    free(a);
+    free(b);
+    free(expected);
+    free(c_f64);
+    free(a_f32);
+    free(b_f32);
+    free(c_f32);
+
+    return matches;
+}
+
+static void gemm_reference(const gemm_transpose trans_a, const gemm_transpose trans_b, const struct gemm_case *const shape, const double *const a, const size_t lda, const double *const b, const size_t ldb, double *const c)
+{
+    for (size_t i = 0; i < shape->m; i++)
+    {
+        for (size_t j = 0; j < shape->n; j++)
+        {
+            double sum = 0.0;
+            for (size_t p = 0; p < shape->k; p++)
+            {
+                const double a_ip = trans_a == GEMM_NO_TRANS ? a[i * lda + p] : a[p * lda + i];
+                const double b_pj = trans_b == GEMM_NO_TRANS ? b[p * ldb + j] : b[j * ldb + p];
+                sum += a_ip * b_pj;
+            }
+            c[i * shape->n + j] = sum;
+        }
+    }
+}
@@ -0,0 +1,179 @@
+#include "cgrad_test/assert.h"
+#include "cgrad_test/config.h"
+#include "cgrad_test/test_result.h"
+#include "cgrad_test/test_case.h"
+#include "cgrad_test/datastructures/test_list/test_list.h"
+#include "cgrad_test/datastructures/test_list/test_list_callbacks.h"
+#include "cgrad_test/run_tests.h"
+#include "cgrad/serving/inference_batcher.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+void inference_batcher_test_batched_forward(struct test_result *);
+void inference_batcher_test_queue_full(struct test_result *);
+
+static cgrad_error linear_model_forward(void *model, struct tensor *const x, struct tensor **const out, struct cgrad_env *const env);
+
+int main(int argc, char **argv)
+{
+    struct test_list *tests = tests_list_alloc();
+    test_list_append(tests, &inference_batcher_test_batched_forward, "inference_batcher_test_batched_forward");
+    test_list_append(tests, &inference_batcher_test_queue_full, "inference_batcher_test_queue_full");
+
+    run_tests(tests);
+
+    size_t num_failed_tests = 0;
+    test_list_foreach(tests, &report_failures, &num_failed_tests);
+
+    size_t num_passed_tests = tests->size - num_failed_tests;
+    float percentage_passed_tests = ((float)num_passed_tests / (float)tests->size) * 100.0;
+    float percentage_failed_tests = ((float)num_failed_tests / (float)tests->size) * 100.0;
+
+    printf("Number of tests: %ld\n", tests->size);
+    printf("Number of passed tests: %ld (%.2f \%)\n", num_passed_tests, percentage_passed_tests);
+    printf("Number of failed tests: %ld (%.2f \%)\n", num_failed_tests, percentage_failed_tests);
+
+    return EXIT_SUCCESS;
+}
+
+void inference_batcher_test_batched_forward(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t IN_DIM = 6;
+    const size_t OUT_DIM = 3;
+    const size_t N_REQUESTS = 10;
+    const size_t MAX_BATCH_SIZE = 4;
+
+    struct linear layer;
+    ASSERT_TRUE(linear_init(&layer, IN_DIM, OUT_DIM, DTYPE, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_xavier_init(&layer) == NO_ERROR, "Linear Xavier initialization failed.");
+
+    float inputs[10][6];
+    float outputs[10][3];
+    for (size_t i = 0; i < N_REQUESTS; i++)
+    {
+        for (size_t j = 0; j < IN_DIM; j++)
+        {
+            inputs[i][j] = 0.1f * i - 0.2f * j;
+        }
+    }
+
+    // Reference outputs, computed on a single batch before the batcher owns the environment
+    const size_t x_shape[] = {N_REQUESTS, IN_DIM};
+    struct tensor *x = tensor_from_array_alloc(&env, inputs, x_shape, 2, DTYPE);
+    struct tensor *expected = NULL;
+    ASSERT_TRUE(linear_forward(&layer, x, &expected, false) == NO_ERROR, "Linear forward failed.");
+
+    // The delay is long enough for the submissions of a batch to be gathered
+    const struct inference_batcher_config config = {
+        .in_dim = IN_DIM,
+        .out_dim = OUT_DIM,
+        .dtype = DTYPE,
+        .max_batch_size = MAX_BATCH_SIZE,
+        .max_delay_us = 200000,
+        .queue_capacity = 16,
+    };
+    struct inference_batcher batcher;
+    ASSERT_TRUE(inference_batcher_init(&batcher, &config, &linear_model_forward, &layer, &env) == NO_ERROR, "Batcher initialization failed.");
+
+    struct inference_future futures[10];
+    for (size_t i = 0; i < N_REQUESTS; i++)
+    {
+        futures[i].input = inputs[i];
+        futures[i].output = outputs[i];
+        ASSERT_TRUE(inference_batcher_submit(&batcher, &futures[i]) == NO_ERROR, "Submission failed.");
+    }
+    for (size_t i = 0; i < N_REQUESTS; i++)
+    {
+        ASSERT_TRUE(inference_future_wait(&batcher, &futures[i]) == NO_ERROR, "Request failed.");
+    }
+
+    struct inference_batcher_stats stats;
+    size_t histogram[5];
+    ASSERT_TRUE(inference_batcher_get_stats(&batcher, &stats, histogram) == NO_ERROR, "Stats retrieval failed.");
+    inference_batcher_cleanup(&batcher);
+
+    const float *expected_data = expected->data;
+    for (size_t i = 0; i < N_REQUESTS; i++)
+    {
+        for (size_t j = 0; j < OUT_DIM; j++)
+        {
+            ASSERT_TRUE(fabsf(outputs[i][j] - expected_data[i * OUT_DIM + j]) < 1e-5f, "Batched output differs from the reference.");
+        }
+    }
+
+    size_t histogram_requests = 0;
+    for (size_t size = 1; size <= MAX_BATCH_SIZE; size++)
+    {
+        histogram_requests += size * histogram[size];
+    }
+    ASSERT_TRUE(stats.completed_requests == N_REQUESTS && histogram_requests == N_REQUESTS, "Every request should be counted once.");
+    ASSERT_TRUE(stats.queue_depth == 0, "Queue should be empty.");
+    ASSERT_TRUE(stats.mean_batch_size > 1.0, "Requests should have been batched.");
+    ASSERT_TRUE(stats.latency_p50_us <= stats.latency_p90_us && stats.latency_p90_us <= stats.latency_p99_us, "Percentiles should be ordered.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void inference_batcher_test_queue_full(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct linear layer;
+    ASSERT_TRUE(linear_init(&layer, 2, 2, DTYPE, &env) == NO_ERROR, "Linear initialization failed.");
+
+    // The dispatcher waits for a full batch, which the queue can never hold
+    const struct inference_batcher_config config = {
+        .in_dim = 2,
+        .out_dim = 2,
+        .dtype = DTYPE,
+        .max_batch_size = 8,
+        .max_delay_us = 1000000,
+        .queue_capacity = 2,
+    };
+    struct inference_batcher batcher;
+    ASSERT_TRUE(inference_batcher_init(&batcher, &config, &linear_model_forward, &layer, &env) == NO_ERROR, "Batcher initialization failed.");
+
+    float inputs[3][2] = {{1.0f, 2.0f}, {3.0f, 4.0f}, {5.0f, 6.0f}};
+    float outputs[3][2];
+    struct inference_future futures[3];
+    for (size_t i = 0; i < 3; i++)
+    {
+        futures[i].input = inputs[i];
+        futures[i].output = outputs[i];
+    }
+
+    cgrad_error err0 = inference_batcher_submit(&batcher, &futures[0]);
+    cgrad_error err1 = inference_batcher_submit(&batcher, &futures[1]);
+    cgrad_error err2 = inference_batcher_submit(&batcher, &futures[2]);
+
+    // Cleanup runs the pending requests before stopping
+    inference_batcher_cleanup(&batcher);
+
+    ASSERT_TRUE(err0 == NO_ERROR && err1 == NO_ERROR, "Submissions within capacity should succeed.");
+    ASSERT_TRUE(err2 == INFERENCE_BATCHER_QUEUE_FULL, "Submission beyond capacity should be rejected.");
+    ASSERT_TRUE(futures[0].done && futures[1].done, "Pending requests should complete on cleanup.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+static cgrad_error linear_model_forward(void *model, struct tensor *const x, struct tensor **const out, struct cgrad_env *const env)
+{
+    return linear_forward((struct linear *)model, x, out, false);
+}
@@ -0,0 +1,305 @@
+#include "cgrad_test/assert.h"
+#include "cgrad_test/config.h"
+#include "cgrad_test/test_result.h"
+#include "cgrad_test/test_case.h"
+#include "cgrad_test/datastructures/test_list/test_list.h"
+#include "cgrad_test/datastructures/test_list/test_list_callbacks.h"
+#include "cgrad_test/run_tests.h"
+#include "cgrad/model/model_checkpoint.h"
+#include "cgrad/model/model_checkpoint_writer.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/optimizers/sgd.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHECKPOINT_TEST_PATH "model_checkpoint_test.bin"
+
+void model_checkpoint_test_save_load(struct test_result *);
+void model_checkpoint_test_map(struct test_result *);
+void model_checkpoint_test_mismatch(struct test_result *);
+void model_checkpoint_test_writer(struct test_result *);
+
+static bool tensor_data_equal(const struct tensor *const a, const struct tensor *const b);
+static bool files_equal(const char *const path1, const char *const path2);
+
+int main(int argc, char **argv)
+{
+    struct test_list *tests = tests_list_alloc();
+    test_list_append(tests, &model_checkpoint_test_save_load, "model_checkpoint_test_save_load");
+    test_list_append(tests, &model_checkpoint_test_map, "model_checkpoint_test_map");
+    test_list_append(tests, &model_checkpoint_test_mismatch, "model_checkpoint_test_mismatch");
+    test_list_append(tests, &model_checkpoint_test_writer, "model_checkpoint_test_writer");
+
+    run_tests(tests);
+
+    size_t num_failed_tests = 0;
+    test_list_foreach(tests, &report_failures, &num_failed_tests);
+
+    size_t num_passed_tests = tests->size - num_failed_tests;
+    float percentage_passed_tests = ((float)num_passed_tests / (float)tests->size) * 100.0;
+    float percentage_failed_tests = ((float)num_failed_tests / (float)tests->size) * 100.0;
+
+    printf("Number of tests: %ld\n", tests->size);
+    printf("Number of passed tests: %ld (%.2f \%)\n", num_passed_tests, percentage_passed_tests);
+    printf("Number of failed tests: %ld (%.2f \%)\n", num_failed_tests, percentage_failed_tests);
+
+    return EXIT_SUCCESS;
+}
+
+void model_checkpoint_test_save_load(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    // A float32 and a float16 layer, the latter also has master weights in the optimizer
+    struct linear saved1, saved2, loaded1, loaded2;
+    ASSERT_TRUE(linear_init(&saved1, 13, 7, DTYPE_FLOAT32, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_init(&saved2, 7, 3, DTYPE_FLOAT16, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_init(&loaded1, 13, 7, DTYPE_FLOAT32, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_init(&loaded2, 7, 3, DTYPE_FLOAT16, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_xavier_init(&saved1) == NO_ERROR && linear_xavier_init(&saved2) == NO_ERROR, "Linear Xavier initialization failed.");
+
+    struct model_params saved_params, loaded_params;
+    model_params_init(&saved_params);
+    model_params_init(&loaded_params);
+    model_params_add(&saved_params, saved1.weight);
+    model_params_add(&saved_params, saved1.bias);
+    model_params_add(&saved_params, saved2.weight);
+    model_params_add(&saved_params, saved2.bias);
+    model_params_add(&loaded_params, loaded1.weight);
+    model_params_add(&loaded_params, loaded1.bias);
+    model_params_add(&loaded_params, loaded2.weight);
+    model_params_add(&loaded_params, loaded2.bias);
+
+    struct sgd_optimizer saved_opt, loaded_opt;
+    ASSERT_TRUE(sgd_optimizer_init(&saved_opt, &saved_params, 0.1, 0.9, false, &env) == NO_ERROR, "Optimizer initialization failed.");
+    ASSERT_TRUE(sgd_optimizer_init(&loaded_opt, &loaded_params, 0.1, 0.9, false, &env) == NO_ERROR, "Optimizer initialization failed.");
+
+    // Non-zero momentum, so that restoring it can be told apart from the initial state
+    float *momentum = saved_opt.prev_b_t[0]->data;
+    for (size_t i = 0; i < saved_opt.prev_b_t[0]->data_size; i++)
+    {
+        momentum[i] = 0.5f * i;
+    }
+
+    ASSERT_TRUE(model_checkpoint_save(&saved_params, &saved_opt, CHECKPOINT_TEST_PATH) == NO_ERROR, "Checkpoint save failed.");
+    ASSERT_TRUE(model_checkpoint_load(&loaded_params, &loaded_opt, CHECKPOINT_TEST_PATH) == NO_ERROR, "Checkpoint load failed.");
+
+    for (size_t i = 0; i < saved_params.size; i++)
+    {
+        ASSERT_TRUE(tensor_data_equal(saved_params.params[i], loaded_params.params[i]), "Loaded parameter differs from the saved one.");
+        ASSERT_TRUE(tensor_data_equal(saved_opt.prev_b_t[i], loaded_opt.prev_b_t[i]), "Loaded momentum differs from the saved one.");
+    }
+    ASSERT_TRUE(tensor_data_equal(saved_opt.master[2], loaded_opt.master[2]), "Loaded master weights differ from the saved ones.");
+
+test_cleanup:
+    remove(CHECKPOINT_TEST_PATH);
+    cgrad_env_cleanup(&env);
+}
+
+void model_checkpoint_test_map(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct linear saved, mapped;
+    ASSERT_TRUE(linear_init(&saved, 31, 5, DTYPE_FLOAT64, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_init(&mapped, 31, 5, DTYPE_FLOAT64, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_xavier_init(&saved) == NO_ERROR, "Linear Xavier initialization failed.");
+
+    struct model_params saved_params, mapped_params;
+    model_params_init(&saved_params);
+    model_params_init(&mapped_params);
+    model_params_add(&saved_params, saved.weight);
+    model_params_add(&saved_params, saved.bias);
+    model_params_add(&mapped_params, mapped.weight);
+    model_params_add(&mapped_params, mapped.bias);
+
+    ASSERT_TRUE(model_checkpoint_save(&saved_params, NULL, CHECKPOINT_TEST_PATH) == NO_ERROR, "Checkpoint save failed.");
+
+    void *weight_data = mapped.weight->data;
+    void *bias_data = mapped.bias->data;
+
+    struct model_checkpoint_mapping mapping;
+    ASSERT_TRUE(model_checkpoint_map(&mapping, &mapped_params, CHECKPOINT_TEST_PATH) == NO_ERROR, "Checkpoint mapping failed.");
+
+    const char *begin = mapping.addr;
+    const char *weight = mapped.weight->data;
+    ASSERT_TRUE(weight >= begin && weight < begin + mapping.size, "Parameters should point into the mapping.");
+    ASSERT_TRUE((uintptr_t)mapped.weight->data % MODEL_CHECKPOINT_ALIGNMENT == 0 && (uintptr_t)mapped.bias->data % MODEL_CHECKPOINT_ALIGNMENT == 0, "Mapped parameters should be aligned.");
+    ASSERT_TRUE(tensor_data_equal(saved.weight, mapped.weight) && tensor_data_equal(saved.bias, mapped.bias), "Mapped parameters differ from the saved ones.");
+
+    model_checkpoint_unmap(&mapping);
+    ASSERT_TRUE(mapped.weight->data == weight_data && mapped.bias->data == bias_data, "Unmapping should restore the parameter buffers.");
+
+test_cleanup:
+    remove(CHECKPOINT_TEST_PATH);
+    cgrad_env_cleanup(&env);
+}
+
+void model_checkpoint_test_mismatch(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct linear saved, other_shape, other_dtype;
+    ASSERT_TRUE(linear_init(&saved, 4, 3, DTYPE_FLOAT32, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_init(&other_shape, 3, 4, DTYPE_FLOAT32, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_init(&other_dtype, 4, 3, DTYPE_FLOAT64, &env) == NO_ERROR, "Linear initialization failed.");
+
+    struct model_params saved_params, other_shape_params, other_dtype_params, fewer_params;
+    model_params_init(&saved_params);
+    model_params_init(&other_shape_params);
+    model_params_init(&other_dtype_params);
+    model_params_init(&fewer_params);
+    model_params_add(&saved_params, saved.weight);
+    model_params_add(&saved_params, saved.bias);
+    model_params_add(&other_shape_params, other_shape.weight);
+    model_params_add(&other_shape_params, saved.bias);
+    model_params_add(&other_dtype_params, other_dtype.weight);
+    model_params_add(&other_dtype_params, other_dtype.bias);
+    model_params_add(&fewer_params, saved.weight);
+
+    ASSERT_TRUE(model_checkpoint_save(&saved_params, NULL, CHECKPOINT_TEST_PATH) == NO_ERROR, "Checkpoint save failed.");
+    ASSERT_TRUE(model_checkpoint_load(&other_shape_params, NULL, CHECKPOINT_TEST_PATH) == MODEL_CHECKPOINT_PARAMS_MISMATCH, "Shape mismatch should be detected.");
+    ASSERT_TRUE(model_checkpoint_load(&other_dtype_params, NULL, CHECKPOINT_TEST_PATH) == MODEL_CHECKPOINT_PARAMS_MISMATCH, "Dtype mismatch should be detected.");
+    ASSERT_TRUE(model_checkpoint_load(&fewer_params, NULL, CHECKPOINT_TEST_PATH) == MODEL_CHECKPOINT_PARAMS_MISMATCH, "Different number of parameters should be detected.");
+
+    // A file which is not a checkpoint
+    FILE *file = fopen(CHECKPOINT_TEST_PATH, "wb");
+    ASSERT_TRUE(file != NULL, "Could not create test file.");
+    const char garbage[128] = "not a checkpoint";
+    fwrite(garbage, 1, sizeof(garbage), file);
+    fclose(file);
+    ASSERT_TRUE(model_checkpoint_load(&saved_params, NULL, CHECKPOINT_TEST_PATH) == MODEL_CHECKPOINT_INVALID_FORMAT, "Invalid file should be rejected.");
+
+    remove(CHECKPOINT_TEST_PATH);
+    ASSERT_TRUE(model_checkpoint_load(&saved_params, NULL, CHECKPOINT_TEST_PATH) == MODEL_CHECKPOINT_FILE_ERROR, "Missing file should be reported.");
+
+test_cleanup:
+    remove(CHECKPOINT_TEST_PATH);
+    cgrad_env_cleanup(&env);
+}
+
+void model_checkpoint_test_writer(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const size_t KEEP_LAST = 2;
+    const char *const PATHS[] = {"model_checkpoint_writer_test_0.bin", "model_checkpoint_writer_test_1.bin", "model_checkpoint_writer_test_2.bin"};
+
+    bool writer_started = false;
+    struct model_checkpoint_writer writer;
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    struct linear saved, loaded;
+    ASSERT_TRUE(linear_init(&saved, 13, 7, DTYPE_FLOAT32, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_init(&loaded, 13, 7, DTYPE_FLOAT32, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_xavier_init(&saved) == NO_ERROR, "Linear Xavier initialization failed.");
+
+    struct model_params saved_params, loaded_params;
+    model_params_init(&saved_params);
+    model_params_init(&loaded_params);
+    model_params_add(&saved_params, saved.weight);
+    model_params_add(&saved_params, saved.bias);
+    model_params_add(&loaded_params, loaded.weight);
+    model_params_add(&loaded_params, loaded.bias);
+
+    struct sgd_optimizer saved_opt;
+    ASSERT_TRUE(sgd_optimizer_init(&saved_opt, &saved_params, 0.1, 0.9, false, &env) == NO_ERROR, "Optimizer initialization failed.");
+
+    ASSERT_TRUE(model_checkpoint_writer_init(&writer, KEEP_LAST) == NO_ERROR, "Writer initialization failed.");
+    writer_started = true;
+
+    // Each snapshot is compared with a synchronous save of the same state, then the weights are changed at once
+    float *weight = (float *)saved.weight->data;
+    for (size_t c = 0; c < 3; c++)
+    {
+        ASSERT_TRUE(model_checkpoint_writer_save(&writer, &saved_params, &saved_opt, PATHS[c]) == NO_ERROR, "Snapshot failed.");
+        ASSERT_TRUE(model_checkpoint_save(&saved_params, &saved_opt, CHECKPOINT_TEST_PATH) == NO_ERROR, "Checkpoint save failed.");
+        ASSERT_TRUE(writer.last_blocked_seconds <= writer.blocked_seconds, "Blocked time should be accumulated.");
+        ASSERT_TRUE(model_checkpoint_writer_wait(&writer) == NO_ERROR, "Background write failed.");
+        ASSERT_TRUE(files_equal(PATHS[c], CHECKPOINT_TEST_PATH), "Background checkpoint differs from the synchronous one.");
+
+        ASSERT_TRUE(model_checkpoint_writer_save(&writer, &saved_params, &saved_opt, PATHS[c]) == NO_ERROR, "Snapshot failed.");
+        for (size_t i = 0; i < saved.weight->data_size; i++)
+        {
+            weight[i] += 1.0f;
+        }
+    }
+    ASSERT_TRUE(model_checkpoint_writer_wait(&writer) == NO_ERROR, "Background write failed.");
+    ASSERT_TRUE(writer.n_saved == 6, "Every snapshot should be written.");
+
+    // Only the last KEEP_LAST paths are kept, a path written twice counting once
+    ASSERT_TRUE(access(PATHS[0], F_OK) != 0, "The oldest checkpoint should be removed.");
+    ASSERT_TRUE(access(PATHS[1], F_OK) == 0 && access(PATHS[2], F_OK) == 0, "The last checkpoints should be kept.");
+
+    ASSERT_TRUE(model_checkpoint_load(&loaded_params, NULL, PATHS[2]) == NO_ERROR, "Checkpoint load failed.");
+    for (size_t i = 0; i < saved.weight->data_size; i++)
+    {
+        ASSERT_TRUE(((float *)loaded.weight->data)[i] + 1.0f == weight[i], "The snapshot should precede the later updates.");
+    }
+
+    // A failed write is reported by the next wait only
+    ASSERT_TRUE(model_checkpoint_writer_save(&writer, &saved_params, &saved_opt, "model_checkpoint_writer_missing_dir/checkpoint.bin") == NO_ERROR, "Snapshot failed.");
+    ASSERT_TRUE(model_checkpoint_writer_wait(&writer) == MODEL_CHECKPOINT_FILE_ERROR, "The failed write should be reported.");
+    ASSERT_TRUE(model_checkpoint_writer_wait(&writer) == NO_ERROR, "The error should be reported once.");
+    ASSERT_TRUE(model_checkpoint_writer_save(&writer, &saved_params, &saved_opt, PATHS[2]) == NO_ERROR, "Snapshot failed.");
+    ASSERT_TRUE(model_checkpoint_writer_wait(&writer) == NO_ERROR && writer.n_saved == 7, "Writes should resume after a failure.");
+
+test_cleanup:
+    if (writer_started)
+    {
+        model_checkpoint_writer_cleanup(&writer);
+    }
+    for (size_t c = 0; c < 3; c++)
+    {
+        remove(PATHS[c]);
+    }
+    remove(CHECKPOINT_TEST_PATH);
+    cgrad_env_cleanup(&env);
+}
+
+static bool tensor_data_equal(const struct tensor *const a, const struct tensor *const b)
+{
+    return a->dtype == b->dtype && a->data_size == b->data_size && memcmp(a->data, b->data, a->data_size * dtype_sizeof(a->dtype)) == 0;
+}
+
+static bool files_equal(const char *const path1, const char *const path2)
+{
+    FILE *file1 = fopen(path1, "rb");
+    FILE *file2 = fopen(path2, "rb");
+    bool equal = file1 && file2;
+    while (equal)
+    {
+        const int c1 = fgetc(file1);
+        const int c2 = fgetc(file2);
+        equal = c1 == c2;
+        if (c1 == EOF)
+        {
+            break;
+        }
+    }
+
+    if (file1)
+    {
+        fclose(file1);
+    }
+    if (file2)
+    {
+        fclose(file2);
+    }
+    return equal;
+}
@@ -0,0 +1,351 @@
+#include "cgrad_test/assert.h"
+#include "cgrad_test/config.h"
+#include "cgrad_test/test_result.h"
+#include "cgrad_test/test_case.h"
+#include "cgrad_test/datastructures/test_list/test_list.h"
+#include "cgrad_test/datastructures/test_list/test_list_callbacks.h"
+#include "cgrad_test/run_tests.h"
+#include "cgrad/quantization/quantize.h"
+#include "cgrad/quantization/quant_observer.h"
+#include "cgrad/layers/linear.h"
+#include "cgrad/layers/linear_int8.h"
+#include "cgrad/layers/conv2d.h"
+#include "cgrad/layers/conv2d_int8.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/utils/random.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+void tensor_quantize_test_cpu_instance_1(struct test_result *);
+void quant_observer_test_compute_params(struct test_result *);
+void linear_int8_test_forward_instance_1(struct test_result *);
+void linear_int8_test_fused_relu_requantize(struct test_result *);
+void conv2d_int8_test_forward_instance_1(struct test_result *);
+
+static float max_abs_difference(const float *const a, const float *const b, const size_t n);
+static float max_abs(const float *const a, const size_t n);
+
+int main(int argc, char **argv)
+{
+    struct test_list *tests = tests_list_alloc();
+    test_list_append(tests, &tensor_quantize_test_cpu_instance_1, "tensor_quantize_test_cpu_instance_1");
+    test_list_append(tests, &quant_observer_test_compute_params, "quant_observer_test_compute_params");
+    test_list_append(tests, &linear_int8_test_forward_instance_1, "linear_int8_test_forward_instance_1");
+    test_list_append(tests, &linear_int8_test_fused_relu_requantize, "linear_int8_test_fused_relu_requantize");
+    test_list_append(tests, &conv2d_int8_test_forward_instance_1, "conv2d_int8_test_forward_instance_1");
+
+    run_tests(tests);
+
+    size_t num_failed_tests = 0;
+    test_list_foreach(tests, &report_failures, &num_failed_tests);
+
+    size_t num_passed_tests = tests->size - num_failed_tests;
+    float percentage_passed_tests = ((float)num_passed_tests / (float)tests->size) * 100.0;
+    float percentage_failed_tests = ((float)num_failed_tests / (float)tests->size) * 100.0;
+
+    printf("Number of tests: %ld\n", tests->size);
+    printf("Number of passed tests: %ld (%.2f \%)\n", num_passed_tests, percentage_passed_tests);
+    printf("Number of failed tests: %ld (%.2f \%)\n", num_failed_tests, percentage_failed_tests);
+
+    return EXIT_SUCCESS;
+}
+
+void tensor_quantize_test_cpu_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    // Enough values for the vectorized path and a scalar tail, including ties and saturating values
+    const size_t shape[] = {1, 11};
+    const float data[] = {0.0f, 0.25f, -0.25f, 0.0625f, 0.1875f, 1.0f, -1.0f, 10.0f, -10.0f, INFINITY, 0.3125f};
+    const uint8_t expected[] = {64, 66, 62, 64, 66, 72, 56, 127, 0, 127, 66};
+    const struct quant_params params = {.scale = 0.125f, .zero_point = 64};
+
+    struct tensor *t = tensor_from_array_alloc(&env, data, shape, 2, DTYPE_FLOAT32);
+    struct tensor *q = NULL;
+    ASSERT_TRUE(tensor_quantize(t, &params, &q, &env) == NO_ERROR, "Quantization failed.");
+    ASSERT_TRUE(q->dtype == DTYPE_UINT8, "Wrong output dtype.");
+    ASSERT_TRUE(memcmp(q->data, expected, sizeof(expected)) == 0, "One or more quantized values incorrect.");
+
+    struct tensor *dq = NULL;
+    ASSERT_TRUE(tensor_dequantize(q, &params, &dq, &env) == NO_ERROR, "Dequantization failed.");
+    const float *dq_data = dq->data;
+    ASSERT_TRUE(dq_data[1] == 0.25f && dq_data[7] == 7.875f && dq_data[8] == -8.0f, "One or more dequantized values incorrect.");
+
+    const struct quant_params invalid_params = {.scale = 0.0f, .zero_point = 0};
+    struct tensor *q_invalid = NULL;
+    ASSERT_TRUE(tensor_quantize(t, &invalid_params, &q_invalid, &env) == QUANT_INVALID_PARAMS, "Invalid parameters should be rejected.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void quant_observer_test_compute_params(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t shape[] = {2, 2};
+    const float batch1_data[] = {0.5f, 1.0f, 2.0f, 0.0f};
+    const float batch2_data[] = {-1.0f, 3.0f, 0.25f, 1.5f};
+    struct tensor *batch1 = tensor_from_array_alloc(&env, batch1_data, shape, 2, DTYPE_FLOAT32);
+    struct tensor *batch2 = tensor_from_array_alloc(&env, batch2_data, shape, 2, DTYPE_FLOAT32);
+
+    struct quant_observer observer;
+    quant_observer_init(&observer);
+
+    struct quant_params params;
+    ASSERT_TRUE(quant_observer_compute_params(&observer, &params) == QUANT_OBSERVER_EMPTY, "Params should not be computed without observations.");
+
+    // Non-negative activations use the whole range with a zero point of 0
+    ASSERT_TRUE(quant_observer_update(&observer, batch1) == NO_ERROR, "Observer update failed.");
+    ASSERT_TRUE(quant_observer_compute_params(&observer, &params) == NO_ERROR, "Params computation failed.");
+    ASSERT_TRUE(params.zero_point == 0, "Wrong zero point for non-negative values.");
+    ASSERT_TRUE(fabsf(params.scale - 2.0f / QUANT_ACTIVATION_QMAX) < 1e-7f, "Wrong scale for non-negative values.");
+
+    ASSERT_TRUE(quant_observer_update(&observer, batch2) == NO_ERROR, "Observer update failed.");
+    ASSERT_TRUE(quant_observer_compute_params(&observer, &params) == NO_ERROR, "Params computation failed.");
+    ASSERT_TRUE(fabsf(params.scale - 4.0f / QUANT_ACTIVATION_QMAX) < 1e-7f, "Wrong scale over several batches.");
+    ASSERT_TRUE(params.zero_point == 32, "Wrong zero point over several batches.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void linear_int8_test_forward_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    // Dimensions not multiple of the kernel tiles nor of the vector width
+    const size_t BATCH_SIZE = 5;
+    const size_t IN_DIM = 70;
+    const size_t OUT_DIM = 9;
+
+    struct linear layer;
+    ASSERT_TRUE(linear_init(&layer, IN_DIM, OUT_DIM, DTYPE, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_xavier_init(&layer) == NO_ERROR, "Linear Xavier initialization failed.");
+
+    // Output channels with very different magnitudes, which per-channel scales handle better
+    float *weight_data = layer.weight->data;
+    float *bias_data = layer.bias->data;
+    for (size_t i = 0; i < IN_DIM; i++)
+    {
+        weight_data[i * OUT_DIM] *= 0.01f;
+    }
+    for (size_t j = 0; j < OUT_DIM; j++)
+    {
+        bias_data[j] = sample_uniform(-0.5, 0.5);
+    }
+
+    const size_t x_shape[] = {BATCH_SIZE, IN_DIM};
+    struct tensor *x = tensor_no_grad_alloc(&env, x_shape, 2, DTYPE);
+    float *x_data = x->data;
+    for (size_t i = 0; i < x->data_size; i++)
+    {
+        x_data[i] = sample_uniform(-1.0, 2.0);
+    }
+
+    struct tensor *expected = NULL;
+    ASSERT_TRUE(linear_forward(&layer, x, &expected, false) == NO_ERROR, "Float forward failed.");
+
+    struct quant_observer observer;
+    quant_observer_init(&observer);
+    ASSERT_TRUE(quant_observer_update(&observer, x) == NO_ERROR, "Observer update failed.");
+    struct quant_params input_params;
+    ASSERT_TRUE(quant_observer_compute_params(&observer, &input_params) == NO_ERROR, "Params computation failed.");
+
+    struct linear_int8 per_tensor;
+    struct linear_int8 per_channel;
+    ASSERT_TRUE(linear_int8_init(&per_tensor, &layer, &input_params, QUANT_PER_TENSOR) == NO_ERROR, "Quantization failed.");
+    ASSERT_TRUE(linear_int8_init(&per_channel, &layer, &input_params, QUANT_PER_CHANNEL) == NO_ERROR, "Quantization failed.");
+    ASSERT_TRUE(per_tensor.weight.data->dtype == DTYPE_INT8, "Weights should be stored as DTYPE_INT8.");
+
+    struct tensor *out_per_tensor = NULL;
+    struct tensor *out_per_channel = NULL;
+    ASSERT_TRUE(linear_int8_forward(&per_tensor, x, &out_per_tensor) == NO_ERROR, "Quantized forward failed.");
+    ASSERT_TRUE(linear_int8_forward(&per_channel, x, &out_per_channel) == NO_ERROR, "Quantized forward failed.");
+    ASSERT_TRUE(out_per_tensor->dtype == DTYPE_FLOAT32 && out_per_tensor->shape[0] == BATCH_SIZE && out_per_tensor->shape[1] == OUT_DIM, "Wrong output.");
+
+    const float tolerance = 0.02f * max_abs(expected->data, expected->data_size);
+    ASSERT_TRUE(max_abs_difference(out_per_tensor->data, expected->data, expected->data_size) < tolerance, "Per-tensor output too far from float output.");
+    ASSERT_TRUE(max_abs_difference(out_per_channel->data, expected->data, expected->data_size) < tolerance, "Per-channel output too far from float output.");
+
+    // The small output channel is only accurate with its own scale
+    float channel_error_per_tensor = 0;
+    float channel_error_per_channel = 0;
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+    {
+        const float reference = ((float *)expected->data)[i * OUT_DIM] - bias_data[0];
+        channel_error_per_tensor += fabsf(((float *)out_per_tensor->data)[i * OUT_DIM] - bias_data[0] - reference);
+        channel_error_per_channel += fabsf(((float *)out_per_channel->data)[i * OUT_DIM] - bias_data[0] - reference);
+    }
+    ASSERT_TRUE(channel_error_per_channel < channel_error_per_tensor, "Per-channel scales should reduce the error of small channels.");
+
+    linear_int8_cleanup(&per_tensor);
+    linear_int8_cleanup(&per_channel);
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void linear_int8_test_fused_relu_requantize(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t BATCH_SIZE = 8;
+    const size_t IN_DIM = 64;
+    const size_t OUT_DIM = 16;
+
+    struct linear layer;
+    ASSERT_TRUE(linear_init(&layer, IN_DIM, OUT_DIM, DTYPE, &env) == NO_ERROR, "Linear initialization failed.");
+    ASSERT_TRUE(linear_xavier_init(&layer) == NO_ERROR, "Linear Xavier initialization failed.");
+
+    const size_t x_shape[] = {BATCH_SIZE, IN_DIM};
+    struct tensor *x = tensor_no_grad_alloc(&env, x_shape, 2, DTYPE);
+    float *x_data = x->data;
+    for (size_t i = 0; i < x->data_size; i++)
+    {
+        x_data[i] = sample_uniform(-1.0, 1.0);
+    }
+
+    struct tensor *h = NULL;
+    struct tensor *expected = NULL;
+    ASSERT_TRUE(linear_forward(&layer, x, &h, false) == NO_ERROR, "Float forward failed.");
+    ASSERT_TRUE(relu_forward(h, &expected, false, &env) == NO_ERROR, "ReLU failed.");
+
+    struct quant_observer input_observer;
+    struct quant_observer output_observer;
+    quant_observer_init(&input_observer);
+    quant_observer_init(&output_observer);
+    ASSERT_TRUE(quant_observer_update(&input_observer, x) == NO_ERROR, "Observer update failed.");
+    ASSERT_TRUE(quant_observer_update(&output_observer, expected) == NO_ERROR, "Observer update failed.");
+
+    struct quant_params input_params;
+    struct quant_params output_params;
+    ASSERT_TRUE(quant_observer_compute_params(&input_observer, &input_params) == NO_ERROR, "Params computation failed.");
+    ASSERT_TRUE(quant_observer_compute_params(&output_observer, &output_params) == NO_ERROR, "Params computation failed.");
+
+    struct linear_int8 qlayer;
+    ASSERT_TRUE(linear_int8_init(&qlayer, &layer, &input_params, QUANT_PER_CHANNEL) == NO_ERROR, "Quantization failed.");
+    ASSERT_TRUE(linear_int8_set_output(&qlayer, true, &output_params) == NO_ERROR, "Output setup failed.");
+
+    struct tensor *out = NULL;
+    ASSERT_TRUE(linear_int8_forward(&qlayer, x, &out) == NO_ERROR, "Quantized forward failed.");
+    ASSERT_TRUE(out->dtype == DTYPE_UINT8, "Requantized output should be DTYPE_UINT8.");
+
+    struct tensor *out_dequantized = NULL;
+    ASSERT_TRUE(tensor_dequantize(out, &output_params, &out_dequantized, &env) == NO_ERROR, "Dequantization failed.");
+
+    const float *out_data = out_dequantized->data;
+    const float *expected_data = expected->data;
+    bool zeros_preserved = true;
+    for (size_t i = 0; i < expected->data_size; i++)
+    {
+        zeros_preserved = zeros_preserved && (expected_data[i] > 0 || out_data[i] == 0);
+    }
+    ASSERT_TRUE(zeros_preserved, "Negative outputs should be zeroed by the fused ReLU.");
+
+    const float tolerance = 0.03f * max_abs(expected_data, expected->data_size);
+    ASSERT_TRUE(max_abs_difference(out_data, expected_data, expected->data_size) < tolerance, "Requantized output too far from float output.");
+
+    linear_int8_cleanup(&qlayer);
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void conv2d_int8_test_forward_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t BATCH_SIZE = 2;
+    const size_t IN_CHANNELS = 4;
+    const size_t OUT_CHANNELS = 5;
+    const size_t KERNEL_SIZE = 3;
+
+    struct conv2d layer;
+    ASSERT_TRUE(conv2d_init(&layer, IN_CHANNELS, OUT_CHANNELS, KERNEL_SIZE, DTYPE, &env) == NO_ERROR, "Conv2d initialization failed.");
+    ASSERT_TRUE(conv2d_xavier_init(&layer) == NO_ERROR, "Conv2d Xavier initialization failed.");
+
+    const size_t x_shape[] = {BATCH_SIZE, IN_CHANNELS, 7, 6};
+    struct tensor *x = tensor_no_grad_alloc(&env, x_shape, 4, DTYPE);
+    float *x_data = x->data;
+    for (size_t i = 0; i < x->data_size; i++)
+    {
+        x_data[i] = sample_uniform(-1.0, 1.0);
+    }
+
+    struct tensor *expected = NULL;
+    ASSERT_TRUE(conv2d_forward(&layer, x, &expected, false) == NO_ERROR, "Float forward failed.");
+
+    struct quant_observer observer;
+    quant_observer_init(&observer);
+    ASSERT_TRUE(quant_observer_update(&observer, x) == NO_ERROR, "Observer update failed.");
+    struct quant_params input_params;
+    ASSERT_TRUE(quant_observer_compute_params(&observer, &input_params) == NO_ERROR, "Params computation failed.");
+
+    struct conv2d_int8 qlayer;
+    ASSERT_TRUE(conv2d_int8_init(&qlayer, &layer, &input_params, QUANT_PER_CHANNEL) == NO_ERROR, "Quantization failed.");
+
+    struct tensor *out = NULL;
+    ASSERT_TRUE(conv2d_int8_forward(&qlayer, x, &out) == NO_ERROR, "Quantized forward failed.");
+
+    bool same_shape = out->shape_size == expected->shape_size;
+    for (size_t i = 0; same_shape && i < out->shape_size; i++)
+    {
+        same_shape = out->shape[i] == expected->shape[i];
+    }
+    ASSERT_TRUE(same_shape, "Quantized output should have the float output shape.");
+
+    const float tolerance = 0.02f * max_abs(expected->data, expected->data_size);
+    ASSERT_TRUE(max_abs_difference(out->data, expected->data, expected->data_size) < tolerance, "Quantized output too far from float output.");
+
+    conv2d_int8_cleanup(&qlayer);
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+static float max_abs_difference(const float *const a, const float *const b, const size_t n)
+{
+    float max = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        const float difference = fabsf(a[i] - b[i]);
+        max = difference > max ? difference : max;
+    }
+    return max;
+}
+
+static float max_abs(const float *const a, const size_t n)
+{
+    float max = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        max = fabsf(a[i]) > max ? fabsf(a[i]) : max;
+    }
+    return max;
+}
@@ -0,0 +1,160 @@
+#include "cgrad_test/assert.h"
+#include "cgrad_test/config.h"
+#include "cgrad_test/test_result.h"
+#include "cgrad_test/test_case.h"
+#include "cgrad_test/datastructures/test_list/test_list.h"
+#include "cgrad_test/datastructures/test_list/test_list_callbacks.h"
+#include "cgrad_test/run_tests.h"
+#include "cgrad/utils/philox.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+void philox_test_known_answer(struct test_result *);
+void philox_test_split_fills(struct test_result *);
+void philox_test_streams(struct test_result *);
+void philox_test_distributions(struct test_result *);
+
+int main(int argc, char **argv)
+{
+    struct test_list *tests = tests_list_alloc();
+    test_list_append(tests, &philox_test_known_answer, "philox_test_known_answer");
+    test_list_append(tests, &philox_test_split_fills, "philox_test_split_fills");
+    test_list_append(tests, &philox_test_streams, "philox_test_streams");
+    test_list_append(tests, &philox_test_distributions, "philox_test_distributions");
+
+    run_tests(tests);
+
+    size_t num_failed_tests = 0;
+    test_list_foreach(tests, &report_failures, &num_failed_tests);
+
+    size_t num_passed_tests = tests->size - num_failed_tests;
+    float percentage_passed_tests = ((float)num_passed_tests / (float)tests->size) * 100.0;
+    float percentage_failed_tests = ((float)num_failed_tests / (float)tests->size) * 100.0;
+
+    printf("Number of tests: %ld\n", tests->size);
+    printf("Number of passed tests: %ld (%.2f \%)\n", num_passed_tests, percentage_passed_tests);
+    printf("Number of failed tests: %ld (%.2f \%)\n", num_failed_tests, percentage_failed_tests);
+
+    return EXIT_SUCCESS;
+}
+
+void philox_test_known_answer(struct test_result *result)
+{
+    // Philox4x32-10 reference output for a zero key and a zero counter
+    const uint32_t expected[] = {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8};
+
+    struct philox_state state;
+    philox_init(&state, 0);
+
+    uint32_t words[4];
+    philox_fill_u32(&state, words, 4);
+    ASSERT_TRUE(memcmp(words, expected, sizeof(expected)) == 0, "Output differs from the Philox4x32-10 reference.");
+    ASSERT_TRUE(state.offset == 4, "Generator should advance by the number of words.");
+
+test_cleanup:
+}
+
+void philox_test_split_fills(struct test_result *result)
+{
+    const size_t N = 1000;
+    uint32_t whole[1000];
+    uint32_t split[1000];
+
+    // Offset close to a carry of the low counter word, to exercise it in the vectorized blocks
+    struct philox_state state;
+    philox_init(&state, 1234);
+    philox_skip(&state, 4 * 0xfffffffcull + 2);
+    struct philox_state split_state = state;
+
+    philox_fill_u32(&state, whole, N);
+
+    // Sizes not aligned to blocks nor to the vector width
+    const size_t sizes[] = {1, 3, 7, 2, 45, 129, 64, 5, 250};
+    size_t filled = 0;
+    for (size_t i = 0; filled < N; i = (i + 1) % (sizeof(sizes) / sizeof(sizes[0])))
+    {
+        const size_t size = sizes[i] < N - filled ? sizes[i] : N - filled;
+        philox_fill_u32(&split_state, split + filled, size);
+        filled += size;
+    }
+
+    ASSERT_TRUE(memcmp(whole, split, sizeof(whole)) == 0, "Split fills should produce the same sequence.");
+    ASSERT_TRUE(state.offset == split_state.offset, "Split fills should advance the generator equally.");
+
+    // Floats are a function of the words only
+    philox_init(&state, 99);
+    split_state = state;
+    float values_whole[300];
+    float values_split[300];
+    philox_uniform_f32(&state, values_whole, 300, -1.0f, 1.0f);
+    philox_uniform_f32(&split_state, values_split, 123, -1.0f, 1.0f);
+    philox_uniform_f32(&split_state, values_split + 123, 177, -1.0f, 1.0f);
+    ASSERT_TRUE(memcmp(values_whole, values_split, sizeof(values_whole)) == 0, "Split uniform fills should produce the same values.");
+
+test_cleanup:
+}
+
+void philox_test_streams(struct test_result *result)
+{
+    struct philox_state state;
+    philox_init(&state, 42);
+
+    struct philox_state stream0 = philox_stream(&state, 0);
+    struct philox_state stream1 = philox_stream(&state, 1);
+    philox_skip(&state, 1000);
+    struct philox_state stream1_again = philox_stream(&state, 1);
+
+    uint32_t words0[64], words1[64], words1_again[64];
+    philox_fill_u32(&stream0, words0, 64);
+    philox_fill_u32(&stream1, words1, 64);
+    philox_fill_u32(&stream1_again, words1_again, 64);
+
+    ASSERT_TRUE(memcmp(words0, words1, sizeof(words0)) != 0, "Different streams should produce different sequences.");
+    ASSERT_TRUE(memcmp(words1, words1_again, sizeof(words1)) == 0, "A stream should only depend on the key and the stream index.");
+
+test_cleanup:
+}
+
+void philox_test_distributions(struct test_result *result)
+{
+    const size_t N = 100000;
+    static float uniform[100000];
+    static double normal[100000];
+
+    struct philox_state state;
+    philox_init(&state, 7);
+
+    philox_uniform_f32(&state, uniform, N, -2.0f, 3.0f);
+    double sum = 0.0;
+    for (size_t i = 0; i < N; i++)
+    {
+        ASSERT_TRUE(uniform[i] >= -2.0f && uniform[i] <= 3.0f, "Uniform value out of range.");
+        sum += uniform[i];
+    }
+    ASSERT_TRUE(fabs(sum / N - 0.5) < 0.02, "Wrong mean of uniform values.");
+
+    philox_normal_f64(&state, normal, N, 1.0, 2.0);
+    double mean = 0.0;
+    for (size_t i = 0; i < N; i++)
+    {
+        ASSERT_TRUE(isfinite(normal[i]), "Normal value should be finite.");
+        mean += normal[i];
+    }
+    mean /= N;
+    double variance = 0.0;
+    for (size_t i = 0; i < N; i++)
+    {
+        variance += (normal[i] - mean) * (normal[i] - mean);
+    }
+    variance /= N;
+    ASSERT_TRUE(fabs(mean - 1.0) < 0.03 && fabs(sqrt(variance) - 2.0) < 0.03, "Wrong moments of normal values.");
+
+    for (size_t i = 0; i < 1000; i++)
+    {
+        const int64_t value = philox_uniform_int(&state, -3, 4);
+        ASSERT_TRUE(value >= -3 && value <= 4, "Integer out of range.");
+    }
+
+test_cleanup:
+}
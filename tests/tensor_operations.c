@@ -9,15 +9,42 @@
 #include "cgrad/memory/computational_graph/computational_graph_cpu_allocator.h"
 #include "cgrad/tensor/tensor_set.h"
 #include "cgrad/tensor/tensor2d_mult.h"
+#include "cgrad/tensor/tensor2d_sparse_mult.h"
+#include "cgrad/dataset/csv_dataset.h"
+#include "cgrad/dataset/indexes_batch.h"
 #include "cgrad/tensor/tensor_add.h"
+#include "cgrad/tensor/tensor_cast.h"
 #include "cgrad/tensor/tensor_equality.h"
+#include "cgrad/tensor/tensor_foreach.h"
 #include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_helpers.h"
+#include "cgrad/tensor/tensor_permute.h"
+#include "cgrad/tensor/tensor_reduce.h"
+#include "cgrad/tensor/tensor_reshape.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/losses/mse.h"
+#include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 void tensor2d_mult_test_cpu_instance_1(struct test_result *);
 void tensor_add_test_cpu_instance_1(struct test_result *);
 void tensor_add_test_cpu_instance_2(struct test_result *);
 void tensor_add_test_cpu_instance_3(struct test_result *);
+void tensor_cast_test_cpu_instance_1(struct test_result *);
+void tensor2d_mult_test_cpu_instance_2(struct test_result *);
+void tensor_permute_test_cpu_instance_1(struct test_result *);
+void tensor_permute_test_cpu_instance_2(struct test_result *);
+void tensor_reduce_test_cpu_instance_1(struct test_result *);
+void tensor_reduce_test_cpu_instance_2(struct test_result *);
+void tensor_foreach_test_cpu_instance_1(struct test_result *);
+void tensor_foreach_test_cpu_instance_2(struct test_result *);
+void tensor2d_sparse_mult_test_cpu_instance_1(struct test_result *);
+void tensor2d_sparse_mult_test_cpu_instance_2(struct test_result *);
+
+static bool tensor_permute_matches_reference(const struct tensor *const t, const size_t *const perm, const struct tensor *const out);
+static void tensor_reduce_reference(const struct tensor *const t, const size_t *const axes, const size_t n_axes, double *const sum, double *const max, size_t *const argmax);
+static double tensor_value(const struct tensor *const t, const size_t i);
 
 int main(int argc, char **argv)
 {
@@ -26,6 +53,16 @@ int main(int argc, char **argv)
     test_list_append(tests, &tensor_add_test_cpu_instance_1, "tensor_add_test_cpu_instance_1");
     test_list_append(tests, &tensor_add_test_cpu_instance_2, "tensor_add_test_cpu_instance_2");
     test_list_append(tests, &tensor_add_test_cpu_instance_3, "tensor_add_test_cpu_instance_3");
+    test_list_append(tests, &tensor_cast_test_cpu_instance_1, "tensor_cast_test_cpu_instance_1");
+    test_list_append(tests, &tensor2d_mult_test_cpu_instance_2, "tensor2d_mult_test_cpu_instance_2");
+    test_list_append(tests, &tensor_permute_test_cpu_instance_1, "tensor_permute_test_cpu_instance_1");
+    test_list_append(tests, &tensor_permute_test_cpu_instance_2, "tensor_permute_test_cpu_instance_2");
+    test_list_append(tests, &tensor_reduce_test_cpu_instance_1, "tensor_reduce_test_cpu_instance_1");
+    test_list_append(tests, &tensor_reduce_test_cpu_instance_2, "tensor_reduce_test_cpu_instance_2");
+    test_list_append(tests, &tensor_foreach_test_cpu_instance_1, "tensor_foreach_test_cpu_instance_1");
+    test_list_append(tests, &tensor_foreach_test_cpu_instance_2, "tensor_foreach_test_cpu_instance_2");
+    test_list_append(tests, &tensor2d_sparse_mult_test_cpu_instance_1, "tensor2d_sparse_mult_test_cpu_instance_1");
+    test_list_append(tests, &tensor2d_sparse_mult_test_cpu_instance_2, "tensor2d_sparse_mult_test_cpu_instance_2");
 
     run_tests(tests);
 
@@ -153,4 +190,663 @@ void tensor_add_test_cpu_instance_3(struct test_result *result)
 
 test_cleanup:
     cgrad_env_cleanup(&env);
-}
\ No newline at end of file
+}
+
+void tensor_cast_test_cpu_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    // 9 elements, to cover both the vectorized and the scalar conversions
+    const size_t shape[] = {1, 9};
+    const float t_data[] = {1.0, -2.5, 0.0, 1.00390625, 1.01171875, 65504.0, 1e-8, 3.0, 1.01171875};
+    struct tensor *t = tensor_from_array_alloc(&env, t_data, shape, 2, DTYPE_FLOAT32);
+
+    // bfloat16 keeps 8 significant bits, ties round to even
+    const float expected_bf16_data[] = {1.0, -2.5, 0.0, 1.0, 1.015625, 65536.0, 1.0012e-8, 3.0, 1.015625};
+    struct tensor *expected_bf16 = tensor_from_array_alloc(&env, expected_bf16_data, shape, 2, DTYPE_FLOAT32);
+
+    // float16 keeps 11 significant bits, 1e-8 underflows
+    const float expected_f16_data[] = {1.0, -2.5, 0.0, 1.00390625, 1.01171875, 65504.0, 0.0, 3.0, 1.01171875};
+    struct tensor *expected_f16 = tensor_from_array_alloc(&env, expected_f16_data, shape, 2, DTYPE_FLOAT32);
+
+    struct tensor *t_bf16 = NULL;
+    struct tensor *t_f16 = NULL;
+    struct tensor *back_bf16 = NULL;
+    struct tensor *back_f16 = NULL;
+    ASSERT_TRUE(tensor_cast(t, DTYPE_BFLOAT16, &t_bf16, false, &env) == NO_ERROR, "Cast to bfloat16 failed.");
+    ASSERT_TRUE(tensor_cast(t, DTYPE_FLOAT16, &t_f16, false, &env) == NO_ERROR, "Cast to float16 failed.");
+    ASSERT_TRUE(tensor_cast(t_bf16, DTYPE_FLOAT32, &back_bf16, false, &env) == NO_ERROR, "Cast from bfloat16 failed.");
+    ASSERT_TRUE(tensor_cast(t_f16, DTYPE_FLOAT32, &back_f16, false, &env) == NO_ERROR, "Cast from float16 failed.");
+
+    ASSERT_TRUE(tensor_no_grad_equal(back_bf16, expected_bf16), "One or more bfloat16 values incorrect.");
+    ASSERT_TRUE(tensor_no_grad_equal(back_f16, expected_f16), "One or more float16 values incorrect.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void tensor2d_mult_test_cpu_instance_2(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT16;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t shape[] = {2, 2};
+    const float t1_data[] = {1.0, 2.0, 3.0, 4.0};
+    struct tensor *t1_f32 = tensor_from_array_alloc(&env, t1_data, shape, 2, DTYPE_FLOAT32);
+
+    const float t2_data[] = {1.0, 2.0, 3.0, 512.0};
+    struct tensor *t2_f32 = tensor_from_array_alloc(&env, t2_data, shape, 2, DTYPE_FLOAT32);
+
+    const float expected_out_data[] = {7.0, 1026.0, 15.0, 2054.0};
+    struct tensor *expected_out = tensor_from_array_alloc(&env, expected_out_data, shape, 2, DTYPE_FLOAT32);
+
+    struct tensor *t1 = NULL;
+    struct tensor *t2 = NULL;
+    struct tensor *out = NULL;
+    struct tensor *out_f32 = NULL;
+    ASSERT_TRUE(tensor_cast(t1_f32, DTYPE, &t1, false, &env) == NO_ERROR, "Cast failed.");
+    ASSERT_TRUE(tensor_cast(t2_f32, DTYPE, &t2, false, &env) == NO_ERROR, "Cast failed.");
+    ASSERT_TRUE(tensor2d_mult(t1, t2, &out, false, &env) == NO_ERROR, "Mult failed.");
+    ASSERT_TRUE(out->dtype == DTYPE, "Wrong output dtype.");
+    ASSERT_TRUE(tensor_cast(out, DTYPE_FLOAT32, &out_f32, false, &env) == NO_ERROR, "Cast failed.");
+
+    ASSERT_TRUE(tensor_no_grad_equal(out_f32, expected_out), "One or more output values incorrect.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void tensor_permute_test_cpu_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPES[] = {DTYPE_FLOAT64, DTYPE_FLOAT32, DTYPE_FLOAT16};
+
+    // Edge tiles, merged axes, unmoved innermost axes, the identity and axes of size one
+    const size_t shape_sizes[] = {2, 3, 4, 4, 3, 3, 2};
+    const size_t shapes[][4] = {{37, 70}, {3, 64, 65}, {2, 3, 4, 5}, {4, 1, 9, 16}, {5, 6, 7}, {130, 8, 9}, {1, 1}};
+    const size_t perms[][4] = {{1, 0}, {0, 2, 1}, {3, 1, 0, 2}, {2, 1, 0, 3}, {0, 1, 2}, {2, 0, 1}, {1, 0}};
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+    ASSERT_TRUE(cgrad_env_set_num_threads(&env, 4) == NO_ERROR, "Thread pool initialization should not fail.");
+
+    for (size_t d = 0; d < sizeof(DTYPES) / sizeof(DTYPES[0]); d++)
+    {
+        for (size_t c = 0; c < sizeof(shape_sizes) / sizeof(shape_sizes[0]); c++)
+        {
+            struct tensor *t = tensor_alloc(&env, shapes[c], shape_sizes[c], DTYPES[d]);
+            ASSERT_TRUE(t, "Tensor allocation failed.");
+            for (size_t i = 0; i < t->data_size; i++)
+            {
+                switch (DTYPES[d])
+                {
+                case DTYPE_FLOAT64:
+                    ((double *)t->data)[i] = (double)i;
+                    break;
+                case DTYPE_FLOAT32:
+                    ((float *)t->data)[i] = (float)i;
+                    break;
+                default:
+                    ((uint16_t *)t->data)[i] = (uint16_t)(i & 0x3fff);
+                    break;
+                }
+            }
+
+            struct tensor *out = NULL;
+            ASSERT_TRUE(tensor_permute(t, perms[c], &out, false, &env) == NO_ERROR, "Permute failed.");
+            ASSERT_TRUE(tensor_permute_matches_reference(t, perms[c], out), "One or more output values incorrect.");
+
+            tensor_free(&env, out);
+            tensor_free(&env, t);
+        }
+    }
+
+    const size_t invalid_perm[] = {0, 0};
+    struct tensor *t = tensor_alloc(&env, shapes[0], shape_sizes[0], DTYPE_FLOAT32);
+    struct tensor *out = NULL;
+    ASSERT_TRUE(tensor_permute(t, invalid_perm, &out, false, &env) == TENSOR_PERMUTE_INVALID_AXES, "Repeated axes should be rejected.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void tensor_permute_test_cpu_instance_2(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t shape[] = {2, 3, 4};
+    const size_t perm[] = {2, 0, 1};
+    struct tensor *t = tensor_alloc(&env, shape, 3, DTYPE);
+    ASSERT_TRUE(t, "Tensor allocation failed.");
+    for (size_t i = 0; i < t->data_size; i++)
+    {
+        ((double *)t->data)[i] = 0.5 * (double)i - 3.0;
+    }
+
+    const size_t column_shape[] = {24, 1};
+    struct tensor *target = tensor_alloc(&env, column_shape, 2, DTYPE);
+    ASSERT_TRUE(target, "Tensor allocation failed.");
+    memset(target->data, 0, target->data_size * sizeof(double));
+
+    struct tensor *out = NULL;
+    struct tensor *column = NULL;
+    struct tensor *z = NULL;
+    ASSERT_TRUE(tensor_permute(t, perm, &out, true, &env) == NO_ERROR, "Permute failed.");
+    ASSERT_TRUE(tensor_reshape(out, column_shape, 2, &column, true, &env) == NO_ERROR, "Reshape failed.");
+    ASSERT_TRUE(mse_loss(column, target, &z, true, &env) == NO_ERROR, "MSE failed.");
+    ASSERT_TRUE(backward(z, &env) == NO_ERROR, "Backward failed.");
+
+    // The loss is the mean of half the squares, so each value is its own gradient once moved back to its place
+    for (size_t i = 0; i < t->data_size; i++)
+    {
+        const double expected = ((double *)t->data)[i] / 24.0;
+        ASSERT_TRUE(fabs(((double *)t->grad->data)[i] - expected) < 1e-12, "Wrong gradient.");
+    }
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void tensor_reduce_test_cpu_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPES[] = {DTYPE_FLOAT64, DTYPE_FLOAT32};
+
+    // Rows and runs, merged axes, every axis, axes of size one, and outputs too few not to split the reduced axes
+    const size_t shape_sizes[] = {2, 2, 4, 3, 3, 2, 2};
+    const size_t shapes[][4] = {{37, 300}, {37, 300}, {2, 3, 4, 5}, {6, 1, 7}, {5, 6, 7}, {300000, 3}, {2, 200000}};
+    const size_t n_axes[] = {1, 1, 2, 2, 3, 1, 1};
+    const size_t axes[][3] = {{0}, {1}, {1, 3}, {0, 1}, {2, 0, 1}, {0}, {1}};
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+    ASSERT_TRUE(cgrad_env_set_num_threads(&env, 4) == NO_ERROR, "Thread pool initialization should not fail.");
+
+    for (size_t d = 0; d < sizeof(DTYPES) / sizeof(DTYPES[0]); d++)
+    {
+        for (size_t c = 0; c < sizeof(shape_sizes) / sizeof(shape_sizes[0]); c++)
+        {
+            struct tensor *t = tensor_alloc(&env, shapes[c], shape_sizes[c], DTYPES[d]);
+            ASSERT_TRUE(t, "Tensor allocation failed.");
+            for (size_t i = 0; i < t->data_size; i++)
+            {
+                // Repeated values, so that the first maximum is not the only one
+                const double value = (double)((i * 7919) % 1000) / 8.0 - 50.0;
+                if (DTYPES[d] == DTYPE_FLOAT64)
+                {
+                    ((double *)t->data)[i] = value;
+                }
+                else
+                {
+                    ((float *)t->data)[i] = (float)value;
+                }
+            }
+
+            const bool keepdim = c % 2 == 0;
+            struct tensor *sum = NULL;
+            struct tensor *mean = NULL;
+            struct tensor *max = NULL;
+            struct tensor *argmax = NULL;
+            ASSERT_TRUE(tensor_reduce_sum(t, axes[c], n_axes[c], keepdim, &sum, false, &env) == NO_ERROR, "Sum failed.");
+            ASSERT_TRUE(tensor_reduce_mean(t, axes[c], n_axes[c], keepdim, &mean, false, &env) == NO_ERROR, "Mean failed.");
+            ASSERT_TRUE(tensor_reduce_max(t, axes[c], n_axes[c], keepdim, &max, false, &env) == NO_ERROR, "Max failed.");
+            ASSERT_TRUE(tensor_reduce_argmax(t, axes[c], n_axes[c], keepdim, &argmax, &env) == NO_ERROR, "Argmax failed.");
+            ASSERT_TRUE(argmax->dtype == DTYPE_INT32, "Argmax should return int32 positions.");
+            ASSERT_TRUE(sum->shape_size == (keepdim ? t->shape_size : (n_axes[c] == t->shape_size ? 1 : t->shape_size - n_axes[c])), "Wrong output shape.");
+
+            double *expected_sum = malloc(sum->data_size * sizeof(double));
+            double *expected_max = malloc(sum->data_size * sizeof(double));
+            size_t *expected_argmax = malloc(sum->data_size * sizeof(size_t));
+            ASSERT_TRUE(expected_sum && expected_max && expected_argmax, "Allocation failed.");
+            tensor_reduce_reference(t, axes[c], n_axes[c], expected_sum, expected_max, expected_argmax);
+
+            const double n_reduced = (double)(t->data_size / sum->data_size);
+            bool correct = true;
+            for (size_t i = 0; i < sum->data_size; i++)
+            {
+                const double tolerance = 1e-6 * (fabs(expected_sum[i]) + n_reduced);
+                correct = correct && fabs(tensor_value(sum, i) - expected_sum[i]) <= tolerance;
+                correct = correct && fabs(tensor_value(mean, i) - expected_sum[i] / n_reduced) <= tolerance / n_reduced;
+                correct = correct && tensor_value(max, i) == expected_max[i];
+                correct = correct && tensor_value(argmax, i) == (double)expected_argmax[i];
+            }
+            free(expected_sum);
+            free(expected_max);
+            free(expected_argmax);
+            ASSERT_TRUE(correct, "One or more output values incorrect.");
+
+            // The parts of the reduced axes are combined in a fixed order, whatever the number of threads
+            struct tensor *serial_sum = tensor_alloc(&env, sum->shape, sum->shape_size, sum->dtype);
+            ASSERT_TRUE(serial_sum, "Tensor allocation failed.");
+            ASSERT_TRUE(tensor_reduce_sum_into(t, axes[c], n_axes[c], serial_sum, NULL) == NO_ERROR, "Sum failed.");
+            ASSERT_TRUE(memcmp(serial_sum->data, sum->data, sum->data_size * dtype_sizeof(sum->dtype)) == 0, "Sum depends on the number of threads.");
+            ASSERT_TRUE(tensor_reduce_argmax_into(t, axes[c], n_axes[c], serial_sum, NULL) == TENSOR_DTYPE_MISMATCH, "Argmax into a floating point tensor should fail.");
+
+            tensor_free(&env, serial_sum);
+            tensor_free(&env, sum);
+            tensor_free(&env, mean);
+            tensor_free(&env, max);
+            tensor_free(&env, argmax);
+            tensor_free(&env, t);
+        }
+    }
+
+    const size_t repeated_axes[] = {1, 1};
+    struct tensor *t = tensor_alloc(&env, shapes[0], shape_sizes[0], DTYPE_FLOAT32);
+    struct tensor *out = NULL;
+    ASSERT_TRUE(tensor_reduce_sum(t, repeated_axes, 2, false, &out, false, &env) == TENSOR_REDUCE_INVALID_AXES, "Repeated axes should be rejected.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void tensor_reduce_test_cpu_instance_2(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    const size_t shape[] = {3, 4, 5};
+    struct tensor *t_max = tensor_alloc(&env, shape, 3, DTYPE);
+    struct tensor *t_mean = tensor_alloc(&env, shape, 3, DTYPE);
+    ASSERT_TRUE(t_max && t_mean, "Tensor allocation failed.");
+    for (size_t i = 0; i < t_max->data_size; i++)
+    {
+        ((double *)t_max->data)[i] = (double)((i * 37) % 11);
+        ((double *)t_mean->data)[i] = 0.5 * (double)i - 3.0;
+    }
+
+    // max over {0, 2} gives 4 values, mean over {1} gives 15
+    const size_t max_axes[] = {0, 2};
+    const size_t mean_axes[] = {1};
+    const size_t max_column_shape[] = {4, 1};
+    const size_t mean_column_shape[] = {15, 1};
+    struct tensor *max_target = tensor_alloc(&env, max_column_shape, 2, DTYPE);
+    struct tensor *mean_target = tensor_alloc(&env, mean_column_shape, 2, DTYPE);
+    ASSERT_TRUE(max_target && mean_target, "Tensor allocation failed.");
+    memset(max_target->data, 0, max_target->data_size * sizeof(double));
+    memset(mean_target->data, 0, mean_target->data_size * sizeof(double));
+
+    struct tensor *max = NULL;
+    struct tensor *max_column = NULL;
+    struct tensor *z_max = NULL;
+    ASSERT_TRUE(tensor_reduce_max(t_max, max_axes, 2, false, &max, true, &env) == NO_ERROR, "Max failed.");
+    ASSERT_TRUE(tensor_reshape(max, max_column_shape, 2, &max_column, true, &env) == NO_ERROR, "Reshape failed.");
+    ASSERT_TRUE(mse_loss(max_column, max_target, &z_max, true, &env) == NO_ERROR, "MSE failed.");
+    ASSERT_TRUE(backward(z_max, &env) == NO_ERROR, "Backward failed.");
+
+    struct tensor *mean = NULL;
+    struct tensor *mean_column = NULL;
+    struct tensor *z_mean = NULL;
+    ASSERT_TRUE(tensor_reduce_mean(t_mean, mean_axes, 1, true, &mean, true, &env) == NO_ERROR, "Mean failed.");
+    ASSERT_TRUE(tensor_reshape(mean, mean_column_shape, 2, &mean_column, true, &env) == NO_ERROR, "Reshape failed.");
+    ASSERT_TRUE(mse_loss(mean_column, mean_target, &z_mean, true, &env) == NO_ERROR, "MSE failed.");
+    ASSERT_TRUE(backward(z_mean, &env) == NO_ERROR, "Backward failed.");
+
+    // The loss is the mean of half the squares, so each output is its own gradient once divided by their number
+    double expected_sum[15];
+    double expected_max[15];
+    size_t expected_argmax[15];
+    tensor_reduce_reference(t_max, max_axes, 2, expected_sum, expected_max, expected_argmax);
+    for (size_t i = 0; i < t_max->data_size; i++)
+    {
+        const size_t j = i / 5 % 4;
+        const size_t reduced = i / 20 * 5 + i % 5;
+        const double expected = reduced == expected_argmax[j] ? expected_max[j] / 4.0 : 0.0;
+        ASSERT_TRUE(fabs(((double *)t_max->grad->data)[i] - expected) < 1e-12, "Wrong gradient of the maximum.");
+    }
+
+    tensor_reduce_reference(t_mean, mean_axes, 1, expected_sum, expected_max, expected_argmax);
+    for (size_t i = 0; i < t_mean->data_size; i++)
+    {
+        const size_t j = i / 20 * 5 + i % 5;
+        const double expected = expected_sum[j] / 4.0 / 15.0 / 4.0;
+        ASSERT_TRUE(fabs(((double *)t_mean->grad->data)[i] - expected) < 1e-12, "Wrong gradient of the mean.");
+    }
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void tensor_foreach_test_cpu_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const size_t N_TENSORS = 100;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+    ASSERT_TRUE(cgrad_env_set_num_threads(&env, 3) == NO_ERROR, "Setting the number of threads failed.");
+
+    // Many biases sharing work items, and a few tensors spanning several of them, every fifth entry left out
+    struct tensor *xs[100];
+    struct tensor *ys[100];
+    double expected_sum = 0.0;
+    for (size_t i = 0; i < N_TENSORS; i++)
+    {
+        xs[i] = NULL;
+        ys[i] = NULL;
+        if (i % 5 == 4)
+        {
+            continue;
+        }
+
+        const size_t shape[] = {i % 10 == 0 ? 3 * TENSOR_FOREACH_CHUNK / 2 + i : 1 + i % 7};
+        xs[i] = tensor_alloc(&env, shape, 1, DTYPE_FLOAT32);
+        ys[i] = tensor_alloc(&env, shape, 1, DTYPE_FLOAT32);
+        ASSERT_TRUE(xs[i] && ys[i], "Tensor allocation failed.");
+        for (size_t j = 0; j < xs[i]->data_size; j++)
+        {
+            ((float *)xs[i]->data)[j] = (float)((i * 31 + j * 7) % 13) - 6.0f;
+            ((float *)ys[i]->data)[j] = 1.0f;
+        }
+    }
+
+    // ys <- 0.5 * (2 * xs + ys) - 0.5
+    ASSERT_TRUE(tensor_foreach_axpy(xs, ys, N_TENSORS, 2.0, env.pool) == NO_ERROR, "Axpy failed.");
+    ASSERT_TRUE(tensor_foreach_scale(ys, N_TENSORS, 0.5, env.pool) == NO_ERROR, "Scale failed.");
+    for (size_t i = 0; i < N_TENSORS; i++)
+    {
+        for (size_t j = 0; ys[i] && j < ys[i]->data_size; j++)
+        {
+            const float y = ((float *)ys[i]->data)[j] - 0.5f;
+            ASSERT_TRUE(y == ((float *)xs[i]->data)[j], "Wrong axpy or scale.");
+            expected_sum += (double)y * y;
+        }
+    }
+
+    // The norm does not depend on the number of threads
+    double norm = 0.0;
+    double serial_norm = 0.0;
+    ASSERT_TRUE(tensor_foreach_norm(xs, N_TENSORS, &norm, env.pool) == NO_ERROR, "Norm failed.");
+    ASSERT_TRUE(tensor_foreach_norm(xs, N_TENSORS, &serial_norm, NULL) == NO_ERROR, "Norm failed.");
+    ASSERT_TRUE(norm == serial_norm, "The norm depends on the number of threads.");
+    ASSERT_TRUE(fabs(norm - sqrt(expected_sum)) < 1e-9 * norm, "Wrong norm.");
+
+    double total_norm = 0.0;
+    ASSERT_TRUE(tensor_foreach_clip_norm(xs, N_TENSORS, 10.0, &total_norm, env.pool) == NO_ERROR, "Clipping failed.");
+    ASSERT_TRUE(total_norm == norm, "Wrong norm before clipping.");
+    ASSERT_TRUE(tensor_foreach_norm(xs, N_TENSORS, &norm, env.pool) == NO_ERROR, "Norm failed.");
+    ASSERT_TRUE(fabs(norm - 10.0) < 1e-4, "Wrong norm after clipping.");
+
+    ASSERT_TRUE(tensor_foreach_zero(xs, N_TENSORS, env.pool) == NO_ERROR, "Zero failed.");
+    ASSERT_TRUE(tensor_foreach_norm(xs, N_TENSORS, &norm, env.pool) == NO_ERROR, "Norm failed.");
+    ASSERT_TRUE(norm == 0.0, "Tensors were not zeroed.");
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void tensor_foreach_test_cpu_instance_2(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const double LR = 0.1;
+    const double MOMENTUM = 0.5;
+
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    // One parameter per update rule: plain, with momentum and Nesterov momentum
+    const size_t shape[] = {5};
+    struct tensor *weights[3];
+    struct tensor *grads[3];
+    struct tensor *momentums[3];
+    for (size_t i = 0; i < 3; i++)
+    {
+        weights[i] = tensor_alloc(&env, shape, 1, DTYPE_FLOAT64);
+        grads[i] = tensor_alloc(&env, shape, 1, DTYPE_FLOAT64);
+        momentums[i] = tensor_alloc(&env, shape, 1, DTYPE_FLOAT64);
+        ASSERT_TRUE(weights[i] && grads[i] && momentums[i], "Tensor allocation failed.");
+        for (size_t j = 0; j < 5; j++)
+        {
+            ((double *)weights[i]->data)[j] = (double)j;
+            ((double *)grads[i]->data)[j] = 1.0 - (double)j;
+            ((double *)momentums[i]->data)[j] = 0.0;
+        }
+    }
+
+    const struct tensor_foreach_sgd_args plain = {.lr = LR, .momentum = 0.0, .nesterov = false, .grad_scale = 2.0};
+    const struct tensor_foreach_sgd_args momentum = {.lr = LR, .momentum = MOMENTUM, .nesterov = false, .grad_scale = 1.0};
+    const struct tensor_foreach_sgd_args nesterov = {.lr = LR, .momentum = MOMENTUM, .nesterov = true, .grad_scale = 1.0};
+    for (size_t step = 0; step < 2; step++)
+    {
+        ASSERT_TRUE(tensor_foreach_sgd(&weights[0], &grads[0], &momentums[0], NULL, 1, &plain, env.pool) == NO_ERROR, "SGD failed.");
+        ASSERT_TRUE(tensor_foreach_sgd(&weights[1], &grads[1], &momentums[1], NULL, 1, &momentum, env.pool) == NO_ERROR, "SGD failed.");
+        ASSERT_TRUE(tensor_foreach_sgd(&weights[2], &grads[2], &momentums[2], NULL, 1, &nesterov, env.pool) == NO_ERROR, "SGD failed.");
+    }
+
+    // With a constant gradient g, the momentum is g then 1.5 g, so that the updates sum to 2.5 g, or to 1.5 g + 1.75 g with Nesterov
+    for (size_t j = 0; j < 5; j++)
+    {
+        const double g = 1.0 - (double)j;
+        ASSERT_TRUE(fabs(((double *)weights[0]->data)[j] - ((double)j - LR * 4.0 * g)) < 1e-12, "Wrong plain SGD update.");
+        ASSERT_TRUE(fabs(((double *)weights[1]->data)[j] - ((double)j - LR * 2.5 * g)) < 1e-12, "Wrong momentum update.");
+        ASSERT_TRUE(fabs(((double *)weights[2]->data)[j] - ((double)j - LR * 3.25 * g)) < 1e-12, "Wrong Nesterov update.");
+        ASSERT_TRUE(fabs(((double *)momentums[1]->data)[j] - 1.5 * g) < 1e-12, "Wrong momentum.");
+        ASSERT_TRUE(((double *)momentums[0]->data)[j] == 0.0, "Plain SGD should not update the momentum.");
+    }
+
+test_cleanup:
+    cgrad_env_cleanup(&env);
+}
+
+void tensor2d_sparse_mult_test_cpu_instance_1(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT64;
+
+    struct sparse_tensor sparse_x = {0};
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    // x has an empty row, and its third column no value, so that the third row of the gradient of y is zero
+    const size_t x_shape[] = {4, 6};
+    const double x_data[] = {
+        1.0, 0.0, 0.0, 0.0, 2.0, 0.0,
+        0.0, 0.0, 0.0, 0.0, 0.0, 0.0,
+        0.0, -3.0, 0.0, 0.5, 0.0, 4.0,
+        5.0, 0.0, 0.0, 0.0, 0.0, -1.0};
+    struct tensor *x = tensor_from_array_alloc(&env, x_data, x_shape, 2, DTYPE);
+    ASSERT_TRUE(x, "Tensor allocation failed.");
+    tensor_set_requires_grad(x, false);
+
+    ASSERT_TRUE(sparse_tensor_from_dense(x, &sparse_x, &env) == NO_ERROR, "Sparse conversion failed.");
+    ASSERT_TRUE(sparse_x.nnz == 7 && sparse_x.shape[0] == 4 && sparse_x.shape[1] == 6, "Wrong sparse tensor.");
+    ASSERT_TRUE(((int32_t *)sparse_x.row_ptrs->data)[1] == 2 && ((int32_t *)sparse_x.row_ptrs->data)[2] == 2, "Wrong row offsets.");
+
+    // The same weight multiplied by the sparse and the dense x
+    const size_t y_shape[] = {6, 3};
+    struct tensor *y_sparse = tensor_alloc(&env, y_shape, 2, DTYPE);
+    struct tensor *y_dense = tensor_alloc(&env, y_shape, 2, DTYPE);
+    ASSERT_TRUE(y_sparse && y_dense, "Tensor allocation failed.");
+    for (size_t i = 0; i < y_sparse->data_size; i++)
+    {
+        ((double *)y_sparse->data)[i] = ((double *)y_dense->data)[i] = 0.25 * (double)i - 1.0;
+    }
+
+    const size_t column_shape[] = {12, 1};
+    struct tensor *target = tensor_no_grad_zero_alloc(&env, column_shape, 2, DTYPE);
+    ASSERT_TRUE(target, "Tensor allocation failed.");
+    tensor_set_requires_grad(target, false);
+
+    struct tensor *outs[2] = {NULL};
+    struct tensor *columns[2] = {NULL};
+    struct tensor *z[2] = {NULL};
+    ASSERT_TRUE(tensor2d_sparse_mult(&sparse_x, y_sparse, &outs[0], true, &env) == NO_ERROR, "Sparse mult failed.");
+    ASSERT_TRUE(tensor2d_mult(x, y_dense, &outs[1], true, &env) == NO_ERROR, "Mult failed.");
+    for (size_t p = 0; p < 2; p++)
+    {
+        ASSERT_TRUE(tensor_reshape(outs[p], column_shape, 2, &columns[p], true, &env) == NO_ERROR, "Reshape failed.");
+        ASSERT_TRUE(mse_loss(columns[p], target, &z[p], true, &env) == NO_ERROR, "MSE failed.");
+        ASSERT_TRUE(backward(z[p], &env) == NO_ERROR, "Backward failed.");
+    }
+
+    for (size_t i = 0; i < outs[0]->data_size; i++)
+    {
+        ASSERT_TRUE(fabs(((double *)outs[0]->data)[i] - ((double *)outs[1]->data)[i]) < 1e-12, "Wrong product.");
+    }
+    for (size_t i = 0; i < y_sparse->data_size; i++)
+    {
+        ASSERT_TRUE(fabs(((double *)y_sparse->grad->data)[i] - ((double *)y_dense->grad->data)[i]) < 1e-12, "Wrong gradient.");
+    }
+    ASSERT_TRUE(((double *)y_sparse->grad->data)[2 * 3] == 0.0, "Rows of columns without values should have no gradient.");
+
+test_cleanup:
+    sparse_tensor_free(&sparse_x, &env);
+    cgrad_env_cleanup(&env);
+}
+
+void tensor2d_sparse_mult_test_cpu_instance_2(struct test_result *result)
+{
+    const int SEED = 42;
+    const size_t INTERMEDIATES_CAPACITY = 20;
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct sparse_tensor inputs = {0};
+    struct indexes_batch *ixs_batch = NULL;
+    struct cgrad_env env;
+    ASSERT_TRUE(cgrad_env_init(&env, SEED, INTERMEDIATES_CAPACITY) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+
+    // Label first, then four features
+    double data[] = {
+        1.0, 0.0, 2.0, 0.0, 0.0,
+        0.0, 0.0, 0.0, 0.0, 0.0,
+        3.0, 1.5, 0.0, 0.0, -2.0};
+    struct csv_dataset dataset = {.rows = 3, .cols = 5, .data = data};
+
+    ixs_batch = indexes_batch_alloc(3);
+    ASSERT_TRUE(ixs_batch, "Indexes batch allocation failed.");
+    const size_t indexes[] = {2, 1, 0};
+    memcpy(ixs_batch->indexes, indexes, sizeof(indexes));
+    ixs_batch->size = 3;
+
+    struct tensor *targets = NULL;
+    ASSERT_TRUE(csv_dataset_sample_batch_sparse(&dataset, &inputs, &targets, ixs_batch, DTYPE, &env) == NO_ERROR, "Sparse sampling failed.");
+    ASSERT_TRUE(sparse_tensor_check(&inputs) == NO_ERROR, "Sampled sparse tensor is invalid.");
+
+    const int32_t expected_row_ptrs[] = {0, 2, 2, 3};
+    const int32_t expected_col_indexes[] = {0, 3, 1};
+    const float expected_values[] = {1.5f, -2.0f, 2.0f};
+    const float expected_targets[] = {3.0f, 0.0f, 1.0f};
+    ASSERT_TRUE(inputs.nnz == 3 && inputs.shape[0] == 3 && inputs.shape[1] == 4, "Wrong sparse shape.");
+    ASSERT_TRUE(memcmp(inputs.row_ptrs->data, expected_row_ptrs, sizeof(expected_row_ptrs)) == 0, "Wrong row offsets.");
+    ASSERT_TRUE(memcmp(inputs.col_indexes->data, expected_col_indexes, sizeof(expected_col_indexes)) == 0, "Wrong column indexes.");
+    ASSERT_TRUE(memcmp(inputs.values->data, expected_values, sizeof(expected_values)) == 0, "Wrong values.");
+    ASSERT_TRUE(memcmp(targets->data, expected_targets, sizeof(expected_targets)) == 0, "Wrong targets.");
+
+    // Column indexes out of bounds are rejected before multiplying
+    const size_t y_shape[] = {4, 2};
+    struct tensor *y = tensor_alloc(&env, y_shape, 2, DTYPE);
+    struct tensor *out = NULL;
+    ASSERT_TRUE(y, "Tensor allocation failed.");
+    ((int32_t *)inputs.col_indexes->data)[1] = 4;
+    ASSERT_TRUE(tensor2d_sparse_mult(&inputs, y, &out, false, &env) == SPARSE_TENSOR_INVALID_INDEXES, "Invalid indexes should be rejected.");
+
+test_cleanup:
+    sparse_tensor_free(&inputs, &env);
+    indexes_batch_free(ixs_batch);
+    cgrad_env_cleanup(&env);
+}
+
+static bool tensor_permute_matches_reference(const struct tensor *const t, const size_t *const perm, const struct tensor *const out)
+{
+    const size_t elem_size = dtype_sizeof(t->dtype);
+    for (size_t i = 0; i < out->data_size; i++)
+    {
+        // Unravel the index of the output, axis a of out being axis perm[a] of t
+        size_t t_offset = 0;
+        size_t remainder = i;
+        for (size_t a = out->shape_size; a-- > 0;)
+        {
+            t_offset += (remainder % out->shape[a]) * t->stride[perm[a]];
+            remainder /= out->shape[a];
+        }
+
+        if (memcmp((const unsigned char *)out->data + i * elem_size, (const unsigned char *)t->data + t_offset * elem_size, elem_size) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void tensor_reduce_reference(const struct tensor *const t, const size_t *const axes, const size_t n_axes, double *const sum, double *const max, size_t *const argmax)
+{
+    bool reduced[TENSOR_MAX_SHAPE_SIZE] = {false};
+    size_t n_out = 1;
+    for (size_t a = 0; a < n_axes; a++)
+    {
+        reduced[axes[a]] = true;
+    }
+    for (size_t a = 0; a < t->shape_size; a++)
+    {
+        n_out *= reduced[a] ? 1 : t->shape[a];
+    }
+    for (size_t j = 0; j < n_out; j++)
+    {
+        sum[j] = 0.0;
+        max[j] = -INFINITY;
+        argmax[j] = 0;
+    }
+
+    // Elements are visited in order, so a strictly greater value is needed to move the first maximum
+    for (size_t i = 0; i < t->data_size; i++)
+    {
+        size_t out_pos = 0;
+        size_t reduced_pos = 0;
+        for (size_t a = 0; a < t->shape_size; a++)
+        {
+            const size_t idx = i / t->stride[a] % t->shape[a];
+            if (reduced[a])
+            {
+                reduced_pos = reduced_pos * t->shape[a] + idx;
+            }
+            else
+            {
+                out_pos = out_pos * t->shape[a] + idx;
+            }
+        }
+
+        const double value = tensor_value(t, i);
+        sum[out_pos] += value;
+        if (value > max[out_pos])
+        {
+            max[out_pos] = value;
+            argmax[out_pos] = reduced_pos;
+        }
+    }
+}
+
+static double tensor_value(const struct tensor *const t, const size_t i)
+{
+    switch (t->dtype)
+    {
+    case DTYPE_FLOAT64:
+        return ((double *)t->data)[i];
+    case DTYPE_INT32:
+        return (double)((int32_t *)t->data)[i];
+    default:
+        return (double)((float *)t->data)[i];
+    }
+}
@@ -0,0 +1,249 @@
+#include "cgrad_test/assert.h"
+#include "cgrad_test/config.h"
+#include "cgrad_test/test_result.h"
+#include "cgrad_test/test_case.h"
+#include "cgrad_test/datastructures/test_list/test_list.h"
+#include "cgrad_test/datastructures/test_list/test_list_callbacks.h"
+#include "cgrad_test/run_tests.h"
+#include "cgrad/cgrad_env.h"
+#include "cgrad/parallel/thread_pool.h"
+#include "cgrad/layers/conv2d.h"
+#include "cgrad/layers/relu.h"
+#include "cgrad/losses/cross_entropy.h"
+#include "cgrad/autograd/backpropagation/backpropagation.h"
+#include "cgrad/tensor/tensor_alloc.h"
+#include "cgrad/tensor/tensor_reshape.h"
+#include "cgrad/tensor/tensor_sum.h"
+#include <stdio.h>
+#include <string.h>
+
+#define N_THREADS 4
+
+struct visit_counts
+{
+    unsigned char *counts;
+    struct thread_pool *pool;
+};
+
+void thread_pool_test_parallel_for(struct test_result *);
+void thread_pool_test_conv2d_matches_serial(struct test_result *);
+void thread_pool_test_kernels_match_serial(struct test_result *);
+
+static void count_visits(void *arg, const size_t begin, const size_t end);
+static void count_visits_nested(void *arg, const size_t begin, const size_t end);
+static bool tensor_data_equal(const struct tensor *const a, const struct tensor *const b);
+static void fill(struct tensor *const t, const size_t period, const double scale);
+
+int main(int argc, char **argv)
+{
+    struct test_list *tests = tests_list_alloc();
+    test_list_append(tests, &thread_pool_test_parallel_for, "thread_pool_test_parallel_for");
+    test_list_append(tests, &thread_pool_test_conv2d_matches_serial, "thread_pool_test_conv2d_matches_serial");
+    test_list_append(tests, &thread_pool_test_kernels_match_serial, "thread_pool_test_kernels_match_serial");
+
+    run_tests(tests);
+
+    size_t num_failed_tests = 0;
+    test_list_foreach(tests, &report_failures, &num_failed_tests);
+
+    size_t num_passed_tests = tests->size - num_failed_tests;
+    float percentage_passed_tests = ((float)num_passed_tests / (float)tests->size) * 100.0;
+    float percentage_failed_tests = ((float)num_failed_tests / (float)tests->size) * 100.0;
+
+    printf("Number of tests: %ld\n", tests->size);
+    printf("Number of passed tests: %ld (%.2f \%)\n", num_passed_tests, percentage_passed_tests);
+    printf("Number of failed tests: %ld (%.2f \%)\n", num_failed_tests, percentage_failed_tests);
+
+    return EXIT_SUCCESS;
+}
+
+void thread_pool_test_parallel_for(struct test_result *result)
+{
+    const size_t SIZES[] = {0, 1, 7, 1000, 100003};
+    const size_t GRAINS[] = {0, 1, 64, 5000};
+
+    struct thread_pool pool;
+    bool initialized = false;
+    unsigned char *counts = calloc(100003, 1);
+    ASSERT_TRUE(counts, "Allocation failed.");
+    ASSERT_TRUE(thread_pool_init(&pool, N_THREADS) == NO_ERROR, "Thread pool initialization should not fail.");
+    initialized = true;
+
+    for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); s++)
+    {
+        for (size_t g = 0; g < sizeof(GRAINS) / sizeof(GRAINS[0]); g++)
+        {
+            // Nested loops run serially, so every index is still visited once
+            struct visit_counts visits = {.counts = counts, .pool = &pool};
+            memset(counts, 0, SIZES[s]);
+            thread_pool_parallel_for(&pool, SIZES[s], GRAINS[g], &count_visits, &visits);
+            thread_pool_parallel_for(&pool, SIZES[s], GRAINS[g], &count_visits_nested, &visits);
+            thread_pool_parallel_for(NULL, SIZES[s], GRAINS[g], &count_visits, &visits);
+
+            for (size_t i = 0; i < SIZES[s]; i++)
+            {
+                ASSERT_TRUE(counts[i] == 3, "Every index should be visited once per loop.");
+            }
+        }
+    }
+
+test_cleanup:
+    if (initialized)
+    {
+        thread_pool_cleanup(&pool);
+    }
+    free(counts);
+}
+
+void thread_pool_test_conv2d_matches_serial(struct test_result *result)
+{
+    const cgrad_dtype DTYPE = DTYPE_FLOAT32;
+
+    struct cgrad_env env;
+    struct cgrad_env serial;
+    ASSERT_TRUE(cgrad_env_init(&env, 42, 20) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+    ASSERT_TRUE(cgrad_env_set_num_threads(&env, N_THREADS) == NO_ERROR, "Thread pool initialization should not fail.");
+    ASSERT_TRUE(cgrad_env_context_init(&serial, 20) == NO_ERROR && serial.pool == NULL, "Contexts should run kernels serially.");
+
+    struct conv2d conv;
+    ASSERT_TRUE(conv2d_init(&conv, 3, 8, 3, DTYPE, &env) == NO_ERROR && conv2d_xavier_init(&conv) == NO_ERROR, "Conv2d initialization failed.");
+
+    // Large enough for the patches, their scatter and the transposition to be split across threads
+    const size_t x_shape[] = {8, 3, 20, 20};
+    const size_t y_shape[] = {8, 1};
+    const size_t flat_shape[] = {8, 8 * 18 * 18};
+    struct cgrad_env *envs[] = {&serial, &env};
+    struct tensor *x[2];
+    struct tensor *out[2];
+    struct tensor *weight_grad[2] = {NULL, NULL};
+    for (size_t run = 0; run < 2; run++)
+    {
+        struct cgrad_env *run_env = envs[run];
+        x[run] = tensor_alloc(run_env, x_shape, 4, DTYPE);
+        struct tensor *y = tensor_alloc(run_env, y_shape, 2, DTYPE);
+        ASSERT_TRUE(x[run] && y, "Allocation failed.");
+        fill(x[run], 23, 0.05);
+        for (size_t i = 0; i < y->data_size; i++)
+        {
+            ((float *)y->data)[i] = (float)(i * 37 % 100);
+        }
+
+        struct tensor *h = NULL;
+        struct tensor *flat = NULL;
+        struct tensor *loss = NULL;
+        ASSERT_TRUE(conv2d_forward_env(&conv, x[run], &out[run], true, run_env) == NO_ERROR, "Conv2d forward failed.");
+        ASSERT_TRUE(relu_forward(out[run], &h, true, run_env) == NO_ERROR, "Relu forward failed.");
+        ASSERT_TRUE(tensor_reshape(h, flat_shape, 2, &flat, true, run_env) == NO_ERROR, "Reshape failed.");
+        ASSERT_TRUE(cross_entropy_loss(flat, y, &loss, true, run_env) == NO_ERROR, "Loss failed.");
+
+        conv.weight->grad = NULL;
+        ASSERT_TRUE(backward(loss, run_env) == NO_ERROR, "Backward failed.");
+        weight_grad[run] = conv.weight->grad;
+        ASSERT_TRUE(x[run]->grad && weight_grad[run], "Gradients should be computed.");
+    }
+
+    ASSERT_TRUE(tensor_data_equal(out[0], out[1]), "Parallel forward should match the serial one.");
+    ASSERT_TRUE(tensor_data_equal(x[0]->grad, x[1]->grad), "Parallel scatter should match the serial one.");
+    ASSERT_TRUE(tensor_data_equal(weight_grad[0], weight_grad[1]), "Parallel backward should match the serial one.");
+
+test_cleanup:
+    cgrad_env_cleanup(&serial);
+    cgrad_env_cleanup(&env);
+}
+
+void thread_pool_test_kernels_match_serial(struct test_result *result)
+{
+    const cgrad_dtype DTYPES[] = {DTYPE_FLOAT64, DTYPE_FLOAT32};
+
+    struct cgrad_env env;
+    struct cgrad_env serial;
+    ASSERT_TRUE(cgrad_env_init(&env, 42, 20) == NO_ERROR, "CGrad Environment Initialization should not fail.");
+    ASSERT_TRUE(cgrad_env_set_num_threads(&env, N_THREADS) == NO_ERROR, "Thread pool initialization should not fail.");
+    ASSERT_TRUE(cgrad_env_context_init(&serial, 20) == NO_ERROR, "Context initialization should not fail.");
+
+    for (size_t d = 0; d < sizeof(DTYPES) / sizeof(DTYPES[0]); d++)
+    {
+        const size_t logits_shape[] = {4096, 10};
+        const size_t targets_shape[] = {4096, 1};
+        const size_t sum_shape[] = {1, 10};
+        struct cgrad_env *envs[] = {&serial, &env};
+        struct tensor *relu_out[2];
+        struct tensor *loss[2];
+        struct tensor *logits[2];
+        struct tensor *sum[2];
+        for (size_t run = 0; run < 2; run++)
+        {
+            struct cgrad_env *run_env = envs[run];
+            struct tensor *x = tensor_alloc(run_env, logits_shape, 2, DTYPES[d]);
+            struct tensor *y = tensor_alloc(run_env, targets_shape, 2, DTYPES[d]);
+            sum[run] = tensor_alloc(run_env, sum_shape, 2, DTYPES[d]);
+            ASSERT_TRUE(x && y && sum[run], "Allocation failed.");
+            fill(x, 31, 0.1);
+            for (size_t i = 0; i < y->data_size; i++)
+            {
+                if (DTYPES[d] == DTYPE_FLOAT64)
+                {
+                    ((double *)y->data)[i] = (double)(i * 7 % 10);
+                }
+                else
+                {
+                    ((float *)y->data)[i] = (float)(i * 7 % 10);
+                }
+            }
+
+            ASSERT_TRUE(relu_forward(x, &relu_out[run], true, run_env) == NO_ERROR, "Relu forward failed.");
+            ASSERT_TRUE(cross_entropy_loss(relu_out[run], y, &loss[run], true, run_env) == NO_ERROR, "Loss failed.");
+            ASSERT_TRUE(tensor_sum_parallel(relu_out[run], 0, sum[run], run_env->pool) == NO_ERROR, "Sum failed.");
+            ASSERT_TRUE(backward(loss[run], run_env) == NO_ERROR, "Backward failed.");
+            logits[run] = relu_out[run];
+        }
+
+        // Per row losses are summed in order, so even the loss is bitwise identical
+        ASSERT_TRUE(tensor_data_equal(relu_out[0], relu_out[1]), "Parallel relu should match the serial one.");
+        ASSERT_TRUE(tensor_data_equal(loss[0], loss[1]), "Parallel loss should match the serial one.");
+        ASSERT_TRUE(tensor_data_equal(logits[0]->grad, logits[1]->grad), "Parallel loss gradient should match the serial one.");
+        ASSERT_TRUE(tensor_data_equal(sum[0], sum[1]), "Parallel sum should match the serial one.");
+    }
+
+test_cleanup:
+    cgrad_env_cleanup(&serial);
+    cgrad_env_cleanup(&env);
+}
+
+static void count_visits(void *arg, const size_t begin, const size_t end)
+{
+    struct visit_counts *visits = arg;
+    for (size_t i = begin; i < end; i++)
+    {
+        visits->counts[i]++;
+    }
+}
+
+static void count_visits_nested(void *arg, const size_t begin, const size_t end)
+{
+    struct visit_counts *visits = arg;
+    struct visit_counts range = {.counts = visits->counts + begin, .pool = NULL};
+    thread_pool_parallel_for(visits->pool, end - begin, 1, &count_visits, &range);
+}
+
+static bool tensor_data_equal(const struct tensor *const a, const struct tensor *const b)
+{
+    return a && b && a->data_size == b->data_size && a->dtype == b->dtype &&
+           memcmp(a->data, b->data, a->data_size * dtype_sizeof(a->dtype)) == 0;
+}
+
+static void fill(struct tensor *const t, const size_t period, const double scale)
+{
+    for (size_t i = 0; i < t->data_size; i++)
+    {
+        const double value = scale * (double)(i % period) - scale * period / 3.0;
+        if (t->dtype == DTYPE_FLOAT64)
+        {
+            ((double *)t->data)[i] = value;
+        }
+        else
+        {
+            ((float *)t->data)[i] = (float)value;
+        }
+    }
+}